@@ -0,0 +1,181 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef CODEC_FIELDVIEW_H_
+#define CODEC_FIELDVIEW_H_
+
+#include "common/base/Base.h"
+#include "common/meta/SchemaProviderIf.h"
+
+namespace nebula {
+
+/**
+ * A non-owning view of one field of a V2-encoded row. Resolving it
+ * walks the row header and the field offset only: no Value is
+ * constructed, no reader is initialized and no other field is touched,
+ * so probing a single column of a wide row costs a few loads. The
+ * composite types (DATE, DATETIME) are not resolved - a view of them
+ * reports !ok() and the caller falls back to a full reader.
+ *
+ * The view borrows the row bytes, so it must not outlive them.
+ */
+class FieldView final {
+public:
+    static FieldView of(const meta::SchemaProviderIf* schema,
+                        folly::StringPiece row,
+                        size_t index) noexcept {
+        FieldView view;
+        if (schema == nullptr || row.empty() || index >= schema->getNumFields()) {
+            return view;
+        }
+        size_t headerLen = (row[0] & 0x07) + 1;
+        size_t numNullables = schema->getNumNullableFields();
+        size_t numNullBytes = numNullables > 0 ? ((numNullables - 1) >> 3) + 1 : 0;
+        const auto* field = schema->field(index);
+        if (field == nullptr) {
+            return view;
+        }
+        view.type_ = field->type();
+
+        if (field->nullable()) {
+            static const uint8_t bits[] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
+            auto pos = field->nullFlagPos();
+            size_t nullOffset = headerLen + (pos >> 3);
+            if (nullOffset >= row.size()) {
+                return view;
+            }
+            if (row[nullOffset] & bits[pos & 0x07]) {
+                view.ok_ = true;
+                view.null_ = true;
+                return view;
+            }
+        }
+
+        size_t offset = headerLen + numNullBytes + field->offset();
+        size_t len = 0;
+        switch (view.type_) {
+            case meta::cpp2::PropertyType::BOOL:
+            case meta::cpp2::PropertyType::INT8:
+                len = sizeof(int8_t);
+                break;
+            case meta::cpp2::PropertyType::INT16:
+                len = sizeof(int16_t);
+                break;
+            case meta::cpp2::PropertyType::INT32:
+            case meta::cpp2::PropertyType::FLOAT:
+                len = sizeof(int32_t);
+                break;
+            case meta::cpp2::PropertyType::INT64:
+            case meta::cpp2::PropertyType::TIMESTAMP:
+            case meta::cpp2::PropertyType::DOUBLE:
+            case meta::cpp2::PropertyType::VID:
+                len = sizeof(int64_t);
+                break;
+            case meta::cpp2::PropertyType::FIXED_STRING:
+                len = field->size();
+                break;
+            case meta::cpp2::PropertyType::STRING: {
+                int32_t strOffset;
+                int32_t strLen;
+                if (offset + 2 * sizeof(int32_t) > row.size()) {
+                    return view;
+                }
+                memcpy(reinterpret_cast<void*>(&strOffset), &row[offset], sizeof(int32_t));
+                memcpy(reinterpret_cast<void*>(&strLen),
+                       &row[offset + sizeof(int32_t)],
+                       sizeof(int32_t));
+                // an empty string may point one past the end of the row
+                if (static_cast<size_t>(strOffset) + strLen > row.size()) {
+                    return view;
+                }
+                view.bytes_ = row.subpiece(strOffset, strLen);
+                view.ok_ = true;
+                return view;
+            }
+            default:
+                // composite types need a full reader
+                return view;
+        }
+        if (offset + len > row.size()) {
+            return view;
+        }
+        view.bytes_ = row.subpiece(offset, len);
+        view.ok_ = true;
+        return view;
+    }
+
+    // Whether the field was resolved; false for an unknown index, a
+    // truncated row or a type the view does not support
+    bool ok() const {
+        return ok_;
+    }
+
+    bool isNull() const {
+        return null_;
+    }
+
+    meta::cpp2::PropertyType type() const {
+        return type_;
+    }
+
+    // The raw bytes of the field inside the row
+    folly::StringPiece raw() const {
+        return bytes_;
+    }
+
+    // Typed accessors, only meaningful when ok() && !isNull() and the
+    // type matches
+    bool boolVal() const {
+        return bytes_[0] != 0;
+    }
+
+    int64_t intVal() const {
+        switch (type_) {
+            case meta::cpp2::PropertyType::INT8:
+                return static_cast<int8_t>(bytes_[0]);
+            case meta::cpp2::PropertyType::INT16: {
+                int16_t val;
+                memcpy(reinterpret_cast<void*>(&val), bytes_.data(), sizeof(int16_t));
+                return val;
+            }
+            case meta::cpp2::PropertyType::INT32: {
+                int32_t val;
+                memcpy(reinterpret_cast<void*>(&val), bytes_.data(), sizeof(int32_t));
+                return val;
+            }
+            default: {
+                int64_t val;
+                memcpy(reinterpret_cast<void*>(&val), bytes_.data(), sizeof(int64_t));
+                return val;
+            }
+        }
+    }
+
+    double doubleVal() const {
+        if (type_ == meta::cpp2::PropertyType::FLOAT) {
+            float val;
+            memcpy(reinterpret_cast<void*>(&val), bytes_.data(), sizeof(float));
+            return val;
+        }
+        double val;
+        memcpy(reinterpret_cast<void*>(&val), bytes_.data(), sizeof(double));
+        return val;
+    }
+
+    // STRING, FIXED_STRING and VID byte range
+    folly::StringPiece strVal() const {
+        return bytes_;
+    }
+
+private:
+    bool                        ok_{false};
+    bool                        null_{false};
+    meta::cpp2::PropertyType    type_{meta::cpp2::PropertyType::UNKNOWN};
+    folly::StringPiece          bytes_;
+};
+
+}  // namespace nebula
+#endif  // CODEC_FIELDVIEW_H_
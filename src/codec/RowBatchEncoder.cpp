@@ -0,0 +1,66 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "codec/RowBatchEncoder.h"
+
+namespace nebula {
+
+RowBatchEncoder::RowBatchEncoder(std::shared_ptr<const meta::SchemaProviderIf> schema,
+                                 const std::vector<std::string>& propNames)
+        : schema_(std::move(schema)) {
+    CHECK(!!schema_);
+    indices_.reserve(propNames.size());
+    for (const auto& name : propNames) {
+        auto index = schema_->getFieldIndex(name);
+        if (index < 0) {
+            ok_ = false;
+            return;
+        }
+        indices_.emplace_back(index);
+    }
+}
+
+
+StatusOr<std::string> RowBatchEncoder::encode(const std::vector<Value>& props) const {
+    if (!ok_) {
+        return Status::Error("Unknown property name");
+    }
+
+    // Strings are the only part of a row whose size the schema does not
+    // fix, so measuring them makes the reservation exact
+    size_t strSpace = 0;
+    for (const auto& value : props) {
+        if (value.type() == Value::Type::STRING) {
+            strSpace += value.getStr().size();
+        }
+    }
+
+    RowWriterV2 rowWrite(schema_.get(), strSpace);
+    if (!indices_.empty()) {
+        for (size_t i = 0; i < indices_.size(); i++) {
+            auto wRet = rowWrite.setValue(indices_[i], props[i]);
+            if (wRet != WriteResult::SUCCEEDED) {
+                return Status::Error("Add field faild");
+            }
+        }
+    } else {
+        for (size_t i = 0; i < props.size(); i++) {
+            auto wRet = rowWrite.setValue(i, props[i]);
+            if (wRet != WriteResult::SUCCEEDED) {
+                return Status::Error("Add field faild");
+            }
+        }
+    }
+
+    auto wRet = rowWrite.finish();
+    if (wRet != WriteResult::SUCCEEDED) {
+        return Status::Error("Add field faild");
+    }
+
+    return std::move(rowWrite).moveEncodedStr();
+}
+
+}  // namespace nebula
@@ -0,0 +1,47 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef CODEC_ROWBATCHENCODER_H_
+#define CODEC_ROWBATCHENCODER_H_
+
+#include "common/base/Base.h"
+#include "common/base/StatusOr.h"
+#include "common/meta/SchemaProviderIf.h"
+#include "codec/RowWriterV2.h"
+
+namespace nebula {
+
+/**
+ * Encodes a stream of rows which all share one schema and one property
+ * order, as the bulk ingest processors produce. The property names are
+ * resolved to field indices once at construction time, and every row
+ * buffer is reserved at its exact final size - the fixed area comes
+ * from the schema, the string area from the values - so encoding a row
+ * performs a single allocation and never grows the buffer.
+ */
+class RowBatchEncoder final {
+public:
+    // An empty propNames encodes the values in schema-defined order
+    RowBatchEncoder(std::shared_ptr<const meta::SchemaProviderIf> schema,
+                    const std::vector<std::string>& propNames);
+
+    // False when one of the property names is not part of the schema
+    bool ok() const {
+        return ok_;
+    }
+
+    // Encode one row. The values line up with the property order given
+    // at construction time
+    StatusOr<std::string> encode(const std::vector<Value>& props) const;
+
+private:
+    std::shared_ptr<const meta::SchemaProviderIf> schema_;
+    std::vector<ssize_t> indices_;
+    bool ok_{true};
+};
+
+}  // namespace nebula
+#endif  // CODEC_ROWBATCHENCODER_H_
@@ -0,0 +1,239 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "codec/RowDecodePlan.h"
+#include <numeric>
+
+namespace nebula {
+
+namespace {
+
+size_t fieldWidth(const meta::SchemaProviderIf::Field* field) {
+    switch (field->type()) {
+        case meta::cpp2::PropertyType::BOOL:
+        case meta::cpp2::PropertyType::INT8:
+            return sizeof(int8_t);
+        case meta::cpp2::PropertyType::INT16:
+            return sizeof(int16_t);
+        case meta::cpp2::PropertyType::INT32:
+        case meta::cpp2::PropertyType::FLOAT:
+            return sizeof(int32_t);
+        case meta::cpp2::PropertyType::INT64:
+        case meta::cpp2::PropertyType::TIMESTAMP:
+        case meta::cpp2::PropertyType::DOUBLE:
+        case meta::cpp2::PropertyType::VID:
+            return sizeof(int64_t);
+        case meta::cpp2::PropertyType::STRING:
+            // offset and length of the out-of-line bytes
+            return 2 * sizeof(int32_t);
+        case meta::cpp2::PropertyType::FIXED_STRING:
+            return field->size();
+        case meta::cpp2::PropertyType::DATE:
+            return sizeof(int16_t) + 2 * sizeof(int8_t);
+        case meta::cpp2::PropertyType::DATETIME:
+            return sizeof(int16_t) + 5 * sizeof(int8_t) + 2 * sizeof(int32_t);
+        default:
+            LOG(FATAL) << "Should not reach here";
+    }
+}
+
+}  // anonymous namespace
+
+RowDecodePlan::RowDecodePlan(const meta::SchemaProviderIf* schema,
+                             const std::vector<size_t>& projection)
+    : ver_(schema->getVersion()) {
+    size_t numNullables = schema->getNumNullableFields();
+    numNullBytes_ = numNullables > 0 ? ((numNullables - 1) >> 3) + 1 : 0;
+    size_t numNullBytes = numNullBytes_;
+    minBodyLen_ = numNullBytes;
+
+    std::vector<size_t> indices = projection;
+    if (indices.empty()) {
+        indices.resize(schema->getNumFields());
+        std::iota(indices.begin(), indices.end(), 0);
+    }
+
+    fields_.reserve(indices.size());
+    for (auto index : indices) {
+        const auto* field = schema->field(index);
+        CHECK(field != nullptr) << "Unknown field index " << index;
+        FieldPlan plan;
+        plan.offset = numNullBytes + field->offset();
+        plan.size = field->size();
+        plan.type = field->type();
+        plan.nullable = field->nullable();
+        if (plan.nullable) {
+            plan.nullByte = field->nullFlagPos() >> 3;
+            plan.nullMask = 0x80 >> (field->nullFlagPos() & 0x07);
+            // where the flag lands when the bitmap bytes are loaded
+            // into one little-endian word; flags beyond the first
+            // eight bytes keep the byte-at-a-time test
+            if (plan.nullByte < sizeof(uint64_t)) {
+                plan.nullBits = static_cast<uint64_t>(plan.nullMask) << (8 * plan.nullByte);
+                nullMask64_ |= plan.nullBits;
+            } else {
+                plan.nullBits = 0;
+            }
+        } else {
+            plan.nullByte = 0;
+            plan.nullMask = 0;
+            plan.nullBits = 0;
+        }
+        minBodyLen_ = std::max(minBodyLen_, plan.offset + fieldWidth(field));
+        fields_.emplace_back(std::move(plan));
+    }
+}
+
+bool RowDecodePlan::decode(folly::StringPiece row, std::vector<Value>& values) const {
+    if (row.empty()) {
+        return false;
+    }
+    size_t numVerBytes = row[0] & 0x07;
+    size_t headerLen = numVerBytes + 1;
+    SchemaVer ver = 0;
+    if (numVerBytes > 0) {
+        if (headerLen > row.size()) {
+            return false;
+        }
+        memcpy(reinterpret_cast<void*>(&ver), &row[1], numVerBytes);
+    }
+    if (ver != ver_ || headerLen + minBodyLen_ > row.size()) {
+        return false;
+    }
+
+    auto origSize = values.size();
+    const char* base = row.data() + headerLen;
+    // Load the null bitmap once and test it word-at-a-time; for the
+    // common all-set row every per-field null check below reduces to
+    // one AND against zero
+    uint64_t nulls = 0;
+    if (nullMask64_ != 0) {
+        memcpy(reinterpret_cast<void*>(&nulls), base,
+               std::min(numNullBytes_, sizeof(uint64_t)));
+        nulls &= nullMask64_;
+    }
+    for (const auto& field : fields_) {
+        bool isNull;
+        if (UNLIKELY(field.nullable && field.nullBits == 0)) {
+            // a flag beyond the first eight bitmap bytes
+            isNull = (base[field.nullByte] & field.nullMask) != 0;
+        } else {
+            isNull = (nulls & field.nullBits) != 0;
+        }
+        if (isNull) {
+            values.emplace_back(NullType::__NULL__);
+            continue;
+        }
+        const char* ptr = base + field.offset;
+        switch (field.type) {
+            case meta::cpp2::PropertyType::BOOL: {
+                values.emplace_back(*ptr != 0);
+                break;
+            }
+            case meta::cpp2::PropertyType::INT8: {
+                values.emplace_back(static_cast<int8_t>(*ptr));
+                break;
+            }
+            case meta::cpp2::PropertyType::INT16: {
+                int16_t val;
+                memcpy(reinterpret_cast<void*>(&val), ptr, sizeof(int16_t));
+                values.emplace_back(val);
+                break;
+            }
+            case meta::cpp2::PropertyType::INT32: {
+                int32_t val;
+                memcpy(reinterpret_cast<void*>(&val), ptr, sizeof(int32_t));
+                values.emplace_back(val);
+                break;
+            }
+            case meta::cpp2::PropertyType::INT64: {
+                int64_t val;
+                memcpy(reinterpret_cast<void*>(&val), ptr, sizeof(int64_t));
+                values.emplace_back(val);
+                break;
+            }
+            case meta::cpp2::PropertyType::VID: {
+                // compatible with V1, an 8-byte long string
+                values.emplace_back(std::string(ptr, sizeof(int64_t)));
+                break;
+            }
+            case meta::cpp2::PropertyType::FLOAT: {
+                float val;
+                memcpy(reinterpret_cast<void*>(&val), ptr, sizeof(float));
+                values.emplace_back(val);
+                break;
+            }
+            case meta::cpp2::PropertyType::DOUBLE: {
+                double val;
+                memcpy(reinterpret_cast<void*>(&val), ptr, sizeof(double));
+                values.emplace_back(val);
+                break;
+            }
+            case meta::cpp2::PropertyType::STRING: {
+                int32_t strOffset;
+                int32_t strLen;
+                memcpy(reinterpret_cast<void*>(&strOffset), ptr, sizeof(int32_t));
+                memcpy(reinterpret_cast<void*>(&strLen), ptr + sizeof(int32_t), sizeof(int32_t));
+                if (static_cast<size_t>(strOffset) == row.size() && strLen == 0) {
+                    values.emplace_back(std::string());
+                    break;
+                }
+                if (static_cast<size_t>(strOffset) + strLen > row.size()) {
+                    values.resize(origSize);
+                    return false;
+                }
+                values.emplace_back(std::string(&row[strOffset], strLen));
+                break;
+            }
+            case meta::cpp2::PropertyType::FIXED_STRING: {
+                values.emplace_back(std::string(ptr, field.size));
+                break;
+            }
+            case meta::cpp2::PropertyType::TIMESTAMP: {
+                Timestamp ts;
+                memcpy(reinterpret_cast<void*>(&ts), ptr, sizeof(Timestamp));
+                values.emplace_back(ts);
+                break;
+            }
+            case meta::cpp2::PropertyType::DATE: {
+                Date dt;
+                memcpy(reinterpret_cast<void*>(&dt.year), ptr, sizeof(int16_t));
+                memcpy(reinterpret_cast<void*>(&dt.month), ptr + sizeof(int16_t),
+                       sizeof(int8_t));
+                memcpy(reinterpret_cast<void*>(&dt.day),
+                       ptr + sizeof(int16_t) + sizeof(int8_t), sizeof(int8_t));
+                values.emplace_back(std::move(dt));
+                break;
+            }
+            case meta::cpp2::PropertyType::DATETIME: {
+                DateTime dt;
+                memcpy(reinterpret_cast<void*>(&dt.year), ptr, sizeof(int16_t));
+                memcpy(reinterpret_cast<void*>(&dt.month),
+                       ptr + sizeof(int16_t), sizeof(int8_t));
+                memcpy(reinterpret_cast<void*>(&dt.day),
+                       ptr + sizeof(int16_t) + sizeof(int8_t), sizeof(int8_t));
+                memcpy(reinterpret_cast<void*>(&dt.hour),
+                       ptr + sizeof(int16_t) + 2 * sizeof(int8_t), sizeof(int8_t));
+                memcpy(reinterpret_cast<void*>(&dt.minute),
+                       ptr + sizeof(int16_t) + 3 * sizeof(int8_t), sizeof(int8_t));
+                memcpy(reinterpret_cast<void*>(&dt.sec),
+                       ptr + sizeof(int16_t) + 4 * sizeof(int8_t), sizeof(int8_t));
+                memcpy(reinterpret_cast<void*>(&dt.microsec),
+                       ptr + sizeof(int16_t) + 5 * sizeof(int8_t), sizeof(int32_t));
+                memcpy(reinterpret_cast<void*>(&dt.timezone),
+                       ptr + sizeof(int16_t) + 5 * sizeof(int8_t) + sizeof(int32_t),
+                       sizeof(int32_t));
+                values.emplace_back(std::move(dt));
+                break;
+            }
+            default:
+                LOG(FATAL) << "Should not reach here";
+        }
+    }
+    return true;
+}
+
+}  // namespace nebula
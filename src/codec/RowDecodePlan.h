@@ -0,0 +1,68 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef CODEC_ROWDECODEPLAN_H_
+#define CODEC_ROWDECODEPLAN_H_
+
+#include "common/base/Base.h"
+#include "common/meta/SchemaProviderIf.h"
+#include "common/datatypes/Value.h"
+
+namespace nebula {
+
+/**
+ * A decode routine specialized for one schema version and one
+ * projection, assembled once and run per row. Building the plan
+ * resolves everything RowReaderV2 re-derives per access - header
+ * length, null bitmap layout, per-field absolute offsets and types -
+ * into a flat table, so decoding a row is a single pass over the table
+ * with no schema interpretation left.
+ *
+ * A plan only decodes rows written with the schema version it was built
+ * from; decode() rejects rows of any other version and the caller falls
+ * back to a reader.
+ */
+class RowDecodePlan final {
+public:
+    // An empty projection selects every field of the schema
+    RowDecodePlan(const meta::SchemaProviderIf* schema,
+                  const std::vector<size_t>& projection = {});
+
+    /**
+     * Appends one Value per projected field to values, in projection
+     * order. Returns false, appending nothing, when the row was written
+     * with a different schema version or is too short.
+     */
+    bool decode(folly::StringPiece row, std::vector<Value>& values) const;
+
+    size_t numFields() const {
+        return fields_.size();
+    }
+
+private:
+    struct FieldPlan {
+        size_t                      offset;    // offset from the end of the header
+        size_t                      size;      // fixed strings carry their size here
+        meta::cpp2::PropertyType    type;
+        bool                        nullable;
+        size_t                      nullByte;  // null flag byte, from the end of the header
+        uint8_t                     nullMask;
+        // the same flag as a bit in the bitmap loaded into one word,
+        // zero for non-nullable fields
+        uint64_t                    nullBits;
+    };
+
+    SchemaVer               ver_;
+    size_t                  minBodyLen_;  // null bitmap plus the fixed field area
+    size_t                  numNullBytes_;
+    // every null bit the projection touches; bitmaps of up to eight
+    // bytes are loaded once and tested word-at-a-time against this
+    uint64_t                nullMask64_{0};
+    std::vector<FieldPlan>  fields_;
+};
+
+}  // namespace nebula
+#endif  // CODEC_ROWDECODEPLAN_H_
@@ -73,9 +73,10 @@ std::unique_ptr<RowReader> RowReader::getTagPropReader(
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         TagID tag,
-        folly::StringPiece row) {
+        folly::StringPiece row,
+        SchemaVerCache* cache) {
     auto reader = std::make_unique<RowReaderWrapper>();
-    if (reader->resetTagPropReader(schemaMan, space, tag, row)) {
+    if (reader->resetTagPropReader(schemaMan, space, tag, row, cache)) {
         return reader;
     }
     LOG(ERROR) << "Failed to initiate the reader, most likely the data"
@@ -91,9 +92,10 @@ std::unique_ptr<RowReader> RowReader::getEdgePropReader(
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         EdgeType edge,
-        folly::StringPiece row) {
+        folly::StringPiece row,
+        SchemaVerCache* cache) {
     auto reader = std::make_unique<RowReaderWrapper>();
-    if (reader->resetEdgePropReader(schemaMan, space, edge, row)) {
+    if (reader->resetEdgePropReader(schemaMan, space, edge, row, cache)) {
         return reader;
     }
     LOG(ERROR) << "Failed to initiate the reader, most likely the data"
@@ -155,7 +157,8 @@ bool RowReader::resetTagPropReader(
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         TagID tag,
-        folly::StringPiece row) {
+        folly::StringPiece row,
+        SchemaVerCache* cache) {
     if (schemaMan == nullptr) {
         LOG(ERROR) << "schemaMan should not be nullptr!";
         return false;
@@ -164,6 +167,16 @@ bool RowReader::resetTagPropReader(
     int32_t readerVer;
     RowReaderWrapper::getVersions(row, schemaVer, readerVer);
     if (schemaVer >= 0) {
+        if (cache != nullptr) {
+            auto& schema = cache->slot(tag, schemaVer);
+            if (schema == nullptr) {
+                schema = schemaMan->getTagSchema(space, tag, schemaVer);
+                if (schema == nullptr) {
+                    return false;
+                }
+            }
+            return reset(schema.get(), row, readerVer);
+        }
         auto schema = schemaMan->getTagSchema(space, tag, schemaVer);
         if (schema == nullptr) {
             return false;
@@ -179,7 +192,8 @@ bool RowReader::resetEdgePropReader(
             meta::SchemaManager* schemaMan,
             GraphSpaceID space,
             EdgeType edge,
-            folly::StringPiece row) {
+            folly::StringPiece row,
+            SchemaVerCache* cache) {
     if (schemaMan == nullptr) {
         LOG(ERROR) << "schemaMan should not be nullptr!";
         return false;
@@ -188,6 +202,16 @@ bool RowReader::resetEdgePropReader(
     int32_t readerVer;
     RowReaderWrapper::getVersions(row, schemaVer, readerVer);
     if (schemaVer >= 0) {
+        if (cache != nullptr) {
+            auto& schema = cache->slot(edge, schemaVer);
+            if (schema == nullptr) {
+                schema = schemaMan->getEdgeSchema(space, edge, schemaVer);
+                if (schema == nullptr) {
+                    return false;
+                }
+            }
+            return reset(schema.get(), row, readerVer);
+        }
         auto schema = schemaMan->getEdgeSchema(space, edge, schemaVer);
         if (schema == nullptr) {
             return false;
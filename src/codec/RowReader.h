@@ -15,6 +15,37 @@
 
 namespace nebula {
 
+// One scan's cache of the schemas it has resolved, keyed by tag id or
+// edge type and indexed by schema version, populated on the first miss
+// of each version. Scan loops hand it to the reader factories so a
+// mixed-version scan asks the schema manager at most once per version
+// instead of once per row. Not thread safe: one cache belongs to one
+// scan, and since tag ids and edge types may collide, a cache holds
+// one kind of schema only
+class SchemaVerCache final {
+public:
+    // The cache slot of the given schema id and version, growing the
+    // cache as needed; an empty slot is the caller's to fill
+    std::shared_ptr<const meta::NebulaSchemaProvider>& slot(int32_t id, SchemaVer ver) {
+        for (auto& entry : entries_) {
+            if (entry.first == id) {
+                if (entry.second.size() <= static_cast<size_t>(ver)) {
+                    entry.second.resize(ver + 1);
+                }
+                return entry.second[ver];
+            }
+        }
+        entries_.emplace_back(
+            id, std::vector<std::shared_ptr<const meta::NebulaSchemaProvider>>(ver + 1));
+        return entries_.back().second[ver];
+    }
+
+private:
+    std::vector<std::pair<int32_t,
+                          std::vector<std::shared_ptr<const meta::NebulaSchemaProvider>>>>
+        entries_;
+};
+
 /**
  * This class decodes one row of data
  */
@@ -70,17 +101,21 @@ public:
 
 
 public:
+    // `cache`, when given, short-circuits the per-row schema version
+    // resolution; see SchemaVerCache
     static std::unique_ptr<RowReader> getTagPropReader(
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         TagID tag,
-        folly::StringPiece row);
+        folly::StringPiece row,
+        SchemaVerCache* cache = nullptr);
 
     static std::unique_ptr<RowReader> getEdgePropReader(
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         EdgeType edge,
-        folly::StringPiece row);
+        folly::StringPiece row,
+        SchemaVerCache* cache = nullptr);
 
     static std::unique_ptr<RowReader> getRowReader(
         meta::SchemaProviderIf const* schema,
@@ -96,13 +131,15 @@ public:
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         TagID tag,
-        folly::StringPiece row);
+        folly::StringPiece row,
+        SchemaVerCache* cache = nullptr);
 
     bool resetEdgePropReader(
         meta::SchemaManager* schemaMan,
         GraphSpaceID space,
         EdgeType edge,
-        folly::StringPiece row);
+        folly::StringPiece row,
+        SchemaVerCache* cache = nullptr);
 
     bool reset(meta::SchemaProviderIf const* schema,
                folly::StringPiece row) noexcept;
@@ -147,6 +184,11 @@ public:
         return data_.toString();
     }
 
+    // The raw row the reader decodes, without copying it
+    folly::StringPiece rowData() const {
+        return data_;
+    }
+
 protected:
     meta::SchemaProviderIf const* schema_;
     folly::StringPiece data_;
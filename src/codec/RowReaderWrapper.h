@@ -24,6 +24,18 @@ public:
                folly::StringPiece row,
                int32_t readVer) noexcept override;
 
+    // The reader picked for the current row, nullptr when the wrapper
+    // holds no valid row. Iterator loops read through it directly, so
+    // every access skips the wrapper's forwarding hop
+    RowReader* currReader() const noexcept {
+        return currReader_;
+    }
+
+    // Drop the current row, making currReader() return nullptr
+    void clear() noexcept {
+        currReader_ = nullptr;
+    }
+
     Value getValueByName(const std::string& prop) const noexcept override {
         DCHECK(!!currReader_);
         return currReader_->getValueByName(prop);
@@ -82,7 +94,7 @@ public:
 private:
     RowReaderV1 readerV1_;
     RowReaderV2 readerV2_;
-    RowReader* currReader_;
+    RowReader* currReader_ = nullptr;
 };
 
 }  // namespace nebula
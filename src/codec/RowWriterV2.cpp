@@ -10,6 +10,11 @@
 namespace nebula {
 
 RowWriterV2::RowWriterV2(const meta::SchemaProviderIf* schema)
+        : RowWriterV2(schema, 1024) {
+}
+
+
+RowWriterV2::RowWriterV2(const meta::SchemaProviderIf* schema, size_t reservedStrSpace)
         : schema_(schema)
         , numNullBytes_(0)
         , approxStrLen_(0)
@@ -18,7 +23,7 @@ RowWriterV2::RowWriterV2(const meta::SchemaProviderIf* schema)
     CHECK(!!schema_);
 
     // Reserve space for the header, the data, and the string values
-    buf_.reserve(schema_->size() + schema_->getNumFields() / 8 + 8 + 1024);
+    buf_.reserve(schema_->size() + schema_->getNumFields() / 8 + 8 + reservedStrSpace);
 
     char header = 0;
 
@@ -87,6 +87,10 @@ enum class WriteResult {
 class RowWriterV2 {
 public:
     explicit RowWriterV2(const meta::SchemaProviderIf* schema);
+    // Same as above, but reserves the given number of bytes for the
+    // variant length string content instead of the default guess, so a
+    // caller who knows the string sizes avoids every reallocation
+    RowWriterV2(const meta::SchemaProviderIf* schema, size_t reservedStrSpace);
     // This constructor only takes a V2 encoded string
     RowWriterV2(const meta::SchemaProviderIf* schema, std::string&& encoded);
     // This constructor only takes a V2 encoded string
@@ -105,6 +109,22 @@ public:
         return schema_;
     }
 
+    // The bytes every row encoded with this schema version starts
+    // with: the header byte plus the schema version
+    std::string header() const {
+        return buf_.substr(0, headerLen_);
+    }
+
+    // The absolute byte offset of a fixed-size field in the encoded
+    // row, or -1 for an unknown field
+    int64_t fieldOffset(ssize_t index) const noexcept {
+        auto field = schema_->field(index);
+        if (field == nullptr) {
+            return -1;
+        }
+        return headerLen_ + numNullBytes_ + field->offset();
+    }
+
     const std::string& getEncodedStr() const noexcept {
         CHECK(finished_) << "You need to call finish() first";
         return buf_;
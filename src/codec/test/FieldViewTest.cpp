@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "codec/FieldView.h"
+#include "codec/RowWriterV2.h"
+#include "codec/test/SchemaWriter.h"
+
+namespace nebula {
+
+using meta::cpp2::PropertyType;
+
+TEST(FieldView, encodedData) {
+    SchemaWriter schema(7 /*Schema version*/);
+    schema.appendCol("bool_col", PropertyType::BOOL);
+    schema.appendCol("int_col", PropertyType::INT64);
+    schema.appendCol("double_col", PropertyType::DOUBLE);
+    schema.appendCol("str_col", PropertyType::STRING);
+    schema.appendCol("fixed_str_col", PropertyType::FIXED_STRING, 12);
+    schema.appendCol("date_col", PropertyType::DATE);
+    schema.appendCol("nullable_col", PropertyType::INT64, 0, true);
+
+    RowWriterV2 writer(&schema);
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(0, true));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(1, 64));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(2, 2.718));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(3, std::string("Hello world!")));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(4, std::string("Nebula Graph")));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(5, Date(2020, 2, 20)));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.setNull(6));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.finish());
+    std::string encoded = writer.moveEncodedStr();
+    folly::StringPiece row(encoded);
+
+    auto v0 = FieldView::of(&schema, row, 0);
+    ASSERT_TRUE(v0.ok());
+    EXPECT_FALSE(v0.isNull());
+    EXPECT_TRUE(v0.boolVal());
+
+    auto v1 = FieldView::of(&schema, row, 1);
+    ASSERT_TRUE(v1.ok());
+    EXPECT_EQ(64, v1.intVal());
+
+    auto v2 = FieldView::of(&schema, row, 2);
+    ASSERT_TRUE(v2.ok());
+    EXPECT_DOUBLE_EQ(2.718, v2.doubleVal());
+
+    auto v3 = FieldView::of(&schema, row, 3);
+    ASSERT_TRUE(v3.ok());
+    EXPECT_EQ("Hello world!", v3.strVal());
+
+    auto v4 = FieldView::of(&schema, row, 4);
+    ASSERT_TRUE(v4.ok());
+    EXPECT_EQ("Nebula Graph", v4.strVal());
+
+    // composite types are not resolved
+    auto v5 = FieldView::of(&schema, row, 5);
+    EXPECT_FALSE(v5.ok());
+
+    auto v6 = FieldView::of(&schema, row, 6);
+    ASSERT_TRUE(v6.ok());
+    EXPECT_TRUE(v6.isNull());
+
+    // out of range index
+    auto v7 = FieldView::of(&schema, row, 7);
+    EXPECT_FALSE(v7.ok());
+}
+
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
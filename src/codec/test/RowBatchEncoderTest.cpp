@@ -0,0 +1,79 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "codec/RowBatchEncoder.h"
+#include "codec/RowWriterV2.h"
+#include "codec/test/SchemaWriter.h"
+
+namespace nebula {
+
+using meta::cpp2::PropertyType;
+
+TEST(RowBatchEncoder, matchesRowWriter) {
+    auto schema = std::make_shared<SchemaWriter>(3 /*Schema version*/);
+    schema->appendCol("bool_col", PropertyType::BOOL);
+    schema->appendCol("int_col", PropertyType::INT64);
+    schema->appendCol("str_col", PropertyType::STRING);
+    schema->appendCol("nullable_col", PropertyType::INT64, 0, true);
+
+    // the props arrive in a different order than the schema defines
+    std::vector<std::string> propNames = {"str_col", "int_col", "bool_col", "nullable_col"};
+    std::vector<Value> props = {"Hello world!", 64, true, Value::kNullValue};
+
+    RowBatchEncoder encoder(schema, propNames);
+    ASSERT_TRUE(encoder.ok());
+    auto status = encoder.encode(props);
+    ASSERT_TRUE(status.ok());
+
+    RowWriterV2 writer(schema.get());
+    for (size_t i = 0; i < propNames.size(); i++) {
+        ASSERT_EQ(WriteResult::SUCCEEDED, writer.setValue(propNames[i], props[i]));
+    }
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.finish());
+    EXPECT_EQ(writer.moveEncodedStr(), status.value());
+}
+
+
+TEST(RowBatchEncoder, schemaOrder) {
+    auto schema = std::make_shared<SchemaWriter>();
+    schema->appendCol("int_col", PropertyType::INT64);
+    schema->appendCol("double_col", PropertyType::DOUBLE);
+
+    // an empty prop name list means the values follow the schema order
+    RowBatchEncoder encoder(schema, {});
+    ASSERT_TRUE(encoder.ok());
+    auto status = encoder.encode({64, 2.718});
+    ASSERT_TRUE(status.ok());
+
+    RowWriterV2 writer(schema.get());
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(0, 64));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(1, 2.718));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.finish());
+    EXPECT_EQ(writer.moveEncodedStr(), status.value());
+}
+
+
+TEST(RowBatchEncoder, unknownProp) {
+    auto schema = std::make_shared<SchemaWriter>();
+    schema->appendCol("int_col", PropertyType::INT64);
+
+    RowBatchEncoder encoder(schema, {"no_such_col"});
+    EXPECT_FALSE(encoder.ok());
+    EXPECT_FALSE(encoder.encode({64}).ok());
+}
+
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "codec/RowDecodePlan.h"
+#include "codec/RowReaderWrapper.h"
+#include "codec/RowWriterV2.h"
+#include "codec/test/SchemaWriter.h"
+
+namespace nebula {
+
+using meta::cpp2::PropertyType;
+
+TEST(RowDecodePlan, matchesReader) {
+    SchemaWriter schema(3 /*Schema version*/);
+    schema.appendCol("bool_col", PropertyType::BOOL);
+    schema.appendCol("int_col", PropertyType::INT64);
+    schema.appendCol("double_col", PropertyType::DOUBLE);
+    schema.appendCol("str_col", PropertyType::STRING);
+    schema.appendCol("fixed_str_col", PropertyType::FIXED_STRING, 12);
+    schema.appendCol("date_col", PropertyType::DATE);
+    schema.appendCol("nullable_col", PropertyType::INT64, 0, true);
+
+    RowWriterV2 writer(&schema);
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(0, true));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(1, 64));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(2, 2.718));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(3, std::string("Hello world!")));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(4, std::string("Nebula Graph")));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.set(5, Date(2020, 2, 20)));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.setNull(6));
+    ASSERT_EQ(WriteResult::SUCCEEDED, writer.finish());
+    std::string encoded = writer.moveEncodedStr();
+    folly::StringPiece row(encoded);
+
+    auto reader = RowReader::getRowReader(&schema, row);
+    ASSERT_TRUE(!!reader);
+
+    // the full-row plan decodes exactly what the reader does
+    RowDecodePlan plan(&schema);
+    ASSERT_EQ(schema.getNumFields(), plan.numFields());
+    std::vector<Value> values;
+    ASSERT_TRUE(plan.decode(row, values));
+    ASSERT_EQ(schema.getNumFields(), values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        EXPECT_EQ(reader->getValueByIndex(i), values[i]) << "Field " << i;
+    }
+
+    // a projected plan decodes only the selected fields, in order
+    RowDecodePlan projected(&schema, {3, 1});
+    std::vector<Value> projValues;
+    ASSERT_TRUE(projected.decode(row, projValues));
+    ASSERT_EQ(2, projValues.size());
+    EXPECT_EQ(Value("Hello world!"), projValues[0]);
+    EXPECT_EQ(Value(64), projValues[1]);
+
+    // a row of another schema version is rejected
+    SchemaWriter newerSchema(4 /*Schema version*/);
+    newerSchema.appendCol("bool_col", PropertyType::BOOL);
+    RowDecodePlan newerPlan(&newerSchema);
+    std::vector<Value> rejected;
+    EXPECT_FALSE(newerPlan.decode(row, rejected));
+    EXPECT_TRUE(rejected.empty());
+}
+
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -6,6 +6,7 @@
 
 #include "common/base/Base.h"
 #include "common/datatypes/Value.h"
+#include "common/meta/NebulaSchemaProvider.h"
 #include <gtest/gtest.h>
 #include "codec/RowReaderWrapper.h"
 #include "codec/test/SchemaWriter.h"
@@ -329,6 +330,22 @@ TEST(RowReaderV2, iterator) {
     EXPECT_EQ(64, index);
 }
 
+TEST(SchemaVerCache, Slot) {
+    SchemaVerCache cache;
+    // An untouched slot is empty; the caller fills it once per version
+    EXPECT_EQ(nullptr, cache.slot(3, 1));
+    cache.slot(3, 1) = std::make_shared<meta::NebulaSchemaProvider>(1);
+    EXPECT_EQ(1, cache.slot(3, 1)->getVersion());
+
+    // Other versions and other ids have their own, still empty, slots
+    EXPECT_EQ(nullptr, cache.slot(3, 0));
+    EXPECT_EQ(nullptr, cache.slot(4, 1));
+
+    // Growing the version range keeps what was already resolved
+    EXPECT_EQ(nullptr, cache.slot(3, 7));
+    EXPECT_EQ(1, cache.slot(3, 1)->getVersion());
+}
+
 }  // namespace nebula
 
 
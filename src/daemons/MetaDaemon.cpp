@@ -23,6 +23,7 @@
 #include "meta/KVBasedClusterIdMan.h"
 #include "meta/ActiveHostsMan.h"
 #include "meta/processors/jobMan/JobManager.h"
+#include "meta/processors/admin/Balancer.h"
 #include "meta/RootUserMan.h"
 #include "meta/MetaServiceUtils.h"
 
@@ -52,6 +53,7 @@ DEFINE_bool(upgrade_meta_data, false, "old stored meta data may have different f
                                       " set to true to do meta data upgrade");
 
 static std::unique_ptr<apache::thrift::ThriftServer> gServer;
+static nebula::meta::Balancer* gBalancer = nullptr;
 static void signalHandler(int sig);
 static Status setupSignalHandler();
 
@@ -99,6 +101,11 @@ std::unique_ptr<nebula::kvstore::KVStore> initKV(std::vector<nebula::HostAddr> p
         auto ret = kvstore->partLeader(nebula::meta::kDefaultSpaceId,
                                        nebula::meta::kDefaultPartId);
         if (!nebula::ok(ret)) {
+            if (!kvstore->diskLoadFinished()) {
+                LOG(INFO) << "The part is still loading from disk, sleep 1s";
+                sleep(1);
+                continue;
+            }
             LOG(ERROR) << "Nebula store init failed";
             return nullptr;
         }
@@ -259,6 +266,16 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    {
+        // Safe to start on every metad, only the meta leader acts; a
+        // no-op unless --auto_leader_balance_interval_secs is positive
+        gBalancer = nebula::meta::Balancer::instance(kvstore.get());
+        if (!gBalancer->startAutoLeaderBalance(localhost)) {
+            LOG(ERROR) << "Start auto leader balance failed";
+            return EXIT_FAILURE;
+        }
+    }
+
     // Setup the signal handlers
     status = setupSignalHandler();
     if (!status.ok()) {
@@ -302,6 +319,9 @@ void signalHandler(int sig) {
             if (gServer) {
                 gServer->stop();
             }
+            if (gBalancer) {
+                gBalancer->stopAutoLeaderBalance();
+            }
             {
                 auto gJobMgr = nebula::meta::JobManager::getInstance();
                 gJobMgr->shutDown();
@@ -0,0 +1,118 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "kvstore/CacheWarmup.h"
+#include "utils/Types.h"
+
+DEFINE_bool(block_cache_warmup, false,
+            "Whether to profile the hot keys of every engine and replay "
+            "them after a restart, re-warming the block cache in the "
+            "background instead of re-faulting the working set on client "
+            "traffic");
+DEFINE_int32(block_cache_warmup_top_n, 4096,
+             "Number of hottest entries one engine's warmup profile keeps");
+DEFINE_int32(block_cache_warmup_interval_secs, 600,
+             "How often the warmup profiles are persisted");
+DEFINE_int32(block_cache_warmup_sample_every_n, 64,
+             "Only every n-th engine read is recorded into the profile");
+
+namespace nebula {
+namespace kvstore {
+
+void CacheWarmup::record(AccessKind kind, folly::StringPiece key) {
+    std::string entry;
+    entry.reserve(1 + key.size());
+    entry.append(1, static_cast<char>(kind));
+    entry.append(key.data(), key.size());
+    std::lock_guard<std::mutex> g(lock_);
+    auto& count = hits_[std::move(entry)];
+    count++;
+    // Lossy bound: drop what was seen once, so the steady working set
+    // survives churny one-off scans
+    if (hits_.size() > 4 * static_cast<size_t>(FLAGS_block_cache_warmup_top_n)) {
+        for (auto it = hits_.begin(); it != hits_.end();) {
+            if (it->second <= 1) {
+                it = hits_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+std::string CacheWarmup::encode() const {
+    // Encode under the lock so the pointers into the table stay valid
+    std::lock_guard<std::mutex> g(lock_);
+    std::vector<std::pair<uint64_t, const std::string*>> sorted;
+    sorted.reserve(hits_.size());
+    for (const auto& entry : hits_) {
+        sorted.emplace_back(entry.second, &entry.first);
+    }
+    // Hottest first
+    std::sort(sorted.begin(), sorted.end(),
+              [] (const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    });
+    if (sorted.size() > static_cast<size_t>(FLAGS_block_cache_warmup_top_n)) {
+        sorted.resize(FLAGS_block_cache_warmup_top_n);
+    }
+    if (sorted.empty()) {
+        return "";
+    }
+    std::string image;
+    auto num = static_cast<int32_t>(sorted.size());
+    image.append(reinterpret_cast<const char*>(&num), sizeof(int32_t));
+    for (const auto& entry : sorted) {
+        image.append(reinterpret_cast<const char*>(&entry.first), sizeof(uint64_t));
+        auto len = static_cast<int32_t>(entry.second->size());
+        image.append(reinterpret_cast<const char*>(&len), sizeof(int32_t));
+        image.append(*entry.second);
+    }
+    return image;
+}
+
+// static
+bool CacheWarmup::decode(folly::StringPiece image, std::vector<Entry>& out) {
+    out.clear();
+    size_t offset = 0;
+    auto readI32 = [&image, &offset] (int32_t& val) {
+        if (offset + sizeof(int32_t) > image.size()) {
+            return false;
+        }
+        val = readInt<int32_t>(image.data() + offset, sizeof(int32_t));
+        offset += sizeof(int32_t);
+        return true;
+    };
+    int32_t num = 0;
+    if (!readI32(num) || num < 0) {
+        return false;
+    }
+    out.reserve(num);
+    for (int32_t i = 0; i < num; i++) {
+        if (offset + sizeof(uint64_t) > image.size()) {
+            return false;
+        }
+        auto hits = readInt<uint64_t>(image.data() + offset, sizeof(uint64_t));
+        offset += sizeof(uint64_t);
+        int32_t len = 0;
+        if (!readI32(len) || len < 1 || offset + len > image.size()) {
+            return false;
+        }
+        Entry entry;
+        entry.kind = static_cast<AccessKind>(image[offset]);
+        if (entry.kind != AccessKind::GET && entry.kind != AccessKind::PREFIX) {
+            return false;
+        }
+        entry.hits = hits;
+        entry.key.assign(image.data() + offset + 1, len - 1);
+        offset += len;
+        out.emplace_back(std::move(entry));
+    }
+    return true;
+}
+
+}  // namespace kvstore
+}  // namespace nebula
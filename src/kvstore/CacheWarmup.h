@@ -0,0 +1,63 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef KVSTORE_CACHEWARMUP_H_
+#define KVSTORE_CACHEWARMUP_H_
+
+#include "common/base/Base.h"
+
+namespace nebula {
+namespace kvstore {
+
+/**
+ * Sampled hot-key profile of one engine, feeding the block cache
+ * warmup after a restart. The engine records a sample of the keys it
+ * serves into a frequency table; every --block_cache_warmup_interval_secs
+ * the hottest entries are persisted inside the engine itself, and on
+ * startup the saved profile is replayed in the background, hottest
+ * entries first, faulting the blocks of the working set back in
+ * through the normal read path. Replaying reads keeps the mechanism
+ * independent of the RocksDB version - no persistent secondary cache
+ * needed - at the cost of re-reading the blocks instead of loading
+ * them back directly.
+ *
+ * The table is lossy: when it outgrows its bound, the entries seen
+ * only once are dropped, so a steady working set survives churny
+ * one-off scans. record() is safe to call concurrently.
+ * */
+class CacheWarmup final {
+public:
+    // How the key was accessed, deciding how the warmup replays it
+    enum class AccessKind : char {
+        GET = 0x01,
+        PREFIX = 0x02,
+    };
+
+    struct Entry {
+        AccessKind kind;
+        uint64_t hits;
+        std::string key;
+    };
+
+    void record(AccessKind kind, folly::StringPiece key);
+
+    // Serialize the hottest --block_cache_warmup_top_n entries,
+    // descending by hit count; empty when nothing was recorded
+    std::string encode() const;
+
+    // Restore the entries of a persisted profile in their stored
+    // order. Returns false on a corrupt image
+    static bool decode(folly::StringPiece image, std::vector<Entry>& out);
+
+private:
+    mutable std::mutex lock_;
+    // Keyed by the kind byte followed by the raw key
+    std::unordered_map<std::string, uint64_t> hits_;
+};
+
+}  // namespace kvstore
+}  // namespace nebula
+#endif  // KVSTORE_CACHEWARMUP_H_
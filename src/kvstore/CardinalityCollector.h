@@ -0,0 +1,125 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef KVSTORE_CARDINALITYCOLLECTOR_H_
+#define KVSTORE_CARDINALITYCOLLECTOR_H_
+
+#include "common/base/Base.h"
+#include "utils/NebulaKeyUtils.h"
+#include <rocksdb/table_properties.h>
+
+namespace nebula {
+namespace kvstore {
+
+// The user property each data sst carries when
+// --enable_cardinality_stats is on: the counts of its vertex entries
+// per (part, tag) and edge entries per (part, edgeType), one
+// whitespace-separated line each
+constexpr char kCardinalityProperty[] = "nebula.cardinality";
+
+// Counts the vertex and edge entries of one sst as rocksdb builds it
+// at flush or compaction time, so the per-part cardinalities come for
+// free with writes the engine does anyway. The counts include every
+// stored version and entries shadowed by later deletes, so they are
+// upper bounds that each compaction tightens
+class CardinalityCollector final : public rocksdb::TablePropertiesCollector {
+public:
+    explicit CardinalityCollector(int32_t vIdLen) : vIdLen_(vIdLen) {}
+
+    rocksdb::Status AddUserKey(const rocksdb::Slice& key,
+                               const rocksdb::Slice& value,
+                               rocksdb::EntryType type,
+                               rocksdb::SequenceNumber seq,
+                               uint64_t fileSize) override {
+        UNUSED(value);
+        UNUSED(seq);
+        UNUSED(fileSize);
+        if (type != rocksdb::kEntryPut) {
+            return rocksdb::Status::OK();
+        }
+        folly::StringPiece raw(key.data(), key.size());
+        if (NebulaKeyUtils::isVertex(vIdLen_, raw)) {
+            vertices_[std::make_pair(NebulaKeyUtils::getPart(raw),
+                                     NebulaKeyUtils::getTagId(vIdLen_, raw))]++;
+        } else if (NebulaKeyUtils::isEdge(vIdLen_, raw)) {
+            edges_[std::make_pair(NebulaKeyUtils::getPart(raw),
+                                  NebulaKeyUtils::getEdgeType(vIdLen_, raw))]++;
+        }
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status Finish(rocksdb::UserCollectedProperties* props) override {
+        std::string encoded;
+        for (const auto& v : vertices_) {
+            encoded += folly::stringPrintf("v %d %d %ld\n",
+                                           v.first.first, v.first.second, v.second);
+        }
+        for (const auto& e : edges_) {
+            encoded += folly::stringPrintf("e %d %d %ld\n",
+                                           e.first.first, e.first.second, e.second);
+        }
+        props->emplace(kCardinalityProperty, std::move(encoded));
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::UserCollectedProperties GetReadableProperties() const override {
+        return rocksdb::UserCollectedProperties{};
+    }
+
+    const char* Name() const override {
+        return "CardinalityCollector";
+    }
+
+    // Fold one encoded property into the running per-part sums; lines
+    // it cannot parse are skipped
+    static void merge(const std::string& encoded,
+                      std::map<std::pair<PartitionID, TagID>, int64_t>* vertices,
+                      std::map<std::pair<PartitionID, EdgeType>, int64_t>* edges) {
+        std::vector<folly::StringPiece> lines;
+        folly::split('\n', encoded, lines, true);
+        for (const auto& line : lines) {
+            char kind = 0;
+            int32_t part = 0;
+            int32_t schemaId = 0;
+            int64_t count = 0;
+            if (sscanf(line.str().c_str(), "%c %d %d %ld",
+                       &kind, &part, &schemaId, &count) != 4) {
+                continue;
+            }
+            if (kind == 'v') {
+                (*vertices)[std::make_pair(part, schemaId)] += count;
+            } else if (kind == 'e') {
+                (*edges)[std::make_pair(part, schemaId)] += count;
+            }
+        }
+    }
+
+private:
+    int32_t vIdLen_;
+    std::map<std::pair<PartitionID, TagID>, int64_t> vertices_;
+    std::map<std::pair<PartitionID, EdgeType>, int64_t> edges_;
+};
+
+class CardinalityCollectorFactory final : public rocksdb::TablePropertiesCollectorFactory {
+public:
+    explicit CardinalityCollectorFactory(int32_t vIdLen) : vIdLen_(vIdLen) {}
+
+    rocksdb::TablePropertiesCollector* CreateTablePropertiesCollector(
+            rocksdb::TablePropertiesCollectorFactory::Context) override {
+        return new CardinalityCollector(vIdLen_);
+    }
+
+    const char* Name() const override {
+        return "CardinalityCollectorFactory";
+    }
+
+private:
+    int32_t vIdLen_;
+};
+
+}   // namespace kvstore
+}   // namespace nebula
+#endif   // KVSTORE_CARDINALITYCOLLECTOR_H_
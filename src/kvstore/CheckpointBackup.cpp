@@ -0,0 +1,334 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "kvstore/CheckpointBackup.h"
+#include "common/fs/FileUtils.h"
+#include <folly/hash/Checksum.h>
+#include <folly/String.h>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace nebula {
+namespace kvstore {
+
+namespace {
+constexpr size_t kCopyChunkSize = 1UL << 20;  // 1MB
+const char kBackupManifest[] = "BACKUP_MANIFEST";
+const char kDeltaManifest[] = "MANIFEST_DELTA";
+}  // anonymous namespace
+
+
+StatusOr<uint32_t> LocalDirSink::copyFile(const std::string& src, const std::string& dst) {
+    std::ifstream in(src, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        return Status::Error("Open %s for read failed", src.c_str());
+    }
+    auto dir = dst.substr(0, dst.find_last_of('/'));
+    if (!fs::FileUtils::makeDir(dir)) {
+        return Status::Error("Failed to create %s", dir.c_str());
+    }
+    std::ofstream out(dst, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        return Status::Error("Open %s for write failed", dst.c_str());
+    }
+    std::string buf(kCopyChunkSize, '\0');
+    uint32_t crc = 0;
+    while (in) {
+        in.read(&buf[0], buf.size());
+        auto bytes = in.gcount();
+        if (bytes <= 0) {
+            break;
+        }
+        if (bytesPerSec_ > 0) {
+            // Shared across all transfer threads, so the limit caps the
+            // whole backup, not each stream. Consumed in quanta no larger
+            // than a second's worth so one chunk never exceeds the burst
+            int64_t remaining = bytes;
+            while (remaining > 0) {
+                auto quantum = std::min<int64_t>(remaining, bytesPerSec_);
+                bucket_.consumeWithBorrowAndWait(quantum, bytesPerSec_, bytesPerSec_);
+                remaining -= quantum;
+            }
+        }
+        crc = folly::crc32c(reinterpret_cast<const uint8_t*>(buf.data()), bytes, crc);
+        out.write(buf.data(), bytes);
+        if (!out) {
+            return Status::Error("Write to %s failed", dst.c_str());
+        }
+    }
+    out.close();
+    return crc;
+}
+
+
+StatusOr<uint32_t> LocalDirSink::putFile(const std::string& localPath,
+                                         const std::string& relPath) {
+    return copyFile(localPath, fs::FileUtils::joinPath(root_, relPath));
+}
+
+
+StatusOr<uint32_t> LocalDirSink::getFile(const std::string& relPath,
+                                         const std::string& localPath) {
+    return copyFile(fs::FileUtils::joinPath(root_, relPath), localPath);
+}
+
+
+Status LocalDirSink::putMeta(const std::string& relPath, const std::string& contents) {
+    auto path = fs::FileUtils::joinPath(root_, relPath);
+    auto dir = path.substr(0, path.find_last_of('/'));
+    if (!fs::FileUtils::makeDir(dir)) {
+        return Status::Error("Failed to create %s", dir.c_str());
+    }
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        return Status::Error("Open %s for write failed", path.c_str());
+    }
+    out << contents;
+    return out ? Status::OK() : Status::Error("Write to %s failed", path.c_str());
+}
+
+
+StatusOr<std::string> LocalDirSink::getMeta(const std::string& relPath) {
+    auto path = fs::FileUtils::joinPath(root_, relPath);
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        return Status::Error("Open %s for read failed", path.c_str());
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+
+bool LocalDirSink::exists(const std::string& relPath) {
+    return fs::FileUtils::exist(fs::FileUtils::joinPath(root_, relPath));
+}
+
+
+StatusOr<std::vector<std::string>> CheckpointBackup::listCheckpointFiles(
+        const std::string& checkpointDir) {
+    std::vector<std::string> files;
+    auto dataDir = fs::FileUtils::joinPath(checkpointDir, "data");
+    if (!fs::FileUtils::exist(dataDir)) {
+        return Status::Error("%s has no data directory", checkpointDir.c_str());
+    }
+    for (auto& f : fs::FileUtils::listAllFilesInDir(dataDir.c_str())) {
+        files.emplace_back("data/" + f);
+    }
+    // The wal directory holds one sub-directory per part
+    auto walDir = fs::FileUtils::joinPath(checkpointDir, "wal");
+    if (fs::FileUtils::exist(walDir)) {
+        for (auto& part : fs::FileUtils::listAllDirsInDir(walDir.c_str())) {
+            auto partDir = fs::FileUtils::joinPath(walDir, part);
+            for (auto& f : fs::FileUtils::listAllFilesInDir(partDir.c_str())) {
+                files.emplace_back("wal/" + part + "/" + f);
+            }
+        }
+    }
+    return files;
+}
+
+
+StatusOr<std::pair<std::string, std::vector<std::string>>> CheckpointBackup::listDeltaFiles(
+        const std::string& checkpointDir) {
+    auto manifest = fs::FileUtils::joinPath(checkpointDir, kDeltaManifest);
+    std::ifstream in(manifest);
+    if (!in.is_open()) {
+        return Status::Error("%s has no %s, take a full backup instead",
+                             checkpointDir.c_str(), kDeltaManifest);
+    }
+    std::string base;
+    std::vector<std::string> files;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (line.find("base:") == 0) {
+            base = line.substr(strlen("base:"));
+        } else {
+            files.emplace_back(line);
+        }
+    }
+    if (base.empty()) {
+        return Status::Error("%s names no base checkpoint", manifest.c_str());
+    }
+    // The wal is hard-linked per checkpoint and tiny next to the sst
+    // files, ship it in full every time
+    auto walDir = fs::FileUtils::joinPath(checkpointDir, "wal");
+    if (fs::FileUtils::exist(walDir)) {
+        for (auto& part : fs::FileUtils::listAllDirsInDir(walDir.c_str())) {
+            auto partDir = fs::FileUtils::joinPath(walDir, part);
+            for (auto& f : fs::FileUtils::listAllFilesInDir(partDir.c_str())) {
+                files.emplace_back("wal/" + part + "/" + f);
+            }
+        }
+    }
+    return std::make_pair(base, files);
+}
+
+
+Status CheckpointBackup::transfer(const std::string& checkpointDir,
+                                  const std::string& backupName,
+                                  const std::vector<std::string>& files,
+                                  std::map<std::string, uint32_t>& checksums) {
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex lock;
+    Status error;
+    auto threadNum = std::min(static_cast<size_t>(concurrency_), files.size());
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::max(threadNum, 1UL); t++) {
+        workers.emplace_back([&] {
+            while (!failed.load(std::memory_order_relaxed)) {
+                auto i = next.fetch_add(1, std::memory_order_relaxed);
+                if (i >= files.size()) {
+                    break;
+                }
+                auto& rel = files[i];
+                auto ret = sink_->putFile(fs::FileUtils::joinPath(checkpointDir, rel),
+                                          backupName + "/" + rel);
+                std::lock_guard<std::mutex> g(lock);
+                if (!ret.ok()) {
+                    failed = true;
+                    error = ret.status();
+                    break;
+                }
+                checksums.emplace(rel, ret.value());
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (failed) {
+        return error;
+    }
+    return Status::OK();
+}
+
+
+Status CheckpointBackup::backup(const std::string& checkpointDir,
+                                const std::string& backupName,
+                                bool incremental) {
+    std::string base;
+    std::vector<std::string> files;
+    if (incremental) {
+        auto ret = listDeltaFiles(checkpointDir);
+        if (!ret.ok()) {
+            return ret.status();
+        }
+        std::tie(base, files) = std::move(ret).value();
+        if (!sink_->exists(base + "/" + kBackupManifest)) {
+            return Status::Error("Base backup %s is not in the sink", base.c_str());
+        }
+    } else {
+        auto ret = listCheckpointFiles(checkpointDir);
+        if (!ret.ok()) {
+            return ret.status();
+        }
+        files = std::move(ret).value();
+    }
+    if (sink_->exists(backupName + "/" + kBackupManifest)) {
+        return Status::Error("Backup %s already exists", backupName.c_str());
+    }
+
+    std::map<std::string, uint32_t> checksums;
+    auto status = transfer(checkpointDir, backupName, files, checksums);
+    if (!status.ok()) {
+        return status;
+    }
+
+    // Written last: a backup without its manifest is invisible to restore,
+    // so a transfer killed halfway leaves garbage but never a bad backup
+    std::stringstream manifest;
+    manifest << "base:" << base << std::endl;
+    for (auto& entry : checksums) {
+        manifest << entry.second << " " << entry.first << std::endl;
+    }
+    return sink_->putMeta(backupName + "/" + kBackupManifest, manifest.str());
+}
+
+
+Status CheckpointBackup::restore(const std::string& backupName, const std::string& targetDir) {
+    auto ret = sink_->getMeta(backupName + "/" + kBackupManifest);
+    if (!ret.ok()) {
+        return ret.status();
+    }
+    std::string base;
+    std::vector<std::pair<std::string, uint32_t>> files;
+    std::vector<std::string> lines;
+    folly::split("\n", ret.value(), lines, true);
+    for (auto& line : lines) {
+        if (line.find("base:") == 0) {
+            base = line.substr(strlen("base:"));
+            continue;
+        }
+        auto sep = line.find(' ');
+        if (sep == std::string::npos) {
+            return Status::Error("Malformed manifest line \"%s\" in %s",
+                                 line.c_str(), backupName.c_str());
+        }
+        files.emplace_back(line.substr(sep + 1),
+                           folly::to<uint32_t>(line.substr(0, sep)));
+    }
+
+    // Lay down the base chain first, then overlay this backup on top.
+    // Delta wal files overwrite the base's copy, which is exactly the
+    // rollover semantics of the engine itself
+    if (!base.empty()) {
+        auto status = restore(base, targetDir);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex lock;
+    Status error;
+    auto threadNum = std::min(static_cast<size_t>(concurrency_), files.size());
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::max(threadNum, 1UL); t++) {
+        workers.emplace_back([&] {
+            while (!failed.load(std::memory_order_relaxed)) {
+                auto i = next.fetch_add(1, std::memory_order_relaxed);
+                if (i >= files.size()) {
+                    break;
+                }
+                auto& rel = files[i].first;
+                auto crcRet = sink_->getFile(backupName + "/" + rel,
+                                             fs::FileUtils::joinPath(targetDir, rel));
+                std::lock_guard<std::mutex> g(lock);
+                if (!crcRet.ok()) {
+                    failed = true;
+                    error = crcRet.status();
+                    break;
+                }
+                if (crcRet.value() != files[i].second) {
+                    failed = true;
+                    error = Status::Error("Checksum mismatch on %s/%s: expected %u got %u",
+                                          backupName.c_str(), rel.c_str(),
+                                          files[i].second, crcRet.value());
+                    break;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (failed) {
+        return error;
+    }
+    LOG(INFO) << "Restored backup " << backupName << " (" << files.size()
+              << " files) into " << targetDir;
+    return Status::OK();
+}
+
+}  // namespace kvstore
+}  // namespace nebula
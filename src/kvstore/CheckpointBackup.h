@@ -0,0 +1,122 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef KVSTORE_CHECKPOINTBACKUP_H_
+#define KVSTORE_CHECKPOINTBACKUP_H_
+
+#include "common/base/Base.h"
+#include "common/base/Status.h"
+#include "common/base/StatusOr.h"
+#include <folly/TokenBucket.h>
+
+namespace nebula {
+namespace kvstore {
+
+/**
+ * A sink stores backup files under relative paths: a mounted NFS
+ * directory, an object store, whatever. Implementations stream in
+ * chunks, take their pace from the token bucket handed to them (shared
+ * across all transfer threads, so the bandwidth limit is global), and
+ * return the crc32c of the bytes shipped. The manager records those
+ * checksums in the backup manifest and verifies them again on restore.
+ */
+class BackupSink {
+public:
+    virtual ~BackupSink() = default;
+
+    virtual StatusOr<uint32_t> putFile(const std::string& localPath,
+                                       const std::string& relPath) = 0;
+
+    virtual StatusOr<uint32_t> getFile(const std::string& relPath,
+                                       const std::string& localPath) = 0;
+
+    // Small metadata blobs, the manifests; no rate limit applied
+    virtual Status putMeta(const std::string& relPath, const std::string& contents) = 0;
+
+    virtual StatusOr<std::string> getMeta(const std::string& relPath) = 0;
+
+    virtual bool exists(const std::string& relPath) = 0;
+};
+
+
+/**
+ * A sink backed by a local directory, which covers NFS and fuse mounts.
+ * bytesPerSec of 0 means unlimited.
+ */
+class LocalDirSink final : public BackupSink {
+public:
+    explicit LocalDirSink(std::string root, int64_t bytesPerSec = 0)
+        : root_(std::move(root))
+        , bytesPerSec_(bytesPerSec) {}
+
+    StatusOr<uint32_t> putFile(const std::string& localPath,
+                               const std::string& relPath) override;
+
+    StatusOr<uint32_t> getFile(const std::string& relPath,
+                               const std::string& localPath) override;
+
+    Status putMeta(const std::string& relPath, const std::string& contents) override;
+
+    StatusOr<std::string> getMeta(const std::string& relPath) override;
+
+    bool exists(const std::string& relPath) override;
+
+private:
+    // Chunked copy from src to dst, rate limited, returning the crc32c
+    StatusOr<uint32_t> copyFile(const std::string& src, const std::string& dst);
+
+    std::string root_;
+    int64_t bytesPerSec_;
+    folly::DynamicTokenBucket bucket_;
+};
+
+
+/**
+ * Ships one engine checkpoint (the <dataRoot>/checkpoints/<name> tree
+ * CreateCheckpointProcessor leaves behind) to a sink and back. Backups
+ * are laid out under <backupName>/ in the sink with a BACKUP_MANIFEST
+ * listing every file and its crc32c. In incremental mode only the files
+ * named by the checkpoint's MANIFEST_DELTA are shipped and the manifest
+ * records which backup it is based on; restore follows that chain, so
+ * the target directory always comes out complete.
+ */
+class CheckpointBackup final {
+public:
+    CheckpointBackup(BackupSink* sink, int32_t concurrency)
+        : sink_(sink)
+        , concurrency_(concurrency) {}
+
+    // checkpointDir holds data/ and wal/, backupName is the name in the sink
+    Status backup(const std::string& checkpointDir,
+                  const std::string& backupName,
+                  bool incremental);
+
+    // Materialize backupName into targetDir as data/ plus wal/, the layout
+    // a space directory needs for NebulaStore::init to pick the engine up.
+    // Every file is checksum-verified against the manifest
+    Status restore(const std::string& backupName, const std::string& targetDir);
+
+private:
+    // All files of the checkpoint, relative to checkpointDir
+    StatusOr<std::vector<std::string>> listCheckpointFiles(const std::string& checkpointDir);
+
+    // The files MANIFEST_DELTA names plus the wal, and the base checkpoint
+    StatusOr<std::pair<std::string, std::vector<std::string>>> listDeltaFiles(
+        const std::string& checkpointDir);
+
+    // Transfer the given files in parallel, filling relPath -> crc32c
+    Status transfer(const std::string& checkpointDir,
+                    const std::string& backupName,
+                    const std::vector<std::string>& files,
+                    std::map<std::string, uint32_t>& checksums);
+
+    BackupSink* sink_;
+    int32_t concurrency_;
+};
+
+}  // namespace kvstore
+}  // namespace nebula
+#endif  // KVSTORE_CHECKPOINTBACKUP_H_
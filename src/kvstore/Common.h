@@ -38,11 +38,32 @@ enum ResultCode {
     ERR_RESULT_FILTERED     = -18,
     ERR_INVALID_FIELD_VALUE = -19,
     ERR_INVALID_DATA        = -20,
+    ERR_OUT_OF_MEMORY       = -21,
+    ERR_WRITE_STALL         = -22,
     ERR_USER_CANCELLED      = -98,
     ERR_PARTIAL_RESULT      = -99,
     ERR_UNKNOWN             = -100,
 };
 
+// How a scan intends to consume the data, so the engine can tune its
+// read options. BULK marks long sequential scans - a whole-part scan
+// or an index rebuild - which stream with readahead and stay out of
+// the block cache instead of evicting the hot working set
+enum class ScanHint {
+    DEFAULT = 0,
+    BULK    = 1,
+};
+
+// An opaque handle pinning one consistent read version of a whole
+// space, obtained from KVStore::beginSnapshot(). Scans passing the
+// handle all observe the pinned version, however many iterators they
+// open. The version is released when the handle is destroyed
+class SpaceSnapshot {
+public:
+    virtual ~SpaceSnapshot() = default;
+};
+
+
 class KVFilter {
 public:
     KVFilter() = default;
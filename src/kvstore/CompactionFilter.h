@@ -10,6 +10,7 @@
 #include "common/base/Base.h"
 #include "common/time/WallClock.h"
 #include <rocksdb/compaction_filter.h>
+#include <rocksdb/table_properties.h>
 #include "kvstore/Common.h"
 
 namespace nebula {
@@ -89,6 +90,14 @@ public:
 
     virtual std::shared_ptr<KVCompactionFilterFactory>
     buildCfFactory(GraphSpaceID spaceId, int32_t customFilterIntervalSecs) = 0;
+
+    // The table properties collector shipped alongside the filter, if
+    // any; installed on the engines of the space at open time
+    virtual std::shared_ptr<rocksdb::TablePropertiesCollectorFactory>
+    buildTablePropsFactory(GraphSpaceID spaceId) {
+        UNUSED(spaceId);
+        return nullptr;
+    }
 };
 
 }   // namespace kvstore
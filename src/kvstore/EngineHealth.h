@@ -0,0 +1,97 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef KVSTORE_ENGINEHEALTH_H_
+#define KVSTORE_ENGINEHEALTH_H_
+
+#include "common/base/Base.h"
+
+DECLARE_int64(engine_degraded_latency_us);
+
+namespace nebula {
+namespace kvstore {
+
+enum class EngineHealth {
+    HEALTHY  = 0,
+    DEGRADED = 1,
+    FAILED   = 2,
+};
+
+/**
+ * The health of one engine (one disk), fed by the rocksdb background
+ * error callbacks and by the periodic probe reads NebulaStore runs.
+ * Transitions:
+ *   - a background error stops the engine              -> FAILED
+ *   - a probe read fails                               -> FAILED
+ *   - rocksdb recovered from the background error      -> DEGRADED
+ *   - probe latency above --engine_degraded_latency_us -> DEGRADED
+ *   - enough consecutive clean probes                  -> one state up
+ * A FAILED engine climbs back through DEGRADED, never straight to
+ * HEALTHY, so one lucky probe after a disk error does not reopen the
+ * floodgates. The probes run on one thread; the error callbacks may
+ * fire concurrently and simply overwrite the state, losing a probe
+ * transition to a concurrent error report is the right outcome anyway.
+ * */
+class HealthTracker final {
+public:
+    EngineHealth health() const {
+        return static_cast<EngineHealth>(state_.load(std::memory_order_relaxed));
+    }
+
+    void onBackgroundError() {
+        state_.store(static_cast<int32_t>(EngineHealth::FAILED),
+                     std::memory_order_relaxed);
+    }
+
+    void onErrorRecovered() {
+        state_.store(static_cast<int32_t>(EngineHealth::DEGRADED),
+                     std::memory_order_relaxed);
+    }
+
+    void onProbe(bool ok, int64_t latencyUs) {
+        if (!ok) {
+            goodProbes_ = 0;
+            state_.store(static_cast<int32_t>(EngineHealth::FAILED),
+                         std::memory_order_relaxed);
+            return;
+        }
+        auto avgUs = (probeAvgUs_ * 3 + latencyUs) / 4;
+        probeAvgUs_ = avgUs;
+        auto target = FLAGS_engine_degraded_latency_us;
+        bool slow = target > 0 && avgUs > target;
+        auto current = health();
+        if (current == EngineHealth::HEALTHY) {
+            if (slow) {
+                goodProbes_ = 0;
+                state_.store(static_cast<int32_t>(EngineHealth::DEGRADED),
+                             std::memory_order_relaxed);
+            }
+            return;
+        }
+        if (slow) {
+            goodProbes_ = 0;
+            return;
+        }
+        if (++goodProbes_ >= kGoodProbesToRecover) {
+            goodProbes_ = 0;
+            auto next = current == EngineHealth::FAILED ? EngineHealth::DEGRADED
+                                                        : EngineHealth::HEALTHY;
+            state_.store(static_cast<int32_t>(next), std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static constexpr int32_t kGoodProbesToRecover = 3;
+
+    std::atomic<int32_t>    state_{static_cast<int32_t>(EngineHealth::HEALTHY)};
+    // Only the probe thread reads and writes these two
+    int64_t                 probeAvgUs_{0};
+    int32_t                 goodProbes_{0};
+};
+
+}  // namespace kvstore
+}  // namespace nebula
+#endif  // KVSTORE_ENGINEHEALTH_H_
@@ -5,6 +5,7 @@
  */
 
 #include "common/base/Base.h"
+#include "kvstore/EngineHealth.h"
 #include "rocksdb/db.h"
 #include "rocksdb/listener.h"
 
@@ -13,6 +14,27 @@ namespace kvstore {
 
 class EventListener : public rocksdb::EventListener {
 public:
+    explicit EventListener(std::shared_ptr<HealthTracker> health = nullptr)
+        : health_(std::move(health)) {}
+
+    void OnBackgroundError(rocksdb::BackgroundErrorReason reason,
+                           rocksdb::Status* status) override {
+        LOG(ERROR) << "Rocksdb background error, reason " << static_cast<int32_t>(reason)
+                   << ", status: " << status->ToString();
+        if (health_ != nullptr) {
+            health_->onBackgroundError();
+        }
+    }
+
+    void OnErrorRecoveryCompleted(rocksdb::Status oldBgError) override {
+        LOG(WARNING) << "Rocksdb recovered from background error: "
+                     << oldBgError.ToString();
+        if (health_ != nullptr) {
+            // probes promote it the rest of the way back to healthy
+            health_->onErrorRecovered();
+        }
+    }
+
     void OnCompactionCompleted(rocksdb::DB*, const rocksdb::CompactionJobInfo& info) override {
         LOG(INFO) << "Rocksdb compact column family: " << info.cf_name
                   << " because of " << static_cast<int32_t>(info.compaction_reason)
@@ -22,6 +44,45 @@ public:
                   << ", base level is " << info.base_input_level
                   << ", output level is " << info.output_level;
     }
+
+    void OnStallConditionsChanged(const rocksdb::WriteStallInfo& info) override {
+        LOG(WARNING) << "Rocksdb write stall of column family: " << info.cf_name
+                     << " changed: " << conditionName(info.condition.prev)
+                     << " -> " << conditionName(info.condition.cur);
+        if (info.condition.cur == rocksdb::WriteStallCondition::kDelayed) {
+            stallDelayed().fetch_add(1, std::memory_order_relaxed);
+        } else if (info.condition.cur == rocksdb::WriteStallCondition::kStopped) {
+            stallStopped().fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Times writes entered the delayed respectively stopped stall
+    // condition since the process started, summed over all engines, so
+    // the web service can report them without scraping the rocksdb LOG
+    static std::atomic<int64_t>& stallDelayed() {
+        static std::atomic<int64_t> counter{0};
+        return counter;
+    }
+
+    static std::atomic<int64_t>& stallStopped() {
+        static std::atomic<int64_t> counter{0};
+        return counter;
+    }
+
+private:
+    static const char* conditionName(rocksdb::WriteStallCondition condition) {
+        switch (condition) {
+            case rocksdb::WriteStallCondition::kNormal:
+                return "normal";
+            case rocksdb::WriteStallCondition::kDelayed:
+                return "delayed";
+            case rocksdb::WriteStallCondition::kStopped:
+                return "stopped";
+        }
+        return "unknown";
+    }
+
+    std::shared_ptr<HealthTracker> health_;
 };
 
 }  // namespace kvstore
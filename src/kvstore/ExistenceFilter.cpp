@@ -0,0 +1,101 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "kvstore/ExistenceFilter.h"
+#include <folly/hash/Hash.h>
+
+namespace nebula {
+namespace kvstore {
+
+ExistenceFilter::ExistenceFilter(size_t numCounters)
+    : counters_(numCounters) {
+    for (auto& counter : counters_) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ExistenceFilter::hashes(const folly::StringPiece& key, size_t* idx) const {
+    uint64_t h1 = folly::hash::fnv64(key.data(), key.data() + key.size());
+    // Double hashing: the second hash only needs to be odd to walk the
+    // whole counter array
+    uint64_t h2 = folly::hash::twang_mix64(h1) | 1;
+    for (size_t i = 0; i < kNumHashes; i++) {
+        idx[i] = (h1 + i * h2) % counters_.size();
+    }
+}
+
+void ExistenceFilter::insert(const folly::StringPiece& key) {
+    size_t idx[kNumHashes];
+    hashes(key, idx);
+    for (size_t i = 0; i < kNumHashes; i++) {
+        auto& counter = counters_[idx[i]];
+        auto cur = counter.load(std::memory_order_relaxed);
+        while (cur < std::numeric_limits<uint8_t>::max() &&
+               !counter.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+void ExistenceFilter::remove(const folly::StringPiece& key) {
+    size_t idx[kNumHashes];
+    hashes(key, idx);
+    for (size_t i = 0; i < kNumHashes; i++) {
+        auto& counter = counters_[idx[i]];
+        auto cur = counter.load(std::memory_order_relaxed);
+        // A saturated counter has lost its exact count and stays put
+        while (cur > 0 && cur < std::numeric_limits<uint8_t>::max() &&
+               !counter.compare_exchange_weak(cur, cur - 1, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+bool ExistenceFilter::maybeExists(const folly::StringPiece& key) const {
+    size_t idx[kNumHashes];
+    hashes(key, idx);
+    for (size_t i = 0; i < kNumHashes; i++) {
+        if (counters_[idx[i]].load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string ExistenceFilter::encode(LogID committedLogId) const {
+    std::string image;
+    image.reserve(sizeof(LogID) + counters_.size());
+    image.append(reinterpret_cast<const char*>(&committedLogId), sizeof(LogID));
+    for (auto& counter : counters_) {
+        auto val = counter.load(std::memory_order_relaxed);
+        image.append(reinterpret_cast<const char*>(&val), sizeof(uint8_t));
+    }
+    return image;
+}
+
+// static
+std::unique_ptr<ExistenceFilter> ExistenceFilter::decode(const folly::StringPiece& image,
+                                                         size_t numCounters,
+                                                         LogID expectedLogId) {
+    if (image.size() != sizeof(LogID) + numCounters) {
+        LOG(WARNING) << "Existence filter image of unexpected size " << image.size();
+        return nullptr;
+    }
+    LogID logId;
+    memcpy(&logId, image.data(), sizeof(LogID));
+    if (logId != expectedLogId) {
+        LOG(WARNING) << "Existence filter image is stale: cut at log " << logId
+                     << ", part is at log " << expectedLogId;
+        return nullptr;
+    }
+    auto filter = std::make_unique<ExistenceFilter>(numCounters);
+    const auto* data = image.data() + sizeof(LogID);
+    for (size_t i = 0; i < numCounters; i++) {
+        filter->counters_[i].store(static_cast<uint8_t>(data[i]), std::memory_order_relaxed);
+    }
+    return filter;
+}
+
+}  // namespace kvstore
+}  // namespace nebula
@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef KVSTORE_EXISTENCEFILTER_H_
+#define KVSTORE_EXISTENCEFILTER_H_
+
+#include <atomic>
+
+#include "common/base/Base.h"
+#include "common/thrift/ThriftTypes.h"
+
+namespace nebula {
+namespace kvstore {
+
+// A counting Bloom filter over the version-stripped data keys of one
+// part, answering "definitely absent" for existence probes without
+// touching the engine. Counters saturate at 255 and a saturated
+// counter is never decremented again, so heavy reuse of a slot can
+// only leave false positives behind, never false negatives. Removing
+// a key that was never inserted is not supported — the commit path
+// only removes keys it has read, which keeps that invariant.
+//
+// insert/remove/maybeExists are safe to call concurrently; encode
+// snapshots the counters and expects mutation to have stopped.
+class ExistenceFilter final {
+public:
+    explicit ExistenceFilter(size_t numCounters);
+
+    void insert(const folly::StringPiece& key);
+
+    void remove(const folly::StringPiece& key);
+
+    bool maybeExists(const folly::StringPiece& key) const;
+
+    // Serialize the filter together with the log id it is current as
+    // of, producing the image decode() validates against
+    std::string encode(LogID committedLogId) const;
+
+    // Restore a filter from its checkpoint image. Returns nullptr when
+    // the image was cut for a different counter count or a different
+    // committed log id — the caller should rebuild from data instead
+    static std::unique_ptr<ExistenceFilter> decode(const folly::StringPiece& image,
+                                                   size_t numCounters,
+                                                   LogID expectedLogId);
+
+private:
+    static constexpr size_t kNumHashes = 4;
+
+    void hashes(const folly::StringPiece& key, size_t* idx) const;
+
+    std::vector<std::atomic<uint8_t>> counters_;
+};
+
+}  // namespace kvstore
+}  // namespace nebula
+#endif  // KVSTORE_EXISTENCEFILTER_H_
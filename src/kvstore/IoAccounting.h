@@ -0,0 +1,66 @@
+/* Copyright (c) 2021 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef KVSTORE_IOACCOUNTING_H_
+#define KVSTORE_IOACCOUNTING_H_
+
+#include "common/base/Base.h"
+#include <rocksdb/perf_context.h>
+#include <rocksdb/perf_level.h>
+
+namespace nebula {
+namespace kvstore {
+
+// Scoped tally of the physical block reads rocksdb does on the current
+// thread, off its thread-local perf context. The perf context counts
+// the blocks actually fetched from the sst files, i.e. the block cache
+// misses, which is what saturates the disk; cache hits and memtable
+// reads cost no I/O and are not counted. Wrap the synchronous execution
+// of one part's plan with it and read the deltas afterwards — the
+// counters are thread-local, so the scope must not outlive the thread's
+// share of the work. A disabled scope costs one branch
+class IoAccountingScope final {
+public:
+    explicit IoAccountingScope(bool enabled) {
+        if (!enabled) {
+            return;
+        }
+        active_ = true;
+        prevLevel_ = rocksdb::GetPerfLevel();
+        if (prevLevel_ < rocksdb::PerfLevel::kEnableCount) {
+            rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+        }
+        auto* ctx = rocksdb::get_perf_context();
+        baseReads_ = ctx->block_read_count;
+        baseBytes_ = ctx->block_read_byte;
+    }
+
+    ~IoAccountingScope() {
+        if (active_ && prevLevel_ < rocksdb::PerfLevel::kEnableCount) {
+            rocksdb::SetPerfLevel(prevLevel_);
+        }
+    }
+
+    // Blocks read from disk since the scope opened
+    int64_t blockReads() const {
+        return active_ ? rocksdb::get_perf_context()->block_read_count - baseReads_ : 0;
+    }
+
+    // Bytes of those blocks before decompression
+    int64_t blockReadBytes() const {
+        return active_ ? rocksdb::get_perf_context()->block_read_byte - baseBytes_ : 0;
+    }
+
+private:
+    bool                active_{false};
+    rocksdb::PerfLevel  prevLevel_{rocksdb::PerfLevel::kDisable};
+    int64_t             baseReads_{0};
+    int64_t             baseBytes_{0};
+};
+
+}  // namespace kvstore
+}  // namespace nebula
+#endif  // KVSTORE_IOACCOUNTING_H_
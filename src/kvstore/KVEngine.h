@@ -10,6 +10,7 @@
 #include "common/base/Base.h"
 #include "common/base/Status.h"
 #include "kvstore/Common.h"
+#include "kvstore/EngineHealth.h"
 #include "kvstore/KVIterator.h"
 
 namespace nebula {
@@ -21,11 +22,23 @@ public:
 
     virtual ResultCode put(folly::StringPiece key, folly::StringPiece value) = 0;
 
+    // Apply a merge operand to the key; only meaningful on engines
+    // opened with a merge operator
+    virtual ResultCode merge(folly::StringPiece key, folly::StringPiece value) {
+        UNUSED(key);
+        UNUSED(value);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
+
     virtual ResultCode remove(folly::StringPiece key) = 0;
 
     // Remove all keys in the range [start, end)
     virtual ResultCode removeRange(folly::StringPiece start,
                                    folly::StringPiece end) = 0;
+
+    // Drop every buffered op but keep the allocated buffer, so a
+    // recycled batch stays sized to the largest commit it has carried
+    virtual void clear() = 0;
 };
 
 
@@ -41,6 +54,24 @@ public:
     // Otherwise, nullptr will be returned
     virtual const char* getDataRoot() const = 0;
 
+    // The health of the disk behind the engine; engines without a
+    // health signal are always healthy
+    virtual EngineHealth health() const {
+        return EngineHealth::HEALTHY;
+    }
+
+    // Run one timed health-probe read and feed the result into the
+    // engine's health state
+    virtual void probeHealth() {}
+
+    // Persist the sampled hot-key profile feeding the block cache
+    // warmup, see CacheWarmup. A no-op when the warmup is disabled
+    virtual void saveWarmupProfile() {}
+
+    // Replay the persisted profile, faulting the hot blocks back into
+    // the block cache; meant to run on a background worker after init
+    virtual void warmupBlockCache() {}
+
     virtual std::unique_ptr<WriteBatch> startBatchWrite() = 0;
 
     virtual ResultCode commitBatchWrite(std::unique_ptr<WriteBatch> batch,
@@ -49,24 +80,45 @@ public:
     // Read a single key
     virtual ResultCode get(const std::string& key, std::string* value) = 0;
 
+    // Read the value of the first key under `keyPrefix'. With versions
+    // encoded descending in the key, that is the latest version of a
+    // versioned record: one bounded seek and one value copy, without an
+    // iterator object crossing the interface
+    virtual ResultCode getLatest(const std::string& keyPrefix,
+                                 std::string* value,
+                                 const void* snapshot = nullptr) = 0;
+
     // Read a list of keys, if key[i] does not exist, the i-th value in return value
     // would be Status::KeyNotFound
     virtual std::vector<Status> multiGet(const std::vector<std::string>& keys,
                                          std::vector<std::string>* values) = 0;
 
+    // Pin the current version of the data. Scans passing the returned
+    // engine-native handle observe this one version until it is handed
+    // back to releaseSnapshot()
+    virtual const void* beginSnapshot() = 0;
+
+    virtual void releaseSnapshot(const void* snapshot) = 0;
+
     // Get all results in range [start, end)
     virtual ResultCode range(const std::string& start,
                              const std::string& end,
-                             std::unique_ptr<KVIterator>* iter) = 0;
+                             std::unique_ptr<KVIterator>* iter,
+                             ScanHint hint = ScanHint::DEFAULT,
+                             const void* snapshot = nullptr) = 0;
 
     // Get all results with 'prefix' str as prefix.
     virtual ResultCode prefix(const std::string& prefix,
-                              std::unique_ptr<KVIterator>* iter) = 0;
+                              std::unique_ptr<KVIterator>* iter,
+                              ScanHint hint = ScanHint::DEFAULT,
+                              const void* snapshot = nullptr) = 0;
 
     // Get all results with 'prefix' str as prefix starting form 'start'
     virtual ResultCode rangeWithPrefix(const std::string& start,
                                        const std::string& prefix,
-                                       std::unique_ptr<KVIterator>* iter) = 0;
+                                       std::unique_ptr<KVIterator>* iter,
+                                       ScanHint hint = ScanHint::DEFAULT,
+                                       const void* snapshot = nullptr) = 0;
 
     // Get all results in range [start, end)
     virtual ResultCode put(std::string key, std::string value) = 0;
@@ -97,8 +149,19 @@ public:
     // Return total parts num
     virtual int32_t totalPartsNum() = 0;
 
-    // Ingest sst files
-    virtual ResultCode ingest(const std::vector<std::string>& files) = 0;
+    // Ingest sst files. With prewarm the ingested key ranges get their
+    // filter/index blocks pulled into the block cache before returning
+    virtual ResultCode ingest(const std::vector<std::string>& files,
+                              bool prewarm = false) = 0;
+
+    // Write a batch of strictly ascending, unique keys as an SST file
+    // under <dataRoot>/download/<partId>/, where ingest() picks it up.
+    // Engines without a bulk path report ERR_UNSUPPORTED
+    virtual ResultCode writeBulkSst(PartitionID partId, const std::vector<KV>& sortedData) {
+        UNUSED(partId);
+        UNUSED(sortedData);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
 
     // Set Config Option
     virtual ResultCode setOption(const std::string& configKey,
@@ -108,8 +171,67 @@ public:
     virtual ResultCode setDBOption(const std::string& configKey,
                                    const std::string& configValue) = 0;
 
+    // Read back the current value of a Config Option. Engines without
+    // option introspection report ERR_UNSUPPORTED
+    virtual ResultCode getOption(const std::string& configKey,
+                                 std::string* configValue) {
+        UNUSED(configKey);
+        UNUSED(configValue);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
+
+    // Read back the current value of a DB Config Option
+    virtual ResultCode getDBOption(const std::string& configKey,
+                                   std::string* configValue) {
+        UNUSED(configKey);
+        UNUSED(configValue);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
+
+    // Read an internal property of the engine, e.g.
+    // "rocksdb.estimate-pending-compaction-bytes". Engines without such
+    // internals report ERR_UNSUPPORTED, an unknown property name is
+    // ERR_KEY_NOT_FOUND
+    virtual ResultCode getProperty(const std::string& property,
+                                   std::string* value) {
+        UNUSED(property);
+        UNUSED(value);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
+
+    // How close the engine is to a write stall, as a percentage: 0 is
+    // an idle engine, 100 means the engine is delaying or blocking
+    // writes right now. Computed from the engine's internal metrics
+    // against its own slowdown limits; engines without such metrics
+    // always report 0
+    virtual int32_t writeStallPct() {
+        return 0;
+    }
+
+    // All ticker counters of the engine's statistics object as
+    // name -> value. ERR_KEY_NOT_FOUND when the engine runs without
+    // one, i.e. --enable_rocksdb_statistics is off
+    virtual ResultCode getStatistics(std::unordered_map<std::string, int64_t>* stats) {
+        UNUSED(stats);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
+
+    // Per-part vertex and edge counts aggregated off the sst table
+    // properties, one line each; empty on engines without the
+    // collector, i.e. --enable_cardinality_stats is off
+    virtual std::string cardinalityStatus() {
+        return "";
+    }
+
     virtual ResultCode compact() = 0;
 
+    // Adjust the write rate limit of the background I/O (flush,
+    // compaction, ingest) at runtime, in MB/s. Only effective when the
+    // engine was opened with a rate limiter
+    virtual void setRateLimit(int32_t mbps) {
+        UNUSED(mbps);
+    }
+
     virtual ResultCode flush() = 0;
 
     virtual ResultCode createCheckpoint(const std::string& name) = 0;
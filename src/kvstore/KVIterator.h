@@ -12,6 +12,59 @@
 namespace nebula {
 namespace kvstore {
 
+/**
+ * A contiguous block of key/value records copied out of an iterator in
+ * one call, so callers on hot scan paths can walk a cache-resident
+ * batch instead of paying a virtual call per record. The returned
+ * slices point into the batch arena and stay valid until the next
+ * clear() or nextBatch() refill.
+ * */
+class KVBatch final {
+public:
+    void clear() {
+        arena_.clear();
+        records_.clear();
+    }
+
+    size_t size() const {
+        return records_.size();
+    }
+
+    bool empty() const {
+        return records_.empty();
+    }
+
+    folly::StringPiece key(size_t i) const {
+        DCHECK_LT(i, records_.size());
+        const auto& r = records_[i];
+        return folly::StringPiece(arena_.data() + r.keyOff, r.keyLen);
+    }
+
+    folly::StringPiece val(size_t i) const {
+        DCHECK_LT(i, records_.size());
+        const auto& r = records_[i];
+        return folly::StringPiece(arena_.data() + r.keyOff + r.keyLen, r.valLen);
+    }
+
+    void add(folly::StringPiece key, folly::StringPiece val) {
+        records_.emplace_back(Record{arena_.size(), key.size(), val.size()});
+        arena_.append(key.data(), key.size());
+        arena_.append(val.data(), val.size());
+    }
+
+private:
+    struct Record {
+        size_t keyOff;
+        size_t keyLen;
+        size_t valLen;
+    };
+
+    // Keys and values interleaved back to back, in iteration order
+    std::string arena_;
+    std::vector<Record> records_;
+};
+
+
 class KVIterator {
 public:
     virtual ~KVIterator()  = default;
@@ -25,6 +78,78 @@ public:
     virtual folly::StringPiece key() const = 0;
 
     virtual folly::StringPiece val() const = 0;
+
+    // Fill the batch with up to n records starting at the current
+    // position and advance past them. Engine iterators override this
+    // to walk the underlying iterator without a virtual call per record
+    virtual size_t nextBatch(size_t n, KVBatch* batch) {
+        batch->clear();
+        while (batch->size() < n && valid()) {
+            batch->add(key(), val());
+            next();
+        }
+        return batch->size();
+    }
+
+    // Reposition to the first record at or after target, skipping the
+    // records in between in the engine. Returns false when the engine
+    // cannot seek; the position is then unchanged and callers should
+    // step with next() instead. On engines with a prefix extractor the
+    // target must share the extractor prefix of the current position
+    virtual bool seek(folly::StringPiece target) {
+        UNUSED(target);
+        return false;
+    }
+
+    // Advance past the next n records without copying them out, for
+    // scans which sample a range instead of reading all of it. Returns
+    // how many records were skipped, less than n when the range ends
+    virtual size_t skip(size_t n) {
+        size_t count = 0;
+        while (count < n && valid()) {
+            next();
+            ++count;
+        }
+        return count;
+    }
+};
+
+
+/**
+ * An iterator over one record the caller already holds in memory, for
+ * feeding code paths written against KVIterator without touching the
+ * engine.
+ * */
+class SingleRecordIterator final : public KVIterator {
+public:
+    SingleRecordIterator(std::string key, std::string val)
+        : key_(std::move(key))
+        , val_(std::move(val)) {}
+
+    bool valid() const override {
+        return valid_;
+    }
+
+    void next() override {
+        valid_ = false;
+    }
+
+    void prev() override {
+        valid_ = true;
+    }
+
+    folly::StringPiece key() const override {
+        return key_;
+    }
+
+    folly::StringPiece val() const override {
+        return val_;
+    }
+
+private:
+    std::string key_;
+    std::string val_;
+    bool valid_{true};
 };
 
 }  // namespace kvstore
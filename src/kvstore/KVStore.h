@@ -11,6 +11,7 @@
 #include "common/base/ErrorOr.h"
 #include "common/base/Status.h"
 #include "common/meta/SchemaManager.h"
+#include <folly/futures/Future.h>
 #include <rocksdb/merge_operator.h>
 #include <rocksdb/compaction_filter.h>
 #include "kvstore/raftex/RaftPart.h"
@@ -29,11 +30,22 @@ struct KVOptions {
     // SchemaManager instance, help the hbasestore to encode/decode data.
     std::unique_ptr<meta::SchemaManager> schemaMan_{nullptr};
 
+    // Non-owning SchemaManager the nebula store consults for per-space
+    // properties, e.g. the vid length sizing the rocksdb prefix bloom
+    // filter. When null, engines fall back to the default vid length.
+    meta::SchemaManager* spaceSchemaMan_{nullptr};
+
     // Paths for data. It would be used by rocksdb engine.
     // Be careful! We should ensure each "paths" has only one instance,
     // otherwise it would mix up the data on disk.
     std::vector<std::string> dataPaths_;
 
+    // Root path for the raft WALs. When empty, each part keeps its WAL
+    // beside the data under the owning engine's data root. Pointing it
+    // at a separate (fast) device moves only the WALs there, while the
+    // SSTs stay on the dataPaths_.
+    std::string walPath_;
+
     //  PartManager instance for kvstore.
     std::unique_ptr<PartManager> partMan_{nullptr};
 
@@ -43,6 +55,23 @@ struct KVOptions {
      * Custom CompactionFilter used in compaction.
      * */
     std::unique_ptr<CompactionFilterFactoryBuilder> cffBuilder_{nullptr};
+
+    // Invoked for every key a committed raft log mutates, right before
+    // the batch reaches the engine, on leaders and followers alike.
+    // Lets read caches layered above the store invalidate their
+    // entries. Must be cheap and thread safe
+    std::function<void(GraphSpaceID, PartitionID, const folly::StringPiece&)>
+    committedKeyFn_{nullptr};
+
+    // Invoked once per part on ingest(buildIndex=true), with the staged
+    // data ssts of the part and the staging directory they live in,
+    // before any of them moves into the engine. The storage layer
+    // writes the index ssts of the staged rows into the same directory,
+    // so they join the same ingest and no post-ingest rebuild scan is
+    // needed. Null when the store has no index layer above it
+    std::function<ResultCode(GraphSpaceID, PartitionID,
+                             const std::vector<std::string>&, const std::string&)>
+    ingestIndexBuilderFn_{nullptr};
 };
 
 
@@ -76,7 +105,49 @@ public:
     virtual ResultCode get(GraphSpaceID spaceId,
                            PartitionID  partId,
                            const std::string& key,
-                           std::string* value) = 0;
+                           std::string* value,
+                           bool canReadFromFollower = false) = 0;
+
+    // Read the value of the first key under `keyPrefix'. Versions are
+    // encoded descending in the key, so for a versioned record this is
+    // the latest version — a bounded seek and a single value copy,
+    // cheaper than a prefix() scan that materializes an iterator
+    virtual ResultCode getLatest(GraphSpaceID spaceId,
+                                 PartitionID partId,
+                                 const std::string& keyPrefix,
+                                 std::string* value,
+                                 bool canReadFromFollower = false,
+                                 const SpaceSnapshot* snapshot = nullptr) = 0;
+
+    // False only when the store can prove no record with this
+    // version-stripped data key exists in the part (see the per-part
+    // existence filter); a plain `true` just means "go read the engine"
+    virtual bool maybeExists(GraphSpaceID spaceId,
+                             PartitionID partId,
+                             const std::string& keyNoVersion) {
+        UNUSED(spaceId); UNUSED(partId); UNUSED(keyNoVersion);
+        return true;
+    }
+
+    // Read a single key without blocking the calling thread. The base
+    // implementation performs the read inline; stores may override it
+    // to run the read elsewhere, so a block-cache miss does not park
+    // the handler thread on disk I/O
+    virtual folly::Future<ErrorOr<ResultCode, std::string>>
+    asyncGet(GraphSpaceID spaceId,
+             PartitionID partId,
+             std::string key,
+             bool canReadFromFollower = false) {
+        std::string value;
+        auto code = get(spaceId, partId, key, &value, canReadFromFollower);
+        ErrorOr<ResultCode, std::string> ret;
+        if (code == ResultCode::SUCCEEDED) {
+            ret = std::move(value);
+        } else {
+            ret = code;
+        }
+        return folly::makeFuture(std::move(ret));
+    }
 
     // Read multiple keys, if error occurs a ResultCode is returned,
     // If key[i] does not exist, the i-th value in return value would be Status::KeyNotFound
@@ -84,14 +155,64 @@ public:
     multiGet(GraphSpaceID spaceId,
              PartitionID partId,
              const std::vector<std::string>& keys,
-             std::vector<std::string>* values) = 0;
+             std::vector<std::string>* values,
+             bool canReadFromFollower = false) = 0;
+
+    // The result of reading the keys of one part, with the same
+    // semantics as multiGet()
+    struct PartMultiGetResult {
+        PartitionID partId;
+        ResultCode code;
+        std::vector<Status> statuses;
+        std::vector<std::string> values;
+    };
+
+    // Read keys spanning multiple parts of the space. The returned
+    // future completes when every part has finished, and the results
+    // keep the order of keysOfPart. This base implementation reads the
+    // parts one by one; stores may override it to fan the per-part
+    // reads out in parallel
+    virtual folly::Future<std::vector<PartMultiGetResult>>
+    asyncMultiGet(GraphSpaceID spaceId,
+                  std::vector<std::pair<PartitionID, std::vector<std::string>>> keysOfPart,
+                  bool canReadFromFollower = false) {
+        std::vector<PartMultiGetResult> results;
+        results.reserve(keysOfPart.size());
+        for (auto& partKeys : keysOfPart) {
+            PartMultiGetResult result;
+            result.partId = partKeys.first;
+            auto ret = multiGet(spaceId,
+                                partKeys.first,
+                                partKeys.second,
+                                &result.values,
+                                canReadFromFollower);
+            result.code = ret.first;
+            result.statuses = std::move(ret.second);
+            results.emplace_back(std::move(result));
+        }
+        return folly::makeFuture(std::move(results));
+    }
+
+    // Pin the current version of every engine of the space, so the
+    // scans of one request all observe the same state however many
+    // tags and edges they cover. Returns nullptr when the space is
+    // unknown or the store does not pin versions; scans treat a null
+    // handle as "read the latest state". The handle must not outlive
+    // the store
+    virtual std::unique_ptr<SpaceSnapshot> beginSnapshot(GraphSpaceID spaceId) {
+        UNUSED(spaceId);
+        return nullptr;
+    }
 
     // Get all results in range [start, end)
     virtual ResultCode range(GraphSpaceID spaceId,
                              PartitionID  partId,
                              const std::string& start,
                              const std::string& end,
-                             std::unique_ptr<KVIterator>* iter) = 0;
+                             std::unique_ptr<KVIterator>* iter,
+                             bool canReadFromFollower = false,
+                             ScanHint hint = ScanHint::DEFAULT,
+                             const SpaceSnapshot* snapshot = nullptr) = 0;
 
     // Since the `range' interface will hold references to its 3rd & 4th parameter, in `iter',
     // thus the arguments must outlive `iter'.
@@ -100,33 +221,48 @@ public:
                              PartitionID  partId,
                              std::string&& start,
                              std::string&& end,
-                             std::unique_ptr<KVIterator>* iter) = delete;
+                             std::unique_ptr<KVIterator>* iter,
+                             bool canReadFromFollower = false,
+                             ScanHint hint = ScanHint::DEFAULT,
+                             const SpaceSnapshot* snapshot = nullptr) = delete;
 
     // Get all results with prefix.
     virtual ResultCode prefix(GraphSpaceID spaceId,
                               PartitionID  partId,
                               const std::string& prefix,
-                              std::unique_ptr<KVIterator>* iter) = 0;
+                              std::unique_ptr<KVIterator>* iter,
+                              bool canReadFromFollower = false,
+                              ScanHint hint = ScanHint::DEFAULT,
+                              const SpaceSnapshot* snapshot = nullptr) = 0;
 
     // To forbid to pass rvalue via the `prefix' parameter.
     virtual ResultCode prefix(GraphSpaceID spaceId,
                               PartitionID  partId,
                               std::string&& prefix,
-                              std::unique_ptr<KVIterator>* iter) = delete;
+                              std::unique_ptr<KVIterator>* iter,
+                              bool canReadFromFollower = false,
+                              ScanHint hint = ScanHint::DEFAULT,
+                              const SpaceSnapshot* snapshot = nullptr) = delete;
 
     // Get all results with prefix starting from start
     virtual ResultCode rangeWithPrefix(GraphSpaceID spaceId,
                                        PartitionID  partId,
                                        const std::string& start,
                                        const std::string& prefix,
-                                       std::unique_ptr<KVIterator>* iter) = 0;
+                                       std::unique_ptr<KVIterator>* iter,
+                                       bool canReadFromFollower = false,
+                                       ScanHint hint = ScanHint::DEFAULT,
+                                       const SpaceSnapshot* snapshot = nullptr) = 0;
 
     // To forbid to pass rvalue via the `rangeWithPrefix' parameter.
     virtual ResultCode rangeWithPrefix(GraphSpaceID spaceId,
                                        PartitionID  partId,
                                        std::string&& start,
                                        std::string&& prefix,
-                                       std::unique_ptr<KVIterator>* iter) = delete;
+                                       std::unique_ptr<KVIterator>* iter,
+                                       bool canReadFromFollower = false,
+                                       ScanHint hint = ScanHint::DEFAULT,
+                                       const SpaceSnapshot* snapshot = nullptr) = delete;
 
     virtual ResultCode sync(GraphSpaceID spaceId,
                             PartitionID partId) = 0;
@@ -136,6 +272,22 @@ public:
                                std::vector<KV> keyValues,
                                KVCallback cb) = 0;
 
+    // Append an already encoded batch (see encodeBatchValue and
+    // encodeDedupBatch) through the normal log path, without the
+    // per-part atomic op serialization
+    virtual void asyncAppendBatch(GraphSpaceID spaceId,
+                                  PartitionID partId,
+                                  std::string batch,
+                                  KVCallback cb) = 0;
+
+    // Apply a merge operand to the key. Only supported on stores whose
+    // engines were opened with a merge operator (KVOptions::mergeOp_)
+    virtual void asyncMerge(GraphSpaceID spaceId,
+                            PartitionID partId,
+                            const std::string& key,
+                            const std::string& value,
+                            KVCallback cb) = 0;
+
     // Asynchronous version of remove methods
     virtual void asyncRemove(GraphSpaceID spaceId,
                              PartitionID partId,
@@ -153,12 +305,44 @@ public:
                                   const std::string& end,
                                   KVCallback cb) = 0;
 
+    // Remove several [start, end) ranges in one write. Each range
+    // becomes a single range tombstone instead of one tombstone per
+    // key, so it is the preferred way to drop many keys at once
+    virtual void asyncMultiRemoveRange(GraphSpaceID spaceId,
+                                       PartitionID partId,
+                                       std::vector<KV> ranges,
+                                       KVCallback cb) = 0;
+
     virtual void asyncAtomicOp(GraphSpaceID spaceId,
                                PartitionID partId,
                                raftex::AtomicOp op,
                                KVCallback cb) = 0;
 
-    virtual ResultCode ingest(GraphSpaceID spaceId) = 0;
+    // Move the staged SST files of the space into the engines. With
+    // verifyChecksum every file's block checksums are verified in
+    // parallel first and a corrupt file aborts the whole ingest while
+    // the data is still invisible. With prewarm the filter/index blocks
+    // of the ingested ranges are read into the block cache before the
+    // call returns, so the first queries do not pay the faulting cost.
+    // With buildIndex the KVOptions::ingestIndexBuilderFn_ hook runs
+    // per part first, generating the index ssts of the staged rows so
+    // they move in together with the data
+    virtual ResultCode ingest(GraphSpaceID spaceId,
+                              bool verifyChecksum = false,
+                              bool prewarm = false,
+                              bool buildIndex = false) = 0;
+
+    // Stage a batch of ascending, unique keys as an SST file on this
+    // replica's engine for the part, bypassing raft. The file sits in
+    // the download directory until ingest() is issued. Callers own
+    // consistency: the same data must be staged on every replica of
+    // the part before ingesting
+    virtual ResultCode writeBulkSst(GraphSpaceID spaceId,
+                                    PartitionID partId,
+                                    const std::vector<KV>& sortedData) {
+        UNUSED(spaceId); UNUSED(partId); UNUSED(sortedData);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
 
     virtual int32_t allLeader(std::unordered_map<GraphSpaceID,
                               std::vector<PartitionID>>& leaderIds) = 0;
@@ -176,6 +360,33 @@ public:
 
     virtual ResultCode setWriteBlocking(GraphSpaceID spaceId, bool sign) = 0;
 
+    // Move one part's replica onto another engine (data path) of the
+    // same host at local copy speed, without raft replication. The
+    // bulk of the data is copied while writes keep flowing; the part
+    // is then briefly stopped, restarted on the target engine and
+    // catches its tail up through raft. Only meaningful on stores
+    // that spread parts across local engines
+    virtual ResultCode migratePart(GraphSpaceID spaceId,
+                                   PartitionID partId,
+                                   const std::string& dataPath) {
+        UNUSED(spaceId); UNUSED(partId); UNUSED(dataPath);
+        return ResultCode::ERR_UNSUPPORTED;
+    }
+
+    // Running and queued snapshot streams of the whole store, one line
+    // each; empty on stores without a snapshot scheduler
+    virtual std::string snapshotScheduleStatus() {
+        return "";
+    }
+
+    // Approximate per-part vertex and edge counts of the space, read
+    // off the sst table properties; empty unless the engines run with
+    // --enable_cardinality_stats
+    virtual std::string cardinalityStatus(GraphSpaceID spaceId) {
+        UNUSED(spaceId);
+        return "";
+    }
+
 protected:
     KVStore() = default;
 };
@@ -15,6 +15,52 @@ namespace kvstore {
 
 constexpr auto kHeadLen = sizeof(int64_t) + 1 + sizeof(uint32_t);
 
+namespace {
+
+// LEB128: seven value bits per byte, low bits first, the high bit
+// flags a continuation. Short keys and values take one length byte
+// instead of four
+size_t varintLength(uint64_t val) {
+    size_t len = 1;
+    while (val >= 0x80) {
+        val >>= 7;
+        len++;
+    }
+    return len;
+}
+
+char* encodeVarint(char* p, uint64_t val) {
+    while (val >= 0x80) {
+        *p++ = static_cast<char>(val | 0x80);
+        val >>= 7;
+    }
+    *p++ = static_cast<char>(val);
+    return p;
+}
+
+uint64_t decodeVarint(const char*& p) {
+    uint64_t val = 0;
+    int32_t shift = 0;
+    while (static_cast<uint8_t>(*p) & 0x80) {
+        val |= static_cast<uint64_t>(static_cast<uint8_t>(*p++) & 0x7F) << shift;
+        shift += 7;
+    }
+    val |= static_cast<uint64_t>(static_cast<uint8_t>(*p++)) << shift;
+    return val;
+}
+
+// The fixed log head: timestamp, then the type byte carrying the
+// format flag
+char* encodeLogHead(char* p, LogType type) {
+    int64_t ts = time::WallClock::fastNowInMilliSec();
+    ::memcpy(p, &ts, sizeof(int64_t));
+    p += sizeof(int64_t);
+    *p++ = static_cast<char>(type | kLogFormatV2);
+    return p;
+}
+
+}  // Anonymous namespace
+
 std::string encodeKV(const folly::StringPiece& key,
                      const folly::StringPiece& val) {
     uint32_t ksize = key.size();
@@ -64,59 +110,47 @@ folly::StringPiece decodeSingleValue(folly::StringPiece encoded) {
 
 
 std::string encodeMultiValues(LogType type, const std::vector<std::string>& values) {
-    size_t totalLen = 0;
+    // One size pass, then a single allocation and memcpy packing
+    size_t totalLen = sizeof(int64_t) + 1 + varintLength(values.size());
     for (auto& v : values) {
-        totalLen += (sizeof(uint32_t) + v.size());
+        totalLen += varintLength(v.size()) + v.size();
     }
 
-    std::string encoded;
-    encoded.reserve(totalLen + kHeadLen);
-
-    // Timestamp (8 bytes)
-    int64_t ts = time::WallClock::fastNowInMilliSec();
-    encoded.append(reinterpret_cast<char*>(&ts), sizeof(int64_t));
-    // Log type
-    encoded.append(reinterpret_cast<char*>(&type), 1);
-    // Number of values
-    uint32_t num = values.size();
-    encoded.append(reinterpret_cast<char*>(&num), sizeof(uint32_t));
-    // Values
+    std::string encoded(totalLen, '\0');
+    char* p = encodeLogHead(&encoded[0], type);
+    p = encodeVarint(p, values.size());
     for (auto& v : values) {
-        uint32_t len = v.size();
-        encoded.append(reinterpret_cast<char*>(&len), sizeof(uint32_t));
-        encoded.append(v.data(), len);
+        p = encodeVarint(p, v.size());
+        ::memcpy(p, v.data(), v.size());
+        p += v.size();
     }
+    DCHECK_EQ(p, encoded.data() + encoded.size());
 
     return encoded;
 }
 
 
 std::string encodeMultiValues(LogType type, const std::vector<KV>& kvs) {
-    size_t totalLen = 0;
+    // Number of total strings: #keys + #values
+    size_t num = 2 * kvs.size();
+    size_t totalLen = sizeof(int64_t) + 1 + varintLength(num);
     for (auto& kv : kvs) {
-        totalLen += (2 * sizeof(uint32_t) + kv.first.size() + kv.second.size());
+        totalLen += varintLength(kv.first.size()) + kv.first.size()
+                  + varintLength(kv.second.size()) + kv.second.size();
     }
 
-    std::string encoded;
-    encoded.reserve(totalLen + kHeadLen);
-
-    // Timestamp (8 bytes)
-    int64_t ts = time::WallClock::fastNowInMilliSec();
-    encoded.append(reinterpret_cast<char*>(&ts), sizeof(int64_t));
-    // Log type
-    encoded.append(reinterpret_cast<char*>(&type), 1);
-    // Number of total strings: #keys + #values
-    uint32_t num = 2 * kvs.size();
-    encoded.append(reinterpret_cast<char*>(&num), sizeof(uint32_t));
-    // Key/value pairs
+    std::string encoded(totalLen, '\0');
+    char* p = encodeLogHead(&encoded[0], type);
+    p = encodeVarint(p, num);
     for (auto& kv : kvs) {
-        uint32_t len = kv.first.size();
-        encoded.append(reinterpret_cast<char*>(&len), sizeof(uint32_t));
-        encoded.append(kv.first.data(), len);
-        len = kv.second.size();
-        encoded.append(reinterpret_cast<char*>(&len), sizeof(uint32_t));
-        encoded.append(kv.second.data(), len);
+        p = encodeVarint(p, kv.first.size());
+        ::memcpy(p, kv.first.data(), kv.first.size());
+        p += kv.first.size();
+        p = encodeVarint(p, kv.second.size());
+        ::memcpy(p, kv.second.data(), kv.second.size());
+        p += kv.second.size();
     }
+    DCHECK_EQ(p, encoded.data() + encoded.size());
 
     return encoded;
 }
@@ -125,41 +159,50 @@ std::string encodeMultiValues(LogType type, const std::vector<KV>& kvs) {
 std::string encodeMultiValues(LogType type,
                               folly::StringPiece v1,
                               folly::StringPiece v2) {
-    std::string encoded;
-    encoded.reserve(kHeadLen + 2 * sizeof(uint32_t) + v1.size() + v2.size());
-
-    // Timestamp (8 bytes)
-    int64_t ts = time::WallClock::fastNowInMilliSec();
-    encoded.append(reinterpret_cast<char*>(&ts), sizeof(int64_t));
-    // Log type
-    encoded.append(reinterpret_cast<char*>(&type), 1);
-    // Number of values
-    uint32_t num = 2;
-    encoded.append(reinterpret_cast<char*>(&num), sizeof(uint32_t));
-    // Values
-    uint32_t len = v1.size();
-    encoded.append(reinterpret_cast<char*>(&len), sizeof(uint32_t));
-    encoded.append(v1.begin(), len);
-    len = v2.size();
-    encoded.append(reinterpret_cast<char*>(&len), sizeof(uint32_t));
-    encoded.append(v2.begin(), len);
+    size_t totalLen = sizeof(int64_t) + 1 + 1
+                    + varintLength(v1.size()) + v1.size()
+                    + varintLength(v2.size()) + v2.size();
+
+    std::string encoded(totalLen, '\0');
+    char* p = encodeLogHead(&encoded[0], type);
+    p = encodeVarint(p, 2);
+    p = encodeVarint(p, v1.size());
+    ::memcpy(p, v1.data(), v1.size());
+    p += v1.size();
+    p = encodeVarint(p, v2.size());
+    ::memcpy(p, v2.data(), v2.size());
+    p += v2.size();
+    DCHECK_EQ(p, encoded.data() + encoded.size());
 
     return encoded;
 }
 
 
 std::vector<folly::StringPiece> decodeMultiValues(folly::StringPiece encoded) {
-    // Skip the timestamp and the first type byte
-    auto* p = encoded.begin() + sizeof(int64_t) + 1;
-    uint32_t numValues = *(reinterpret_cast<const uint32_t*>(p));
-
+    // Skip the timestamp
+    const char* p = encoded.begin() + sizeof(int64_t);
     std::vector<folly::StringPiece> values;
-    p += sizeof(uint32_t);
-    for (auto i = 0U; i < numValues; i++) {
-        uint32_t len = *(reinterpret_cast<const uint32_t*>(p));
-        DCHECK_LE(p + sizeof(uint32_t) + len, encoded.begin() + encoded.size());
-        values.emplace_back(p + sizeof(uint32_t), len);
-        p += (sizeof(uint32_t) + len);
+    if (*p++ & kLogFormatV2) {
+        auto numValues = decodeVarint(p);
+        values.reserve(numValues);
+        for (auto i = 0U; i < numValues; i++) {
+            auto len = decodeVarint(p);
+            DCHECK_LE(p + len, encoded.begin() + encoded.size());
+            values.emplace_back(p, len);
+            p += len;
+        }
+    } else {
+        // Logs written before the varint format carry fixed 4-byte
+        // lengths
+        uint32_t numValues = *(reinterpret_cast<const uint32_t*>(p));
+        p += sizeof(uint32_t);
+        values.reserve(numValues);
+        for (auto i = 0U; i < numValues; i++) {
+            uint32_t len = *(reinterpret_cast<const uint32_t*>(p));
+            DCHECK_LE(p + sizeof(uint32_t) + len, encoded.begin() + encoded.size());
+            values.emplace_back(p + sizeof(uint32_t), len);
+            p += (sizeof(uint32_t) + len);
+        }
     }
     DCHECK_EQ(p, encoded.begin() + encoded.size());
 
@@ -168,56 +211,129 @@ std::vector<folly::StringPiece> decodeMultiValues(folly::StringPiece encoded) {
 
 std::string
 encodeBatchValue(const std::vector<std::tuple<BatchLogType, std::string, std::string>>& batch) {
-    auto type = LogType::OP_BATCH_WRITE;
-    std::string encoded;
-    encoded.reserve(1024);
+    size_t totalLen = sizeof(int64_t) + 1 + varintLength(batch.size());
+    for (auto& op : batch) {
+        auto& key = std::get<1>(op);
+        auto& val = std::get<2>(op);
+        totalLen += 1 + varintLength(key.size()) + key.size()
+                  + varintLength(val.size()) + val.size();
+    }
 
-    // Timestamp (8 bytes)
-    int64_t ts = time::WallClock::fastNowInMilliSec();
-    encoded.append(reinterpret_cast<char*>(&ts), sizeof(int64_t));
-    // Log type
-    encoded.append(reinterpret_cast<char*>(&type), 1);
-    // Number of values
-    auto num = static_cast<uint32_t>(batch.size());
-    encoded.append(reinterpret_cast<char*>(&num), sizeof(uint32_t));
-    // Values
+    std::string encoded(totalLen, '\0');
+    char* p = encodeLogHead(&encoded[0], LogType::OP_BATCH_WRITE);
+    p = encodeVarint(p, batch.size());
     for (auto& op : batch) {
-        auto opType = std::get<0>(op);
-        auto key = std::get<1>(op);
-        auto val = std::get<2>(op);
-        auto keySize = key.size();
-        auto valSize = val.size();
-        encoded.append(reinterpret_cast<char*>(&opType), 1)
-               .append(reinterpret_cast<char*>(&keySize), sizeof(uint32_t))
-               .append(key.data(), keySize)
-               .append(reinterpret_cast<char*>(&valSize), sizeof(uint32_t))
-               .append(val.data(), valSize);
+        auto& key = std::get<1>(op);
+        auto& val = std::get<2>(op);
+        *p++ = std::get<0>(op);
+        p = encodeVarint(p, key.size());
+        ::memcpy(p, key.data(), key.size());
+        p += key.size();
+        p = encodeVarint(p, val.size());
+        ::memcpy(p, val.data(), val.size());
+        p += val.size();
     }
+    DCHECK_EQ(p, encoded.data() + encoded.size());
 
     return encoded;
 }
 
 std::vector<std::pair<BatchLogType, std::pair<folly::StringPiece, folly::StringPiece>>>
 decodeBatchValue(folly::StringPiece encoded) {
-    // Skip the timestamp and the first type byte
-    auto* p = encoded.begin() + sizeof(int64_t) + 1;
-    uint32_t numValues = *(reinterpret_cast<const uint32_t*>(p));
-    p += sizeof(uint32_t);
+    // Skip the timestamp
+    const char* p = encoded.begin() + sizeof(int64_t);
     std::vector<std::pair<BatchLogType, std::pair<folly::StringPiece, folly::StringPiece>>> batch;
+    if (*p++ & kLogFormatV2) {
+        auto numValues = decodeVarint(p);
+        batch.reserve(numValues);
+        for (auto i = 0U; i < numValues; i++) {
+            BatchLogType type = static_cast<BatchLogType>(*p++);
+            auto len1 = decodeVarint(p);
+            auto* key = p;
+            p += len1;
+            auto len2 = decodeVarint(p);
+            batch.emplace_back(type, std::pair<folly::StringPiece, folly::StringPiece>
+                    (folly::StringPiece(key, len1),
+                     folly::StringPiece(p, len2)));
+            p += len2;
+        }
+    } else {
+        uint32_t numValues = *(reinterpret_cast<const uint32_t*>(p));
+        p += sizeof(uint32_t);
+        batch.reserve(numValues);
+        for (auto i = 0U; i < numValues; i++) {
+            auto offset = 0;
+            BatchLogType type = *(reinterpret_cast<const BatchLogType *>(p));
+            p += sizeof(LogType);
+            uint32_t len1 = *(reinterpret_cast<const uint32_t*>(p));
+            offset += sizeof(uint32_t) + len1;
+            uint32_t len2 = *(reinterpret_cast<const uint32_t*>(p + offset));
+            offset += sizeof(uint32_t);
+            batch.emplace_back(type, std::pair<folly::StringPiece, folly::StringPiece>
+                    (folly::StringPiece(p + sizeof(uint32_t), len1),
+                     folly::StringPiece(p + offset, len2)));
+            p += offset + len2;
+        }
+    }
+    return batch;
+}
+
+std::string
+encodeDedupBatch(uint64_t dedupId,
+                 const std::vector<std::tuple<BatchLogType, std::string, std::string>>& batch) {
+    size_t totalLen = sizeof(int64_t) + 1 + sizeof(uint64_t) + varintLength(batch.size());
+    for (auto& op : batch) {
+        auto& key = std::get<1>(op);
+        auto& val = std::get<2>(op);
+        totalLen += 1 + varintLength(key.size()) + key.size()
+                  + varintLength(val.size()) + val.size();
+    }
+
+    std::string encoded(totalLen, '\0');
+    char* p = encodeLogHead(&encoded[0], LogType::OP_DEDUP_BATCH);
+    ::memcpy(p, &dedupId, sizeof(uint64_t));
+    p += sizeof(uint64_t);
+    p = encodeVarint(p, batch.size());
+    for (auto& op : batch) {
+        auto& key = std::get<1>(op);
+        auto& val = std::get<2>(op);
+        *p++ = std::get<0>(op);
+        p = encodeVarint(p, key.size());
+        ::memcpy(p, key.data(), key.size());
+        p += key.size();
+        p = encodeVarint(p, val.size());
+        ::memcpy(p, val.data(), val.size());
+        p += val.size();
+    }
+    DCHECK_EQ(p, encoded.data() + encoded.size());
+
+    return encoded;
+}
+
+std::pair<uint64_t,
+          std::vector<std::pair<BatchLogType, std::pair<folly::StringPiece, folly::StringPiece>>>>
+decodeDedupBatch(folly::StringPiece encoded) {
+    // Skip the timestamp and the type byte; the op postdates the
+    // varint format, so there is no fixed-length layout to branch on
+    const char* p = encoded.begin() + sizeof(int64_t) + 1;
+    uint64_t dedupId;
+    ::memcpy(&dedupId, p, sizeof(uint64_t));
+    p += sizeof(uint64_t);
+    auto numValues = decodeVarint(p);
+    std::vector<std::pair<BatchLogType, std::pair<folly::StringPiece, folly::StringPiece>>> batch;
+    batch.reserve(numValues);
     for (auto i = 0U; i < numValues; i++) {
-        auto offset = 0;
-        BatchLogType type = *(reinterpret_cast<const BatchLogType *>(p));
-        p += sizeof(LogType);
-        uint32_t len1 = *(reinterpret_cast<const uint32_t*>(p));
-        offset += sizeof(uint32_t) + len1;
-        uint32_t len2 = *(reinterpret_cast<const uint32_t*>(p + offset));
-        offset += sizeof(uint32_t);
+        BatchLogType type = static_cast<BatchLogType>(*p++);
+        auto len1 = decodeVarint(p);
+        auto* key = p;
+        p += len1;
+        auto len2 = decodeVarint(p);
         batch.emplace_back(type, std::pair<folly::StringPiece, folly::StringPiece>
-                (folly::StringPiece(p + sizeof(uint32_t), len1),
-                 folly::StringPiece(p + offset, len2)));
-        p += offset + len2;
+                (folly::StringPiece(key, len1),
+                 folly::StringPiece(p, len2)));
+        p += len2;
     }
-    return batch;
+    return std::make_pair(dedupId, std::move(batch));
 }
 
 std::string encodeHost(LogType type, const HostAddr& host) {
@@ -23,12 +23,25 @@ enum LogType : char {
     OP_ADD_PEER       = 0x09,
     OP_REMOVE_PEER    = 0x10,
     OP_BATCH_WRITE    = 0x11,
+    OP_MERGE          = 0x12,
+    OP_DEDUP_BATCH    = 0x13,
 };
 
+// Set on the type byte of logs whose string lengths are
+// varint-encoded. Logs written before the varint format carry a zero
+// bit here, so both formats stay decodable
+constexpr char kLogFormatV2 = 0x40;
+
+// The log type with the format flag stripped
+inline LogType logType(const folly::StringPiece& log) {
+    return static_cast<LogType>(log[sizeof(int64_t)] & ~kLogFormatV2);
+}
+
 enum BatchLogType : char {
     OP_BATCH_PUT            = 0x1,
     OP_BATCH_REMOVE         = 0x2,
     OP_BATCH_REMOVE_RANGE   = 0x3,
+    OP_BATCH_MERGE          = 0x4,
 };
 
 std::string encodeKV(const folly::StringPiece& key,
@@ -52,6 +65,17 @@ encodeBatchValue(const std::vector<std::tuple<BatchLogType, std::string, std::st
 std::vector<std::pair<BatchLogType, std::pair<folly::StringPiece, folly::StringPiece>>>
 decodeBatchValue(folly::StringPiece encoded);
 
+// A batch write prefixed with a 64-bit dedup id. Each part remembers
+// the ids it recently committed (see --mutate_dedup_window) and a
+// batch whose id repeats is acked without being re-applied
+std::string
+encodeDedupBatch(uint64_t dedupId,
+                 const std::vector<std::tuple<BatchLogType, std::string, std::string>>& batch);
+
+std::pair<uint64_t,
+          std::vector<std::pair<BatchLogType, std::pair<folly::StringPiece, folly::StringPiece>>>>
+decodeDedupBatch(folly::StringPiece encoded);
+
 std::string encodeHost(LogType type, const HostAddr& learner);
 HostAddr decodeHost(LogType type, const folly::StringPiece& encoded);
 
@@ -84,6 +108,14 @@ public:
         batch_.emplace_back(std::move(op));
     }
 
+    // Only meaningful on engines opened with a merge operator
+    void merge(std::string&& key, std::string&& operand) {
+        auto op = std::make_tuple(BatchLogType::OP_BATCH_MERGE,
+                                  std::forward<std::string>(key),
+                                  std::forward<std::string>(operand));
+        batch_.emplace_back(std::move(op));
+    }
+
     void clear() {
         batch_.clear();
     }
@@ -9,22 +9,105 @@
 #include "common/network/NetworkUtils.h"
 #include "kvstore/NebulaStore.h"
 #include <folly/Likely.h>
+#include <folly/Random.h>
 #include <algorithm>
 #include <cstdint>
 #include "kvstore/RocksEngine.h"
 #include "kvstore/SnapshotManagerImpl.h"
+#include <rocksdb/sst_file_reader.h>
+#include "utils/NebulaKeyUtils.h"
+
+DECLARE_bool(block_cache_warmup);
+DECLARE_int32(block_cache_warmup_interval_secs);
+DECLARE_int32(raft_rpc_timeout_ms);
 
 DEFINE_string(engine_type, "rocksdb", "rocksdb, memory...");
 DEFINE_int32(custom_filter_interval_secs, 24 * 3600, "interval to trigger custom compaction");
 DEFINE_int32(num_workers, 4, "Number of worker threads");
 DEFINE_bool(check_leader, true, "Check leader or not");
+DEFINE_uint32(engine_job_concurrency, 0,
+              "How many engines of one space an ingest or compact job works on "
+              "in parallel. Each engine sits on its own disk, so this caps the "
+              "number of busy disks. 0 means all engines at once");
+DEFINE_uint32(load_part_concurrency, 4,
+              "How many parts of one engine are opened at a time on start. "
+              "Opening a part replays its wal, so this caps the recovery "
+              "I/O per disk while every disk loads in parallel. 0 opens "
+              "all parts of an engine at once");
+DEFINE_bool(option_update_dry_run, false,
+            "Only log what a config update delivered from meta would change on "
+            "each engine, old value and new, without applying anything");
+DEFINE_uint32(ingest_verify_concurrency, 4,
+              "How many sst files an ingest verifies in parallel when the "
+              "checksum check is requested. Verification is pure read I/O "
+              "against the staging dirs, so it may run wider than the "
+              "per-disk ingest itself");
+DEFINE_bool(rebalance_engine_parts, false,
+            "Even out the number of parts across the data paths of each space "
+            "on start. A moved part is copied locally between the engines, no "
+            "raft replication is involved");
+DEFINE_int32(apply_flush_interval_secs, 0,
+             "Seconds between timed memtable flushes of every engine. With "
+             "--rocksdb_disable_wal a part's recoverable commit point is its "
+             "last flush, and restart replays the raft wal from there; the "
+             "timed flush bounds that tail to one interval of writes. 0 "
+             "leaves the flushes to rocksdb's own memtable limits");
+DEFINE_int32(engine_health_probe_interval_secs, 0,
+             "Seconds between the timed probe reads feeding each engine's "
+             "health state. 0 disables the probes, leaving only the rocksdb "
+             "background-error callbacks to drive it");
+DEFINE_int64(engine_degraded_latency_us, 0,
+             "Moving average probe-read latency in microseconds above which "
+             "an engine counts as degraded. 0 means latency never degrades "
+             "an engine");
+DEFINE_int32(engine_degraded_shed_pct, 50,
+             "Percentage of the requests to parts on a degraded engine that "
+             "are rejected outright instead of queueing on the sick disk");
+DEFINE_int32(write_stall_reject_pct, 0,
+             "Stall proximity percentage (see KVEngine::writeStallPct) at or "
+             "above which writes to parts on the engine are rejected with "
+             "ERR_WRITE_STALL instead of accepted, so clients back off "
+             "before rocksdb blocks the write threads and everything times "
+             "out at once. 0 disables the rejection");
+DEFINE_int32(raft_client_warmup_interval_secs, 0,
+             "Seconds between the rounds that pre-connect the raft client of "
+             "every io eventbase to every remote peer we share a part with. "
+             "The first round runs on start, so the first replication RPC "
+             "after an election does not pay connection setup on top of the "
+             "already elevated latency; the later rounds replace clients "
+             "whose channel has gone bad and reach peers added by rebalance. "
+             "0 leaves the connections to be opened lazily on first use");
 
 namespace nebula {
 namespace kvstore {
 
 NebulaStore::~NebulaStore() {
+    if (partLoadThread_.joinable()) {
+        LOG(INFO) << "Waiting for the disk load to finish...";
+        partLoadThread_.join();
+    }
     LOG(INFO) << "Cut off the relationship with meta client";
     options_.partMan_.reset();
+    if (healthThread_) {
+        healthThread_->stop();
+        healthThread_->wait();
+        healthThread_.reset();
+    }
+    if (flushThread_) {
+        flushThread_->stop();
+        flushThread_->wait();
+        flushThread_.reset();
+    }
+    if (warmupThread_) {
+        warmupThread_->stop();
+        warmupThread_->wait();
+        warmupThread_.reset();
+    }
+    if (raftClientThread_) {
+        raftClientThread_->stop();
+        raftClientThread_->wait();
+        raftClientThread_.reset();
+    }
     LOG(INFO) << "Stop the raft service...";
     raftService_->stop();
     LOG(INFO) << "Waiting for the raft service stop...";
@@ -50,127 +133,116 @@ bool NebulaStore::init() {
 
     CHECK(!!options_.partMan_);
     LOG(INFO) << "Scan the local path, and init the spaces_";
+    // Engines of every space with the parts each one holds. The parts are
+    // opened only after all data paths have been scanned, so the parts of
+    // one space can first be rebalanced across its engines
+    SpaceEngineParts spaceEngines;
     {
+        // One thread per data path: each path is its own disk and the
+        // scan is dominated by the rocksdb open and recovery of the
+        // engines under it, so the disks recover in parallel
+        std::mutex enginesLock;
+        std::atomic<bool> scanFailed{false};
+        std::vector<std::thread> scanThreads;
         for (auto& path : options_.dataPaths_) {
-            auto rootPath = folly::stringPrintf("%s/nebula", path.c_str());
-            auto dirs = fs::FileUtils::listAllDirsInDir(rootPath.c_str());
-            for (auto& dir : dirs) {
-                LOG(INFO) << "Scan path \"" << path << "/" << dir << "\"";
-                try {
-                    GraphSpaceID spaceId;
-                    try {
-                        spaceId = folly::to<GraphSpaceID>(dir);
-                    } catch (const std::exception& ex) {
-                        LOG(ERROR) << "Data path invalid: " << ex.what();
-                        return false;
-                    }
-
-                    if (!options_.partMan_->spaceExist(storeSvcAddr_, spaceId).ok()) {
-                        // TODO We might want to have a second thought here.
-                        // Removing the data directly feels a little strong
-                        LOG(INFO) << "Space " << spaceId
-                                  << " does not exist any more, remove the data!";
-                        auto dataPath = folly::stringPrintf("%s/%s",
-                                                            rootPath.c_str(),
-                                                            dir.c_str());
-                        CHECK(fs::FileUtils::remove(dataPath.c_str(), true));
-                        continue;
-                    }
+            scanThreads.emplace_back([this, path, &spaceEngines, &enginesLock, &scanFailed] {
+                if (!scanDataPath(path, spaceEngines, enginesLock)) {
+                    scanFailed = true;
+                }
+            });
+        }
+        for (auto& t : scanThreads) {
+            t.join();
+        }
+        if (scanFailed) {
+            return false;
+        }
 
-                    KVEngine* enginePtr = nullptr;
-                    {
-                        folly::RWSpinLock::WriteHolder wh(&lock_);
-                        auto engine = newEngine(spaceId, path);
-                        auto spaceIt = this->spaces_.find(spaceId);
-                        if (spaceIt == this->spaces_.end()) {
-                            LOG(INFO) << "Load space " << spaceId << " from disk";
-                            spaceIt = this->spaces_.emplace(
-                                spaceId,
-                                std::make_unique<SpacePartInfo>()).first;
-                        }
-                        spaceIt->second->engines_.emplace_back(std::move(engine));
-                        enginePtr = spaceIt->second->engines_.back().get();
-                    }
+        // The scan threads append engines in completion order; restore
+        // the data path order so every engine keeps its position across
+        // restarts
+        auto pathIndex = [this] (const std::string& root) -> size_t {
+            for (size_t i = 0; i < options_.dataPaths_.size(); i++) {
+                if (root.find(options_.dataPaths_[i] + "/") == 0) {
+                    return i;
+                }
+            }
+            return options_.dataPaths_.size();
+        };
+        folly::RWSpinLock::WriteHolder wh(&lock_);
+        for (auto& spaceEntry : spaces_) {
+            std::sort(spaceEntry.second->engines_.begin(),
+                      spaceEntry.second->engines_.end(),
+                      [&pathIndex] (const auto& lhs, const auto& rhs) {
+                          return pathIndex(lhs->getDataRoot()) <
+                                 pathIndex(rhs->getDataRoot());
+                      });
+        }
+    }
 
-                    // partIds is the partition in this host waiting to open
-                    std::vector<PartitionID> partIds;
-                    for (auto& partId : enginePtr->allParts()) {
-                        if (!options_.partMan_->partExist(storeSvcAddr_, spaceId, partId).ok()) {
-                            LOG(INFO) << "Part " << partId
-                                      << " does not exist any more, remove it!";
-                            enginePtr->removePart(partId);
-                            continue;
-                        } else {
-                             auto it = std::find(partIds.begin(), partIds.end(), partId);
-                             if (it != partIds.end()) {
-                                LOG(INFO) << "Part " << partId
-                                          << " has been loaded, skip current one, remove it!";
-                                enginePtr->removePart(partId);
-                             } else {
-                                partIds.emplace_back(partId);
-                             }
-                        }
-                    }
-                    if (partIds.empty()) {
-                        continue;
-                    }
+    if (FLAGS_rebalance_engine_parts) {
+        for (auto& spaceEntry : spaceEngines) {
+            equalizeSpaceEngines(spaceEntry.first, spaceEntry.second);
+        }
+    }
 
-                    std::atomic<size_t> counter(partIds.size());
-                    folly::Baton<true, std::atomic> baton;
-                    LOG(INFO) << "Need to open " << partIds.size() << " parts of space " << spaceId;
-                    for (auto& partId : partIds) {
-                        bgWorkers_->addTask([
-                                spaceId, partId, enginePtr, &counter, &baton, this] () mutable {
-                            auto part = std::make_shared<Part>(spaceId,
-                                                               partId,
-                                                               raftAddr_,
-                                                               folly::stringPrintf("%s/wal/%d",
-                                                                       enginePtr->getDataRoot(),
-                                                                       partId),
-                                                               enginePtr,
-                                                               ioPool_,
-                                                               bgWorkers_,
-                                                               workers_,
-                                                               snapshot_,
-                                                               clientMan_);
-                            auto status = options_.partMan_->partMeta(spaceId, partId);
-                            if (!status.ok()) {
-                                LOG(WARNING) << status.status().toString();
-                                return;
-                            }
-                            auto partMeta = status.value();
-                            std::vector<HostAddr> peers;
-                            for (auto& h : partMeta.hosts_) {
-                                if (h != storeSvcAddr_) {
-                                    peers.emplace_back(getRaftAddr(h));
-                                    VLOG(1) << "Add peer " << peers.back();
-                                }
-                            }
-                            raftService_->addPartition(part);
-                            part->start(std::move(peers), false);
-                            LOG(INFO) << "Load part " << spaceId << ", " << partId << " from disk";
-
-                            {
-                                folly::RWSpinLock::WriteHolder holder(&lock_);
-                                auto iter = spaces_.find(spaceId);
-                                CHECK(iter != spaces_.end());
-                                iter->second->parts_.emplace(partId, part);
-                            }
-                            counter.fetch_sub(1);
-                            if (counter.load() == 0) {
-                                baton.post();
-                            }
-                        });
-                    }
-                    baton.wait();
-                    LOG(INFO) << "Load space " << spaceId << " complete";
-                } catch (std::exception& e) {
-                    LOG(FATAL) << "Invalid data directory \"" << dir << "\"";
+    // Mark every part that will come up before any of them opens, so the
+    // meta reconciliation below does not rebuild a part that is still
+    // replaying its wal
+    std::vector<std::tuple<GraphSpaceID, KVEngine*, std::vector<PartitionID>>> loads;
+    {
+        folly::RWSpinLock::WriteHolder wh(&lock_);
+        for (auto& spaceEntry : spaceEngines) {
+            for (auto& engineEntry : spaceEntry.second) {
+                if (engineEntry.second.empty()) {
+                    continue;
                 }
+                for (auto partId : engineEntry.second) {
+                    loadingParts_[spaceEntry.first].emplace(partId);
+                }
+                loads.emplace_back(spaceEntry.first,
+                                   engineEntry.first,
+                                   std::move(engineEntry.second));
             }
         }
+        // The spaces join the part table right away; each part follows
+        // the moment its own recovery finishes
+        publishPartTable();
     }
 
+    // Every disk loads its parts in parallel, at most
+    // FLAGS_load_part_concurrency of them at a time each. init() does
+    // not wait: a recovered part starts serving as soon as it is
+    // published, instead of the whole host gating on the slowest disk
+    partLoadThread_ = std::thread([this, loads = std::move(loads)] () mutable {
+        std::vector<std::thread> loaders;
+        for (auto& load : loads) {
+            auto spaceId = std::get<0>(load);
+            auto* engine = std::get<1>(load);
+            auto& partIds = std::get<2>(load);
+            LOG(INFO) << "Need to open " << partIds.size() << " parts of space "
+                      << spaceId << " on " << engine->getDataRoot();
+            auto concurrency = partIds.size();
+            if (FLAGS_load_part_concurrency != 0) {
+                concurrency = std::min(concurrency,
+                                       static_cast<size_t>(FLAGS_load_part_concurrency));
+            }
+            auto next = std::make_shared<std::atomic<size_t>>(0);
+            for (size_t i = 0; i < concurrency; i++) {
+                loaders.emplace_back([this, spaceId, engine, &partIds, next] {
+                    size_t idx;
+                    while ((idx = next->fetch_add(1)) < partIds.size()) {
+                        loadPartFromDisk(spaceId, partIds[idx], engine);
+                    }
+                });
+            }
+        }
+        for (auto& t : loaders) {
+            t.join();
+        }
+        LOG(INFO) << "Load the parts of all spaces from disk complete";
+    });
+
     LOG(INFO) << "Init data from partManager for " << storeSvcAddr_;
     auto partsMap = options_.partMan_->parts(storeSvcAddr_);
     for (auto& entry : partsMap) {
@@ -188,6 +260,128 @@ bool NebulaStore::init() {
 
     LOG(INFO) << "Register handler...";
     options_.partMan_->registerHandler(this);
+
+    if (FLAGS_engine_health_probe_interval_secs > 0) {
+        healthThread_ = std::make_unique<thread::GenericWorker>();
+        CHECK(healthThread_->start());
+        healthThread_->addRepeatTask(FLAGS_engine_health_probe_interval_secs * 1000,
+                                     &NebulaStore::probeEngineHealth, this);
+    }
+
+    if (FLAGS_apply_flush_interval_secs > 0) {
+        flushThread_ = std::make_unique<thread::GenericWorker>();
+        CHECK(flushThread_->start());
+        flushThread_->addRepeatTask(FLAGS_apply_flush_interval_secs * 1000,
+                                    &NebulaStore::flushApplyState, this);
+    }
+
+    if (FLAGS_block_cache_warmup) {
+        // Re-read the persisted hot sets in the background while the
+        // service is already up, and keep the profiles fresh for the
+        // next restart
+        {
+            folly::RWSpinLock::ReadHolder rh(&lock_);
+            for (auto& spaceEntry : spaces_) {
+                // The space handle keeps the engines alive should the
+                // space go away while the warmup still runs
+                auto space = spaceEntry.second;
+                for (size_t i = 0; i < space->engines_.size(); i++) {
+                    bgWorkers_->addTask([space, i] {
+                        space->engines_[i]->warmupBlockCache();
+                    });
+                }
+            }
+        }
+        warmupThread_ = std::make_unique<thread::GenericWorker>();
+        CHECK(warmupThread_->start());
+        warmupThread_->addRepeatTask(FLAGS_block_cache_warmup_interval_secs * 1000,
+                                     &NebulaStore::saveWarmupProfiles, this);
+    }
+
+    if (FLAGS_raft_client_warmup_interval_secs > 0) {
+        warmupRaftClients();
+        raftClientThread_ = std::make_unique<thread::GenericWorker>();
+        CHECK(raftClientThread_->start());
+        raftClientThread_->addRepeatTask(FLAGS_raft_client_warmup_interval_secs * 1000,
+                                         &NebulaStore::warmupRaftClients, this);
+    }
+    return true;
+}
+
+
+bool NebulaStore::scanDataPath(const std::string& path,
+                               SpaceEngineParts& spaceEngines,
+                               std::mutex& enginesLock) {
+    auto rootPath = folly::stringPrintf("%s/nebula", path.c_str());
+    auto dirs = fs::FileUtils::listAllDirsInDir(rootPath.c_str());
+    for (auto& dir : dirs) {
+        LOG(INFO) << "Scan path \"" << path << "/" << dir << "\"";
+        try {
+            GraphSpaceID spaceId;
+            try {
+                spaceId = folly::to<GraphSpaceID>(dir);
+            } catch (const std::exception& ex) {
+                LOG(ERROR) << "Data path invalid: " << ex.what();
+                return false;
+            }
+
+            if (!options_.partMan_->spaceExist(storeSvcAddr_, spaceId).ok()) {
+                // TODO We might want to have a second thought here.
+                // Removing the data directly feels a little strong
+                LOG(INFO) << "Space " << spaceId
+                          << " does not exist any more, remove the data!";
+                auto dataPath = folly::stringPrintf("%s/%s",
+                                                    rootPath.c_str(),
+                                                    dir.c_str());
+                CHECK(fs::FileUtils::remove(dataPath.c_str(), true));
+                continue;
+            }
+
+            // The open with its recovery is the slow part, keep it
+            // outside lock_ so the other disks do not spin on it
+            auto engine = newEngine(spaceId, path);
+            KVEngine* enginePtr = engine.get();
+            {
+                folly::RWSpinLock::WriteHolder wh(&lock_);
+                auto spaceIt = this->spaces_.find(spaceId);
+                if (spaceIt == this->spaces_.end()) {
+                    LOG(INFO) << "Load space " << spaceId << " from disk";
+                    spaceIt = this->spaces_.emplace(
+                        spaceId,
+                        std::make_unique<SpacePartInfo>()).first;
+                }
+                spaceIt->second->engines_.emplace_back(std::move(engine));
+            }
+
+            // partIds is the partition in this host waiting to open
+            std::vector<PartitionID> partIds;
+            for (auto& partId : enginePtr->allParts()) {
+                if (!options_.partMan_->partExist(storeSvcAddr_, spaceId, partId).ok()) {
+                    LOG(INFO) << "Part " << partId
+                              << " does not exist any more, remove it!";
+                    enginePtr->removePart(partId);
+                    continue;
+                } else {
+                     auto it = std::find(partIds.begin(), partIds.end(), partId);
+                     if (it != partIds.end()) {
+                        LOG(INFO) << "Part " << partId
+                                  << " has been loaded, skip current one, remove it!";
+                        enginePtr->removePart(partId);
+                     } else {
+                        partIds.emplace_back(partId);
+                     }
+                }
+            }
+            // Keep the engine even when it holds no part yet, an
+            // empty data path is the main rebalance target
+            {
+                std::lock_guard<std::mutex> g(enginesLock);
+                spaceEngines[spaceId].emplace_back(enginePtr, std::move(partIds));
+            }
+        } catch (std::exception& e) {
+            LOG(FATAL) << "Invalid data directory \"" << dir << "\"";
+        }
+    }
     return true;
 }
 
@@ -196,14 +390,25 @@ std::unique_ptr<KVEngine> NebulaStore::newEngine(GraphSpaceID spaceId,
                                                  const std::string& path) {
     if (FLAGS_engine_type == "rocksdb") {
         std::shared_ptr<KVCompactionFilterFactory> cfFactory = nullptr;
+        std::shared_ptr<rocksdb::TablePropertiesCollectorFactory> tpcFactory = nullptr;
         if (options_.cffBuilder_ != nullptr) {
             cfFactory = options_.cffBuilder_->buildCfFactory(spaceId,
                                                              FLAGS_custom_filter_interval_secs);
+            tpcFactory = options_.cffBuilder_->buildTablePropsFactory(spaceId);
+        }
+        int32_t vIdLen = sizeof(int64_t);
+        if (options_.spaceSchemaMan_ != nullptr) {
+            auto len = options_.spaceSchemaMan_->getSpaceVidLen(spaceId);
+            if (len.ok()) {
+                vIdLen = len.value();
+            }
         }
         return std::make_unique<RocksEngine>(spaceId,
                                              path,
                                              options_.mergeOp_,
-                                             cfFactory);
+                                             cfFactory,
+                                             tpcFactory,
+                                             vIdLen);
     } else {
         LOG(FATAL) << "Unknown engine type " << FLAGS_engine_type;
         return nullptr;
@@ -211,17 +416,25 @@ std::unique_ptr<KVEngine> NebulaStore::newEngine(GraphSpaceID spaceId,
 }
 
 ErrorOr<ResultCode, HostAddr> NebulaStore::partLeader(GraphSpaceID spaceId, PartitionID partId) {
-    folly::RWSpinLock::ReadHolder rh(&lock_);
-    auto it = spaces_.find(spaceId);
-    if (UNLIKELY(it == spaces_.end())) {
-        return ResultCode::ERR_SPACE_NOT_FOUND;
+    auto ret = part(spaceId, partId);
+    if (!ok(ret)) {
+        return error(ret);
     }
-    auto& parts = it->second->parts_;
-    auto partIt = parts.find(partId);
-    if (UNLIKELY(partIt == parts.end())) {
-        return ResultCode::ERR_PART_NOT_FOUND;
+    return getStoreAddr(nebula::value(ret)->leader());
+}
+
+void NebulaStore::publishPartTable() {
+    auto table = std::make_shared<PartTable>();
+    table->reserve(spaces_.size());
+    for (const auto& spaceEntry : spaces_) {
+        // inserts the space even when it holds no part yet
+        auto& parts = (*table)[spaceEntry.first];
+        parts.reserve(spaceEntry.second->parts_.size());
+        for (const auto& partEntry : spaceEntry.second->parts_) {
+            parts.emplace(partEntry.first, partEntry.second);
+        }
     }
-    return getStoreAddr(partIt->second->leader());
+    partTable_.store(std::shared_ptr<const PartTable>(std::move(table)));
 }
 
 void NebulaStore::addSpace(GraphSpaceID spaceId) {
@@ -235,6 +448,7 @@ void NebulaStore::addSpace(GraphSpaceID spaceId) {
     for (auto& path : options_.dataPaths_) {
         this->spaces_[spaceId]->engines_.emplace_back(newEngine(spaceId, path));
     }
+    publishPartTable();
 }
 
 
@@ -246,6 +460,12 @@ void NebulaStore::addPart(GraphSpaceID spaceId, PartitionID partId, bool asLearn
         LOG(INFO) << "[" << spaceId << "," << partId << "] has existed!";
         return;
     }
+    auto loadingIt = loadingParts_.find(spaceId);
+    if (loadingIt != loadingParts_.end() && loadingIt->second.count(partId) != 0) {
+        // Still replaying from disk; it publishes itself when done
+        LOG(INFO) << "[" << spaceId << "," << partId << "] is loading from disk!";
+        return;
+    }
 
     int32_t minIndex = -1;
     int32_t index = 0;
@@ -266,26 +486,51 @@ void NebulaStore::addPart(GraphSpaceID spaceId, PartitionID partId, bool asLearn
     spaceIt->second->parts_.emplace(
         partId,
         newPart(spaceId, partId, targetEngine.get(), asLearner));
+    publishPartTable();
     LOG(INFO) << "Space " << spaceId << ", part " << partId
               << " has been added, asLearner " << asLearner;
 }
 
+std::string NebulaStore::walPath(GraphSpaceID spaceId,
+                                 PartitionID partId,
+                                 KVEngine* engine) const {
+    if (options_.walPath_.empty()) {
+        return folly::stringPrintf("%s/wal/%d", engine->getDataRoot(), partId);
+    }
+    // Mirror the <walPath>/nebula/<spaceId> layout of the data roots, so
+    // one wal device can serve every space and engine without clashes
+    return folly::stringPrintf("%s/nebula/%d/wal/%d",
+                               options_.walPath_.c_str(),
+                               spaceId,
+                               partId);
+}
+
 std::shared_ptr<Part> NebulaStore::newPart(GraphSpaceID spaceId,
                                            PartitionID partId,
                                            KVEngine* engine,
                                            bool asLearner) {
+    // Pin the part to its executor lane if the lanes are enabled,
+    // otherwise all parts share the workers pool
+    auto executor = raftService_->laneExecutor(spaceId, partId);
+    if (executor == nullptr) {
+        executor = workers_;
+    }
     auto part = std::make_shared<Part>(spaceId,
                                        partId,
                                        raftAddr_,
-                                       folly::stringPrintf("%s/wal/%d",
-                                               engine->getDataRoot(),
-                                               partId),
+                                       walPath(spaceId, partId, engine),
                                        engine,
                                        ioPool_,
                                        bgWorkers_,
-                                       workers_,
+                                       executor,
                                        snapshot_,
                                        clientMan_);
+    if (options_.committedKeyFn_ != nullptr) {
+        part->setCommittedKeyFn(options_.committedKeyFn_);
+    }
+    part->setLeadershipChangedFn([this] (GraphSpaceID space, PartitionID pId, bool isLeader) {
+        onLeadershipChanged(space, pId, isLeader);
+    });
     auto metaStatus = options_.partMan_->partMeta(spaceId, partId);
     if (!metaStatus.ok()) {
         return nullptr;
@@ -304,7 +549,273 @@ std::shared_ptr<Part> NebulaStore::newPart(GraphSpaceID spaceId,
     return part;
 }
 
+void NebulaStore::loadPartFromDisk(GraphSpaceID spaceId,
+                                   PartitionID partId,
+                                   KVEngine* engine) {
+    auto part = newPart(spaceId, partId, engine, false);
+    bool removed = false;
+    {
+        folly::RWSpinLock::WriteHolder holder(&lock_);
+        auto loadingIt = loadingParts_.find(spaceId);
+        if (loadingIt == loadingParts_.end() ||
+            loadingIt->second.erase(partId) == 0) {
+            // removePart() dropped the mark while the part was opening;
+            // finish the removal it could not do itself
+            removed = true;
+        } else {
+            if (loadingIt->second.empty()) {
+                loadingParts_.erase(loadingIt);
+            }
+            if (part != nullptr) {
+                auto iter = spaces_.find(spaceId);
+                CHECK(iter != spaces_.end());
+                iter->second->parts_.emplace(partId, part);
+                // Publish per part, so the host serves each one the
+                // moment it is ready instead of after the last disk
+                // finishes
+                publishPartTable();
+            }
+        }
+    }
+    if (removed) {
+        if (part != nullptr) {
+            raftService_->removePartition(part);
+            part->reset();
+        }
+        engine->removePart(partId);
+        {
+            folly::RWSpinLock::WriteHolder holder(&lock_);
+            auto loadingIt = loadingParts_.find(spaceId);
+            if (loadingIt != loadingParts_.end() && loadingIt->second.empty()) {
+                loadingParts_.erase(loadingIt);
+            }
+        }
+        LOG(INFO) << "Space " << spaceId << ", part " << partId
+                  << " has been removed!";
+        return;
+    }
+    if (part == nullptr) {
+        // Meta dropped the part while it was waiting to open; leave it
+        // unopened, the data stays until meta removes it
+        LOG(WARNING) << "Part meta of [" << spaceId << "," << partId
+                     << "] not found, skip loading it";
+        return;
+    }
+    LOG(INFO) << "Load part " << spaceId << ", " << partId << " from disk";
+}
+
+void NebulaStore::equalizeSpaceEngines(
+        GraphSpaceID spaceId,
+        std::vector<std::pair<KVEngine*, std::vector<PartitionID>>>& engines) {
+    if (engines.size() < 2) {
+        return;
+    }
+    auto cmp = [] (const auto& lhs, const auto& rhs) {
+        return lhs.second.size() < rhs.second.size();
+    };
+    while (true) {
+        auto most = std::max_element(engines.begin(), engines.end(), cmp);
+        auto least = std::min_element(engines.begin(), engines.end(), cmp);
+        if (most->second.size() <= least->second.size() + 1) {
+            break;
+        }
+        auto partId = most->second.back();
+        LOG(INFO) << "Move part " << partId << " of space " << spaceId
+                  << " from " << most->first->getDataRoot()
+                  << " to " << least->first->getDataRoot();
+        if (!movePartData(spaceId, partId, most->first, least->first)) {
+            LOG(ERROR) << "Move part " << partId << " of space " << spaceId
+                       << " failed, stop rebalancing the space";
+            break;
+        }
+        least->first->addPart(partId);
+        most->first->removePart(partId);
+        if (options_.walPath_.empty()) {
+            // The wal stays on the old disk, drop it. The part restarts
+            // from the copied commit point and pulls the wal tail from
+            // the leader, no full snapshot is needed
+            auto oldWal = walPath(spaceId, partId, most->first);
+            fs::FileUtils::remove(oldWal.c_str(), true);
+        }
+        most->second.pop_back();
+        least->second.emplace_back(partId);
+    }
+}
+
+bool NebulaStore::movePartData(GraphSpaceID spaceId,
+                               PartitionID partId,
+                               KVEngine* from,
+                               KVEngine* to) {
+    UNUSED(spaceId);
+    // The same key type ranges removePart reclaims, so nothing the part
+    // wrote is left behind
+    static const std::vector<NebulaKeyType> types{NebulaKeyType::kData,
+                                                  NebulaKeyType::kIndex,
+                                                  NebulaKeyType::kUUID,
+                                                  NebulaKeyType::kSystem};
+    for (auto type : types) {
+        if (!copyPartRange(partId, type, from, to)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NebulaStore::copyPartRange(PartitionID partId,
+                                NebulaKeyType type,
+                                KVEngine* from,
+                                KVEngine* to) {
+    static constexpr int64_t kMoveBatchSize = 1024 * 1024 * 10;
+    PartitionID item = (partId << kPartitionOffset) | static_cast<uint32_t>(type);
+    std::string prefix(reinterpret_cast<const char*>(&item), sizeof(PartitionID));
+    std::unique_ptr<KVIterator> iter;
+    auto ret = from->prefix(prefix, &iter);
+    if (ret != ResultCode::SUCCEEDED) {
+        return false;
+    }
+    std::vector<KV> data;
+    int64_t batchSize = 0;
+    while (iter->valid()) {
+        data.emplace_back(iter->key().str(), iter->val().str());
+        batchSize += data.back().first.size() + data.back().second.size();
+        if (batchSize >= kMoveBatchSize) {
+            if (to->multiPut(std::move(data)) != ResultCode::SUCCEEDED) {
+                return false;
+            }
+            data.clear();
+            batchSize = 0;
+        }
+        iter->next();
+    }
+    if (!data.empty() && to->multiPut(std::move(data)) != ResultCode::SUCCEEDED) {
+        return false;
+    }
+    return true;
+}
+
+ResultCode NebulaStore::migratePart(GraphSpaceID spaceId,
+                                    PartitionID partId,
+                                    const std::string& dataPath) {
+    KVEngine* from = nullptr;
+    KVEngine* to = nullptr;
+    std::shared_ptr<Part> oldPart;
+    {
+        folly::RWSpinLock::ReadHolder rh(&lock_);
+        auto spaceIt = spaces_.find(spaceId);
+        if (spaceIt == spaces_.end()) {
+            return ResultCode::ERR_SPACE_NOT_FOUND;
+        }
+        auto partIt = spaceIt->second->parts_.find(partId);
+        if (partIt == spaceIt->second->parts_.end()) {
+            return ResultCode::ERR_PART_NOT_FOUND;
+        }
+        oldPart = partIt->second;
+        from = oldPart->engine();
+        for (auto& engine : spaceIt->second->engines_) {
+            std::string root = engine->getDataRoot();
+            if (root == dataPath || root.find(dataPath + "/") == 0) {
+                to = engine.get();
+                break;
+            }
+        }
+    }
+    if (to == nullptr) {
+        LOG(ERROR) << "Space " << spaceId << ", part " << partId
+                   << ": no engine of the space lives under " << dataPath;
+        return ResultCode::ERR_UNKNOWN;
+    }
+    if (to == from) {
+        LOG(INFO) << "Space " << spaceId << ", part " << partId
+                  << " already lives on " << dataPath;
+        return ResultCode::SUCCEEDED;
+    }
+
+    // Phase one: copy the bulk while the part keeps serving. The commit
+    // marker (kSystem) goes first, so it can only undershoot the data
+    // the later iterators observe; on restart raft replays the logs
+    // past the marker, and re-applying batches the copy already carried
+    // is harmless
+    LOG(INFO) << "Space " << spaceId << ", part " << partId << ": copying from "
+              << from->getDataRoot() << " to " << to->getDataRoot();
+    static const std::vector<NebulaKeyType> types{NebulaKeyType::kSystem,
+                                                  NebulaKeyType::kData,
+                                                  NebulaKeyType::kIndex,
+                                                  NebulaKeyType::kUUID};
+    for (auto type : types) {
+        if (!copyPartRange(partId, type, from, to)) {
+            LOG(ERROR) << "Space " << spaceId << ", part " << partId
+                       << ": bulk copy failed, dropping the partial copy";
+            // pair the accounting so the reclaim does not underflow
+            to->addPart(partId);
+            to->removePart(partId);
+            return ResultCode::ERR_IO_ERROR;
+        }
+    }
+
+    // Phase two: the brief pause. Stop the part, restart it on the
+    // target engine and let raft catch up the writes that landed after
+    // the copy; writes arriving in between fail as they do across a
+    // leader change and get retried by the client
+    {
+        folly::RWSpinLock::WriteHolder wh(&lock_);
+        auto spaceIt = spaces_.find(spaceId);
+        if (spaceIt == spaces_.end()) {
+            to->addPart(partId);
+            to->removePart(partId);
+            return ResultCode::ERR_SPACE_NOT_FOUND;
+        }
+        auto partIt = spaceIt->second->parts_.find(partId);
+        if (partIt == spaceIt->second->parts_.end() || partIt->second != oldPart) {
+            // the part was dropped or replaced while we copied
+            to->addPart(partId);
+            to->removePart(partId);
+            return ResultCode::ERR_PART_NOT_FOUND;
+        }
+        raftService_->removePartition(oldPart);
+        spaceIt->second->parts_.erase(partIt);
+        to->addPart(partId);
+        auto part = newPart(spaceId, partId, to, false);
+        if (part == nullptr) {
+            // part meta vanished mid-flight; put the part back on the
+            // source engine so the replica is not lost
+            LOG(ERROR) << "Space " << spaceId << ", part " << partId
+                       << ": restart on the target engine failed, reverting";
+            to->removePart(partId);
+            part = newPart(spaceId, partId, from, false);
+            if (part != nullptr) {
+                spaceIt->second->parts_.emplace(partId, part);
+            }
+            publishPartTable();
+            return ResultCode::ERR_UNKNOWN;
+        }
+        spaceIt->second->parts_.emplace(partId, part);
+        publishPartTable();
+        // reclaim the source copy; the wal moves with the engine root
+        // unless a dedicated wal device keeps it in place
+        from->removePart(partId);
+        if (options_.walPath_.empty()) {
+            auto oldWal = walPath(spaceId, partId, from);
+            fs::FileUtils::remove(oldWal.c_str(), true);
+        }
+    }
+    LOG(INFO) << "Space " << spaceId << ", part " << partId
+              << " now lives on " << to->getDataRoot();
+    return ResultCode::SUCCEEDED;
+}
+
 void NebulaStore::removeSpace(GraphSpaceID spaceId) {
+    // Wait out the loaders of the space first; tearing the engines down
+    // under them would leave dangling pointers
+    while (true) {
+        {
+            folly::RWSpinLock::ReadHolder rh(&lock_);
+            if (loadingParts_.find(spaceId) == loadingParts_.end()) {
+                break;
+            }
+        }
+        LOG(INFO) << "Space " << spaceId << " is still loading from disk, waiting...";
+        usleep(100 * 1000);
+    }
     folly::RWSpinLock::WriteHolder wh(&lock_);
     auto spaceIt = this->spaces_.find(spaceId);
     auto& engines = spaceIt->second->engines_;
@@ -316,7 +827,15 @@ void NebulaStore::removeSpace(GraphSpaceID spaceId) {
         CHECK_EQ(0, engine->totalPartsNum());
     }
     this->spaces_.erase(spaceIt);
-    // TODO(dangleptr): Should we delete the data?
+    publishPartTable();
+    {
+        // The parts went down without firing onLostLeadership
+        folly::RWSpinLock::WriteHolder lh(&leaderLock_);
+        if (leaderParts_.erase(spaceId) != 0) {
+            ++leaderEpoch_;
+        }
+    }
+    // The engines have reclaimed the part data in removePart()
     LOG(INFO) << "Space " << spaceId << " has been removed!";
 }
 
@@ -333,6 +852,18 @@ void NebulaStore::removePart(GraphSpaceID spaceId, PartitionID partId) {
             partIt->second->reset();
             spaceIt->second->parts_.erase(partId);
             e->removePart(partId);
+            publishPartTable();
+            // A stopped part fires no onLostLeadership, drop it from
+            // the leader table by hand
+            onLeadershipChanged(spaceId, partId, false);
+        } else {
+            // The part may still be loading from disk; dropping its mark
+            // makes its loader finish the removal. The loader also clears
+            // the entry itself, so removeSpace() keeps waiting for it
+            auto loadingIt = loadingParts_.find(spaceId);
+            if (loadingIt != loadingParts_.end()) {
+                loadingIt->second.erase(partId);
+            }
         }
     }
     LOG(INFO) << "Space " << spaceId << ", part " << partId << " has been removed!";
@@ -341,45 +872,185 @@ void NebulaStore::removePart(GraphSpaceID spaceId, PartitionID partId) {
 void NebulaStore::updateSpaceOption(GraphSpaceID spaceId,
                                     const std::unordered_map<std::string, std::string>& options,
                                     bool isDbOption) {
-    if (isDbOption) {
+    // Apply on a background worker so the meta client thread delivering
+    // the update is not blocked behind the engines
+    bgWorkers_->addTask([this, spaceId, options, isDbOption] {
+        setOptionBatch(spaceId, options, isDbOption);
+    });
+}
+
+ResultCode NebulaStore::setOptionBatch(
+        GraphSpaceID spaceId,
+        const std::unordered_map<std::string, std::string>& options,
+        bool isDbOption) {
+    auto spaceRet = space(spaceId);
+    if (!ok(spaceRet)) {
+        return error(spaceRet);
+    }
+    auto space = nebula::value(spaceRet);
+    auto getOpt = [isDbOption] (KVEngine* engine, const std::string& key, std::string* value) {
+        return isDbOption ? engine->getDBOption(key, value) : engine->getOption(key, value);
+    };
+    auto setOpt = [isDbOption] (KVEngine* engine, const std::string& key,
+                                const std::string& value) {
+        return isDbOption ? engine->setDBOption(key, value) : engine->setOption(key, value);
+    };
+    // The previous value of every option applied per engine, so a half
+    // applied bundle can be undone
+    std::vector<std::vector<std::pair<std::string, std::string>>> applied(
+        space->engines_.size());
+    auto code = ResultCode::SUCCEEDED;
+    for (size_t i = 0; i < space->engines_.size() && code == ResultCode::SUCCEEDED; i++) {
+        auto* engine = space->engines_[i].get();
         for (const auto& kv : options) {
-            setDBOption(spaceId, kv.first, kv.second);
+            std::string oldValue;
+            bool hasOld = getOpt(engine, kv.first, &oldValue) == ResultCode::SUCCEEDED;
+            if (FLAGS_option_update_dry_run) {
+                LOG(INFO) << "Dry run on " << engine->getDataRoot() << ": would set "
+                          << kv.first << " from "
+                          << (hasOld ? oldValue : std::string("<unknown>"))
+                          << " to " << kv.second;
+                continue;
+            }
+            code = setOpt(engine, kv.first, kv.second);
+            if (code != ResultCode::SUCCEEDED) {
+                break;
+            }
+            if (hasOld) {
+                applied[i].emplace_back(kv.first, oldValue);
+            }
+            // Read back what the engine holds now. Values come back
+            // normalized (4M -> 4194304), so only a failed read-back
+            // is worth reporting
+            std::string verify;
+            if (getOpt(engine, kv.first, &verify) != ResultCode::SUCCEEDED) {
+                LOG(WARNING) << "Option " << kv.first << " applied on "
+                             << engine->getDataRoot() << " but cannot be read back";
+            }
         }
-    } else {
-        for (const auto& kv : options) {
-            setOption(spaceId, kv.first, kv.second);
+    }
+    if (code != ResultCode::SUCCEEDED) {
+        LOG(ERROR) << "Space " << spaceId << " option update failed, rolling back the "
+                   << "values already changed";
+        for (size_t i = 0; i < applied.size(); i++) {
+            for (const auto& kv : applied[i]) {
+                setOpt(space->engines_[i].get(), kv.first, kv.second);
+            }
         }
     }
+    return code;
 }
 
 ResultCode NebulaStore::get(GraphSpaceID spaceId,
                             PartitionID partId,
                             const std::string& key,
-                            std::string* value) {
-    auto ret = part(spaceId, partId);
+                            std::string* value,
+                            bool canReadFromFollower) {
+    auto ret = partIfServing(spaceId, partId);
     if (!ok(ret)) {
         return error(ret);
     }
     auto part = nebula::value(ret);
-    if (!checkLeader(part)) {
+    if (!checkLeader(part, canReadFromFollower)) {
         return ResultCode::ERR_LEADER_CHANGED;
     }
     return part->engine()->get(key, value);
 }
 
 
+ResultCode NebulaStore::getLatest(GraphSpaceID spaceId,
+                                  PartitionID partId,
+                                  const std::string& keyPrefix,
+                                  std::string* value,
+                                  bool canReadFromFollower,
+                                  const SpaceSnapshot* snapshot) {
+    auto ret = partIfServing(spaceId, partId);
+    if (!ok(ret)) {
+        return error(ret);
+    }
+    auto part = nebula::value(ret);
+    if (!checkLeader(part, canReadFromFollower)) {
+        return ResultCode::ERR_LEADER_CHANGED;
+    }
+    auto* engine = part->engine();
+    auto* engineSnap = snapshot == nullptr
+        ? nullptr
+        : static_cast<const NebulaSnapshot*>(snapshot)->engineSnapshot(engine);
+    return engine->getLatest(keyPrefix, value, engineSnap);
+}
+
+
+bool NebulaStore::maybeExists(GraphSpaceID spaceId,
+                              PartitionID partId,
+                              const std::string& keyNoVersion) {
+    auto ret = partIfServing(spaceId, partId);
+    if (!ok(ret)) {
+        return true;
+    }
+    return nebula::value(ret)->maybeExists(keyNoVersion);
+}
+
+
+folly::Future<ErrorOr<ResultCode, std::string>> NebulaStore::asyncGet(
+        GraphSpaceID spaceId,
+        PartitionID partId,
+        std::string key,
+        bool canReadFromFollower) {
+    return folly::via(
+        ioPool_.get(),
+        [this, spaceId, partId, key = std::move(key), canReadFromFollower] () {
+            std::string value;
+            auto code = get(spaceId, partId, key, &value, canReadFromFollower);
+            ErrorOr<ResultCode, std::string> ret;
+            if (code == ResultCode::SUCCEEDED) {
+                ret = std::move(value);
+            } else {
+                ret = code;
+            }
+            return ret;
+        });
+}
+
+
+folly::Future<std::vector<KVStore::PartMultiGetResult>> NebulaStore::asyncMultiGet(
+        GraphSpaceID spaceId,
+        std::vector<std::pair<PartitionID, std::vector<std::string>>> keysOfPart,
+        bool canReadFromFollower) {
+    std::vector<folly::Future<PartMultiGetResult>> futures;
+    futures.reserve(keysOfPart.size());
+    for (auto& partKeys : keysOfPart) {
+        auto partId = partKeys.first;
+        futures.emplace_back(folly::via(
+            ioPool_.get(),
+            [this, spaceId, partId,
+             keys = std::move(partKeys.second), canReadFromFollower] () {
+                PartMultiGetResult result;
+                result.partId = partId;
+                auto ret = multiGet(spaceId, partId, keys, &result.values, canReadFromFollower);
+                result.code = ret.first;
+                result.statuses = std::move(ret.second);
+                return result;
+            }));
+    }
+    // The tasks report errors through PartMultiGetResult::code and
+    // never throw, so the collected future cannot carry an exception
+    return folly::collect(std::move(futures));
+}
+
+
 std::pair<ResultCode, std::vector<Status>> NebulaStore::multiGet(
         GraphSpaceID spaceId,
         PartitionID partId,
         const std::vector<std::string>& keys,
-        std::vector<std::string>* values) {
+        std::vector<std::string>* values,
+        bool canReadFromFollower) {
     std::vector<Status> status;
-    auto ret = part(spaceId, partId);
+    auto ret = partIfServing(spaceId, partId);
     if (!ok(ret)) {
         return {error(ret), status};
     }
     auto part = nebula::value(ret);
-    if (!checkLeader(part)) {
+    if (!checkLeader(part, canReadFromFollower)) {
         return {ResultCode::ERR_LEADER_CHANGED, status};
     }
     status = part->engine()->multiGet(keys, values);
@@ -395,36 +1066,65 @@ std::pair<ResultCode, std::vector<Status>> NebulaStore::multiGet(
 }
 
 
+std::unique_ptr<SpaceSnapshot> NebulaStore::beginSnapshot(GraphSpaceID spaceId) {
+    folly::RWSpinLock::ReadHolder rh(&lock_);
+    auto spaceIt = spaces_.find(spaceId);
+    if (spaceIt == spaces_.end()) {
+        return nullptr;
+    }
+    auto snapshot = std::make_unique<NebulaSnapshot>();
+    snapshot->snapshots_.reserve(spaceIt->second->engines_.size());
+    for (auto& engine : spaceIt->second->engines_) {
+        snapshot->snapshots_.emplace_back(engine.get(), engine->beginSnapshot());
+    }
+    return snapshot;
+}
+
+
 ResultCode NebulaStore::range(GraphSpaceID spaceId,
                               PartitionID partId,
                               const std::string& start,
                               const std::string& end,
-                              std::unique_ptr<KVIterator>* iter) {
-    auto ret = part(spaceId, partId);
+                              std::unique_ptr<KVIterator>* iter,
+                              bool canReadFromFollower,
+                              ScanHint hint,
+                              const SpaceSnapshot* snapshot) {
+    auto ret = partIfServing(spaceId, partId);
     if (!ok(ret)) {
         return error(ret);
     }
     auto part = nebula::value(ret);
-    if (!checkLeader(part)) {
+    if (!checkLeader(part, canReadFromFollower)) {
         return ResultCode::ERR_LEADER_CHANGED;
     }
-    return part->engine()->range(start, end, iter);
+    auto* engine = part->engine();
+    auto* engineSnap = snapshot == nullptr
+        ? nullptr
+        : static_cast<const NebulaSnapshot*>(snapshot)->engineSnapshot(engine);
+    return engine->range(start, end, iter, hint, engineSnap);
 }
 
 
 ResultCode NebulaStore::prefix(GraphSpaceID spaceId,
                                PartitionID partId,
                                const std::string& prefix,
-                               std::unique_ptr<KVIterator>* iter) {
-    auto ret = part(spaceId, partId);
+                               std::unique_ptr<KVIterator>* iter,
+                               bool canReadFromFollower,
+                               ScanHint hint,
+                               const SpaceSnapshot* snapshot) {
+    auto ret = partIfServing(spaceId, partId);
     if (!ok(ret)) {
         return error(ret);
     }
     auto part = nebula::value(ret);
-    if (!checkLeader(part)) {
+    if (!checkLeader(part, canReadFromFollower)) {
         return ResultCode::ERR_LEADER_CHANGED;
     }
-    return part->engine()->prefix(prefix, iter);
+    auto* engine = part->engine();
+    auto* engineSnap = snapshot == nullptr
+        ? nullptr
+        : static_cast<const NebulaSnapshot*>(snapshot)->engineSnapshot(engine);
+    return engine->prefix(prefix, iter, hint, engineSnap);
 }
 
 
@@ -432,22 +1132,29 @@ ResultCode NebulaStore::rangeWithPrefix(GraphSpaceID spaceId,
                                         PartitionID  partId,
                                         const std::string& start,
                                         const std::string& prefix,
-                                        std::unique_ptr<KVIterator>* iter) {
-    auto ret = part(spaceId, partId);
+                                        std::unique_ptr<KVIterator>* iter,
+                                        bool canReadFromFollower,
+                                        ScanHint hint,
+                                        const SpaceSnapshot* snapshot) {
+    auto ret = partIfServing(spaceId, partId);
     if (!ok(ret)) {
         return error(ret);
     }
     auto part = nebula::value(ret);
-    if (!checkLeader(part)) {
+    if (!checkLeader(part, canReadFromFollower)) {
         return ResultCode::ERR_LEADER_CHANGED;
     }
-    return part->engine()->rangeWithPrefix(start, prefix, iter);
+    auto* engine = part->engine();
+    auto* engineSnap = snapshot == nullptr
+        ? nullptr
+        : static_cast<const NebulaSnapshot*>(snapshot)->engineSnapshot(engine);
+    return engine->rangeWithPrefix(start, prefix, iter, hint, engineSnap);
 }
 
 
 ResultCode NebulaStore::sync(GraphSpaceID spaceId,
                              PartitionID partId) {
-    auto partRet = part(spaceId, partId);
+    auto partRet = partIfServing(spaceId, partId);
     if (!ok(partRet)) {
         return error(partRet);
     }
@@ -470,7 +1177,7 @@ void NebulaStore::asyncMultiPut(GraphSpaceID spaceId,
                                 PartitionID partId,
                                 std::vector<KV> keyValues,
                                 KVCallback cb) {
-    auto ret = part(spaceId, partId);
+    auto ret = partIfWritable(spaceId, partId);
     if (!ok(ret)) {
         cb(error(ret));
         return;
@@ -480,11 +1187,40 @@ void NebulaStore::asyncMultiPut(GraphSpaceID spaceId,
 }
 
 
+void NebulaStore::asyncMerge(GraphSpaceID spaceId,
+                             PartitionID partId,
+                             const std::string& key,
+                             const std::string& value,
+                             KVCallback cb) {
+    auto ret = partIfWritable(spaceId, partId);
+    if (!ok(ret)) {
+        cb(error(ret));
+        return;
+    }
+    auto part = nebula::value(ret);
+    part->asyncMerge(key, value, std::move(cb));
+}
+
+
+void NebulaStore::asyncAppendBatch(GraphSpaceID spaceId,
+                                   PartitionID partId,
+                                   std::string batch,
+                                   KVCallback cb) {
+    auto ret = partIfWritable(spaceId, partId);
+    if (!ok(ret)) {
+        cb(error(ret));
+        return;
+    }
+    auto part = nebula::value(ret);
+    part->asyncAppendBatch(std::move(batch), std::move(cb));
+}
+
+
 void NebulaStore::asyncRemove(GraphSpaceID spaceId,
                               PartitionID partId,
                               const std::string& key,
                               KVCallback cb) {
-    auto ret = part(spaceId, partId);
+    auto ret = partIfWritable(spaceId, partId);
     if (!ok(ret)) {
         cb(error(ret));
         return;
@@ -498,7 +1234,7 @@ void NebulaStore::asyncMultiRemove(GraphSpaceID spaceId,
                                    PartitionID  partId,
                                    std::vector<std::string> keys,
                                    KVCallback cb) {
-    auto ret = part(spaceId, partId);
+    auto ret = partIfWritable(spaceId, partId);
     if (!ok(ret)) {
         cb(error(ret));
         return;
@@ -513,7 +1249,7 @@ void NebulaStore::asyncRemoveRange(GraphSpaceID spaceId,
                                    const std::string& start,
                                    const std::string& end,
                                    KVCallback cb) {
-    auto ret = part(spaceId, partId);
+    auto ret = partIfWritable(spaceId, partId);
     if (!ok(ret)) {
         cb(error(ret));
         return;
@@ -522,11 +1258,25 @@ void NebulaStore::asyncRemoveRange(GraphSpaceID spaceId,
     part->asyncRemoveRange(start, end, std::move(cb));
 }
 
+
+void NebulaStore::asyncMultiRemoveRange(GraphSpaceID spaceId,
+                                        PartitionID partId,
+                                        std::vector<KV> ranges,
+                                        KVCallback cb) {
+    auto ret = partIfWritable(spaceId, partId);
+    if (!ok(ret)) {
+        cb(error(ret));
+        return;
+    }
+    auto part = nebula::value(ret);
+    part->asyncMultiRemoveRange(ranges, std::move(cb));
+}
+
 void NebulaStore::asyncAtomicOp(GraphSpaceID spaceId,
                                 PartitionID partId,
                                 raftex::AtomicOp op,
                                 KVCallback cb) {
-    auto ret = part(spaceId, partId);
+    auto ret = partIfWritable(spaceId, partId);
     if (!ok(ret)) {
         cb(error(ret));
         return;
@@ -537,12 +1287,14 @@ void NebulaStore::asyncAtomicOp(GraphSpaceID spaceId,
 
 ErrorOr<ResultCode, std::shared_ptr<Part>> NebulaStore::part(GraphSpaceID spaceId,
                                                              PartitionID partId) {
-    folly::RWSpinLock::ReadHolder rh(&lock_);
-    auto it = spaces_.find(spaceId);
-    if (UNLIKELY(it == spaces_.end())) {
+    // Wait-free against the meta-update callbacks: the loaded table is
+    // immutable, membership changes swap a rebuilt one in
+    auto table = partTable_.load();
+    auto it = table->find(spaceId);
+    if (UNLIKELY(it == table->end())) {
         return ResultCode::ERR_SPACE_NOT_FOUND;
     }
-    auto& parts = it->second->parts_;
+    auto& parts = it->second;
     auto partIt = parts.find(partId);
     if (UNLIKELY(partIt == parts.end())) {
         return ResultCode::ERR_PART_NOT_FOUND;
@@ -550,37 +1302,285 @@ ErrorOr<ResultCode, std::shared_ptr<Part>> NebulaStore::part(GraphSpaceID spaceI
     return partIt->second;
 }
 
-ResultCode NebulaStore::ingest(GraphSpaceID spaceId) {
+ErrorOr<ResultCode, std::pair<LogID, TermID>> NebulaStore::commitToken(GraphSpaceID spaceId,
+                                                                       PartitionID partId) {
+    auto ret = part(spaceId, partId);
+    if (!ok(ret)) {
+        return error(ret);
+    }
+    return nebula::value(ret)->committedLogIdAndTerm();
+}
+
+ResultCode NebulaStore::waitCommitted(GraphSpaceID spaceId,
+                                      PartitionID partId,
+                                      LogID logId,
+                                      int64_t timeoutMs) {
+    auto ret = part(spaceId, partId);
+    if (!ok(ret)) {
+        return error(ret);
+    }
+    return nebula::value(ret)->waitCommitted(logId, timeoutMs)
+            ? ResultCode::SUCCEEDED : ResultCode::ERR_CONSENSUS_ERROR;
+}
+
+ErrorOr<ResultCode, std::shared_ptr<Part>> NebulaStore::partIfServing(GraphSpaceID spaceId,
+                                                                      PartitionID partId) {
+    auto ret = part(spaceId, partId);
+    if (!ok(ret)) {
+        return ret;
+    }
+    auto health = nebula::value(ret)->engine()->health();
+    if (LIKELY(health == EngineHealth::HEALTHY)) {
+        return ret;
+    }
+    if (health == EngineHealth::FAILED) {
+        // Failing fast beats grinding through the engine timeout: the
+        // graph layer has replicas to retry
+        return ResultCode::ERR_PART_NOT_FOUND;
+    }
+    if (static_cast<int32_t>(folly::Random::rand32(100)) < FLAGS_engine_degraded_shed_pct) {
+        return ResultCode::ERR_PART_NOT_FOUND;
+    }
+    return ret;
+}
+
+ErrorOr<ResultCode, std::shared_ptr<Part>> NebulaStore::partIfWritable(GraphSpaceID spaceId,
+                                                                       PartitionID partId) {
+    auto ret = partIfServing(spaceId, partId);
+    if (!ok(ret) || FLAGS_write_stall_reject_pct <= 0) {
+        return ret;
+    }
+    auto stallPct = nebula::value(ret)->engine()->writeStallPct();
+    if (UNLIKELY(stallPct >= FLAGS_write_stall_reject_pct)) {
+        LOG_EVERY_N(WARNING, 1000)
+            << "Rejecting write to [" << spaceId << ", " << partId << "]: engine "
+            << nebula::value(ret)->engine()->getDataRoot()
+            << " is at " << stallPct << "% of a write stall";
+        return ResultCode::ERR_WRITE_STALL;
+    }
+    return ret;
+}
+
+void NebulaStore::probeEngineHealth() {
+    // Same read-holder iteration engineStatus() does; a probe is one
+    // point read per engine
+    folly::RWSpinLock::ReadHolder rh(&lock_);
+    for (auto& spaceEntry : spaces_) {
+        for (auto& engine : spaceEntry.second->engines_) {
+            auto before = engine->health();
+            engine->probeHealth();
+            auto after = engine->health();
+            if (after != before) {
+                LOG(WARNING) << "Engine " << engine->getDataRoot()
+                             << " health changed: " << static_cast<int32_t>(before)
+                             << " -> " << static_cast<int32_t>(after);
+            }
+        }
+    }
+}
+
+void NebulaStore::flushApplyState() {
+    // Grab the space handles first; the flushes can take seconds and
+    // must not run under lock_
+    std::vector<std::shared_ptr<SpacePartInfo>> spaces;
+    {
+        folly::RWSpinLock::ReadHolder rh(&lock_);
+        spaces.reserve(spaces_.size());
+        for (auto& spaceEntry : spaces_) {
+            spaces.emplace_back(spaceEntry.second);
+        }
+    }
+    for (auto& space : spaces) {
+        for (auto& engine : space->engines_) {
+            auto code = engine->flush();
+            if (code != ResultCode::SUCCEEDED) {
+                LOG(WARNING) << "Timed flush of " << engine->getDataRoot()
+                             << " failed, error " << static_cast<int32_t>(code);
+            }
+        }
+    }
+}
+
+void NebulaStore::saveWarmupProfiles() {
+    std::vector<std::shared_ptr<SpacePartInfo>> spaces;
+    {
+        folly::RWSpinLock::ReadHolder rh(&lock_);
+        spaces.reserve(spaces_.size());
+        for (auto& spaceEntry : spaces_) {
+            spaces.emplace_back(spaceEntry.second);
+        }
+    }
+    for (auto& space : spaces) {
+        for (auto& engine : space->engines_) {
+            engine->saveWarmupProfile();
+        }
+    }
+}
+
+void NebulaStore::warmupRaftClients() {
+    // The raft address of every remote peer we share a part with
+    std::unordered_set<HostAddr> peers;
+    auto partsMap = options_.partMan_->parts(storeSvcAddr_);
+    for (auto& spaceEntry : partsMap) {
+        for (auto& partEntry : spaceEntry.second) {
+            auto metaStatus = options_.partMan_->partMeta(spaceEntry.first, partEntry.first);
+            if (!metaStatus.ok()) {
+                continue;
+            }
+            for (auto& h : metaStatus.value().hosts_) {
+                if (h != storeSvcAddr_) {
+                    peers.emplace(getRaftAddr(h));
+                }
+            }
+        }
+    }
+    if (peers.empty()) {
+        return;
+    }
+    // Touch every (eventbase, peer) slot of the client manager from the
+    // eventbase's own thread, the way the replication path does. The
+    // manager caches the client per slot and hands back a fresh one
+    // when the cached channel has gone bad, so one round both opens the
+    // missing connections and retires the dead ones
+    for (size_t i = 0; i < ioPool_->numThreads(); i++) {
+        auto* evb = ioPool_->getEventBase();
+        evb->runInEventBaseThread([clientMan = clientMan_, evb, peers] {
+            for (auto& peer : peers) {
+                clientMan->client(peer, evb, false, FLAGS_raft_rpc_timeout_ms);
+            }
+        });
+    }
+    VLOG(1) << "Warmed the raft clients of " << ioPool_->numThreads()
+            << " eventbases to " << peers.size() << " peers";
+}
+
+ResultCode NebulaStore::runEngineJobs(const std::shared_ptr<SpacePartInfo>& space,
+                                      const std::function<ResultCode(KVEngine*)>& job) {
+    auto concurrency = space->engines_.size();
+    if (FLAGS_engine_job_concurrency != 0) {
+        concurrency = std::min(concurrency,
+                               static_cast<size_t>(FLAGS_engine_job_concurrency));
+    }
+
+    std::atomic<size_t> nextEngine{0};
+    std::atomic<ResultCode> code{ResultCode::SUCCEEDED};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < concurrency; i++) {
+        threads.emplace_back([&space, &job, &nextEngine, &code] {
+            size_t idx;
+            while ((idx = nextEngine.fetch_add(1)) < space->engines_.size()) {
+                auto ret = job(space->engines_[idx].get());
+                if (ret != ResultCode::SUCCEEDED) {
+                    code = ret;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return code;
+}
+
+ResultCode NebulaStore::ingest(GraphSpaceID spaceId, bool verifyChecksum, bool prewarm,
+                               bool buildIndex) {
     auto spaceRet = space(spaceId);
     if (!ok(spaceRet)) {
         return error(spaceRet);
     }
     auto space = nebula::value(spaceRet);
-    for (auto& engine : space->engines_) {
+    if (verifyChecksum) {
+        // Collect every staged file up front and verify the block
+        // checksums before any engine moves a file in, so one corrupt
+        // download aborts the whole ingest while the data is still
+        // invisible
+        std::vector<std::string> files;
+        for (auto& engine : space->engines_) {
+            for (auto part : engine->allParts()) {
+                auto path = folly::stringPrintf("%s/download/%d",
+                                                engine->getDataRoot(), part);
+                if (!fs::FileUtils::exist(path)) {
+                    continue;
+                }
+                auto more = fs::FileUtils::listAllFilesInDir(path.c_str(), true, "*.sst");
+                files.insert(files.end(), more.begin(), more.end());
+            }
+        }
+        LOG(INFO) << "Space " << spaceId << " verifying " << files.size()
+                  << " sst files before ingest";
+        auto workers = std::max<size_t>(1,
+            std::min<size_t>(FLAGS_ingest_verify_concurrency, files.size()));
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < workers; i++) {
+            threads.emplace_back([&files, &next, &failed] {
+                size_t idx;
+                while (!failed && (idx = next.fetch_add(1)) < files.size()) {
+                    rocksdb::SstFileReader reader{rocksdb::Options()};
+                    auto status = reader.Open(files[idx]);
+                    if (status.ok()) {
+                        status = reader.VerifyChecksum();
+                    }
+                    if (!status.ok()) {
+                        LOG(ERROR) << "Checksum verification of " << files[idx]
+                                   << " failed: " << status.ToString();
+                        failed = true;
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        if (failed) {
+            return ResultCode::ERR_INVALID_DATA;
+        }
+    }
+    LOG(INFO) << "Space " << spaceId << " start ingesting.";
+    auto code = runEngineJobs(space, [this, spaceId, prewarm, buildIndex] (KVEngine* engine) {
         auto parts = engine->allParts();
         for (auto part : parts) {
-            auto ret = this->engine(spaceId, part);
-            if (!ok(ret)) {
-                return error(ret);
-            }
-
-            auto path = folly::stringPrintf("%s/download/%d", value(ret)->getDataRoot(), part);
+            auto path = folly::stringPrintf("%s/download/%d", engine->getDataRoot(), part);
             if (!fs::FileUtils::exist(path)) {
                 LOG(INFO) << path << " not existed";
                 continue;
             }
 
             auto files = nebula::fs::FileUtils::listAllFilesInDir(path.c_str(), true, "*.sst");
+            if (buildIndex && options_.ingestIndexBuilderFn_ != nullptr && !files.empty()) {
+                // The generated index ssts land in the same staging dir
+                // and join the file list, so data and index move in as
+                // one operation
+                auto ret = options_.ingestIndexBuilderFn_(spaceId, part, files, path);
+                if (ret != ResultCode::SUCCEEDED) {
+                    return ret;
+                }
+                files = nebula::fs::FileUtils::listAllFilesInDir(path.c_str(), true, "*.sst");
+            }
             for (auto file : files) {
                 LOG(INFO) << "Ingesting extra file: " << file;
-                auto code = engine->ingest(std::vector<std::string>({file}));
+                auto code = engine->ingest(std::vector<std::string>({file}), prewarm);
                 if (code != ResultCode::SUCCEEDED) {
                     return code;
                 }
             }
         }
+        return ResultCode::SUCCEEDED;
+    });
+    LOG(INFO) << "Space " << spaceId << " ingesting done.";
+    return code;
+}
+
+
+ResultCode NebulaStore::writeBulkSst(GraphSpaceID spaceId,
+                                     PartitionID partId,
+                                     const std::vector<KV>& sortedData) {
+    auto engineRet = engine(spaceId, partId);
+    if (!ok(engineRet)) {
+        return error(engineRet);
     }
-    return ResultCode::SUCCEEDED;
+    return nebula::value(engineRet)->writeBulkSst(partId, sortedData);
 }
 
 
@@ -627,24 +1627,43 @@ ResultCode NebulaStore::compact(GraphSpaceID spaceId) {
     }
     auto space = nebula::value(spaceRet);
 
-    auto code = ResultCode::SUCCEEDED;
-    std::vector<std::thread> threads;
     LOG(INFO) << "Space " << spaceId << " start compaction.";
-    for (auto& engine : space->engines_) {
-        threads.emplace_back(std::thread([&engine, &code] {
-            auto ret = engine->compact();
-            if (ret != ResultCode::SUCCEEDED) {
-                code = ret;
+    auto code = runEngineJobs(space, [] (KVEngine* engine) {
+        return engine->compact();
+    });
+    LOG(INFO) << "Space " << spaceId << " compaction done.";
+    return code;
+}
+
+std::vector<EngineStatus> NebulaStore::engineStatus(
+        const std::vector<std::string>& properties) {
+    std::vector<EngineStatus> result;
+    folly::RWSpinLock::ReadHolder rh(&lock_);
+    for (const auto& spaceEntry : spaces_) {
+        for (const auto& engine : spaceEntry.second->engines_) {
+            EngineStatus status;
+            status.spaceId = spaceEntry.first;
+            status.path = engine->getDataRoot();
+            for (const auto& property : properties) {
+                std::string value;
+                if (engine->getProperty(property, &value) == ResultCode::SUCCEEDED) {
+                    status.properties.emplace(property, std::move(value));
+                }
             }
-        }));
+            engine->getStatistics(&status.statistics);
+            result.emplace_back(std::move(status));
+        }
     }
+    return result;
+}
 
-    // Wait for all threads to finish
-    for (auto& t : threads) {
-        t.join();
+void NebulaStore::setEngineRateLimit(int32_t mbps) {
+    folly::RWSpinLock::ReadHolder rh(&lock_);
+    for (auto& spaceEntry : spaces_) {
+        for (auto& engine : spaceEntry.second->engines_) {
+            engine->setRateLimit(mbps);
+        }
     }
-    LOG(INFO) << "Space " << spaceId << " compaction done.";
-    return code;
 }
 
 ResultCode NebulaStore::flush(GraphSpaceID spaceId) {
@@ -662,6 +1681,21 @@ ResultCode NebulaStore::flush(GraphSpaceID spaceId) {
     return ResultCode::SUCCEEDED;
 }
 
+std::string NebulaStore::cardinalityStatus(GraphSpaceID spaceId) {
+    auto spaceRet = space(spaceId);
+    if (!ok(spaceRet)) {
+        return "";
+    }
+    auto space = nebula::value(spaceRet);
+    // Every part lives on exactly one engine of the host, so the
+    // per-engine reports concatenate without double counting
+    std::string status;
+    for (auto& engine : space->engines_) {
+        status += engine->cardinalityStatus();
+    }
+    return status;
+}
+
 ResultCode NebulaStore::createCheckpoint(GraphSpaceID spaceId, const std::string& name) {
     auto spaceRet = space(spaceId);
     if (!ok(spaceRet)) {
@@ -758,31 +1792,19 @@ ResultCode NebulaStore::setWriteBlocking(GraphSpaceID spaceId, bool sign) {
 }
 
 bool NebulaStore::isLeader(GraphSpaceID spaceId, PartitionID partId) {
-    folly::RWSpinLock::ReadHolder rh(&lock_);
-    auto spaceIt = spaces_.find(spaceId);
-    if (spaceIt != this->spaces_.end()) {
-        auto partIt = spaceIt->second->parts_.find(partId);
-        if (partIt != spaceIt->second->parts_.end()) {
-            return partIt->second->isLeader();
-        } else {
-            return false;
-        }
+    auto ret = part(spaceId, partId);
+    if (!ok(ret)) {
+        return false;
     }
-    return false;
+    return nebula::value(ret)->isLeader();
 }
 
 ErrorOr<ResultCode, KVEngine*> NebulaStore::engine(GraphSpaceID spaceId, PartitionID partId) {
-    folly::RWSpinLock::ReadHolder rh(&lock_);
-    auto it = spaces_.find(spaceId);
-    if (UNLIKELY(it == spaces_.end())) {
-        return ResultCode::ERR_SPACE_NOT_FOUND;
-    }
-    auto& parts = it->second->parts_;
-    auto partIt = parts.find(partId);
-    if (UNLIKELY(partIt == parts.end())) {
-        return ResultCode::ERR_PART_NOT_FOUND;
+    auto ret = part(spaceId, partId);
+    if (!ok(ret)) {
+        return error(ret);
     }
-    return partIt->second->engine();
+    return nebula::value(ret)->engine();
 }
 
 ErrorOr<ResultCode, std::shared_ptr<SpacePartInfo>> NebulaStore::space(GraphSpaceID spaceId) {
@@ -794,25 +1816,71 @@ ErrorOr<ResultCode, std::shared_ptr<SpacePartInfo>> NebulaStore::space(GraphSpac
     return it->second;
 }
 
+void NebulaStore::onLeadershipChanged(GraphSpaceID spaceId, PartitionID partId, bool isLeader) {
+    if (isLeader) {
+        // The callback runs on a background worker, so the part may
+        // have been removed since it won the election; never resurrect
+        // an entry for a part the table no longer holds
+        auto table = partTable_.load();
+        auto spaceIt = table->find(spaceId);
+        if (spaceIt == table->end() ||
+            spaceIt->second.find(partId) == spaceIt->second.end()) {
+            return;
+        }
+    }
+    folly::RWSpinLock::WriteHolder wh(&leaderLock_);
+    if (isLeader) {
+        if (!leaderParts_[spaceId].emplace(partId).second) {
+            return;
+        }
+    } else {
+        auto it = leaderParts_.find(spaceId);
+        if (it == leaderParts_.end() || it->second.erase(partId) == 0) {
+            return;
+        }
+        if (it->second.empty()) {
+            leaderParts_.erase(it);
+        }
+    }
+    ++leaderEpoch_;
+}
+
 int32_t NebulaStore::allLeader(std::unordered_map<GraphSpaceID,
                                                   std::vector<PartitionID>>& leaderIds) {
-    folly::RWSpinLock::ReadHolder rh(&lock_);
-    int32_t count = 0;
-    for (const auto& spaceIt : spaces_) {
-        auto spaceId = spaceIt.first;
-        for (const auto& partIt : spaceIt.second->parts_) {
-            auto partId = partIt.first;
-            if (partIt.second->isLeader()) {
-                leaderIds[spaceId].emplace_back(partId);
-                ++count;
-            }
+    {
+        folly::RWSpinLock::ReadHolder rh(&leaderLock_);
+        if (leaderSnapshotEpoch_ == leaderEpoch_) {
+            leaderIds = leaderSnapshot_;
+            return leaderSnapshotCount_;
+        }
+    }
+    folly::RWSpinLock::WriteHolder wh(&leaderLock_);
+    if (leaderSnapshotEpoch_ != leaderEpoch_) {
+        // Reassemble only after a leadership change; on a stable term
+        // every heartbeat reuses the snapshot above
+        leaderSnapshot_.clear();
+        leaderSnapshotCount_ = 0;
+        for (const auto& spaceIt : leaderParts_) {
+            auto& parts = leaderSnapshot_[spaceIt.first];
+            parts.insert(parts.end(), spaceIt.second.begin(), spaceIt.second.end());
+            leaderSnapshotCount_ += spaceIt.second.size();
         }
+        leaderSnapshotEpoch_ = leaderEpoch_;
     }
-    return count;
+    leaderIds = leaderSnapshot_;
+    return leaderSnapshotCount_;
 }
 
-bool NebulaStore::checkLeader(std::shared_ptr<Part> part) const {
-    return !FLAGS_check_leader || (part->isLeader() && part->leaseValid());
+bool NebulaStore::checkLeader(std::shared_ptr<Part> part, bool canReadFromFollower) const {
+    if (!FLAGS_check_leader) {
+        return true;
+    }
+    if (canReadFromFollower && part->syncedWithLeader()) {
+        // Stale-tolerant read served by a replica which recently
+        // heard from the leader
+        return true;
+    }
+    return part->canReadUnderLease();
 }
 
 
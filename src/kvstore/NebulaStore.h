@@ -11,6 +11,8 @@
 #include "common/interface/gen-cpp2/RaftexServiceAsyncClient.h"
 #include <gtest/gtest_prod.h>
 #include <folly/RWSpinLock.h>
+#include <folly/concurrency/AtomicSharedPtr.h>
+#include "common/thread/GenericWorker.h"
 #include "kvstore/raftex/RaftexService.h"
 #include "kvstore/KVStore.h"
 #include "kvstore/PartManager.h"
@@ -32,9 +34,49 @@ struct SpacePartInfo {
     std::vector<std::unique_ptr<KVEngine>> engines_;
 };
 
+// Snapshot of one engine's internals for the web service
+struct EngineStatus {
+    GraphSpaceID                                    spaceId;
+    std::string                                     path;
+    // property name -> value, for the properties asked for that the
+    // engine knows
+    std::unordered_map<std::string, std::string>    properties;
+    // ticker name -> value, empty unless --enable_rocksdb_statistics
+    std::unordered_map<std::string, int64_t>        statistics;
+};
+
+// The pinned versions of every engine of one space. Released on
+// destruction, so the handle must not outlive the space's engines
+class NebulaSnapshot : public SpaceSnapshot {
+public:
+    ~NebulaSnapshot() override {
+        for (auto& snap : snapshots_) {
+            snap.first->releaseSnapshot(snap.second);
+        }
+    }
+
+    // The engine-native snapshot pinned on the given engine, nullptr
+    // when the engine is not part of this snapshot
+    const void* engineSnapshot(KVEngine* engine) const {
+        for (auto& snap : snapshots_) {
+            if (snap.first == engine) {
+                return snap.second;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    friend class NebulaStore;
+    std::vector<std::pair<KVEngine*, const void*>> snapshots_;
+};
+
 class NebulaStore : public KVStore, public Handler {
     FRIEND_TEST(NebulaStoreTest, SimpleTest);
     FRIEND_TEST(NebulaStoreTest, PartsTest);
+    FRIEND_TEST(NebulaStoreTest, RebalanceEnginePartsTest);
+    FRIEND_TEST(NebulaStoreTest, SetOptionBatchTest);
+    FRIEND_TEST(NebulaStoreTest, MigratePartTest);
     FRIEND_TEST(NebulaStoreTest, ThreeCopiesTest);
     FRIEND_TEST(NebulaStoreTest, TransLeaderTest);
     FRIEND_TEST(NebulaStoreTest, CheckpointTest);
@@ -102,52 +144,100 @@ public:
     ResultCode get(GraphSpaceID spaceId,
                    PartitionID  partId,
                    const std::string& key,
-                   std::string* value) override;
+                   std::string* value,
+                   bool canReadFromFollower = false) override;
+
+    ResultCode getLatest(GraphSpaceID spaceId,
+                         PartitionID partId,
+                         const std::string& keyPrefix,
+                         std::string* value,
+                         bool canReadFromFollower = false,
+                         const SpaceSnapshot* snapshot = nullptr) override;
+
+    bool maybeExists(GraphSpaceID spaceId,
+                     PartitionID partId,
+                     const std::string& keyNoVersion) override;
 
     std::pair<ResultCode, std::vector<Status>>
     multiGet(GraphSpaceID spaceId,
              PartitionID partId,
              const std::vector<std::string>& keys,
-             std::vector<std::string>* values) override;
+             std::vector<std::string>* values,
+             bool canReadFromFollower = false) override;
+
+    // Runs the read on the IO thread pool, so a cold read keeps the
+    // calling thread free while it waits on disk
+    folly::Future<ErrorOr<ResultCode, std::string>>
+    asyncGet(GraphSpaceID spaceId,
+             PartitionID partId,
+             std::string key,
+             bool canReadFromFollower = false) override;
+
+    // Fans the per-part reads out over the IO thread pool, so point
+    // reads spanning many parts do not pay sequential per-part latency
+    folly::Future<std::vector<PartMultiGetResult>>
+    asyncMultiGet(GraphSpaceID spaceId,
+                  std::vector<std::pair<PartitionID, std::vector<std::string>>> keysOfPart,
+                  bool canReadFromFollower = false) override;
+
+    std::unique_ptr<SpaceSnapshot> beginSnapshot(GraphSpaceID spaceId) override;
 
     // Get all results in range [start, end)
     ResultCode range(GraphSpaceID spaceId,
                      PartitionID  partId,
                      const std::string& start,
                      const std::string& end,
-                     std::unique_ptr<KVIterator>* iter) override;
+                     std::unique_ptr<KVIterator>* iter,
+                     bool canReadFromFollower = false,
+                     ScanHint hint = ScanHint::DEFAULT,
+                     const SpaceSnapshot* snapshot = nullptr) override;
     // Delete the overloading with a rvalue `start' and `end'
     ResultCode range(GraphSpaceID spaceId,
                      PartitionID  partId,
                      std::string&& start,
                      std::string&& end,
-                     std::unique_ptr<KVIterator>* iter) override = delete;
+                     std::unique_ptr<KVIterator>* iter,
+                     bool canReadFromFollower = false,
+                     ScanHint hint = ScanHint::DEFAULT,
+                     const SpaceSnapshot* snapshot = nullptr) override = delete;
 
     // Get all results with prefix.
     ResultCode prefix(GraphSpaceID spaceId,
                       PartitionID  partId,
                       const std::string& prefix,
-                      std::unique_ptr<KVIterator>* iter) override;
+                      std::unique_ptr<KVIterator>* iter,
+                      bool canReadFromFollower = false,
+                      ScanHint hint = ScanHint::DEFAULT,
+                      const SpaceSnapshot* snapshot = nullptr) override;
 
     // Delete the overloading with a rvalue `prefix'
     ResultCode prefix(GraphSpaceID spaceId,
                       PartitionID  partId,
                       std::string&& prefix,
-                      std::unique_ptr<KVIterator>* iter) override = delete;
+                      std::unique_ptr<KVIterator>* iter,
+                      bool canReadFromFollower = false,
+                      ScanHint hint = ScanHint::DEFAULT,
+                      const SpaceSnapshot* snapshot = nullptr) override = delete;
 
     // Get all results with prefix starting from start
     ResultCode rangeWithPrefix(GraphSpaceID spaceId,
                                PartitionID  partId,
                                const std::string& start,
                                const std::string& prefix,
-                               std::unique_ptr<KVIterator>* iter) override;
+                               std::unique_ptr<KVIterator>* iter,
+                               bool canReadFromFollower = false,
+                               ScanHint hint = ScanHint::DEFAULT,
+                               const SpaceSnapshot* snapshot = nullptr) override;
 
     // Delete the overloading with a rvalue `prefix'
     ResultCode rangeWithPrefix(GraphSpaceID spaceId,
                                PartitionID  partId,
                                std::string&& start,
                                std::string&& prefix,
-                               std::unique_ptr<KVIterator>* iter) override = delete;
+                               std::unique_ptr<KVIterator>* iter,
+                               bool canReadFromFollower = false,
+                               ScanHint hint = ScanHint::DEFAULT,
+                               const SpaceSnapshot* snapshot = nullptr) override = delete;
 
     ResultCode sync(GraphSpaceID spaceId,
                     PartitionID partId) override;
@@ -158,6 +248,17 @@ public:
                        std::vector<KV> keyValues,
                        KVCallback cb) override;
 
+    void asyncMerge(GraphSpaceID spaceId,
+                    PartitionID partId,
+                    const std::string& key,
+                    const std::string& value,
+                    KVCallback cb) override;
+
+    void asyncAppendBatch(GraphSpaceID spaceId,
+                          PartitionID partId,
+                          std::string batch,
+                          KVCallback cb) override;
+
     void asyncRemove(GraphSpaceID spaceId,
                      PartitionID partId,
                      const std::string& key,
@@ -174,6 +275,11 @@ public:
                           const std::string& end,
                           KVCallback cb) override;
 
+    void asyncMultiRemoveRange(GraphSpaceID spaceId,
+                               PartitionID partId,
+                               std::vector<KV> ranges,
+                               KVCallback cb) override;
+
     void asyncAtomicOp(GraphSpaceID spaceId,
                        PartitionID partId,
                        raftex::AtomicOp op,
@@ -182,7 +288,29 @@ public:
     ErrorOr<ResultCode, std::shared_ptr<Part>> part(GraphSpaceID spaceId,
                                                     PartitionID partId) override;
 
-    ResultCode ingest(GraphSpaceID spaceId) override;
+    // The session token for read-your-writes: the (logId, term) the
+    // local replica of the part has applied. Sampled after a successful
+    // write it covers that write, raft applies in order
+    ErrorOr<ResultCode, std::pair<LogID, TermID>> commitToken(GraphSpaceID spaceId,
+                                                              PartitionID partId);
+
+    // Block until the local replica of the part has applied logId, so a
+    // read presenting a session token sees the writes behind it even on
+    // a follower or a just-elected leader. ERR_CONSENSUS_ERROR when the
+    // replica did not catch up within timeoutMs
+    ResultCode waitCommitted(GraphSpaceID spaceId,
+                             PartitionID partId,
+                             LogID logId,
+                             int64_t timeoutMs);
+
+    ResultCode ingest(GraphSpaceID spaceId,
+                      bool verifyChecksum = false,
+                      bool prewarm = false,
+                      bool buildIndex = false) override;
+
+    ResultCode writeBulkSst(GraphSpaceID spaceId,
+                            PartitionID partId,
+                            const std::vector<KV>& sortedData) override;
 
     ResultCode setOption(GraphSpaceID spaceId,
                          const std::string& configKey,
@@ -192,8 +320,23 @@ public:
                            const std::string& configKey,
                            const std::string& configValue);
 
+    // Apply a bundle of options to every engine of the space, all or
+    // nothing: when any engine rejects a key, the keys already applied
+    // are rolled back to their previous values on every engine touched.
+    // With --option_update_dry_run it only logs what would change
+    ResultCode setOptionBatch(GraphSpaceID spaceId,
+                              const std::unordered_map<std::string, std::string>& options,
+                              bool isDbOption);
+
     ResultCode compact(GraphSpaceID spaceId) override;
 
+    // Collect the given engine properties and the statistics tickers
+    // of every engine, one entry per (space, engine path)
+    std::vector<EngineStatus> engineStatus(const std::vector<std::string>& properties);
+
+    // Adjust the background write rate limit of every engine, in MB/s
+    void setEngineRateLimit(int32_t mbps);
+
     ResultCode flush(GraphSpaceID spaceId) override;
 
     ResultCode createCheckpoint(GraphSpaceID spaceId, const std::string& name) override;
@@ -202,8 +345,29 @@ public:
 
     ResultCode setWriteBlocking(GraphSpaceID spaceId, bool sign) override;
 
+    // Live intra-host migration of one part onto the engine rooted
+    // under dataPath. The bulk is copied while the part keeps serving
+    // writes; the switch itself stops the part briefly and restarts it
+    // on the target engine, where raft replays the tail it missed
+    ResultCode migratePart(GraphSpaceID spaceId,
+                           PartitionID partId,
+                           const std::string& dataPath) override;
+
+    std::string snapshotScheduleStatus() override {
+        return snapshot_->scheduleStatus();
+    }
+
+    std::string cardinalityStatus(GraphSpaceID spaceId) override;
+
     bool isLeader(GraphSpaceID spaceId, PartitionID partId);
 
+    // True once every part found on disk by init() has been opened. The
+    // store serves the parts that are ready while this is still false
+    bool diskLoadFinished() {
+        folly::RWSpinLock::ReadHolder rh(&lock_);
+        return loadingParts_.empty();
+    }
+
     ErrorOr<ResultCode, std::shared_ptr<SpacePartInfo>> space(GraphSpaceID spaceId);
 
     /**
@@ -227,22 +391,156 @@ private:
 
     std::unique_ptr<KVEngine> newEngine(GraphSpaceID spaceId, const std::string& path);
 
+    // The engines of every space with the parts each one holds,
+    // collected while the data paths are scanned on start
+    using SpaceEngineParts =
+        std::unordered_map<GraphSpaceID,
+                           std::vector<std::pair<KVEngine*, std::vector<PartitionID>>>>;
+
+    // Scan one data path: open every engine found under it, prune the
+    // parts meta no longer knows, and collect the rest into spaceEngines
+    // under enginesLock. Each path is one disk, so init() runs this once
+    // per path in parallel. Returns false on an invalid directory name
+    bool scanDataPath(const std::string& path,
+                      SpaceEngineParts& spaceEngines,
+                      std::mutex& enginesLock);
+
+    // Run the job once per engine of the space, at most
+    // FLAGS_engine_job_concurrency engines at a time (each engine is
+    // one disk). Returns the code of the last failed job, if any
+    ResultCode runEngineJobs(const std::shared_ptr<SpacePartInfo>& space,
+                             const std::function<ResultCode(KVEngine*)>& job);
+
     std::shared_ptr<Part> newPart(GraphSpaceID spaceId,
                                   PartitionID partId,
                                   KVEngine* engine,
                                   bool asLearner);
 
+    // Open one part found on disk during init() and publish it into the
+    // part table, clearing its loadingParts_ mark. Runs on the loader
+    // threads behind init()
+    void loadPartFromDisk(GraphSpaceID spaceId, PartitionID partId, KVEngine* engine);
+
+    // Even out the parts of one space across its engines by moving part
+    // data locally between disks. Only safe before the parts are opened,
+    // so it runs on start when --rebalance_engine_parts is set
+    void equalizeSpaceEngines(
+        GraphSpaceID spaceId,
+        std::vector<std::pair<KVEngine*, std::vector<PartitionID>>>& engines);
+
+    // Copy all the data the part holds from one engine of this host to
+    // another, including its system commit key
+    bool movePartData(GraphSpaceID spaceId,
+                      PartitionID partId,
+                      KVEngine* from,
+                      KVEngine* to);
+
+    // Copy one key-type range of the part between two engines of this
+    // host, in batches
+    bool copyPartRange(PartitionID partId,
+                       NebulaKeyType type,
+                       KVEngine* from,
+                       KVEngine* to);
+
+    // The WAL directory for the given part: beside the data under the
+    // engine's data root by default, or on the dedicated wal device
+    // when KVOptions::walPath_ is set
+    std::string walPath(GraphSpaceID spaceId,
+                        PartitionID partId,
+                        KVEngine* engine) const;
+
     ErrorOr<ResultCode, KVEngine*> engine(GraphSpaceID spaceId, PartitionID partId);
 
-    bool checkLeader(std::shared_ptr<Part> part) const;
+    bool checkLeader(std::shared_ptr<Part> part, bool canReadFromFollower = false) const;
+
+    // Rebuild the immutable part lookup table from spaces_ and swap it
+    // in. Must be called with lock_ held for writing
+    void publishPartTable();
+
+    // part(), gated on the health of the engine behind it: a part on a
+    // FAILED engine is rejected outright and one on a DEGRADED engine
+    // sheds --engine_degraded_shed_pct percent of its load, both with
+    // ERR_PART_NOT_FOUND so the graph layer retries another replica
+    // instead of waiting out an engine timeout. The data paths resolve
+    // parts through this; routing and admin lookups keep plain part()
+    ErrorOr<ResultCode, std::shared_ptr<Part>> partIfServing(GraphSpaceID spaceId,
+                                                             PartitionID partId);
+
+    // partIfServing(), additionally gated on the stall proximity of the
+    // engine behind the part: at or above --write_stall_reject_pct the
+    // write is rejected with ERR_WRITE_STALL, so clients back off before
+    // rocksdb blocks the write threads. The write paths resolve parts
+    // through this; reads stay on partIfServing
+    ErrorOr<ResultCode, std::shared_ptr<Part>> partIfWritable(GraphSpaceID spaceId,
+                                                              PartitionID partId);
+
+    // One timed probe read per engine, feeding the health state
+    void probeEngineHealth();
+
+    // One timed memtable flush per engine. With --rocksdb_disable_wal
+    // the flush is what makes the applied raft logs and the commit key
+    // they carry recoverable, so this bounds the wal tail a restart
+    // replays. Runs on flushThread_ every --apply_flush_interval_secs
+    void flushApplyState();
+
+    // Persist every engine's hot-key profile for the block cache
+    // warmup. Runs on warmupThread_ every
+    // --block_cache_warmup_interval_secs
+    void saveWarmupProfiles();
+
+    // Pre-connect the raft client of every io eventbase to every
+    // remote peer we share a part with, so an elected leader starts
+    // replicating over connections that already exist. Runs once on
+    // start and then on raftClientThread_ every
+    // --raft_client_warmup_interval_secs
+    void warmupRaftClients();
+
+    // Record one leadership change published by a part at
+    // onElected/onLostLeadership, bumping leaderEpoch_ so the next
+    // allLeader() rebuilds its snapshot
+    void onLeadershipChanged(GraphSpaceID spaceId, PartitionID partId, bool isLeader);
 
 private:
+    // The space -> part -> Part resolution every request does, as an
+    // immutable snapshot swapped out whole on membership changes, so
+    // readers chase pointers without touching lock_. A space it holds
+    // may have no part yet, that keeps the space-not-found and
+    // part-not-found answers apart
+    using PartTable =
+        std::unordered_map<GraphSpaceID,
+                           std::unordered_map<PartitionID, std::shared_ptr<Part>>>;
+
     // The lock used to protect spaces_
     folly::RWSpinLock lock_;
     std::unordered_map<GraphSpaceID, std::shared_ptr<SpacePartInfo>> spaces_;
+    folly::atomic_shared_ptr<const PartTable> partTable_{std::make_shared<const PartTable>()};
+    // The parts found on disk in init() that their loader threads have
+    // not opened yet, grouped by space. addPart() skips these so the meta
+    // reconciliation does not rebuild a part that is still replaying, and
+    // removePart() drops a mark to hand the removal over to the loader.
+    // Protected by lock_
+    std::unordered_map<GraphSpaceID, std::unordered_set<PartitionID>> loadingParts_;
+
+    // The parts this store currently leads, maintained incrementally by
+    // onLeadershipChanged() so the heartbeat does not walk every part.
+    // The epoch counts changes; allLeader() reuses its last assembled
+    // snapshot while the epoch stands still. All behind leaderLock_
+    folly::RWSpinLock leaderLock_;
+    std::unordered_map<GraphSpaceID, std::unordered_set<PartitionID>> leaderParts_;
+    uint64_t leaderEpoch_{0};
+    std::unordered_map<GraphSpaceID, std::vector<PartitionID>> leaderSnapshot_;
+    uint64_t leaderSnapshotEpoch_{0};
+    int32_t leaderSnapshotCount_{0};
 
     std::shared_ptr<folly::IOThreadPoolExecutor> ioPool_;
     std::shared_ptr<thread::GenericThreadPool> bgWorkers_;
+    std::unique_ptr<thread::GenericWorker> healthThread_;
+    std::unique_ptr<thread::GenericWorker> flushThread_;
+    std::unique_ptr<thread::GenericWorker> warmupThread_;
+    std::unique_ptr<thread::GenericWorker> raftClientThread_;
+    // Supervises the per-disk loader threads started by init(); joined
+    // on destruction
+    std::thread partLoadThread_;
     HostAddr storeSvcAddr_;
     std::shared_ptr<folly::Executor> workers_;
     HostAddr raftAddr_;
@@ -8,9 +8,31 @@
 #include "kvstore/LogEncoder.h"
 #include "kvstore/RocksEngineConfig.h"
 #include "utils/NebulaKeyUtils.h"
+#include "utils/RequestTrace.h"
 
 DEFINE_int32(cluster_id, 0, "A unique id for each cluster");
 
+DEFINE_bool(enable_part_existence_filter, false,
+            "Maintain an in-memory counting Bloom filter per part over the "
+            "version-stripped data keys, so point existence probes of keys "
+            "that do not exist skip the engine read");
+
+DEFINE_int32(existence_filter_mb, 8,
+             "Counter memory of each part's existence filter, in MB");
+
+DEFINE_bool(snapshot_receive_dedup, false,
+            "While receiving a snapshot, skip re-writing rows the local "
+            "engine already holds with an identical value. A replica "
+            "rejoining after maintenance keeps almost all of its data "
+            "through cleanup(), so the rebuild degrades into a sequential "
+            "compare instead of a full rewrite");
+
+DEFINE_int32(mutate_dedup_window, 0,
+             "Number of recently committed dedup batch ids each part "
+             "remembers; a batch whose id repeats inside the window is "
+             "acked without being re-applied, so graph-layer retries do "
+             "not double-write. 0 disables the window");
+
 namespace nebula {
 namespace kvstore {
 
@@ -40,6 +62,57 @@ Part::Part(GraphSpaceID spaceId,
         , partId_(partId)
         , walPath_(walPath)
         , engine_(engine) {
+    if (FLAGS_enable_part_existence_filter) {
+        loadExistenceFilter();
+    }
+}
+
+void Part::loadExistenceFilter() {
+    auto numCounters = static_cast<size_t>(FLAGS_existence_filter_mb) << 20;
+    auto filterKey = NebulaKeyUtils::systemExistenceFilterKey(partId_);
+    std::string image;
+    if (engine_->get(filterKey, &image) == ResultCode::SUCCEEDED) {
+        existenceFilter_ = ExistenceFilter::decode(image, numCounters,
+                                                   lastCommittedLogId().first);
+        // The image goes stale with the first commit; drop it now and
+        // cut a fresh one on the next clean shutdown
+        engine_->remove(filterKey);
+        if (existenceFilter_ != nullptr) {
+            LOG(INFO) << idStr_ << "Existence filter restored from its checkpoint image";
+            return;
+        }
+    }
+    // First start, or the last shutdown was not clean: rebuild from data
+    existenceFilter_ = std::make_unique<ExistenceFilter>(numCounters);
+    auto prefix = NebulaKeyUtils::partPrefix(partId_);
+    std::unique_ptr<KVIterator> iter;
+    auto ret = engine_->prefix(prefix, &iter);
+    if (ret != ResultCode::SUCCEEDED) {
+        LOG(ERROR) << idStr_ << "Failed to rebuild the existence filter, error "
+                   << static_cast<int32_t>(ret);
+        existenceFilter_.reset();
+        return;
+    }
+    int64_t numKeys = 0;
+    while (iter->valid()) {
+        existenceFilter_->insert(NebulaKeyUtils::keyWithNoVersion(iter->key()));
+        ++numKeys;
+        iter->next();
+    }
+    LOG(INFO) << idStr_ << "Existence filter rebuilt from " << numKeys << " keys";
+}
+
+void Part::saveExistenceFilter() {
+    if (existenceFilter_ == nullptr) {
+        return;
+    }
+    auto image = existenceFilter_->encode(lastCommittedLogId().first);
+    auto ret = engine_->put(NebulaKeyUtils::systemExistenceFilterKey(partId_),
+                            std::move(image));
+    if (ret != ResultCode::SUCCEEDED) {
+        LOG(WARNING) << idStr_ << "Failed to checkpoint the existence filter, error "
+                     << static_cast<int32_t>(ret);
+    }
 }
 
 
@@ -71,11 +144,45 @@ void Part::asyncPut(folly::StringPiece key, folly::StringPiece value, KVCallback
 }
 
 
+void Part::asyncMerge(folly::StringPiece key, folly::StringPiece value, KVCallback cb) {
+    std::string log = encodeMultiValues(OP_MERGE, key, value);
+
+    appendAsync(FLAGS_cluster_id, std::move(log))
+        .thenValue([this, callback = std::move(cb)] (AppendLogResult res) mutable {
+            callback(this->toResultCode(res));
+        });
+}
+
+
+void Part::asyncAppendBatch(std::string&& batch, KVCallback cb) {
+    // spans the whole raft round: wal write, replication and commit
+    auto appendStartUs = time::WallClock::fastNowInMicroSec();
+    appendAsync(FLAGS_cluster_id, std::move(batch))
+        .thenValue([this, appendStartUs, callback = std::move(cb)]
+                   (AppendLogResult res) mutable {
+            if (UNLIKELY(FLAGS_trace_request_every_n > 0)) {
+                RequestTrace::record(
+                        "raft_append",
+                        time::WallClock::fastNowInMicroSec() - appendStartUs);
+            }
+            callback(this->toResultCode(res));
+        });
+}
+
+
 void Part::asyncMultiPut(const std::vector<KV>& keyValues, KVCallback cb) {
     std::string log = encodeMultiValues(OP_MULTI_PUT, keyValues);
 
+    // spans the whole raft round: wal write, replication and commit
+    auto appendStartUs = time::WallClock::fastNowInMicroSec();
     appendAsync(FLAGS_cluster_id, std::move(log))
-        .thenValue([this, callback = std::move(cb)] (AppendLogResult res) mutable {
+        .thenValue([this, appendStartUs, callback = std::move(cb)]
+                   (AppendLogResult res) mutable {
+            if (UNLIKELY(FLAGS_trace_request_every_n > 0)) {
+                RequestTrace::record(
+                        "raft_append",
+                        time::WallClock::fastNowInMicroSec() - appendStartUs);
+            }
             callback(this->toResultCode(res));
         });
 }
@@ -112,6 +219,15 @@ void Part::asyncRemoveRange(folly::StringPiece start,
         });
 }
 
+void Part::asyncMultiRemoveRange(const std::vector<KV>& ranges, KVCallback cb) {
+    std::string log = encodeMultiValues(OP_REMOVE_RANGE, ranges);
+
+    appendAsync(FLAGS_cluster_id, std::move(log))
+        .thenValue([this, callback = std::move(cb)] (AppendLogResult res) mutable {
+            callback(this->toResultCode(res));
+        });
+}
+
 void Part::sync(KVCallback cb) {
     sendCommandAsync("")
         .thenValue([this, callback = std::move(cb)] (AppendLogResult res) mutable {
@@ -173,11 +289,17 @@ void Part::setBlocking(bool sign) {
 
 void Part::onLostLeadership(TermID term) {
     VLOG(1) << "Lost the leadership for the term " << term;
+    if (leadershipChangedFn_ != nullptr) {
+        leadershipChangedFn_(spaceId_, partId_, false);
+    }
 }
 
 
 void Part::onElected(TermID term) {
     VLOG(1) << "Being elected as the leader for the term " << term;
+    if (leadershipChangedFn_ != nullptr) {
+        leadershipChangedFn_(spaceId_, partId_, true);
+    }
 }
 
 void Part::onDiscoverNewLeader(HostAddr nLeader) {
@@ -200,12 +322,13 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
             ++(*iter);
             continue;
         }
-        DCHECK_GE(log.size(), sizeof(int64_t) + 1 + sizeof(uint32_t));
+        DCHECK_GE(log.size(), sizeof(int64_t) + 2);
         // Skip the timestamp (type of int64_t)
-        switch (log[sizeof(int64_t)]) {
+        switch (logType(log)) {
         case OP_PUT: {
             auto pieces = decodeMultiValues(log);
             DCHECK_EQ(2, pieces.size());
+            notifyCommitted(pieces[0]);
             if (batch->put(pieces[0], pieces[1]) != ResultCode::SUCCEEDED) {
                 LOG(ERROR) << idStr_ << "Failed to call WriteBatch::put()";
                 return false;
@@ -217,6 +340,7 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
             // Make the number of values are an even number
             DCHECK_EQ((kvs.size() + 1) / 2, kvs.size() / 2);
             for (size_t i = 0; i < kvs.size(); i += 2) {
+                notifyCommitted(kvs[i]);
                 if (batch->put(kvs[i], kvs[i + 1]) != ResultCode::SUCCEEDED) {
                     LOG(ERROR) << idStr_ << "Failed to call WriteBatch::put()";
                     return false;
@@ -224,8 +348,19 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
             }
             break;
         }
+        case OP_MERGE: {
+            auto pieces = decodeMultiValues(log);
+            DCHECK_EQ(2, pieces.size());
+            notifyCommitted(pieces[0]);
+            if (batch->merge(pieces[0], pieces[1]) != ResultCode::SUCCEEDED) {
+                LOG(ERROR) << idStr_ << "Failed to call WriteBatch::merge()";
+                return false;
+            }
+            break;
+        }
         case OP_REMOVE: {
             auto key = decodeSingleValue(log);
+            notifyCommitted(key, true);
             if (batch->remove(key) != ResultCode::SUCCEEDED) {
                 LOG(ERROR) << idStr_ << "Failed to call WriteBatch::remove()";
                 return false;
@@ -235,6 +370,7 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
         case OP_MULTI_REMOVE: {
             auto keys = decodeMultiValues(log);
             for (auto k : keys) {
+                notifyCommitted(k, true);
                 if (batch->remove(k) != ResultCode::SUCCEEDED) {
                     LOG(ERROR) << idStr_ << "Failed to call WriteBatch::remove()";
                     return false;
@@ -243,11 +379,13 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
             break;
         }
         case OP_REMOVE_RANGE: {
-            auto range = decodeMultiValues(log);
-            DCHECK_EQ(2, range.size());
-            if (batch->removeRange(range[0], range[1]) != ResultCode::SUCCEEDED) {
-                LOG(ERROR) << idStr_ << "Failed to call WriteBatch::removeRange()";
-                return false;
+            auto ranges = decodeMultiValues(log);
+            DCHECK_EQ(0, ranges.size() % 2);
+            for (size_t i = 0; i < ranges.size(); i += 2) {
+                if (batch->removeRange(ranges[i], ranges[i + 1]) != ResultCode::SUCCEEDED) {
+                    LOG(ERROR) << idStr_ << "Failed to call WriteBatch::removeRange()";
+                    return false;
+                }
             }
             break;
         }
@@ -256,11 +394,41 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
             for (auto& op : data) {
                 ResultCode code = ResultCode::SUCCEEDED;
                 if (op.first == BatchLogType::OP_BATCH_PUT) {
+                    notifyCommitted(op.second.first);
+                    code = batch->put(op.second.first, op.second.second);
+                } else if (op.first == BatchLogType::OP_BATCH_REMOVE) {
+                    notifyCommitted(op.second.first, true);
+                    code = batch->remove(op.second.first);
+                } else if (op.first == BatchLogType::OP_BATCH_REMOVE_RANGE) {
+                    code = batch->removeRange(op.second.first, op.second.second);
+                } else if (op.first == BatchLogType::OP_BATCH_MERGE) {
+                    code = batch->merge(op.second.first, op.second.second);
+                }
+                if (code != ResultCode::SUCCEEDED) {
+                    LOG(ERROR) << idStr_ << "Failed to call WriteBatch";
+                    return false;
+                }
+            }
+            break;
+        }
+        case OP_DEDUP_BATCH: {
+            auto data = decodeDedupBatch(log);
+            if (isDuplicateBatch(data.first)) {
+                VLOG(1) << idStr_ << "Skip duplicate batch " << data.first;
+                break;
+            }
+            for (auto& op : data.second) {
+                ResultCode code = ResultCode::SUCCEEDED;
+                if (op.first == BatchLogType::OP_BATCH_PUT) {
+                    notifyCommitted(op.second.first);
                     code = batch->put(op.second.first, op.second.second);
                 } else if (op.first == BatchLogType::OP_BATCH_REMOVE) {
+                    notifyCommitted(op.second.first, true);
                     code = batch->remove(op.second.first);
                 } else if (op.first == BatchLogType::OP_BATCH_REMOVE_RANGE) {
                     code = batch->removeRange(op.second.first, op.second.second);
+                } else if (op.first == BatchLogType::OP_BATCH_MERGE) {
+                    code = batch->merge(op.second.first, op.second.second);
                 }
                 if (code != ResultCode::SUCCEEDED) {
                     LOG(ERROR) << idStr_ << "Failed to call WriteBatch";
@@ -311,6 +479,24 @@ bool Part::commitLogs(std::unique_ptr<LogIterator> iter) {
                     == ResultCode::SUCCEEDED;
 }
 
+bool Part::isDuplicateBatch(uint64_t dedupId) {
+    if (FLAGS_mutate_dedup_window <= 0) {
+        return false;
+    }
+    if (dedupSeen_.count(dedupId) != 0) {
+        return true;
+    }
+    if (dedupRing_.size() < static_cast<size_t>(FLAGS_mutate_dedup_window)) {
+        dedupRing_.emplace_back(dedupId);
+    } else {
+        dedupSeen_.erase(dedupRing_[dedupRingPos_]);
+        dedupRing_[dedupRingPos_] = dedupId;
+        dedupRingPos_ = (dedupRingPos_ + 1) % dedupRing_.size();
+    }
+    dedupSeen_.emplace(dedupId);
+    return false;
+}
+
 std::pair<int64_t, int64_t> Part::commitSnapshot(const std::vector<std::string>& rows,
                                                  LogID committedLogId,
                                                  TermID committedLogTerm,
@@ -318,15 +504,56 @@ std::pair<int64_t, int64_t> Part::commitSnapshot(const std::vector<std::string>&
     auto batch = engine_->startBatchWrite();
     int64_t count = 0;
     int64_t size = 0;
+    // The rows of a stream arrive in key order per prefix run, so one
+    // forward engine iterator answers almost every dedup probe; it is
+    // reopened whenever the stream moves to the next run
+    std::unique_ptr<KVIterator> localIter;
+    std::string runPrefix;
+    auto rowUnchanged = [&] (const folly::StringPiece& key,
+                             const folly::StringPiece& value) -> bool {
+        auto prefix = key.subpiece(0, sizeof(PartitionID)).str();
+        if (localIter == nullptr || prefix != runPrefix) {
+            runPrefix = prefix;
+            localIter.reset();
+            if (ResultCode::SUCCEEDED != engine_->prefix(runPrefix, &localIter)) {
+                localIter.reset();
+                return false;
+            }
+        }
+        while (localIter != nullptr && localIter->valid() && localIter->key() < key) {
+            // a local key the snapshot does not carry; it stays, the
+            // same as it would without the dedup
+            localIter->next();
+        }
+        return localIter != nullptr && localIter->valid() &&
+               localIter->key() == key && localIter->val() == value;
+    };
+    int64_t reused = 0;
     for (auto& row : rows) {
         count++;
         size += row.size();
         auto kv = decodeKV(row);
+        if (FLAGS_snapshot_receive_dedup && rowUnchanged(kv.first, kv.second)) {
+            // the replica still holds this exact row, e.g. it rejoined
+            // after maintenance; writing it again would only feed the
+            // flush and compaction queues
+            reused++;
+            continue;
+        }
+        // Snapshot rows bypass commitLogs, so feed the existence
+        // filter here as well
+        if (existenceFilter_ != nullptr && NebulaKeyUtils::isDataKey(kv.first)) {
+            existenceFilter_->insert(NebulaKeyUtils::keyWithNoVersion(kv.first));
+        }
         if (ResultCode::SUCCEEDED != batch->put(kv.first, kv.second)) {
             LOG(ERROR) << idStr_ << "Put failed in commit";
             return std::make_pair(0, 0);
         }
     }
+    if (reused > 0) {
+        VLOG(1) << idStr_ << "Snapshot batch reused " << reused
+                << " of " << count << " rows already on disk";
+    }
     if (finished) {
         if (ResultCode::SUCCEEDED != putCommitMsg(batch.get(), committedLogId, committedLogTerm)) {
             LOG(ERROR) << idStr_ << "Put failed in commit";
@@ -8,9 +8,11 @@
 #define KVSTORE_PART_H_
 
 #include "common/base/Base.h"
+#include "common/time/WallClock.h"
 #include "utils/NebulaKeyUtils.h"
 #include "raftex/RaftPart.h"
 #include "kvstore/Common.h"
+#include "kvstore/ExistenceFilter.h"
 #include "kvstore/KVEngine.h"
 #include "kvstore/raftex/SnapshotManager.h"
 #include "kvstore/wal/FileBasedWal.h"
@@ -22,6 +24,9 @@ using RaftClient = thrift::ThriftClientManager<raftex::cpp2::RaftexServiceAsyncC
 
 class Part : public raftex::RaftPart {
     friend class SnapshotManager;
+    // The write-path benchmark (PartCommitBenchmark.cpp) feeds
+    // commitLogs directly, without a raft service in front of it
+    friend class PartCommitBench;
 public:
     Part(GraphSpaceID spaceId,
          PartitionID partId,
@@ -35,6 +40,7 @@ public:
          std::shared_ptr<RaftClient> clientMan);
 
     virtual ~Part() {
+        saveExistenceFilter();
         LOG(INFO) << idStr_ << "~Part()";
     }
 
@@ -42,7 +48,51 @@ public:
         return engine_;
     }
 
+    // Invoked for every key a committed log mutates (see
+    // KVOptions::committedKeyFn_)
+    using CommittedKeyFn = std::function<void(GraphSpaceID, PartitionID,
+                                              const folly::StringPiece&)>;
+
+    void setCommittedKeyFn(CommittedKeyFn fn) {
+        committedKeyFn_ = std::move(fn);
+    }
+
+    // Invoked on a background worker whenever the part gains (true) or
+    // loses (false) its leadership; set by NebulaStore::newPart to keep
+    // the leader table current without walking every part
+    using LeadershipChangedFn = std::function<void(GraphSpaceID, PartitionID, bool)>;
+
+    void setLeadershipChangedFn(LeadershipChangedFn fn) {
+        leadershipChangedFn_ = std::move(fn);
+    }
+
+    // True unless the part's existence filter can prove the key absent.
+    // `keyNoVersion` must be a version-stripped data key (a full vertex
+    // or edge key prefix); a plain `true` just means "go read the engine"
+    bool maybeExists(const folly::StringPiece& keyNoVersion) const {
+        return existenceFilter_ == nullptr || existenceFilter_->maybeExists(keyNoVersion);
+    }
+
+    // Hand out the next version timestamp of this part's hybrid
+    // logical clock: wall-clock microseconds, but never behind a
+    // version the part has already committed (see observeVersionTime).
+    // Versions minted from it stay in issue order within the part no
+    // matter how the clocks of the writing hosts compare
+    int64_t issueVersionTime() {
+        auto now = time::WallClock::fastNowInMicroSec();
+        auto last = hlcTime_.load(std::memory_order_relaxed);
+        int64_t next;
+        do {
+            next = std::max(now, last + 1);
+        } while (!hlcTime_.compare_exchange_weak(last, next, std::memory_order_relaxed));
+        return next;
+    }
+
     void asyncPut(folly::StringPiece key, folly::StringPiece value, KVCallback cb);
+
+    void asyncMerge(folly::StringPiece key, folly::StringPiece value, KVCallback cb);
+
+    void asyncAppendBatch(std::string&& batch, KVCallback cb);
     void asyncMultiPut(const std::vector<KV>& keyValues, KVCallback cb);
 
     void asyncRemove(folly::StringPiece key, KVCallback cb);
@@ -51,6 +101,10 @@ public:
                           folly::StringPiece end,
                           KVCallback cb);
 
+    // Each KV holds one [start, end) pair; all the ranges are removed
+    // in one log entry
+    void asyncMultiRemoveRange(const std::vector<KV>& ranges, KVCallback cb);
+
     void asyncAtomicOp(raftex::AtomicOp op, KVCallback cb);
 
     void asyncAddLearner(const HostAddr& learner, KVCallback cb);
@@ -109,6 +163,11 @@ private:
                                                TermID committedLogTerm,
                                                bool finished) override;
 
+    // The commit id rides in the same group-commit batch as the data it
+    // covers, so the engine never recovers data without the matching
+    // apply state. With --rocksdb_disable_wal both become durable at the
+    // next memtable flush; --apply_flush_interval_secs bounds how far
+    // that can trail
     ResultCode putCommitMsg(WriteBatch* batch, LogID committedLogId, TermID committedLogTerm);
 
     void cleanup() override {
@@ -128,12 +187,77 @@ private:
 
     ResultCode toResultCode(raftex::AppendLogResult res);
 
+    // True when the id already sits in the dedup window; otherwise
+    // records it, evicting the oldest remembered id once the window is
+    // full. Only called from commitLogs, which raft serializes, so the
+    // ring needs no locking
+    bool isDuplicateBatch(uint64_t dedupId);
+
 protected:
     GraphSpaceID spaceId_;
     PartitionID partId_;
     std::string walPath_;
     KVEngine* engine_ = nullptr;
     NewLeaderCallback newLeaderCb_ = nullptr;
+    CommittedKeyFn committedKeyFn_{nullptr};
+    LeadershipChangedFn leadershipChangedFn_{nullptr};
+    // Tracks which version-stripped data keys this part holds; see
+    // --enable_part_existence_filter
+    std::unique_ptr<ExistenceFilter> existenceFilter_;
+
+    // The hybrid logical clock behind issueVersionTime(): the max of
+    // the wall clock and every version timestamp committed on the part
+    std::atomic<int64_t> hlcTime_{0};
+
+    // The ids of recently committed dedup batches (see
+    // --mutate_dedup_window). The ring bounds the memory, the set makes
+    // the membership check O(1)
+    std::vector<uint64_t> dedupRing_;
+    size_t dedupRingPos_{0};
+    std::unordered_set<uint64_t> dedupSeen_;
+
+    // Run the committed-key hook and the existence filter update, if
+    // any, for one mutated key. Range removals bypass this, which only
+    // leaves the filter with extra false positives
+    void notifyCommitted(const folly::StringPiece& key, bool removal = false) {
+        if (key.size() > sizeof(PartitionID) + sizeof(int64_t)
+                && NebulaKeyUtils::isDataKey(key)) {
+            // Every version travels through the raft log, so ratcheting
+            // the clock here keeps it ahead of everything committed on
+            // leader and followers alike; a newly elected leader mints
+            // versions that sort after the old leader's
+            observeVersionTime(NebulaKeyUtils::getVersionTime(key));
+            if (existenceFilter_ != nullptr) {
+                auto stripped = NebulaKeyUtils::keyWithNoVersion(key);
+                if (removal) {
+                    existenceFilter_->remove(stripped);
+                } else {
+                    existenceFilter_->insert(stripped);
+                }
+            }
+        }
+        if (committedKeyFn_ != nullptr) {
+            committedKeyFn_(spaceId_, partId_, key);
+        }
+    }
+
+    // Move the hybrid logical clock forward to a committed version's
+    // timestamp; never backwards
+    void observeVersionTime(int64_t timeUs) {
+        auto last = hlcTime_.load(std::memory_order_relaxed);
+        while (timeUs > last
+                && !hlcTime_.compare_exchange_weak(last, timeUs, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Restore the filter from its checkpoint image, or rebuild it by
+    // scanning the part when the image is missing or stale
+    void loadExistenceFilter();
+
+    // Checkpoint the filter image so the next start skips the rebuild
+    // scan; the image carries the committed log id it was cut at and is
+    // ignored if any commit sneaks in after it
+    void saveExistenceFilter();
 };
 
 }  // namespace kvstore
@@ -7,11 +7,23 @@
 #include "common/base/Base.h"
 #include "common/fs/FileUtils.h"
 #include <folly/String.h>
+#include <fstream>
+#include <sstream>
 #include "kvstore/RocksEngine.h"
+#include <rocksdb/convenience.h>
+#include <rocksdb/sst_file_reader.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/statistics.h>
+#include "common/time/WallClock.h"
 #include "kvstore/KVStore.h"
+#include "kvstore/CardinalityCollector.h"
 #include "kvstore/RocksEngineConfig.h"
+#include "utils/RequestTrace.h"
 #include "utils/NebulaKeyUtils.h"
 
+DECLARE_bool(block_cache_warmup);
+DECLARE_int32(block_cache_warmup_sample_every_n);
+
 namespace nebula {
 namespace kvstore {
 
@@ -28,14 +40,47 @@ namespace {
 class RocksWriteBatch : public WriteBatch {
 private:
     rocksdb::WriteBatch batch_;
+    rocksdb::ColumnFamilyHandle* defaultCf_;
+    rocksdb::ColumnFamilyHandle* indexCf_;
+    rocksdb::ColumnFamilyHandle* inEdgeCf_;
+    int32_t vIdLen_;
+
+    // Mirrors RocksEngine::cfHandle() for the ops inside one batch: a
+    // commit mixing data, index and in-edge updates routes every op to
+    // the column family its key belongs to
+    rocksdb::ColumnFamilyHandle* cfFor(folly::StringPiece key) const {
+        if (indexCf_ != nullptr && NebulaKeyUtils::isIndexKey(key)) {
+            return indexCf_;
+        }
+        if (inEdgeCf_ != nullptr && NebulaKeyUtils::isInEdgeKey(vIdLen_, key)) {
+            return inEdgeCf_;
+        }
+        return defaultCf_;
+    }
 
 public:
-    RocksWriteBatch() : batch_(FLAGS_rocksdb_batch_size) {}
+    RocksWriteBatch(rocksdb::ColumnFamilyHandle* defaultCf,
+                    rocksdb::ColumnFamilyHandle* indexCf,
+                    rocksdb::ColumnFamilyHandle* inEdgeCf,
+                    int32_t vIdLen)
+        : batch_(FLAGS_rocksdb_batch_size)
+        , defaultCf_(defaultCf)
+        , indexCf_(indexCf)
+        , inEdgeCf_(inEdgeCf)
+        , vIdLen_(vIdLen) {}
 
     virtual ~RocksWriteBatch() = default;
 
     ResultCode put(folly::StringPiece key, folly::StringPiece value) override {
-        if (batch_.Put(toSlice(key), toSlice(value)).ok()) {
+        if (batch_.Put(cfFor(key), toSlice(key), toSlice(value)).ok()) {
+            return ResultCode::SUCCEEDED;
+        } else {
+            return ResultCode::ERR_UNKNOWN;
+        }
+    }
+
+    ResultCode merge(folly::StringPiece key, folly::StringPiece value) override {
+        if (batch_.Merge(cfFor(key), toSlice(key), toSlice(value)).ok()) {
             return ResultCode::SUCCEEDED;
         } else {
             return ResultCode::ERR_UNKNOWN;
@@ -43,7 +88,7 @@ public:
     }
 
     ResultCode remove(folly::StringPiece key) override {
-        if (batch_.Delete(toSlice(key)).ok()) {
+        if (batch_.Delete(cfFor(key), toSlice(key)).ok()) {
             return ResultCode::SUCCEEDED;
         } else {
             return ResultCode::ERR_UNKNOWN;
@@ -52,11 +97,27 @@ public:
 
     // Remove all keys in the range [start, end)
     ResultCode removeRange(folly::StringPiece start, folly::StringPiece end) override {
-        if (batch_.DeleteRange(toSlice(start), toSlice(end)).ok()) {
-            return ResultCode::SUCCEEDED;
-        } else {
+        auto* cf = cfFor(start);
+        if (!batch_.DeleteRange(cf, toSlice(start), toSlice(end)).ok()) {
             return ResultCode::ERR_UNKNOWN;
         }
+        // A data range that does not reach the edge type field covers
+        // keys of both data families
+        if (inEdgeCf_ != nullptr && cf == defaultCf_
+                && start.size() >= sizeof(PartitionID)
+                && start.size() < sizeof(PartitionID) + vIdLen_ + sizeof(EdgeType)
+                && NebulaKeyUtils::isDataKey(start)) {
+            if (!batch_.DeleteRange(inEdgeCf_, toSlice(start), toSlice(end)).ok()) {
+                return ResultCode::ERR_UNKNOWN;
+            }
+        }
+        return ResultCode::SUCCEEDED;
+    }
+
+    // rocksdb keeps the rep buffer across Clear(), so a recycled batch
+    // carries the capacity of the largest commit it has seen
+    void clear() override {
+        batch_.Clear();
     }
 
     rocksdb::WriteBatch* data() {
@@ -67,6 +128,58 @@ public:
 }  // Anonymous namespace
 
 
+/***************************************
+ *
+ * Iterators returning their rocksdb iterator to the engine pool
+ *
+ **************************************/
+class PooledRangeIter final : public RocksRangeIter {
+public:
+    PooledRangeIter(RocksEngine* engine,
+                    bool totalOrder,
+                    rocksdb::ColumnFamilyHandle* cf,
+                    rocksdb::Iterator* iter,
+                    rocksdb::Slice start,
+                    rocksdb::Slice end)
+        : RocksRangeIter(iter, start, end)
+        , engine_(engine)
+        , totalOrder_(totalOrder)
+        , cf_(cf) {}
+
+    ~PooledRangeIter() {
+        engine_->recycleIter(totalOrder_, cf_, iter_.release());
+    }
+
+private:
+    RocksEngine* engine_;
+    bool totalOrder_;
+    rocksdb::ColumnFamilyHandle* cf_;
+};
+
+
+class PooledPrefixIter final : public RocksPrefixIter {
+public:
+    PooledPrefixIter(RocksEngine* engine,
+                     bool totalOrder,
+                     rocksdb::ColumnFamilyHandle* cf,
+                     rocksdb::Iterator* iter,
+                     rocksdb::Slice prefix)
+        : RocksPrefixIter(iter, prefix)
+        , engine_(engine)
+        , totalOrder_(totalOrder)
+        , cf_(cf) {}
+
+    ~PooledPrefixIter() {
+        engine_->recycleIter(totalOrder_, cf_, iter_.release());
+    }
+
+private:
+    RocksEngine* engine_;
+    bool totalOrder_;
+    rocksdb::ColumnFamilyHandle* cf_;
+};
+
+
 /***************************************
  *
  * Implementation of WriteBatch
@@ -75,9 +188,12 @@ public:
 RocksEngine::RocksEngine(GraphSpaceID spaceId,
                          const std::string& dataPath,
                          std::shared_ptr<rocksdb::MergeOperator> mergeOp,
-                         std::shared_ptr<rocksdb::CompactionFilterFactory> cfFactory)
+                         std::shared_ptr<rocksdb::CompactionFilterFactory> cfFactory,
+                         std::shared_ptr<rocksdb::TablePropertiesCollectorFactory> tpcFactory,
+                         int32_t vIdLen)
         : KVEngine(spaceId)
-        , dataPath_(folly::stringPrintf("%s/nebula/%d", dataPath.c_str(), spaceId)) {
+        , dataPath_(folly::stringPrintf("%s/nebula/%d", dataPath.c_str(), spaceId))
+        , vIdLen_(vIdLen) {
     auto path = folly::stringPrintf("%s/data", dataPath_.c_str());
     if (FileUtils::fileType(path.c_str()) == FileType::NOTEXIST) {
         if (!FileUtils::makeDir(path)) {
@@ -91,32 +207,218 @@ RocksEngine::RocksEngine(GraphSpaceID spaceId,
 
     rocksdb::Options options;
     rocksdb::DB* db = nullptr;
-    rocksdb::Status status = initRocksdbOptions(options);
+    rocksdb::Status status = initRocksdbOptions(options, spaceId, vIdLen_, health_);
     CHECK(status.ok());
+    rateLimiter_ = options.rate_limiter;
     if (mergeOp != nullptr) {
         options.merge_operator = mergeOp;
     }
     if (cfFactory != nullptr) {
         options.compaction_filter_factory = cfFactory;
     }
-    status = rocksdb::DB::Open(options, path, &db);
-    CHECK(status.ok()) << status.ToString();
+    if (tpcFactory != nullptr) {
+        options.table_properties_collector_factories.emplace_back(tpcFactory);
+    }
+    if (FLAGS_enable_cardinality_stats) {
+        options.table_properties_collector_factories.emplace_back(
+                std::make_shared<CardinalityCollectorFactory>(vIdLen_));
+    }
+
+    // A db opened with the index or in-edge column family once must
+    // keep opening it, whatever the flags say now, otherwise rocksdb
+    // refuses to open
+    std::vector<std::string> cfNames;
+    auto listStatus = rocksdb::DB::ListColumnFamilies(options, path, &cfNames);
+    if (!listStatus.ok()) {
+        // A brand new db has no manifest to list yet
+        cfNames = {rocksdb::kDefaultColumnFamilyName};
+    }
+    bool hasIndexCf = std::find(cfNames.begin(), cfNames.end(),
+                                kIndexColumnFamilyName) != cfNames.end();
+    bool hasInEdgeCf = std::find(cfNames.begin(), cfNames.end(),
+                                 kInEdgeColumnFamilyName) != cfNames.end();
+    bool useIndexCf = hasIndexCf || FLAGS_rocksdb_separate_index_cf;
+    bool useInEdgeCf = hasInEdgeCf || FLAGS_rocksdb_separate_in_edge_cf;
+
+    if (useIndexCf || useInEdgeCf) {
+        rocksdb::ColumnFamilyOptions indexCfOpts;
+        rocksdb::ColumnFamilyOptions inEdgeCfOpts;
+        if (useIndexCf) {
+            status = initIndexColumnFamilyOptions(indexCfOpts);
+            CHECK(status.ok());
+            if (mergeOp != nullptr) {
+                indexCfOpts.merge_operator = mergeOp;
+            }
+            if (cfFactory != nullptr) {
+                indexCfOpts.compaction_filter_factory = cfFactory;
+            }
+        }
+        if (useInEdgeCf) {
+            status = initInEdgeColumnFamilyOptions(inEdgeCfOpts, vIdLen_);
+            CHECK(status.ok());
+            if (mergeOp != nullptr) {
+                inEdgeCfOpts.merge_operator = mergeOp;
+            }
+            if (cfFactory != nullptr) {
+                inEdgeCfOpts.compaction_filter_factory = cfFactory;
+            }
+            // In-edges are data keys, so they take part in the table
+            // property stats like the default family does
+            if (tpcFactory != nullptr) {
+                inEdgeCfOpts.table_properties_collector_factories.emplace_back(tpcFactory);
+            }
+            if (FLAGS_enable_cardinality_stats) {
+                inEdgeCfOpts.table_properties_collector_factories.emplace_back(
+                        std::make_shared<CardinalityCollectorFactory>(vIdLen_));
+            }
+        }
+
+        std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+        descriptors.emplace_back(rocksdb::kDefaultColumnFamilyName,
+                                 rocksdb::ColumnFamilyOptions(options));
+        if (hasIndexCf) {
+            descriptors.emplace_back(kIndexColumnFamilyName, indexCfOpts);
+        }
+        if (hasInEdgeCf) {
+            descriptors.emplace_back(kInEdgeColumnFamilyName, inEdgeCfOpts);
+        }
+        std::vector<rocksdb::ColumnFamilyHandle*> handles;
+        status = rocksdb::DB::Open(options, path, descriptors, &handles, &db);
+        CHECK(status.ok()) << status.ToString();
+        // The default family stays reachable via db->DefaultColumnFamily()
+        delete handles[0];
+        size_t handleIdx = 1;
+        if (hasIndexCf) {
+            indexCf_.reset(handles[handleIdx++]);
+        }
+        if (hasInEdgeCf) {
+            inEdgeCf_.reset(handles[handleIdx++]);
+        }
+        if (useIndexCf && !hasIndexCf) {
+            rocksdb::ColumnFamilyHandle* indexCf = nullptr;
+            status = db->CreateColumnFamily(indexCfOpts, kIndexColumnFamilyName, &indexCf);
+            CHECK(status.ok()) << status.ToString();
+            indexCf_.reset(indexCf);
+        }
+        if (useInEdgeCf && !hasInEdgeCf) {
+            rocksdb::ColumnFamilyHandle* inEdgeCf = nullptr;
+            status = db->CreateColumnFamily(inEdgeCfOpts, kInEdgeColumnFamilyName, &inEdgeCf);
+            CHECK(status.ok()) << status.ToString();
+            inEdgeCf_.reset(inEdgeCf);
+        }
+        LOG(INFO) << "open rocksdb with" << (useIndexCf ? " the index" : "")
+                  << (useInEdgeCf ? " the in-edge" : "") << " column family on " << path;
+    } else {
+        status = rocksdb::DB::Open(options, path, &db);
+        CHECK(status.ok()) << status.ToString();
+        LOG(INFO) << "open rocksdb on " << path;
+    }
     db_.reset(db);
     partsNum_ = allParts().size();
-    LOG(INFO) << "open rocksdb on " << path;
+    if (FLAGS_block_cache_warmup) {
+        warmup_ = std::make_unique<CacheWarmup>();
+    }
+}
+
+
+rocksdb::ColumnFamilyHandle* RocksEngine::cfHandle(const folly::StringPiece& key) const {
+    if (indexCf_ != nullptr && NebulaKeyUtils::isIndexKey(key)) {
+        return indexCf_.get();
+    }
+    if (inEdgeCf_ != nullptr && NebulaKeyUtils::isInEdgeKey(vIdLen_, key)) {
+        return inEdgeCf_.get();
+    }
+    return db_->DefaultColumnFamily();
+}
+
+
+bool RocksEngine::spansInEdgeCf(const folly::StringPiece& prefix) const {
+    return inEdgeCf_ != nullptr
+        && prefix.size() >= sizeof(PartitionID)
+        && prefix.size() < sizeof(PartitionID) + vIdLen_ + sizeof(EdgeType)
+        && NebulaKeyUtils::isDataKey(prefix);
+}
+
+
+bool RocksEngine::canUsePrefixBloom(const folly::StringPiece& prefix) const {
+    // Index keys live in a column family without a prefix extractor
+    return FLAGS_enable_rocksdb_prefix_filtering
+        && !NebulaKeyUtils::isIndexKey(prefix)
+        && prefix.size() >= sizeof(PartitionID) + static_cast<size_t>(vIdLen_);
+}
+
+
+rocksdb::Iterator* RocksEngine::acquireIter(bool totalOrder, rocksdb::ColumnFamilyHandle* cf) {
+    int32_t cfSlot = cf == indexCf_.get() ? 1 : (cf == inEdgeCf_.get() ? 2 : 0);
+    auto& slot = iterPool_->slots[totalOrder ? 1 : 0][cfSlot];
+    while (!slot.empty()) {
+        auto iter = std::move(slot.back());
+        slot.pop_back();
+        // Refresh moves the iterator to the latest snapshot; it is a
+        // no-op when the superversion has not changed since creation
+        if (iter->Refresh().ok()) {
+            return iter.release();
+        }
+    }
+    rocksdb::ReadOptions options;
+    options.total_order_seek = totalOrder;
+    return db_->NewIterator(options, cf);
+}
+
+
+void RocksEngine::recycleIter(bool totalOrder,
+                              rocksdb::ColumnFamilyHandle* cf,
+                              rocksdb::Iterator* iter) {
+    int32_t cfSlot = cf == indexCf_.get() ? 1 : (cf == inEdgeCf_.get() ? 2 : 0);
+    auto& slot = iterPool_->slots[totalOrder ? 1 : 0][cfSlot];
+    if (slot.size() < static_cast<size_t>(FLAGS_rocksdb_iterator_pool_size)) {
+        slot.emplace_back(iter);
+    } else {
+        delete iter;
+    }
+}
+
+
+void RocksEngine::setRateLimit(int32_t mbps) {
+    if (rateLimiter_ != nullptr && mbps > 0) {
+        rateLimiter_->SetBytesPerSecond(mbps * 1024 * 1024L);
+    }
 }
 
 
 std::unique_ptr<WriteBatch> RocksEngine::startBatchWrite() {
-    return std::make_unique<RocksWriteBatch>();
+    auto& slot = batchPool_->slots;
+    if (!slot.empty()) {
+        auto batch = std::move(slot.back());
+        slot.pop_back();
+        return batch;
+    }
+    return std::make_unique<RocksWriteBatch>(db_->DefaultColumnFamily(), indexCf_.get(),
+                                             inEdgeCf_.get(), vIdLen_);
+}
+
+
+void RocksEngine::recycleBatch(std::unique_ptr<WriteBatch> batch) {
+    auto& slot = batchPool_->slots;
+    if (slot.size() < static_cast<size_t>(FLAGS_rocksdb_batch_pool_size)) {
+        batch->clear();
+        slot.emplace_back(std::move(batch));
+    }
 }
 
 
 ResultCode RocksEngine::commitBatchWrite(std::unique_ptr<WriteBatch> batch, bool disableWAL) {
+    TraceSpanGuard span("engine_write");
+    auto* b = static_cast<RocksWriteBatch*>(batch.get());
+    if (FLAGS_rocksdb_merge_part_writes) {
+        auto code = groupWrite(b->data(), disableWAL);
+        recycleBatch(std::move(batch));
+        return code;
+    }
     rocksdb::WriteOptions options;
     options.disableWAL = disableWAL;
-    auto* b = static_cast<RocksWriteBatch*>(batch.get());
     rocksdb::Status status = db_->Write(options, b->data());
+    recycleBatch(std::move(batch));
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     }
@@ -125,9 +427,82 @@ ResultCode RocksEngine::commitBatchWrite(std::unique_ptr<WriteBatch> batch, bool
 }
 
 
+ResultCode RocksEngine::groupWrite(rocksdb::WriteBatch* batch, bool disableWAL) {
+    // The 8 byte sequence and 4 byte count every batch rep starts with
+    static constexpr size_t kBatchHeaderSize = 12;
+
+    PendingWrite pending{batch, disableWAL};
+    std::unique_lock<std::mutex> guard(writeLock_);
+    writeQueue_.emplace_back(&pending);
+    while (writerActive_) {
+        writeCond_.wait(guard, [this, &pending] {
+            return pending.done || !writerActive_;
+        });
+        if (pending.done) {
+            // A leader carried this batch in its group
+            return pending.result;
+        }
+    }
+
+    // Lead the group: everything queued so far goes out in one write
+    writerActive_ = true;
+    auto group = std::move(writeQueue_);
+    writeQueue_.clear();
+    guard.unlock();
+
+    rocksdb::WriteOptions options;
+    options.disableWAL = true;
+    for (auto* w : group) {
+        // One caller needing the rocksdb WAL makes the whole group use
+        // it
+        options.disableWAL &= w->disableWAL;
+    }
+
+    rocksdb::Status status;
+    if (group.size() == 1) {
+        status = db_->Write(options, group[0]->batch);
+    } else {
+        // Concatenate the batch reps: entries simply follow the header
+        // back to back, the counts add up, and rocksdb assigns the
+        // sequence on write. Each part's own batch stays contiguous, so
+        // per-part ordering is preserved
+        std::string rep = group[0]->batch->Data();
+        uint32_t count = group[0]->batch->Count();
+        for (size_t i = 1; i < group.size(); i++) {
+            const auto& next = group[i]->batch->Data();
+            if (next.size() > kBatchHeaderSize) {
+                rep.append(next.data() + kBatchHeaderSize, next.size() - kBatchHeaderSize);
+            }
+            count += group[i]->batch->Count();
+        }
+        ::memcpy(&rep[sizeof(uint64_t)], &count, sizeof(count));
+        rocksdb::WriteBatch merged(rep);
+        status = db_->Write(options, &merged);
+    }
+
+    auto result = ResultCode::SUCCEEDED;
+    if (!status.ok()) {
+        LOG(ERROR) << "Write into rocksdb failed because of " << status.ToString();
+        result = ResultCode::ERR_UNKNOWN;
+    }
+
+    guard.lock();
+    writerActive_ = false;
+    for (auto* w : group) {
+        w->result = result;
+        w->done = true;
+    }
+    guard.unlock();
+    writeCond_.notify_all();
+    return result;
+}
+
+
 ResultCode RocksEngine::get(const std::string& key, std::string* value) {
+    TraceSpanGuard span("engine_get");
+    maybeRecordWarmup(CacheWarmup::AccessKind::GET, key);
     rocksdb::ReadOptions options;
-    rocksdb::Status status = db_->Get(options, rocksdb::Slice(key), value);
+    rocksdb::Status status = db_->Get(options, cfHandle(key), rocksdb::Slice(key), value);
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else if (status.IsNotFound()) {
@@ -140,15 +515,117 @@ ResultCode RocksEngine::get(const std::string& key, std::string* value) {
 }
 
 
+// The profile lives inside the engine under a reserved key outside any
+// part's key space, like the health probe key
+static const std::string kWarmupProfileKey =             // NOLINT
+    "\xFF__block_cache_warmup_profile__";
+// How many records one replayed prefix pulls; enough to fault the
+// leading data blocks of the range without re-running the whole scan
+static constexpr int32_t kWarmupRecordsPerPrefix = 128;
+
+void RocksEngine::maybeRecordWarmup(CacheWarmup::AccessKind kind, const std::string& key) {
+    if (warmup_ == nullptr) {
+        return;
+    }
+    static thread_local uint32_t counter = 0;
+    if (++counter % FLAGS_block_cache_warmup_sample_every_n != 0) {
+        return;
+    }
+    warmup_->record(kind, key);
+}
+
+void RocksEngine::saveWarmupProfile() {
+    if (warmup_ == nullptr) {
+        return;
+    }
+    auto image = warmup_->encode();
+    if (image.empty()) {
+        return;
+    }
+    rocksdb::WriteOptions options;
+    options.disableWAL = FLAGS_rocksdb_disable_wal;
+    auto status = db_->Put(options, db_->DefaultColumnFamily(),
+                           rocksdb::Slice(kWarmupProfileKey), rocksdb::Slice(image));
+    if (!status.ok()) {
+        LOG(ERROR) << "Failed to persist the warmup profile on " << dataPath_
+                   << ": " << status.ToString();
+    }
+}
+
+void RocksEngine::warmupBlockCache() {
+    std::string image;
+    rocksdb::ReadOptions readOpts;
+    auto status = db_->Get(readOpts, db_->DefaultColumnFamily(),
+                           rocksdb::Slice(kWarmupProfileKey), &image);
+    if (status.IsNotFound()) {
+        return;
+    }
+    if (!status.ok()) {
+        LOG(ERROR) << "Failed to read the warmup profile on " << dataPath_
+                   << ": " << status.ToString();
+        return;
+    }
+    std::vector<CacheWarmup::Entry> entries;
+    if (!CacheWarmup::decode(image, entries)) {
+        LOG(ERROR) << "Corrupt warmup profile on " << dataPath_ << ", skip the warmup";
+        return;
+    }
+    // The entries come hottest first, so even a warmup cut short by
+    // eviction pressure has loaded the most valuable blocks
+    auto startUs = time::WallClock::fastNowInMicroSec();
+    int64_t replayed = 0;
+    for (const auto& entry : entries) {
+        if (entry.kind == CacheWarmup::AccessKind::GET) {
+            std::string value;
+            db_->Get(readOpts, cfHandle(entry.key), rocksdb::Slice(entry.key), &value);
+            replayed++;
+            continue;
+        }
+        // Short recorded prefixes may span extractor prefixes, so the
+        // replay always seeks in total order
+        rocksdb::ReadOptions iterOpts;
+        iterOpts.total_order_seek = true;
+        std::unique_ptr<rocksdb::Iterator> iter(
+            db_->NewIterator(iterOpts, cfHandle(entry.key)));
+        iter->Seek(rocksdb::Slice(entry.key));
+        for (int32_t i = 0; i < kWarmupRecordsPerPrefix
+                && iter->Valid()
+                && iter->key().starts_with(rocksdb::Slice(entry.key)); i++) {
+            iter->Next();
+        }
+        replayed++;
+    }
+    LOG(INFO) << "Warmed the block cache on " << dataPath_ << " from " << replayed
+              << " profile entries in "
+              << time::WallClock::fastNowInMicroSec() - startUs << " us";
+}
+
+void RocksEngine::probeHealth() {
+    // A point read of a key that can never exist: it misses, but it
+    // still walks memtable, filters and possibly one data block, which
+    // is exactly the I/O a real read pays
+    static const std::string kProbeKey = "\xFF__engine_health_probe__";
+    rocksdb::ReadOptions options;
+    std::string value;
+    auto startUs = time::WallClock::fastNowInMicroSec();
+    auto status = db_->Get(options, db_->DefaultColumnFamily(),
+                           rocksdb::Slice(kProbeKey), &value);
+    auto latencyUs = time::WallClock::fastNowInMicroSec() - startUs;
+    health_->onProbe(status.ok() || status.IsNotFound(), latencyUs);
+}
+
+
 std::vector<Status> RocksEngine::multiGet(const std::vector<std::string>& keys,
                                           std::vector<std::string>* values) {
     rocksdb::ReadOptions options;
     std::vector<rocksdb::Slice> slices;
+    std::vector<rocksdb::ColumnFamilyHandle*> cfs;
     for (size_t index = 0; index < keys.size(); index++) {
         slices.emplace_back(keys[index]);
+        cfs.emplace_back(cfHandle(keys[index]));
     }
 
-    auto status = db_->MultiGet(options, slices, values);
+    auto status = db_->MultiGet(options, cfs, slices, values);
     std::vector<Status> ret;
     std::transform(status.begin(), status.end(), std::back_inserter(ret),
                    [] (const auto& s) {
@@ -164,40 +641,259 @@ std::vector<Status> RocksEngine::multiGet(const std::vector<std::string>& keys,
 }
 
 
+namespace {
+
+// Read options for a bulk scan: stream sequentially at disk bandwidth
+// without evicting the hot working set from the block cache
+rocksdb::ReadOptions bulkScanOptions(bool totalOrder) {
+    rocksdb::ReadOptions options;
+    options.total_order_seek = totalOrder;
+    options.prefix_same_as_start = !totalOrder;
+    options.readahead_size = FLAGS_rocksdb_bulk_scan_readahead;
+    options.fill_cache = false;
+    return options;
+}
+
+// Read options for a scan pinned to an explicit snapshot
+rocksdb::ReadOptions snapshotScanOptions(bool totalOrder, const void* snapshot) {
+    rocksdb::ReadOptions options;
+    options.total_order_seek = totalOrder;
+    options.prefix_same_as_start = !totalOrder;
+    options.snapshot = static_cast<const rocksdb::Snapshot*>(snapshot);
+    return options;
+}
+
+// Merges the default and in-edge column family halves of one data scan
+// back into a single key-ordered stream. A key lives in exactly one
+// family, so picking the smaller head of the two halves restores the
+// order a single-family scan would have produced
+class MergedDataIter final : public KVIterator {
+public:
+    MergedDataIter(std::unique_ptr<KVIterator> dataHalf,
+                   std::unique_ptr<KVIterator> inEdgeHalf)
+        : dataHalf_(std::move(dataHalf))
+        , inEdgeHalf_(std::move(inEdgeHalf)) {}
+
+    bool valid() const override {
+        return dataHalf_->valid() || inEdgeHalf_->valid();
+    }
+
+    void next() override {
+        smaller()->next();
+    }
+
+    void prev() override {
+        LOG(FATAL) << "A merged data scan cannot step backwards";
+    }
+
+    folly::StringPiece key() const override {
+        return smaller()->key();
+    }
+
+    folly::StringPiece val() const override {
+        return smaller()->val();
+    }
+
+    bool seek(folly::StringPiece target) override {
+        return dataHalf_->seek(target) && inEdgeHalf_->seek(target);
+    }
+
+private:
+    KVIterator* smaller() const {
+        if (!dataHalf_->valid()) {
+            return inEdgeHalf_.get();
+        }
+        if (!inEdgeHalf_->valid()) {
+            return dataHalf_.get();
+        }
+        return dataHalf_->key() < inEdgeHalf_->key() ? dataHalf_.get() : inEdgeHalf_.get();
+    }
+
+    std::unique_ptr<KVIterator> dataHalf_;
+    std::unique_ptr<KVIterator> inEdgeHalf_;
+};
+
+}  // Anonymous namespace
+
+
+const void* RocksEngine::beginSnapshot() {
+    return db_->GetSnapshot();
+}
+
+
+void RocksEngine::releaseSnapshot(const void* snapshot) {
+    db_->ReleaseSnapshot(static_cast<const rocksdb::Snapshot*>(snapshot));
+}
+
+
 ResultCode RocksEngine::range(const std::string& start,
                               const std::string& end,
-                              std::unique_ptr<KVIterator>* storageIter) {
-    rocksdb::ReadOptions options;
-    rocksdb::Iterator* iter = db_->NewIterator(options);
-    if (iter) {
+                              std::unique_ptr<KVIterator>* storageIter,
+                              ScanHint hint,
+                              const void* snapshot) {
+    if (spansInEdgeCf(start)) {
+        std::unique_ptr<KVIterator> dataHalf;
+        std::unique_ptr<KVIterator> inEdgeHalf;
+        rangeInCf(db_->DefaultColumnFamily(), start, end, &dataHalf, hint, snapshot);
+        rangeInCf(inEdgeCf_.get(), start, end, &inEdgeHalf, hint, snapshot);
+        storageIter->reset(new MergedDataIter(std::move(dataHalf), std::move(inEdgeHalf)));
+        return ResultCode::SUCCEEDED;
+    }
+    return rangeInCf(cfHandle(start), start, end, storageIter, hint, snapshot);
+}
+
+
+ResultCode RocksEngine::rangeInCf(rocksdb::ColumnFamilyHandle* cf,
+                                  const std::string& start,
+                                  const std::string& end,
+                                  std::unique_ptr<KVIterator>* storageIter,
+                                  ScanHint hint,
+                                  const void* snapshot) {
+    // An arbitrary range may span prefixes, never use prefix mode
+    bool totalOrder = FLAGS_enable_rocksdb_prefix_filtering;
+    if (hint == ScanHint::BULK) {
+        // Bulk scans bypass the iterator pool: their read options
+        // differ, and a streaming iterator is not worth caching
+        auto* iter = db_->NewIterator(bulkScanOptions(totalOrder), cf);
         iter->Seek(rocksdb::Slice(start));
+        storageIter->reset(new RocksRangeIter(iter, start, end));
+        return ResultCode::SUCCEEDED;
     }
-    storageIter->reset(new RocksRangeIter(iter, start, end));
+    if (snapshot != nullptr) {
+        // Pinned scans bypass the pool as well: pooled iterators are
+        // refreshed to the latest version on reuse
+        auto* iter = db_->NewIterator(snapshotScanOptions(totalOrder, snapshot), cf);
+        iter->Seek(rocksdb::Slice(start));
+        storageIter->reset(new RocksRangeIter(iter, start, end));
+        return ResultCode::SUCCEEDED;
+    }
+    rocksdb::Iterator* iter = acquireIter(totalOrder, cf);
+    iter->Seek(rocksdb::Slice(start));
+    storageIter->reset(new PooledRangeIter(this, totalOrder, cf, iter, start, end));
     return ResultCode::SUCCEEDED;
 }
 
 
 ResultCode RocksEngine::prefix(const std::string& prefix,
-                               std::unique_ptr<KVIterator>* storageIter) {
-    rocksdb::ReadOptions options;
-    rocksdb::Iterator* iter = db_->NewIterator(options);
-    if (iter) {
+                               std::unique_ptr<KVIterator>* storageIter,
+                               ScanHint hint,
+                               const void* snapshot) {
+    // only the seek; the iteration itself runs in the caller
+    TraceSpanGuard span("engine_prefix");
+    maybeRecordWarmup(CacheWarmup::AccessKind::PREFIX, prefix);
+    if (spansInEdgeCf(prefix)) {
+        std::unique_ptr<KVIterator> dataHalf;
+        std::unique_ptr<KVIterator> inEdgeHalf;
+        prefixInCf(db_->DefaultColumnFamily(), prefix, &dataHalf, hint, snapshot);
+        prefixInCf(inEdgeCf_.get(), prefix, &inEdgeHalf, hint, snapshot);
+        storageIter->reset(new MergedDataIter(std::move(dataHalf), std::move(inEdgeHalf)));
+        return ResultCode::SUCCEEDED;
+    }
+    return prefixInCf(cfHandle(prefix), prefix, storageIter, hint, snapshot);
+}
+
+
+ResultCode RocksEngine::prefixInCf(rocksdb::ColumnFamilyHandle* cf,
+                                   const std::string& prefix,
+                                   std::unique_ptr<KVIterator>* storageIter,
+                                   ScanHint hint,
+                                   const void* snapshot) {
+    // Shorter prefixes, e.g. a whole-part scan, visit keys with
+    // different extractor prefixes and need a total order seek
+    bool totalOrder = FLAGS_enable_rocksdb_prefix_filtering
+                   && !canUsePrefixBloom(prefix);
+    if (hint == ScanHint::BULK) {
+        auto* iter = db_->NewIterator(bulkScanOptions(totalOrder), cf);
         iter->Seek(rocksdb::Slice(prefix));
+        storageIter->reset(new RocksPrefixIter(iter, prefix));
+        return ResultCode::SUCCEEDED;
     }
-    storageIter->reset(new RocksPrefixIter(iter, prefix));
+    if (snapshot != nullptr) {
+        auto* iter = db_->NewIterator(snapshotScanOptions(totalOrder, snapshot), cf);
+        iter->Seek(rocksdb::Slice(prefix));
+        storageIter->reset(new RocksPrefixIter(iter, prefix));
+        return ResultCode::SUCCEEDED;
+    }
+    rocksdb::Iterator* iter = acquireIter(totalOrder, cf);
+    iter->Seek(rocksdb::Slice(prefix));
+    storageIter->reset(new PooledPrefixIter(this, totalOrder, cf, iter, prefix));
     return ResultCode::SUCCEEDED;
 }
 
 
+ResultCode RocksEngine::getLatest(const std::string& keyPrefix,
+                                  std::string* value,
+                                  const void* snapshot) {
+    TraceSpanGuard span("engine_get_latest");
+    bool totalOrder = FLAGS_enable_rocksdb_prefix_filtering
+                   && !canUsePrefixBloom(keyPrefix);
+    auto* cf = cfHandle(keyPrefix);
+    if (snapshot != nullptr) {
+        // Pinned reads bypass the pool: pooled iterators are refreshed
+        // to the latest version on reuse
+        auto* iter = db_->NewIterator(snapshotScanOptions(totalOrder, snapshot), cf);
+        iter->Seek(rocksdb::Slice(keyPrefix));
+        auto code = ResultCode::ERR_KEY_NOT_FOUND;
+        if (iter->Valid() && iter->key().starts_with(keyPrefix)) {
+            value->assign(iter->value().data(), iter->value().size());
+            code = ResultCode::SUCCEEDED;
+        }
+        delete iter;
+        return code;
+    }
+    rocksdb::Iterator* iter = acquireIter(totalOrder, cf);
+    iter->Seek(rocksdb::Slice(keyPrefix));
+    auto code = ResultCode::ERR_KEY_NOT_FOUND;
+    if (iter->Valid() && iter->key().starts_with(keyPrefix)) {
+        value->assign(iter->value().data(), iter->value().size());
+        code = ResultCode::SUCCEEDED;
+    }
+    recycleIter(totalOrder, cf, iter);
+    return code;
+}
+
+
 ResultCode RocksEngine::rangeWithPrefix(const std::string& start,
                                         const std::string& prefix,
-                                        std::unique_ptr<KVIterator>* storageIter) {
-    rocksdb::ReadOptions options;
-    rocksdb::Iterator* iter = db_->NewIterator(options);
-    if (iter) {
+                                        std::unique_ptr<KVIterator>* storageIter,
+                                        ScanHint hint,
+                                        const void* snapshot) {
+    if (spansInEdgeCf(prefix)) {
+        std::unique_ptr<KVIterator> dataHalf;
+        std::unique_ptr<KVIterator> inEdgeHalf;
+        rangeWithPrefixInCf(db_->DefaultColumnFamily(), start, prefix,
+                            &dataHalf, hint, snapshot);
+        rangeWithPrefixInCf(inEdgeCf_.get(), start, prefix, &inEdgeHalf, hint, snapshot);
+        storageIter->reset(new MergedDataIter(std::move(dataHalf), std::move(inEdgeHalf)));
+        return ResultCode::SUCCEEDED;
+    }
+    return rangeWithPrefixInCf(cfHandle(prefix), start, prefix, storageIter, hint, snapshot);
+}
+
+
+ResultCode RocksEngine::rangeWithPrefixInCf(rocksdb::ColumnFamilyHandle* cf,
+                                            const std::string& start,
+                                            const std::string& prefix,
+                                            std::unique_ptr<KVIterator>* storageIter,
+                                            ScanHint hint,
+                                            const void* snapshot) {
+    bool totalOrder = FLAGS_enable_rocksdb_prefix_filtering
+                   && !canUsePrefixBloom(prefix);
+    if (hint == ScanHint::BULK) {
+        auto* iter = db_->NewIterator(bulkScanOptions(totalOrder), cf);
         iter->Seek(rocksdb::Slice(start));
+        storageIter->reset(new RocksPrefixIter(iter, prefix));
+        return ResultCode::SUCCEEDED;
+    }
+    if (snapshot != nullptr) {
+        auto* iter = db_->NewIterator(snapshotScanOptions(totalOrder, snapshot), cf);
+        iter->Seek(rocksdb::Slice(start));
+        storageIter->reset(new RocksPrefixIter(iter, prefix));
+        return ResultCode::SUCCEEDED;
     }
-    storageIter->reset(new RocksPrefixIter(iter, prefix));
+    rocksdb::Iterator* iter = acquireIter(totalOrder, cf);
+    iter->Seek(rocksdb::Slice(start));
+    storageIter->reset(new PooledPrefixIter(this, totalOrder, cf, iter, prefix));
     return ResultCode::SUCCEEDED;
 }
 
@@ -205,7 +901,7 @@ ResultCode RocksEngine::rangeWithPrefix(const std::string& start,
 ResultCode RocksEngine::put(std::string key, std::string value) {
     rocksdb::WriteOptions options;
     options.disableWAL = FLAGS_rocksdb_disable_wal;
-    rocksdb::Status status = db_->Put(options, key, value);
+    rocksdb::Status status = db_->Put(options, cfHandle(key), key, value);
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -216,13 +912,15 @@ ResultCode RocksEngine::put(std::string key, std::string value) {
 
 
 ResultCode RocksEngine::multiPut(std::vector<KV> keyValues) {
-    rocksdb::WriteBatch updates(FLAGS_rocksdb_batch_size);
+    auto batch = startBatchWrite();
+    auto* b = static_cast<RocksWriteBatch*>(batch.get());
     for (size_t i = 0; i < keyValues.size(); i++) {
-        updates.Put(keyValues[i].first, keyValues[i].second);
+        b->put(keyValues[i].first, keyValues[i].second);
     }
     rocksdb::WriteOptions options;
     options.disableWAL = FLAGS_rocksdb_disable_wal;
-    rocksdb::Status status = db_->Write(options, &updates);
+    rocksdb::Status status = db_->Write(options, b->data());
+    recycleBatch(std::move(batch));
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -235,7 +933,7 @@ ResultCode RocksEngine::multiPut(std::vector<KV> keyValues) {
 ResultCode RocksEngine::remove(const std::string& key) {
     rocksdb::WriteOptions options;
     options.disableWAL = FLAGS_rocksdb_disable_wal;
-    auto status = db_->Delete(options, key);
+    auto status = db_->Delete(options, cfHandle(key), key);
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -246,13 +944,15 @@ ResultCode RocksEngine::remove(const std::string& key) {
 
 
 ResultCode RocksEngine::multiRemove(std::vector<std::string> keys) {
-    rocksdb::WriteBatch deletes(FLAGS_rocksdb_batch_size);
+    auto batch = startBatchWrite();
+    auto* b = static_cast<RocksWriteBatch*>(batch.get());
     for (size_t i = 0; i < keys.size(); i++) {
-        deletes.Delete(keys[i]);
+        b->remove(keys[i]);
     }
     rocksdb::WriteOptions options;
     options.disableWAL = FLAGS_rocksdb_disable_wal;
-    rocksdb::Status status = db_->Write(options, &deletes);
+    rocksdb::Status status = db_->Write(options, b->data());
+    recycleBatch(std::move(batch));
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -266,7 +966,12 @@ ResultCode RocksEngine::removeRange(const std::string& start,
                                     const std::string& end) {
     rocksdb::WriteOptions options;
     options.disableWAL = FLAGS_rocksdb_disable_wal;
-    auto status = db_->DeleteRange(options, db_->DefaultColumnFamily(), start, end);
+    auto status = db_->DeleteRange(options, cfHandle(start), start, end);
+    if (status.ok() && spansInEdgeCf(start)) {
+        // A data range that does not pin the edge direction covers
+        // keys of both data families
+        status = db_->DeleteRange(options, inEdgeCf_.get(), start, end);
+    }
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -292,9 +997,50 @@ void RocksEngine::removePart(PartitionID partId) {
      rocksdb::WriteOptions options;
      options.disableWAL = FLAGS_rocksdb_disable_wal;
      auto status = db_->Delete(options, partKey(partId));
-     if (status.ok()) {
-         partsNum_--;
-         CHECK_GE(partsNum_, 0);
+     if (!status.ok()) {
+         return;
+     }
+     partsNum_--;
+     CHECK_GE(partsNum_, 0);
+
+     // Reclaim everything the part holds with one range tombstone per
+     // key type instead of iterating the keys. Whole sst files covered
+     // by a range are dropped right away, the rest goes with compaction
+     static const std::vector<NebulaKeyType> types{NebulaKeyType::kData,
+                                                   NebulaKeyType::kIndex,
+                                                   NebulaKeyType::kUUID,
+                                                   NebulaKeyType::kSystem};
+     for (auto type : types) {
+         PartitionID item = (partId << kPartitionOffset) | static_cast<uint32_t>(type);
+         std::string start(reinterpret_cast<const char*>(&item), sizeof(PartitionID));
+         // The next prefix in lexicographic order bounds the range
+         std::string end = start;
+         for (auto i = end.size(); i-- > 0; ) {
+             if (static_cast<uint8_t>(end[i]) != 0xFF) {
+                 end[i]++;
+                 end.resize(i + 1);
+                 break;
+             }
+         }
+         std::vector<rocksdb::ColumnFamilyHandle*> cfs{cfHandle(start)};
+         if (type == NebulaKeyType::kData && inEdgeCf_ != nullptr) {
+             // The part's in-edges live in their own family under the
+             // same range
+             cfs.emplace_back(inEdgeCf_.get());
+         }
+         rocksdb::Slice sliceStart(start);
+         rocksdb::Slice sliceEnd(end);
+         for (auto* cf : cfs) {
+             status = rocksdb::DeleteFilesInRange(db_.get(), cf, &sliceStart, &sliceEnd);
+             if (!status.ok()) {
+                 LOG(WARNING) << "DeleteFilesInRange failed: " << status.ToString();
+             }
+             status = db_->DeleteRange(options, cf, sliceStart, sliceEnd);
+             if (!status.ok()) {
+                 LOG(WARNING) << "DeleteRange part " << partId
+                              << " failed: " << status.ToString();
+             }
+         }
      }
 }
 
@@ -328,15 +1074,107 @@ int32_t RocksEngine::totalPartsNum() {
 }
 
 
-ResultCode RocksEngine::ingest(const std::vector<std::string>& files) {
+ResultCode RocksEngine::ingest(const std::vector<std::string>& files, bool prewarm) {
+    // The boundary keys are captured before the ingest moves the files
+    // away, so the warm-up below touches exactly the ranges that are
+    // about to appear
+    std::vector<std::pair<std::string, std::string>> ranges;
+    if (prewarm) {
+        for (auto& file : files) {
+            rocksdb::SstFileReader reader{rocksdb::Options()};
+            auto s = reader.Open(file);
+            if (!s.ok()) {
+                LOG(ERROR) << "Failed to open sst file " << file << ": " << s.ToString();
+                return ResultCode::ERR_IO_ERROR;
+            }
+            std::unique_ptr<rocksdb::Iterator> iter(
+                reader.NewIterator(rocksdb::ReadOptions()));
+            iter->SeekToFirst();
+            if (!iter->Valid()) {
+                continue;
+            }
+            std::string first = iter->key().ToString();
+            iter->SeekToLast();
+            ranges.emplace_back(std::move(first), iter->key().ToString());
+        }
+    }
     rocksdb::IngestExternalFileOptions options;
     rocksdb::Status status = db_->IngestExternalFile(files, options);
-    if (status.ok()) {
-        return ResultCode::SUCCEEDED;
-    } else {
+    if (!status.ok()) {
         LOG(ERROR) << "Ingest Failed: " << status.ToString();
         return ResultCode::ERR_UNKNOWN;
     }
+    for (auto& range : ranges) {
+        prewarmRange(range.first, range.second);
+    }
+    return ResultCode::SUCCEEDED;
+}
+
+
+void RocksEngine::prewarmRange(const std::string& smallest, const std::string& largest) {
+    // A point read faults the filter and index blocks of every level
+    // the key touches into the block cache; a miss warms them just as
+    // well as a hit, so the return codes do not matter here
+    rocksdb::ReadOptions options;
+    std::string value;
+    db_->Get(options, cfHandle(smallest), rocksdb::Slice(smallest), &value);
+    db_->Get(options, cfHandle(largest), rocksdb::Slice(largest), &value);
+    if (FLAGS_rocksdb_ingest_prewarm_data_mb <= 0) {
+        return;
+    }
+    // Optionally pull in the leading data blocks of the range too, for
+    // files whose head is known to be hot. The iterator fills the cache
+    // as it goes; the budget keeps a big ingest from wiping it
+    int64_t budget = FLAGS_rocksdb_ingest_prewarm_data_mb * 1024L * 1024L;
+    rocksdb::Slice upper(largest);
+    options.iterate_upper_bound = &upper;
+    options.total_order_seek = true;
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(options, cfHandle(smallest)));
+    for (iter->Seek(rocksdb::Slice(smallest)); iter->Valid() && budget > 0; iter->Next()) {
+        budget -= iter->key().size() + iter->value().size();
+    }
+}
+
+
+ResultCode RocksEngine::writeBulkSst(PartitionID partId, const std::vector<KV>& sortedData) {
+    if (sortedData.empty()) {
+        return ResultCode::SUCCEEDED;
+    }
+    auto dir = folly::stringPrintf("%s/download/%d", dataPath_.c_str(), partId);
+    if (!FileUtils::makeDir(dir)) {
+        LOG(ERROR) << "Failed to create bulk load dir " << dir;
+        return ResultCode::ERR_IO_ERROR;
+    }
+    // The name only needs to be unique within the dir; the sequence
+    // disambiguates batches landing in the same microsecond
+    static std::atomic<uint64_t> seq{0};
+    auto path = folly::stringPrintf("%s/bulk-%ld-%lu.sst",
+                                    dir.c_str(),
+                                    time::WallClock::fastNowInMicroSec(),
+                                    seq.fetch_add(1));
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), rocksdb::Options());
+    auto status = writer.Open(path);
+    if (!status.ok()) {
+        LOG(ERROR) << "Failed to open sst file " << path << ": " << status.ToString();
+        return ResultCode::ERR_IO_ERROR;
+    }
+    for (auto& kv : sortedData) {
+        status = writer.Put(kv.first, kv.second);
+        if (!status.ok()) {
+            // Out-of-order or duplicate keys end up here
+            LOG(ERROR) << "Failed to append to sst file " << path
+                       << ": " << status.ToString();
+            writer.Finish();
+            return ResultCode::ERR_INVALID_DATA;
+        }
+    }
+    status = writer.Finish();
+    if (!status.ok()) {
+        LOG(ERROR) << "Failed to finish sst file " << path << ": " << status.ToString();
+        return ResultCode::ERR_IO_ERROR;
+    }
+    VLOG(1) << "Wrote bulk sst " << path << " with " << sortedData.size() << " rows";
+    return ResultCode::SUCCEEDED;
 }
 
 
@@ -374,9 +1212,162 @@ ResultCode RocksEngine::setDBOption(const std::string& configKey,
 }
 
 
+ResultCode RocksEngine::getOption(const std::string& configKey,
+                                  std::string* configValue) {
+    std::string allOptions;
+    rocksdb::Status status = rocksdb::GetStringFromColumnFamilyOptions(&allOptions,
+                                                                       db_->GetOptions());
+    std::unordered_map<std::string, std::string> optionsMap;
+    if (status.ok()) {
+        status = rocksdb::StringToMap(allOptions, &optionsMap);
+    }
+    if (!status.ok()) {
+        LOG(ERROR) << "GetOption Failed: " << status.ToString();
+        return ResultCode::ERR_UNKNOWN;
+    }
+    auto it = optionsMap.find(configKey);
+    if (it == optionsMap.end()) {
+        return ResultCode::ERR_KEY_NOT_FOUND;
+    }
+    *configValue = it->second;
+    return ResultCode::SUCCEEDED;
+}
+
+
+ResultCode RocksEngine::getDBOption(const std::string& configKey,
+                                    std::string* configValue) {
+    std::string allOptions;
+    rocksdb::Status status = rocksdb::GetStringFromDBOptions(&allOptions, db_->GetDBOptions());
+    std::unordered_map<std::string, std::string> optionsMap;
+    if (status.ok()) {
+        status = rocksdb::StringToMap(allOptions, &optionsMap);
+    }
+    if (!status.ok()) {
+        LOG(ERROR) << "GetDBOption Failed: " << status.ToString();
+        return ResultCode::ERR_UNKNOWN;
+    }
+    auto it = optionsMap.find(configKey);
+    if (it == optionsMap.end()) {
+        return ResultCode::ERR_KEY_NOT_FOUND;
+    }
+    *configValue = it->second;
+    return ResultCode::SUCCEEDED;
+}
+
+
+ResultCode RocksEngine::getProperty(const std::string& property,
+                                    std::string* value) {
+    if (!db_->GetProperty(property, value)) {
+        return ResultCode::ERR_KEY_NOT_FOUND;
+    }
+    return ResultCode::SUCCEEDED;
+}
+
+
+ResultCode RocksEngine::getStatistics(std::unordered_map<std::string, int64_t>* stats) {
+    auto statistics = db_->GetDBOptions().statistics;
+    if (statistics == nullptr) {
+        // the engine was opened without --enable_rocksdb_statistics
+        return ResultCode::ERR_KEY_NOT_FOUND;
+    }
+    stats->reserve(rocksdb::TickersNameMap.size());
+    for (const auto& ticker : rocksdb::TickersNameMap) {
+        stats->emplace(ticker.second,
+                       static_cast<int64_t>(statistics->getTickerCount(ticker.first)));
+    }
+    return ResultCode::SUCCEEDED;
+}
+
+
+int32_t RocksEngine::writeStallPct() {
+    auto nowUs = time::WallClock::fastNowInMicroSec();
+    auto lastUs = stallCheckedAtUs_.load(std::memory_order_relaxed);
+    if (nowUs - lastUs < FLAGS_rocksdb_stall_check_interval_ms * 1000L ||
+        !stallCheckedAtUs_.compare_exchange_strong(lastUs, nowUs,
+                                                   std::memory_order_relaxed)) {
+        // Within the interval, or another thread is refreshing right now
+        return stallPct_.load(std::memory_order_relaxed);
+    }
+
+    // The proximity is the worst signal against the engine's own
+    // slowdown limits, the same limits rocksdb applies its write
+    // delays at; an engine already delaying writes reports 100
+    auto options = db_->GetOptions();
+    int64_t pct = 0;
+    uint64_t value = 0;
+    if (db_->GetIntProperty(rocksdb::DB::Properties::kActualDelayedWriteRate, &value) &&
+            value > 0) {
+        pct = 100;
+    }
+    if (options.soft_pending_compaction_bytes_limit > 0 &&
+            db_->GetIntProperty(rocksdb::DB::Properties::kEstimatePendingCompactionBytes,
+                                &value)) {
+        pct = std::max(pct, static_cast<int64_t>(
+            value * 100 / options.soft_pending_compaction_bytes_limit));
+    }
+    if (options.max_write_buffer_number > 1 &&
+            db_->GetIntProperty(rocksdb::DB::Properties::kNumImmutableMemTable, &value)) {
+        // plus one for the active memtable
+        pct = std::max(pct, (static_cast<int64_t>(value) + 1) * 100
+                                / options.max_write_buffer_number);
+    }
+    if (options.level0_slowdown_writes_trigger > 0 &&
+            db_->GetIntProperty("rocksdb.num-files-at-level0", &value)) {
+        pct = std::max(pct, static_cast<int64_t>(value) * 100
+                                / options.level0_slowdown_writes_trigger);
+    }
+    auto result = static_cast<int32_t>(std::min(pct, int64_t(100)));
+    stallPct_.store(result, std::memory_order_relaxed);
+    return result;
+}
+
+
+std::string RocksEngine::cardinalityStatus() {
+    rocksdb::TablePropertiesCollection tableProps;
+    auto status = db_->GetPropertiesOfAllTables(&tableProps);
+    if (status.ok() && inEdgeCf_ != nullptr) {
+        // The in-edge family carries the collector too, its counts
+        // join the same maps
+        status = db_->GetPropertiesOfAllTables(inEdgeCf_.get(), &tableProps);
+    }
+    if (!status.ok()) {
+        LOG(ERROR) << "Get table properties failed: " << status.ToString();
+        return "";
+    }
+    std::map<std::pair<PartitionID, TagID>, int64_t> vertices;
+    std::map<std::pair<PartitionID, EdgeType>, int64_t> edges;
+    for (const auto& table : tableProps) {
+        const auto& userProps = table.second->user_collected_properties;
+        auto iter = userProps.find(kCardinalityProperty);
+        if (iter == userProps.end()) {
+            // an sst from before the collector was enabled; its rows
+            // join the counts after the next compaction rewrites it
+            continue;
+        }
+        CardinalityCollector::merge(iter->second, &vertices, &edges);
+    }
+    std::stringstream os;
+    for (const auto& v : vertices) {
+        os << "part " << v.first.first << " tag " << v.first.second
+           << ": ~" << v.second << " rows\n";
+    }
+    for (const auto& e : edges) {
+        os << "part " << e.first.first << " edge " << e.first.second
+           << ": ~" << e.second << " rows\n";
+    }
+    return os.str();
+}
+
+
 ResultCode RocksEngine::compact() {
     rocksdb::CompactRangeOptions options;
     rocksdb::Status status = db_->CompactRange(options, nullptr, nullptr);
+    if (status.ok() && indexCf_ != nullptr) {
+        status = db_->CompactRange(options, indexCf_.get(), nullptr, nullptr);
+    }
+    if (status.ok() && inEdgeCf_ != nullptr) {
+        status = db_->CompactRange(options, inEdgeCf_.get(), nullptr, nullptr);
+    }
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -388,6 +1379,12 @@ ResultCode RocksEngine::compact() {
 ResultCode RocksEngine::flush() {
     rocksdb::FlushOptions options;
     rocksdb::Status status = db_->Flush(options);
+    if (status.ok() && indexCf_ != nullptr) {
+        status = db_->Flush(options, indexCf_.get());
+    }
+    if (status.ok() && inEdgeCf_ != nullptr) {
+        status = db_->Flush(options, inEdgeCf_.get());
+    }
     if (status.ok()) {
         return ResultCode::SUCCEEDED;
     } else {
@@ -443,8 +1440,58 @@ ResultCode RocksEngine::createCheckpoint(const std::string& name) {
         LOG(ERROR) << "Create checkpoint Failed: " << status.ToString();
         return ResultCode::ERR_CHECKPOINT_ERROR;
     }
+    writeCheckpointManifest(name, checkpointPath);
     return ResultCode::SUCCEEDED;
 }
 
+
+void RocksEngine::writeCheckpointManifest(const std::string& name,
+                                          const std::string& checkpointPath) {
+    /*
+     * The SSTs of a checkpoint are immutable and named by file number,
+     * so any file already present in the previous checkpoint is
+     * byte-identical there and need not be shipped again. MANIFEST_DELTA
+     * lists the files new since the previous checkpoint (everything, on
+     * the first one) together with the checkpoint it is based on, so
+     * backup transfer cost scales with churn instead of data size
+     */
+    auto checkpointsRoot = folly::stringPrintf("%s/checkpoints", dataPath_.c_str());
+    auto latestFile = folly::stringPrintf("%s/LATEST", checkpointsRoot.c_str());
+    std::string base;
+    std::unordered_set<std::string> baseFiles;
+    {
+        std::ifstream latest(latestFile);
+        if (latest.good() && std::getline(latest, base) && !base.empty()) {
+            auto baseData = folly::stringPrintf("%s/%s/data",
+                                                checkpointsRoot.c_str(), base.c_str());
+            for (auto& file : FileUtils::listAllFilesInDir(baseData.c_str())) {
+                baseFiles.emplace(std::move(file));
+            }
+        }
+    }
+    if (baseFiles.empty()) {
+        base.clear();
+    }
+
+    auto manifest = folly::stringPrintf("%s/%s/MANIFEST_DELTA",
+                                        checkpointsRoot.c_str(), name.c_str());
+    std::ofstream out(manifest, std::ofstream::trunc);
+    out << "base:" << base << std::endl;
+    size_t changed = 0;
+    for (auto& file : FileUtils::listAllFilesInDir(checkpointPath.c_str())) {
+        if (baseFiles.count(file) == 0) {
+            out << "data/" << file << std::endl;
+            changed++;
+        }
+    }
+    out.close();
+
+    std::ofstream latest(latestFile, std::ofstream::trunc);
+    latest << name << std::endl;
+    latest.close();
+    LOG(INFO) << "Checkpoint " << name << " on " << dataPath_ << ": " << changed
+              << " files changed since " << (base.empty() ? "scratch" : base);
+}
+
 }  // namespace kvstore
 }  // namespace nebula
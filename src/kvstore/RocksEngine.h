@@ -8,11 +8,14 @@
 #define KVSTORE_ROCKSENGINE_H_
 
 #include "common/base/Base.h"
+#include <folly/ThreadLocal.h>
+#include <condition_variable>
 #include <gtest/gtest_prod.h>
 #include <rocksdb/db.h>
 #include <rocksdb/utilities/checkpoint.h>
 #include "kvstore/KVIterator.h"
 #include "kvstore/KVEngine.h"
+#include "kvstore/CacheWarmup.h"
 
 namespace nebula {
 namespace kvstore {
@@ -46,7 +49,33 @@ public:
         return folly::StringPiece(iter_->value().data(), iter_->value().size());
     }
 
-private:
+    size_t nextBatch(size_t n, KVBatch* batch) override {
+        batch->clear();
+        while (batch->size() < n && !!iter_ && iter_->Valid()
+                && (iter_->key().compare(end_) < 0)) {
+            batch->add(folly::StringPiece(iter_->key().data(), iter_->key().size()),
+                       folly::StringPiece(iter_->value().data(), iter_->value().size()));
+            iter_->Next();
+        }
+        return batch->size();
+    }
+
+    size_t skip(size_t n) override {
+        size_t count = 0;
+        while (count < n && !!iter_ && iter_->Valid()
+                && (iter_->key().compare(end_) < 0)) {
+            iter_->Next();
+            ++count;
+        }
+        return count;
+    }
+
+    bool seek(folly::StringPiece target) override {
+        iter_->Seek(rocksdb::Slice(target.data(), target.size()));
+        return true;
+    }
+
+protected:
     std::unique_ptr<rocksdb::Iterator> iter_;
     rocksdb::Slice start_;
     rocksdb::Slice end_;
@@ -80,6 +109,32 @@ public:
         return folly::StringPiece(iter_->value().data(), iter_->value().size());
     }
 
+    size_t nextBatch(size_t n, KVBatch* batch) override {
+        batch->clear();
+        while (batch->size() < n && !!iter_ && iter_->Valid()
+                && (iter_->key().starts_with(prefix_))) {
+            batch->add(folly::StringPiece(iter_->key().data(), iter_->key().size()),
+                       folly::StringPiece(iter_->value().data(), iter_->value().size()));
+            iter_->Next();
+        }
+        return batch->size();
+    }
+
+    size_t skip(size_t n) override {
+        size_t count = 0;
+        while (count < n && !!iter_ && iter_->Valid()
+                && (iter_->key().starts_with(prefix_))) {
+            iter_->Next();
+            ++count;
+        }
+        return count;
+    }
+
+    bool seek(folly::StringPiece target) override {
+        iter_->Seek(rocksdb::Slice(target.data(), target.size()));
+        return true;
+    }
+
 protected:
     std::unique_ptr<rocksdb::Iterator> iter_;
     rocksdb::Slice prefix_;
@@ -92,12 +147,16 @@ protected:
  *************************************************************************/
 class RocksEngine : public KVEngine {
     FRIEND_TEST(RocksEngineTest, SimpleTest);
+    friend class PooledRangeIter;
+    friend class PooledPrefixIter;
 
 public:
     RocksEngine(GraphSpaceID spaceId,
                 const std::string& dataPath,
                 std::shared_ptr<rocksdb::MergeOperator> mergeOp = nullptr,
-                std::shared_ptr<rocksdb::CompactionFilterFactory> cfFactory = nullptr);
+                std::shared_ptr<rocksdb::CompactionFilterFactory> cfFactory = nullptr,
+                std::shared_ptr<rocksdb::TablePropertiesCollectorFactory> tpcFactory = nullptr,
+                int32_t vIdLen = sizeof(int64_t));
 
     ~RocksEngine() {
         LOG(INFO) << "Release rocksdb on " << dataPath_;
@@ -107,6 +166,16 @@ public:
         return dataPath_.c_str();
     }
 
+    EngineHealth health() const override {
+        return health_->health();
+    }
+
+    void probeHealth() override;
+
+    void saveWarmupProfile() override;
+
+    void warmupBlockCache() override;
+
     std::unique_ptr<WriteBatch> startBatchWrite() override;
 
     ResultCode commitBatchWrite(std::unique_ptr<WriteBatch> batch,
@@ -117,19 +186,33 @@ public:
      ********************/
     ResultCode get(const std::string& key, std::string* value) override;
 
+    ResultCode getLatest(const std::string& keyPrefix,
+                         std::string* value,
+                         const void* snapshot = nullptr) override;
+
     std::vector<Status> multiGet(const std::vector<std::string>& keys,
                                  std::vector<std::string>* values) override;
 
+    const void* beginSnapshot() override;
+
+    void releaseSnapshot(const void* snapshot) override;
+
     ResultCode range(const std::string& start,
                      const std::string& end,
-                     std::unique_ptr<KVIterator>* iter) override;
+                     std::unique_ptr<KVIterator>* iter,
+                     ScanHint hint = ScanHint::DEFAULT,
+                     const void* snapshot = nullptr) override;
 
     ResultCode prefix(const std::string& prefix,
-                      std::unique_ptr<KVIterator>* iter) override;
+                      std::unique_ptr<KVIterator>* iter,
+                      ScanHint hint = ScanHint::DEFAULT,
+                      const void* snapshot = nullptr) override;
 
     ResultCode rangeWithPrefix(const std::string& start,
                                const std::string& prefix,
-                               std::unique_ptr<KVIterator>* iter) override;
+                               std::unique_ptr<KVIterator>* iter,
+                               ScanHint hint = ScanHint::DEFAULT,
+                               const void* snapshot = nullptr) override;
 
     /*********************
      * Data modification
@@ -156,7 +239,10 @@ public:
 
     int32_t totalPartsNum() override;
 
-    ResultCode ingest(const std::vector<std::string>& files) override;
+    ResultCode ingest(const std::vector<std::string>& files,
+                      bool prewarm = false) override;
+
+    ResultCode writeBulkSst(PartitionID partId, const std::vector<KV>& sortedData) override;
 
     ResultCode setOption(const std::string& configKey,
                          const std::string& configValue) override;
@@ -164,22 +250,170 @@ public:
     ResultCode setDBOption(const std::string& configKey,
                            const std::string& configValue) override;
 
+    ResultCode getOption(const std::string& configKey,
+                         std::string* configValue) override;
+
+    ResultCode getDBOption(const std::string& configKey,
+                           std::string* configValue) override;
+
+    ResultCode getProperty(const std::string& property,
+                           std::string* value) override;
+
+    ResultCode getStatistics(std::unordered_map<std::string, int64_t>* stats) override;
+
+    int32_t writeStallPct() override;
+
+    std::string cardinalityStatus() override;
+
     ResultCode compact() override;
 
     ResultCode flush() override;
 
+    void setRateLimit(int32_t mbps) override;
+
     /*********************
      * Checkpoint operation
      ********************/
     ResultCode createCheckpoint(const std::string& path) override;
 
+private:
+    // Write <checkpoint>/MANIFEST_DELTA, the list of files new since
+    // the previous checkpoint of this engine, and move the LATEST
+    // marker forward. Incremental backups ship only the listed files
+    void writeCheckpointManifest(const std::string& name, const std::string& checkpointPath);
+
+public:
+
 private:
     std::string partKey(PartitionID partId);
 
+    // The column family holding the given key or scan prefix: the index
+    // column family for index entries and the in-edge one for edge keys
+    // with a negative edge type, when they are in use, the default one
+    // for everything else. Index scans never span another family, since
+    // every prefix carries the key type in its first four bytes; data
+    // scans can, see spansInEdgeCf()
+    rocksdb::ColumnFamilyHandle* cfHandle(const folly::StringPiece& key) const;
+
+    // Whether a scan with this prefix must visit both the default and
+    // the in-edge column family: a data prefix too short to reach the
+    // edge type field matches vertex rows and edges of both directions
+    // at once, like the whole-part and whole-vertex prefixes do. Such
+    // scans merge the two families back into one key-ordered stream
+    bool spansInEdgeCf(const folly::StringPiece& prefix) const;
+
+    // One column family's share of a scan, with the pooled, bulk or
+    // snapshot-pinned read options the public scans use
+    ResultCode rangeInCf(rocksdb::ColumnFamilyHandle* cf,
+                         const std::string& start,
+                         const std::string& end,
+                         std::unique_ptr<KVIterator>* iter,
+                         ScanHint hint,
+                         const void* snapshot);
+
+    ResultCode prefixInCf(rocksdb::ColumnFamilyHandle* cf,
+                          const std::string& prefix,
+                          std::unique_ptr<KVIterator>* iter,
+                          ScanHint hint,
+                          const void* snapshot);
+
+    ResultCode rangeWithPrefixInCf(rocksdb::ColumnFamilyHandle* cf,
+                                   const std::string& start,
+                                   const std::string& prefix,
+                                   std::unique_ptr<KVIterator>* iter,
+                                   ScanHint hint,
+                                   const void* snapshot);
+
+    // Whether an iterator seeking with the given prefix may run in
+    // rocksdb prefix mode, i.e. use the prefix bloom filter. Only valid
+    // when every key it will visit shares the capped extractor prefix
+    // of the seek key, so the prefix must cover partId + vid
+    bool canUsePrefixBloom(const folly::StringPiece& prefix) const;
+
+    // Fault the filter/index blocks covering [smallest, largest] into
+    // the block cache, plus the leading data blocks when
+    // --rocksdb_ingest_prewarm_data_mb is set
+    void prewarmRange(const std::string& smallest, const std::string& largest);
+
+    // Take an iterator out of the calling thread's pool, refreshed to
+    // the latest snapshot, or create one when the pool is empty. The
+    // traversal path opens one iterator per tag/edge per vertex, so
+    // reuse matters there
+    rocksdb::Iterator* acquireIter(bool totalOrder, rocksdb::ColumnFamilyHandle* cf);
+
+    // Hand an iterator back to the calling thread's pool, or delete it
+    // when the pool is full
+    void recycleIter(bool totalOrder, rocksdb::ColumnFamilyHandle* cf, rocksdb::Iterator* iter);
+
+    // Hand a cleared write batch back to the calling thread's pool, or
+    // delete it when the pool is full. Every raft apply round commits
+    // one batch per part, so reuse spares an allocation of the batch
+    // plus its high-water-mark sized buffer on each commit
+    void recycleBatch(std::unique_ptr<WriteBatch> batch);
+
+    // Group commit: queue the batch and either lead the write for
+    // everything queued so far or wait for the current leader to carry
+    // it. Parts sharing this engine commit one log batch each per raft
+    // apply, and this folds the concurrent ones into a single rocksdb
+    // write
+    ResultCode groupWrite(rocksdb::WriteBatch* batch, bool disableWAL);
+
 private:
+    // Record a sampled read into the warmup profile; cheap no-op when
+    // the warmup is disabled
+    void maybeRecordWarmup(CacheWarmup::AccessKind kind, const std::string& key);
+
     std::string  dataPath_;
+    int32_t vIdLen_;
+    // Shared with the rocksdb event listener, which reports background
+    // errors into it
+    std::shared_ptr<HealthTracker> health_{std::make_shared<HealthTracker>()};
+    // The last computed stall proximity and when it was computed; see
+    // writeStallPct(). Refreshed at most once per
+    // --write_stall_check_interval_ms, so the write path reads an
+    // atomic instead of polling rocksdb per request
+    std::atomic<int32_t> stallPct_{0};
+    std::atomic<int64_t> stallCheckedAtUs_{0};
+    // Sampled hot-key profile of this engine; null unless
+    // --block_cache_warmup is on
+    std::unique_ptr<CacheWarmup> warmup_{nullptr};
+    std::shared_ptr<rocksdb::RateLimiter> rateLimiter_{nullptr};
     std::unique_ptr<rocksdb::DB> db_{nullptr};
+    // Destroyed before db_, as column family handles must not outlive
+    // the DB they belong to
+    std::unique_ptr<rocksdb::ColumnFamilyHandle> indexCf_{nullptr};
+    std::unique_ptr<rocksdb::ColumnFamilyHandle> inEdgeCf_{nullptr};
+
+    struct IterPool {
+        // Indexed by [total order seek][column family], since an
+        // iterator is bound to its read options and column family
+        std::vector<std::unique_ptr<rocksdb::Iterator>> slots[2][3];
+    };
+    // Per-thread, and destroyed before db_: pooled iterators must not
+    // outlive the DB either
+    folly::ThreadLocal<IterPool> iterPool_;
+
+    struct BatchPool {
+        std::vector<std::unique_ptr<WriteBatch>> slots;
+    };
+    // Per-thread pool of cleared write batches, refilled by
+    // recycleBatch(); a recycled batch keeps its buffer, so steady
+    // commit traffic stops allocating batch memory altogether
+    folly::ThreadLocal<BatchPool> batchPool_;
+
     int32_t partsNum_ = -1;
+
+    // One queued commit waiting for the group leader
+    struct PendingWrite {
+        rocksdb::WriteBatch* batch;
+        bool disableWAL;
+        ResultCode result{ResultCode::SUCCEEDED};
+        bool done{false};
+    };
+    std::mutex writeLock_;
+    std::condition_variable writeCond_;
+    std::vector<PendingWrite*> writeQueue_;
+    bool writerActive_{false};
 };
 
 }  // namespace kvstore
@@ -6,6 +6,7 @@
 
 #include "common/base/Base.h"
 #include "common/conf/Configuration.h"
+#include "common/thrift/ThriftTypes.h"
 #include "kvstore/RocksEngineConfig.h"
 #include "kvstore/EventListner.h"
 #include <rocksdb/db.h>
@@ -13,31 +14,119 @@
 #include <rocksdb/convenience.h>
 #include <rocksdb/utilities/options_util.h>
 #include <rocksdb/slice_transform.h>
+#include <rocksdb/rate_limiter.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/statistics.h>
+#include <rocksdb/persistent_cache.h>
 
 // [WAL]
 DEFINE_bool(rocksdb_disable_wal,
             true,
             "Whether to disable the WAL in rocksdb");
 
+DEFINE_int64(rocksdb_bulk_scan_readahead,
+             4 << 20,
+             "Readahead size in bytes for bulk scans, e.g. whole-part scans "
+             "and index rebuilds. Bulk scans also skip the block cache");
+
+DEFINE_bool(rocksdb_merge_part_writes,
+            true,
+            "Whether to coalesce concurrent commits of partitions sharing an engine "
+            "into a single rocksdb write");
+
 // [DBOptions]
 DEFINE_string(rocksdb_db_options,
               "{}",
               "json string of DBOptions, all keys and values are string");
 
+DEFINE_bool(enable_rocksdb_statistics, false,
+            "Whether to create a rocksdb::Statistics object per engine. Its "
+            "ticker counters go out over the web service per engine; rocksdb "
+            "itself pays a few percent for maintaining them");
+
+DEFINE_bool(enable_cardinality_stats, false,
+            "Count vertex and edge entries per part in an sst table "
+            "properties collector as rocksdb builds the files, so per-tag "
+            "and per-edgeType cardinalities can be read off the table "
+            "properties instead of a full scan job");
+
 // [CFOptions "default"]
 DEFINE_string(rocksdb_column_family_options,
               "{}",
               "json string of ColumnFamilyOptions, all keys and values are string");
 
+DEFINE_string(rocksdb_option_profiles,
+              "{}",
+              "json string of named ColumnFamilyOptions profiles. Each key "
+              "names a profile and each value is a json object of options "
+              "overriding rocksdb_column_family_options key by key, e.g. "
+              "{\"write_heavy\": {\"write_buffer_size\": \"268435456\"}}");
+
+DEFINE_string(rocksdb_space_profiles,
+              "",
+              "Comma separated <spaceId>:<profile> pairs assigning a space "
+              "to one of the --rocksdb_option_profiles, so a write-heavy "
+              "space and a read-heavy one can run different memtable and "
+              "compaction settings in one process. Unlisted spaces use the "
+              "plain rocksdb_column_family_options");
+
 //  [TableOptions/BlockBasedTable "default"]
 DEFINE_string(rocksdb_block_based_table_options,
               "{}",
               "json string of BlockBasedTableOptions, all keys and values are string");
 
+// [CFOptions "index"]
+DEFINE_bool(rocksdb_separate_index_cf,
+            false,
+            "Whether to keep index entries in their own column family with a "
+            "dedicated block cache, so an index rebuild cannot evict the data "
+            "hot set. Once a space has been opened with the flag on, the "
+            "column family stays in use even if the flag is turned off again. "
+            "Index entries written before the flag was turned on are not "
+            "migrated and become invisible, so only enable it on new spaces");
+
+DEFINE_string(rocksdb_index_column_family_options,
+              "{}",
+              "json string of ColumnFamilyOptions of the index column family, "
+              "overriding rocksdb_column_family_options key by key");
+
+DEFINE_int64(rocksdb_index_block_cache, 256,
+             "The block cache size of the index column family. The unit is MB");
+
+// [CFOptions "in_edge"]
+DEFINE_bool(rocksdb_separate_in_edge_cf,
+            false,
+            "Whether to keep in-edges in their own column family, so the "
+            "edges arriving at a vertex compact next to each other instead "
+            "of interleaving with the outgoing ones, and a reverse traversal "
+            "scans a compact file set. Once a space has been opened with the "
+            "flag on, the column family stays in use even if the flag is "
+            "turned off again. In-edges written before the flag was turned "
+            "on are not migrated and become invisible, so only enable it on "
+            "new spaces, and not on spaces loaded through sst ingest, which "
+            "always lands in the default family");
+
+DEFINE_string(rocksdb_in_edge_column_family_options,
+              "{}",
+              "json string of ColumnFamilyOptions of the in-edge column "
+              "family, overriding rocksdb_column_family_options key by key");
+
+DEFINE_int64(rocksdb_in_edge_block_cache, 256,
+             "The block cache size of the in-edge column family. The unit is MB");
+
 DEFINE_int32(rocksdb_batch_size,
              4 * 1024,
              "default reserved bytes for one batch operation");
+
+DEFINE_int32(rocksdb_iterator_pool_size,
+             8,
+             "How many rocksdb iterators each thread caches per column "
+             "family for reuse across scans. 0 disables iterator reuse");
+
+DEFINE_int32(rocksdb_batch_pool_size,
+             4,
+             "How many write batches each thread keeps for reuse across "
+             "commits. 0 disables batch reuse");
 /*
  * For these un-supported string options as below, will need to specify them with gflag.
  */
@@ -46,12 +135,271 @@ DEFINE_int32(rocksdb_batch_size,
 DEFINE_int64(rocksdb_block_cache, 1024,
              "The default block cache size used in BlockBasedTable. The unit is MB");
 
+DEFINE_string(rocksdb_block_cache_quotas,
+              "",
+              "Comma separated <spaceId>:<MB> pairs. A listed space gets a "
+              "dedicated block cache of the given size, so its hot set cannot "
+              "be evicted by other spaces; all other spaces share the cache "
+              "sized by --rocksdb_block_cache");
+
+DEFINE_string(rocksdb_nvme_cache_path,
+              "",
+              "Directory on a fast SSD holding the persistent cache tier "
+              "under the DRAM block cache. Blocks evicted from DRAM are "
+              "served from there instead of the capacity disks. Empty "
+              "disables the tier");
+
+DEFINE_int64(rocksdb_nvme_cache_size, 16384,
+             "The size of the persistent cache tier shared by all engines "
+             "of the process. The unit is MB");
+
+DEFINE_string(rocksdb_nvme_cache_spaces,
+              "",
+              "Comma separated spaceIds enabling the persistent cache tier "
+              "per space, so a space fitting its DRAM cache does not churn "
+              "the tier. Empty enables it for all spaces");
+
+DEFINE_bool(rocksdb_direct_io, false,
+            "Whether to read and compact with O_DIRECT, so the block cache "
+            "is the only cache and the page cache stops double buffering "
+            "every block. Only worth it on hosts whose working set cannot "
+            "fit the page cache anyway");
+
+DEFINE_string(rocksdb_direct_io_spaces,
+              "",
+              "Comma separated spaceIds using direct I/O when "
+              "--rocksdb_direct_io is on, so a small space keeps the page "
+              "cache. Empty applies it to all spaces");
+
+DEFINE_string(rocksdb_blob_spaces,
+              "",
+              "Comma separated <spaceId>:<KB> pairs enabling value "
+              "separation per space. A listed space stores values larger "
+              "than the given threshold in blob files next to the sst "
+              "files, so the LSM levels hold keys and small values only "
+              "and compactions stop rewriting the heavy property payloads "
+              "level after level. Empty disables value separation");
+
+DEFINE_int64(rocksdb_blob_file_size, 256,
+             "Target size of one blob file. The unit is MB");
+
+DEFINE_double(rocksdb_blob_gc_age_cutoff, 0.25,
+              "Compactions relocate the live blobs of the oldest fraction "
+              "of blob files given here, so space held by overwritten or "
+              "deleted values is reclaimed. 0 disables blob garbage "
+              "collection");
+
 DEFINE_bool(enable_partitioned_index_filter, false, "True for partitioned index filters");
 
+DEFINE_int32(rocksdb_rate_limit, 0,
+             "Write rate limit in MB/s applied to flush, compaction and "
+             "ingest of one engine, i.e. one disk, keeping background I/O "
+             "from starving the foreground reads. 0 means unlimited");
+
+DEFINE_int32(rocksdb_ingest_prewarm_data_mb, 0,
+             "When ingesting with pre-warm, also scan up to this many MB "
+             "of data blocks per ingested file range into the block cache, "
+             "on top of the filter/index blocks that are always warmed. "
+             "0 warms filter/index blocks only");
+
+DEFINE_int32(rocksdb_stall_check_interval_ms, 1000,
+             "How often writeStallPct() recomputes the stall proximity of "
+             "an engine from the rocksdb internal metrics; between two "
+             "checks the write path reads the cached value");
+
+DEFINE_bool(enable_rocksdb_prefix_filtering,
+            false,
+            "Whether to enable prefix bloom filter in rocksdb, both in the "
+            "memtables and the sst files. The prefix is sized to partId + "
+            "vid, so prefix seeks of a vertex and its edges can skip sst "
+            "files that cannot contain the prefix. Must not be turned on "
+            "for spaces whose data was written with a different vid length");
+
 namespace nebula {
 namespace kvstore {
 
-rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts) {
+const char kIndexColumnFamilyName[] = "index";
+const char kInEdgeColumnFamilyName[] = "in_edge";
+
+namespace {
+
+// All the block caches of the process by name, so usage can be
+// inspected per cache through the web service
+std::mutex blockCacheLock;
+std::vector<std::pair<std::string, std::shared_ptr<rocksdb::Cache>>> blockCaches;
+
+std::shared_ptr<rocksdb::Cache> getOrCreateCache(const std::string& name, int64_t capacityMB) {
+    std::lock_guard<std::mutex> g(blockCacheLock);
+    for (auto& cache : blockCaches) {
+        if (cache.first == name) {
+            return cache.second;
+        }
+    }
+    auto cache = rocksdb::NewLRUCache(capacityMB * 1024 * 1024);
+    blockCaches.emplace_back(name, cache);
+    return cache;
+}
+
+// The ColumnFamilyOptions overrides of the profile the space is
+// assigned to, empty when the space has no profile
+std::unordered_map<std::string, std::string> spaceProfileOptions(GraphSpaceID spaceId) {
+    std::unordered_map<std::string, std::string> map;
+    std::string profile;
+    std::vector<std::string> assigns;
+    folly::split(",", FLAGS_rocksdb_space_profiles, assigns, true);
+    for (auto& assign : assigns) {
+        std::vector<std::string> pair;
+        folly::split(":", assign, pair, true);
+        if (pair.size() != 2) {
+            LOG(ERROR) << "Ignore malformed space profile \"" << assign << "\"";
+            continue;
+        }
+        try {
+            if (folly::to<GraphSpaceID>(pair[0]) == spaceId) {
+                profile = pair[1];
+                break;
+            }
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "Ignore malformed space profile \"" << assign << "\"";
+        }
+    }
+    if (profile.empty()) {
+        return map;
+    }
+    conf::Configuration conf;
+    auto status = conf.parseFromString(FLAGS_rocksdb_option_profiles);
+    if (!status.ok()) {
+        LOG(ERROR) << "Ignore malformed option profiles";
+        return map;
+    }
+    bool found = false;
+    conf.forEachItem([&] (const std::string& name, const folly::dynamic& opts) {
+        if (name != profile || !opts.isObject()) {
+            return;
+        }
+        found = true;
+        for (auto& kv : opts.items()) {
+            LOG(INFO) << "Emplace rocksdb option " << kv.first.asString() << "="
+                      << kv.second.asString() << " of profile " << profile
+                      << " for space " << spaceId;
+            map.emplace(kv.first.asString(), kv.second.asString());
+        }
+    });
+    if (!found) {
+        LOG(ERROR) << "Option profile \"" << profile << "\" of space " << spaceId
+                   << " is not defined";
+    }
+    return map;
+}
+
+// One persistent cache for the whole process: the tier sits on one
+// NVMe device, and a shared cache lets a hot space use whatever a cold
+// one does not
+std::mutex nvmeCacheLock;
+std::shared_ptr<rocksdb::PersistentCache> nvmeCache;
+
+std::shared_ptr<rocksdb::PersistentCache> getNvmeCache() {
+    std::lock_guard<std::mutex> g(nvmeCacheLock);
+    if (nvmeCache) {
+        return nvmeCache;
+    }
+    std::shared_ptr<rocksdb::PersistentCache> cache;
+    auto status = rocksdb::NewPersistentCache(rocksdb::Env::Default(),
+                                              FLAGS_rocksdb_nvme_cache_path,
+                                              FLAGS_rocksdb_nvme_cache_size * 1024 * 1024,
+                                              nullptr,
+                                              true /* optimized_for_nvm */,
+                                              &cache);
+    if (!status.ok()) {
+        LOG(ERROR) << "Open the persistent cache in " << FLAGS_rocksdb_nvme_cache_path
+                   << " failed: " << status.ToString();
+        return nullptr;
+    }
+    nvmeCache = cache;
+    return nvmeCache;
+}
+
+// Whether the space is in the comma separated list; an empty list
+// means every space
+bool spaceListed(const std::string& list, GraphSpaceID spaceId) {
+    if (list.empty()) {
+        return true;
+    }
+    std::vector<std::string> spaces;
+    folly::split(",", list, spaces, true);
+    for (auto& space : spaces) {
+        try {
+            if (folly::to<GraphSpaceID>(space) == spaceId) {
+                return true;
+            }
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "Ignore malformed space id \"" << space << "\"";
+        }
+    }
+    return false;
+}
+
+bool nvmeCacheEnabled(GraphSpaceID spaceId) {
+    return !FLAGS_rocksdb_nvme_cache_path.empty() &&
+           spaceListed(FLAGS_rocksdb_nvme_cache_spaces, spaceId);
+}
+
+// The value separation threshold of the space in bytes, or -1 when the
+// space is not listed in FLAGS_rocksdb_blob_spaces
+int64_t spaceBlobThreshold(GraphSpaceID spaceId) {
+    std::vector<std::string> pairs;
+    folly::split(",", FLAGS_rocksdb_blob_spaces, pairs, true);
+    for (auto& entry : pairs) {
+        std::vector<std::string> pair;
+        folly::split(":", entry, pair, true);
+        if (pair.size() != 2) {
+            LOG(ERROR) << "Ignore malformed blob space \"" << entry << "\"";
+            continue;
+        }
+        try {
+            if (folly::to<GraphSpaceID>(pair[0]) == spaceId) {
+                return folly::to<int64_t>(pair[1]) * 1024;
+            }
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "Ignore malformed blob space \"" << entry << "\"";
+        }
+    }
+    return -1;
+}
+
+}  // Anonymous namespace
+
+std::shared_ptr<rocksdb::Cache> spaceBlockCache(GraphSpaceID spaceId) {
+    std::vector<std::string> quotas;
+    folly::split(",", FLAGS_rocksdb_block_cache_quotas, quotas, true);
+    for (auto& quota : quotas) {
+        std::vector<std::string> pair;
+        folly::split(":", quota, pair, true);
+        if (pair.size() != 2) {
+            LOG(ERROR) << "Ignore malformed block cache quota \"" << quota << "\"";
+            continue;
+        }
+        try {
+            if (folly::to<GraphSpaceID>(pair[0]) == spaceId) {
+                return getOrCreateCache(folly::stringPrintf("space_%d", spaceId),
+                                        folly::to<int64_t>(pair[1]));
+            }
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "Ignore malformed block cache quota \"" << quota << "\"";
+        }
+    }
+    return getOrCreateCache("default", FLAGS_rocksdb_block_cache);
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<rocksdb::Cache>>> allBlockCaches() {
+    std::lock_guard<std::mutex> g(blockCacheLock);
+    return blockCaches;
+}
+
+rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts,
+                                   GraphSpaceID spaceId,
+                                   int32_t vidLen,
+                                   std::shared_ptr<HealthTracker> health) {
     rocksdb::Status s;
     rocksdb::DBOptions dbOpts;
     rocksdb::ColumnFamilyOptions cfOpts;
@@ -65,9 +413,21 @@ rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts) {
     if (!s.ok()) {
         return s;
     }
-    dbOpts.listeners.emplace_back(new EventListener());
+    dbOpts.listeners.emplace_back(new EventListener(std::move(health)));
+    if (FLAGS_enable_rocksdb_statistics) {
+        // one object per engine, reachable later via GetDBOptions()
+        dbOpts.statistics = rocksdb::CreateDBStatistics();
+    }
+    if (FLAGS_rocksdb_rate_limit > 0) {
+        // One limiter per engine, so the limit is per disk
+        dbOpts.rate_limiter.reset(
+            rocksdb::NewGenericRateLimiter(FLAGS_rocksdb_rate_limit * 1024 * 1024L));
+    }
 
-    std::unordered_map<std::string, std::string> cfOptsMap;
+    // The profile assigned to the space overrides the default CF
+    // options key by key: loadOptionsMap() keeps the existing entry on
+    // duplicated keys, hence the profile is loaded first
+    std::unordered_map<std::string, std::string> cfOptsMap = spaceProfileOptions(spaceId);
     if (!loadOptionsMap(cfOptsMap, FLAGS_rocksdb_column_family_options)) {
         return rocksdb::Status::InvalidArgument();
     }
@@ -78,6 +438,31 @@ rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts) {
 
     baseOpts = rocksdb::Options(dbOpts, cfOpts);
 
+    if (FLAGS_rocksdb_direct_io && spaceListed(FLAGS_rocksdb_direct_io_spaces, spaceId)) {
+        baseOpts.use_direct_reads = true;
+        baseOpts.use_direct_io_for_flush_and_compaction = true;
+        if (baseOpts.compaction_readahead_size == 0) {
+            // with O_DIRECT there is no page cache readahead, the
+            // compaction reads have to bring their own
+            baseOpts.compaction_readahead_size = 2 << 20;
+        }
+    }
+
+    auto blobThreshold = spaceBlobThreshold(spaceId);
+    if (blobThreshold >= 0) {
+        // Keys and values below the threshold stay in the LSM, so the
+        // block cache keeps serving them; only the heavy payloads move
+        // out and are fetched with one extra read on a hit
+        baseOpts.enable_blob_files = true;
+        baseOpts.min_blob_size = blobThreshold;
+        baseOpts.blob_file_size = FLAGS_rocksdb_blob_file_size * 1024 * 1024;
+        baseOpts.blob_compression_type = baseOpts.compression;
+        if (FLAGS_rocksdb_blob_gc_age_cutoff > 0.0) {
+            baseOpts.enable_blob_garbage_collection = true;
+            baseOpts.blob_garbage_collection_age_cutoff = FLAGS_rocksdb_blob_gc_age_cutoff;
+        }
+    }
+
     std::unordered_map<std::string, std::string> bbtOptsMap;
     if (!loadOptionsMap(bbtOptsMap, FLAGS_rocksdb_block_based_table_options)) {
         return rocksdb::Status::InvalidArgument();
@@ -88,9 +473,16 @@ rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts) {
         return s;
     }
 
-    static std::shared_ptr<rocksdb::Cache> blockCache
-        = rocksdb::NewLRUCache(FLAGS_rocksdb_block_cache * 1024 * 1024);
-    bbtOpts.block_cache = blockCache;
+    bbtOpts.block_cache = spaceBlockCache(spaceId);
+    if (nvmeCacheEnabled(spaceId)) {
+        // Bulk scans read with fill_cache off, so one-off scans are not
+        // admitted into either tier; what lands here is the point-read
+        // and seek working set evicted from DRAM
+        auto cache = getNvmeCache();
+        if (cache != nullptr) {
+            bbtOpts.persistent_cache = cache;
+        }
+    }
     bbtOpts.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
     if (FLAGS_enable_partitioned_index_filter) {
         bbtOpts.index_type = rocksdb::BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
@@ -100,11 +492,104 @@ rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts) {
         bbtOpts.pin_l0_filter_and_index_blocks_in_cache =
             baseOpts.compaction_style == rocksdb::CompactionStyle::kCompactionStyleLevel;
     }
+    if (FLAGS_enable_rocksdb_prefix_filtering) {
+        // partId + vid is the longest prefix shared by a vertex and all
+        // of its edges, which is what the exec nodes seek with
+        baseOpts.prefix_extractor.reset(
+            rocksdb::NewCappedPrefixTransform(sizeof(PartitionID) + vidLen));
+        baseOpts.memtable_prefix_bloom_size_ratio = 0.1;
+        // The filter block holds either whole-key or prefix blooms,
+        // not both
+        bbtOpts.whole_key_filtering = false;
+    }
     baseOpts.table_factory.reset(NewBlockBasedTableFactory(bbtOpts));
     baseOpts.create_if_missing = true;
     return s;
 }
 
+rocksdb::Status initIndexColumnFamilyOptions(rocksdb::ColumnFamilyOptions &cfOpts) {
+    rocksdb::Status s;
+    rocksdb::BlockBasedTableOptions bbtOpts;
+
+    // The index specific options take precedence over the default CF
+    // options, so only the differences have to be configured. Note that
+    // loadOptionsMap() keeps the existing entry on duplicated keys,
+    // hence the overrides are loaded first
+    std::unordered_map<std::string, std::string> cfOptsMap;
+    if (!loadOptionsMap(cfOptsMap, FLAGS_rocksdb_index_column_family_options)) {
+        return rocksdb::Status::InvalidArgument();
+    }
+    if (!loadOptionsMap(cfOptsMap, FLAGS_rocksdb_column_family_options)) {
+        return rocksdb::Status::InvalidArgument();
+    }
+    s = GetColumnFamilyOptionsFromMap(rocksdb::ColumnFamilyOptions(), cfOptsMap, &cfOpts, true);
+    if (!s.ok()) {
+        return s;
+    }
+
+    std::unordered_map<std::string, std::string> bbtOptsMap;
+    if (!loadOptionsMap(bbtOptsMap, FLAGS_rocksdb_block_based_table_options)) {
+        return rocksdb::Status::InvalidArgument();
+    }
+    s = GetBlockBasedTableOptionsFromMap(rocksdb::BlockBasedTableOptions(), bbtOptsMap,
+                                         &bbtOpts, true);
+    if (!s.ok()) {
+        return s;
+    }
+
+    bbtOpts.block_cache = getOrCreateCache(kIndexColumnFamilyName,
+                                           FLAGS_rocksdb_index_block_cache);
+    bbtOpts.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+    cfOpts.table_factory.reset(NewBlockBasedTableFactory(bbtOpts));
+    return s;
+}
+
+rocksdb::Status initInEdgeColumnFamilyOptions(rocksdb::ColumnFamilyOptions &cfOpts,
+                                              int32_t vidLen) {
+    rocksdb::Status s;
+    rocksdb::BlockBasedTableOptions bbtOpts;
+
+    // As with the index family, the in-edge specific options take
+    // precedence over the default CF options, so only the differences
+    // have to be configured
+    std::unordered_map<std::string, std::string> cfOptsMap;
+    if (!loadOptionsMap(cfOptsMap, FLAGS_rocksdb_in_edge_column_family_options)) {
+        return rocksdb::Status::InvalidArgument();
+    }
+    if (!loadOptionsMap(cfOptsMap, FLAGS_rocksdb_column_family_options)) {
+        return rocksdb::Status::InvalidArgument();
+    }
+    s = GetColumnFamilyOptionsFromMap(rocksdb::ColumnFamilyOptions(), cfOptsMap, &cfOpts, true);
+    if (!s.ok()) {
+        return s;
+    }
+
+    std::unordered_map<std::string, std::string> bbtOptsMap;
+    if (!loadOptionsMap(bbtOptsMap, FLAGS_rocksdb_block_based_table_options)) {
+        return rocksdb::Status::InvalidArgument();
+    }
+    s = GetBlockBasedTableOptionsFromMap(rocksdb::BlockBasedTableOptions(), bbtOptsMap,
+                                         &bbtOpts, true);
+    if (!s.ok()) {
+        return s;
+    }
+
+    bbtOpts.block_cache = getOrCreateCache(kInEdgeColumnFamilyName,
+                                           FLAGS_rocksdb_in_edge_block_cache);
+    bbtOpts.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+    if (FLAGS_enable_rocksdb_prefix_filtering) {
+        // In-edge keys start with partId + vid like the default
+        // family's keys, so the same extractor serves the reverse
+        // traversal seeks
+        cfOpts.prefix_extractor.reset(
+            rocksdb::NewCappedPrefixTransform(sizeof(PartitionID) + vidLen));
+        cfOpts.memtable_prefix_bloom_size_ratio = 0.1;
+        bbtOpts.whole_key_filtering = false;
+    }
+    cfOpts.table_factory.reset(NewBlockBasedTableFactory(bbtOpts));
+    return s;
+}
+
 bool loadOptionsMap(std::unordered_map<std::string, std::string> &map, const std::string& gflags) {
     conf::Configuration conf;
     auto status = conf.parseFromString(gflags);
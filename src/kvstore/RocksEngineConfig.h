@@ -8,6 +8,8 @@
 #define KVSTORE_ROCKSENGINECONFIG_H_
 
 #include "common/base/Base.h"
+#include "common/thrift/ThriftTypes.h"
+#include "kvstore/EngineHealth.h"
 #include <rocksdb/db.h>
 
 // [Version]
@@ -18,6 +20,18 @@ DECLARE_string(rocksdb_db_options);
 
 // [CFOptions "default"]
 DECLARE_string(rocksdb_column_family_options);
+DECLARE_string(rocksdb_option_profiles);
+DECLARE_string(rocksdb_space_profiles);
+
+// [CFOptions "index"]
+DECLARE_bool(rocksdb_separate_index_cf);
+DECLARE_string(rocksdb_index_column_family_options);
+DECLARE_int64(rocksdb_index_block_cache);
+
+// [CFOptions "in_edge"]
+DECLARE_bool(rocksdb_separate_in_edge_cf);
+DECLARE_string(rocksdb_in_edge_column_family_options);
+DECLARE_int64(rocksdb_in_edge_block_cache);
 
 //  [TableOptions/BlockBasedTable "default"]
 DECLARE_string(rocksdb_block_based_table_options);
@@ -27,19 +41,78 @@ DECLARE_string(memtable_factory);
 
 // rocksdb db wal disable
 DECLARE_bool(rocksdb_disable_wal);
+DECLARE_bool(rocksdb_merge_part_writes);
+DECLARE_bool(enable_rocksdb_statistics);
+DECLARE_bool(enable_cardinality_stats);
+DECLARE_int64(rocksdb_bulk_scan_readahead);
 
 // BlockBasedTable block_cache
 DECLARE_int64(rocksdb_block_cache);
+DECLARE_string(rocksdb_block_cache_quotas);
+
+// BlobDB-style value separation
+DECLARE_string(rocksdb_blob_spaces);
+DECLARE_int64(rocksdb_blob_file_size);
+DECLARE_double(rocksdb_blob_gc_age_cutoff);
+
+// prefix bloom filter
+DECLARE_bool(enable_rocksdb_prefix_filtering);
 
 DECLARE_int32(rocksdb_batch_size);
 
+DECLARE_int32(rocksdb_iterator_pool_size);
+DECLARE_int32(rocksdb_batch_pool_size);
+
+DECLARE_int32(rocksdb_rate_limit);
+
+DECLARE_int32(rocksdb_ingest_prewarm_data_mb);
+
+DECLARE_int32(rocksdb_stall_check_interval_ms);
+
 DECLARE_string(part_man_type);
 
 
 namespace nebula {
 namespace kvstore {
 
-rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts);
+// The name of the column family holding the index entries when
+// FLAGS_rocksdb_separate_index_cf is on
+extern const char kIndexColumnFamilyName[];
+
+// The name of the column family holding the in-edges when
+// FLAGS_rocksdb_separate_in_edge_cf is on
+extern const char kInEdgeColumnFamilyName[];
+
+// vidLen sizes the prefix extractor to the partId + vid prefix all the
+// vertex and edge scans seek with; it only matters when
+// FLAGS_enable_rocksdb_prefix_filtering is on. The health tracker, when
+// given, receives the background-error callbacks of the engine
+rocksdb::Status initRocksdbOptions(rocksdb::Options &baseOpts,
+                                   GraphSpaceID spaceId = 0,
+                                   int32_t vidLen = sizeof(int64_t),
+                                   std::shared_ptr<HealthTracker> health = nullptr);
+
+// The block cache the given space should use: its dedicated cache when
+// a quota is configured in FLAGS_rocksdb_block_cache_quotas, the shared
+// default cache otherwise
+std::shared_ptr<rocksdb::Cache> spaceBlockCache(GraphSpaceID spaceId);
+
+// Every block cache of the process with its name ("default", "index" or
+// "space_<id>"), for the stats endpoint of the web service
+std::vector<std::pair<std::string, std::shared_ptr<rocksdb::Cache>>> allBlockCaches();
+
+// Build the options of the index column family: the default CF options
+// overridden by FLAGS_rocksdb_index_column_family_options, with its own
+// block cache, so index compactions cannot evict the data hot set
+rocksdb::Status initIndexColumnFamilyOptions(rocksdb::ColumnFamilyOptions &cfOpts);
+
+// Build the options of the in-edge column family: the default CF
+// options overridden by FLAGS_rocksdb_in_edge_column_family_options,
+// with its own block cache. In-edge keys carry the partId + vid prefix
+// like the default family's keys do, so the family keeps the prefix
+// extractor and the reverse traversal seeks stay bloom filtered
+rocksdb::Status initInEdgeColumnFamilyOptions(rocksdb::ColumnFamilyOptions &cfOpts,
+                                              int32_t vidLen);
 
 bool loadOptionsMap(std::unordered_map<std::string, std::string> &map, const std::string& gflags);
 
@@ -16,40 +16,49 @@ void SnapshotManagerImpl::accessAllRowsInSnapshot(GraphSpaceID spaceId,
                                                   PartitionID partId,
                                                   raftex::SnapshotCallback cb) {
     CHECK_NOTNULL(store_);
-    std::unique_ptr<KVIterator> iter;
-    auto prefix = NebulaKeyUtils::partPrefix(partId);
+    // The vid dictionary lives under system keys outside the data
+    // range, and a replica rebuilt from the snapshot cannot resolve its
+    // aliased keys without it, so it travels first
+    std::vector<std::string> prefixes{NebulaKeyUtils::systemVidAliasPrefix(partId),
+                                      NebulaKeyUtils::partPrefix(partId)};
     std::vector<std::string> data;
     int64_t totalSize = 0;
     int64_t totalCount = 0;
-    auto ret = store_->prefix(spaceId, partId, prefix, &iter);
-    if (ret != ResultCode::SUCCEEDED) {
-        LOG(INFO) << "[spaceId:" << spaceId << ", partId:" << partId << "] access prefix failed"
-                  << ", error code:" << static_cast<int32_t>(ret);
-        cb(data, totalCount, totalSize, raftex::SnapshotStatus::FAILED);
-        return;
-    }
     data.reserve(kReserveNum);
     int32_t batchSize = 0;
-    while (iter && iter->valid()) {
-        if (batchSize >= FLAGS_snapshot_batch_size) {
-            if (cb(data, totalCount, totalSize, raftex::SnapshotStatus::IN_PROGRESS)) {
-                data.clear();
-                batchSize = 0;
-            } else {
-                LOG(INFO) << "[spaceId:" << spaceId << ", partId:" << partId
-                          << "] callback invoked failed";
-                return;
+    for (const auto& prefix : prefixes) {
+        std::unique_ptr<KVIterator> iter;
+        auto ret = store_->prefix(spaceId, partId, prefix, &iter);
+        if (ret != ResultCode::SUCCEEDED) {
+            LOG(INFO) << "[spaceId:" << spaceId << ", partId:" << partId
+                      << "] access prefix failed"
+                      << ", error code:" << static_cast<int32_t>(ret);
+            cb(std::move(data), totalCount, totalSize, raftex::SnapshotStatus::FAILED);
+            return;
+        }
+        while (iter && iter->valid()) {
+            if (batchSize >= FLAGS_snapshot_batch_size) {
+                if (cb(std::move(data), totalCount, totalSize,
+                       raftex::SnapshotStatus::IN_PROGRESS)) {
+                    data.clear();
+                    data.reserve(kReserveNum);
+                    batchSize = 0;
+                } else {
+                    LOG(INFO) << "[spaceId:" << spaceId << ", partId:" << partId
+                              << "] callback invoked failed";
+                    return;
+                }
             }
+            auto key = iter->key();
+            auto val = iter->val();
+            data.emplace_back(encodeKV(key, val));
+            batchSize += data.back().size();
+            totalSize += data.back().size();
+            totalCount++;
+            iter->next();
         }
-        auto key = iter->key();
-        auto val = iter->val();
-        data.emplace_back(encodeKV(key, val));
-        batchSize += data.back().size();
-        totalSize += data.back().size();
-        totalCount++;
-        iter->next();
     }
-    cb(data, totalCount, totalSize, raftex::SnapshotStatus::DONE);
+    cb(std::move(data), totalCount, totalSize, raftex::SnapshotStatus::DONE);
 }
 }  // namespace kvstore
 }  // namespace nebula
@@ -13,17 +13,21 @@
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp2/async/HeaderClientChannel.h>
 
+DEFINE_int32(hbase_client_connections, 4,
+             "Connections to the HBase thrift gateway, each driven by its "
+             "own IO thread. Concurrent requests spread over them round "
+             "robin instead of serializing on a single channel");
 
 namespace nebula {
 namespace kvstore {
 
 const char* kColumnFamilyName = "cf";
 
-HBaseClient::HBaseClient(const HostAddr& host) {
+HBaseClient::HBaseClient(const HostAddr& host) : host_(host) {
     clientsMan_ = std::make_shared<thrift::ThriftClientManager<
                                    THBaseServiceAsyncClient>>();
-    auto evb = folly::EventBaseManager::get()->getEventBase();
-    client_ = clientsMan_->client(host, evb, true);
+    ioPool_ = std::make_shared<folly::IOThreadPoolExecutor>(
+        std::max(1, FLAGS_hbase_client_connections));
 }
 
 
@@ -31,6 +35,51 @@ HBaseClient::~HBaseClient() {
 }
 
 
+std::pair<folly::EventBase*, std::shared_ptr<THBaseServiceAsyncClient>>
+HBaseClient::connection() {
+    auto evb = ioPool_->getEventBase();
+    return {evb, clientsMan_->client(host_, evb, true)};
+}
+
+
+std::vector<TPut> HBaseClient::buildPuts(
+        const std::vector<std::pair<std::string, std::vector<KV>>>& dataList) {
+    std::vector<TPut> tPutList;
+    for (auto& data : dataList) {
+        TPut tPut;
+        tPut.set_row(data.first);
+        std::vector<TColumnValue> tColumnValueList;
+        for (auto& kv : data.second) {
+            TColumnValue tColumnValue;
+            tColumnValue.set_family(kColumnFamilyName);
+            tColumnValue.set_qualifier(kv.first);
+            tColumnValue.set_value(kv.second);
+            tColumnValueList.emplace_back(tColumnValue);
+        }
+        tPut.set_columnValues(tColumnValueList);
+        tPutList.emplace_back(tPut);
+    }
+    return tPutList;
+}
+
+
+std::vector<TDelete> HBaseClient::buildDeletes(const std::vector<std::string>& rowKeys) {
+    std::vector<TDelete> tDeleteList;
+    for (auto& rowKey : rowKeys) {
+        TDelete tDelete;
+        tDelete.set_row(rowKey);
+        TColumn tColumn;
+        tColumn.set_family(kColumnFamilyName);
+        std::vector<TColumn> tColumnList;
+        tColumnList.emplace_back(tColumn);
+        tDelete.set_columns(tColumnList);
+        tDelete.set_durability(TDurability::ASYNC_WAL);
+        tDeleteList.emplace_back(tDelete);
+    }
+    return tDeleteList;
+}
+
+
 ResultCode HBaseClient::get(const std::string& tableName,
                             const std::string& rowKey,
                             KVMap& data) {
@@ -42,9 +91,13 @@ ResultCode HBaseClient::get(const std::string& tableName,
     tColumnList.emplace_back(tColumn);
     tGet.set_columns(tColumnList);
 
-    TResult tResult;
+    auto conn = connection();
     try {
-        client_->sync_get(tResult, tableName, tGet);
+        // The caller blocks in get() until the future is fulfilled, so
+        // the captured references outlive the lambda
+        auto tResult = folly::via(conn.first, [client = conn.second, &tableName, &tGet] {
+            return client->future_get(tableName, tGet);
+        }).get();
         std::vector<TColumnValue> tColumnValueList = tResult.columnValues;
         if (tColumnValueList.size() > 0) {
             for (auto& cv : tColumnValueList) {
@@ -81,11 +134,13 @@ std::pair<ResultCode, std::vector<Status>> HBaseClient::multiGet(
         tGetList.emplace_back(tGet);
     }
 
-    std::vector<TResult> tResultList;
     std::vector<Status> status;
     ResultCode resultCode = ResultCode::SUCCEEDED;
+    auto conn = connection();
     try {
-        client_->sync_getMultiple(tResultList, tableName, tGetList);
+        auto tResultList = folly::via(conn.first, [client = conn.second, &tableName, &tGetList] {
+            return client->future_getMultiple(tableName, tGetList);
+        }).get();
         for (auto& tResult : tResultList) {
             std::vector<TColumnValue> tColumnValueList = tResult.columnValues;
             if (tColumnValueList.size() > 0) {
@@ -128,8 +183,11 @@ ResultCode HBaseClient::put(const std::string& tableName,
     }
     tPut.set_columnValues(tColumnValueList);
 
+    auto conn = connection();
     try {
-        client_->sync_put(tableName, tPut);
+        folly::via(conn.first, [client = conn.second, &tableName, &tPut] {
+            return client->future_put(tableName, tPut);
+        }).get();
         return ResultCode::SUCCEEDED;
     } catch (const TIOError &ex) {
         LOG(ERROR) << "TIOError: " << ex.message;
@@ -144,34 +202,24 @@ ResultCode HBaseClient::put(const std::string& tableName,
 
 ResultCode HBaseClient::multiPut(const std::string& tableName,
                                  std::vector<std::pair<std::string, std::vector<KV>>>& dataList) {
-    std::vector<TPut> tPutList;
-    for (auto& data : dataList) {
-        TPut tPut;
-        tPut.set_row(data.first);
-        auto kvs = data.second;
-        std::vector<TColumnValue> tColumnValueList;
-        for (auto& kv : kvs) {
-            TColumnValue tColumnValue;
-            tColumnValue.set_family(kColumnFamilyName);
-            tColumnValue.set_qualifier(kv.first);
-            tColumnValue.set_value(kv.second);
-            tColumnValueList.emplace_back(tColumnValue);
-        }
-        tPut.set_columnValues(tColumnValueList);
-        tPutList.emplace_back(tPut);
-    }
+    return asyncMultiPut(tableName, dataList).get();
+}
 
-    try {
-        client_->sync_putMultiple(tableName, tPutList);
+
+folly::Future<ResultCode> HBaseClient::asyncMultiPut(
+        const std::string& tableName,
+        std::vector<std::pair<std::string, std::vector<KV>>> dataList) {
+    auto tPutList = buildPuts(dataList);
+    auto conn = connection();
+    return folly::via(conn.first,
+                      [client = conn.second, tableName, tPutList = std::move(tPutList)] () mutable {
+        return client->future_putMultiple(tableName, tPutList);
+    }).thenValue([] (auto&&) {
         return ResultCode::SUCCEEDED;
-    } catch (const TIOError &ex) {
-        LOG(ERROR) << "TIOError: " << ex.message;
+    }).thenError([] (auto&& e) {
+        LOG(ERROR) << "MultiPut Failed: " << e.what();
         return ResultCode::ERR_IO_ERROR;
-    } catch (const apache::thrift::transport::TTransportException &tte) {
-        LOG(ERROR) << "TTransportException: " << tte.what();
-        return ResultCode::ERR_IO_ERROR;
-    }
-    return ResultCode::ERR_UNKNOWN;
+    });
 }
 
 
@@ -179,8 +227,6 @@ ResultCode HBaseClient::range(const std::string& tableName,
                               const std::string& startRowKey,
                               const std::string& endRowKey,
                               std::vector<std::pair<std::string, KVMap>>& dataList) {
-    // TODO(zhangguoqing) This is a simple implementation that get all results immediately,
-    // and in the future, it will use HBaseScanIter to improve performance.
     TScan tScan;
     tScan.set_startRow(startRowKey);
     tScan.set_stopRow(endRowKey);
@@ -189,15 +235,41 @@ ResultCode HBaseClient::range(const std::string& tableName,
     tColumn.set_family(kColumnFamilyName);
     tColumnList.emplace_back(tColumn);
     tScan.set_columns(tColumnList);
-    tScan.set_caching(kScanRowNum * kScanRowNum);
+    tScan.set_caching(kScanRowNum);
 
+    // The scanner is stateful on its connection, so the whole scan is
+    // pinned to one slot of the pool
+    auto conn = connection();
+    auto evb = conn.first;
+    auto client = conn.second;
     int32_t scannerId = -1;
+    auto closeScanner = [&] {
+        if (scannerId < 0) {
+            return;
+        }
+        try {
+            folly::via(evb, [client, scannerId] {
+                return client->future_closeScanner(scannerId);
+            }).get();
+        } catch (const std::exception& ex) {
+            LOG(ERROR) << "closeScanner Failed: " << ex.what();
+        }
+    };
     try {
-        scannerId = client_->sync_openScanner(tableName, tScan);
+        scannerId = folly::via(evb, [client, &tableName, &tScan] {
+            return client->future_openScanner(tableName, tScan);
+        }).get();
+        // Keep one fetch in flight: while batch N is converted below,
+        // batch N + 1 is already on the wire
+        auto pending = folly::via(evb, [client, scannerId, num = kScanRowNum] {
+            return client->future_getScannerRows(scannerId, num);
+        });
         while (true) {
-            std::vector<TResult> tResultList;
-            client_->sync_getScannerRows(tResultList, scannerId, kScanRowNum);
+            auto tResultList = std::move(pending).get();
             if (tResultList.size() == 0) break;
+            pending = folly::via(evb, [client, scannerId, num = kScanRowNum] {
+                return client->future_getScannerRows(scannerId, num);
+            });
             for (auto& tResult : tResultList) {
                 std::vector<TColumnValue> tColumnValueList = tResult.columnValues;
                 if (tColumnValueList.size() > 0) {
@@ -209,16 +281,15 @@ ResultCode HBaseClient::range(const std::string& tableName,
                     dataList.emplace_back(std::make_pair(rowKey, std::move(data)));
                 }
             }
-            tResultList.clear();
         }
-        client_->sync_closeScanner(scannerId);
+        closeScanner();
         return ResultCode::SUCCEEDED;
     } catch (const TIOError &ex) {
-        if (scannerId >= 0) client_->sync_closeScanner(scannerId);
+        closeScanner();
         LOG(ERROR) << "TIOError: " << ex.message;
         return ResultCode::ERR_IO_ERROR;
     } catch (const apache::thrift::transport::TTransportException &tte) {
-        if (scannerId >= 0) client_->sync_closeScanner(scannerId);
+        closeScanner();
         LOG(ERROR) << "TTransportException: " << tte.what();
         return ResultCode::ERR_IO_ERROR;
     }
@@ -228,8 +299,14 @@ ResultCode HBaseClient::range(const std::string& tableName,
 
 ResultCode HBaseClient::remove(const std::string& tableName,
                                const std::string& rowKey) {
+    return asyncRemove(tableName, rowKey).get();
+}
+
+
+folly::Future<ResultCode> HBaseClient::asyncRemove(const std::string& tableName,
+                                                   std::string rowKey) {
     TDelete tDelete;
-    tDelete.set_row(rowKey);
+    tDelete.set_row(std::move(rowKey));
     TColumn tColumn;
     tColumn.set_family(kColumnFamilyName);
     std::vector<TColumn> tColumnList;
@@ -237,48 +314,39 @@ ResultCode HBaseClient::remove(const std::string& tableName,
     tDelete.set_columns(tColumnList);
     tDelete.set_durability(TDurability::ASYNC_WAL);
 
-    try {
-        client_->sync_deleteSingle(tableName, tDelete);
+    auto conn = connection();
+    return folly::via(conn.first,
+                      [client = conn.second, tableName, tDelete = std::move(tDelete)] () mutable {
+        return client->future_deleteSingle(tableName, tDelete);
+    }).thenValue([] (auto&&) {
         return ResultCode::SUCCEEDED;
-    } catch (const TIOError &ex) {
-        LOG(ERROR) << "TIOError: " << ex.message;
-        return ResultCode::ERR_IO_ERROR;
-    } catch (const apache::thrift::transport::TTransportException &tte) {
-        LOG(ERROR) << "TTransportException: " << tte.what();
+    }).thenError([] (auto&& e) {
+        LOG(ERROR) << "Remove Failed: " << e.what();
         return ResultCode::ERR_IO_ERROR;
-    }
-    return ResultCode::ERR_UNKNOWN;
+    });
 }
 
+
 ResultCode HBaseClient::multiRemove(const std::string& tableName,
                                     std::vector<std::string>& rowKeys) {
-    std::vector<TDelete> tDeleteList;
-    for (auto& rowKey : rowKeys) {
-        TDelete tDelete;
-        tDelete.set_row(rowKey);
-        TColumn tColumn;
-        tColumn.set_family(kColumnFamilyName);
-        std::vector<TColumn> tColumnList;
-        tColumnList.emplace_back(tColumn);
-        tDelete.set_columns(tColumnList);
-        tDelete.set_durability(TDurability::ASYNC_WAL);
-        tDeleteList.emplace_back(tDelete);
-    }
+    return asyncMultiRemove(tableName, rowKeys).get();
+}
 
-    std::vector<TDelete> tDeleteResultList;
-    try {
-        client_->sync_deleteMultiple(tDeleteResultList, tableName, tDeleteList);
+
+folly::Future<ResultCode> HBaseClient::asyncMultiRemove(const std::string& tableName,
+                                                        std::vector<std::string> rowKeys) {
+    auto tDeleteList = buildDeletes(rowKeys);
+    auto conn = connection();
+    return folly::via(conn.first,
+                      [client = conn.second, tableName, tDeleteList = std::move(tDeleteList)] () mutable {
+        return client->future_deleteMultiple(tableName, tDeleteList);
+    }).thenValue([] (auto&&) {
         return ResultCode::SUCCEEDED;
-    } catch (const TIOError &ex) {
-        LOG(ERROR) << "TIOError: " << ex.message;
+    }).thenError([] (auto&& e) {
+        LOG(ERROR) << "MultiRemove Failed: " << e.what();
         return ResultCode::ERR_IO_ERROR;
-    } catch (const apache::thrift::transport::TTransportException &tte) {
-        LOG(ERROR) << "TTransportException: " << tte.what();
-        return ResultCode::ERR_IO_ERROR;
-    }
-    return ResultCode::ERR_UNKNOWN;
+    });
 }
 
 }  // namespace kvstore
 }  // namespace nebula
-
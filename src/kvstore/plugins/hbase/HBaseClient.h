@@ -15,6 +15,7 @@
 #include "gen-cpp2/hbase_types.h"
 #include "gen-cpp2/THBaseServiceAsyncClient.h"
 #include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 
 
 namespace nebula {
@@ -54,10 +55,36 @@ public:
     ResultCode multiRemove(const std::string& tableName,
                            std::vector<std::string>& rowKeys);
 
+    // Async variants for the write path: the RPC runs on one of the
+    // pooled connections and the returned future fires on its IO
+    // thread, so the caller never blocks on the wire
+    folly::Future<ResultCode> asyncMultiPut(
+            const std::string& tableName,
+            std::vector<std::pair<std::string, std::vector<KV>>> dataList);
+
+    folly::Future<ResultCode> asyncRemove(const std::string& tableName,
+                                          std::string rowKey);
+
+    folly::Future<ResultCode> asyncMultiRemove(const std::string& tableName,
+                                               std::vector<std::string> rowKeys);
+
 private:
-    std::shared_ptr<thrift::ThriftClientManager<THBaseServiceAsyncClient>> clientsMan_;
+    // One slot of the connection pool, picked round robin: the event
+    // base and the thrift client bound to it. The manager caches one
+    // client, i.e. one connection, per event base
+    std::pair<folly::EventBase*, std::shared_ptr<THBaseServiceAsyncClient>> connection();
+
+    static std::vector<TPut> buildPuts(
+            const std::vector<std::pair<std::string, std::vector<KV>>>& dataList);
 
-    std::shared_ptr<THBaseServiceAsyncClient> client_;
+    static std::vector<TDelete> buildDeletes(const std::vector<std::string>& rowKeys);
+
+private:
+    HostAddr host_;
+
+    std::shared_ptr<folly::IOThreadPoolExecutor> ioPool_;
+
+    std::shared_ptr<thrift::ThriftClientManager<THBaseServiceAsyncClient>> clientsMan_;
 
     const int32_t kScanRowNum = {1024};
 };
@@ -65,4 +92,3 @@ private:
 }  // namespace kvstore
 }  // namespace nebula
 #endif  // KVSTORE_PLUGINS_HBASE_HBASECLIENT_H_
-
@@ -203,8 +203,14 @@ ResultCode HBaseStore::rangeWithPrefix(GraphSpaceID spaceId,
                                        PartitionID  partId,
                                        const std::string& start,
                                        const std::string& prefix,
-                                       std::unique_ptr<KVIterator>* storageIter) {
+                                       std::unique_ptr<KVIterator>* storageIter,
+                                       bool canReadFromFollower,
+                                       ScanHint hint,
+                                       const SpaceSnapshot* snapshot) {
     UNUSED(partId);
+    UNUSED(canReadFromFollower);
+    UNUSED(hint);
+    UNUSED(snapshot);
     auto tableName = this->spaceIdToTableName(spaceId);
     std::string startRowKey, endRowKey;
     startRowKey = this->getRowKey(start);
@@ -245,8 +251,10 @@ ResultCode HBaseStore::multiRemove(GraphSpaceID spaceId,
 ResultCode HBaseStore::get(GraphSpaceID spaceId,
                            PartitionID partId,
                            const std::string& key,
-                           std::string* value) {
+                           std::string* value,
+                           bool canReadFromFollower) {
     UNUSED(partId);
+    UNUSED(canReadFromFollower);
     auto tableName = this->spaceIdToTableName(spaceId);
     auto rowKey = this->getRowKey(key);
     KVMap data;
@@ -262,12 +270,36 @@ ResultCode HBaseStore::get(GraphSpaceID spaceId,
 }
 
 
+ResultCode HBaseStore::getLatest(GraphSpaceID spaceId,
+                                 PartitionID partId,
+                                 const std::string& keyPrefix,
+                                 std::string* value,
+                                 bool canReadFromFollower,
+                                 const SpaceSnapshot* snapshot) {
+    UNUSED(partId);
+    UNUSED(canReadFromFollower);
+    UNUSED(snapshot);
+    std::unique_ptr<KVIterator> iter;
+    auto code = this->prefix(spaceId, keyPrefix, &iter);
+    if (code != ResultCode::SUCCEEDED) {
+        return code;
+    }
+    if (iter == nullptr || !iter->valid()) {
+        return ResultCode::ERR_KEY_NOT_FOUND;
+    }
+    *value = iter->val().str();
+    return ResultCode::SUCCEEDED;
+}
+
+
 std::pair<ResultCode, std::vector<Status>> HBaseStore::multiGet(
         GraphSpaceID spaceId,
         PartitionID partId,
         const std::vector<std::string>& keys,
-        std::vector<std::string>* values) {
+        std::vector<std::string>* values,
+        bool canReadFromFollower) {
     UNUSED(partId);
+    UNUSED(canReadFromFollower);
     auto tableName = this->spaceIdToTableName(spaceId);
     std::vector<std::string> rowKeys;
     for (auto& key : keys) {
@@ -292,8 +324,14 @@ ResultCode HBaseStore::range(GraphSpaceID spaceId,
                              PartitionID partId,
                              const std::string& start,
                              const std::string& end,
-                             std::unique_ptr<KVIterator>* iter) {
+                             std::unique_ptr<KVIterator>* iter,
+                             bool canReadFromFollower,
+                             ScanHint hint,
+                             const SpaceSnapshot* snapshot) {
     UNUSED(partId);
+    UNUSED(canReadFromFollower);
+    UNUSED(hint);
+    UNUSED(snapshot);
     return this->range(spaceId, start, end, iter);
 }
 
@@ -301,8 +339,14 @@ ResultCode HBaseStore::range(GraphSpaceID spaceId,
 ResultCode HBaseStore::prefix(GraphSpaceID spaceId,
                               PartitionID partId,
                               const std::string& prefix,
-                              std::unique_ptr<KVIterator>* iter) {
+                              std::unique_ptr<KVIterator>* iter,
+                              bool canReadFromFollower,
+                              ScanHint hint,
+                              const SpaceSnapshot* snapshot) {
     UNUSED(partId);
+    UNUSED(canReadFromFollower);
+    UNUSED(hint);
+    UNUSED(snapshot);
     return this->prefix(spaceId, prefix, iter);
 }
 
@@ -312,21 +356,22 @@ void HBaseStore::asyncMultiPut(GraphSpaceID spaceId,
                                std::vector<KV> keyValues,
                                KVCallback cb) {
     UNUSED(partId);
-    auto multiPut = [this, &spaceId, &keyValues] () -> ResultCode {
-        auto tableName = this->spaceIdToTableName(spaceId);
-        std::vector<std::pair<std::string, std::vector<KV>>> dataList;
-        for (size_t i = 0; i < keyValues.size(); i++) {
-            auto rowKey = this->getRowKey(keyValues[i].first);
-            auto data = this->decode(spaceId, keyValues[i].first, keyValues[i].second);
-            dataList.emplace_back(std::make_pair(rowKey, data));
-        }
-        ResultCode code = client_->multiPut(tableName, dataList);
-        if (code == ResultCode::ERR_IO_ERROR) {
-            LOG(ERROR) << "MultiPut Failed: the HBase I/O error.";
-        }
-        return code;
-    };
-    return cb(multiPut());
+    auto tableName = this->spaceIdToTableName(spaceId);
+    std::vector<std::pair<std::string, std::vector<KV>>> dataList;
+    for (size_t i = 0; i < keyValues.size(); i++) {
+        auto rowKey = this->getRowKey(keyValues[i].first);
+        auto data = this->decode(spaceId, keyValues[i].first, keyValues[i].second);
+        dataList.emplace_back(std::make_pair(rowKey, data));
+    }
+    // Only the decoding runs in the caller; the RPC is in flight when
+    // this returns and the callback fires on the client's IO thread
+    client_->asyncMultiPut(tableName, std::move(dataList))
+        .thenValue([cb = std::move(cb)] (ResultCode code) mutable {
+            if (code == ResultCode::ERR_IO_ERROR) {
+                LOG(ERROR) << "MultiPut Failed: the HBase I/O error.";
+            }
+            cb(code);
+        });
 }
 
 
@@ -335,16 +380,15 @@ void HBaseStore::asyncRemove(GraphSpaceID spaceId,
                              const std::string& key,
                              KVCallback cb) {
     UNUSED(partId);
-    auto remove = [this, &spaceId, &key] () -> ResultCode {
-        auto tableName = this->spaceIdToTableName(spaceId);
-        auto rowKey = this->getRowKey(key);
-        ResultCode code = client_->remove(tableName, rowKey);
-        if (code == ResultCode::ERR_IO_ERROR) {
-            LOG(ERROR) << "Remove Failed: " << key << ", the HBase I/O error.";
-        }
-        return code;
-    };
-    return cb(remove());
+    auto tableName = this->spaceIdToTableName(spaceId);
+    auto rowKey = this->getRowKey(key);
+    client_->asyncRemove(tableName, rowKey)
+        .thenValue([key, cb = std::move(cb)] (ResultCode code) mutable {
+            if (code == ResultCode::ERR_IO_ERROR) {
+                LOG(ERROR) << "Remove Failed: " << key << ", the HBase I/O error.";
+            }
+            cb(code);
+        });
 }
 
 
@@ -353,7 +397,36 @@ void HBaseStore::asyncMultiRemove(GraphSpaceID spaceId,
                                   std::vector<std::string> keys,
                                   KVCallback cb) {
     UNUSED(partId);
-    return cb(this->multiRemove(spaceId, keys));
+    auto tableName = this->spaceIdToTableName(spaceId);
+    std::vector<std::string> rowKeys;
+    for (auto& key : keys) {
+        rowKeys.emplace_back(this->getRowKey(key));
+    }
+    client_->asyncMultiRemove(tableName, std::move(rowKeys))
+        .thenValue([cb = std::move(cb)] (ResultCode code) mutable {
+            if (code == ResultCode::ERR_IO_ERROR) {
+                LOG(ERROR) << "MultiRemove Failed: the HBase I/O error.";
+            }
+            cb(code);
+        });
+}
+
+
+void HBaseStore::asyncMultiRemoveRange(GraphSpaceID spaceId,
+                                       PartitionID partId,
+                                       std::vector<KV> ranges,
+                                       KVCallback cb) {
+    // asyncRemoveRange() of this store runs the removal inline
+    ResultCode ret = ResultCode::SUCCEEDED;
+    for (auto& range : ranges) {
+        this->asyncRemoveRange(spaceId, partId, range.first, range.second,
+                               [&ret] (ResultCode code) {
+                                   if (code != ResultCode::SUCCEEDED) {
+                                       ret = code;
+                                   }
+                               });
+    }
+    return cb(ret);
 }
 
 
@@ -413,7 +486,7 @@ void HBaseStore::asyncRemovePrefix(GraphSpaceID spaceId,
     return cb(removePrefix());
 }
 
-ResultCode HBaseStore::ingest(GraphSpaceID) {
+ResultCode HBaseStore::ingest(GraphSpaceID, bool, bool, bool) {
     LOG(FATAL) << "Unimplement";
 }
 
@@ -79,20 +79,34 @@ public:
     ResultCode get(GraphSpaceID spaceId,
                    PartitionID  partId,
                    const std::string& key,
-                   std::string* value) override;
+                   std::string* value,
+                   bool canReadFromFollower = false) override;
+
+    // HBase has no versioned key encoding to exploit, so this falls
+    // back to a prefix scan and returns the first row
+    ResultCode getLatest(GraphSpaceID spaceId,
+                         PartitionID partId,
+                         const std::string& keyPrefix,
+                         std::string* value,
+                         bool canReadFromFollower = false,
+                         const SpaceSnapshot* snapshot = nullptr) override;
 
     std::pair<ResultCode, std::vector<Status>> multiGet(
             GraphSpaceID spaceId,
             PartitionID partId,
             const std::vector<std::string>& keys,
-            std::vector<std::string>* values) override;
+            std::vector<std::string>* values,
+            bool canReadFromFollower = false) override;
 
     // Get all results in range [start, end)
     ResultCode range(GraphSpaceID spaceId,
                      PartitionID  partId,
                      const std::string& start,
                      const std::string& end,
-                     std::unique_ptr<KVIterator>* iter) override;
+                     std::unique_ptr<KVIterator>* iter,
+                     bool canReadFromFollower = false,
+                     ScanHint hint = ScanHint::DEFAULT,
+                     const SpaceSnapshot* snapshot = nullptr) override;
 
     // Since the `range' interface will hold references to its 3rd & 4th parameter, in `iter',
     // thus the arguments must outlive `iter'.
@@ -101,33 +115,48 @@ public:
                      PartitionID  partId,
                      std::string&& start,
                      std::string&& end,
-                     std::unique_ptr<KVIterator>* iter) override = delete;
+                     std::unique_ptr<KVIterator>* iter,
+                     bool canReadFromFollower = false,
+                     ScanHint hint = ScanHint::DEFAULT,
+                     const SpaceSnapshot* snapshot = nullptr) override = delete;
 
     // Get all results with prefix.
     ResultCode prefix(GraphSpaceID spaceId,
                       PartitionID  partId,
                       const std::string& prefix,
-                      std::unique_ptr<KVIterator>* iter) override;
+                      std::unique_ptr<KVIterator>* iter,
+                      bool canReadFromFollower = false,
+                      ScanHint hint = ScanHint::DEFAULT,
+                      const SpaceSnapshot* snapshot = nullptr) override;
 
     // To forbid to pass rvalue via the `prefix' parameter.
     ResultCode prefix(GraphSpaceID spaceId,
                       PartitionID  partId,
                       std::string&& prefix,
-                      std::unique_ptr<KVIterator>* iter) override = delete;
+                      std::unique_ptr<KVIterator>* iter,
+                      bool canReadFromFollower = false,
+                      ScanHint hint = ScanHint::DEFAULT,
+                      const SpaceSnapshot* snapshot = nullptr) override = delete;
 
     // Get all results with prefix starting from start
     ResultCode rangeWithPrefix(GraphSpaceID spaceId,
                                PartitionID  partId,
                                const std::string& start,
                                const std::string& prefix,
-                               std::unique_ptr<KVIterator>* iter) override;
+                               std::unique_ptr<KVIterator>* iter,
+                               bool canReadFromFollower = false,
+                               ScanHint hint = ScanHint::DEFAULT,
+                               const SpaceSnapshot* snapshot = nullptr) override;
 
     // To forbid to pass rvalue via the `rangeWithPrefix' parameter.
     ResultCode rangeWithPrefix(GraphSpaceID spaceId,
                                PartitionID  partId,
                                std::string&& start,
                                std::string&& prefix,
-                               std::unique_ptr<KVIterator>* iter) override = delete;
+                               std::unique_ptr<KVIterator>* iter,
+                               bool canReadFromFollower = false,
+                               ScanHint hint = ScanHint::DEFAULT,
+                               const SpaceSnapshot* snapshot = nullptr) override = delete;
 
     ResultCode sync(GraphSpaceID spaceId, PartitionID partId) override;
 
@@ -137,6 +166,30 @@ public:
                        std::vector<KV> keyValues,
                        KVCallback cb) override;
 
+    // The encoded batch format is specific to the raft log
+    void asyncAppendBatch(GraphSpaceID spaceId,
+                          PartitionID partId,
+                          std::string batch,
+                          KVCallback cb) override {
+        UNUSED(spaceId);
+        UNUSED(partId);
+        UNUSED(batch);
+        cb(ResultCode::ERR_UNSUPPORTED);
+    }
+
+    // HBase has no merge-operator equivalent
+    void asyncMerge(GraphSpaceID spaceId,
+                    PartitionID partId,
+                    const std::string& key,
+                    const std::string& value,
+                    KVCallback cb) override {
+        UNUSED(spaceId);
+        UNUSED(partId);
+        UNUSED(key);
+        UNUSED(value);
+        cb(ResultCode::ERR_UNSUPPORTED);
+    }
+
     void asyncRemove(GraphSpaceID spaceId,
                      PartitionID partId,
                      const std::string& key,
@@ -147,6 +200,11 @@ public:
                           std::vector<std::string> keys,
                           KVCallback cb) override;
 
+    void asyncMultiRemoveRange(GraphSpaceID spaceId,
+                               PartitionID partId,
+                               std::vector<KV> ranges,
+                               KVCallback cb) override;
+
     void asyncRemoveRange(GraphSpaceID spaceId,
                           PartitionID partId,
                           const std::string& start,
@@ -165,7 +223,10 @@ public:
         LOG(FATAL) << "Not supportted yet!";
     }
 
-    ResultCode ingest(GraphSpaceID spaceId) override;
+    ResultCode ingest(GraphSpaceID spaceId,
+                      bool verifyChecksum = false,
+                      bool prewarm = false,
+                      bool buildIndex = false) override;
 
     int32_t allLeader(std::unordered_map<GraphSpaceID,
                                          std::vector<PartitionID>>& leaderIds) override;
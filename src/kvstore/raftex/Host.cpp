@@ -5,6 +5,7 @@
  */
 
 #include "kvstore/raftex/Host.h"
+#include "kvstore/raftex/LogCompression.h"
 #include "kvstore/raftex/RaftPart.h"
 #include "kvstore/wal/FileBasedWal.h"
 #include "common/network/NetworkUtils.h"
@@ -16,8 +17,15 @@ DEFINE_uint32(max_appendlog_batch_size, 128,
 DEFINE_uint32(max_outstanding_requests, 1024,
               "The max number of outstanding appendLog requests");
 DEFINE_int32(raft_rpc_timeout_ms, 500, "rpc timeout for raft client");
+DEFINE_int32(raft_test_append_delay_ms, 0,
+             "Test only. Delay every outgoing appendLog request by this many ms, "
+             "simulating a slow or congested network");
+DEFINE_int32(raft_test_append_drop_pct, 0,
+             "Test only. Drop this percentage of outgoing appendLog requests; a dropped "
+             "request surfaces as an rpc error after the rpc timeout, like a real loss");
 
 DECLARE_bool(trace_raft);
+DECLARE_bool(raft_log_compression);
 
 namespace nebula {
 namespace raftex {
@@ -430,6 +438,9 @@ Host::prepareAppendLogRequest() {
         req->set_log_term(term);
 
         std::vector<cpp2::LogEntry> logs;
+        // The raw payload sent right before the current one, the anchor
+        // the delta encoding works against
+        std::string prevMsg;
         for (size_t cnt = 0;
              it->valid()
                 && it->logTerm() == term
@@ -437,7 +448,13 @@ Host::prepareAppendLogRequest() {
              ++(*it), ++cnt) {
             cpp2::LogEntry le;
             le.set_cluster(it->logSource());
-            le.set_log_str(it->logMsg().toString());
+            if (FLAGS_raft_log_compression) {
+                auto msg = it->logMsg();
+                le.set_log_str(encodeLogMsg(msg, prevMsg));
+                prevMsg = msg.toString();
+            } else {
+                le.set_log_str(it->logMsg().toString());
+            }
             logs.emplace_back(std::move(le));
         }
         req->set_log_str_list(std::move(logs));
@@ -492,6 +509,26 @@ folly::Future<cpp2::AppendLogResponse> Host::sendAppendLogRequest(
               << ", committed_id " << req->get_committed_log_id()
               << ", last_log_term_sent" << req->get_last_log_term_sent()
               << ", last_log_id_sent " << req->get_last_log_id_sent();
+    if (UNLIKELY(FLAGS_raft_test_append_drop_pct > 0) &&
+        static_cast<int32_t>(folly::Random::rand32(100)) < FLAGS_raft_test_append_drop_pct) {
+        // a lost packet is only noticed when the rpc times out, so hold the
+        // failure back for that long as well
+        VLOG(2) << idStr_ << "Dropping the request by fault injection";
+        return folly::futures::sleep(std::chrono::milliseconds(FLAGS_raft_rpc_timeout_ms))
+            .via(eb)
+            .thenValue([](auto&&) -> cpp2::AppendLogResponse {
+                throw std::runtime_error("appendLog request dropped by fault injection");
+            });
+    }
+    if (UNLIKELY(FLAGS_raft_test_append_delay_ms > 0)) {
+        return folly::futures::sleep(std::chrono::milliseconds(FLAGS_raft_test_append_delay_ms))
+            .via(eb)
+            .thenValue([self = shared_from_this(), eb, req = std::move(req)](auto&&) {
+                auto client = self->part_->clientMan_->client(self->addr_, eb, false,
+                                                              FLAGS_raft_rpc_timeout_ms);
+                return client->future_appendLog(*req);
+            });
+    }
     // Get client connection
     auto client = part_->clientMan_->client(addr_, eb, false, FLAGS_raft_rpc_timeout_ms);
     return client->future_appendLog(*req);
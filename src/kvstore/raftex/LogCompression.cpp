@@ -0,0 +1,150 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "kvstore/raftex/LogCompression.h"
+#include <folly/compression/Compression.h>
+
+DEFINE_bool(raft_log_compression, false,
+            "Whether to compress the log payloads replicated to followers, "
+            "must be enabled on all replicas at the same time");
+DEFINE_int32(raft_log_compression_threshold, 512,
+             "Log payloads smaller than this in bytes are sent raw");
+DEFINE_bool(raft_log_delta_encoding, false,
+            "Whether to send each log payload as a delta against the previous "
+            "one of the same request, requires raft_log_compression on all "
+            "replicas but itself only matters on leaders");
+
+namespace nebula {
+namespace raftex {
+
+namespace {
+
+constexpr char kRawMarker = 0x00;
+constexpr char kZstdMarker = 0x01;
+// Delta payloads start with the length of the prefix shared with the
+// previous payload, followed by the raw or compressed suffix
+constexpr char kDeltaMarker = 0x02;
+constexpr char kZstdDeltaMarker = 0x03;
+constexpr size_t kDeltaHeaderLen = sizeof(uint32_t);
+
+folly::io::Codec* codec() {
+    static thread_local auto codec = folly::io::getCodec(folly::io::CodecType::ZSTD);
+    return codec.get();
+}
+
+}  // anonymous namespace
+
+std::string encodeLogMsg(folly::StringPiece msg, folly::StringPiece prev) {
+    if (FLAGS_raft_log_delta_encoding && !prev.empty()) {
+        size_t limit = std::min(msg.size(), prev.size());
+        size_t prefixLen = 0;
+        while (prefixLen < limit && msg[prefixLen] == prev[prefixLen]) {
+            prefixLen++;
+        }
+        // The shared prefix has to pay for the length header carrying it
+        if (prefixLen > kDeltaHeaderLen + 1) {
+            folly::StringPiece suffix(msg.data() + prefixLen, msg.size() - prefixLen);
+            auto header = static_cast<uint32_t>(prefixLen);
+            std::string encoded;
+            if (suffix.size() >= static_cast<size_t>(FLAGS_raft_log_compression_threshold)) {
+                auto compressed = codec()->compress(suffix);
+                if (compressed.size() < suffix.size()) {
+                    encoded.reserve(1 + kDeltaHeaderLen + compressed.size());
+                    encoded.append(1, kZstdDeltaMarker);
+                    encoded.append(reinterpret_cast<const char*>(&header), kDeltaHeaderLen);
+                    encoded.append(compressed);
+                    return encoded;
+                }
+            }
+            encoded.reserve(1 + kDeltaHeaderLen + suffix.size());
+            encoded.append(1, kDeltaMarker);
+            encoded.append(reinterpret_cast<const char*>(&header), kDeltaHeaderLen);
+            encoded.append(suffix.data(), suffix.size());
+            return encoded;
+        }
+    }
+    if (msg.size() >= static_cast<size_t>(FLAGS_raft_log_compression_threshold)) {
+        auto compressed = codec()->compress(msg);
+        if (compressed.size() + 1 < msg.size()) {
+            compressed.insert(0, 1, kZstdMarker);
+            return compressed;
+        }
+    }
+    std::string encoded;
+    encoded.reserve(msg.size() + 1);
+    encoded.append(1, kRawMarker);
+    encoded.append(msg.data(), msg.size());
+    return encoded;
+}
+
+bool decodeLogEntries(const std::vector<cpp2::LogEntry>& in,
+                      std::vector<cpp2::LogEntry>& out) {
+    out.clear();
+    out.reserve(in.size());
+    const std::string* prev = nullptr;
+    for (const auto& entry : in) {
+        const auto& data = entry.get_log_str();
+        if (data.empty()) {
+            LOG(ERROR) << "Empty log payload, missing the compression marker";
+            return false;
+        }
+        cpp2::LogEntry decoded;
+        decoded.set_cluster(entry.get_cluster());
+        folly::StringPiece payload(data.data() + 1, data.size() - 1);
+        switch (data.front()) {
+            case kRawMarker:
+                decoded.set_log_str(payload.toString());
+                break;
+            case kZstdMarker:
+                try {
+                    decoded.set_log_str(codec()->uncompress(payload));
+                } catch (const std::exception& e) {
+                    LOG(ERROR) << "Failed to uncompress the log payload: " << e.what();
+                    return false;
+                }
+                break;
+            case kDeltaMarker:
+            case kZstdDeltaMarker: {
+                if (prev == nullptr || payload.size() < kDeltaHeaderLen) {
+                    LOG(ERROR) << "Truncated or leading delta log payload";
+                    return false;
+                }
+                uint32_t prefixLen;
+                memcpy(&prefixLen, payload.data(), kDeltaHeaderLen);
+                if (prefixLen > prev->size()) {
+                    LOG(ERROR) << "Delta log payload shares " << prefixLen
+                               << " bytes, but the previous one only holds " << prev->size();
+                    return false;
+                }
+                folly::StringPiece suffix(payload.data() + kDeltaHeaderLen,
+                                          payload.size() - kDeltaHeaderLen);
+                auto restored = prev->substr(0, prefixLen);
+                if (data.front() == kZstdDeltaMarker) {
+                    try {
+                        restored.append(codec()->uncompress(suffix));
+                    } catch (const std::exception& e) {
+                        LOG(ERROR) << "Failed to uncompress the log payload: " << e.what();
+                        return false;
+                    }
+                } else {
+                    restored.append(suffix.data(), suffix.size());
+                }
+                decoded.set_log_str(std::move(restored));
+                break;
+            }
+            default:
+                LOG(ERROR) << "Unknown compression marker "
+                           << static_cast<int32_t>(data.front());
+                return false;
+        }
+        out.emplace_back(std::move(decoded));
+        prev = &out.back().get_log_str();
+    }
+    return true;
+}
+
+}  // namespace raftex
+}  // namespace nebula
@@ -0,0 +1,49 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef RAFTEX_LOGCOMPRESSION_H_
+#define RAFTEX_LOGCOMPRESSION_H_
+
+#include "common/base/Base.h"
+#include "common/interface/gen-cpp2/raftex_types.h"
+
+namespace nebula {
+namespace raftex {
+
+/**
+ * Optional compression of the log payloads replicated from leader to
+ * followers. When FLAGS_raft_log_compression is on, every log payload on
+ * the wire carries a one-byte marker which records whether it is raw or
+ * zstd compressed, so payloads below FLAGS_raft_log_compression_threshold
+ * (or ones the codec cannot shrink) are sent as-is. The flag has to be
+ * enabled on all replicas at the same time, since a peer running with the
+ * flag off would take the marker byte as part of the payload.
+ *
+ * On top of that, FLAGS_raft_log_delta_encoding sends a payload as the
+ * byte prefix it shares with the previous payload of the same request
+ * plus the remaining suffix, which pays off for bulk writes where
+ * consecutive logs repeat long key prefixes. Delta payloads carry their
+ * own markers, and every decoder handles them as soon as
+ * raft_log_compression is on, so the delta flag only needs to be flipped
+ * on leaders and can roll out one host at a time.
+ * */
+
+// Encode one log payload for the wire. `prev' is the raw payload right
+// before this one in the same request, or empty for the first one.
+// Delta-encodes against `prev' when that is enabled and shorter, then
+// compresses whatever remains when it is worthwhile; otherwise prepends
+// the raw marker only.
+std::string encodeLogMsg(folly::StringPiece msg, folly::StringPiece prev = folly::StringPiece());
+
+// Decode all payloads of an AppendLogRequest. Returns false if any payload
+// is corrupt, the decoded entries are returned through `out'.
+bool decodeLogEntries(const std::vector<cpp2::LogEntry>& in,
+                      std::vector<cpp2::LogEntry>& out);
+
+}  // namespace raftex
+}  // namespace nebula
+
+#endif  // RAFTEX_LOGCOMPRESSION_H_
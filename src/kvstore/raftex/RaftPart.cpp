@@ -16,9 +16,11 @@
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/gen/Base.h>
 #include "kvstore/wal/FileBasedWal.h"
+#include "kvstore/raftex/LogCompression.h"
 #include "kvstore/raftex/LogStrListIterator.h"
 #include "kvstore/raftex/Host.h"
 #include "kvstore/raftex/RaftPart.h"
+#include "utils/RequestTrace.h"
 
 DEFINE_uint32(raft_heartbeat_interval_secs, 5,
              "Seconds between each heartbeat");
@@ -32,6 +34,29 @@ DEFINE_int64(wal_file_size, 16 * 1024 * 1024, "Default wal file size");
 DEFINE_int32(wal_buffer_size, 8 * 1024 * 1024, "Default wal buffer size");
 DEFINE_int32(wal_buffer_num, 2, "Default wal buffer number");
 DEFINE_bool(trace_raft, false, "Enable trace one raft request");
+DECLARE_bool(raft_coalesced_heartbeats);
+DECLARE_bool(raft_log_compression);
+DEFINE_bool(raft_pipelined_log_append, false,
+            "Overlap the WAL disk write with the replication to followers, "
+            "the commit is gated on both completing");
+DEFINE_uint32(raft_batch_window_us, 0,
+              "Group-commit window in microseconds. When positive, the leader "
+              "accumulates logs for up to this long before kicking a "
+              "replication round. 0 means kick immediately");
+DEFINE_uint32(follower_read_max_staleness_ms, 5 * 1000,
+              "A follower/learner can serve stale-tolerant reads only if it "
+              "has heard from the leader within this many milliseconds");
+DEFINE_uint32(raft_batch_window_bytes, 64 * 1024,
+              "Kick the replication round right away once the buffered logs "
+              "exceed this many bytes, regardless of the time window");
+DEFINE_uint64(raft_election_backoff_max_weight, 8,
+              "Upper bound of the exponential backoff weight applied to the "
+              "election timeout and the retry delay of failed elections");
+DEFINE_bool(raft_async_apply, false,
+            "Acknowledge writes once a quorum holds them in the WAL and let "
+            "a background task apply them to the state machine in larger "
+            "batches. Reads on the leader may briefly miss an acknowledged "
+            "write until the apply catches up");
 
 namespace nebula {
 namespace raftex {
@@ -43,6 +68,26 @@ using nebula::wal::FileBasedWalPolicy;
 
 using OpProcessor = folly::Function<folly::Optional<std::string>(AtomicOp op)>;
 
+namespace {
+
+// Tracks the responses of one replication round. The promise is
+// fulfilled as soon as a quorum of non-learner hosts succeeded, or
+// when all hosts have responded, whichever comes first. Stragglers
+// keep recording their responses afterwards without gating the round.
+struct AppendLogQuorumContext {
+    explicit AppendLogQuorumContext(size_t t) : total(t) {}
+
+    const size_t total;
+    std::mutex lock;
+    std::vector<std::pair<size_t, cpp2::AppendLogResponse>> resps;
+    size_t numSucceeded{0};
+    size_t numResponded{0};
+    bool fulfilled{false};
+    folly::Promise<std::vector<std::pair<size_t, cpp2::AppendLogResponse>>> promise;
+};
+
+}  // anonymous namespace
+
 class AppendLogsIterator final : public LogIterator {
 public:
     AppendLogsIterator(LogID firstLogId,
@@ -331,6 +376,9 @@ void RaftPart::stop() {
         status_ = Status::STOPPED;
         leader_ = {"", 0};
         role_ = Role::FOLLOWER;
+        releaseSnapshotRecvSlot();
+        // Nothing will commit any more; release the session waiters
+        commitCond_.notify_all();
 
         hosts = std::move(hosts_);
     }
@@ -351,6 +399,16 @@ void RaftPart::stop() {
 }
 
 
+bool RaftPart::waitCommitted(LogID logId, int64_t timeoutMs) {
+    std::unique_lock<std::mutex> lck(raftLock_);
+    commitCond_.wait_for(lck, std::chrono::milliseconds(timeoutMs),
+                         [this, logId] {
+                             return committedLogId_ >= logId || status_ == Status::STOPPED;
+                         });
+    return committedLogId_ >= logId;
+}
+
+
 AppendLogResult RaftPart::canAppendLogs() {
     CHECK(!raftLock_.try_lock());
     if (status_ == Status::STARTING) {
@@ -560,6 +618,8 @@ folly::Future<AppendLogResult> RaftPart::appendLogAsync(ClusterID source,
 
     LogCache swappedOutLogs;
     auto retFuture = folly::Future<AppendLogResult>::makeEmpty();
+    bool kickWindowTask = false;
+    bool kickReplication = false;
 
     if (bufferOverFlow_) {
         PLOG_EVERY_N(WARNING, 30) << idStr_
@@ -569,7 +629,7 @@ folly::Future<AppendLogResult> RaftPart::appendLogAsync(ClusterID source,
         return AppendLogResult::E_BUFFER_OVERFLOW;
     }
     {
-        std::lock_guard<std::mutex> lck(logsLock_);
+        std::lock_guard<folly::SpinLock> lck(logsLock_);
 
         VLOG(2) << idStr_ << "Checking whether buffer overflow";
 
@@ -587,6 +647,7 @@ folly::Future<AppendLogResult> RaftPart::appendLogAsync(ClusterID source,
 
         // Append new logs to the buffer
         DCHECK_GE(source, 0);
+        cachedLogsBytes_ += log.size();
         logs_.emplace_back(source, logType, std::move(log), std::move(op));
         switch (logType) {
             case LogType::ATOMIC_OP:
@@ -600,20 +661,54 @@ folly::Future<AppendLogResult> RaftPart::appendLogAsync(ClusterID source,
                 break;
         }
 
-        bool expected = false;
-        if (replicatingLogs_.compare_exchange_strong(expected, true)) {
-            // We need to send logs to all followers
-            VLOG(2) << idStr_ << "Preparing to send AppendLog request";
-            sendingPromise_ = std::move(cachingPromise_);
-            cachingPromise_.reset();
-            std::swap(swappedOutLogs, logs_);
-            bufferOverFlow_ = false;
-        } else {
+        if (replicatingLogs_) {
             VLOG(2) << idStr_
                     << "Another AppendLogs request is ongoing,"
                        " just return";
             return retFuture;
         }
+
+        // Group-commit window: when no replication round is in flight,
+        // keep accumulating logs until either the size or the time
+        // threshold is reached before kicking appendLogsInternal, so
+        // throughput scales with load instead of collapsing into
+        // per-log replication rounds
+        if (FLAGS_raft_batch_window_us > 0
+                && cachedLogsBytes_ < FLAGS_raft_batch_window_bytes
+                && logs_.size() < FLAGS_max_batch_size) {
+            if (!batchWindowScheduled_) {
+                batchWindowScheduled_ = true;
+                // Schedule the task after the lock is released
+                kickWindowTask = true;
+            }
+        } else {
+            bool expected = false;
+            if (replicatingLogs_.compare_exchange_strong(expected, true)) {
+                // We need to send logs to all followers
+                VLOG(2) << idStr_ << "Preparing to send AppendLog request";
+                sendingPromise_ = std::move(cachingPromise_);
+                cachingPromise_.reset();
+                std::swap(swappedOutLogs, logs_);
+                bufferOverFlow_ = false;
+                cachedLogsBytes_ = 0;
+                kickReplication = true;
+            } else {
+                VLOG(2) << idStr_
+                        << "Another AppendLogs request is ongoing,"
+                           " just return";
+                return retFuture;
+            }
+        }
+    }
+
+    if (kickWindowTask) {
+        size_t delayMS = std::max<size_t>(1, FLAGS_raft_batch_window_us / 1000);
+        bgWorkers_->addDelayTask(delayMS, [self = shared_from_this()] {
+            self->flushBatchWindow();
+        });
+    }
+    if (!kickReplication) {
+        return retFuture;
     }
 
     LogID firstId = 0;
@@ -656,6 +751,104 @@ folly::Future<AppendLogResult> RaftPart::appendLogAsync(ClusterID source,
     return retFuture;
 }
 
+void RaftPart::flushBatchWindow() {
+    LogCache swappedOutLogs;
+    {
+        std::lock_guard<folly::SpinLock> lck(logsLock_);
+        batchWindowScheduled_ = false;
+        if (logs_.empty()) {
+            return;
+        }
+        bool expected = false;
+        if (!replicatingLogs_.compare_exchange_strong(expected, true)) {
+            // The in-flight round will pick the buffered logs up
+            // when it finishes
+            return;
+        }
+        VLOG(2) << idStr_ << "Group-commit window expired, kicking " << logs_.size() << " logs";
+        sendingPromise_ = std::move(cachingPromise_);
+        cachingPromise_.reset();
+        std::swap(swappedOutLogs, logs_);
+        bufferOverFlow_ = false;
+        cachedLogsBytes_ = 0;
+    }
+
+    LogID firstId = 0;
+    TermID termId = 0;
+    AppendLogResult res;
+    {
+        std::lock_guard<std::mutex> g(raftLock_);
+        res = canAppendLogs();
+        if (res == AppendLogResult::SUCCEEDED) {
+            firstId = lastLogId_ + 1;
+            termId = term_;
+        }
+    }
+
+    if (!checkAppendLogResult(res)) {
+        PLOG_EVERY_N(ERROR, 100) << idStr_ << "Cannot append logs, clean the buffer";
+        return;
+    }
+    AppendLogsIterator it(
+        firstId,
+        termId,
+        std::move(swappedOutLogs),
+        [this] (AtomicOp opCB) -> folly::Optional<std::string> {
+            CHECK(opCB != nullptr);
+            auto opRet = opCB();
+            if (!opRet.hasValue()) {
+                // Failed
+                sendingPromise_.setOneSingleValue(AppendLogResult::E_ATOMIC_OP_FAILURE);
+            }
+            return opRet;
+        });
+    appendLogsInternal(std::move(it), termId);
+}
+
+void RaftPart::applyLogsAsync() {
+    while (true) {
+        LogID from = 0;
+        LogID to = 0;
+        TermID term = 0;
+        {
+            std::lock_guard<std::mutex> g(raftLock_);
+            if (status_ != Status::RUNNING || role_ != Role::LEADER
+                    || committedLogId_ >= quorumLogId_) {
+                // Nothing left to apply, or the part is no longer the
+                // leader, in which case the new leader's heartbeats will
+                // drive the remaining applies through the follower path
+                applyRunning_ = false;
+                return;
+            }
+            from = committedLogId_ + 1;
+            to = quorumLogId_;
+            term = term_;
+        }
+        // Apply outside of raftLock_, so appending and replicating the
+        // next batches proceed while RocksDB digests this one. The logs
+        // in [from, to] are quorum-replicated, the WAL will not roll
+        // them back while we stay in this term
+        auto walIt = wal_->iterator(from, to);
+        SlowOpTracker tracker;
+        if (!commitLogs(std::move(walIt))) {
+            LOG(FATAL) << idStr_ << "Failed to commit logs";
+        }
+        if (tracker.slow()) {
+            tracker.output(idStr_, folly::stringPrintf("Async commit: %ld",
+                                                       to - from + 1));
+        }
+        {
+            std::lock_guard<std::mutex> g(raftLock_);
+            if (term_ == term) {
+                committedLogId_ = to;
+                lastCommittedTerm_ = term;
+                commitCond_.notify_all();
+            }
+        }
+        VLOG(2) << idStr_ << "Applied the logs " << from << " to " << to;
+    }
+}
+
 void RaftPart::appendLogsInternal(AppendLogsIterator iter, TermID termId) {
     TermID currTerm = 0;
     LogID prevLogId = 0;
@@ -698,8 +891,28 @@ void RaftPart::appendLogsInternal(AppendLogsIterator iter, TermID termId) {
         prevLogTerm = lastLogTerm_;
         committed = committedLogId_;
         // Step 1: Write WAL
+        TraceSpanGuard walSpan("wal_append");
         SlowOpTracker tracker;
-        if (!wal_->appendLogs(iter)) {
+        if (FLAGS_raft_pipelined_log_append) {
+            // Stage the logs into the in-memory buffer so replication can
+            // start right away, and flush them to disk on a background
+            // worker. The commit will wait for the flush to finish.
+            if (!wal_->appendLogsToBuffer(iter)) {
+                LOG(ERROR) << idStr_ << "Failed to buffer logs for WAL";
+                res = AppendLogResult::E_WAL_FAILURE;
+                break;
+            }
+            auto flushPromise = std::make_shared<folly::Promise<bool>>();
+            walFlushFuture_ = flushPromise->getFuture();
+            bgWorkers_->addTask([self = shared_from_this(), flushPromise] () mutable {
+                bool ok = false;
+                {
+                    std::lock_guard<std::mutex> flushGuard(self->raftLock_);
+                    ok = self->wal_->flushPendingLogs();
+                }
+                flushPromise->setValue(ok);
+            });
+        } else if (!wal_->appendLogs(iter)) {
             LOG(ERROR) << idStr_ << "Failed to write into WAL";
             res = AppendLogResult::E_WAL_FAILURE;
             break;
@@ -770,35 +983,50 @@ void RaftPart::replicateLogs(folly::EventBase* eb,
 
     lastMsgSentDur_.reset();
     SlowOpTracker tracker;
-    collectNSucceeded(
-        gen::from(hosts)
-        | gen::map([self = shared_from_this(),
-                    eb,
-                    currTerm,
-                    lastLogId,
-                    prevLogId,
-                    prevLogTerm,
-                    committedId] (std::shared_ptr<Host> hostPtr) {
-            VLOG(2) << self->idStr_
-                    << "Appending logs to "
-                    << hostPtr->idStr();
-            return via(eb, [=] () -> Future<cpp2::AppendLogResponse> {
-                        return hostPtr->appendLogs(eb,
-                                                   currTerm,
-                                                   lastLogId,
-                                                   committedId,
-                                                   prevLogTerm,
-                                                   prevLogId);
-                   });
-        })
-        | gen::as<std::vector>(),
-        // Number of succeeded required
-        quorum_,
-        // Result evaluator
-        [hosts] (size_t index, cpp2::AppendLogResponse& resp) {
-            return resp.get_error_code() == cpp2::ErrorCode::SUCCEEDED
-                    && !hosts[index]->isLearner();
-        })
+    // Fan the AppendLog requests out to all hosts in parallel. The
+    // promise is fulfilled as soon as a quorum of non-learner hosts
+    // have acked, so one straggler on a degraded disk does not gate
+    // the commit; its response is still recorded asynchronously and
+    // the host catches up through its own pending-request queue.
+    auto ctx = std::make_shared<AppendLogQuorumContext>(hosts.size());
+    if (quorum_ == 0 || hosts.empty()) {
+        ctx->fulfilled = true;
+        ctx->promise.setValue(ctx->resps);
+    }
+    for (size_t i = 0; i < hosts.size(); ++i) {
+        auto hostPtr = hosts[i];
+        VLOG(2) << idStr_
+                << "Appending logs to "
+                << hostPtr->idStr();
+        via(eb, [=] () -> Future<cpp2::AppendLogResponse> {
+            return hostPtr->appendLogs(eb,
+                                       currTerm,
+                                       lastLogId,
+                                       committedId,
+                                       prevLogTerm,
+                                       prevLogId);
+        }).then([ctx, i, hosts, quorum = quorum_] (Try<cpp2::AppendLogResponse>&& t) {
+            cpp2::AppendLogResponse resp;
+            if (t.hasException()) {
+                resp.set_error_code(cpp2::ErrorCode::E_EXCEPTION);
+            } else {
+                resp = std::move(t).value();
+            }
+            std::lock_guard<std::mutex> g(ctx->lock);
+            if (resp.get_error_code() == cpp2::ErrorCode::SUCCEEDED
+                    && !hosts[i]->isLearner()) {
+                ++ctx->numSucceeded;
+            }
+            ++ctx->numResponded;
+            ctx->resps.emplace_back(i, std::move(resp));
+            if (!ctx->fulfilled
+                    && (ctx->numSucceeded >= quorum || ctx->numResponded == ctx->total)) {
+                ctx->fulfilled = true;
+                ctx->promise.setValue(ctx->resps);
+            }
+        });
+    }
+    ctx->promise.getFuture()
         .via(executor_.get())
             .then([self = shared_from_this(),
                    eb,
@@ -857,6 +1085,20 @@ void RaftPart::processAppendLogResponses(
 
         LogID firstLogId = 0;
         AppendLogResult res = AppendLogResult::SUCCEEDED;
+        // In pipelined mode, the commit is gated on the WAL flush
+        // as well as the quorum acks. Wait for the flush outside of
+        // raftLock_, since the flush task itself grabs the lock.
+        if (walFlushFuture_.valid()) {
+            if (!std::move(walFlushFuture_).get()) {
+                LOG(ERROR) << idStr_ << "Failed to flush the pipelined WAL write";
+                res = AppendLogResult::E_WAL_FAILURE;
+            }
+            walFlushFuture_ = folly::Future<bool>::makeEmpty();
+        }
+        if (!checkAppendLogResult(res)) {
+            LOG(ERROR) << idStr_ << "processAppendLogResponses failed!";
+            return;
+        }
         do {
             std::lock_guard<std::mutex> g(raftLock_);
             if (status_ != Status::RUNNING) {
@@ -877,21 +1119,41 @@ void RaftPart::processAppendLogResponses(
             lastLogId_ = lastLogId;
             lastLogTerm_ = currTerm;
 
-            auto walIt = wal_->iterator(committedId + 1, lastLogId);
-            SlowOpTracker tracker;
-            // Step 3: Commit the batch
-            if (commitLogs(std::move(walIt))) {
-                committedLogId_ = lastLogId;
+            if (FLAGS_raft_async_apply) {
+                // Step 3 (async): the logs are durable on a quorum, hand
+                // the local apply over to a background task and fulfill
+                // the promises right away. The task folds everything
+                // replicated since its last round into one commitLogs call
+                quorumLogId_ = lastLogId;
                 firstLogId = lastLogId_ + 1;
+                if (!applyRunning_) {
+                    applyRunning_ = true;
+                    bgWorkers_->addTask([self = shared_from_this()] {
+                        self->applyLogsAsync();
+                    });
+                }
+                VLOG(2) << idStr_ << "Leader scheduled the apply of logs "
+                                  << committedId + 1 << " to " << lastLogId;
             } else {
-                LOG(FATAL) << idStr_ << "Failed to commit logs";
-            }
-            if (tracker.slow()) {
-                tracker.output(idStr_, folly::stringPrintf("Total commit: %ld",
-                                                           committedLogId_ - committedId));
+                auto walIt = wal_->iterator(committedId + 1, lastLogId);
+                TraceSpanGuard commitSpan("raft_commit");
+                SlowOpTracker tracker;
+                // Step 3: Commit the batch
+                if (commitLogs(std::move(walIt))) {
+                    committedLogId_ = lastLogId;
+                    firstLogId = lastLogId_ + 1;
+                    lastCommittedTerm_ = currTerm;
+                    commitCond_.notify_all();
+                } else {
+                    LOG(FATAL) << idStr_ << "Failed to commit logs";
+                }
+                if (tracker.slow()) {
+                    tracker.output(idStr_, folly::stringPrintf("Total commit: %ld",
+                                                               committedLogId_ - committedId));
+                }
+                VLOG(2) << idStr_ << "Leader succeeded in committing the logs "
+                                  << committedId + 1 << " to " << lastLogId;
             }
-            VLOG(2) << idStr_ << "Leader succeeded in committing the logs "
-                              << committedId + 1 << " to " << lastLogId;
 
             lastMsgAcceptedCostMs_ = lastMsgSentDur_.elapsedInMSec();
             lastMsgAcceptedTime_ = time::WallClock::fastNowInMilliSec();
@@ -911,7 +1173,7 @@ void RaftPart::processAppendLogResponses(
         // Step 5: Check whether need to continue
         // the log replication
         {
-            std::lock_guard<std::mutex> lck(logsLock_);
+            std::lock_guard<folly::SpinLock> lck(logsLock_);
             CHECK(replicatingLogs_);
             // Continue to process the original AppendLogsIterator if necessary
             iter.resume();
@@ -937,6 +1199,7 @@ void RaftPart::processAppendLogResponses(
                         });
                     logs_.clear();
                     bufferOverFlow_ = false;
+                    cachedLogsBytes_ = 0;
                 }
                 // Reset replicatingLogs_ one of the following is true:
                 // 1. old iter is empty && logs_.size() == 0
@@ -1072,9 +1335,7 @@ typename RaftPart::Role RaftPart::processElectionResponses(
             ++numSucceeded;
         } else if (r.second.get_error_code() == cpp2::ErrorCode::E_LOG_STALE) {
             LOG(INFO) << idStr_ << "My last log id is less than " << hosts[r.first]->address()
-                      << ", double my election interval.";
-            uint64_t curWeight = weight_.load();
-            weight_.store(curWeight * 2);
+                      << ", need to back off my election.";
         }
     }
 
@@ -1086,6 +1347,26 @@ typename RaftPart::Role RaftPart::processElectionResponses(
                   << proposedTerm_;
         term_ = proposedTerm_;
         role_ = Role::LEADER;
+    } else {
+        // Lost this round, double the backoff weight so that competing
+        // candidates stop colliding round after round. The weight stretches
+        // both the election timeout and the randomized retry delay, and is
+        // capped so a long outage does not leave the part unable to elect
+        uint64_t curWeight = weight_.load();
+        if (curWeight < FLAGS_raft_election_backoff_max_weight) {
+            weight_.store(curWeight * 2);
+        }
+        if (results.size() < quorum_) {
+            // Most peers did not even respond, so we are probably on the
+            // wrong side of a network partition. Take the proposed term
+            // back, otherwise it keeps growing while we are cut off and
+            // would dethrone a healthy leader the moment we rejoin. This
+            // is the protection a pre-vote phase would give us
+            LOG(INFO) << idStr_ << "Only " << results.size()
+                      << " peers responded, rewind the proposed term "
+                      << proposedTerm_ << " back to " << term_;
+            proposedTerm_ = term_;
+        }
     }
 
     return role_;
@@ -1217,7 +1498,7 @@ void RaftPart::statusPolling() {
             VLOG(2) << idStr_ << "Wait for a while and continue the leader election";
             delay = (folly::Random::rand32(1500) + 500) * weight_;
         }
-    } else if (needToSendHeartbeat()) {
+    } else if (!FLAGS_raft_coalesced_heartbeats && needToSendHeartbeat()) {
         VLOG(2) << idStr_ << "Need to send heartbeat";
         sendHeartbeat();
     }
@@ -1253,6 +1534,14 @@ void RaftPart::cleanupSnapshot() {
     std::lock_guard<std::mutex> g(raftLock_);
     reset();
     status_ = Status::RUNNING;
+    releaseSnapshotRecvSlot();
+}
+
+void RaftPart::releaseSnapshotRecvSlot() {
+    if (recvSnapshotSlotHeld_) {
+        snapshot_->finishRecv(recvSnapshotFrom_);
+        recvSnapshotSlotHeld_ = false;
+    }
 }
 
 bool RaftPart::needToCleanWal() {
@@ -1410,7 +1699,7 @@ void RaftPart::processAskForVoteRequest(
 
 
 void RaftPart::processAppendLogRequest(
-        const cpp2::AppendLogRequest& req,
+        cpp2::AppendLogRequest& req,
         cpp2::AppendLogResponse& resp) {
     if (FLAGS_trace_raft) {
         LOG(INFO) << idStr_
@@ -1467,6 +1756,20 @@ void RaftPart::processAppendLogRequest(
     // Reset the timeout timer
     lastMsgRecvDur_.reset();
 
+    // Restore the log payloads upfront in case the leader compresses them.
+    // The request is not used again once this handler returns, so steal
+    // the payloads instead of deep-copying every log string
+    std::vector<cpp2::LogEntry> logEntries;
+    if (FLAGS_raft_log_compression) {
+        if (!decodeLogEntries(req.get_log_str_list(), logEntries)) {
+            LOG(ERROR) << idStr_ << "Failed to decode the log payloads";
+            resp.set_error_code(cpp2::ErrorCode::E_WAL_FAIL);
+            return;
+        }
+    } else {
+        logEntries = std::move(req.log_str_list);
+    }
+
     if (req.get_sending_snapshot() && status_ != Status::WAITING_SNAPSHOT) {
         LOG(INFO) << idStr_ << "Begin to wait for the snapshot"
                   << " " << req.get_committed_log_id();
@@ -1481,7 +1784,7 @@ void RaftPart::processAppendLogRequest(
                 << "The part is receiving snapshot,"
                 << "so just accept the new wals, but don't commit them."
                 << "last_log_id_sent " << req.get_last_log_id_sent()
-                << ", total log number " << req.get_log_str_list().size();
+                << ", total log number " << logEntries.size();
         if (lastLogId_ > 0 && req.get_last_log_id_sent() > lastLogId_) {
             // There is a gap
             LOG(INFO) << idStr_ << "Local is missing logs from id "
@@ -1492,14 +1795,14 @@ void RaftPart::processAppendLogRequest(
         // TODO(heng): if we have 3 node, one is leader, one is wait snapshot and return success,
         // the other is follower, but leader replica log to follow failed,
         // How to deal with leader crash? At this time, no leader will be elected.
-        size_t numLogs = req.get_log_str_list().size();
+        size_t numLogs = logEntries.size();
         LogID firstId = req.get_last_log_id_sent() + 1;
 
         VLOG(2) << idStr_ << "Writing log [" << firstId
                 << ", " << firstId + numLogs - 1 << "] to WAL";
         LogStrListIterator iter(firstId,
                                 req.get_log_term(),
-                                req.get_log_str_list());
+                                std::move(logEntries));
         if (wal_->appendLogs(iter)) {
             // When leader has been sending a snapshot already, sometimes it would send a request
             // with empty log list, and lastLogId in wal may be 0 because of reset.
@@ -1574,13 +1877,13 @@ void RaftPart::processAppendLogRequest(
     }
 
     // Append new logs
-    size_t numLogs = req.get_log_str_list().size();
+    size_t numLogs = logEntries.size();
     LogID firstId = req.get_last_log_id_sent() + 1;
     VLOG(2) << idStr_ << "Writing log [" << firstId
             << ", " << firstId + numLogs - 1 << "] to WAL";
     LogStrListIterator iter(firstId,
                             req.get_log_term(),
-                            req.get_log_str_list());
+                            std::move(logEntries));
     if (wal_->appendLogs(iter)) {
         CHECK_EQ(firstId + numLogs - 1, wal_->lastLogId());
         lastLogId_ = wal_->lastLogId();
@@ -1604,6 +1907,7 @@ void RaftPart::processAppendLogRequest(
                               << committedLogId_ + 1 << " to "
                               << lastLogIdCanCommit;
             committedLogId_ = lastLogIdCanCommit;
+            commitCond_.notify_all();
             resp.set_committed_log_id(lastLogIdCanCommit);
         } else {
             LOG(ERROR) << idStr_ << "Failed to commit log "
@@ -1745,6 +2049,21 @@ void RaftPart::processSendSnapshotRequest(const cpp2::SendSnapshotRequest& req,
         resp.set_error_code(cpp2::ErrorCode::E_TERM_OUT_OF_DATE);
         return;
     }
+    if (!recvSnapshotSlotHeld_) {
+        // First batch of a new stream; take an inbound slot before
+        // touching any data. When the source host already runs its share
+        // of streams into us, fail this one and let the sender retry on
+        // a later heartbeat
+        auto source = HostAddr(req.get_leader_addr(), req.get_leader_port());
+        if (!snapshot_->tryStartRecv(source)) {
+            LOG(INFO) << idStr_ << "Too many snapshot streams coming from "
+                      << source << ", let this one retry later";
+            resp.set_error_code(cpp2::ErrorCode::E_NOT_READY);
+            return;
+        }
+        recvSnapshotFrom_ = source;
+        recvSnapshotSlotHeld_ = true;
+    }
     if (status_ != Status::WAITING_SNAPSHOT) {
         LOG(INFO) << idStr_ << "Begin to receive the snapshot";
         reset();
@@ -1769,6 +2088,7 @@ void RaftPart::processSendSnapshotRequest(const cpp2::SendSnapshotRequest& req,
     }
     if (req.get_done()) {
         committedLogId_ = req.get_committed_log_id();
+        commitCond_.notify_all();
         if (lastLogId_ < committedLogId_) {
             lastLogId_ = committedLogId_;
             lastLogTerm_ = req.get_committed_log_term();
@@ -1778,6 +2098,7 @@ void RaftPart::processSendSnapshotRequest(const cpp2::SendSnapshotRequest& req,
             wal_->reset();
         }
         status_ = Status::RUNNING;
+        releaseSnapshotRecvSlot();
         LOG(INFO) << idStr_ << "Receive all snapshot, committedLogId_ " << committedLogId_
                   << ", lastLodId " << lastLogId_ << ", lastLogTermId " << lastLogTerm_;
     }
@@ -1805,11 +2126,12 @@ std::vector<std::shared_ptr<Host>> RaftPart::followers() const {
 bool RaftPart::checkAppendLogResult(AppendLogResult res) {
     if (res != AppendLogResult::SUCCEEDED) {
         {
-            std::lock_guard<std::mutex> lck(logsLock_);
+            std::lock_guard<folly::SpinLock> lck(logsLock_);
             logs_.clear();
             cachingPromise_.setValue(res);
             cachingPromise_.reset();
             bufferOverFlow_ = false;
+            cachedLogsBytes_ = 0;
         }
         sendingPromise_.setValue(res);
         replicatingLogs_ = false;
@@ -1854,6 +2176,21 @@ AppendLogResult RaftPart::isCatchedUp(const HostAddr& peer) {
     return AppendLogResult::E_INVALID_PEER;
 }
 
+size_t RaftPart::healthyReplicas() {
+    std::lock_guard<std::mutex> lck(raftLock_);
+    // Count myself plus every non-learner peer not behind a snapshot. A
+    // dead peer that needs no snapshot still counts: the leader has no
+    // cheap way to tell it apart, and overcounting merely queues this
+    // part behind ones that are verifiably worse off
+    size_t count = 1;
+    for (auto& host : hosts_) {
+        if (!host->isLearner() && !host->sendingSnapshot_) {
+            ++count;
+        }
+    }
+    return count;
+}
+
 bool RaftPart::linkCurrentWAL(const char* newPath) {
     CHECK_NOTNULL(newPath);
     std::lock_guard<std::mutex> g(raftLock_);
@@ -1890,6 +2227,43 @@ bool RaftPart::leaseValid() {
         < FLAGS_raft_heartbeat_interval_secs * 1000 - lastMsgAcceptedCostMs_;
 }
 
+bool RaftPart::canReadUnderLease() {
+    std::lock_guard<std::mutex> g(raftLock_);
+    if (role_ != Role::LEADER) {
+        return false;
+    }
+    if (hosts_.empty()) {
+        // Single replica, no lease needed
+        return true;
+    }
+    // A fresh leader may not serve lease reads before it has committed
+    // a log in its own term, otherwise its applied state could still be
+    // behind what the previous leader committed
+    if (lastCommittedTerm_ != term_) {
+        return false;
+    }
+    return time::WallClock::fastNowInMilliSec() - lastMsgAcceptedTime_
+        < FLAGS_raft_heartbeat_interval_secs * 1000 - lastMsgAcceptedCostMs_;
+}
+
+bool RaftPart::syncedWithLeader() {
+    std::lock_guard<std::mutex> g(raftLock_);
+    if (role_ == Role::LEADER) {
+        return true;
+    }
+    if (role_ != Role::FOLLOWER && role_ != Role::LEARNER) {
+        return false;
+    }
+    if (status_ != Status::RUNNING) {
+        return false;
+    }
+    // The replica must have heard from a known leader within the
+    // staleness bound, which also bounds how far its applied state
+    // can lag behind the leader's
+    return leader_ != HostAddr("", 0)
+        && lastMsgRecvDur_.elapsedInMSec() <= FLAGS_follower_read_max_staleness_ms;
+}
+
 }  // namespace raftex
 }  // namespace nebula
 
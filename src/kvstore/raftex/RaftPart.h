@@ -15,6 +15,7 @@
 #include "kvstore/raftex/SnapshotManager.h"
 #include <folly/futures/SharedPromise.h>
 #include <folly/Function.h>
+#include <folly/SpinLock.h>
 #include <gtest/gtest_prod.h>
 #include "utils/LogIterator.h"
 
@@ -75,6 +76,7 @@ class RaftPart : public std::enable_shared_from_this<RaftPart> {
     friend class AppendLogsIterator;
     friend class Host;
     friend class SnapshotManager;
+    friend class RaftexService;
     FRIEND_TEST(MemberChangeTest, AddRemovePeerTest);
     FRIEND_TEST(MemberChangeTest, RemoveLeaderTest);
 
@@ -127,6 +129,21 @@ public:
         return leader_;
     }
 
+    // The (logId, term) of the last log this replica has applied to its
+    // state machine. Sampled after a successful write it is a session
+    // token: any replica whose applied log has reached the id has the
+    // write, so a read presenting the token never sees an older state
+    std::pair<LogID, TermID> committedLogIdAndTerm() const {
+        std::lock_guard<std::mutex> g(raftLock_);
+        return std::make_pair(committedLogId_, lastCommittedTerm_);
+    }
+
+    // Block until this replica has applied logId. Returns false when
+    // timeoutMs ran out or the part stopped first. Log ids grow
+    // monotonically across terms, so waiting on the id alone is enough
+    // for a token taken from any replica
+    bool waitCommitted(LogID logId, int64_t timeoutMs);
+
     std::shared_ptr<wal::FileBasedWal> wal() const {
         return wal_;
     }
@@ -183,6 +200,12 @@ public:
      * */
     AppendLogResult isCatchedUp(const HostAddr& peer);
 
+    // The replicas believed to hold a full copy of the data: the part
+    // itself plus every non-learner peer not currently behind a
+    // snapshot. SnapshotManager serves the most under-replicated parts
+    // first based on this
+    size_t healthyReplicas();
+
     bool linkCurrentWAL(const char* newPath);
 
     /**
@@ -200,9 +223,11 @@ public:
         const cpp2::AskForVoteRequest& req,
         cpp2::AskForVoteResponse& resp);
 
-    // Process appendLog request
+    // Process appendLog request. The request is mutable so the log
+    // payloads can be moved out instead of copied; it must not be
+    // accessed after this returns
     void processAppendLogRequest(
-        const cpp2::AppendLogRequest& req,
+        cpp2::AppendLogRequest& req,
         cpp2::AppendLogResponse& resp);
 
     // Process sendSnapshot request
@@ -212,6 +237,17 @@ public:
 
     bool leaseValid();
 
+    // Whether a linearizable read can be served locally, without a
+    // heartbeat round: the part must be the leader, must have committed
+    // a log in its own term, and the lease obtained from the last
+    // quorum-accepted message must still hold
+    bool canReadUnderLease();
+
+    // Whether a follower/learner may serve a stale-tolerant read,
+    // i.e. it has heard from the leader within
+    // FLAGS_follower_read_max_staleness_ms
+    bool syncedWithLeader();
+
 protected:
     // Protected constructor to prevent from instantiating directly
     RaftPart(
@@ -335,6 +371,11 @@ private:
 
     void cleanupSnapshot();
 
+    // Give back the inbound stream slot held for the snapshot being
+    // received, if any; called with raftLock_ held on every way out of
+    // Status::WAITING_SNAPSHOT
+    void releaseSnapshotRecvSlot();
+
     bool needToCleanWal();
 
     // The method sends out AskForVote request
@@ -361,6 +402,15 @@ private:
                                                   std::string log,
                                                   AtomicOp cb = nullptr);
 
+    // Kick the replication round when the group-commit time window expires
+    void flushBatchWindow();
+
+    // Apply the quorum-replicated logs to the state machine on a
+    // background worker, in order, batching everything replicated since
+    // the last round into one commitLogs call. Only used when
+    // FLAGS_raft_async_apply is on
+    void applyLogsAsync();
+
     void appendLogsInternal(AppendLogsIterator iter, TermID termId);
 
     void replicateLogs(
@@ -476,16 +526,28 @@ protected:
     std::vector<std::shared_ptr<Host>> hosts_;
     size_t quorum_{0};
 
-    // The lock is used to protect logs_ and cachingPromise_
-    mutable std::mutex logsLock_;
+    // The lock is used to protect logs_ and cachingPromise_. The critical
+    // sections are a few list operations only, so a spin lock beats parking
+    // the appending threads when many of them hit one partition
+    mutable folly::SpinLock logsLock_;
     std::atomic_bool replicatingLogs_{false};
     std::atomic_bool bufferOverFlow_{false};
     PromiseSet<AppendLogResult> cachingPromise_;
     LogCache logs_;
+    // Total size in bytes of the logs buffered in logs_,
+    // protected by logsLock_
+    size_t cachedLogsBytes_{0};
+    // Whether a group-commit window task has been scheduled,
+    // protected by logsLock_
+    bool batchWindowScheduled_{false};
 
     // Partition level lock to synchronize the access of the partition
     mutable std::mutex raftLock_;
 
+    // Signalled under raftLock_ whenever committedLogId_ advances;
+    // waitCommitted blocks on it
+    mutable std::condition_variable commitCond_;
+
     PromiseSet<AppendLogResult> sendingPromise_;
 
     Status status_;
@@ -510,6 +572,16 @@ protected:
     TermID lastLogTerm_{0};
     // The id for the last globally committed log (from the leader)
     LogID committedLogId_{0};
+    // The term in which this part last committed a log as the leader.
+    // A fresh leader must commit a log in its own term before its
+    // lease can be trusted for local reads
+    TermID lastCommittedTerm_{0};
+    // The highest log id known to be replicated to a quorum. Only ahead
+    // of committedLogId_ when FLAGS_raft_async_apply is on and the apply
+    // task has not caught up yet. Protected by raftLock_
+    LogID quorumLogId_{0};
+    // Whether the background apply task is running, protected by raftLock_
+    bool applyRunning_{false};
 
     // To record how long ago when the last leader message received
     time::Duration lastMsgRecvDur_;
@@ -523,6 +595,11 @@ protected:
     // Write-ahead Log
     std::shared_ptr<wal::FileBasedWal> wal_;
 
+    // Fulfilled when the pipelined WAL flush of the in-flight batch
+    // finishes. Only valid when FLAGS_raft_pipelined_log_append is on,
+    // and only accessed by the (serialized) replication round
+    folly::Future<bool> walFlushFuture_ = folly::Future<bool>::makeEmpty();
+
     // IO Thread pool
     std::shared_ptr<folly::IOThreadPoolExecutor> ioThreadPool_;
     // Shared worker thread pool
@@ -537,6 +614,10 @@ protected:
     int64_t lastTotalCount_ = 0;
     int64_t lastTotalSize_ = 0;
     time::Duration lastSnapshotRecvDur_;
+    // The host whose inbound stream slot this part holds while
+    // receiving a snapshot (see SnapshotManager::tryStartRecv)
+    HostAddr recvSnapshotFrom_;
+    bool recvSnapshotSlotHeld_{false};
 
     // Used to bypass the stale command
     int64_t startTimeMs_ = 0;
@@ -6,9 +6,21 @@
 
 #include "common/base/Base.h"
 #include "kvstore/raftex/RaftexService.h"
+#include <folly/Hash.h>
 #include <folly/ScopeGuard.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include "kvstore/raftex/RaftPart.h"
 
+DEFINE_bool(raft_coalesced_heartbeats, false,
+            "Drive the heartbeats of all raft parts from one service-level "
+            "loop instead of per-part delayed tasks. With 100+ partitions "
+            "per host this avoids thousands of timer wakeups per second");
+DECLARE_uint32(raft_heartbeat_interval_secs);
+DEFINE_uint32(raft_executor_lanes, 0,
+              "Number of single-threaded executor lanes the raft parts are "
+              "sharded onto by hashing (spaceId, partId). 0 keeps all parts "
+              "on the shared workers pool");
+
 namespace nebula {
 namespace raftex {
 
@@ -29,10 +41,32 @@ std::shared_ptr<RaftexService> RaftexService::createService(
     svc->server_->setInterface(svc);
 
     svc->initThriftServer(pool, workers, port);
+
+    if (FLAGS_raft_executor_lanes > 0) {
+        svc->lanes_.reserve(FLAGS_raft_executor_lanes);
+        for (uint32_t i = 0; i < FLAGS_raft_executor_lanes; i++) {
+            svc->lanes_.emplace_back(std::make_shared<folly::CPUThreadPoolExecutor>(
+                1,
+                std::make_shared<folly::NamedThreadFactory>(
+                    folly::stringPrintf("raft-lane-%u", i))));
+        }
+        LOG(INFO) << "Created " << FLAGS_raft_executor_lanes
+                  << " executor lanes for the raft parts";
+    }
     return svc;
 }
 
 
+std::shared_ptr<folly::Executor> RaftexService::laneExecutor(GraphSpaceID spaceId,
+                                                             PartitionID partId) const {
+    if (lanes_.empty()) {
+        return nullptr;
+    }
+    auto idx = folly::hash::hash_combine(spaceId, partId) % lanes_.size();
+    return lanes_[idx];
+}
+
+
 RaftexService::~RaftexService() {
 }
 
@@ -48,10 +82,37 @@ bool RaftexService::start() {
         return false;
     }
 
+    if (FLAGS_raft_coalesced_heartbeats) {
+        heartbeatThread_.reset(new std::thread([&] { heartbeatLoop(); }));
+    }
+
     return true;
 }
 
 
+void RaftexService::heartbeatLoop() {
+    LOG(INFO) << "Start the coalesced heartbeat loop";
+    while (status_.load() == STATUS_RUNNING) {
+        std::vector<std::shared_ptr<RaftPart>> parts;
+        {
+            folly::RWSpinLock::ReadHolder rh(partsLock_);
+            parts.reserve(parts_.size());
+            for (auto& p : parts_) {
+                parts.emplace_back(p.second);
+            }
+        }
+        for (auto& part : parts) {
+            if (part->needToSendHeartbeat()) {
+                part->sendHeartbeat();
+            }
+        }
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(FLAGS_raft_heartbeat_interval_secs * 1000 / 3));
+    }
+    LOG(INFO) << "The coalesced heartbeat loop stopped";
+}
+
+
 void RaftexService::waitUntilReady() {
     while (status_.load() == STATUS_NOT_RUNNING) {
         std::this_thread::sleep_for(std::chrono::microseconds(100));
@@ -145,6 +206,14 @@ void RaftexService::stop() {
 
 
 void RaftexService::waitUntilStop() {
+    for (auto& lane : lanes_) {
+        lane->join();
+    }
+    lanes_.clear();
+    if (heartbeatThread_) {
+        heartbeatThread_->join();
+        heartbeatThread_.reset();
+    }
     if (serverThread_) {
         serverThread_->join();
         serverThread_.reset();
@@ -211,7 +280,9 @@ void RaftexService::appendLog(
         return;
     }
 
-    part->processAppendLogRequest(req, resp);
+    // The server discards the request once this handler returns, so it
+    // is safe to let the part move the log payloads out of it
+    part->processAppendLogRequest(const_cast<cpp2::AppendLogRequest&>(req), resp);
 }
 
 void RaftexService::sendSnapshot(
@@ -10,6 +10,7 @@
 #include "common/base/Base.h"
 #include "common/interface/gen-cpp2/RaftexService.h"
 #include <folly/RWSpinLock.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 namespace nebula {
@@ -39,6 +40,22 @@ public:
     void stop();
     void waitUntilStop();
 
+    // The loop which drives the heartbeats of all leader parts when
+    // FLAGS_raft_coalesced_heartbeats is on. Parts which lead to the
+    // same peer hosts fire back-to-back on the shared client
+    // connections, in one wakeup per interval, instead of each part
+    // scheduling its own delayed task
+    void heartbeatLoop();
+
+    // The executor lane the given part is pinned to, decided by hashing
+    // (spaceId, partId) onto FLAGS_raft_executor_lanes single-threaded
+    // executors. All deferred work of one part runs on one thread, so a
+    // hot part cannot queue behind the timers of hundreds of cold ones.
+    // Returns nullptr when the lanes are disabled and the caller should
+    // fall back to the shared workers pool
+    std::shared_ptr<folly::Executor> laneExecutor(GraphSpaceID spaceId,
+                                                  PartitionID partId) const;
+
     void askForVote(cpp2::AskForVoteResponse& resp,
                     const cpp2::AskForVoteRequest& req) override;
 
@@ -69,7 +86,9 @@ private:
 
 private:
     std::unique_ptr<apache::thrift::ThriftServer> server_;
+    std::vector<std::shared_ptr<folly::CPUThreadPoolExecutor>> lanes_;
     std::unique_ptr<std::thread> serverThread_;
+    std::unique_ptr<std::thread> heartbeatThread_;
     uint32_t serverPort_;
 
     enum RaftServiceStatus{
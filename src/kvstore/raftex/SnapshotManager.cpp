@@ -5,11 +5,18 @@
  */
 #include "kvstore/raftex/SnapshotManager.h"
 #include "kvstore/raftex/RaftPart.h"
+#include "common/time/Duration.h"
 
 DEFINE_int32(snapshot_worker_threads, 4, "Threads number for snapshot");
 DEFINE_int32(snapshot_io_threads, 4, "Threads number for snapshot");
 DEFINE_int32(snapshot_send_retry_times, 3, "Retry times if send failed");
 DEFINE_int32(snapshot_send_timeout_ms, 60000, "Rpc timeout for sending snapshot");
+DEFINE_int64(snapshot_send_rate_limit, 0,
+             "Max bytes per second when sending snapshot, 0 means no limit");
+DEFINE_int32(snapshot_max_out_streams_per_host, 2,
+             "Max concurrent snapshot streams sent to one host, 0 means no limit");
+DEFINE_int32(snapshot_max_in_streams_per_host, 2,
+             "Max concurrent snapshot streams accepted from one host, 0 means no limit");
 
 namespace nebula {
 namespace raftex {
@@ -21,9 +28,157 @@ SnapshotManager::SnapshotManager() {
 
 folly::Future<Status> SnapshotManager::sendSnapshot(std::shared_ptr<RaftPart> part,
                                                     const HostAddr& dst) {
-    folly::Promise<Status> p;
-    auto fut = p.getFuture();
-    executor_->add([this, p = std::move(p), part, dst] () mutable {
+    SendTask task;
+    task.part = std::move(part);
+    task.dst = dst;
+    auto fut = task.promise.getFuture();
+    {
+        std::lock_guard<std::mutex> g(sendLock_);
+        task.seq = nextSeq_++;
+        waiting_.emplace_back(std::move(task));
+    }
+    // Dispatch off the caller's thread: picking a task consults the
+    // parts' health, which must not happen under the raft locks the
+    // caller may hold
+    executor_->add([this] { scheduleNext(); });
+    return fut;
+}
+
+void SnapshotManager::scheduleNext() {
+    while (true) {
+        // Grab the candidates first and consult their health with no
+        // lock of ours held: healthyReplicas() takes the raft lock
+        std::vector<std::pair<size_t, std::shared_ptr<RaftPart>>> cands;
+        {
+            std::lock_guard<std::mutex> g(sendLock_);
+            for (auto& t : waiting_) {
+                if (hostHasOutCapacity(t.dst)) {
+                    cands.emplace_back(t.seq, t.part);
+                }
+            }
+        }
+        if (cands.empty()) {
+            return;
+        }
+        std::unordered_map<size_t, size_t> healthy;
+        for (auto& c : cands) {
+            healthy.emplace(c.first, c.second->healthyReplicas());
+        }
+        SendTask task;
+        {
+            std::lock_guard<std::mutex> g(sendLock_);
+            // The most under-replicated part goes first; within the same
+            // health the queue is FIFO. Tasks enqueued after the scan
+            // above wait for the next round
+            auto best = waiting_.end();
+            size_t bestHealthy = 0;
+            for (auto it = waiting_.begin(); it != waiting_.end(); ++it) {
+                auto hit = healthy.find(it->seq);
+                if (hit == healthy.end() || !hostHasOutCapacity(it->dst)) {
+                    continue;
+                }
+                if (best == waiting_.end() || hit->second < bestHealthy) {
+                    best = it;
+                    bestHealthy = hit->second;
+                }
+            }
+            if (best == waiting_.end()) {
+                return;
+            }
+            task = std::move(*best);
+            waiting_.erase(best);
+            ++outStreams_[task.dst];
+        }
+        auto dst = task.dst;
+        runSendTask(std::move(task));
+        {
+            std::lock_guard<std::mutex> g(sendLock_);
+            auto it = outStreams_.find(dst);
+            if (it != outStreams_.end() && --it->second == 0) {
+                outStreams_.erase(it);
+            }
+        }
+    }
+}
+
+bool SnapshotManager::hostHasOutCapacity(const HostAddr& dst) {
+    if (FLAGS_snapshot_max_out_streams_per_host <= 0) {
+        return true;
+    }
+    auto it = outStreams_.find(dst);
+    return it == outStreams_.end() ||
+           it->second < static_cast<size_t>(FLAGS_snapshot_max_out_streams_per_host);
+}
+
+bool SnapshotManager::tryStartRecv(const HostAddr& source) {
+    std::lock_guard<std::mutex> g(recvLock_);
+    auto& streams = inStreams_[source];
+    if (FLAGS_snapshot_max_in_streams_per_host > 0 &&
+        streams >= static_cast<size_t>(FLAGS_snapshot_max_in_streams_per_host)) {
+        return false;
+    }
+    ++streams;
+    return true;
+}
+
+void SnapshotManager::finishRecv(const HostAddr& source) {
+    std::lock_guard<std::mutex> g(recvLock_);
+    auto it = inStreams_.find(source);
+    if (it == inStreams_.end()) {
+        return;
+    }
+    if (--it->second == 0) {
+        inStreams_.erase(it);
+    }
+}
+
+std::string SnapshotManager::scheduleStatus() {
+    std::vector<std::tuple<size_t, std::shared_ptr<RaftPart>, HostAddr>> cands;
+    std::stringstream os;
+    {
+        std::lock_guard<std::mutex> g(sendLock_);
+        for (auto& out : outStreams_) {
+            os << "sending: " << out.second << " streams to " << out.first << "\n";
+        }
+        for (auto& t : waiting_) {
+            cands.emplace_back(t.seq, t.part, t.dst);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> g(recvLock_);
+        for (auto& in : inStreams_) {
+            os << "receiving: " << in.second << " streams from " << in.first << "\n";
+        }
+    }
+    // Show the queue in dispatch order: fewest healthy replicas first,
+    // FIFO within the same health. The health is read outside our locks,
+    // like scheduleNext does
+    std::vector<std::tuple<size_t, size_t, std::shared_ptr<RaftPart>, HostAddr>> queue;
+    for (auto& c : cands) {
+        queue.emplace_back(std::get<1>(c)->healthyReplicas(),
+                           std::get<0>(c),
+                           std::get<1>(c),
+                           std::get<2>(c));
+    }
+    std::sort(queue.begin(), queue.end(),
+              [] (const auto& l, const auto& r) {
+        return std::tie(std::get<0>(l), std::get<1>(l)) <
+               std::tie(std::get<0>(r), std::get<1>(r));
+    });
+    size_t pos = 0;
+    for (auto& q : queue) {
+        os << "queued #" << ++pos << ": " << std::get<2>(q)->idStr_
+           << "to " << std::get<3>(q)
+           << ", healthy replicas " << std::get<0>(q) << "\n";
+    }
+    return os.str();
+}
+
+void SnapshotManager::runSendTask(SendTask task) {
+    auto part = std::move(task.part);
+    auto dst = task.dst;
+    folly::Promise<Status> p = std::move(task.promise);
+    {
         auto spaceId = part->spaceId_;
         auto partId = part->partId_;
         auto termId = part->term_;
@@ -35,10 +190,15 @@ folly::Future<Status> SnapshotManager::sendSnapshot(std::shared_ptr<RaftPart> pa
         LOG(INFO) << part->idStr_ << "Begin to send the snapshot"
                                   << ", commitLogId = " << commitLogIdAndTerm.first
                                   << ", commitLogTerm = " << commitLogIdAndTerm.second;
+        // Throttle the snapshot stream so that rebuilding a replica does not
+        // saturate the network and disturb foreground traffic. The stream is
+        // sent batch by batch on this thread, so the bookkeeping needs no lock.
+        time::Duration sendDur;
+        int64_t sentBytes = 0;
         accessAllRowsInSnapshot(spaceId,
                                 partId,
                                 [&, this, p = std::move(p)] (
-                                           const std::vector<std::string>& data,
+                                           std::vector<std::string>&& data,
                                            int64_t totalCount,
                                            int64_t totalSize,
                                            SnapshotStatus status) mutable -> bool {
@@ -47,23 +207,39 @@ folly::Future<Status> SnapshotManager::sendSnapshot(std::shared_ptr<RaftPart> pa
                 p.setValue(Status::Error("Send snapshot failed!"));
                 return false;
             }
+            if (FLAGS_snapshot_send_rate_limit > 0 && sentBytes > 0) {
+                // Simple token-bucket: if we are ahead of the configured rate,
+                // sleep until the bytes sent so far fit into the budget.
+                int64_t expectedMs = sentBytes * 1000 / FLAGS_snapshot_send_rate_limit;
+                int64_t elapsedMs = static_cast<int64_t>(sendDur.elapsedInMSec());
+                if (expectedMs > elapsedMs) {
+                    usleep((expectedMs - elapsedMs) * 1000);
+                }
+            }
+            int64_t batchBytes = 0;
+            for (const auto& row : data) {
+                batchBytes += row.size();
+            }
+            auto req = std::make_shared<raftex::cpp2::SendSnapshotRequest>();
+            req->set_space(spaceId);
+            req->set_part(partId);
+            req->set_term(termId);
+            req->set_committed_log_id(commitLogIdAndTerm.first);
+            req->set_committed_log_term(commitLogIdAndTerm.second);
+            req->set_leader_addr(localhost.host);
+            req->set_leader_port(localhost.port);
+            req->set_rows(std::move(data));
+            req->set_total_size(totalSize);
+            req->set_total_count(totalCount);
+            req->set_done(status == SnapshotStatus::DONE);
             int retry = FLAGS_snapshot_send_retry_times;
             while (retry-- > 0) {
-                auto f = send(spaceId,
-                              partId,
-                              termId,
-                              commitLogIdAndTerm.first,
-                              commitLogIdAndTerm.second,
-                              localhost,
-                              data,
-                              totalSize,
-                              totalCount,
-                              dst,
-                              status == SnapshotStatus::DONE);
+                auto f = send(req, dst);
                 // TODO(heng): we send request one by one to avoid too large memory occupied.
                 try {
                     auto resp  = std::move(f).get();
                     if (resp.get_error_code() == cpp2::ErrorCode::SUCCEEDED) {
+                        sentBytes += batchBytes;
                         VLOG(1) << part->idStr_ << "has sended count " << totalCount;
                         if (status == SnapshotStatus::DONE) {
                             LOG(INFO) << part->idStr_ << "Finished, totalCount " << totalCount
@@ -89,39 +265,17 @@ folly::Future<Status> SnapshotManager::sendSnapshot(std::shared_ptr<RaftPart> pa
             p.setValue(Status::Error("Send snapshot failed!"));
             return false;
         });
-    });
-    return fut;
+    }
 }
 
 folly::Future<raftex::cpp2::SendSnapshotResponse> SnapshotManager::send(
-                                                            GraphSpaceID spaceId,
-                                                            PartitionID partId,
-                                                            TermID termId,
-                                                            LogID committedLogId,
-                                                            TermID committedLogTerm,
-                                                            const HostAddr& localhost,
-                                                            const std::vector<std::string>& data,
-                                                            int64_t totalSize,
-                                                            int64_t totalCount,
-                                                            const HostAddr& addr,
-                                                            bool finished) {
+                                std::shared_ptr<raftex::cpp2::SendSnapshotRequest> req,
+                                const HostAddr& addr) {
     VLOG(2) << "Send snapshot request to " << addr;
-    raftex::cpp2::SendSnapshotRequest req;
-    req.set_space(spaceId);
-    req.set_part(partId);
-    req.set_term(termId);
-    req.set_committed_log_id(committedLogId);
-    req.set_committed_log_term(committedLogTerm);
-    req.set_leader_addr(localhost.host);
-    req.set_leader_port(localhost.port);
-    req.set_rows(data);
-    req.set_total_size(totalSize);
-    req.set_total_count(totalCount);
-    req.set_done(finished);
     auto* evb = ioThreadPool_->getEventBase();
-    return folly::via(evb, [this, addr, evb, req = std::move(req)] () mutable {
+    return folly::via(evb, [this, addr, evb, req = std::move(req)] () {
         auto client = connManager_.client(addr, evb, false, FLAGS_snapshot_send_timeout_ms);
-        return client->future_sendSnapshot(req);
+        return client->future_sendSnapshot(*req);
     });
 }
 
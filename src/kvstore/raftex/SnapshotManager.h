@@ -26,7 +26,9 @@ enum SnapshotStatus {
     FAILED,
 };
 
-using SnapshotCallback = folly::Function<bool(const std::vector<std::string>& rows,
+// The rows are passed by rvalue reference, so that the sender could move them
+// into the rpc request instead of copying the whole batch again.
+using SnapshotCallback = folly::Function<bool(std::vector<std::string>&& rows,
                                               int64_t totalCount,
                                               int64_t totalSize,
                                               SnapshotStatus status)>;
@@ -37,23 +39,53 @@ public:
     SnapshotManager();
     virtual ~SnapshotManager() = default;
 
-    // Send snapshot for spaceId, partId to host dst.
+    // Send snapshot for spaceId, partId to host dst. The stream does not
+    // necessarily start right away: sends are queued and dispatched to
+    // parts with the fewest healthy replicas first, at most
+    // --snapshot_max_out_streams_per_host of them running against one
+    // destination at a time
     folly::Future<Status> sendSnapshot(std::shared_ptr<RaftPart> part,
                                        const HostAddr& dst);
 
+    // Called by the receiving part when the first batch of a new inbound
+    // stream shows up. False when the source host already runs
+    // --snapshot_max_in_streams_per_host streams into us; the sender
+    // fails the stream and retries on a later heartbeat
+    bool tryStartRecv(const HostAddr& source);
+
+    // Return the inbound slot taken by tryStartRecv
+    void finishRecv(const HostAddr& source);
+
+    // Running and queued streams, one line each with the queue position,
+    // for "/admin?op=snapshot_queue"
+    std::string scheduleStatus();
+
 private:
+    struct SendTask {
+        std::shared_ptr<RaftPart> part;
+        HostAddr dst;
+        folly::Promise<Status> promise;
+        size_t seq{0};
+    };
+
+    // Dispatch eligible queued sends, running each stream on the calling
+    // worker thread until nothing is eligible. Must not be called while
+    // any raft lock is held: picking a task consults the parts' health
+    void scheduleNext();
+
+    // The whole stream of one snapshot, batch by batch; blocks until it
+    // finishes or fails
+    void runSendTask(SendTask task);
+
+    // Whether dst may take one more outbound stream; call with sendLock_
+    // held
+    bool hostHasOutCapacity(const HostAddr& dst);
+
+    // The request is shared between retries, so the rows are only moved into
+    // it once no matter how many times the batch is sent.
     folly::Future<raftex::cpp2::SendSnapshotResponse> send(
-                                                   GraphSpaceID spaceId,
-                                                   PartitionID partId,
-                                                   TermID termId,
-                                                   LogID committedLogId,
-                                                   TermID committedLogTerm,
-                                                   const HostAddr& localhost,
-                                                   const std::vector<std::string>& data,
-                                                   int64_t totalSize,
-                                                   int64_t totalCount,
-                                                   const HostAddr& addr,
-                                                   bool finished);
+                                  std::shared_ptr<raftex::cpp2::SendSnapshotRequest> req,
+                                  const HostAddr& addr);
 
     virtual void accessAllRowsInSnapshot(GraphSpaceID spaceId,
                                          PartitionID partId,
@@ -63,6 +95,19 @@ private:
     std::unique_ptr<folly::IOThreadPoolExecutor> executor_;
     std::unique_ptr<folly::IOThreadPoolExecutor> ioThreadPool_;
     thrift::ThriftClientManager<raftex::cpp2::RaftexServiceAsyncClient> connManager_;
+
+    // Outbound queue and per-destination running counters. sendLock_ is
+    // never held while a raft lock is taken, except through
+    // RaftPart::healthyReplicas in scheduleNext/scheduleStatus
+    std::mutex sendLock_;
+    std::list<SendTask> waiting_;
+    std::unordered_map<HostAddr, size_t> outStreams_;
+    size_t nextSeq_{0};
+
+    // Inbound per-source counters; recvLock_ is a leaf lock, safe to
+    // take under the raft locks the receive path holds
+    std::mutex recvLock_;
+    std::unordered_map<HostAddr, size_t> inStreams_;
 };
 
 }  // namespace raftex
@@ -0,0 +1,151 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include "common/fs/TempDir.h"
+#include "common/time/WallClock.h"
+#include "kvstore/raftex/RaftexService.h"
+#include "kvstore/raftex/test/RaftexTestBase.h"
+#include "kvstore/raftex/test/TestShard.h"
+#include <gtest/gtest.h>
+
+DEFINE_int32(replication_bm_copies, 3, "Number of in-process raft copies");
+DEFINE_int32(replication_bm_logs, 2000, "Logs to append in each scenario");
+DEFINE_int32(replication_bm_payload, 64, "Payload bytes of each log");
+DEFINE_int32(replication_bm_delay_ms, 20, "Injected send delay of the slow-network scenario");
+DEFINE_int32(replication_bm_drop_pct, 5, "Injected loss of the packet-loss scenario");
+
+DECLARE_int32(raft_test_append_delay_ms);
+DECLARE_int32(raft_test_append_drop_pct);
+
+namespace nebula {
+namespace raftex {
+
+// Not a correctness test: each scenario stands up
+// FLAGS_replication_bm_copies in-process parts, pushes
+// FLAGS_replication_bm_logs appends through the leader and reports
+// throughput plus the commit latency distribution, optionally with
+// delay/loss injected at the Host send layer. Run it before and after a
+// replication change to see what the change costs.
+class ReplicationScenario {
+public:
+    explicit ReplicationScenario(const std::string& name)
+        : name_(name)
+        , walRoot_(folly::stringPrintf("/tmp/%s.XXXXXX", name.c_str()).c_str()) {
+        setupRaft(FLAGS_replication_bm_copies, walRoot_, workers_, wals_,
+                  allHosts_, services_, copies_, leader_);
+        checkLeadership(copies_, leader_);
+    }
+
+    ~ReplicationScenario() {
+        finishRaft(services_, copies_, workers_, leader_);
+    }
+
+    void appendAndReport() {
+        std::mutex lock;
+        std::vector<int64_t> latenciesUs;
+        latenciesUs.reserve(FLAGS_replication_bm_logs);
+        std::vector<folly::Future<AppendLogResult>> futures;
+        futures.reserve(FLAGS_replication_bm_logs);
+        const std::string payload(FLAGS_replication_bm_payload, 'x');
+
+        auto benchStartUs = time::WallClock::fastNowInMicroSec();
+        for (int32_t i = 0; i < FLAGS_replication_bm_logs; i++) {
+            auto startUs = time::WallClock::fastNowInMicroSec();
+            auto fut = leader_->appendAsync(0, folly::stringPrintf("%08d_", i) + payload)
+                .thenValue([startUs, &lock, &latenciesUs](AppendLogResult res) {
+                    if (res == AppendLogResult::SUCCEEDED) {
+                        auto nowUs = time::WallClock::fastNowInMicroSec();
+                        std::lock_guard<std::mutex> g(lock);
+                        latenciesUs.emplace_back(nowUs - startUs);
+                    }
+                    return res;
+                });
+            futures.emplace_back(std::move(fut));
+        }
+        folly::collectAll(futures).wait();
+        auto totalUs = time::WallClock::fastNowInMicroSec() - benchStartUs;
+
+        std::lock_guard<std::mutex> g(lock);
+        ASSERT_FALSE(latenciesUs.empty());
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        auto pct = [&latenciesUs](double p) {
+            return latenciesUs[static_cast<size_t>(p * (latenciesUs.size() - 1))];
+        };
+        LOG(INFO) << "[" << name_ << "] committed " << latenciesUs.size()
+                  << "/" << FLAGS_replication_bm_logs << " logs in " << totalUs / 1000 << "ms"
+                  << ", throughput " << latenciesUs.size() * 1000000 / totalUs << " logs/s"
+                  << ", commit latency(us) p50 = " << pct(0.5)
+                  << ", p95 = " << pct(0.95)
+                  << ", p99 = " << pct(0.99)
+                  << ", max = " << latenciesUs.back();
+    }
+
+    // Kill the leader and report how long the group has no usable one
+    void reelectAndReport() {
+        auto downUs = time::WallClock::fastNowInMicroSec();
+        killOneCopy(services_, copies_, leader_, checkLeadership(copies_, leader_));
+        waitUntilLeaderElected(copies_, leader_);
+        auto downtimeUs = time::WallClock::fastNowInMicroSec() - downUs;
+        LOG(INFO) << "[" << name_ << "] election downtime "
+                  << downtimeUs / 1000 << "ms";
+    }
+
+private:
+    const std::string name_;
+    fs::TempDir walRoot_;
+    std::shared_ptr<thread::GenericThreadPool> workers_;
+    std::vector<std::string> wals_;
+    std::vector<HostAddr> allHosts_;
+    std::vector<std::shared_ptr<RaftexService>> services_;
+    std::vector<std::shared_ptr<test::TestShard>> copies_;
+    std::shared_ptr<test::TestShard> leader_;
+};
+
+
+TEST(ReplicationBenchmark, AppendBaseline) {
+    ReplicationScenario scenario("replication_bm_baseline");
+    scenario.appendAndReport();
+}
+
+
+TEST(ReplicationBenchmark, AppendWithSlowNetwork) {
+    FLAGS_raft_test_append_delay_ms = FLAGS_replication_bm_delay_ms;
+    {
+        ReplicationScenario scenario("replication_bm_slow_network");
+        scenario.appendAndReport();
+    }
+    FLAGS_raft_test_append_delay_ms = 0;
+}
+
+
+TEST(ReplicationBenchmark, AppendWithPacketLoss) {
+    FLAGS_raft_test_append_drop_pct = FLAGS_replication_bm_drop_pct;
+    {
+        ReplicationScenario scenario("replication_bm_packet_loss");
+        scenario.appendAndReport();
+    }
+    FLAGS_raft_test_append_drop_pct = 0;
+}
+
+
+TEST(ReplicationBenchmark, ElectionDowntime) {
+    ReplicationScenario scenario("replication_bm_election");
+    scenario.appendAndReport();
+    scenario.reelectAndReport();
+}
+
+}  // namespace raftex
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -174,7 +174,7 @@ public:
                           << ", total count sended " << totalCount
                           << ", total size sended " << totalSize
                           << ", finished false";
-                cb(data, totalCount, totalSize, SnapshotStatus::IN_PROGRESS);
+                cb(std::move(data), totalCount, totalSize, SnapshotStatus::IN_PROGRESS);
                 data.clear();
             }
             auto encoded = encodeSnapshotRow(row.first, row.second);
@@ -186,7 +186,7 @@ public:
                   << ", total count sended " << totalCount
                   << ", total size sended " << totalSize
                   << ", finished true";
-        cb(data, totalCount, totalSize, SnapshotStatus::DONE);
+        cb(std::move(data), totalCount, totalSize, SnapshotStatus::DONE);
     }
 
     RaftexService* service_;
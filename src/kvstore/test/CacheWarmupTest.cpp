@@ -0,0 +1,139 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "kvstore/CacheWarmup.h"
+
+DECLARE_int32(block_cache_warmup_top_n);
+
+namespace nebula {
+namespace kvstore {
+
+TEST(CacheWarmupTest, RoundTrip) {
+    CacheWarmup warmup;
+    for (int32_t i = 0; i < 3; i++) {
+        warmup.record(CacheWarmup::AccessKind::GET, "hot_key");
+    }
+    for (int32_t i = 0; i < 2; i++) {
+        warmup.record(CacheWarmup::AccessKind::PREFIX, "hot_prefix");
+    }
+    warmup.record(CacheWarmup::AccessKind::GET, "cold_key");
+
+    std::vector<CacheWarmup::Entry> entries;
+    ASSERT_TRUE(CacheWarmup::decode(warmup.encode(), entries));
+    ASSERT_EQ(3, entries.size());
+    // hottest first
+    EXPECT_EQ(CacheWarmup::AccessKind::GET, entries[0].kind);
+    EXPECT_EQ(3, entries[0].hits);
+    EXPECT_EQ("hot_key", entries[0].key);
+    EXPECT_EQ(CacheWarmup::AccessKind::PREFIX, entries[1].kind);
+    EXPECT_EQ(2, entries[1].hits);
+    EXPECT_EQ("hot_prefix", entries[1].key);
+    EXPECT_EQ(CacheWarmup::AccessKind::GET, entries[2].kind);
+    EXPECT_EQ(1, entries[2].hits);
+    EXPECT_EQ("cold_key", entries[2].key);
+}
+
+TEST(CacheWarmupTest, SameKeyDifferentKinds) {
+    CacheWarmup warmup;
+    warmup.record(CacheWarmup::AccessKind::GET, "key");
+    warmup.record(CacheWarmup::AccessKind::PREFIX, "key");
+
+    std::vector<CacheWarmup::Entry> entries;
+    ASSERT_TRUE(CacheWarmup::decode(warmup.encode(), entries));
+    // a get and a prefix scan of the same key are distinct entries
+    ASSERT_EQ(2, entries.size());
+    EXPECT_NE(entries[0].kind, entries[1].kind);
+    EXPECT_EQ("key", entries[0].key);
+    EXPECT_EQ("key", entries[1].key);
+}
+
+TEST(CacheWarmupTest, TopNTruncation) {
+    auto oldTopN = FLAGS_block_cache_warmup_top_n;
+    FLAGS_block_cache_warmup_top_n = 10;
+    SCOPE_EXIT {
+        FLAGS_block_cache_warmup_top_n = oldTopN;
+    };
+    CacheWarmup warmup;
+    for (int32_t i = 0; i < 20; i++) {
+        // key_0 is the hottest, key_19 the coldest
+        for (int32_t hits = 0; hits < 21 - i; hits++) {
+            warmup.record(CacheWarmup::AccessKind::GET,
+                          folly::stringPrintf("key_%d", i));
+        }
+    }
+    std::vector<CacheWarmup::Entry> entries;
+    ASSERT_TRUE(CacheWarmup::decode(warmup.encode(), entries));
+    ASSERT_EQ(10, entries.size());
+    for (int32_t i = 0; i < 10; i++) {
+        EXPECT_EQ(folly::stringPrintf("key_%d", i), entries[i].key);
+        EXPECT_EQ(21 - i, entries[i].hits);
+    }
+}
+
+TEST(CacheWarmupTest, LossyBoundKeepsHotEntries) {
+    auto oldTopN = FLAGS_block_cache_warmup_top_n;
+    FLAGS_block_cache_warmup_top_n = 16;
+    SCOPE_EXIT {
+        FLAGS_block_cache_warmup_top_n = oldTopN;
+    };
+    CacheWarmup warmup;
+    for (int32_t i = 0; i < 8; i++) {
+        warmup.record(CacheWarmup::AccessKind::GET,
+                      folly::stringPrintf("hot_%d", i));
+        warmup.record(CacheWarmup::AccessKind::GET,
+                      folly::stringPrintf("hot_%d", i));
+    }
+    // a churny one-off scan far beyond the table bound
+    for (int32_t i = 0; i < 1000; i++) {
+        warmup.record(CacheWarmup::AccessKind::GET,
+                      folly::stringPrintf("scan_%d", i));
+    }
+    std::vector<CacheWarmup::Entry> entries;
+    ASSERT_TRUE(CacheWarmup::decode(warmup.encode(), entries));
+    // the steady working set survived the scan
+    for (int32_t i = 0; i < 8; i++) {
+        EXPECT_EQ(folly::stringPrintf("hot_%d", i), entries[i].key);
+        EXPECT_EQ(2, entries[i].hits);
+    }
+}
+
+TEST(CacheWarmupTest, EmptyProfile) {
+    CacheWarmup warmup;
+    EXPECT_EQ("", warmup.encode());
+}
+
+TEST(CacheWarmupTest, CorruptImage) {
+    CacheWarmup warmup;
+    warmup.record(CacheWarmup::AccessKind::GET, "key");
+    auto image = warmup.encode();
+
+    std::vector<CacheWarmup::Entry> entries;
+    // truncated image
+    EXPECT_FALSE(CacheWarmup::decode(
+        folly::StringPiece(image.data(), image.size() - 1), entries));
+    // bogus access kind
+    auto bogus = image;
+    bogus[sizeof(int32_t) + sizeof(uint64_t) + sizeof(int32_t)] = 0x7F;
+    EXPECT_FALSE(CacheWarmup::decode(bogus, entries));
+    // the intact image still decodes
+    EXPECT_TRUE(CacheWarmup::decode(image, entries));
+    ASSERT_EQ(1, entries.size());
+    EXPECT_EQ("key", entries[0].key);
+}
+
+}  // namespace kvstore
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,171 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <folly/init/Init.h>
+#include "common/fs/TempDir.h"
+#include "common/fs/FileUtils.h"
+#include "kvstore/CheckpointBackup.h"
+#include <fstream>
+
+namespace nebula {
+namespace kvstore {
+
+namespace {
+
+void writeFile(const std::string& path, const std::string& contents) {
+    auto dir = path.substr(0, path.find_last_of('/'));
+    ASSERT_TRUE(fs::FileUtils::makeDir(dir));
+    std::ofstream out(path, std::ios::out | std::ios::trunc | std::ios::binary);
+    ASSERT_TRUE(out.is_open());
+    out << contents;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    CHECK(in.is_open()) << path;
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// A checkpoint directory the way RocksEngine and Part leave it behind:
+// data/ with the sst files, wal/<part>/ with the linked wal segments
+void makeCheckpoint(const std::string& dir,
+                    const std::vector<std::pair<std::string, std::string>>& files) {
+    for (auto& f : files) {
+        writeFile(fs::FileUtils::joinPath(dir, f.first), f.second);
+    }
+}
+
+}  // anonymous namespace
+
+
+TEST(CheckpointBackupTest, BackupAndRestore) {
+    fs::TempDir root("/tmp/checkpoint_backup_test.XXXXXX");
+    auto cpDir = fs::FileUtils::joinPath(root.path(), "checkpoint1");
+    std::vector<std::pair<std::string, std::string>> files = {
+        {"data/000001.sst", std::string(1024, 'a')},
+        {"data/MANIFEST-000001", "manifest"},
+        {"wal/1/0000000000000000001.wal", std::string(128, 'w')},
+        {"wal/2/0000000000000000001.wal", std::string(64, 'x')},
+    };
+    makeCheckpoint(cpDir, files);
+
+    auto sinkDir = fs::FileUtils::joinPath(root.path(), "sink");
+    LocalDirSink sink(sinkDir);
+    CheckpointBackup bm(&sink, 4);
+    ASSERT_TRUE(bm.backup(cpDir, "backup1", false).ok());
+    ASSERT_TRUE(sink.exists("backup1/BACKUP_MANIFEST"));
+
+    // A second backup under the same name must be refused
+    ASSERT_FALSE(bm.backup(cpDir, "backup1", false).ok());
+
+    auto restoreDir = fs::FileUtils::joinPath(root.path(), "restored");
+    ASSERT_TRUE(bm.restore("backup1", restoreDir).ok());
+    for (auto& f : files) {
+        EXPECT_EQ(f.second, readFile(fs::FileUtils::joinPath(restoreDir, f.first)));
+    }
+}
+
+
+TEST(CheckpointBackupTest, IncrementalChain) {
+    fs::TempDir root("/tmp/checkpoint_backup_test.XXXXXX");
+    auto cp1 = fs::FileUtils::joinPath(root.path(), "checkpoint1");
+    makeCheckpoint(cp1, {
+        {"data/000001.sst", std::string(512, 'a')},
+        {"wal/1/0000000000000000001.wal", "wal-v1"},
+    });
+    // The second checkpoint hard-links 000001.sst and adds 000002.sst;
+    // its MANIFEST_DELTA names only the new file
+    auto cp2 = fs::FileUtils::joinPath(root.path(), "checkpoint2");
+    makeCheckpoint(cp2, {
+        {"data/000001.sst", std::string(512, 'a')},
+        {"data/000002.sst", std::string(256, 'b')},
+        {"wal/1/0000000000000000001.wal", "wal-v2"},
+    });
+    writeFile(fs::FileUtils::joinPath(cp2, "MANIFEST_DELTA"),
+              "base:backup1\ndata/000002.sst\n");
+
+    auto sinkDir = fs::FileUtils::joinPath(root.path(), "sink");
+    LocalDirSink sink(sinkDir);
+    CheckpointBackup bm(&sink, 2);
+
+    // Incremental without its base in the sink must be refused
+    ASSERT_FALSE(bm.backup(cp2, "backup2", true).ok());
+
+    ASSERT_TRUE(bm.backup(cp1, "backup1", false).ok());
+    ASSERT_TRUE(bm.backup(cp2, "backup2", true).ok());
+    // The shared sst was not shipped twice
+    ASSERT_FALSE(sink.exists("backup2/data/000001.sst"));
+
+    auto restoreDir = fs::FileUtils::joinPath(root.path(), "restored");
+    ASSERT_TRUE(bm.restore("backup2", restoreDir).ok());
+    EXPECT_EQ(std::string(512, 'a'),
+              readFile(fs::FileUtils::joinPath(restoreDir, "data/000001.sst")));
+    EXPECT_EQ(std::string(256, 'b'),
+              readFile(fs::FileUtils::joinPath(restoreDir, "data/000002.sst")));
+    // The newer wal overlays the base's copy
+    EXPECT_EQ("wal-v2",
+              readFile(fs::FileUtils::joinPath(restoreDir, "wal/1/0000000000000000001.wal")));
+}
+
+
+TEST(CheckpointBackupTest, CorruptedBackupIsRejected) {
+    fs::TempDir root("/tmp/checkpoint_backup_test.XXXXXX");
+    auto cpDir = fs::FileUtils::joinPath(root.path(), "checkpoint1");
+    makeCheckpoint(cpDir, {
+        {"data/000001.sst", std::string(1024, 'a')},
+        {"wal/1/0000000000000000001.wal", "wal"},
+    });
+
+    auto sinkDir = fs::FileUtils::joinPath(root.path(), "sink");
+    LocalDirSink sink(sinkDir);
+    CheckpointBackup bm(&sink, 2);
+    ASSERT_TRUE(bm.backup(cpDir, "backup1", false).ok());
+
+    // Flip bits in a shipped file; restore must notice via the checksums
+    writeFile(fs::FileUtils::joinPath(sinkDir, "backup1/data/000001.sst"),
+              std::string(1024, 'z'));
+    auto restoreDir = fs::FileUtils::joinPath(root.path(), "restored");
+    auto status = bm.restore("backup1", restoreDir);
+    ASSERT_FALSE(status.ok());
+    ASSERT_NE(status.toString().find("Checksum mismatch"), std::string::npos);
+}
+
+
+TEST(CheckpointBackupTest, BandwidthLimitedSink) {
+    fs::TempDir root("/tmp/checkpoint_backup_test.XXXXXX");
+    auto cpDir = fs::FileUtils::joinPath(root.path(), "checkpoint1");
+    makeCheckpoint(cpDir, {
+        {"data/000001.sst", std::string(192 * 1024, 'a')},
+    });
+
+    auto sinkDir = fs::FileUtils::joinPath(root.path(), "sink");
+    // 192KB at 128KB/s: the bucket hands out one second's burst for
+    // free, the remaining 64KB must wait about half a second. Just
+    // assert the copy is measurably slower than an unlimited one
+    LocalDirSink sink(sinkDir, 128 * 1024);
+    CheckpointBackup bm(&sink, 1);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(bm.backup(cpDir, "backup1", false).ok());
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    EXPECT_GE(ms, 200);
+}
+
+}  // namespace kvstore
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,74 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "kvstore/EngineHealth.h"
+
+namespace nebula {
+namespace kvstore {
+
+TEST(EngineHealthTest, CleanProbesStayHealthy) {
+    FLAGS_engine_degraded_latency_us = 1000;
+    HealthTracker tracker;
+    EXPECT_EQ(EngineHealth::HEALTHY, tracker.health());
+    for (int i = 0; i < 10; i++) {
+        tracker.onProbe(true, 100);
+    }
+    EXPECT_EQ(EngineHealth::HEALTHY, tracker.health());
+    FLAGS_engine_degraded_latency_us = 0;
+}
+
+TEST(EngineHealthTest, SlowProbesDegradeAndRecover) {
+    FLAGS_engine_degraded_latency_us = 1000;
+    HealthTracker tracker;
+    // one probe far over the target pushes the moving average past it
+    tracker.onProbe(true, 100 * 1000);
+    EXPECT_EQ(EngineHealth::DEGRADED, tracker.health());
+    // the average has to decay below the target first, then three
+    // consecutive clean probes promote the engine back
+    for (int i = 0; i < 30; i++) {
+        tracker.onProbe(true, 0);
+    }
+    EXPECT_EQ(EngineHealth::HEALTHY, tracker.health());
+    FLAGS_engine_degraded_latency_us = 0;
+}
+
+TEST(EngineHealthTest, FailedClimbsBackThroughDegraded) {
+    FLAGS_engine_degraded_latency_us = 1000;
+    HealthTracker tracker;
+    tracker.onProbe(false, 0);
+    EXPECT_EQ(EngineHealth::FAILED, tracker.health());
+    // three clean probes lift it one level, not straight to healthy
+    for (int i = 0; i < 3; i++) {
+        tracker.onProbe(true, 0);
+    }
+    EXPECT_EQ(EngineHealth::DEGRADED, tracker.health());
+    for (int i = 0; i < 3; i++) {
+        tracker.onProbe(true, 0);
+    }
+    EXPECT_EQ(EngineHealth::HEALTHY, tracker.health());
+    FLAGS_engine_degraded_latency_us = 0;
+}
+
+TEST(EngineHealthTest, BackgroundErrorFailsTheEngine) {
+    HealthTracker tracker;
+    tracker.onBackgroundError();
+    EXPECT_EQ(EngineHealth::FAILED, tracker.health());
+    tracker.onErrorRecovered();
+    EXPECT_EQ(EngineHealth::DEGRADED, tracker.health());
+}
+
+}  // namespace kvstore
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,98 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "kvstore/ExistenceFilter.h"
+
+namespace nebula {
+namespace kvstore {
+
+TEST(ExistenceFilterTest, InsertRemove) {
+    ExistenceFilter filter(1 << 20);
+    for (int32_t i = 0; i < 1000; i++) {
+        filter.insert(folly::stringPrintf("key_%d", i));
+    }
+    // no false negatives, ever
+    for (int32_t i = 0; i < 1000; i++) {
+        EXPECT_TRUE(filter.maybeExists(folly::stringPrintf("key_%d", i)));
+    }
+    for (int32_t i = 0; i < 1000; i++) {
+        filter.remove(folly::stringPrintf("key_%d", i));
+    }
+    // removed keys read as absent again while the counters are exact
+    int32_t hits = 0;
+    for (int32_t i = 0; i < 1000; i++) {
+        if (filter.maybeExists(folly::stringPrintf("key_%d", i))) {
+            hits++;
+        }
+    }
+    EXPECT_EQ(0, hits);
+}
+
+TEST(ExistenceFilterTest, FalsePositiveRate) {
+    ExistenceFilter filter(1 << 20);
+    for (int32_t i = 0; i < 10000; i++) {
+        filter.insert(folly::stringPrintf("present_%d", i));
+    }
+    int32_t falsePositives = 0;
+    for (int32_t i = 0; i < 10000; i++) {
+        if (filter.maybeExists(folly::stringPrintf("absent_%d", i))) {
+            falsePositives++;
+        }
+    }
+    // 10k keys in 1M counters with 4 hashes: the expected rate is far
+    // below 1%, leave plenty of slack
+    EXPECT_LT(falsePositives, 100);
+}
+
+TEST(ExistenceFilterTest, Saturation) {
+    ExistenceFilter filter(8);
+    // with 8 counters every slot saturates quickly
+    for (int32_t i = 0; i < 10000; i++) {
+        filter.insert(folly::stringPrintf("key_%d", i));
+    }
+    for (int32_t i = 0; i < 10000; i++) {
+        filter.remove(folly::stringPrintf("key_%d", i));
+    }
+    // saturated counters never decrement, so everything still reads as
+    // maybe-present — false positives only, no false negatives
+    for (int32_t i = 0; i < 100; i++) {
+        EXPECT_TRUE(filter.maybeExists(folly::stringPrintf("key_%d", i)));
+    }
+}
+
+TEST(ExistenceFilterTest, EncodeDecode) {
+    const size_t numCounters = 1 << 16;
+    ExistenceFilter filter(numCounters);
+    for (int32_t i = 0; i < 1000; i++) {
+        filter.insert(folly::stringPrintf("key_%d", i));
+    }
+    auto image = filter.encode(42);
+
+    auto restored = ExistenceFilter::decode(image, numCounters, 42);
+    ASSERT_NE(nullptr, restored);
+    for (int32_t i = 0; i < 1000; i++) {
+        EXPECT_TRUE(restored->maybeExists(folly::stringPrintf("key_%d", i)));
+    }
+
+    // a stale image must not be restored
+    EXPECT_EQ(nullptr, ExistenceFilter::decode(image, numCounters, 43));
+    // nor one cut for a different filter size
+    EXPECT_EQ(nullptr, ExistenceFilter::decode(image, numCounters * 2, 42));
+}
+
+}  // namespace kvstore
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include "kvstore/LogEncoder.h"
+
+using nebula::kvstore::KV;
+using nebula::kvstore::LogType;
+
+// roughly the shape of a GetNeighbors-era write: a 33 byte key (part,
+// vid, type, rank, dst, version) and a property row of some dozens of
+// bytes
+std::vector<KV> makeBatch(size_t num) {
+    std::vector<KV> kvs;
+    kvs.reserve(num);
+    for (size_t i = 0; i < num; i++) {
+        kvs.emplace_back(folly::stringPrintf("%033zu", i), std::string(64, 'v'));
+    }
+    return kvs;
+}
+
+const std::vector<KV> kBatch1 = makeBatch(1);       // NOLINT
+const std::vector<KV> kBatch16 = makeBatch(16);     // NOLINT
+const std::vector<KV> kBatch128 = makeBatch(128);   // NOLINT
+
+BENCHMARK(EncodeSingleValue, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto log = nebula::kvstore::encodeSingleValue(LogType::OP_PUT,
+                                                      kBatch1.front().first);
+        folly::doNotOptimizeAway(log);
+    }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EncodeMultiValues1, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto log = nebula::kvstore::encodeMultiValues(LogType::OP_MULTI_PUT, kBatch1);
+        folly::doNotOptimizeAway(log);
+    }
+}
+
+BENCHMARK(EncodeMultiValues16, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto log = nebula::kvstore::encodeMultiValues(LogType::OP_MULTI_PUT, kBatch16);
+        folly::doNotOptimizeAway(log);
+    }
+}
+
+BENCHMARK(EncodeMultiValues128, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto log = nebula::kvstore::encodeMultiValues(LogType::OP_MULTI_PUT, kBatch128);
+        folly::doNotOptimizeAway(log);
+    }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(DecodeMultiValues128, iters) {
+    std::string log;
+    BENCHMARK_SUSPEND {
+        log = nebula::kvstore::encodeMultiValues(LogType::OP_MULTI_PUT, kBatch128);
+    }
+    for (size_t i = 0; i < iters; i++) {
+        auto values = nebula::kvstore::decodeMultiValues(log);
+        folly::doNotOptimizeAway(values);
+    }
+}
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+    folly::runBenchmarks();
+    return 0;
+}
@@ -39,7 +39,8 @@ TEST(LogEncoderTest, MultiValuesTest) {
     {
         std::vector<std::string> values;
         auto encoded = encodeMultiValues(OP_MULTI_REMOVE, values);
-        ASSERT_EQ(1 + sizeof(uint32_t) + sizeof(int64_t), encoded.size());
+        // Timestamp, flagged type byte and a one-byte varint count
+        ASSERT_EQ(1 + 1 + sizeof(int64_t), encoded.size());
 
         auto decoded = decodeMultiValues(encoded);
         ASSERT_TRUE(decoded.empty());
@@ -114,6 +115,41 @@ TEST(LogEncoderTest, MultiValuesTest) {
     }
 }
 
+TEST(LogEncoderTest, MultiByteVarintTest) {
+    // A value long enough that its varint length takes two bytes
+    std::vector<std::string> values;
+    values.emplace_back(std::string(1000, 'x'));
+    values.emplace_back("short");
+    auto encoded = encodeMultiValues(OP_MULTI_REMOVE, values);
+    auto decoded = decodeMultiValues(encoded);
+    ASSERT_EQ(2, decoded.size());
+    ASSERT_EQ(values[0], decoded[0].toString());
+    ASSERT_EQ(values[1], decoded[1].toString());
+}
+
+TEST(LogEncoderTest, LegacyFormatTest) {
+    // A log written before the varint format: fixed 4-byte lengths and
+    // no format flag on the type byte
+    std::string encoded;
+    int64_t ts = 0;
+    char type = OP_MULTI_PUT;
+    encoded.append(reinterpret_cast<char*>(&ts), sizeof(int64_t));
+    encoded.append(&type, 1);
+    uint32_t num = 2;
+    encoded.append(reinterpret_cast<char*>(&num), sizeof(uint32_t));
+    for (auto* v : {"legacy_key", "legacy_value"}) {
+        uint32_t len = ::strlen(v);
+        encoded.append(reinterpret_cast<char*>(&len), sizeof(uint32_t));
+        encoded.append(v, len);
+    }
+
+    ASSERT_EQ(OP_MULTI_PUT, logType(encoded));
+    auto decoded = decodeMultiValues(encoded);
+    ASSERT_EQ(2, decoded.size());
+    ASSERT_EQ("legacy_key", decoded[0].toString());
+    ASSERT_EQ("legacy_value", decoded[1].toString());
+}
+
 TEST(LogEncoderTest, KVTest) {
     auto encoded = encodeKV("KV_key", "KV_val");
     auto decoded = decodeKV(encoded);
@@ -150,6 +186,27 @@ TEST(LogEncoderTest, BatchTest) {
     ASSERT_EQ(expectd, decoded);
 }
 
+TEST(LogEncoderTest, DedupBatchTest) {
+    auto helper = std::make_unique<BatchHolder>();
+    helper->put("put_key", "put_value");
+    helper->remove("remove");
+
+    uint64_t dedupId = 0x1234abcd5678ef90UL;
+    auto encoded = encodeDedupBatch(dedupId, helper->getBatch());
+    ASSERT_EQ(LogType::OP_DEDUP_BATCH, logType(encoded));
+
+    auto decoded = decodeDedupBatch(encoded);
+    ASSERT_EQ(dedupId, decoded.first);
+
+    std::vector<std::pair<BatchLogType,
+                std::pair<folly::StringPiece, folly::StringPiece>>> expectd;
+    expectd.emplace_back(OP_BATCH_PUT,
+            std::pair<folly::StringPiece, folly::StringPiece>("put_key", "put_value"));
+    expectd.emplace_back(OP_BATCH_REMOVE,
+            std::pair<folly::StringPiece, folly::StringPiece>("remove", ""));
+    ASSERT_EQ(expectd, decoded.second);
+}
+
 }  // namespace kvstore
 }  // namespace nebula
 
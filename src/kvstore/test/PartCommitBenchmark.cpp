@@ -0,0 +1,282 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include "common/fs/TempDir.h"
+#include "common/thread/GenericThreadPool.h"
+#include <thrift/lib/cpp/concurrency/ThreadManager.h>
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include "kvstore/Part.h"
+#include "kvstore/LogEncoder.h"
+#include "kvstore/RocksEngine.h"
+
+DEFINE_int64(part_commit_bm_batch_size, 16,
+             "Key-value pairs carried by each log entry");
+DEFINE_int64(part_commit_bm_window, 4,
+             "Log entries handed to one commitLogs call");
+DEFINE_int32(part_commit_bm_remove_pct, 10,
+             "Percentage of removes in the mixed-op window");
+
+namespace nebula {
+namespace kvstore {
+
+// Replays a pre-encoded window of logs, standing in for the wal
+// iterator raft hands to commitLogs
+class BenchLogIterator final : public LogIterator {
+public:
+    explicit BenchLogIterator(const std::vector<std::string>& logs)
+        : logs_(logs) {}
+
+    LogIterator& operator++() override {
+        ++idx_;
+        return *this;
+    }
+
+    bool valid() const override {
+        return idx_ < logs_.size();
+    }
+
+    LogID logId() const override {
+        return idx_ + 1;
+    }
+
+    TermID logTerm() const override {
+        return 1;
+    }
+
+    ClusterID logSource() const override {
+        return 0;
+    }
+
+    folly::StringPiece logMsg() const override {
+        return logs_[idx_];
+    }
+
+private:
+    const std::vector<std::string>& logs_;
+    size_t idx_{0};
+};
+
+// Owns a Part wired straight onto a RocksEngine — no raft service and
+// no peers — so commitLogs runs exactly the code a replica runs, minus
+// the wal and the network
+class PartCommitBench {
+public:
+    PartCommitBench()
+            : dataPath_("/tmp/part_commit_bm_data.XXXXXX")
+            , walPath_("/tmp/part_commit_bm_wal.XXXXXX") {
+        engine_ = std::make_unique<RocksEngine>(1, dataPath_.path());
+        ioPool_ = std::make_shared<folly::IOThreadPoolExecutor>(1);
+        workers_ = std::make_shared<thread::GenericThreadPool>();
+        workers_->start(1, "part-commit-bm");
+        auto handlers
+            = apache::thrift::concurrency::PriorityThreadManager::newPriorityThreadManager(
+                    1, true /*stats*/);
+        handlers->setNamePrefix("executor");
+        handlers->start();
+        handlers_ = handlers;
+        part_ = std::make_shared<Part>(1,  // spaceId
+                                       1,  // partId
+                                       HostAddr("127.0.0.1", 0),
+                                       walPath_.path(),
+                                       engine_.get(),
+                                       ioPool_,
+                                       workers_,
+                                       handlers_,
+                                       nullptr,    // no snapshot manager
+                                       nullptr);   // no raft clients
+    }
+
+    ~PartCommitBench() {
+        // ~RaftPart insists on a stopped part
+        part_->stop();
+        part_.reset();
+        workers_->stop();
+        workers_->wait();
+    }
+
+    bool commit(const std::vector<std::string>& logs) {
+        return part_->commitLogs(std::make_unique<BenchLogIterator>(logs));
+    }
+
+private:
+    fs::TempDir dataPath_;
+    fs::TempDir walPath_;
+    std::unique_ptr<RocksEngine> engine_;
+    std::shared_ptr<folly::IOThreadPoolExecutor> ioPool_;
+    std::shared_ptr<thread::GenericThreadPool> workers_;
+    std::shared_ptr<folly::Executor> handlers_;
+    std::shared_ptr<Part> part_;
+};
+
+// The same kv shape LogEncoderBenchmark uses: a 33 byte key and a
+// property row of some dozens of bytes, salted per log so a window is
+// not a pure overwrite
+std::vector<KV> makeKvs(size_t log) {
+    std::vector<KV> kvs;
+    kvs.reserve(FLAGS_part_commit_bm_batch_size);
+    for (int64_t i = 0; i < FLAGS_part_commit_bm_batch_size; i++) {
+        kvs.emplace_back(folly::stringPrintf("%016zu%017zu", log, static_cast<size_t>(i)),
+                         std::string(64, 'v'));
+    }
+    return kvs;
+}
+
+std::vector<std::string> makeMultiPutWindow() {
+    std::vector<std::string> logs;
+    logs.reserve(FLAGS_part_commit_bm_window);
+    for (int64_t log = 0; log < FLAGS_part_commit_bm_window; log++) {
+        logs.emplace_back(encodeMultiValues(LogType::OP_MULTI_PUT, makeKvs(log)));
+    }
+    return logs;
+}
+
+std::vector<std::string> makeSinglePutWindow() {
+    std::vector<std::string> logs;
+    logs.reserve(FLAGS_part_commit_bm_window);
+    for (int64_t log = 0; log < FLAGS_part_commit_bm_window; log++) {
+        auto kvs = makeKvs(log);
+        logs.emplace_back(encodeMultiValues(LogType::OP_PUT,
+                                            kvs.front().first,
+                                            kvs.front().second));
+    }
+    return logs;
+}
+
+std::vector<std::string> makeBatchWriteWindow(int32_t removePct) {
+    std::vector<std::string> logs;
+    logs.reserve(FLAGS_part_commit_bm_window);
+    for (int64_t log = 0; log < FLAGS_part_commit_bm_window; log++) {
+        BatchHolder holder;
+        auto kvs = makeKvs(log);
+        for (size_t i = 0; i < kvs.size(); i++) {
+            if (static_cast<int32_t>(i * 100 / kvs.size()) < removePct) {
+                holder.remove(std::move(kvs[i].first));
+            } else {
+                holder.put(std::move(kvs[i].first), std::move(kvs[i].second));
+            }
+        }
+        logs.emplace_back(encodeBatchValue(holder.getBatch()));
+    }
+    return logs;
+}
+
+void runCommitLogs(const std::vector<std::string>& logs, size_t iters) {
+    std::unique_ptr<PartCommitBench> bench;
+    BENCHMARK_SUSPEND {
+        bench = std::make_unique<PartCommitBench>();
+    }
+    for (size_t i = 0; i < iters; i++) {
+        CHECK(bench->commit(logs));
+    }
+    BENCHMARK_SUSPEND {
+        bench.reset();
+    }
+}
+
+// The decode stage alone: what commitLogs spends before it touches the
+// engine
+BENCHMARK(DecodeStageMultiPut, iters) {
+    std::vector<std::string> logs;
+    BENCHMARK_SUSPEND {
+        logs = makeMultiPutWindow();
+    }
+    for (size_t i = 0; i < iters; i++) {
+        for (auto& log : logs) {
+            auto kvs = decodeMultiValues(log);
+            folly::doNotOptimizeAway(kvs);
+        }
+    }
+}
+
+// The engine stage alone: batch construction and group commit from
+// already-decoded pieces
+BENCHMARK(EngineStageMultiPut, iters) {
+    std::unique_ptr<fs::TempDir> dataPath;
+    std::unique_ptr<RocksEngine> engine;
+    std::vector<std::string> logs;
+    std::vector<std::vector<folly::StringPiece>> decoded;
+    BENCHMARK_SUSPEND {
+        dataPath = std::make_unique<fs::TempDir>("/tmp/part_commit_bm_engine.XXXXXX");
+        engine = std::make_unique<RocksEngine>(1, dataPath->path());
+        logs = makeMultiPutWindow();
+        for (auto& log : logs) {
+            decoded.emplace_back(decodeMultiValues(log));
+        }
+    }
+    for (size_t i = 0; i < iters; i++) {
+        auto batch = engine->startBatchWrite();
+        for (auto& kvs : decoded) {
+            for (size_t j = 0; j < kvs.size(); j += 2) {
+                CHECK(batch->put(kvs[j], kvs[j + 1]) == ResultCode::SUCCEEDED);
+            }
+        }
+        CHECK(engine->commitBatchWrite(std::move(batch)) == ResultCode::SUCCEEDED);
+    }
+    BENCHMARK_SUSPEND {
+        engine.reset();
+        dataPath.reset();
+    }
+}
+
+BENCHMARK_DRAW_LINE();
+
+// The full glue: decode, dispatch, batch construction, commit message
+// and group commit, through Part::commitLogs
+BENCHMARK(CommitLogsSinglePut, iters) {
+    std::vector<std::string> logs;
+    BENCHMARK_SUSPEND {
+        logs = makeSinglePutWindow();
+    }
+    runCommitLogs(logs, iters);
+}
+
+BENCHMARK(CommitLogsMultiPut, iters) {
+    std::vector<std::string> logs;
+    BENCHMARK_SUSPEND {
+        logs = makeMultiPutWindow();
+    }
+    runCommitLogs(logs, iters);
+}
+
+BENCHMARK(CommitLogsBatchWrite, iters) {
+    std::vector<std::string> logs;
+    BENCHMARK_SUSPEND {
+        logs = makeBatchWriteWindow(0);
+    }
+    runCommitLogs(logs, iters);
+}
+
+BENCHMARK(CommitLogsMixed, iters) {
+    std::vector<std::string> logs;
+    BENCHMARK_SUSPEND {
+        logs = makeBatchWriteWindow(FLAGS_part_commit_bm_remove_pct);
+    }
+    runCommitLogs(logs, iters);
+}
+
+}  // namespace kvstore
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+    folly::runBenchmarks();
+    return 0;
+}
+
+/**
+ * One iteration of a CommitLogs* benchmark commits one window:
+ * --part_commit_bm_window log entries of --part_commit_bm_batch_size
+ * key-value pairs each (CommitLogsSinglePut carries one pair per log),
+ * so ops/s = iters/s * window * batch_size.
+ *
+ * CommitLogsMultiPut minus DecodeStageMultiPut minus EngineStageMultiPut
+ * approximates the dispatch overhead of commitLogs itself; changes to
+ * the log format or the write batch path should move exactly one of the
+ * three.
+ */
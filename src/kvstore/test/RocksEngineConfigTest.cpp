@@ -88,6 +88,29 @@ TEST(RocksEngineConfigTest, createOptionsTest) {
     FLAGS_rocksdb_db_options = "{}";
 }
 
+TEST(RocksEngineConfigTest, SpaceProfileTest) {
+    FLAGS_rocksdb_column_family_options = R"({"max_write_buffer_number":"4"})";
+    FLAGS_rocksdb_option_profiles = R"({"write_heavy":{"max_write_buffer_number":"8"}})";
+    FLAGS_rocksdb_space_profiles = "1:write_heavy";
+
+    // The assigned space gets the profile override
+    rocksdb::Options options;
+    rocksdb::Status s = initRocksdbOptions(options, 1);
+    ASSERT_TRUE(s.ok()) << s.ToString();
+    EXPECT_EQ(8, options.max_write_buffer_number);
+
+    // An unlisted space keeps the default CF options
+    rocksdb::Options defOptions;
+    s = initRocksdbOptions(defOptions, 2);
+    ASSERT_TRUE(s.ok()) << s.ToString();
+    EXPECT_EQ(4, defOptions.max_write_buffer_number);
+
+    // Clean up
+    FLAGS_rocksdb_column_family_options = "{}";
+    FLAGS_rocksdb_option_profiles = "{}";
+    FLAGS_rocksdb_space_profiles = "";
+}
+
 }  // namespace kvstore
 }  // namespace nebula
 
@@ -6,10 +6,13 @@
 
 #include "common/base/Base.h"
 #include "common/fs/TempDir.h"
+#include "common/fs/FileUtils.h"
 #include <gtest/gtest.h>
 #include <rocksdb/db.h>
 #include <folly/lang/Bits.h>
 #include "kvstore/RocksEngine.h"
+#include "kvstore/RocksEngineConfig.h"
+#include "utils/NebulaKeyUtils.h"
 
 namespace nebula {
 namespace kvstore {
@@ -113,6 +116,58 @@ TEST(RocksEngineTest, PrefixTest) {
 }
 
 
+TEST(RocksEngineTest, GetLatestTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_GetLatestTest.XXXXXX");
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    std::vector<KV> data;
+    for (int32_t i = 0; i < 10; i++) {
+        data.emplace_back(folly::stringPrintf("a_%d", i),
+                          folly::stringPrintf("val_%d", i));
+    }
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->multiPut(std::move(data)));
+
+    // the first key under the prefix in sorted order
+    std::string val;
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->getLatest("a_", &val));
+    EXPECT_EQ("val_0", val);
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->getLatest("a_5", &val));
+    EXPECT_EQ("val_5", val);
+    EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND, engine->getLatest("b_", &val));
+
+    // pinned to a snapshot, it reads the version at beginSnapshot()
+    auto* snapshot = engine->beginSnapshot();
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->put("a_0", "updated"));
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->getLatest("a_", &val, snapshot));
+    EXPECT_EQ("val_0", val);
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->getLatest("a_", &val));
+    EXPECT_EQ("updated", val);
+    engine->releaseSnapshot(snapshot);
+}
+
+
+TEST(RocksEngineTest, SnapshotTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_SnapshotTest.XXXXXX");
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->put("snap_key", "old"));
+    auto* snapshot = engine->beginSnapshot();
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->put("snap_key", "new"));
+
+    // The pinned scan observes the state at beginSnapshot()
+    std::unique_ptr<KVIterator> iter;
+    EXPECT_EQ(ResultCode::SUCCEEDED,
+              engine->prefix("snap_key", &iter, ScanHint::DEFAULT, snapshot));
+    ASSERT_TRUE(iter->valid());
+    EXPECT_EQ("old", iter->val());
+
+    // An unpinned scan observes the latest state
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->prefix("snap_key", &iter));
+    ASSERT_TRUE(iter->valid());
+    EXPECT_EQ("new", iter->val());
+
+    engine->releaseSnapshot(snapshot);
+}
+
+
 TEST(RocksEngineTest, RemoveTest) {
     fs::TempDir rootPath("/tmp/rocksdb_engine_RemoveTest.XXXXXX");
     auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
@@ -183,8 +238,177 @@ TEST(RocksEngineTest, OptionTest) {
               engine->setDBOption("max_background_compactions", "2_"));
     EXPECT_EQ(ResultCode::ERR_INVALID_ARGUMENT,
               engine->setDBOption("max_background_compactions", "bad_value"));
+
+    std::string value;
+    EXPECT_EQ(ResultCode::SUCCEEDED,
+              engine->getOption("disable_auto_compactions", &value));
+    EXPECT_EQ("true", value);
+    EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND,
+              engine->getOption("disable_auto_compactions_", &value));
+    EXPECT_EQ(ResultCode::SUCCEEDED,
+              engine->getDBOption("max_background_compactions", &value));
+    EXPECT_EQ("2", value);
+    EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND,
+              engine->getDBOption("max_background_compactions_", &value));
+}
+
+
+TEST(RocksEngineTest, PropertyTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_PropertyTest.XXXXXX");
+    {
+        auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+        std::string value;
+        EXPECT_EQ(ResultCode::SUCCEEDED,
+                  engine->getProperty("rocksdb.estimate-num-keys", &value));
+        EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND,
+                  engine->getProperty("rocksdb.no-such-property", &value));
+
+        // opened without --enable_rocksdb_statistics
+        std::unordered_map<std::string, int64_t> stats;
+        EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND, engine->getStatistics(&stats));
+        EXPECT_TRUE(stats.empty());
+    }
+    {
+        FLAGS_enable_rocksdb_statistics = true;
+        auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+        EXPECT_EQ(ResultCode::SUCCEEDED, engine->put("key", "val"));
+        std::string val;
+        EXPECT_EQ(ResultCode::SUCCEEDED, engine->get("key", &val));
+
+        std::unordered_map<std::string, int64_t> stats;
+        EXPECT_EQ(ResultCode::SUCCEEDED, engine->getStatistics(&stats));
+        EXPECT_FALSE(stats.empty());
+        EXPECT_NE(stats.end(), stats.find("rocksdb.bytes.written"));
+        FLAGS_enable_rocksdb_statistics = false;
+    }
+}
+
+TEST(RocksEngineTest, WriteStallPctTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_WriteStallPctTest.XXXXXX");
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    // An idle engine sits far from a stall; one active memtable out of
+    // the configured budget is the only signal it can show
+    auto pct = engine->writeStallPct();
+    EXPECT_GE(pct, 0);
+    EXPECT_LT(pct, 100);
+    // Within the check interval the cached value is served
+    EXPECT_EQ(pct, engine->writeStallPct());
 }
 
+TEST(RocksEngineTest, BlobValueTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_BlobValueTest.XXXXXX");
+    FLAGS_rocksdb_blob_spaces = "0:1";
+    SCOPE_EXIT {
+        FLAGS_rocksdb_blob_spaces = "";
+    };
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    std::string small(100, 's');
+    std::string large(4096, 'l');
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->put("key_small", small));
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->put("key_large", large));
+    // The blob files are written when rocksdb builds the sst
+    engine->flush();
+
+    std::string value;
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->get("key_small", &value));
+    EXPECT_EQ(small, value);
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->get("key_large", &value));
+    EXPECT_EQ(large, value);
+    // The large value went to a blob file, the small one stayed in the sst
+    std::string numBlobFiles;
+    EXPECT_EQ(ResultCode::SUCCEEDED,
+              engine->getProperty("rocksdb.num-blob-files", &numBlobFiles));
+    EXPECT_EQ("1", numBlobFiles);
+}
+
+TEST(RocksEngineTest, CardinalityTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_CardinalityTest.XXXXXX");
+    FLAGS_enable_cardinality_stats = true;
+    SCOPE_EXIT {
+        FLAGS_enable_cardinality_stats = false;
+    };
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    const size_t vIdLen = sizeof(int64_t);
+    std::vector<KV> data;
+    // Two vertices of tag 3 in part 1, one of them with two versions,
+    // and one vertex of tag 4
+    data.emplace_back(NebulaKeyUtils::vertexKey(vIdLen, 1, "aaaaaaaa", 3, 0), "v1");
+    data.emplace_back(NebulaKeyUtils::vertexKey(vIdLen, 1, "aaaaaaaa", 3, 1), "v1'");
+    data.emplace_back(NebulaKeyUtils::vertexKey(vIdLen, 1, "bbbbbbbb", 3, 0), "v2");
+    data.emplace_back(NebulaKeyUtils::vertexKey(vIdLen, 1, "bbbbbbbb", 4, 0), "v3");
+    // Edges of type 101 in parts 1 and 2, and a non-data key that the
+    // collector must ignore
+    data.emplace_back(NebulaKeyUtils::edgeKey(vIdLen, 1, "aaaaaaaa", 101, 0, "bbbbbbbb", 0),
+                      "e1");
+    data.emplace_back(NebulaKeyUtils::edgeKey(vIdLen, 2, "bbbbbbbb", 101, 0, "aaaaaaaa", 0),
+                      "e2");
+    data.emplace_back(NebulaKeyUtils::systemCommitKey(1), "system");
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->multiPut(std::move(data)));
+    // The collector only runs when rocksdb builds an sst
+    engine->flush();
+
+    auto status = engine->cardinalityStatus();
+    EXPECT_NE(status.find("part 1 tag 3: ~3 rows"), std::string::npos) << status;
+    EXPECT_NE(status.find("part 1 tag 4: ~1 rows"), std::string::npos) << status;
+    EXPECT_NE(status.find("part 1 edge 101: ~1 rows"), std::string::npos) << status;
+    EXPECT_NE(status.find("part 2 edge 101: ~1 rows"), std::string::npos) << status;
+}
+
+TEST(RocksEngineTest, InEdgeCfTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_InEdgeCfTest.XXXXXX");
+    FLAGS_rocksdb_separate_in_edge_cf = true;
+    SCOPE_EXIT {
+        FLAGS_rocksdb_separate_in_edge_cf = false;
+    };
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    const size_t vIdLen = sizeof(int64_t);
+    auto outKey = NebulaKeyUtils::edgeKey(vIdLen, 1, "aaaaaaaa", 101, 0, "bbbbbbbb", 0);
+    auto inKey = NebulaKeyUtils::edgeKey(vIdLen, 1, "bbbbbbbb", -101, 0, "aaaaaaaa", 0);
+    std::vector<KV> data;
+    // The two orientations of one logical edge, plus a tag row
+    data.emplace_back(NebulaKeyUtils::vertexKey(vIdLen, 1, "aaaaaaaa", 3, 0), "v1");
+    data.emplace_back(outKey, "out");
+    data.emplace_back(inKey, "in");
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->multiPut(std::move(data)));
+
+    // Point reads route to the family the key lives in
+    std::string value;
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->get(outKey, &value));
+    EXPECT_EQ("out", value);
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->get(inKey, &value));
+    EXPECT_EQ("in", value);
+
+    // A scan pinned to a negative edge type stays in the in-edge family
+    std::unique_ptr<KVIterator> iter;
+    auto inPrefix = NebulaKeyUtils::edgePrefix(vIdLen, 1, "bbbbbbbb", -101);
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->prefix(inPrefix, &iter));
+    ASSERT_TRUE(iter->valid());
+    EXPECT_EQ("in", iter->val());
+    iter->next();
+    EXPECT_FALSE(iter->valid());
+
+    // A whole-part scan does not pin the direction and merges both
+    // families back into one key-ordered stream
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->prefix(NebulaKeyUtils::partPrefix(1), &iter));
+    std::string lastKey;
+    int32_t num = 0;
+    while (iter->valid()) {
+        auto key = iter->key().str();
+        EXPECT_LT(lastKey, key);
+        lastKey = key;
+        num++;
+        iter->next();
+    }
+    EXPECT_EQ(3, num);
+
+    // Once opened with the family, the db keeps using it even with the
+    // flag turned off again
+    engine.reset();
+    FLAGS_rocksdb_separate_in_edge_cf = false;
+    engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->get(inKey, &value));
+    EXPECT_EQ("in", value);
+}
 
 TEST(RocksEngineTest, CompactTest) {
     fs::TempDir rootPath("/tmp/rocksdb_engine_CompactTest.XXXXXX");
@@ -224,6 +448,104 @@ TEST(RocksEngineTest, IngestTest) {
     EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND, engine->get("key_not_exist", &result));
 }
 
+TEST(RocksEngineTest, IngestPrewarmTest) {
+    FLAGS_rocksdb_ingest_prewarm_data_mb = 1;
+    fs::TempDir rootPath("/tmp/rocksdb_engine_IngestPrewarmTest.XXXXXX");
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+
+    std::vector<KV> sortedData;
+    for (int32_t i = 0; i < 100; i++) {
+        sortedData.emplace_back(folly::stringPrintf("key_%03d", i),
+                                folly::stringPrintf("val_%03d", i));
+    }
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->writeBulkSst(1, sortedData));
+    auto dir = folly::stringPrintf("%s/download/1", engine->getDataRoot());
+    auto files = fs::FileUtils::listAllFilesInDir(dir.c_str(), true, "*.sst");
+    ASSERT_EQ(1, files.size());
+
+    // The warmed ingest must be as correct as the plain one; the
+    // caching effect itself is not observable through the API
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->ingest(files, true));
+    std::string result;
+    for (int32_t i = 0; i < 100; i++) {
+        EXPECT_EQ(ResultCode::SUCCEEDED,
+                  engine->get(folly::stringPrintf("key_%03d", i), &result));
+        EXPECT_EQ(folly::stringPrintf("val_%03d", i), result);
+    }
+    FLAGS_rocksdb_ingest_prewarm_data_mb = 0;
+}
+
+TEST(RocksEngineTest, WriteBulkSstTest) {
+    fs::TempDir rootPath("/tmp/rocksdb_engine_WriteBulkSstTest.XXXXXX");
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+
+    std::vector<KV> sortedData;
+    for (int32_t i = 0; i < 100; i++) {
+        sortedData.emplace_back(folly::stringPrintf("key_%03d", i),
+                                folly::stringPrintf("val_%03d", i));
+    }
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->writeBulkSst(1, sortedData));
+
+    // the file lands where ingest() looks for it
+    auto dir = folly::stringPrintf("%s/download/1", engine->getDataRoot());
+    auto files = fs::FileUtils::listAllFilesInDir(dir.c_str(), true, "*.sst");
+    ASSERT_EQ(1, files.size());
+
+    std::string result;
+    EXPECT_EQ(ResultCode::ERR_KEY_NOT_FOUND, engine->get("key_000", &result));
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->ingest(files));
+    for (int32_t i = 0; i < 100; i++) {
+        EXPECT_EQ(ResultCode::SUCCEEDED,
+                  engine->get(folly::stringPrintf("key_%03d", i), &result));
+        EXPECT_EQ(folly::stringPrintf("val_%03d", i), result);
+    }
+
+    // out-of-order input is rejected instead of producing a bad file
+    std::vector<KV> unsorted;
+    unsorted.emplace_back("key_b", "");
+    unsorted.emplace_back("key_a", "");
+    EXPECT_EQ(ResultCode::ERR_INVALID_DATA, engine->writeBulkSst(2, unsorted));
+}
+
+TEST(RocksEngineTest, PrefixBloomTest) {
+    FLAGS_enable_rocksdb_prefix_filtering = true;
+    fs::TempDir rootPath("/tmp/rocksdb_engine_PrefixBloomTest.XXXXXX");
+    auto engine = std::make_unique<RocksEngine>(0, rootPath.path());
+    std::vector<KV> data;
+    for (auto partId = 1; partId <= 2; partId++) {
+        for (int32_t i = 0; i < 10;  i++) {
+            auto key = NebulaKeyUtils::vertexKey(sizeof(int64_t),
+                                                 partId,
+                                                 folly::stringPrintf("vid_%d", i),
+                                                 i,
+                                                 0L);
+            data.emplace_back(std::move(key), folly::stringPrintf("val_%d", i));
+        }
+    }
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->multiPut(std::move(data)));
+    // Flush to sst so the bloom filter gets involved
+    EXPECT_EQ(ResultCode::SUCCEEDED, engine->flush());
+
+    auto checkPrefix = [&](const std::string& prefix, int32_t expectedTotal) {
+        std::unique_ptr<KVIterator> iter;
+        EXPECT_EQ(ResultCode::SUCCEEDED, engine->prefix(prefix, &iter));
+        int num = 0;
+        while (iter->valid()) {
+            num++;
+            iter->next();
+        }
+        EXPECT_EQ(expectedTotal, num);
+    };
+    // Longer than partId + vid: prefix mode
+    checkPrefix(NebulaKeyUtils::vertexPrefix(sizeof(int64_t), 1, "vid_1", 1), 1);
+    // Exactly partId + vid: prefix mode
+    checkPrefix(NebulaKeyUtils::vertexPrefix(sizeof(int64_t), 1, "vid_1"), 1);
+    // Whole part: must fall back to a total order seek
+    checkPrefix(NebulaKeyUtils::partPrefix(1), 10);
+    checkPrefix(NebulaKeyUtils::partPrefix(2), 10);
+    FLAGS_enable_rocksdb_prefix_filtering = false;
+}
+
 }  // namespace kvstore
 }  // namespace nebula
 
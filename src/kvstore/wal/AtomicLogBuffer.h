@@ -41,7 +41,7 @@ struct Node {
     Node() = default;
 
     bool isFull() {
-        return pos_.load(std::memory_order_relaxed) == kMaxLength;
+        return pos_->load(std::memory_order_relaxed) == kMaxLength;
     }
 
     bool push_back(Record&& rec) {
@@ -49,24 +49,26 @@ struct Node {
             return false;
         }
         size_ += rec.size();
-        auto pos = pos_.load(std::memory_order_acquire);
+        auto pos = pos_->load(std::memory_order_acquire);
         (*records_)[pos] = std::move(rec);
-        pos_.fetch_add(1, std::memory_order_release);
+        pos_->fetch_add(1, std::memory_order_release);
         return true;
     }
 
     Record* rec(int32_t index) {
         CHECK_GE(index, 0);
-        auto pos = pos_.load(std::memory_order_acquire);
+        auto pos = pos_->load(std::memory_order_acquire);
         CHECK_LE(index, pos);
         CHECK(index != kMaxLength);
         return &(*records_)[index];
     }
 
     LogID lastLogId() const {
-        return firstLogId_ + pos_.load(std::memory_order_relaxed);
+        return firstLogId_ + pos_->load(std::memory_order_relaxed);
     }
 
+    /******* fields only touched by the single writer ***************/
+
     LogID                             firstLogId_{0};
     // total size for current Node.
     int32_t                           size_{0};
@@ -76,8 +78,12 @@ struct Node {
 
     // We should ensure the records appended happens-before pos_ increment.
     folly::CachelinePadded<std::array<Record, kMaxLength>>    records_;
-    // current valid position for the next record.
-    std::atomic<int32_t>              pos_{0};
+    // Current valid position for the next record. A record slot is never
+    // modified again once it is published by the release increment, so
+    // readers pairing with the acquire load never need to retry. The
+    // padding keeps the writer's increments off the cache line holding
+    // markDeleted_/prev_, which readers walk on every node switch.
+    folly::CachelinePadded<std::atomic<int32_t>>              pos_{0};
     // The field only be accessed when the refs count down to zero
     std::atomic<bool>                 markDeleted_{false};
     // We should ensure the records appended happens-before the prev inited.
@@ -117,7 +123,7 @@ public:
                 return *this;
             }
             // Operations after load SHOULD NOT reorder before it.
-            auto pos = currNode_->pos_.load(std::memory_order_acquire);
+            auto pos = currNode_->pos_->load(std::memory_order_acquire);
             VLOG(3) << "currNode firstLogId = " << currNode_->firstLogId_
                     << ", currIndex = " << currIndex_
                     << ", currNode pos " << pos;
@@ -211,7 +217,7 @@ public:
      * Users should ensure there are no readers when releasing it.
      * */
     ~AtomicLogBuffer() {
-        auto refs = refs_.load(std::memory_order_acquire);
+        auto refs = refs_->load(std::memory_order_acquire);
         CHECK_EQ(0, refs);
         auto* curr = head_.load(std::memory_order_relaxed);
         auto* prev = curr;
@@ -346,14 +352,14 @@ private:
     }
 
     int32_t addRef() {
-        return refs_.fetch_add(1, std::memory_order_relaxed);
+        return refs_->fetch_add(1, std::memory_order_relaxed);
     }
 
     void releaseRef() {
         // All operations following SHOULD NOT reordered before tail.load()
         // so we could ensure the tail used in GC is older than new coming readers.
         auto* tail = tail_.load(std::memory_order_acquire);
-        auto readers = refs_.fetch_sub(1, std::memory_order_relaxed);
+        auto readers = refs_->fetch_sub(1, std::memory_order_relaxed);
         VLOG(3) << "Release ref, readers = " << readers;
         if (readers > 1) {
             return;
@@ -403,7 +409,10 @@ private:
     // After tail_, all nodes should be marked deleted.
     std::atomic<Node*>           tail_{nullptr};
 
-    std::atomic_int              refs_{0};
+    // Every reader bumps refs_ on creation and destruction, so keep it
+    // on its own cache line. Otherwise each iterator would invalidate
+    // the line holding head_/tail_, which the writer reads on every push.
+    folly::CachelinePadded<std::atomic_int>    refs_{0};
     // current size for the buffer.
     std::atomic_int              size_{0};
     std::atomic<LogID>           firstLogId_{0};
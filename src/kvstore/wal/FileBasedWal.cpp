@@ -9,13 +9,54 @@
 #include "common/time/WallClock.h"
 #include "kvstore/wal/FileBasedWal.h"
 #include "kvstore/wal/WalFileIterator.h"
+#include <folly/hash/Checksum.h>
 #include <utime.h>
 
+DEFINE_int32(wal_sync_interval_ms, -1,
+             "Group-sync window of the WAL in milliseconds. A value of 0 "
+             "syncs every write, a positive value syncs once the window "
+             "expires or FLAGS_wal_sync_bytes piled up, and -1 keeps the "
+             "old behavior of syncing on file rollover only");
+DEFINE_int32(wal_sync_bytes, 4 * 1024 * 1024,
+             "Sync the WAL once this many unsynced bytes accumulated, "
+             "only effective when FLAGS_wal_sync_interval_ms is positive");
+DEFINE_bool(wal_record_checksum, false,
+            "Append a CRC32C to every new wal record, so torn or bit-rotted "
+            "records are detected during recovery instead of being replayed. "
+            "folly::crc32c uses the SSE4.2 instruction when the CPU has it. "
+            "Records written without the flag are still accepted, but older "
+            "releases cannot read checksummed records, so only turn it on "
+            "after the whole cluster has been upgraded");
+DEFINE_bool(wal_prealloc_file, false,
+            "Preallocate the blocks of every wal segment upfront and keep "
+            "one rotated segment around for reuse, so appends do not stall "
+            "on filesystem metadata updates and block allocation");
+
 namespace nebula {
 namespace wal {
 
 using nebula::fs::FileUtils;
 
+namespace {
+// The name of the spare segment kept for reuse when
+// FLAGS_wal_prealloc_file is on. The extra suffix keeps it out of the
+// "*.wal" glob of scanAllWalFiles()
+const char kRecycledWalFile[] = "wal.recycled";
+
+// The clean-shutdown sidecar. closeCurrFile() records the state of the
+// last segment here, and scanAllWalFiles() consumes it to skip the
+// byte-level scan of the last segment when the recorded state still
+// matches the file
+const char kWalMetaFile[] = "wal.meta";
+
+struct WalMeta {
+    LogID firstId;
+    LogID lastId;
+    TermID lastTerm;
+    int64_t size;
+};
+}  // anonymous namespace
+
 /**********************************************
  *
  * Implementation of FileBasedWal
@@ -160,10 +201,14 @@ void FileBasedWal::scanAllWalFiles() {
             close(fd);
             continue;
         }
+        // Checksummed records carry a CRC32C between the payload and the
+        // trailing length, flagged in the length fields
+        size_t crcSize = (succMsgLen & kWalMsgLenCrcFlag) ? sizeof(uint32_t) : 0;
+        size_t msgLen = succMsgLen & kWalMsgLenMask;
 
         // Verify the last log length
         if (lseek(fd,
-                  -(sizeof(int32_t) * 2 + succMsgLen + sizeof(ClusterID)),
+                  -(sizeof(int32_t) * 2 + crcSize + msgLen + sizeof(ClusterID)),
                   SEEK_END) < 0) {
             LOG(ERROR) << "Failed to seek the last log length from \""
                        << fn << "\" (" << errno << "): "
@@ -190,7 +235,8 @@ void FileBasedWal::scanAllWalFiles() {
         // Read the last log term
         if (lseek(fd,
                   -(sizeof(int32_t) * 2
-                    + succMsgLen
+                    + crcSize
+                    + msgLen
                     + sizeof(ClusterID)
                     + sizeof(TermID)),
                   SEEK_END) < 0) {
@@ -213,7 +259,8 @@ void FileBasedWal::scanAllWalFiles() {
         // Read the last log id
         if (lseek(fd,
                   -(sizeof(int32_t) * 2
-                    + succMsgLen
+                    + crcSize
+                    + msgLen
                     + sizeof(ClusterID)
                     + sizeof(TermID)
                     + sizeof(LogID)),
@@ -240,8 +287,30 @@ void FileBasedWal::scanAllWalFiles() {
 
     if (!walFiles_.empty()) {
         auto it = walFiles_.rbegin();
-        // Try to scan last wal, if it is invalid or empty, scan the privous one
-        scanLastWal(it->second, it->second->firstId());
+        // A clean shutdown left a sidecar describing the last segment.
+        // Consume it (read and unlink, so a stale one never survives the
+        // next run) and skip the byte-level scan when it still matches
+        WalMeta meta;
+        bool hasMeta = false;
+        auto metaPath = FileUtils::joinPath(dir_, kWalMetaFile);
+        int32_t metaFd = open(metaPath.c_str(), O_RDONLY);
+        if (metaFd >= 0) {
+            hasMeta = (read(metaFd, &meta, sizeof(meta)) == sizeof(meta));
+            close(metaFd);
+            unlink(metaPath.c_str());
+        }
+        if (hasMeta
+                && meta.firstId == it->second->firstId()
+                && meta.size == static_cast<int64_t>(it->second->size())
+                && meta.lastId > 0) {
+            VLOG(1) << idStr_ << "Clean shutdown detected, skip scanning \""
+                    << it->second->path() << "\"";
+            it->second->setLastId(meta.lastId);
+            it->second->setLastTerm(meta.lastTerm);
+        } else {
+            // Try to scan last wal, if it is invalid or empty, scan the privous one
+            scanLastWal(it->second, it->second->firstId());
+        }
         if (it->second->lastId() <= 0) {
             unlink(it->second->path());
             walFiles_.erase(it->first);
@@ -285,6 +354,8 @@ void FileBasedWal::closeCurrFile() {
     }
 
     CHECK_EQ(fsync(currFd_), 0) << strerror(errno);
+    unsyncedBytes_ = 0;
+    syncDur_.reset();
     // Close the file
     CHECK_EQ(close(currFd_), 0) << strerror(errno);
     currFd_ = -1;
@@ -298,6 +369,28 @@ void FileBasedWal::closeCurrFile() {
     timebuf.actime = currInfo_->mtime();
     VLOG(1) << "Close cur file " << currInfo_->path() << ", mtime: " << currInfo_->mtime();
     CHECK_EQ(utime(currInfo_->path(), &timebuf), 0);
+
+    // Leave the clean-shutdown sidecar behind, so the next startup can
+    // skip the byte-level scan of this segment. Best effort: without it
+    // the startup simply falls back to scanning
+    WalMeta meta;
+    meta.firstId = currInfo_->firstId();
+    meta.lastId = currInfo_->lastId();
+    meta.lastTerm = currInfo_->lastTerm();
+    meta.size = currInfo_->size();
+    auto metaPath = FileUtils::joinPath(dir_, kWalMetaFile);
+    int32_t metaFd = open(metaPath.c_str(),
+                          O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC,
+                          0644);
+    if (metaFd >= 0) {
+        if (write(metaFd, &meta, sizeof(meta)) != sizeof(meta)) {
+            LOG(WARNING) << idStr_ << "Failed to write " << metaPath
+                         << " (errno: " << errno << "): " << strerror(errno);
+            unlink(metaPath.c_str());
+        }
+        close(metaFd);
+    }
+
     currInfo_.reset();
 }
 
@@ -314,16 +407,34 @@ void FileBasedWal::prepareNewFile(LogID startLogId) {
     VLOG(1) << idStr_ << "Write new file " << info->path();
     walFiles_.emplace(std::make_pair(startLogId, info));
 
+    // Reuse the recycled segment if there is one, its inode and
+    // directory entry are already in place
+    bool recycled = false;
+    if (FLAGS_wal_prealloc_file) {
+        auto spare = FileUtils::joinPath(dir_, kRecycledWalFile);
+        recycled = (rename(spare.c_str(), info->path()) == 0);
+    }
+
     // Create the file for write
-    currFd_ = open(
-        info->path(),
-        O_CREAT | O_EXCL | O_WRONLY | O_APPEND | O_CLOEXEC | O_LARGEFILE,
-        0644);
+    int flags = O_WRONLY | O_APPEND | O_CLOEXEC | O_LARGEFILE;
+    flags |= recycled ? O_TRUNC : (O_CREAT | O_EXCL);
+    currFd_ = open(info->path(), flags, 0644);
     if (currFd_ < 0) {
         LOG(FATAL) << "Failed to open file \"" << info->path()
                    << "\" (errno: " << errno << "): "
                    << strerror(errno);
     }
+#ifdef FALLOC_FL_KEEP_SIZE
+    if (FLAGS_wal_prealloc_file) {
+        // KEEP_SIZE, since scanAllWalFiles() locates the last record
+        // relative to the end of the file and rollover is triggered by
+        // the tracked size, both need st_size to cover valid data only
+        if (fallocate(currFd_, FALLOC_FL_KEEP_SIZE, 0, maxFileSize_) != 0) {
+            VLOG(1) << idStr_ << "Failed to preallocate \"" << info->path()
+                    << "\" (errno: " << errno << "): " << strerror(errno);
+        }
+    }
+#endif
     currInfo_ = info;
 }
 
@@ -369,7 +480,8 @@ void FileBasedWal::rollbackInFile(WalFileInfoPtr info, LogID logId) {
                + sizeof(TermID)
                + sizeof(ClusterID)
                + 2 * sizeof(int32_t)
-               + len;
+               + ((len & kWalMsgLenCrcFlag) ? sizeof(uint32_t) : 0)
+               + (len & kWalMsgLenMask);
 
         if (id == logId) {
             break;
@@ -435,9 +547,12 @@ void FileBasedWal::scanLastWal(WalFileInfoPtr info, LogID firstId) {
                 != sizeof(int32_t)) {
             break;
         }
+        size_t crcSize = (head & kWalMsgLenCrcFlag) ? sizeof(uint32_t) : 0;
+        size_t msgLen = head & kWalMsgLenMask;
 
         if (pread(fd, &foot, sizeof(int32_t),
-                  pos + sizeof(LogID) + sizeof(TermID) + sizeof(int32_t) + sizeof(ClusterID) + head)
+                  pos + sizeof(LogID) + sizeof(TermID) + sizeof(int32_t) + sizeof(ClusterID)
+                      + msgLen + crcSize)
                 != sizeof(int32_t)) {
             break;
         }
@@ -447,6 +562,26 @@ void FileBasedWal::scanLastWal(WalFileInfoPtr info, LogID firstId) {
             break;
         }
 
+        if (crcSize > 0) {
+            // Verify the record against its CRC32C, which covers all
+            // bytes before the checksum. A torn write truncates here
+            auto recLen = sizeof(LogID) + sizeof(TermID) + sizeof(int32_t)
+                          + sizeof(ClusterID) + msgLen;
+            std::string rec(recLen, '\0');
+            uint32_t crc = 0;
+            if (pread(fd, &rec[0], recLen, pos) != static_cast<ssize_t>(recLen)
+                    || pread(fd, &crc, sizeof(uint32_t), pos + recLen)
+                        != sizeof(uint32_t)) {
+                break;
+            }
+            if (crc != folly::crc32c(reinterpret_cast<const uint8_t*>(rec.data()),
+                                     rec.size())) {
+                LOG(ERROR) << "Checksum mismatch on log " << id
+                           << ", truncating the wal from it";
+                break;
+            }
+        }
+
         info->setLastTerm(term);
         info->setLastId(id);
 
@@ -455,7 +590,8 @@ void FileBasedWal::scanLastWal(WalFileInfoPtr info, LogID firstId) {
                + sizeof(TermID)
                + sizeof(ClusterID)
                + sizeof(int32_t)
-               + head
+               + msgLen
+               + crcSize
                + sizeof(int32_t);
 
         ++curLogId;
@@ -474,46 +610,43 @@ void FileBasedWal::scanLastWal(WalFileInfoPtr info, LogID firstId) {
     close(fd);
 }
 
-bool FileBasedWal::appendLogInternal(LogID id,
-                                     TermID term,
-                                     ClusterID cluster,
-                                     std::string msg) {
-    if (stopped_) {
-        LOG(ERROR) << idStr_ << "WAL has stopped. Do not accept logs any more";
-        return false;
-    }
-
-    if (lastLogId_ != 0 && firstLogId_ != 0 && id != lastLogId_ + 1) {
-        LOG(ERROR) << idStr_ << "There is a gap in the log id. The last log id is "
-                   << lastLogId_
-                   << ", and the id being appended is " << id;
-        return false;
-    }
-
-    if (!preProcessor_(id, term, cluster, msg)) {
-        LOG(ERROR) << idStr_ << "Pre process failed for log " << id;
-        return false;
-    }
-
-    // Write to the WAL file first
+std::string FileBasedWal::encodeLogRecord(LogID id,
+                                          TermID term,
+                                          ClusterID cluster,
+                                          const std::string& msg) {
     std::string strBuf;
     strBuf.reserve(sizeof(LogID)
                     + sizeof(TermID)
                     + sizeof(ClusterID)
                     + msg.size()
+                    + sizeof(uint32_t)
                     + 2 * sizeof(int32_t));
     strBuf.append(reinterpret_cast<char*>(&id), sizeof(LogID));
     strBuf.append(reinterpret_cast<char*>(&term), sizeof(TermID));
     int32_t len = msg.size();
+    if (FLAGS_wal_record_checksum) {
+        len |= kWalMsgLenCrcFlag;
+    }
     strBuf.append(reinterpret_cast<char*>(&len), sizeof(int32_t));
     strBuf.append(reinterpret_cast<char*>(&cluster), sizeof(ClusterID));
     strBuf.append(reinterpret_cast<const char*>(msg.data()), msg.size());
+    if (FLAGS_wal_record_checksum) {
+        // The checksum covers everything before it, the length fields
+        // included, so a record whose header was torn fails too
+        uint32_t crc = folly::crc32c(reinterpret_cast<const uint8_t*>(strBuf.data()),
+                                     strBuf.size());
+        strBuf.append(reinterpret_cast<char*>(&crc), sizeof(uint32_t));
+    }
     strBuf.append(reinterpret_cast<char*>(&len), sizeof(int32_t));
+    return strBuf;
+}
+
 
+void FileBasedWal::writeRecordToFile(LogID id, TermID term, const std::string& rec) {
     // Prepare the WAL file if it's not opened
     if (currFd_ < 0) {
         prepareNewFile(id);
-    } else if (currInfo_->size() + strBuf.size() > maxFileSize_) {
+    } else if (currInfo_->size() + rec.size() > maxFileSize_) {
         // Need to roll over
         closeCurrFile();
 
@@ -521,14 +654,70 @@ bool FileBasedWal::appendLogInternal(LogID id,
         prepareNewFile(id);
     }
 
-    ssize_t bytesWritten = write(currFd_, strBuf.data(), strBuf.size());
-    if (bytesWritten != (ssize_t)strBuf.size()) {
-        LOG(FATAL) << idStr_ << "bytesWritten:" << bytesWritten << ", expected:" << strBuf.size()
+    ssize_t bytesWritten = write(currFd_, rec.data(), rec.size());
+    if (bytesWritten != (ssize_t)rec.size()) {
+        LOG(FATAL) << idStr_ << "bytesWritten:" << bytesWritten << ", expected:" << rec.size()
                    << ", error:" << strerror(errno);
     }
-    currInfo_->setSize(currInfo_->size() + strBuf.size());
+    currInfo_->setSize(currInfo_->size() + rec.size());
     currInfo_->setLastId(id);
     currInfo_->setLastTerm(term);
+    unsyncedBytes_ += rec.size();
+    maybeSync();
+}
+
+
+void FileBasedWal::maybeSync() {
+    if (FLAGS_wal_sync_interval_ms < 0 || unsyncedBytes_ == 0) {
+        return;
+    }
+    if (FLAGS_wal_sync_interval_ms == 0
+            || unsyncedBytes_ >= static_cast<size_t>(FLAGS_wal_sync_bytes)
+            || syncDur_.elapsedInMSec() >= static_cast<uint64_t>(FLAGS_wal_sync_interval_ms)) {
+        sync();
+    }
+}
+
+
+bool FileBasedWal::sync() {
+    if (currFd_ < 0 || unsyncedBytes_ == 0) {
+        return true;
+    }
+    if (fsync(currFd_) != 0) {
+        LOG(ERROR) << idStr_ << "Failed to sync the wal file (errno: "
+                   << errno << "): " << strerror(errno);
+        return false;
+    }
+    unsyncedBytes_ = 0;
+    syncDur_.reset();
+    return true;
+}
+
+
+bool FileBasedWal::appendLogInternal(LogID id,
+                                     TermID term,
+                                     ClusterID cluster,
+                                     std::string msg) {
+    if (stopped_) {
+        LOG(ERROR) << idStr_ << "WAL has stopped. Do not accept logs any more";
+        return false;
+    }
+
+    if (lastLogId_ != 0 && firstLogId_ != 0 && id != lastLogId_ + 1) {
+        LOG(ERROR) << idStr_ << "There is a gap in the log id. The last log id is "
+                   << lastLogId_
+                   << ", and the id being appended is " << id;
+        return false;
+    }
+
+    if (!preProcessor_(id, term, cluster, msg)) {
+        LOG(ERROR) << idStr_ << "Pre process failed for log " << id;
+        return false;
+    }
+
+    // Write to the WAL file first
+    std::string strBuf = encodeLogRecord(id, term, cluster, msg);
+    writeRecordToFile(id, term, strBuf);
 
     lastLogId_ = id;
     lastLogTerm_ = term;
@@ -542,6 +731,59 @@ bool FileBasedWal::appendLogInternal(LogID id,
 }
 
 
+bool FileBasedWal::appendLogsToBuffer(LogIterator& iter) {
+    for (; iter.valid(); ++iter) {
+        auto id = iter.logId();
+        auto term = iter.logTerm();
+        auto cluster = iter.logSource();
+        auto msg = iter.logMsg().toString();
+
+        if (stopped_) {
+            LOG(ERROR) << idStr_ << "WAL has stopped. Do not accept logs any more";
+            return false;
+        }
+
+        if (lastLogId_ != 0 && firstLogId_ != 0 && id != lastLogId_ + 1) {
+            LOG(ERROR) << idStr_ << "There is a gap in the log id. The last log id is "
+                       << lastLogId_
+                       << ", and the id being appended is " << id;
+            return false;
+        }
+
+        if (!preProcessor_(id, term, cluster, msg)) {
+            LOG(ERROR) << idStr_ << "Pre process failed for log " << id;
+            return false;
+        }
+
+        pendingRecords_.emplace_back(id, term, encodeLogRecord(id, term, cluster, msg));
+
+        lastLogId_ = id;
+        lastLogTerm_ = term;
+        if (firstLogId_ == 0) {
+            firstLogId_ = id;
+        }
+
+        logBuffer_->push(id, term, cluster, std::move(msg));
+    }
+
+    return true;
+}
+
+
+bool FileBasedWal::flushPendingLogs() {
+    for (auto& rec : pendingRecords_) {
+        writeRecordToFile(std::get<0>(rec), std::get<1>(rec), std::get<2>(rec));
+    }
+    pendingRecords_.clear();
+    // The raft commit is gated on this flush, so make the batch durable
+    // before reporting success when group sync is enabled
+    if (FLAGS_wal_sync_interval_ms >= 0) {
+        return sync();
+    }
+    return true;
+}
+
+
 bool FileBasedWal::appendLog(LogID id,
                              TermID term,
                              ClusterID cluster,
@@ -621,6 +863,9 @@ bool FileBasedWal::rollbackToLog(LogID id) {
     // 1. Roll back WAL files
     //-----------------------
 
+    // Records not flushed yet are rolled back as well
+    pendingRecords_.clear();
+
     // First close the current file
     closeCurrFile();
 
@@ -663,6 +908,7 @@ bool FileBasedWal::rollbackToLog(LogID id) {
 
 
 bool FileBasedWal::reset() {
+    pendingRecords_.clear();
     closeCurrFile();
     logBuffer_->reset();
     {
@@ -696,7 +942,11 @@ void FileBasedWal::cleanWAL(int32_t ttl) {
         if (index++ < size - 1 &&  (now - it->second->mtime() > walTTL)) {
             VLOG(1) << "Clean wals, Remove " << it->second->path() << ", now: " << now
                     << ", mtime: " << it->second->mtime();
-            unlink(it->second->path());
+            if (FLAGS_wal_prealloc_file) {
+                recycleWalFile(it->second->path());
+            } else {
+                unlink(it->second->path());
+            }
             it = walFiles_.erase(it);
             count++;
         } else {
@@ -710,6 +960,21 @@ void FileBasedWal::cleanWAL(int32_t ttl) {
 }
 
 
+void FileBasedWal::recycleWalFile(const char* path) {
+    auto spare = FileUtils::joinPath(dir_, kRecycledWalFile);
+    if (access(spare.c_str(), F_OK) == 0) {
+        // One spare segment is enough
+        unlink(path);
+        return;
+    }
+    if (rename(path, spare.c_str()) != 0) {
+        LOG(WARNING) << idStr_ << "Failed to recycle \"" << path
+                     << "\" (errno: " << errno << "): " << strerror(errno);
+        unlink(path);
+    }
+}
+
+
 size_t FileBasedWal::accessAllWalInfo(std::function<bool(WalFileInfoPtr info)> fn) const {
     std::lock_guard<std::mutex> g(walFilesMutex_);
 
@@ -9,6 +9,7 @@
 
 #include "common/base/Base.h"
 #include "common/base/Cord.h"
+#include "common/time/Duration.h"
 #include <folly/Function.h>
 #include <gtest/gtest_prod.h>
 #include "kvstore/wal/Wal.h"
@@ -18,6 +19,13 @@
 namespace nebula {
 namespace wal {
 
+// A record whose two length fields carry this bit is followed by a
+// CRC32C of all record bytes before the checksum, stored between the
+// payload and the trailing length. Records without the bit have no
+// checksum, so WAL files written before the flag existed still replay
+constexpr int32_t kWalMsgLenCrcFlag = 0x40000000;
+constexpr int32_t kWalMsgLenMask = kWalMsgLenCrcFlag - 1;
+
 struct FileBasedWalPolicy {
     // The life span of the log messages (number of seconds)
     // This is only a hint, the FileBasedWal will try to keep all messages
@@ -94,6 +102,22 @@ public:
     // simultaneously
     bool appendLogs(LogIterator& iter) override;
 
+    // Stage a list of log messages into the in-memory buffer only.
+    // The logs become visible to iterator() immediately, so replication
+    // can start before the logs are persisted. flushPendingLogs() must
+    // be called afterwards to write the staged records to the WAL file.
+    // This method **IS NOT** thread-safe, same as appendLogs()
+    bool appendLogsToBuffer(LogIterator& iter);
+
+    // Write all records staged by appendLogsToBuffer() to the WAL file
+    // This method **IS NOT** thread-safe
+    bool flushPendingLogs();
+
+    // Force an fsync of the current WAL file, no matter whether the
+    // group-sync thresholds are reached
+    // This method **IS NOT** thread-safe, same as the append methods
+    bool sync();
+
     // Rollback to the given ID, all logs after the ID will be discarded
     // This method **IS NOT** thread-safe
     // we **EXPECT** the thread rolling back logs is the same one
@@ -144,6 +168,9 @@ private:
     void closeCurrFile();
     // Prepare a new wal file starting from the given log id
     void prepareNewFile(LogID startLogId);
+    // Keep the rotated file as the spare segment for reuse instead of
+    // unlinking it, only used when FLAGS_wal_prealloc_file is on
+    void recycleWalFile(const char* path);
     // Rollback to logId in given file
     void rollbackInFile(WalFileInfoPtr info, LogID logId);
 
@@ -151,6 +178,20 @@ private:
     // If the last buffer is big enough, create a new one
     BufferPtr getLastBuffer(LogID id, size_t expectedToWrite);
 
+    // Encode one log record in the WAL file format
+    std::string encodeLogRecord(LogID id,
+                                TermID term,
+                                ClusterID cluster,
+                                const std::string& msg);
+
+    // Write one encoded record to the current WAL file,
+    // rolling over to a new file when necessary
+    void writeRecordToFile(LogID id, TermID term, const std::string& rec);
+
+    // Issue an fsync when the group-sync window expired or enough
+    // unsynced bytes piled up, see FLAGS_wal_sync_interval_ms
+    void maybeSync();
+
     // Implementation of appendLog()
     bool appendLogInternal(LogID id,
                            TermID term,
@@ -190,8 +231,17 @@ private:
     // The WalFileInfo corresponding to the currFd_
     WalFileInfoPtr currInfo_;
 
+    // Bytes written to currFd_ since the last fsync, and how long ago
+    // that fsync was. Only touched by the appending thread
+    size_t unsyncedBytes_{0};
+    time::Duration syncDur_;
+
     std::shared_ptr<AtomicLogBuffer> logBuffer_;
 
+    // Records staged by appendLogsToBuffer(), waiting to be written
+    // to the WAL file by flushPendingLogs()
+    std::vector<std::tuple<LogID, TermID, std::string>> pendingRecords_;
+
     PreProcessor preProcessor_;
 
     folly::RWSpinLock rollbackLock_;
@@ -8,6 +8,11 @@
 #include "kvstore/wal/FileBasedWal.h"
 #include "kvstore/wal/WalFileInfo.h"
 #include "kvstore/wal/WalFileIterator.h"
+#include <folly/hash/Checksum.h>
+
+DEFINE_int32(wal_readahead_kb, 256,
+             "Size of the readahead buffer the wal file iterator reads "
+             "through, in kilobytes");
 
 namespace nebula {
 namespace wal {
@@ -82,24 +87,15 @@ WalFileIterator::WalFileIterator(
         while (true) {
             LogID logId;
             // Read the logID
-            int fd = fds_.front();
-            CHECK_EQ(pread(fd,
-                           reinterpret_cast<char*>(&logId),
-                           sizeof(LogID),
-                           currPos_),
-                     static_cast<ssize_t>(sizeof(LogID)));
+            CHECK(read(&logId, sizeof(LogID), currPos_));
             // Read the termID
-            CHECK_EQ(pread(fd,
-                           reinterpret_cast<char*>(&currTerm_),
-                           sizeof(TermID),
-                           currPos_ + sizeof(LogID)),
-                     static_cast<ssize_t>(sizeof(TermID)));
+            CHECK(read(&currTerm_, sizeof(TermID), currPos_ + sizeof(LogID)));
             // Read the log length
-            CHECK_EQ(pread(fd,
-                           reinterpret_cast<char*>(&currMsgLen_),
-                           sizeof(int32_t),
-                           currPos_ + sizeof(LogID) + sizeof(TermID)),
-                     static_cast<ssize_t>(sizeof(int32_t)));
+            CHECK(read(&currMsgLen_,
+                       sizeof(int32_t),
+                       currPos_ + sizeof(LogID) + sizeof(TermID)));
+            currHasCrc_ = currMsgLen_ & kWalMsgLenCrcFlag;
+            currMsgLen_ &= kWalMsgLenMask;
             if (logId == currId_) {
                 break;
             }
@@ -107,12 +103,37 @@ WalFileIterator::WalFileIterator(
                         + sizeof(TermID)
                         + sizeof(int32_t) * 2
                         + currMsgLen_
+                        + (currHasCrc_ ? sizeof(uint32_t) : 0)
                         + sizeof(ClusterID);
         }
     }
 }
 
 
+bool WalFileIterator::read(void* buf, size_t len, int64_t offset) const {
+    DCHECK(!fds_.empty());
+    if (offset < readBufStart_
+            || offset + static_cast<int64_t>(len)
+                > readBufStart_ + static_cast<int64_t>(readBuf_.size())) {
+        // Refill the readahead buffer starting from the requested offset.
+        // The tail of the current file may still be growing, so a short
+        // fill is fine as long as it covers the requested range
+        readBuf_.resize(std::max(len, FLAGS_wal_readahead_kb * 1024UL));
+        auto bytes = pread(fds_.front(), &readBuf_[0], readBuf_.size(), offset);
+        if (bytes < static_cast<ssize_t>(len)) {
+            LOG(ERROR) << "Failed to read " << len << " bytes at offset " << offset
+                       << ", got " << bytes << " (errno: " << errno << "): "
+                       << strerror(errno);
+            return false;
+        }
+        readBuf_.resize(bytes);
+        readBufStart_ = offset;
+    }
+    memcpy(buf, readBuf_.data() + (offset - readBufStart_), len);
+    return true;
+}
+
+
 WalFileIterator::~WalFileIterator() {
     for (auto& fd : fds_) {
         close(fd);
@@ -132,6 +153,9 @@ LogIterator& WalFileIterator::operator++() {
         CHECK_EQ(close(fds_.front()), 0);
         fds_.pop_front();
         idRanges_.pop_front();
+        // The readahead buffer belongs to the closed file
+        readBuf_.clear();
+        readBufStart_ = 0;
 
         if (idRanges_.empty()) {
             // Reached the end of wal files, only happens
@@ -149,6 +173,7 @@ LogIterator& WalFileIterator::operator++() {
                     + sizeof(TermID)
                     + sizeof(int32_t) * 2
                     + currMsgLen_
+                    + (currHasCrc_ ? sizeof(uint32_t) : 0)
                     + sizeof(ClusterID);
     }
 
@@ -158,26 +183,17 @@ LogIterator& WalFileIterator::operator++() {
         return *this;
     } else {
         LogID logId;
-        int fd = fds_.front();
         // Read the logID
-        CHECK_EQ(pread(fd,
-                       reinterpret_cast<char*>(&logId),
-                       sizeof(LogID),
-                       currPos_),
-                 static_cast<ssize_t>(sizeof(LogID))) << "currPos = " << currPos_;
+        CHECK(read(&logId, sizeof(LogID), currPos_)) << "currPos = " << currPos_;
         CHECK_EQ(currId_, logId);
         // Read the termID
-        CHECK_EQ(pread(fd,
-                       reinterpret_cast<char*>(&currTerm_),
-                       sizeof(TermID),
-                       currPos_ + sizeof(LogID)),
-                 static_cast<ssize_t>(sizeof(TermID)));
+        CHECK(read(&currTerm_, sizeof(TermID), currPos_ + sizeof(LogID)));
         // Read the log length
-        CHECK_EQ(pread(fd,
-                       reinterpret_cast<char*>(&currMsgLen_),
-                       sizeof(int32_t),
-                       currPos_ + sizeof(TermID) + sizeof(LogID)),
-                 static_cast<ssize_t>(sizeof(int32_t)));
+        CHECK(read(&currMsgLen_,
+                   sizeof(int32_t),
+                   currPos_ + sizeof(TermID) + sizeof(LogID)));
+        currHasCrc_ = currMsgLen_ & kWalMsgLenCrcFlag;
+        currMsgLen_ &= kWalMsgLenMask;
     }
 
     return *this;
@@ -200,42 +216,48 @@ TermID WalFileIterator::logTerm() const {
 
 
 ClusterID WalFileIterator::logSource() const {
-            // Retrieve from the file
-    DCHECK(!fds_.empty());
+    // Retrieve from the file
     ClusterID cluster = 0;
-    CHECK_EQ(pread(fds_.front(),
-                   &(cluster),
-                   sizeof(ClusterID),
-                   currPos_
-                    + sizeof(LogID)
-                    + sizeof(TermID)
-                    + sizeof(int32_t)),
-             static_cast<ssize_t>(sizeof(ClusterID)))
+    CHECK(read(&cluster,
+               sizeof(ClusterID),
+               currPos_
+                + sizeof(LogID)
+                + sizeof(TermID)
+                + sizeof(int32_t)))
         << "Failed to read. Curr position is " << currPos_
-        << ", expected read length is " << sizeof(ClusterID)
-        << " (errno: " << errno << "): " << strerror(errno);
+        << ", expected read length is " << sizeof(ClusterID);
 
     return cluster;
 }
 
 
 folly::StringPiece WalFileIterator::logMsg() const {
-    // Retrieve from the file
-    DCHECK(!fds_.empty());
+    auto headerLen = sizeof(LogID)
+                     + sizeof(TermID)
+                     + sizeof(int32_t)
+                     + sizeof(ClusterID);
+    if (!currHasCrc_) {
+        // Retrieve from the file
+        currLog_.resize(currMsgLen_);
+        CHECK(read(&currLog_[0], currMsgLen_, currPos_ + headerLen))
+            << "Failed to read. Curr position is " << currPos_
+            << ", expected read length is " << currMsgLen_;
+        return currLog_;
+    }
 
-    currLog_.resize(currMsgLen_);
-    CHECK_EQ(pread(fds_.front(),
-                   &(currLog_[0]),
-                   currMsgLen_,
-                   currPos_
-                    + sizeof(LogID)
-                    + sizeof(TermID)
-                    + sizeof(int32_t)
-                    + sizeof(ClusterID)),
-             static_cast<ssize_t>(currMsgLen_))
+    // Read the header and the payload in one shot, so the stored CRC32C
+    // can be verified over exactly the bytes it was computed on
+    std::string rec(headerLen + currMsgLen_, '\0');
+    uint32_t crc = 0;
+    CHECK(read(&rec[0], rec.size(), currPos_))
         << "Failed to read. Curr position is " << currPos_
-        << ", expected read length is " << currMsgLen_
-        << " (errno: " << errno << "): " << strerror(errno);
+        << ", expected read length is " << rec.size();
+    CHECK(read(&crc, sizeof(uint32_t), currPos_ + rec.size()))
+        << "Failed to read the checksum. Curr position is " << currPos_;
+    CHECK_EQ(folly::crc32c(reinterpret_cast<const uint8_t*>(rec.data()), rec.size()),
+             crc)
+        << "Wal record checksum mismatch on log " << currId_;
+    currLog_ = rec.substr(headerLen);
 
     return currLog_;
 }
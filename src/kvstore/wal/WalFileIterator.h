@@ -40,6 +40,13 @@ public:
 private:
     LogID getFirstIdInNextFile() const;
 
+    // Read `len' bytes at `offset' of the current wal file. The bytes
+    // are served from a large readahead buffer which is refilled with
+    // one pread per FLAGS_wal_readahead_kb, so catching up a follower
+    // streams the wal sequentially instead of issuing several syscalls
+    // per record. Returns false when the file ends before `len' bytes
+    bool read(void* buf, size_t len, int64_t offset) const;
+
 private:
     // Holds the Wal object, so that it will not be destroyed before the iterator
     std::shared_ptr<FileBasedWal> wal_;
@@ -55,7 +62,15 @@ private:
     std::list<int> fds_;
     int64_t currPos_{0};
     int32_t currMsgLen_{0};
+    // Whether the current record carries a trailing CRC32C,
+    // flagged by kWalMsgLenCrcFlag in its length fields
+    bool currHasCrc_{false};
     mutable std::string currLog_;
+
+    // The readahead buffer over the current wal file, holding the bytes
+    // [readBufStart_, readBufStart_ + readBuf_.size())
+    mutable std::string readBuf_;
+    mutable int64_t readBufStart_{0};
 };
 
 }  // namespace wal
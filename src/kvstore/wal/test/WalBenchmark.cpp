@@ -0,0 +1,162 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include "common/fs/FileUtils.h"
+#include "common/fs/TempDir.h"
+#include "common/time/Duration.h"
+#include "kvstore/wal/FileBasedWal.h"
+
+DEFINE_string(wal_bm_path, "", "Directory on the device being profiled; "
+                               "a temp dir under /tmp when empty");
+DEFINE_int32(wal_bm_records, 100000, "Records to append per run");
+DEFINE_int32(wal_bm_record_size, 256, "Payload bytes of a record");
+DEFINE_int32(wal_bm_large_every, 0, "When > 0, every Nth record is a large one, "
+                                    "mimicking a batched write among single ones");
+DEFINE_int32(wal_bm_large_size, 64 * 1024, "Payload bytes of the large records");
+
+DECLARE_int32(wal_sync_interval_ms);
+DECLARE_int32(wal_sync_bytes);
+DECLARE_bool(wal_prealloc_file);
+
+namespace nebula {
+namespace wal {
+
+using nebula::fs::FileUtils;
+
+// One sync-policy preset of the sweep
+struct Profile {
+    const char* name;
+    int32_t syncIntervalMs;
+    int32_t syncBytes;
+    bool prealloc;
+};
+
+// Ordered from least to most durable; the recommendation only considers
+// the ones with a bounded loss window (syncIntervalMs >= 0)
+static const std::vector<Profile> kProfiles = {
+    {"rollover-only",          -1, 0,               false},
+    {"group-sync-100ms",      100, 4 * 1024 * 1024, false},
+    {"group-sync-10ms",        10, 4 * 1024 * 1024, false},
+    {"group-sync-10ms-prealloc", 10, 4 * 1024 * 1024, true},
+    {"sync-every-write",        0, 0,               false},
+};
+
+struct RunResult {
+    double appendMBps;
+    int64_t appendLogsPerSec;
+    int64_t replayLogsPerSec;
+};
+
+RunResult runProfile(const Profile& profile, const std::string& dir) {
+    FLAGS_wal_sync_interval_ms = profile.syncIntervalMs;
+    FLAGS_wal_sync_bytes = profile.syncBytes;
+    FLAGS_wal_prealloc_file = profile.prealloc;
+
+    CHECK(FileUtils::makeDir(dir));
+    FileBasedWalPolicy policy;
+    auto wal = FileBasedWal::getWal(dir,
+                                    "",
+                                    policy,
+                                    [](LogID, TermID, ClusterID, const std::string&) {
+                                        return true;
+                                    });
+
+    const std::string record(FLAGS_wal_bm_record_size, 'r');
+    const std::string largeRecord(FLAGS_wal_bm_large_size, 'R');
+    size_t bytes = 0;
+    time::Duration appendDur;
+    for (int32_t i = 1; i <= FLAGS_wal_bm_records; i++) {
+        const auto& msg = (FLAGS_wal_bm_large_every > 0 && i % FLAGS_wal_bm_large_every == 0)
+                        ? largeRecord : record;
+        CHECK(wal->appendLog(i, 1, 0, msg));
+        bytes += msg.size();
+    }
+    CHECK(wal->sync());
+    auto appendUs = appendDur.elapsedInUSec();
+    auto lastId = wal->lastLogId();
+
+    // Reopen so the replay reads the files back instead of the in-memory
+    // buffers, which is what recovery and a catching-up peer actually do
+    wal.reset();
+    wal = FileBasedWal::getWal(dir,
+                               "",
+                               policy,
+                               [](LogID, TermID, ClusterID, const std::string&) {
+                                   return true;
+                               });
+    CHECK_EQ(lastId, wal->lastLogId());
+
+    time::Duration replayDur;
+    int64_t replayed = 0;
+    size_t replayedBytes = 0;
+    auto iter = wal->iterator(1, lastId);
+    while (iter->valid()) {
+        replayedBytes += iter->logMsg().size();
+        ++(*iter);
+        replayed++;
+    }
+    CHECK_EQ(bytes, replayedBytes);
+    auto replayUs = replayDur.elapsedInUSec();
+    CHECK_EQ(FLAGS_wal_bm_records, replayed);
+
+    RunResult res;
+    res.appendMBps = bytes / 1024.0 / 1024.0 / appendUs * 1000000.0;
+    res.appendLogsPerSec = FLAGS_wal_bm_records * 1000000L / std::max<int64_t>(appendUs, 1);
+    res.replayLogsPerSec = replayed * 1000000L / std::max<int64_t>(replayUs, 1);
+
+    LOG(INFO) << folly::stringPrintf(
+        "%-26s append %8ld logs/s (%7.2f MB/s), replay %8ld logs/s",
+        profile.name, res.appendLogsPerSec, res.appendMBps, res.replayLogsPerSec);
+
+    wal.reset();
+    CHECK(FileUtils::remove(dir.c_str(), true));
+    return res;
+}
+
+int run() {
+    std::unique_ptr<fs::TempDir> tmp;
+    std::string root = FLAGS_wal_bm_path;
+    if (root.empty()) {
+        tmp = std::make_unique<fs::TempDir>("/tmp/walBm.XXXXXX");
+        root = tmp->path();
+        LOG(WARNING) << "No -wal_bm_path given, profiling " << root
+                     << " which is probably not the device you care about";
+    }
+    LOG(INFO) << "Profiling " << root << " with " << FLAGS_wal_bm_records
+              << " records of " << FLAGS_wal_bm_record_size << " bytes";
+
+    const Profile* best = nullptr;
+    RunResult bestRes{0.0, 0, 0};
+    for (const auto& profile : kProfiles) {
+        auto res = runProfile(profile, root + "/" + profile.name);
+        if (profile.syncIntervalMs >= 0 &&
+            (best == nullptr || res.appendLogsPerSec > bestRes.appendLogsPerSec)) {
+            best = &profile;
+            bestRes = res;
+        }
+    }
+
+    CHECK_NOTNULL(best);
+    LOG(INFO) << "Recommended policy for this device: "
+              << "-wal_sync_interval_ms=" << best->syncIntervalMs
+              << " -wal_sync_bytes=" << best->syncBytes
+              << " -wal_prealloc_file=" << (best->prealloc ? "true" : "false")
+              << " (" << best->name << ", " << bestRes.appendLogsPerSec << " logs/s"
+              << "; rollover-only is the no-durability upper bound above)";
+    return 0;
+}
+
+}  // namespace wal
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return nebula::wal::run();
+}
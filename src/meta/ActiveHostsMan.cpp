@@ -6,6 +6,9 @@
 
 #include "meta/ActiveHostsMan.h"
 #include "meta/processors/Common.h"
+#include <folly/Random.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
 
 DEFINE_int32(expired_threshold_sec, 10 * 60,
                      "Hosts will be expired in this time if no heartbeat received");
@@ -13,6 +16,145 @@ DEFINE_int32(expired_threshold_sec, 10 * 60,
 namespace nebula {
 namespace meta {
 
+namespace {
+
+// In-memory mirror of the host rows, so serving getActiveHosts does
+// not deserialize the whole table per call. The view is versioned by
+// an epoch row every heartbeat batch rewrites in the meta KV: the
+// mirror is served only while the stored epoch still matches the one
+// this process wrote last, so a metad that lost leadership (its
+// successor stamps its own epoch) falls back to the scan
+struct HostsView {
+    folly::SharedMutex lock_;
+    // The store the view was seeded from; a view of another store is
+    // never served
+    kvstore::KVStore* source_{nullptr};
+    std::unordered_map<HostAddr, HostInfo> hosts_;
+    // The leader list most recently written per host, used to elide
+    // the rewrite when a heartbeat repeats an unchanged list
+    std::unordered_map<HostAddr, std::string> leaderVals_;
+    // A per-process random stamp plus a counter; together they are the
+    // value of the epoch row this process expects to find
+    int64_t stamp_{static_cast<int64_t>(folly::Random::rand64())};
+    int64_t epoch_{0};
+    std::string epochVal_;
+};
+
+HostsView& hostsView() {
+    static HostsView view;
+    return view;
+}
+
+// Concurrent heartbeats coalesce their KV writes into a single raft
+// append: whoever finds the batcher idle drains it, everyone else
+// just waits for the flush that covers their rows
+struct HeartbeatBatcher {
+    std::mutex lock_;
+    bool flushing_{false};
+    std::vector<kvstore::KV> pending_;
+    std::vector<folly::Promise<kvstore::ResultCode>> waiters_;
+};
+
+HeartbeatBatcher& batcher() {
+    static HeartbeatBatcher b;
+    return b;
+}
+
+// Advance the view epoch and return the value the flush about to
+// happen should store. Flushes are serialized by the batcher, so the
+// stored epoch ends up being the last one handed out
+std::string nextEpochVal() {
+    auto& view = hostsView();
+    folly::SharedMutex::WriteHolder wHolder(view.lock_);
+    view.epoch_++;
+    view.epochVal_ = MetaServiceUtils::hostsViewEpochVal(view.stamp_, view.epoch_);
+    return view.epochVal_;
+}
+
+kvstore::ResultCode batchedPut(kvstore::KVStore* kv, std::vector<kvstore::KV>&& data) {
+    auto& b = batcher();
+    folly::Promise<kvstore::ResultCode> promise;
+    auto future = promise.getFuture();
+    bool flusher = false;
+    {
+        std::lock_guard<std::mutex> g(b.lock_);
+        std::move(data.begin(), data.end(), std::back_inserter(b.pending_));
+        b.waiters_.emplace_back(std::move(promise));
+        if (!b.flushing_) {
+            b.flushing_ = true;
+            flusher = true;
+        }
+    }
+    if (flusher) {
+        while (true) {
+            std::vector<kvstore::KV> batch;
+            std::vector<folly::Promise<kvstore::ResultCode>> waiters;
+            {
+                std::lock_guard<std::mutex> g(b.lock_);
+                if (b.waiters_.empty()) {
+                    b.flushing_ = false;
+                    break;
+                }
+                batch.swap(b.pending_);
+                waiters.swap(b.waiters_);
+            }
+            batch.emplace_back(MetaServiceUtils::hostsViewEpochKey(), nextEpochVal());
+            folly::SharedMutex::WriteHolder wHolder(LockUtils::spaceLock());
+            folly::Baton<true, std::atomic> baton;
+            kvstore::ResultCode ret;
+            kv->asyncMultiPut(kDefaultSpaceId, kDefaultPartId, std::move(batch),
+                                    [&] (kvstore::ResultCode code) {
+                ret = code;
+                baton.post();
+            });
+            baton.wait();
+            for (auto& waiter : waiters) {
+                waiter.setValue(ret);
+            }
+        }
+    }
+    return std::move(future).get();
+}
+
+void applyToView(kvstore::KVStore* kv,
+                 const HostAddr& hostAddr,
+                 const HostInfo& info,
+                 const std::string* leaderVal) {
+    auto& view = hostsView();
+    folly::SharedMutex::WriteHolder wHolder(view.lock_);
+    if (view.source_ != kv) {
+        // Seed the whole table first, so the view does not start out
+        // holding just the hosts that happened to heartbeat early
+        const auto& prefix = MetaServiceUtils::hostPrefix();
+        std::unique_ptr<kvstore::KVIterator> iter;
+        if (kv->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter)
+                != kvstore::ResultCode::SUCCEEDED) {
+            view.source_ = nullptr;
+            return;
+        }
+        view.hosts_.clear();
+        view.leaderVals_.clear();
+        while (iter->valid()) {
+            auto host = MetaServiceUtils::parseHostKey(iter->key());
+            view.hosts_[HostAddr(host.host, host.port)] = HostInfo::decode(iter->val());
+            iter->next();
+        }
+        view.source_ = kv;
+    }
+    view.hosts_[hostAddr] = info;
+    if (leaderVal != nullptr) {
+        view.leaderVals_[hostAddr] = *leaderVal;
+    }
+}
+
+void invalidateView() {
+    auto& view = hostsView();
+    folly::SharedMutex::WriteHolder wHolder(view.lock_);
+    view.source_ = nullptr;
+}
+
+}  // namespace
+
 kvstore::ResultCode ActiveHostsMan::updateHostInfo(kvstore::KVStore* kv,
                                                    const HostAddr& hostAddr,
                                                    const HostInfo& info,
@@ -21,19 +163,34 @@ kvstore::ResultCode ActiveHostsMan::updateHostInfo(kvstore::KVStore* kv,
     std::vector<kvstore::KV> data;
     data.emplace_back(MetaServiceUtils::hostKey(hostAddr.host, hostAddr.port),
                       HostInfo::encodeV2(info));
+    std::string leaderVal;
     if (leaderParts != nullptr) {
-        data.emplace_back(MetaServiceUtils::leaderKey(hostAddr.host, hostAddr.port),
-                          MetaServiceUtils::leaderVal(*leaderParts));
+        leaderVal = MetaServiceUtils::leaderVal(*leaderParts);
+        bool changed = true;
+        {
+            auto& view = hostsView();
+            folly::SharedMutex::ReadHolder rHolder(view.lock_);
+            auto it = view.leaderVals_.find(hostAddr);
+            changed = view.source_ != kv
+                    || it == view.leaderVals_.end()
+                    || it->second != leaderVal;
+        }
+        // Most heartbeats repeat an unchanged leader list; only a real
+        // change (or a cold view, e.g. right after winning leadership)
+        // pays for serializing and writing it again
+        if (changed) {
+            data.emplace_back(MetaServiceUtils::leaderKey(hostAddr.host, hostAddr.port),
+                              leaderVal);
+        }
+    }
+    auto ret = batchedPut(kv, std::move(data));
+    if (ret == kvstore::ResultCode::SUCCEEDED) {
+        applyToView(kv, hostAddr, info, leaderParts != nullptr ? &leaderVal : nullptr);
+    } else {
+        // A failed or redirected write leaves the view cold, so the
+        // next successful heartbeat reseeds and writes in full
+        invalidateView();
     }
-    folly::SharedMutex::WriteHolder wHolder(LockUtils::spaceLock());
-    folly::Baton<true, std::atomic> baton;
-    kvstore::ResultCode ret;
-    kv->asyncMultiPut(kDefaultSpaceId, kDefaultPartId, std::move(data),
-                            [&] (kvstore::ResultCode code) {
-        ret = code;
-        baton.post();
-    });
-    baton.wait();
     return ret;
 }
 
@@ -41,6 +198,29 @@ std::vector<HostAddr> ActiveHostsMan::getActiveHosts(kvstore::KVStore* kv,
                                                      int32_t expiredTTL,
                                                      cpp2::HostRole role) {
     std::vector<HostAddr> hosts;
+    int64_t threshold = (expiredTTL == 0 ? FLAGS_expired_threshold_sec : expiredTTL) * 1000;
+    auto now = time::WallClock::fastNowInMilliSec();
+    {
+        auto& view = hostsView();
+        folly::SharedMutex::ReadHolder rHolder(view.lock_);
+        std::string storedEpoch;
+        if (view.source_ == kv
+                && kv->get(kDefaultSpaceId, kDefaultPartId,
+                           MetaServiceUtils::hostsViewEpochKey(),
+                           &storedEpoch) == kvstore::ResultCode::SUCCEEDED
+                && storedEpoch == view.epochVal_) {
+            for (const auto& entry : view.hosts_) {
+                if (entry.second.role_ == role
+                        && now - entry.second.lastHBTimeInMilliSec_ < threshold) {
+                    hosts.emplace_back(entry.first);
+                }
+            }
+            // Keep the key order the scan below would produce, some
+            // callers treat the list as a stable placement order
+            std::sort(hosts.begin(), hosts.end());
+            return hosts;
+        }
+    }
     const auto& prefix = MetaServiceUtils::hostPrefix();
     std::unique_ptr<kvstore::KVIterator> iter;
     auto ret = kv->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
@@ -48,8 +228,6 @@ std::vector<HostAddr> ActiveHostsMan::getActiveHosts(kvstore::KVStore* kv,
         FLOG_ERROR("getActiveHosts failed(%d)", static_cast<int>(ret));
         return hosts;
     }
-    int64_t threshold = (expiredTTL == 0 ? FLAGS_expired_threshold_sec : expiredTTL) * 1000;
-    auto now = time::WallClock::fastNowInMilliSec();
     while (iter->valid()) {
         auto host = MetaServiceUtils::parseHostKey(iter->key());
         HostInfo info = HostInfo::decodeV2(iter->val());
@@ -70,8 +248,18 @@ bool ActiveHostsMan::isLived(kvstore::KVStore* kv, const HostAddr& host) {
     return std::find(activeHosts.begin(), activeHosts.end(), host) != activeHosts.end();
 }
 
+void ActiveHostsMan::onHostsRemoved(const std::vector<HostAddr>& hosts) {
+    auto& view = hostsView();
+    folly::SharedMutex::WriteHolder wHolder(view.lock_);
+    for (const auto& host : hosts) {
+        view.hosts_.erase(host);
+        view.leaderVals_.erase(host);
+    }
+}
+
 kvstore::ResultCode LastUpdateTimeMan::update(kvstore::KVStore* kv, const int64_t timeInMilliSec) {
     CHECK_NOTNULL(kv);
+    localEpoch_.fetch_add(1, std::memory_order_relaxed);
     std::vector<kvstore::KV> data;
     data.emplace_back(MetaServiceUtils::lastUpdateTimeKey(),
                       MetaServiceUtils::lastUpdateTimeVal(timeInMilliSec));
@@ -99,5 +287,11 @@ int64_t LastUpdateTimeMan::get(kvstore::KVStore* kv) {
     return 0;
 }
 
+int64_t LastUpdateTimeMan::localEpoch() {
+    return localEpoch_.load(std::memory_order_relaxed);
+}
+
+std::atomic<int64_t> LastUpdateTimeMan::localEpoch_{0};
+
 }  // namespace meta
 }  // namespace nebula
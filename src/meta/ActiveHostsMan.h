@@ -118,6 +118,10 @@ public:
 
     static bool isLived(kvstore::KVStore* kv, const HostAddr& host);
 
+    // Drop hosts from the in-memory view after their rows were removed
+    // from the meta KV (see ListHostsProcessor::removeExpiredHosts)
+    static void onHostsRemoved(const std::vector<HostAddr>& hosts);
+
 protected:
     ActiveHostsMan() = default;
 };
@@ -130,8 +134,16 @@ public:
 
     static int64_t get(kvstore::KVStore* kv);
 
+    // Count of updates issued by this process. The stored time has
+    // millisecond resolution, so poll caches pair it with this counter
+    // to tell apart mutations landing in the same millisecond
+    static int64_t localEpoch();
+
 protected:
     LastUpdateTimeMan() = default;
+
+private:
+    static std::atomic<int64_t> localEpoch_;
 };
 
 }  // namespace meta
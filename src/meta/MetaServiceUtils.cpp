@@ -9,6 +9,14 @@
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 #include <thrift/lib/cpp2/protocol/CompactProtocol.h>
 
+DEFINE_int32(meta_list_batch_size, 1024,
+             "How many catalog entries a meta list scan reads per batch "
+             "before the rocksdb iterator is re-seeked");
+DEFINE_bool(meta_serve_reads_on_followers, false,
+            "Let meta followers answer the catalog list requests from their "
+            "own replica. Clients validate what they read against the last "
+            "update time, so a follower answer is at worst briefly stale");
+
 namespace nebula {
 namespace meta {
 
@@ -27,6 +35,7 @@ const std::string kDefaultTable        = "__default__";        // NOLINT
 const std::string kSnapshotsTable      = "__snapshots__";      // NOLINT
 const std::string kLastUpdateTimeTable = "__last_update_time__"; // NOLINT
 const std::string kLeadersTable        = "__leaders__";          // NOLINT
+const std::string kHostsViewEpochTable = "__hosts_view_epoch__"; // NOLINT
 
 const std::string kHostOnline  = "Online";       // NOLINT
 const std::string kHostOffline = "Offline";      // NOLINT
@@ -47,6 +56,21 @@ std::string MetaServiceUtils::lastUpdateTimeVal(const int64_t timeInMilliSec) {
     return val;
 }
 
+std::string MetaServiceUtils::hostsViewEpochKey() {
+    std::string key;
+    key.reserve(kHostsViewEpochTable.size());
+    key.append(kHostsViewEpochTable.data(), kHostsViewEpochTable.size());
+    return key;
+}
+
+std::string MetaServiceUtils::hostsViewEpochVal(int64_t stamp, int64_t epoch) {
+    std::string val;
+    val.reserve(sizeof(int64_t) * 2);
+    val.append(reinterpret_cast<const char*>(&stamp), sizeof(int64_t));
+    val.append(reinterpret_cast<const char*>(&epoch), sizeof(int64_t));
+    return val;
+}
+
 std::string MetaServiceUtils::spaceKey(GraphSpaceID spaceId) {
     std::string key;
     key.reserve(kSpacesTable.size() + sizeof(GraphSpaceID));
@@ -35,6 +35,10 @@ public:
 
     static std::string lastUpdateTimeVal(const int64_t timeInMilliSec);
 
+    static std::string hostsViewEpochKey();
+
+    static std::string hostsViewEpochVal(int64_t stamp, int64_t epoch);
+
     static std::string spaceKey(GraphSpaceID spaceId);
 
     static std::string spaceVal(const cpp2::SpaceProperties &properties);
@@ -0,0 +1,137 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "meta/common/MetaGroupWrite.h"
+#include <folly/synchronization/Baton.h>
+#include "meta/processors/Common.h"
+
+DEFINE_int64(meta_group_write_window_us, 0,
+             "Microseconds the first writer of a group waits for more meta "
+             "writes to park before committing everything parked as one "
+             "multi-put. Bounds the latency a lone write pays and the raft "
+             "commits a maintenance burst costs. 0 commits every write on "
+             "its own");
+DEFINE_int32(meta_group_write_max_batch_kvs, 512,
+             "Key/values parked in a group that make its leader commit "
+             "right away instead of waiting out the window");
+
+namespace nebula {
+namespace meta {
+
+namespace {
+
+struct PendingPut {
+    explicit PendingPut(std::vector<kvstore::KV>* d) : data(d) {}
+
+    std::vector<kvstore::KV>* data;
+    kvstore::ResultCode result{kvstore::ResultCode::SUCCEEDED};
+    bool done{false};
+};
+
+struct GroupState {
+    std::mutex lock;
+    std::condition_variable cond;
+    std::vector<PendingPut*> queue;
+    size_t queuedKvs{0};
+    bool leaderActive{false};
+};
+
+// One group per store: the meta tests run several stores in one
+// process, and their writes must not ride each other's commits
+GroupState& groupState(kvstore::KVStore* kv) {
+    static std::mutex statesLock;
+    static std::unordered_map<kvstore::KVStore*, std::unique_ptr<GroupState>> states;
+    std::lock_guard<std::mutex> g(statesLock);
+    auto& state = states[kv];
+    if (state == nullptr) {
+        state = std::make_unique<GroupState>();
+    }
+    return *state;
+}
+
+kvstore::ResultCode multiPut(kvstore::KVStore* kv, std::vector<kvstore::KV> data) {
+    folly::Baton<true, std::atomic> baton;
+    auto ret = kvstore::ResultCode::SUCCEEDED;
+    kv->asyncMultiPut(kDefaultSpaceId,
+                      kDefaultPartId,
+                      std::move(data),
+                      [&ret, &baton] (kvstore::ResultCode code) {
+                          if (kvstore::ResultCode::SUCCEEDED != code) {
+                              ret = code;
+                              LOG(INFO) << "Put data error on meta server";
+                          }
+                          baton.post();
+                      });
+    baton.wait();
+    return ret;
+}
+
+}  // namespace
+
+kvstore::ResultCode MetaGroupWrite::syncPut(kvstore::KVStore* kv,
+                                            std::vector<kvstore::KV> data) {
+    if (FLAGS_meta_group_write_window_us <= 0) {
+        return multiPut(kv, std::move(data));
+    }
+
+    auto& state = groupState(kv);
+    PendingPut pending(&data);
+    std::unique_lock<std::mutex> guard(state.lock);
+    state.queue.emplace_back(&pending);
+    state.queuedKvs += data.size();
+    while (state.leaderActive) {
+        state.cond.wait(guard, [&state, &pending] {
+            return pending.done || !state.leaderActive;
+        });
+        if (pending.done) {
+            // A leader carried this write in its group
+            return pending.result;
+        }
+    }
+
+    // Lead the group: wait out the window so the writes racing in
+    // behind can park, then commit everything parked in one multi-put
+    state.leaderActive = true;
+    if (state.queuedKvs < static_cast<size_t>(FLAGS_meta_group_write_max_batch_kvs)) {
+        guard.unlock();
+        usleep(FLAGS_meta_group_write_window_us);
+        guard.lock();
+    }
+    auto group = std::move(state.queue);
+    state.queue.clear();
+    state.queuedKvs = 0;
+    guard.unlock();
+
+    std::vector<kvstore::KV> merged;
+    if (group.size() == 1) {
+        merged = std::move(*group[0]->data);
+    } else {
+        size_t total = 0;
+        for (auto* w : group) {
+            total += w->data->size();
+        }
+        merged.reserve(total);
+        for (auto* w : group) {
+            for (auto& kvPair : *w->data) {
+                merged.emplace_back(std::move(kvPair));
+            }
+        }
+    }
+    auto code = multiPut(kv, std::move(merged));
+
+    guard.lock();
+    for (auto* w : group) {
+        w->result = code;
+        w->done = true;
+    }
+    state.leaderActive = false;
+    guard.unlock();
+    state.cond.notify_all();
+    return code;
+}
+
+}  // namespace meta
+}  // namespace nebula
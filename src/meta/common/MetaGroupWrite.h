@@ -0,0 +1,39 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef META_COMMON_METAGROUPWRITE_H_
+#define META_COMMON_METAGROUPWRITE_H_
+
+#include "common/base/Base.h"
+#include "kvstore/KVStore.h"
+
+namespace nebula {
+namespace meta {
+
+/**
+ * The blocking multi-put every meta mutation goes through, with an
+ * optional group commit. Meta records are tiny, so during maintenance
+ * bursts - schema rollouts, user bookkeeping, one balance task state
+ * per transition - metad ends up raft-committing and syncing one record
+ * at a time.
+ *
+ * With --meta_group_write_window_us set, the first writer of a group
+ * waits out the window while the writes racing in behind it park, then
+ * commits everything parked as one multi-put; every parked writer gets
+ * the result of the merged commit. Meta writers hold distinct keys and
+ * block for the result either way, so merging concurrent writes into
+ * one commit is as valid as any order the store could have picked.
+ * */
+class MetaGroupWrite final {
+public:
+    MetaGroupWrite() = delete;
+
+    static kvstore::ResultCode syncPut(kvstore::KVStore* kv, std::vector<kvstore::KV> data);
+};
+
+}  // namespace meta
+}  // namespace nebula
+#endif  // META_COMMON_METAGROUPWRITE_H_
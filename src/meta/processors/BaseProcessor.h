@@ -20,6 +20,7 @@
 #include "kvstore/KVStore.h"
 #include "meta/MetaServiceUtils.h"
 #include "meta/common/MetaCommon.h"
+#include "meta/common/MetaGroupWrite.h"
 #include "meta/processors/Common.h"
 #include "meta/ActiveHostsMan.h"
 
@@ -122,6 +123,20 @@ protected:
 
     StatusOr<std::unique_ptr<kvstore::KVIterator>> doPrefix(const std::string& key);
 
+    /**
+     * Prefix scan delivered in bounded batches of --meta_list_batch_size
+     * entries. The iterator is dropped and the scan re-seeks right behind
+     * the last delivered key between batches, so a huge catalog walk never
+     * pins one rocksdb snapshot for its whole duration. The caller is
+     * expected to hold the catalog lock around the call, which keeps the
+     * batches consistent with each other. With canReadFromFollower the
+     * scan is also answered by a follower replica.
+     * */
+    kvstore::ResultCode doPagedPrefix(const std::string& prefix,
+                                      const std::function<void(folly::StringPiece key,
+                                                               folly::StringPiece val)>& visitor,
+                                      bool canReadFromFollower = false);
+
     /**
      * General get function.
      * */
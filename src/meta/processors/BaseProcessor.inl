@@ -6,6 +6,9 @@
 
 #include "meta/processors/BaseProcessor.h"
 
+DECLARE_int32(meta_list_batch_size);
+DECLARE_bool(meta_serve_reads_on_followers);
+
 namespace nebula {
 namespace meta {
 
@@ -36,6 +39,42 @@ BaseProcessor<RESP>::doPrefix(const std::string& key) {
 }
 
 
+template<typename RESP>
+kvstore::ResultCode
+BaseProcessor<RESP>::doPagedPrefix(const std::string& prefix,
+                                   const std::function<void(folly::StringPiece,
+                                                            folly::StringPiece)>& visitor,
+                                   bool canReadFromFollower) {
+    CHECK_GT(FLAGS_meta_list_batch_size, 0);
+    std::string start = prefix;
+    while (true) {
+        std::unique_ptr<kvstore::KVIterator> iter;
+        auto code = kvstore_->rangeWithPrefix(kDefaultSpaceId,
+                                              kDefaultPartId,
+                                              start,
+                                              prefix,
+                                              &iter,
+                                              canReadFromFollower);
+        if (code != kvstore::ResultCode::SUCCEEDED) {
+            return code;
+        }
+        int32_t count = 0;
+        std::string lastKey;
+        while (iter->valid() && count < FLAGS_meta_list_batch_size) {
+            visitor(iter->key(), iter->val());
+            lastKey = iter->key().str();
+            count++;
+            iter->next();
+        }
+        if (!iter->valid()) {
+            return kvstore::ResultCode::SUCCEEDED;
+        }
+        // More entries left, continue right behind the last delivered key
+        start = lastKey.append(1, '\0');
+    }
+}
+
+
 template<typename RESP>
 StatusOr<std::string> BaseProcessor<RESP>::doGet(const std::string& key) {
     std::string value;
@@ -311,37 +350,12 @@ bool BaseProcessor<RESP>::checkPassword(const std::string& account, const std::s
 
 template<typename RESP>
 kvstore::ResultCode BaseProcessor<RESP>::doSyncPut(std::vector<kvstore::KV> data) {
-    folly::Baton<true, std::atomic> baton;
-    auto ret = kvstore::ResultCode::SUCCEEDED;
-    kvstore_->asyncMultiPut(kDefaultSpaceId,
-                            kDefaultPartId,
-                            std::move(data),
-                            [&ret, &baton] (kvstore::ResultCode code) {
-                                if (kvstore::ResultCode::SUCCEEDED != code) {
-                                    ret = code;
-                                    LOG(INFO) << "Put data error on meta server";
-                                }
-                                baton.post();
-                            });
-    baton.wait();
-    return ret;
+    return MetaGroupWrite::syncPut(kvstore_, std::move(data));
 }
 
 template<typename RESP>
 void BaseProcessor<RESP>::doSyncPutAndUpdate(std::vector<kvstore::KV> data) {
-    folly::Baton<true, std::atomic> baton;
-    auto ret = kvstore::ResultCode::SUCCEEDED;
-    kvstore_->asyncMultiPut(kDefaultSpaceId,
-                            kDefaultPartId,
-                            std::move(data),
-                            [&ret, &baton] (kvstore::ResultCode code) {
-        if (kvstore::ResultCode::SUCCEEDED != code) {
-            ret = code;
-            LOG(INFO) << "Put data error on meta server";
-        }
-        baton.post();
-    });
-    baton.wait();
+    auto ret = MetaGroupWrite::syncPut(kvstore_, std::move(data));
     if (ret != kvstore::ResultCode::SUCCEEDED) {
         this->handleErrorCode(MetaCommon::to(ret));
         this->onFinished();
@@ -40,6 +40,39 @@ GENERATE_LOCK(snapshot);
 #undef GENERATE_LOCK
 };
 
+// Memo for poll-style read RPCs, validated against the last-update
+// time every meta mutation bumps: an entry is served only while its
+// version still matches, so the prefix-scan path is taken just for the
+// first read after a change (and for bootstrap, before any mutation
+// happened). MetaClient caches its answers off the same version, so
+// serving a matching entry adds no staleness the clients do not
+// already accept
+template<typename VAL>
+class VersionedResponseCache {
+public:
+    // The version pairs the stored last-update time with the local
+    // update epoch (see LastUpdateTimeMan::localEpoch)
+    using Version = std::pair<int64_t, int64_t>;
+
+    bool get(int64_t key, const Version& version, VAL* value) {
+        folly::SharedMutex::ReadHolder rHolder(lock_);
+        auto it = entries_.find(key);
+        if (it == entries_.end() || it->second.first != version) {
+            return false;
+        }
+        *value = it->second.second;
+        return true;
+    }
+
+    void put(int64_t key, const Version& version, VAL value) {
+        folly::SharedMutex::WriteHolder wHolder(lock_);
+        entries_[key] = std::make_pair(version, std::move(value));
+    }
+
+private:
+    folly::SharedMutex lock_;
+    std::unordered_map<int64_t, std::pair<Version, VAL>> entries_;
+};
 
 }  // namespace meta
 }  // namespace nebula
@@ -11,6 +11,10 @@
 #include "kvstore/Part.h"
 
 DEFINE_int32(max_retry_times_admin_op, 30, "max retry times for admin request!");
+DEFINE_int32(admin_hedge_delay_ms, 0,
+             "Send the same admin request to the next peer as well when the "
+             "current one has not answered within this many milliseconds, the "
+             "first answer wins. 0 means no hedging");
 
 namespace nebula {
 namespace meta {
@@ -348,17 +352,68 @@ void AdminClient::getResponse(
                          int32_t retry,
                          folly::Promise<Status> pro,
                          int32_t retryLimit) {
+    auto state = std::make_shared<HedgeState>(std::move(pro));
+    if (FLAGS_admin_hedge_delay_ms > 0 && hosts.size() > 1) {
+        // Launch the same request against the next peer when the current
+        // one is slow to answer, whichever finishes first fulfills the
+        // promise. A replica stuck in compaction or swap no longer
+        // dictates the latency of the whole operation
+        auto* evb = ioThreadPool_->getEventBase();
+        auto hedgeIndex = (index + 1) % hosts.size();
+        evb->runInEventBaseThread([this, evb, hosts, hedgeIndex, req, remoteFunc, retry,
+                                   state, retryLimit] () {
+            evb->runAfterDelay([this, hosts, hedgeIndex, req, remoteFunc, retry,
+                                state, retryLimit] () mutable {
+                if (state->done.load()) {
+                    return;
+                }
+                LOG(INFO) << "Slow admin response, hedge the request to " << hosts[hedgeIndex];
+                getResponse(std::move(hosts),
+                            hedgeIndex,
+                            std::move(req),
+                            std::move(remoteFunc),
+                            retry,
+                            state,
+                            retryLimit);
+            }, FLAGS_admin_hedge_delay_ms);
+        });
+    }
+    getResponse(std::move(hosts),
+                index,
+                std::move(req),
+                std::move(remoteFunc),
+                retry,
+                std::move(state),
+                retryLimit);
+}
+
+template<typename Request, typename RemoteFunc>
+void AdminClient::getResponse(
+                         std::vector<HostAddr> hosts,
+                         int32_t index,
+                         Request req,
+                         RemoteFunc remoteFunc,
+                         int32_t retry,
+                         std::shared_ptr<HedgeState> state,
+                         int32_t retryLimit) {
     auto* evb = ioThreadPool_->getEventBase();
     CHECK_GE(index, 0);
     CHECK_LT(index, hosts.size());
     folly::via(evb, [evb, hosts = std::move(hosts), index, req = std::move(req),
-                     remoteFunc = std::move(remoteFunc), retry, pro = std::move(pro),
+                     remoteFunc = std::move(remoteFunc), retry, state = std::move(state),
                      retryLimit, this] () mutable {
+        if (state->done.load()) {
+            // The other attempt has already answered
+            return;
+        }
         auto client = clientsMan_->client(hosts[index], evb);
         remoteFunc(client, req).via(evb)
-            .then([p = std::move(pro), hosts = std::move(hosts), index, req = std::move(req),
+            .then([state = std::move(state), hosts = std::move(hosts), index, req = std::move(req),
                    remoteFunc = std::move(remoteFunc), retry, retryLimit,
                    this] (folly::Try<storage::cpp2::AdminExecResp>&& t) mutable {
+            if (state->done.load()) {
+                return;
+            }
             // exception occurred during RPC
             if (t.hasException()) {
                 if (retry < retryLimit) {
@@ -371,17 +426,18 @@ void AdminClient::getResponse(
                                 std::move(req),
                                 remoteFunc,
                                 retry + 1,
-                                std::move(p),
+                                std::move(state),
                                 retryLimit);
                     return;
                 }
-                p.setValue(Status::Error(folly::stringPrintf("RPC failure in AdminClient: %s",
-                                                             t.exception().what().c_str())));
+                state->setValue(Status::Error(folly::stringPrintf(
+                                                 "RPC failure in AdminClient: %s",
+                                                 t.exception().what().c_str())));
                 return;
             }
             auto&& result = std::move(t).value().get_result();
             if (result.get_failed_parts().empty()) {
-                p.setValue(Status::OK());
+                state->setValue(Status::OK());
                 return;
             }
             auto resp = result.get_failed_parts().front();
@@ -404,7 +460,7 @@ void AdminClient::getResponse(
                                     std::move(req),
                                     std::move(remoteFunc),
                                     retry + 1,
-                                    std::move(p),
+                                    std::move(state),
                                     retryLimit);
                             return;
                         }
@@ -433,11 +489,11 @@ void AdminClient::getResponse(
                                     std::move(req),
                                     std::move(remoteFunc),
                                     retry + 1,
-                                    std::move(p),
+                                    std::move(state),
                                     retryLimit);
                         return;
                     }
-                    p.setValue(Status::Error("Leader changed!"));
+                    state->setValue(Status::Error("Leader changed!"));
                     return;
                 }
                 default: {
@@ -452,12 +508,12 @@ void AdminClient::getResponse(
                                     std::move(req),
                                     std::move(remoteFunc),
                                     retry + 1,
-                                    std::move(p),
+                                    std::move(state),
                                     retryLimit);
                         return;
                     }
-                    p.setValue(Status::Error("Unknown code %d",
-                                             static_cast<int32_t>(resp.get_code())));
+                    state->setValue(Status::Error("Unknown code %d",
+                                                  static_cast<int32_t>(resp.get_code())));
                     return;
                 }
             }
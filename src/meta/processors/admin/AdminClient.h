@@ -147,6 +147,21 @@ private:
                                       RemoteFunc remoteFunc,
                                       RespGenerator respGen);
 
+    // Shared by the primary attempt and its hedged duplicate, only the
+    // first result is delivered and late answers are dropped
+    struct HedgeState {
+        explicit HedgeState(folly::Promise<Status> pro) : promise(std::move(pro)) {}
+
+        void setValue(Status st) {
+            if (!done.exchange(true)) {
+                promise.setValue(std::move(st));
+            }
+        }
+
+        folly::Promise<Status> promise;
+        std::atomic<bool> done{false};
+    };
+
     template<typename Request, typename RemoteFunc>
     void getResponse(std::vector<HostAddr> hosts,
                      int32_t index,
@@ -156,6 +171,15 @@ private:
                      folly::Promise<Status> pro,
                      int32_t retryLimit);
 
+    template<typename Request, typename RemoteFunc>
+    void getResponse(std::vector<HostAddr> hosts,
+                     int32_t index,
+                     Request req,
+                     RemoteFunc remoteFunc,
+                     int32_t retry,
+                     std::shared_ptr<HedgeState> state,
+                     int32_t retryLimit);
+
     void getLeaderDist(const HostAddr& host,
                        folly::Promise<StatusOr<storage::cpp2::GetLeaderPartsResp>>&& pro,
                        int32_t retry,
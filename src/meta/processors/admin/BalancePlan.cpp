@@ -5,12 +5,14 @@
  */
 
 #include "meta/processors/admin/BalancePlan.h"
-#include <folly/synchronization/Baton.h>
 #include "meta/common/MetaCommon.h"
+#include "meta/common/MetaGroupWrite.h"
 #include "meta/processors/Common.h"
 #include "meta/ActiveHostsMan.h"
 
 DEFINE_uint32(task_concurrency, 10, "The tasks number could be invoked simultaneously");
+DEFINE_uint32(balance_host_concurrency, 2,
+              "Max balance tasks moving data off or onto one host at the same time");
 
 namespace nebula {
 namespace meta {
@@ -24,99 +26,109 @@ void BalancePlan::dispatchTasks() {
     for (auto& task : tasks_) {
         partTasks[std::make_pair(task.spaceId_, task.partId_)].emplace_back(index++);
     }
-    buckets_.resize(std::min(partTasks.size(), (size_t)FLAGS_task_concurrency));
+    partQueues_.clear();
+    partQueues_.reserve(partTasks.size());
     for (auto it = partTasks.begin(); it != partTasks.end(); it++) {
-        size_t minNum = tasks_.size();
-        int32_t i = 0, minIndex = 0;
-        for (auto& bucket : buckets_) {
-            if (bucket.size() < minNum) {
-                minNum = bucket.size();
-                minIndex = i;
-            }
-            i++;
-        }
-        for (auto taskIndex : it->second) {
-            buckets_[minIndex].emplace_back(taskIndex);
-        }
+        partQueues_.emplace_back(std::move(it->second));
     }
+    queueHead_.assign(partQueues_.size(), 0);
+    queueRunning_.assign(partQueues_.size(), false);
 }
 
 void BalancePlan::invoke() {
     status_ = Status::IN_PROGRESS;
     dispatchTasks();
-    for (size_t i = 0; i < buckets_.size(); i++) {
-        for (size_t j = 0; j < buckets_[i].size(); j++) {
-            auto taskIndex = buckets_[i][j];
-            tasks_[taskIndex].onFinished_ = [this, i, j]() {
-                bool finished = false;
-                bool stopped = false;
-                {
-                    std::lock_guard<std::mutex> lg(lock_);
-                    finishedTaskNum_++;
-                    VLOG(1) << "Balance " << id_ << " has completed "
-                            << finishedTaskNum_ << " task";
-                    if (finishedTaskNum_ == tasks_.size()) {
-                        finished = true;
-                        if (status_ == Status::IN_PROGRESS) {
-                            status_ = Status::SUCCEEDED;
-                            LOG(INFO) << "Balance " << id_ << " succeeded!";
-                        }
-                    }
-                    stopped = stopped_;
-                }
-                if (finished) {
-                    CHECK_EQ(j, this->buckets_[i].size() - 1);
-                    saveInStore(true);
-                    onFinished_();
-                } else if (j + 1 < this->buckets_[i].size()) {
-                    auto& task = this->tasks_[this->buckets_[i][j + 1]];
-                    if (stopped) {
-                        task.ret_ = BalanceTask::Result::INVALID;
-                    }
-                    task.invoke();
-                }
-            };  // onFinished
-            tasks_[taskIndex].onError_ = [this, i, j, taskIndex]() {
-                bool finished = false;
-                bool stopped = false;
-                {
-                    std::lock_guard<std::mutex> lg(lock_);
-                    finishedTaskNum_++;
-                    VLOG(1) << "Balance " << id_ << " has completed "
-                            << finishedTaskNum_ << " task";
-                    status_ = Status::FAILED;
-                    if (finishedTaskNum_ == tasks_.size()) {
-                        finished = true;
-                        LOG(INFO) << "Balance " << id_ << " failed!";
-                    }
-                    stopped = stopped_;
-                }
-                if (finished) {
-                    CHECK_EQ(j, this->buckets_[i].size() - 1);
-                    saveInStore(true);
-                    onFinished_();
-                } else if (j + 1 < this->buckets_[i].size()) {
-                    auto& task = this->tasks_[this->buckets_[i][j + 1]];
-                    if (tasks_[taskIndex].spaceId_ == task.spaceId_
-                            && tasks_[taskIndex].partId_ == task.partId_) {
-                        LOG(INFO) << "Skip the task for the same partId " << task.partId_;
-                        task.ret_ = BalanceTask::Result::FAILED;
-                    }
-                    if (stopped) {
-                        task.ret_ = BalanceTask::Result::INVALID;
-                    }
-                    task.invoke();
-                }
-            };  // onError
-        }  // for (auto j = 0; j < buckets_[i].size(); j++)
-    }  // for (auto i = 0; i < buckets_.size(); i++)
-
+    for (size_t i = 0; i < partQueues_.size(); i++) {
+        for (size_t j = 0; j < partQueues_[i].size(); j++) {
+            auto taskIndex = partQueues_[i][j];
+            tasks_[taskIndex].onFinished_ = [this, i, taskIndex]() {
+                onTaskDone(i, taskIndex, true);
+            };
+            tasks_[taskIndex].onError_ = [this, i, taskIndex]() {
+                onTaskDone(i, taskIndex, false);
+            };
+        }
+    }
     saveInStore(true);
-    for (auto& bucket : buckets_) {
-        if (!bucket.empty()) {
-            tasks_[bucket[0]].invoke();
+    scheduleMoreTasks();
+}
+
+void BalancePlan::scheduleMoreTasks() {
+    auto hostCap = std::max(1u, FLAGS_balance_host_concurrency);
+    std::vector<int32_t> toRun;
+    {
+        std::lock_guard<std::mutex> lg(lock_);
+        for (size_t i = 0; i < partQueues_.size(); i++) {
+            if (runningTaskNum_ >= FLAGS_task_concurrency) {
+                break;
+            }
+            if (queueRunning_[i] || queueHead_[i] >= partQueues_[i].size()) {
+                continue;
+            }
+            auto taskIndex = partQueues_[i][queueHead_[i]];
+            auto& task = tasks_[taskIndex];
+            if (stopped_ && task.ret_ == BalanceTask::Result::IN_PROGRESS) {
+                task.ret_ = BalanceTask::Result::INVALID;
+            }
+            // Tasks already marked failed or invalid finish without moving
+            // any data, so only live ones count against the host caps
+            if (task.ret_ == BalanceTask::Result::IN_PROGRESS
+                    && (srcRunning_[task.src_] >= hostCap
+                        || dstRunning_[task.dst_] >= hostCap)) {
+                continue;
+            }
+            queueHead_[i]++;
+            queueRunning_[i] = true;
+            runningTaskNum_++;
+            srcRunning_[task.src_]++;
+            dstRunning_[task.dst_]++;
+            toRun.emplace_back(taskIndex);
         }
     }
+    for (auto taskIndex : toRun) {
+        tasks_[taskIndex].invoke();
+    }
+}
+
+void BalancePlan::onTaskDone(size_t queue, int32_t taskIndex, bool succeeded) {
+    bool finished = false;
+    {
+        std::lock_guard<std::mutex> lg(lock_);
+        finishedTaskNum_++;
+        runningTaskNum_--;
+        queueRunning_[queue] = false;
+        auto& task = tasks_[taskIndex];
+        srcRunning_[task.src_]--;
+        dstRunning_[task.dst_]--;
+        LOG(INFO) << "Balance " << id_ << " completed " << finishedTaskNum_
+                  << "/" << tasks_.size() << " tasks, " << runningTaskNum_
+                  << " still in flight";
+        if (!succeeded) {
+            status_ = Status::FAILED;
+            // The partition must not move on after a failed step, so fail
+            // its next queued task; it will cascade through the queue
+            if (queueHead_[queue] < partQueues_[queue].size()) {
+                auto& next = tasks_[partQueues_[queue][queueHead_[queue]]];
+                LOG(INFO) << "Skip the task for the same partId " << next.partId_;
+                next.ret_ = BalanceTask::Result::FAILED;
+            }
+        }
+        if (finishedTaskNum_ == tasks_.size()) {
+            finished = true;
+            if (status_ == Status::IN_PROGRESS) {
+                status_ = Status::SUCCEEDED;
+                LOG(INFO) << "Balance " << id_ << " succeeded!";
+            } else if (status_ == Status::FAILED) {
+                LOG(INFO) << "Balance " << id_ << " failed!";
+            }
+        }
+    }
+    if (finished) {
+        saveInStore(true);
+        onFinished_();
+        return;
+    }
+    scheduleMoreTasks();
 }
 
 cpp2::ErrorCode BalancePlan::saveInStore(bool onlyPlan) {
@@ -128,19 +140,10 @@ cpp2::ErrorCode BalancePlan::saveInStore(bool onlyPlan) {
                 data.emplace_back(task.taskKey(), task.taskVal());
             }
         }
-        folly::Baton<true, std::atomic> baton;
-        auto ret = kvstore::ResultCode::SUCCEEDED;
-        kv_->asyncMultiPut(kDefaultSpaceId,
-                           kDefaultPartId,
-                           std::move(data),
-                           [&baton, &ret] (kvstore::ResultCode code) {
-            if (kvstore::ResultCode::SUCCEEDED != code) {
-                ret = code;
-                LOG(ERROR) << "Can't write the kvstore, ret = " << static_cast<int32_t>(code);
-            }
-            baton.post();
-        });
-        baton.wait();
+        auto ret = MetaGroupWrite::syncPut(kv_, std::move(data));
+        if (kvstore::ResultCode::SUCCEEDED != ret) {
+            LOG(ERROR) << "Can't write the kvstore, ret = " << static_cast<int32_t>(ret);
+        }
         return MetaCommon::to(ret);
     }
     return cpp2::ErrorCode::SUCCEEDED;
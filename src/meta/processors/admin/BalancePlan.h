@@ -94,6 +94,12 @@ private:
 
     void dispatchTasks();
 
+    // Start as many pending tasks as the global and per-host caps
+    // allow. Called once after dispatch and again whenever a task ends
+    void scheduleMoreTasks();
+
+    void onTaskDone(size_t queue, int32_t taskIndex, bool succeeded);
+
     static const std::string& prefix();
 
     static BalanceID id(const folly::StringPiece& rawKey);
@@ -111,9 +117,19 @@ private:
     Status status_ = Status::NOT_START;
     bool stopped_ = false;
 
-    // List of task index in tasks_;
-    using Bucket = std::vector<int32_t>;
-    std::vector<Bucket> buckets_;
+    // Task indices grouped per (space, part). Tasks of one partition
+    // run strictly in order; the scheduler interleaves across queues
+    // subject to the global and per-host concurrency caps
+    using PartQueue = std::vector<int32_t>;
+    std::vector<PartQueue> partQueues_;
+    // Next unscheduled position and in-flight marker per queue
+    std::vector<size_t> queueHead_;
+    std::vector<bool> queueRunning_;
+    size_t runningTaskNum_ = 0;
+    // In-flight tasks per source and per target host (see
+    // --balance_host_concurrency)
+    std::unordered_map<HostAddr, uint32_t> srcRunning_;
+    std::unordered_map<HostAddr, uint32_t> dstRunning_;
 };
 
 }  // namespace meta
@@ -5,7 +5,7 @@
  */
 
 #include "meta/processors/admin/BalanceTask.h"
-#include <folly/synchronization/Baton.h>
+#include "meta/common/MetaGroupWrite.h"
 #include "meta/processors/Common.h"
 
 namespace nebula {
@@ -224,21 +224,14 @@ bool BalanceTask::saveInStore() {
     if (kv_) {
         std::vector<kvstore::KV> data;
         data.emplace_back(taskKey(), taskVal());
-        folly::Baton<true, std::atomic> baton;
-        bool ret = false;
-        kv_->asyncMultiPut(kDefaultSpaceId,
-                           kDefaultPartId,
-                           std::move(data),
-                           [this, &ret, &baton] (kvstore::ResultCode code) {
-            if (kvstore::ResultCode::SUCCEEDED == code) {
-                ret = true;
-            } else {
-                LOG(INFO) << taskIdStr_ << "Can't persist task!";
-            }
-            baton.post();
-        });
-        baton.wait();
-        return ret;
+        // Every task transition writes one record; the group write lets
+        // the transitions of concurrently running tasks share a commit
+        auto code = MetaGroupWrite::syncPut(kv_, std::move(data));
+        if (code != kvstore::ResultCode::SUCCEEDED) {
+            LOG(INFO) << taskIdStr_ << "Can't persist task!";
+            return false;
+        }
+        return true;
     }
     return true;
 }
@@ -17,9 +17,40 @@
 DEFINE_double(leader_balance_deviation, 0.05, "after leader balance, leader count should in range "
                                               "[avg * (1 - deviation), avg * (1 + deviation)]");
 
+DEFINE_int32(auto_leader_balance_interval_secs, 0,
+             "How often the meta leader checks the leader distribution and "
+             "rebalances it through the admin transLeader path. 0 keeps "
+             "leader balance manual");
+
+DEFINE_int32(leader_balance_hysteresis_rounds, 3,
+             "The leader distribution must stay unbalanced for this many "
+             "consecutive checks before an automatic leader balance starts");
+
 namespace nebula {
 namespace meta {
 
+namespace {
+
+// The custom KV segment operators feed per-part request rates through
+const char kPartLoadSegment[] = "part_load";
+
+double partLoadOf(const std::unordered_map<PartitionID, double>& partLoad,
+                  PartitionID partId) {
+    auto it = partLoad.find(partId);
+    return it == partLoad.end() ? 1.0 : it->second;
+}
+
+double loadOfParts(const std::vector<PartitionID>& parts,
+                   const std::unordered_map<PartitionID, double>& partLoad) {
+    double load = 0.0;
+    for (auto partId : parts) {
+        load += partLoadOf(partLoad, partId);
+    }
+    return load;
+}
+
+}  // namespace
+
 ErrorOr<cpp2::ErrorCode, BalanceID> Balancer::balance(std::unordered_set<HostAddr> hostDel) {
     std::lock_guard<std::mutex> lg(lock_);
     if (!running_) {
@@ -481,7 +512,6 @@ Balancer::buildLeaderBalancePlan(HostLeaderMap* hostLeaderMap, GraphSpaceID spac
                                  LeaderBalancePlan& plan, bool useDeviation) {
     std::unordered_map<PartitionID, std::vector<HostAddr>> peersMap;
     std::unordered_map<HostAddr, std::vector<PartitionID>> leaderHostParts;
-    size_t leaderParts = 0;
     {
         // store peers of all paritions in peerMap
         folly::SharedMutex::ReadHolder rHolder(LockUtils::spaceLock());
@@ -498,7 +528,6 @@ Balancer::buildLeaderBalancePlan(HostLeaderMap* hostLeaderMap, GraphSpaceID spac
             memcpy(&partId, key.data() + prefix.size(), sizeof(PartitionID));
             auto peers = MetaServiceUtils::parsePartVal(iter->val());
             peersMap[partId] = std::move(peers);
-            ++leaderParts;
             iter->next();
         }
     }
@@ -521,14 +550,21 @@ Balancer::buildLeaderBalancePlan(HostLeaderMap* hostLeaderMap, GraphSpaceID spac
         return leaderHostParts;
     }
 
-    size_t avgLoad = leaderParts / activeHosts.size();
-    size_t minLoad = avgLoad;
-    size_t maxLoad = avgLoad + 1;
+    // Each part weighs its reported request rate, so hot parts spread
+    // out instead of piling an equal count of them on one host. Without
+    // any feed every part weighs 1 and the plan equalizes leader counts
+    auto partLoad = partLoads(spaceId);
+    double totalLoad = 0.0;
+    for (const auto& partEntry : peersMap) {
+        totalLoad += partLoadOf(partLoad, partEntry.first);
+    }
+
+    double avgLoad = totalLoad / activeHosts.size();
+    double minLoad = std::floor(avgLoad);
+    double maxLoad = minLoad + 1;
     if (useDeviation) {
-        minLoad = std::ceil(static_cast<double> (leaderParts) / activeHosts.size() *
-                            (1 - FLAGS_leader_balance_deviation));
-        maxLoad = std::floor(static_cast<double> (leaderParts) / activeHosts.size() *
-                            (1 + FLAGS_leader_balance_deviation));
+        minLoad = std::ceil(avgLoad * (1 - FLAGS_leader_balance_deviation));
+        maxLoad = std::floor(avgLoad * (1 + FLAGS_leader_balance_deviation));
     }
     LOG(INFO) << "Build leader balance plan, expected min load: " << minLoad
               << ", max load: " << maxLoad;
@@ -538,18 +574,19 @@ Balancer::buildLeaderBalancePlan(HostLeaderMap* hostLeaderMap, GraphSpaceID spac
         int32_t taskCount = 0;
 
         for (auto& hostEntry : leaderHostParts) {
-            if (minLoad <= hostEntry.second.size() && hostEntry.second.size() <= maxLoad) {
+            auto hostLoad = loadOfParts(hostEntry.second, partLoad);
+            if (minLoad <= hostLoad && hostLoad <= maxLoad) {
                 continue;
             }
             hasUnbalancedHost = true;
-            if (hostEntry.second.size() < minLoad) {
+            if (hostLoad < minLoad) {
                 // need to acquire leader from other hosts
                 taskCount += acquireLeaders(allHostParts, leaderHostParts, peersMap, activeHosts,
-                                            hostEntry.first, minLoad, plan, spaceId);
+                                            hostEntry.first, minLoad, partLoad, plan, spaceId);
             } else {
                 // need to transfer leader to other hosts
                 taskCount += giveupLeaders(leaderHostParts, peersMap, activeHosts,
-                                           hostEntry.first, maxLoad, plan, spaceId);
+                                           hostEntry.first, maxLoad, partLoad, plan, spaceId);
             }
         }
 
@@ -567,7 +604,8 @@ int32_t Balancer::acquireLeaders(
         std::unordered_map<PartitionID, std::vector<HostAddr>>& peersMap,
         std::unordered_set<HostAddr>& activeHosts,
         HostAddr host,
-        size_t minLoad,
+        double minLoad,
+        const std::unordered_map<PartitionID, double>& partLoad,
         LeaderBalancePlan& plan,
         GraphSpaceID spaceId) {
     // host will loop for the partition which is not leader, and try to acuire the leader
@@ -577,7 +615,9 @@ int32_t Balancer::acquireLeaders(
                         leaderHostParts[host].begin(), leaderHostParts[host].end(),
                         std::back_inserter(diff));
     auto& hostLeaders = leaderHostParts[host];
+    auto hostLoad = loadOfParts(hostLeaders, partLoad);
     for (const auto& partId : diff) {
+        auto weight = partLoadOf(partLoad, partId);
         // find the leader of partId
         auto peers = peersMap[partId];
         for (const auto& peer : peers) {
@@ -588,9 +628,10 @@ int32_t Balancer::acquireLeaders(
             auto& peerLeaders = leaderHostParts[peer];
             auto it = std::find(peerLeaders.begin(), peerLeaders.end(), partId);
             if (it != peerLeaders.end()) {
-                if (minLoad < peerLeaders.size()) {
+                if (loadOfParts(peerLeaders, partLoad) - weight >= minLoad) {
                     peerLeaders.erase(it);
                     hostLeaders.emplace_back(partId);
+                    hostLoad += weight;
                     plan.emplace_back(spaceId, partId, peer, host);
                     LOG(INFO) << "plan trans leader: " << spaceId << " " << partId << " from "
                               << peer.host
@@ -602,8 +643,8 @@ int32_t Balancer::acquireLeaders(
                 }
             }
         }
-        // if host has enough leader, just return
-        if (minLoad <= hostLeaders.size()) {
+        // if host has enough leader load, just return
+        if (minLoad <= hostLoad) {
             break;
         }
     }
@@ -615,15 +656,18 @@ int32_t Balancer::giveupLeaders(
         std::unordered_map<PartitionID, std::vector<HostAddr>>& peersMap,
         std::unordered_set<HostAddr>& activeHosts,
         HostAddr host,
-        size_t maxLoad,
+        double maxLoad,
+        const std::unordered_map<PartitionID, double>& partLoad,
         LeaderBalancePlan& plan,
         GraphSpaceID spaceId) {
     int taskCount = 0;
     auto& hostLeaders = leaderHostParts[host];
+    auto hostLoad = loadOfParts(hostLeaders, partLoad);
     // host will try to transfer the extra leaders to other peers
     for (auto it = hostLeaders.begin(); it != hostLeaders.end(); ) {
         // find the leader of partId
         auto partId = *it;
+        auto weight = partLoadOf(partLoad, partId);
         auto peers = peersMap[partId];
         bool transfered = false;
         for (const auto& peer : peers) {
@@ -632,9 +676,10 @@ int32_t Balancer::giveupLeaders(
             }
             // If peer can accept this partition leader, than host will transfer to the peer
             auto& peerLeaders = leaderHostParts[peer];
-            if (peerLeaders.size() < maxLoad) {
+            if (loadOfParts(peerLeaders, partLoad) + weight <= maxLoad) {
                 it = hostLeaders.erase(it);
                 peerLeaders.emplace_back(partId);
+                hostLoad -= weight;
                 plan.emplace_back(spaceId, partId, host, peer);
                 LOG(INFO) << "plan trans leader: " << spaceId << " " << partId << " host "
                     << host.host << ":"
@@ -649,8 +694,8 @@ int32_t Balancer::giveupLeaders(
         if (!transfered) {
             ++it;
         }
-        // if host has enough leader, just return
-        if (hostLeaders.size() <= maxLoad) {
+        // if host has shed enough leader load, just return
+        if (hostLoad <= maxLoad) {
             break;
         }
     }
@@ -673,6 +718,134 @@ void Balancer::simplifyLeaderBalnacePlan(GraphSpaceID spaceId, LeaderBalancePlan
     }
 }
 
+std::unordered_map<PartitionID, double> Balancer::partLoads(GraphSpaceID spaceId) {
+    std::unordered_map<PartitionID, double> loads;
+    auto prefix = MetaServiceUtils::assembleSegmentKey(kPartLoadSegment,
+                                                       folly::stringPrintf("%d:", spaceId));
+    std::unique_ptr<kvstore::KVIterator> iter;
+    auto ret = kv_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        return loads;
+    }
+    while (iter->valid()) {
+        auto partStr = iter->key().subpiece(prefix.size()).str();
+        try {
+            auto partId = folly::to<PartitionID>(partStr);
+            auto qps = folly::to<double>(iter->val().str());
+            if (qps > 0) {
+                loads.emplace(partId, qps);
+            }
+        } catch (const std::exception& e) {
+            LOG(WARNING) << "Skip malformed part load entry for space " << spaceId
+                         << ", part \"" << partStr << "\": " << e.what();
+        }
+        iter->next();
+    }
+    return loads;
+}
+
+bool Balancer::leadersImbalanced() {
+    // The leader distribution as the heartbeats last reported it. No RPC
+    // involved, so the periodic check stays cheap; the balance run itself
+    // still fetches a fresh distribution from the storage hosts
+    HostLeaderMap hostLeaderMap;
+    const auto& prefix = MetaServiceUtils::leaderPrefix();
+    std::unique_ptr<kvstore::KVIterator> iter;
+    auto ret = kv_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        return false;
+    }
+    auto activeHosts = ActiveHostsMan::getActiveHosts(kv_);
+    while (iter->valid()) {
+        auto host = MetaServiceUtils::parseLeaderKey(iter->key());
+        if (std::find(activeHosts.begin(), activeHosts.end(), host) != activeHosts.end()) {
+            auto leaderParts = MetaServiceUtils::parseLeaderVal(iter->val());
+            for (auto& spaceEntry : leaderParts) {
+                hostLeaderMap[host][spaceEntry.first] = std::move(spaceEntry.second);
+            }
+        }
+        iter->next();
+    }
+    if (hostLeaderMap.empty()) {
+        return false;
+    }
+
+    std::vector<std::pair<GraphSpaceID, int32_t>> spaces;
+    kvstore::ResultCode code = kvstore::ResultCode::SUCCEEDED;
+    if (!getAllSpaces(spaces, code)) {
+        return false;
+    }
+    for (const auto& spaceInfo : spaces) {
+        LeaderBalancePlan plan;
+        buildLeaderBalancePlan(&hostLeaderMap, spaceInfo.first, plan);
+        simplifyLeaderBalnacePlan(spaceInfo.first, plan);
+        if (!plan.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Balancer::autoLeaderBalanceTick() {
+    auto leaderRet = kv_->partLeader(kDefaultSpaceId, kDefaultPartId);
+    if (!nebula::ok(leaderRet) || nebula::value(leaderRet) != localHost_) {
+        unbalancedRounds_ = 0;
+        return;
+    }
+    if (running_ || inLeaderBalance_) {
+        // Don't fight a data balance or a manual leader balance
+        unbalancedRounds_ = 0;
+        return;
+    }
+    if (!leadersImbalanced()) {
+        unbalancedRounds_ = 0;
+        return;
+    }
+    // Hysteresis: one bad reading right after a rolling restart or a
+    // raft election would otherwise shuffle leaders that are still
+    // settling, and the shuffle itself causes another bad reading
+    if (++unbalancedRounds_ < FLAGS_leader_balance_hysteresis_rounds) {
+        LOG(INFO) << "Leader distribution unbalanced for " << unbalancedRounds_
+                  << " round(s) of " << FLAGS_leader_balance_hysteresis_rounds;
+        return;
+    }
+    unbalancedRounds_ = 0;
+    LOG(INFO) << "Leader distribution stayed unbalanced, start a leader balance";
+    auto code = leaderBalance();
+    if (code != cpp2::ErrorCode::SUCCEEDED) {
+        LOG(ERROR) << "Auto leader balance failed, error "
+                   << static_cast<int32_t>(code);
+    }
+}
+
+bool Balancer::startAutoLeaderBalance(HostAddr localHost) {
+    if (FLAGS_auto_leader_balance_interval_secs <= 0) {
+        LOG(INFO) << "Auto leader balance is off "
+                  << "(--auto_leader_balance_interval_secs is not positive)";
+        return true;
+    }
+    localHost_ = std::move(localHost);
+    autoBalanceThread_ = std::make_unique<thread::GenericWorker>();
+    if (!autoBalanceThread_->start()) {
+        LOG(ERROR) << "Failed to start the auto leader balance thread";
+        return false;
+    }
+    autoBalanceThread_->addRepeatTask(FLAGS_auto_leader_balance_interval_secs * 1000,
+                                      &Balancer::autoLeaderBalanceTick,
+                                      this);
+    LOG(INFO) << "Auto leader balance started, check interval "
+              << FLAGS_auto_leader_balance_interval_secs << "s";
+    return true;
+}
+
+void Balancer::stopAutoLeaderBalance() {
+    if (autoBalanceThread_) {
+        autoBalanceThread_->stop();
+        autoBalanceThread_->wait();
+        autoBalanceThread_.reset();
+    }
+}
+
 }  // namespace meta
 }  // namespace nebula
 
@@ -11,6 +11,7 @@
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include "kvstore/KVStore.h"
 #include "common/network/NetworkUtils.h"
+#include "common/thread/GenericWorker.h"
 #include "common/time/WallClock.h"
 #include "meta/processors/admin/AdminClient.h"
 #include "meta/processors/admin/BalanceTask.h"
@@ -51,6 +52,7 @@ class Balancer {
     FRIEND_TEST(BalanceTest, StopBalanceDataTest);
     FRIEND_TEST(BalanceTest, LeaderBalancePlanTest);
     FRIEND_TEST(BalanceTest, SimpleLeaderBalancePlanTest);
+    FRIEND_TEST(BalanceTest, LoadWeightedLeaderBalancePlanTest);
     FRIEND_TEST(BalanceTest, IntersectHostsLeaderBalancePlanTest);
     FRIEND_TEST(BalanceTest, LeaderBalanceTest);
     FRIEND_TEST(BalanceTest, ManyHostsLeaderBalancePlanTest);
@@ -106,6 +108,18 @@ public:
 
     cpp2::ErrorCode leaderBalance();
 
+    /**
+     * Start the continuous leader balance loop; a no-op unless
+     * --auto_leader_balance_interval_secs is positive. Safe to start on
+     * every metad, only the meta leader acts on a tick. The loop checks
+     * the leader distribution the heartbeats last reported and triggers
+     * leaderBalance() once it stays unbalanced for
+     * --leader_balance_hysteresis_rounds consecutive checks
+     * */
+    bool startAutoLeaderBalance(HostAddr localHost);
+
+    void stopAutoLeaderBalance();
+
     void finish() {
         CHECK(!lock_.try_lock());
         plan_.reset();
@@ -173,12 +187,22 @@ private:
 
     void simplifyLeaderBalnacePlan(GraphSpaceID spaceId, LeaderBalancePlan& plan);
 
+    /**
+     * Per-part leader load for the space, fed through the "part_load"
+     * segment of the custom KV interface: key "<spaceId>:<partId>",
+     * value the part's request rate as a decimal string. Parts nothing
+     * reported on weigh 1, so without any feed the plan equalizes plain
+     * leader counts
+     * */
+    std::unordered_map<PartitionID, double> partLoads(GraphSpaceID spaceId);
+
     int32_t acquireLeaders(std::unordered_map<HostAddr, std::vector<PartitionID>>& allHostParts,
                            std::unordered_map<HostAddr, std::vector<PartitionID>>& leaderHostParts,
                            std::unordered_map<PartitionID, std::vector<HostAddr>>& peersMap,
                            std::unordered_set<HostAddr>& activeHosts,
                            HostAddr to,
-                           size_t maxLoad,
+                           double minLoad,
+                           const std::unordered_map<PartitionID, double>& partLoad,
                            LeaderBalancePlan& plan,
                            GraphSpaceID spaceId);
 
@@ -186,10 +210,17 @@ private:
                           std::unordered_map<PartitionID, std::vector<HostAddr>>& peersMap,
                           std::unordered_set<HostAddr>& activeHosts,
                           HostAddr from,
-                          size_t maxLoad,
+                          double maxLoad,
+                          const std::unordered_map<PartitionID, double>& partLoad,
                           LeaderBalancePlan& plan,
                           GraphSpaceID spaceId);
 
+    void autoLeaderBalanceTick();
+
+    // Whether any space's leader distribution, as the heartbeats last
+    // reported it, would produce a non-empty balance plan
+    bool leadersImbalanced();
+
 private:
     std::atomic_bool running_{false};
     kvstore::KVStore* kv_ = nullptr;
@@ -200,6 +231,10 @@ private:
     std::atomic_bool inLeaderBalance_{false};
     std::unique_ptr<HostLeaderMap> hostLeaderMap_;
     mutable std::mutex lock_;
+    // The continuous leader balance loop
+    std::unique_ptr<thread::GenericWorker> autoBalanceThread_;
+    HostAddr localHost_;
+    int32_t unbalancedRounds_{0};
 };
 
 }  // namespace meta
@@ -15,23 +15,18 @@ void ListTagIndexesProcessor::process(const cpp2::ListTagIndexesReq& req) {
     folly::SharedMutex::ReadHolder rHolder(LockUtils::tagIndexLock());
     auto prefix = MetaServiceUtils::indexPrefix(space);
 
-    std::unique_ptr<kvstore::KVIterator> iter;
-    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
-    handleErrorCode(MetaCommon::to(ret));
-    if (ret != kvstore::ResultCode::SUCCEEDED) {
-        LOG(ERROR) << "List Tag Index Failed: SpaceID " << space;
-        onFinished();
-        return;
-    }
-
     decltype(resp_.items) items;
-    while (iter->valid()) {
-        auto val = iter->val();
+    auto ret = doPagedPrefix(prefix, [&] (folly::StringPiece, folly::StringPiece val) {
         auto item = MetaServiceUtils::parseIndex(val);
         if (item.get_schema_id().getType() == cpp2::SchemaID::Type::tag_id) {
             items.emplace_back(std::move(item));
         }
-        iter->next();
+    }, FLAGS_meta_serve_reads_on_followers);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        LOG(ERROR) << "List Tag Index Failed: SpaceID " << space;
+        handleErrorCode(MetaCommon::to(ret));
+        onFinished();
+        return;
     }
     resp_.set_code(cpp2::ErrorCode::SUCCEEDED);
     resp_.set_items(std::move(items));
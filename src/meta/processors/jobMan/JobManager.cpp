@@ -75,16 +75,53 @@ void JobManager::scheduleThread() {
             }
             usleep(FLAGS_job_check_intervals);
         }
+        if (shutDown_) {
+            break;
+        }
 
         auto jobDesc = JobDescription::loadJobDescription(iJob, kvStore_);
         if (jobDesc == folly::none) {
             LOG(ERROR) << "[JobManager] load a invalid job from queue " << iJob;
             continue;   // leader change or archive happend
         }
-        if (!jobDesc->setStatus(cpp2::JobStatus::RUNNING)) {
-            LOG(INFO) << "[JobManager] skip job " << iJob;
-            continue;
+        auto cls = jobClass(jobDesc->getCmd());
+        {
+            std::lock_guard<std::mutex> lk(classLock_);
+            auto idx = static_cast<size_t>(cls);
+            if (classBusy_[idx]) {
+                // A job of this class is running, keep the class FIFO
+                classPending_[idx].emplace_back(iJob);
+                continue;
+            }
+            classBusy_[idx] = true;
         }
+        pool_->addTask(&JobManager::runJob, this, iJob, cls);
+    }
+    LOG(INFO) << "[JobManager] exit";
+}
+
+JobManager::JobClass JobManager::jobClass(cpp2::AdminCmd cmd) {
+    switch (cmd) {
+        case cpp2::AdminCmd::COMPACT:
+        case cpp2::AdminCmd::FLUSH:
+            return JobClass::kCompact;
+        case cpp2::AdminCmd::REBUILD_TAG_INDEX:
+        case cpp2::AdminCmd::REBUILD_EDGE_INDEX:
+            return JobClass::kRebuild;
+        default:
+            return JobClass::kLight;
+    }
+}
+
+void JobManager::runJob(int32_t iJob, JobClass cls) {
+    // The job description is reloaded here, the job may have been stopped
+    // while it sat behind another one of its class
+    auto jobDesc = JobDescription::loadJobDescription(iJob, kvStore_);
+    if (jobDesc == folly::none) {
+        LOG(ERROR) << "[JobManager] load a invalid job " << iJob;
+    } else if (!jobDesc->setStatus(cpp2::JobStatus::RUNNING)) {
+        LOG(INFO) << "[JobManager] skip job " << iJob;
+    } else {
         save(jobDesc->jobKey(), jobDesc->jobVal());
 
         if (runJobInternal(*jobDesc)) {
@@ -94,7 +131,22 @@ void JobManager::scheduleThread() {
         }
         save(jobDesc->jobKey(), jobDesc->jobVal());
     }
-    LOG(INFO) << "[JobManager] exit";
+
+    // Hand the class over to the next queued job of the same kind
+    int32_t next = -1;
+    {
+        std::lock_guard<std::mutex> lk(classLock_);
+        auto idx = static_cast<size_t>(cls);
+        if (classPending_[idx].empty()) {
+            classBusy_[idx] = false;
+        } else {
+            next = classPending_[idx].front();
+            classPending_[idx].pop_front();
+        }
+    }
+    if (next >= 0) {
+        pool_->addTask(&JobManager::runJob, this, next, cls);
+    }
 }
 
 // @return: true if succeed, false if any task failed
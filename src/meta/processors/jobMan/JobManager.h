@@ -12,6 +12,8 @@
 #include "common/interface/gen-cpp2/meta_types.h"
 #include <boost/core/noncopyable.hpp>
 #include <gtest/gtest_prod.h>
+#include <array>
+#include <deque>
 #include <folly/concurrency/UnboundedQueue.h>
 #include "kvstore/NebulaStore.h"
 #include "meta/processors/jobMan/JobStatus.h"
@@ -49,8 +51,19 @@ public:
     ErrorOr<ResultCode, int32_t> recoverJob();
 
 private:
+    // Jobs of different classes run concurrently on the pool, jobs of one
+    // class stay serial. A long compact no longer blocks a rebuild job
+    enum class JobClass : uint8_t {
+        kCompact = 0,
+        kRebuild,
+        kLight,
+        kNumClasses,
+    };
+
     JobManager() = default;
     void scheduleThread();
+    static JobClass jobClass(cpp2::AdminCmd cmd);
+    void runJob(int32_t iJob, JobClass jobClass);
     bool runJobInternal(const JobDescription& jobDesc);
     int getSpaceId(const std::string& name);
     nebula::kvstore::ResultCode save(const std::string& k, const std::string& v);
@@ -60,6 +73,11 @@ private:
     std::unique_ptr<folly::UMPSCQueue<int32_t, true>> queue_;
     std::unique_ptr<thread::GenericWorker> bgThread_;
 
+    static constexpr size_t kNumJobClasses = static_cast<size_t>(JobClass::kNumClasses);
+    std::mutex classLock_;
+    std::array<bool, kNumJobClasses> classBusy_{};
+    std::array<std::deque<int32_t>, kNumJobClasses> classPending_;
+
     bool shutDown_{false};
     nebula::kvstore::KVStore* kvStore_{nullptr};
     std::unique_ptr<nebula::thread::GenericThreadPool> pool_{nullptr};
@@ -12,9 +12,21 @@ namespace meta {
 void GetPartsAllocProcessor::process(const cpp2::GetPartsAllocReq& req) {
     folly::SharedMutex::ReadHolder rHolder(LockUtils::spaceLock());
     auto spaceId = req.get_space_id();
+    static VersionedResponseCache<decltype(resp_.parts)> cache;
+    auto version = std::make_pair(LastUpdateTimeMan::get(kvstore_),
+                                  LastUpdateTimeMan::localEpoch());
+    if (version.first > 0) {
+        decltype(resp_.parts) cached;
+        if (cache.get(spaceId, version, &cached)) {
+            resp_.set_parts(std::move(cached));
+            onFinished();
+            return;
+        }
+    }
     auto prefix = MetaServiceUtils::partPrefix(spaceId);
     std::unique_ptr<kvstore::KVIterator> iter;
-    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
+    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter,
+                                FLAGS_meta_serve_reads_on_followers);
     handleErrorCode(MetaCommon::to(ret));
     if (ret != kvstore::ResultCode::SUCCEEDED) {
         onFinished();
@@ -29,6 +41,9 @@ void GetPartsAllocProcessor::process(const cpp2::GetPartsAllocReq& req) {
         parts.emplace(partId, std::move(partHosts));
         iter->next();
     }
+    if (version.first > 0) {
+        cache.put(spaceId, version, parts);
+    }
     resp_.set_parts(std::move(parts));
     onFinished();
 }
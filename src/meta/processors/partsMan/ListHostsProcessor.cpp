@@ -179,6 +179,13 @@ void ListHostsProcessor::removeExpiredHosts(std::vector<std::string>&& removeHos
     if (removeHostsKey.empty()) {
         return;
     }
+    std::vector<HostAddr> removedHosts;
+    removedHosts.reserve(removeHostsKey.size());
+    for (const auto& key : removeHostsKey) {
+        auto host = MetaServiceUtils::parseHostKey(key);
+        removedHosts.emplace_back(host.host, host.port);
+    }
+    ActiveHostsMan::onHostsRemoved(removedHosts);
     kvstore_->asyncMultiRemove(kDefaultSpaceId,
                                kDefaultPartId,
                                std::move(removeHostsKey),
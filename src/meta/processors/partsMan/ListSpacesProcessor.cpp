@@ -11,9 +11,21 @@ namespace meta {
 
 void ListSpacesProcessor::process(const cpp2::ListSpacesReq&) {
     folly::SharedMutex::ReadHolder rHolder(LockUtils::spaceLock());
+    static VersionedResponseCache<std::vector<cpp2::IdName>> cache;
+    auto version = std::make_pair(LastUpdateTimeMan::get(kvstore_),
+                                  LastUpdateTimeMan::localEpoch());
+    if (version.first > 0) {
+        std::vector<cpp2::IdName> cached;
+        if (cache.get(0, version, &cached)) {
+            resp_.set_spaces(std::move(cached));
+            onFinished();
+            return;
+        }
+    }
     auto prefix = MetaServiceUtils::spacePrefix();
     std::unique_ptr<kvstore::KVIterator> iter;
-    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
+    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter,
+                                FLAGS_meta_serve_reads_on_followers);
     if (ret != kvstore::ResultCode::SUCCEEDED) {
         handleErrorCode(MetaCommon::to(ret));
         onFinished();
@@ -30,6 +42,9 @@ void ListSpacesProcessor::process(const cpp2::ListSpacesReq&) {
         spaces.emplace_back(std::move(space));
         iter->next();
     }
+    if (version.first > 0) {
+        cache.put(0, version, spaces);
+    }
     resp_.set_spaces(std::move(spaces));
     onFinished();
 }
@@ -13,31 +13,39 @@ void ListEdgesProcessor::process(const cpp2::ListEdgesReq& req) {
     CHECK_SPACE_ID_AND_RETURN(req.get_space_id());
     folly::SharedMutex::ReadHolder rHolder(LockUtils::edgeLock());
     auto spaceId = req.get_space_id();
-    auto prefix = MetaServiceUtils::schemaEdgesPrefix(spaceId);
-    std::unique_ptr<kvstore::KVIterator> iter;
-    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
-    handleErrorCode(MetaCommon::to(ret));
-    if (ret != kvstore::ResultCode::SUCCEEDED) {
-        onFinished();
-        return;
+    static VersionedResponseCache<decltype(resp_.edges)> cache;
+    auto version = std::make_pair(LastUpdateTimeMan::get(kvstore_),
+                                  LastUpdateTimeMan::localEpoch());
+    if (version.first > 0) {
+        decltype(resp_.edges) cached;
+        if (cache.get(spaceId, version, &cached)) {
+            resp_.set_edges(std::move(cached));
+            onFinished();
+            return;
+        }
     }
-
+    auto prefix = MetaServiceUtils::schemaEdgesPrefix(spaceId);
     decltype(resp_.edges) edges;
-    while (iter->valid()) {
-        auto key = iter->key();
-        auto val = iter->val();
+    auto ret = doPagedPrefix(prefix, [&] (folly::StringPiece key, folly::StringPiece val) {
         auto edgeType = *reinterpret_cast<const EdgeType *>(key.data() + prefix.size());
-        auto version = MetaServiceUtils::parseEdgeVersion(key);
+        auto edgeVersion = MetaServiceUtils::parseEdgeVersion(key);
         auto nameLen = *reinterpret_cast<const int32_t *>(val.data());
         auto edgeName = val.subpiece(sizeof(int32_t), nameLen).str();
         auto schema = MetaServiceUtils::parseSchema(val);
         cpp2::EdgeItem edge;
         edge.set_edge_type(edgeType);
         edge.set_edge_name(std::move(edgeName));
-        edge.set_version(version);
+        edge.set_version(edgeVersion);
         edge.set_schema(std::move(schema));
         edges.emplace_back(std::move(edge));
-        iter->next();
+    }, FLAGS_meta_serve_reads_on_followers);
+    handleErrorCode(MetaCommon::to(ret));
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        onFinished();
+        return;
+    }
+    if (version.first > 0) {
+        cache.put(spaceId, version, edges);
     }
     resp_.set_edges(std::move(edges));
     onFinished();
@@ -13,30 +13,39 @@ void ListTagsProcessor::process(const cpp2::ListTagsReq& req) {
     CHECK_SPACE_ID_AND_RETURN(req.get_space_id());
     folly::SharedMutex::ReadHolder rHolder(LockUtils::tagLock());
     auto spaceId = req.get_space_id();
-    auto prefix = MetaServiceUtils::schemaTagsPrefix(spaceId);
-    std::unique_ptr<kvstore::KVIterator> iter;
-    auto ret = kvstore_->prefix(kDefaultSpaceId, kDefaultPartId, prefix, &iter);
-    handleErrorCode(MetaCommon::to(ret));
-    if (ret != kvstore::ResultCode::SUCCEEDED) {
-        onFinished();
-        return;
+    static VersionedResponseCache<decltype(resp_.tags)> cache;
+    auto version = std::make_pair(LastUpdateTimeMan::get(kvstore_),
+                                  LastUpdateTimeMan::localEpoch());
+    if (version.first > 0) {
+        decltype(resp_.tags) cached;
+        if (cache.get(spaceId, version, &cached)) {
+            resp_.set_tags(std::move(cached));
+            onFinished();
+            return;
+        }
     }
+    auto prefix = MetaServiceUtils::schemaTagsPrefix(spaceId);
     decltype(resp_.tags) tags;
-    while (iter->valid()) {
-        auto key = iter->key();
-        auto val = iter->val();
+    auto ret = doPagedPrefix(prefix, [&] (folly::StringPiece key, folly::StringPiece val) {
         auto tagID = *reinterpret_cast<const TagID *>(key.data() + prefix.size());
-        auto version = MetaServiceUtils::parseTagVersion(key);
+        auto tagVersion = MetaServiceUtils::parseTagVersion(key);
         auto nameLen = *reinterpret_cast<const int32_t *>(val.data());
         auto tagName = val.subpiece(sizeof(int32_t), nameLen).str();
         auto schema = MetaServiceUtils::parseSchema(val);
         cpp2::TagItem item;
         item.set_tag_id(tagID);
         item.set_tag_name(std::move(tagName));
-        item.set_version(version);
+        item.set_version(tagVersion);
         item.set_schema(std::move(schema));
         tags.emplace_back(std::move(item));
-        iter->next();
+    }, FLAGS_meta_serve_reads_on_followers);
+    handleErrorCode(MetaCommon::to(ret));
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        onFinished();
+        return;
+    }
+    if (version.first > 0) {
+        cache.put(spaceId, version, tags);
     }
     resp_.set_tags(std::move(tags));
     onFinished();
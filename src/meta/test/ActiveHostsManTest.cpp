@@ -134,6 +134,41 @@ TEST(ActiveHostsManTest, LeaderTest) {
     ASSERT_EQ(1, ActiveHostsMan::getActiveHosts(kv.get()).size());
 }
 
+TEST(ActiveHostsManTest, LeaderDeltaTest) {
+    fs::TempDir rootPath("/tmp/ActiveHostsManTest.XXXXXX");
+    FLAGS_expired_threshold_sec = 2;
+    std::unique_ptr<kvstore::KVStore> kv(MockCluster::initMetaKV(rootPath.path()));
+    auto now = time::WallClock::fastNowInMilliSec();
+    HostInfo info(now, cpp2::HostRole::STORAGE, NEBULA_STRINGIFY(GIT_INFO_SHA));
+
+    std::unordered_map<GraphSpaceID, std::vector<PartitionID>> leaderIds;
+    leaderIds.emplace(1, std::vector<PartitionID>{1, 2});
+    ActiveHostsMan::updateHostInfo(kv.get(), HostAddr("0", 0), info, &leaderIds);
+    ASSERT_EQ(1, ActiveHostsMan::getActiveHosts(kv.get()).size());
+
+    // Drop the leader row behind the manager's back; a heartbeat
+    // repeating the same list is elided and does not restore it
+    folly::Baton<true, std::atomic> baton;
+    kv->asyncMultiRemove(kDefaultSpaceId, kDefaultPartId,
+                         {MetaServiceUtils::leaderKey("0", 0)},
+                         [&baton] (kvstore::ResultCode) { baton.post(); });
+    baton.wait();
+    ActiveHostsMan::updateHostInfo(kv.get(), HostAddr("0", 0), info, &leaderIds);
+    std::string val;
+    auto ret = kv->get(kDefaultSpaceId, kDefaultPartId,
+                       MetaServiceUtils::leaderKey("0", 0), &val);
+    ASSERT_EQ(kvstore::ResultCode::ERR_KEY_NOT_FOUND, ret);
+
+    // A changed list is written again
+    leaderIds[1].emplace_back(3);
+    ActiveHostsMan::updateHostInfo(kv.get(), HostAddr("0", 0), info, &leaderIds);
+    ret = kv->get(kDefaultSpaceId, kDefaultPartId,
+                  MetaServiceUtils::leaderKey("0", 0), &val);
+    ASSERT_EQ(kvstore::ResultCode::SUCCEEDED, ret);
+    auto leaderParts = MetaServiceUtils::parseLeaderVal(val);
+    ASSERT_EQ(3, leaderParts[1].size());
+}
+
 TEST(LastUpdateTimeManTest, NormalTest) {
     fs::TempDir rootPath("/tmp/LastUpdateTimeManTest.XXXXXX");
     std::unique_ptr<kvstore::KVStore> kv(MockCluster::initMetaKV(rootPath.path()));
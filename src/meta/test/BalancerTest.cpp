@@ -211,9 +211,9 @@ TEST(BalanceTest, DispatchTasksTest) {
         }
         plan.dispatchTasks();
         // All tasks is about space 0, part 0.
-        // So they will be dispatched into the same bucket.
-        ASSERT_EQ(1, plan.buckets_.size());
-        ASSERT_EQ(20, plan.buckets_[0].size());
+        // So they will be dispatched into the same queue.
+        ASSERT_EQ(1, plan.partQueues_.size());
+        ASSERT_EQ(20, plan.partQueues_[0].size());
     }
     {
         FLAGS_task_concurrency = 10;
@@ -224,9 +224,9 @@ TEST(BalanceTest, DispatchTasksTest) {
             plan.addTask(std::move(task));
         }
         plan.dispatchTasks();
-        ASSERT_EQ(5, plan.buckets_.size());
-        for (auto& bucket : plan.buckets_) {
-            ASSERT_EQ(1, bucket.size());
+        ASSERT_EQ(5, plan.partQueues_.size());
+        for (auto& queue : plan.partQueues_) {
+            ASSERT_EQ(1, queue.size());
         }
     }
     {
@@ -243,12 +243,12 @@ TEST(BalanceTest, DispatchTasksTest) {
             plan.addTask(std::move(task));
         }
         plan.dispatchTasks();
-        ASSERT_EQ(10, plan.buckets_.size());
+        ASSERT_EQ(10, plan.partQueues_.size());
         int32_t total = 0;
         for (auto i = 0; i < 10; i++) {
-            ASSERT_LE(1, plan.buckets_[i].size());
-            ASSERT_GE(2, plan.buckets_[i].size());
-            total += plan.buckets_[i].size();
+            ASSERT_LE(1, plan.partQueues_[i].size());
+            ASSERT_GE(2, plan.partQueues_[i].size());
+            total += plan.partQueues_[i].size();
         }
         ASSERT_EQ(15, total);
     }
@@ -284,9 +284,9 @@ TEST(BalanceTest, BalancePlanTest) {
         plan.invoke();
         b.wait();
         // All tasks is about space 0, part 0.
-        // So they will be dispatched into the same bucket.
-        ASSERT_EQ(1, plan.buckets_.size());
-        ASSERT_EQ(10, plan.buckets_[0].size());
+        // So they will be dispatched into the same queue.
+        ASSERT_EQ(1, plan.partQueues_.size());
+        ASSERT_EQ(10, plan.partQueues_[0].size());
     }
     {
         LOG(INFO) << "Test with all tasks succeeded, 10 buckets!";
@@ -310,10 +310,10 @@ TEST(BalanceTest, BalancePlanTest) {
         plan.invoke();
         b.wait();
         // All tasks is about different parts.
-        // So they will be dispatched into different buckets.
-        ASSERT_EQ(10, plan.buckets_.size());
+        // So they will be dispatched into different queues.
+        ASSERT_EQ(10, plan.partQueues_.size());
         for (auto i = 0; i < 10; i++) {
-            ASSERT_EQ(1, plan.buckets_[1].size());
+            ASSERT_EQ(1, plan.partQueues_[1].size());
         }
     }
     {
@@ -1152,6 +1152,56 @@ TEST(BalanceTest, SimpleLeaderBalancePlanTest) {
     }
 }
 
+TEST(BalanceTest, LoadWeightedLeaderBalancePlanTest) {
+    fs::TempDir rootPath("/tmp/LoadWeightedLeaderBalancePlanTest.XXXXXX");
+    std::unique_ptr<kvstore::KVStore> kv(MockCluster::initMetaKV(rootPath.path()));
+    std::vector<HostAddr> hosts = {{"0", 0}, {"1", 1}, {"2", 2}};
+    TestUtils::createSomeHosts(kv.get(), hosts);
+    // 9 partition in space 1, 3 replica, 3 hosts
+    TestUtils::assembleSpace(kv.get(), 1, 9, 3, 3);
+
+    // Part 1 serves five times the request rate of the others, fed
+    // through the part_load custom KV segment
+    {
+        std::vector<kvstore::KV> data;
+        data.emplace_back(MetaServiceUtils::assembleSegmentKey("part_load", "1:1"), "5");
+        folly::Baton<true, std::atomic> b;
+        kv->asyncMultiPut(kDefaultSpaceId, kDefaultPartId, std::move(data),
+                          [&](kvstore::ResultCode code) {
+                              ASSERT_EQ(kvstore::ResultCode::SUCCEEDED, code);
+                              b.post();
+                          });
+        b.wait();
+    }
+
+    std::unique_ptr<AdminClient> client(new AdminClient(kv.get()));
+    std::unique_ptr<Balancer> balancer(new Balancer(kv.get(), std::move(client)));
+    {
+        HostLeaderMap hostLeaderMap;
+        hostLeaderMap[HostAddr("0", 0)][1] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+        hostLeaderMap[HostAddr("1", 1)][1] = {};
+        hostLeaderMap[HostAddr("2", 2)][1] = {};
+
+        LeaderBalancePlan plan;
+        auto leaderParts = balancer->buildLeaderBalancePlan(&hostLeaderMap, 1, plan, false);
+        // Total load is 13 over 3 hosts, every host must end up in [4, 5]:
+        // the host leading the hot part gets nearly nothing else, while a
+        // plain count balance would hand it two more leaders
+        for (const auto& hostEntry : leaderParts) {
+            double load = 0;
+            for (auto partId : hostEntry.second) {
+                load += partId == 1 ? 5.0 : 1.0;
+            }
+            EXPECT_GE(load, 4);
+            EXPECT_LE(load, 5);
+            auto it = std::find(hostEntry.second.begin(), hostEntry.second.end(), 1);
+            if (it != hostEntry.second.end()) {
+                EXPECT_EQ(1UL, hostEntry.second.size());
+            }
+        }
+    }
+}
+
 TEST(BalanceTest, IntersectHostsLeaderBalancePlanTest) {
     fs::TempDir rootPath("/tmp/IntersectHostsLeaderBalancePlanTest.XXXXXX");
     std::unique_ptr<kvstore::KVStore> kv(MockCluster::initMetaKV(rootPath.path()));
@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include "common/fs/TempDir.h"
+#include <gtest/gtest.h>
+#include "meta/common/MetaGroupWrite.h"
+#include "meta/processors/Common.h"
+#include "meta/test/TestUtils.h"
+
+DECLARE_int64(meta_group_write_window_us);
+
+namespace nebula {
+namespace meta {
+
+TEST(MetaGroupWriteTest, WindowDisabled) {
+    fs::TempDir rootPath("/tmp/meta_group_write_test.XXXXXX");
+    std::unique_ptr<kvstore::KVStore> kv(MockCluster::initMetaKV(rootPath.path()));
+
+    std::vector<kvstore::KV> data;
+    data.emplace_back("key_plain", "val_plain");
+    ASSERT_EQ(kvstore::ResultCode::SUCCEEDED,
+              MetaGroupWrite::syncPut(kv.get(), std::move(data)));
+
+    std::string value;
+    ASSERT_EQ(kvstore::ResultCode::SUCCEEDED,
+              kv->get(kDefaultSpaceId, kDefaultPartId, "key_plain", &value));
+    ASSERT_EQ("val_plain", value);
+}
+
+TEST(MetaGroupWriteTest, ConcurrentWritersShareCommits) {
+    fs::TempDir rootPath("/tmp/meta_group_write_test.XXXXXX");
+    std::unique_ptr<kvstore::KVStore> kv(MockCluster::initMetaKV(rootPath.path()));
+
+    FLAGS_meta_group_write_window_us = 2000;
+    SCOPE_EXIT {
+        FLAGS_meta_group_write_window_us = 0;
+    };
+
+    constexpr int32_t numThreads = 8;
+    constexpr int32_t numRounds = 20;
+    std::vector<std::thread> threads;
+    for (int32_t t = 0; t < numThreads; t++) {
+        threads.emplace_back([&kv, t] {
+            for (int32_t i = 0; i < numRounds; i++) {
+                std::vector<kvstore::KV> data;
+                data.emplace_back(folly::stringPrintf("key_%d_%d", t, i),
+                                  folly::stringPrintf("val_%d_%d", t, i));
+                ASSERT_EQ(kvstore::ResultCode::SUCCEEDED,
+                          MetaGroupWrite::syncPut(kv.get(), std::move(data)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Whichever group each write rode in, every record must be there
+    for (int32_t t = 0; t < numThreads; t++) {
+        for (int32_t i = 0; i < numRounds; i++) {
+            std::string value;
+            ASSERT_EQ(kvstore::ResultCode::SUCCEEDED,
+                      kv->get(kDefaultSpaceId, kDefaultPartId,
+                              folly::stringPrintf("key_%d_%d", t, i), &value));
+            ASSERT_EQ(folly::stringPrintf("val_%d_%d", t, i), value);
+        }
+    }
+}
+
+}  // namespace meta
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
@@ -41,6 +41,7 @@
 #include "meta/processors/customKV/ScanProcessor.h"
 
 DECLARE_int32(expired_threshold_sec);
+DECLARE_int32(meta_list_batch_size);
 
 namespace nebula {
 namespace meta {
@@ -933,14 +934,18 @@ TEST(ProcessorTest, ListOrGetTagsTest) {
     ASSERT_TRUE(TestUtils::assembleSpace(kv.get(), 1, 1));
     TestUtils::mockTag(kv.get(), 10);
 
-    // Test ListTagsProcessor
+    // Test ListTagsProcessor, with a batch size small enough to make the
+    // scan re-seek several times
     {
+        auto oldBatchSize = FLAGS_meta_list_batch_size;
+        FLAGS_meta_list_batch_size = 3;
         cpp2::ListTagsReq req;
         req.set_space_id(1);
         auto* processor = ListTagsProcessor::instance(kv.get());
         auto f = processor->getFuture();
         processor->process(req);
         auto resp = std::move(f).get();
+        FLAGS_meta_list_batch_size = oldBatchSize;
         decltype(resp.tags) tags;
         tags = resp.get_tags();
         ASSERT_EQ(cpp2::ErrorCode::SUCCEEDED, resp.get_code());
@@ -0,0 +1,209 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "mock/GraphGenerator.h"
+#include "codec/RowWriterV2.h"
+#include "utils/NebulaKeyUtils.h"
+
+namespace nebula {
+namespace mock {
+
+constexpr TagID GraphGenerator::kTagId;
+constexpr EdgeType GraphGenerator::kEdgeType;
+
+std::shared_ptr<meta::NebulaSchemaProvider> GraphGenerator::genTagSchema(SchemaVer ver) {
+    std::shared_ptr<meta::NebulaSchemaProvider> schema(new meta::NebulaSchemaProvider(ver));
+    schema->addField("payload", meta::cpp2::PropertyType::STRING, 0, false, "");
+    return schema;
+}
+
+
+std::shared_ptr<meta::NebulaSchemaProvider> GraphGenerator::genEdgeSchema(SchemaVer ver) {
+    std::shared_ptr<meta::NebulaSchemaProvider> schema(new meta::NebulaSchemaProvider(ver));
+    schema->addField("payload", meta::cpp2::PropertyType::STRING, 0, false, "");
+    return schema;
+}
+
+
+GraphGenerator::GraphGenerator(GraphGenConfig config)
+        : config_(std::move(config))
+        , rng_(config_.seed) {
+    CHECK_GT(config_.numVertices, 0);
+    CHECK_GE(config_.maxPropBytes, config_.minPropBytes);
+}
+
+
+VertexID GraphGenerator::vertexId(int64_t idx) {
+    return folly::stringPrintf("v_%010ld", idx);
+}
+
+
+int64_t GraphGenerator::sampleSource() {
+    auto n = config_.numVertices;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    if (config_.alpha <= 0.0) {
+        return std::min(n - 1, static_cast<int64_t>(uniform(rng_) * n));
+    }
+    // Inverse CDF of a bounded power law on [1, n] with density
+    // proportional to x^-alpha; alpha == 1 is the logarithmic special
+    // case of the integral
+    auto u = uniform(rng_);
+    double x;
+    if (std::abs(config_.alpha - 1.0) < 1e-9) {
+        x = std::exp(u * std::log(static_cast<double>(n)));
+    } else {
+        auto oneMinus = 1.0 - config_.alpha;
+        x = std::pow((std::pow(static_cast<double>(n), oneMinus) - 1.0) * u + 1.0,
+                     1.0 / oneMinus);
+    }
+    return std::min(n - 1, static_cast<int64_t>(x) - 1);
+}
+
+
+std::string GraphGenerator::payload() {
+    std::uniform_int_distribution<size_t> size(config_.minPropBytes, config_.maxPropBytes);
+    std::string result(size(rng_), '\0');
+    for (auto& c : result) {
+        c = 'a' + rng_() % 26;
+    }
+    return result;
+}
+
+
+std::vector<VertexData> GraphGenerator::genVertices() {
+    std::vector<VertexData> vertices;
+    vertices.reserve(config_.numVertices);
+    for (int64_t idx = 0; idx < config_.numVertices; idx++) {
+        VertexData data;
+        data.vId_ = vertexId(idx);
+        data.tId_ = kTagId;
+        data.props_.emplace_back(payload());
+        vertices.emplace_back(std::move(data));
+    }
+    return vertices;
+}
+
+
+std::vector<EdgeData> GraphGenerator::genEdges() {
+    std::vector<EdgeData> edges;
+    edges.reserve(config_.numEdges);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int64_t idx = 0; idx < config_.numEdges; idx++) {
+        auto src = sampleSource();
+        // Destinations stay uniform; only the out-degree is skewed.
+        // Self loops are redirected to the next vertex
+        auto dst = std::min(config_.numVertices - 1,
+                            static_cast<int64_t>(uniform(rng_) * config_.numVertices));
+        if (dst == src) {
+            dst = (dst + 1) % config_.numVertices;
+        }
+        EdgeData data;
+        data.srcId_ = vertexId(src);
+        data.type_ = kEdgeType;
+        data.rank_ = 0;
+        data.dstId_ = vertexId(dst);
+        data.props_.emplace_back(payload());
+        edges.emplace_back(std::move(data));
+    }
+    return edges;
+}
+
+
+nebula::storage::cpp2::AddVerticesRequest GraphGenerator::genAddVerticesReq() {
+    nebula::storage::cpp2::AddVerticesRequest req;
+    req.space_id = 1;
+    req.overwritable = true;
+
+    for (auto& rec : genVertices()) {
+        nebula::storage::cpp2::NewVertex newVertex;
+        nebula::storage::cpp2::NewTag newTag;
+        auto partId = std::hash<std::string>()(rec.vId_) % config_.parts + 1;
+
+        newTag.set_tag_id(rec.tId_);
+        newTag.set_props(std::move(rec.props_));
+
+        std::vector<nebula::storage::cpp2::NewTag> newTags;
+        newTags.push_back(std::move(newTag));
+
+        newVertex.id = rec.vId_;
+        newVertex.set_tags(std::move(newTags));
+        req.parts[partId].emplace_back(std::move(newVertex));
+    }
+    return req;
+}
+
+
+nebula::storage::cpp2::AddEdgesRequest GraphGenerator::genAddEdgesReq() {
+    nebula::storage::cpp2::AddEdgesRequest req;
+    req.space_id = 1;
+    req.overwritable = true;
+
+    for (auto& rec : genEdges()) {
+        nebula::storage::cpp2::NewEdge newEdge;
+        nebula::storage::cpp2::EdgeKey edgeKey;
+        auto partId = std::hash<std::string>()(rec.srcId_) % config_.parts + 1;
+
+        edgeKey.src = rec.srcId_;
+        edgeKey.edge_type = rec.type_;
+        edgeKey.ranking = rec.rank_;
+        edgeKey.dst = rec.dstId_;
+
+        newEdge.set_key(std::move(edgeKey));
+        newEdge.set_props(std::move(rec.props_));
+
+        req.parts[partId].emplace_back(std::move(newEdge));
+    }
+    return req;
+}
+
+
+namespace {
+
+std::string encodeProps(const meta::NebulaSchemaProvider* schema,
+                        const std::vector<Value>& props) {
+    RowWriterV2 writer(schema);
+    for (size_t i = 0; i < props.size(); i++) {
+        auto r = writer.setValue(i, props[i]);
+        CHECK(r == WriteResult::SUCCEEDED);
+    }
+    CHECK(writer.finish() == WriteResult::SUCCEEDED);
+    return std::move(writer).moveEncodedStr();
+}
+
+}  // namespace
+
+
+std::unordered_map<PartitionID, std::vector<kvstore::KV>>
+GraphGenerator::genVertexKVs(int32_t spaceVidLen) {
+    std::unordered_map<PartitionID, std::vector<kvstore::KV>> result;
+    auto schema = genTagSchema();
+    for (auto& vertex : genVertices()) {
+        PartitionID partId = std::hash<std::string>()(vertex.vId_) % config_.parts + 1;
+        auto key = NebulaKeyUtils::vertexKey(spaceVidLen, partId, vertex.vId_,
+                                             vertex.tId_, 0L);
+        result[partId].emplace_back(std::move(key),
+                                    encodeProps(schema.get(), vertex.props_));
+    }
+    return result;
+}
+
+
+std::unordered_map<PartitionID, std::vector<kvstore::KV>>
+GraphGenerator::genEdgeKVs(int32_t spaceVidLen) {
+    std::unordered_map<PartitionID, std::vector<kvstore::KV>> result;
+    auto schema = genEdgeSchema();
+    for (auto& edge : genEdges()) {
+        PartitionID partId = std::hash<std::string>()(edge.srcId_) % config_.parts + 1;
+        auto key = NebulaKeyUtils::edgeKey(spaceVidLen, partId, edge.srcId_, edge.type_,
+                                           edge.rank_, edge.dstId_, 0);
+        result[partId].emplace_back(std::move(key),
+                                    encodeProps(schema.get(), edge.props_));
+    }
+    return result;
+}
+
+}  // namespace mock
+}  // namespace nebula
@@ -0,0 +1,95 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef MOCK_GRAPHGENERATOR_H_
+#define MOCK_GRAPHGENERATOR_H_
+
+#include "common/base/Base.h"
+#include "common/interface/gen-cpp2/storage_types.h"
+#include "common/meta/NebulaSchemaProvider.h"
+#include "kvstore/Common.h"
+#include "mock/MockData.h"
+#include <random>
+
+namespace nebula {
+namespace mock {
+
+// Knobs of the synthetic graph. The defaults give a small uniform
+// graph; perf runs dial the counts up and set alpha for a skewed
+// degree distribution
+struct GraphGenConfig {
+    int64_t     numVertices{1000};
+    int64_t     numEdges{10000};
+    // Power-law exponent of the out-degree skew: edge sources are
+    // drawn with weight rank^-alpha, so vertex 0 is the hottest.
+    // 0 means uniform
+    double      alpha{0.0};
+    // Payload property size, uniform in [minPropBytes, maxPropBytes]
+    size_t      minPropBytes{8};
+    size_t      maxPropBytes{64};
+    // Same seed, same graph - runs are comparable across builds
+    uint64_t    seed{42};
+    int32_t     parts{6};
+};
+
+/**
+ * Parameterized synthetic graph for performance tests, complementing
+ * the fixed serve/like dataset of MockData. The generated tag and edge
+ * carry one string payload each; MockCluster::memSchemaMan registers
+ * their schemas under kTagId/kEdgeType, so the output can be written
+ * through AddVerticesProcessor/AddEdgesProcessor with the requests
+ * below, or straight into an engine as pre-encoded KV pairs
+ */
+class GraphGenerator {
+public:
+    static constexpr TagID kTagId = 9;
+    static constexpr EdgeType kEdgeType = 109;
+
+    static std::shared_ptr<meta::NebulaSchemaProvider> genTagSchema(SchemaVer ver = 0);
+
+    static std::shared_ptr<meta::NebulaSchemaProvider> genEdgeSchema(SchemaVer ver = 0);
+
+    explicit GraphGenerator(GraphGenConfig config);
+
+    // The vid of the idx-th generated vertex, zero padded so the key
+    // order matches the index order
+    static VertexID vertexId(int64_t idx);
+
+    std::vector<VertexData> genVertices();
+
+    std::vector<EdgeData> genEdges();
+
+    /*
+     * Processor-level input
+     */
+    nebula::storage::cpp2::AddVerticesRequest genAddVerticesReq();
+
+    nebula::storage::cpp2::AddEdgesRequest genAddEdgesReq();
+
+    /*
+     * Engine-level input: pre-encoded KV pairs grouped by part
+     */
+    std::unordered_map<PartitionID, std::vector<kvstore::KV>>
+    genVertexKVs(int32_t spaceVidLen = 32);
+
+    std::unordered_map<PartitionID, std::vector<kvstore::KV>>
+    genEdgeKVs(int32_t spaceVidLen = 32);
+
+private:
+    // Index of an edge source, power-law weighted when alpha > 0
+    int64_t sampleSource();
+
+    std::string payload();
+
+private:
+    GraphGenConfig      config_;
+    std::mt19937_64     rng_;
+};
+
+}  // namespace mock
+}  // namespace nebula
+
+#endif  // MOCK_GRAPHGENERATOR_H_
@@ -7,6 +7,7 @@
 #include "mock/AdHocIndexManager.h"
 #include "mock/AdHocSchemaManager.h"
 #include "mock/MockData.h"
+#include "mock/GraphGenerator.h"
 #include "meta/MetaServiceHandler.h"
 #include "common/meta/ServerBasedSchemaManager.h"
 #include "common/clients/meta/MetaClient.h"
@@ -192,6 +193,11 @@ MockCluster::memSchemaMan(SchemaVer schemaVerCount) {
 
     schemaMan->addTagSchema(1, 3, MockData::mockGeneralTagSchemaV2());
 
+    // The synthetic graph of GraphGenerator, for perf runs on
+    // parameterized shapes
+    schemaMan->addTagSchema(1, GraphGenerator::kTagId, GraphGenerator::genTagSchema());
+    schemaMan->addEdgeSchema(1, GraphGenerator::kEdgeType, GraphGenerator::genEdgeSchema());
+
     return schemaMan;
 }
 
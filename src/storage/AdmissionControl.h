@@ -0,0 +1,83 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_ADMISSIONCONTROL_H_
+#define STORAGE_ADMISSIONCONTROL_H_
+
+#include "common/base/Base.h"
+#include "storage/StorageFlags.h"
+
+namespace nebula {
+namespace storage {
+
+/**
+ * Per-class admission control for the storage service. Reads and writes
+ * are admitted against separate in-flight bounds, so a burst of one
+ * class queues on the client instead of occupying every worker thread.
+ * On top of the bounds, an exponential moving average of read latency
+ * acts as a back-pressure signal: while it sits above the configured
+ * target, new writes are shed, trading ingest throughput for read tail
+ * latency. Rejected requests fail all their parts with a retryable code
+ * and are expected to come back after the client's backoff.
+ *
+ * The counters and the average are kept approximately - relaxed atomics
+ * and a racy EWMA update are fine for a shedding signal.
+ * */
+class AdmissionControl final {
+public:
+    bool tryEnterRead() {
+        auto limit = FLAGS_max_concurrent_reads;
+        if (limit > 0 && inFlightReads_.load(std::memory_order_relaxed) >= limit) {
+            return false;
+        }
+        inFlightReads_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void leaveRead(int64_t latencyUs) {
+        inFlightReads_.fetch_sub(1, std::memory_order_relaxed);
+        // avg += (latency - avg) / 8, lost updates only delay the signal
+        auto& avgUs = readLatencyAvgUs();
+        auto avg = avgUs.load(std::memory_order_relaxed);
+        avgUs.store(avg + (latencyUs - avg) / kEwmaWeight,
+                    std::memory_order_relaxed);
+    }
+
+    // The latency average is process wide, so background maintenance
+    // reads the same foreground signal the write shedding uses
+    static std::atomic<int64_t>& readLatencyAvgUs() {
+        static std::atomic<int64_t> avgUs{0};
+        return avgUs;
+    }
+
+    bool tryEnterWrite() {
+        auto target = FLAGS_read_latency_target_us;
+        if (target > 0 &&
+                readLatencyAvgUs().load(std::memory_order_relaxed) > target) {
+            return false;
+        }
+        auto limit = FLAGS_max_concurrent_writes;
+        if (limit > 0 && inFlightWrites_.load(std::memory_order_relaxed) >= limit) {
+            return false;
+        }
+        inFlightWrites_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void leaveWrite() {
+        inFlightWrites_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int64_t kEwmaWeight = 8;
+
+    std::atomic<int32_t> inFlightReads_{0};
+    std::atomic<int32_t> inFlightWrites_{0};
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_ADMISSIONCONTROL_H_
@@ -15,6 +15,9 @@
 #include <folly/futures/Promise.h>
 #include <folly/futures/Future.h>
 #include "storage/CommonUtils.h"
+#include "storage/CompactionScheduler.h"
+#include "storage/MemoryQuota.h"
+#include "utils/RequestTrace.h"
 #include "codec/RowReader.h"
 #include "codec/RowWriterV2.h"
 #include "utils/IndexKeyUtils.h"
@@ -40,9 +43,14 @@ public:
 
 protected:
     void onFinished() {
+        if (UNLIKELY(FLAGS_trace_request_every_n > 0)) {
+            RequestTrace::record("process", this->duration_.elapsedInUSec());
+            RequestTrace::finish();
+        }
         stats::Stats::addStatsValue(stats_,
                                     this->result_.get_failed_parts().empty(),
                                     this->duration_.elapsedInUSec());
+        CompactionScheduler::reportLatency(this->duration_.elapsedInUSec());
         this->result_.set_latency_in_us(this->duration_.elapsedInUSec());
         this->result_.set_failed_parts(this->codes_);
         this->resp_.set_result(std::move(this->result_));
@@ -67,6 +75,10 @@ protected:
 
     void doRemove(GraphSpaceID spaceId, PartitionID partId, std::vector<std::string> keys);
 
+    void doRemoveRange(GraphSpaceID spaceId,
+                       PartitionID partId,
+                       std::vector<kvstore::KV> ranges);
+
     cpp2::ErrorCode to(kvstore::ResultCode code);
 
     nebula::meta::cpp2::ColumnDef columnDef(std::string name,
@@ -82,9 +94,29 @@ protected:
 
     void handleAsync(GraphSpaceID spaceId, PartitionID partId, kvstore::ResultCode code);
 
-    StatusOr<std::string> encodeRowVal(const meta::NebulaSchemaProvider* schema,
-                                       const std::vector<std::string>& propNames,
-                                       const std::vector<Value>& props);
+    // Log one structured line about this request when it ran past
+    // --slow_query_threshold_us, built from the scan counters the plan
+    // context collected; with --enable_io_accounting also one
+    // IoAccounting line per request. Call from onProcessFinished,
+    // before the result set is moved into the response, so the row
+    // count is still valid
+    void maybeLogSlowQuery(const char* opName, size_t rows, const std::string& planProfile);
+
+    // Resolve the latest schema of a tag once for the whole request and
+    // keep it alive until the processor finishes, so per-row paths do
+    // not go back through the schema manager's shared state. Call on
+    // the request thread; the per-part callbacks may only read the pin
+    // set through findPinnedTagSchema()
+    std::shared_ptr<const meta::SchemaProviderIf> pinTagSchema(GraphSpaceID spaceId, TagID tagId);
+
+    std::shared_ptr<const meta::SchemaProviderIf> pinEdgeSchema(GraphSpaceID spaceId,
+                                                                EdgeType type);
+
+    // Read-only lookup into the pin set, safe from the per-part
+    // callbacks. Returns nullptr when the schema was not pinned
+    const meta::SchemaProviderIf* findPinnedTagSchema(TagID tagId) const;
+
+    const meta::SchemaProviderIf* findPinnedEdgeSchema(EdgeType type) const;
 
 protected:
     StorageEnv*                                     env_{nullptr};
@@ -94,11 +126,25 @@ protected:
     cpp2::ResponseCommon                            result_;
 
     std::unique_ptr<PlanContext>                    planContext_;
+    // Owns the pinned read snapshot planContext_->snapshot_ points to
+    std::unique_ptr<kvstore::SpaceSnapshot>         snapshot_;
+    // Memory accounting of this request; the processors that buffer
+    // result rows point their plan contexts at it
+    MemoryQuota                                     memQuota_;
     time::Duration                                  duration_;
     std::vector<cpp2::PartitionResult>              codes_;
     std::mutex                                      lock_;
-    int32_t                                         callingNum_{0};
+    // Outstanding per-part ops; set before the fan-out, counted down
+    // lock-free by handleAsync as each part completes
+    std::atomic<int32_t>                            callingNum_{0};
     int32_t                                         spaceVidLen_;
+
+    // A request touches a handful of schemas, so the pin set is a flat
+    // array scanned linearly instead of a hashed map
+    std::vector<std::pair<TagID, std::shared_ptr<const meta::SchemaProviderIf>>>
+                                                    pinnedTagSchemas_;
+    std::vector<std::pair<EdgeType, std::shared_ptr<const meta::SchemaProviderIf>>>
+                                                    pinnedEdgeSchemas_;
 };
 
 }  // namespace storage
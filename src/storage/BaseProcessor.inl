@@ -5,6 +5,8 @@
  */
 
 #include "storage/BaseProcessor.h"
+#include "storage/StorageFlags.h"
+#include "storage/WriteCoalescer.h"
 
 namespace nebula {
 namespace storage {
@@ -38,6 +40,15 @@ cpp2::ErrorCode BaseProcessor<RESP>::to(kvstore::ResultCode code) {
         return cpp2::ErrorCode::E_TAG_NOT_FOUND;
     case kvstore::ResultCode::ERR_INVALID_DATA:
         return cpp2::ErrorCode::E_INVALID_DATA;
+    case kvstore::ResultCode::ERR_OUT_OF_MEMORY:
+        // The interface has no dedicated code for a request aborted
+        // over its memory quota; surface it as the retryable code the
+        // admission rejection uses, a retry may find less pressure
+        return cpp2::ErrorCode::E_CONSENSUS_ERROR;
+    case kvstore::ResultCode::ERR_WRITE_STALL:
+        // Nor for a write rejected over stall proximity; same retryable
+        // code, the backoff of the retry loop is the backpressure
+        return cpp2::ErrorCode::E_CONSENSUS_ERROR;
     default:
         return cpp2::ErrorCode::E_UNKNOWN;
     }
@@ -49,16 +60,16 @@ void BaseProcessor<RESP>::handleAsync(GraphSpaceID spaceId,
                                       kvstore::ResultCode code) {
     VLOG(3) << "partId:" << partId << ", code:" << static_cast<int32_t>(code);
 
-    bool finished = false;
-    {
+    if (UNLIKELY(code != kvstore::ResultCode::SUCCEEDED)) {
+        // codes_ is shared between the per-part completions, errors
+        // are recorded under the lock
         std::lock_guard<std::mutex> lg(this->lock_);
         handleErrorCode(code, spaceId, partId);
-        this->callingNum_--;
-        if (this->callingNum_ == 0) {
-            finished = true;
-        }
     }
-    if (finished) {
+    // The successful completions only touch the counter; the release
+    // ordering of the decrement makes every recorded error visible to
+    // the completion that finishes the request
+    if (this->callingNum_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
         this->onFinished();
     }
 }
@@ -126,10 +137,15 @@ template <typename RESP>
 void BaseProcessor<RESP>::doPut(GraphSpaceID spaceId,
                                 PartitionID partId,
                                 std::vector<kvstore::KV> data) {
-    this->env_->kvstore_->asyncMultiPut(
-        spaceId, partId, std::move(data), [spaceId, partId, this](kvstore::ResultCode code) {
-            handleAsync(spaceId, partId, code);
-    });
+    auto cb = [spaceId, partId, this](kvstore::ResultCode code) {
+        handleAsync(spaceId, partId, code);
+    };
+    if (this->env_->writeCoalescer_ != nullptr) {
+        this->env_->writeCoalescer_->asyncMultiPut(spaceId, partId,
+                                                   std::move(data), std::move(cb));
+        return;
+    }
+    this->env_->kvstore_->asyncMultiPut(spaceId, partId, std::move(data), std::move(cb));
 }
 
 template <typename RESP>
@@ -155,42 +171,115 @@ template <typename RESP>
 void BaseProcessor<RESP>::doRemove(GraphSpaceID spaceId,
                                    PartitionID partId,
                                    std::vector<std::string> keys) {
-    this->env_->kvstore_->asyncMultiRemove(
-        spaceId, partId, std::move(keys), [spaceId, partId, this](kvstore::ResultCode code) {
+    auto cb = [spaceId, partId, this](kvstore::ResultCode code) {
         handleAsync(spaceId, partId, code);
-    });
+    };
+    if (this->env_->writeCoalescer_ != nullptr) {
+        this->env_->writeCoalescer_->asyncMultiRemove(spaceId, partId,
+                                                      std::move(keys), std::move(cb));
+        return;
+    }
+    this->env_->kvstore_->asyncMultiRemove(spaceId, partId, std::move(keys), std::move(cb));
 }
 
 template <typename RESP>
-StatusOr<std::string>
-BaseProcessor<RESP>::encodeRowVal(const meta::NebulaSchemaProvider* schema,
-                                  const std::vector<std::string>& propNames,
-                                  const std::vector<Value>& props) {
-    RowWriterV2 rowWrite(schema);
-    // If req.prop_names is not empty, use the property name in req.prop_names
-    // Otherwise, use property name in schema
-    if (!propNames.empty()) {
-        for (size_t i = 0; i < propNames.size(); i++) {
-            auto wRet = rowWrite.setValue(propNames[i], props[i]);
-            if (wRet != WriteResult::SUCCEEDED) {
-                return Status::Error("Add field faild");
-            }
+std::shared_ptr<const meta::SchemaProviderIf>
+BaseProcessor<RESP>::pinTagSchema(GraphSpaceID spaceId, TagID tagId) {
+    for (const auto& pin : pinnedTagSchemas_) {
+        if (pin.first == tagId) {
+            return pin.second;
         }
-    } else {
-        for (size_t i = 0; i < props.size(); i++) {
-            auto wRet = rowWrite.setValue(i, props[i]);
-            if (wRet != WriteResult::SUCCEEDED) {
-                return Status::Error("Add field faild");
-            }
+    }
+    auto schema = env_->schemaMan_->getTagSchema(spaceId, tagId);
+    if (schema != nullptr) {
+        pinnedTagSchemas_.emplace_back(tagId, schema);
+    }
+    return schema;
+}
+
+template <typename RESP>
+std::shared_ptr<const meta::SchemaProviderIf>
+BaseProcessor<RESP>::pinEdgeSchema(GraphSpaceID spaceId, EdgeType type) {
+    for (const auto& pin : pinnedEdgeSchemas_) {
+        if (pin.first == type) {
+            return pin.second;
+        }
+    }
+    auto schema = env_->schemaMan_->getEdgeSchema(spaceId, type);
+    if (schema != nullptr) {
+        pinnedEdgeSchemas_.emplace_back(type, schema);
+    }
+    return schema;
+}
+
+template <typename RESP>
+const meta::SchemaProviderIf*
+BaseProcessor<RESP>::findPinnedTagSchema(TagID tagId) const {
+    for (const auto& pin : pinnedTagSchemas_) {
+        if (pin.first == tagId) {
+            return pin.second.get();
+        }
+    }
+    return nullptr;
+}
+
+template <typename RESP>
+const meta::SchemaProviderIf*
+BaseProcessor<RESP>::findPinnedEdgeSchema(EdgeType type) const {
+    for (const auto& pin : pinnedEdgeSchemas_) {
+        if (pin.first == type) {
+            return pin.second.get();
         }
     }
+    return nullptr;
+}
 
-    auto wRet = rowWrite.finish();
-    if (wRet != WriteResult::SUCCEEDED) {
-        return Status::Error("Add field faild");
+template <typename RESP>
+void BaseProcessor<RESP>::maybeLogSlowQuery(const char* opName,
+                                            size_t rows,
+                                            const std::string& planProfile) {
+    CHECK_NOTNULL(planContext_);
+    if (FLAGS_enable_io_accounting) {
+        // One attribution line per request: the requests carry no
+        // session field, so the processor and the space are the
+        // dimensions a workload can be charged back by
+        LOG(INFO) << "IoAccounting " << opName << ":"
+                  << " space=" << planContext_->spaceId_
+                  << " latency_us=" << duration_.elapsedInUSec()
+                  << " rows=" << rows
+                  << " engine_calls=" << planContext_->engineCalls_
+                  << " block_reads=" << planContext_->blockReads_
+                  << " block_read_bytes=" << planContext_->blockReadBytes_;
+        CommonUtils::recordBlockReads(planContext_->blockReads_,
+                                      planContext_->blockReadBytes_);
+    }
+    if (FLAGS_slow_query_threshold_us <= 0 ||
+        duration_.elapsedInUSec() <= static_cast<uint64_t>(FLAGS_slow_query_threshold_us)) {
+        return;
     }
+    LOG(WARNING) << "Slow " << opName << ":"
+                 << " space=" << planContext_->spaceId_
+                 << " latency_us=" << duration_.elapsedInUSec()
+                 << " rows=" << rows
+                 << " engine_calls=" << planContext_->engineCalls_
+                 << " keys_scanned=" << planContext_->keysScanned_
+                 << " stale_versions_skipped=" << planContext_->staleVersionsSkipped_
+                 << " bytes_read=" << planContext_->bytesRead_
+                 << " block_reads=" << planContext_->blockReads_
+                 << " block_read_bytes=" << planContext_->blockReadBytes_
+                 << " slowest_part=" << planContext_->slowestPart_
+                 << " slowest_part_us=" << planContext_->slowestPartUs_
+                 << (planProfile.empty() ? "" : " plan: ") << planProfile;
+}
 
-    return std::move(rowWrite).moveEncodedStr();
+template <typename RESP>
+void BaseProcessor<RESP>::doRemoveRange(GraphSpaceID spaceId,
+                                        PartitionID partId,
+                                        std::vector<kvstore::KV> ranges) {
+    this->env_->kvstore_->asyncMultiRemoveRange(
+        spaceId, partId, std::move(ranges), [spaceId, partId, this](kvstore::ResultCode code) {
+        handleAsync(spaceId, partId, code);
+    });
 }
 
 }  // namespace storage
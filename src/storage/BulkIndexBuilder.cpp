@@ -0,0 +1,176 @@
+/* Copyright (c) 2021 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/BulkIndexBuilder.h"
+#include "codec/RowReader.h"
+#include "utils/IndexKeyUtils.h"
+#include "utils/NebulaKeyUtils.h"
+#include <rocksdb/sst_file_reader.h>
+#include <rocksdb/sst_file_writer.h>
+
+namespace nebula {
+namespace storage {
+
+kvstore::ResultCode BulkIndexBuilder::buildIndexSst(meta::SchemaManager* schemaMan,
+                                                    meta::IndexManager* indexMan,
+                                                    GraphSpaceID spaceId,
+                                                    PartitionID partId,
+                                                    const std::vector<std::string>& dataFiles,
+                                                    const std::string& outputDir) {
+    std::vector<std::shared_ptr<meta::cpp2::IndexItem>> tagIndexes;
+    std::vector<std::shared_ptr<meta::cpp2::IndexItem>> edgeIndexes;
+    auto tRet = indexMan->getTagIndexes(spaceId);
+    if (tRet.ok()) {
+        tagIndexes = std::move(tRet).value();
+    }
+    auto eRet = indexMan->getEdgeIndexes(spaceId);
+    if (eRet.ok()) {
+        edgeIndexes = std::move(eRet).value();
+    }
+    if (tagIndexes.empty() && edgeIndexes.empty()) {
+        return kvstore::ResultCode::SUCCEEDED;
+    }
+    auto vRet = schemaMan->getSpaceVidLen(spaceId);
+    if (!vRet.ok()) {
+        LOG(ERROR) << "Get vid length of space " << spaceId << " failed";
+        return kvstore::ResultCode::ERR_SPACE_NOT_FOUND;
+    }
+    auto vIdLen = vRet.value();
+
+    // A staged file is sorted with the versions of one record adjacent,
+    // newest first; only the newest one feeds the index. The map merges
+    // the files of the part and keeps the output sorted for the writer
+    std::map<std::string, std::string> indexData;
+    // Tag ids and edge types may collide, so each kind gets its own cache
+    SchemaVerCache tagSchemaCache;
+    SchemaVerCache edgeSchemaCache;
+    for (const auto& file : dataFiles) {
+        rocksdb::SstFileReader reader{rocksdb::Options()};
+        auto status = reader.Open(file);
+        if (!status.ok()) {
+            LOG(ERROR) << "Open staged file " << file << " failed: " << status.ToString();
+            return kvstore::ResultCode::ERR_INVALID_DATA;
+        }
+        std::unique_ptr<rocksdb::Iterator> iter(reader.NewIterator(rocksdb::ReadOptions()));
+        std::string lastRecordId;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            folly::StringPiece key(iter->key().data(), iter->key().size());
+            folly::StringPiece val(iter->value().data(), iter->value().size());
+            if (NebulaKeyUtils::isVertex(vIdLen, key)) {
+                auto tagId = NebulaKeyUtils::getTagId(vIdLen, key);
+                auto recordId = NebulaKeyUtils::keyWithNoVersion(key).str();
+                if (recordId == lastRecordId) {
+                    continue;
+                }
+                lastRecordId = std::move(recordId);
+                std::unique_ptr<RowReader> rowReader;
+                for (const auto& index : tagIndexes) {
+                    if (index->get_schema_id().get_tag_id() != tagId) {
+                        continue;
+                    }
+                    if (rowReader == nullptr) {
+                        rowReader = RowReader::getTagPropReader(schemaMan, spaceId, tagId, val,
+                                                                &tagSchemaCache);
+                        if (rowReader == nullptr) {
+                            LOG(ERROR) << "Invalid row of tag " << tagId << " in " << file;
+                            return kvstore::ResultCode::ERR_INVALID_DATA;
+                        }
+                    }
+                    std::vector<Value::Type> colsType;
+                    auto values = IndexKeyUtils::collectIndexValues(rowReader.get(),
+                                                                    index->get_fields(),
+                                                                    colsType);
+                    if (!values.ok()) {
+                        LOG(ERROR) << "Collect index values of tag " << tagId
+                                   << " failed: " << values.status();
+                        return kvstore::ResultCode::ERR_INVALID_DATA;
+                    }
+                    auto vId = NebulaKeyUtils::getVertexId(vIdLen, key);
+                    indexData.emplace(IndexKeyUtils::vertexIndexKey(vIdLen, partId,
+                                                                    index->get_index_id(),
+                                                                    vId.str(),
+                                                                    std::move(values).value(),
+                                                                    colsType),
+                                      "");
+                }
+            } else if (NebulaKeyUtils::isEdge(vIdLen, key)) {
+                auto edgeType = NebulaKeyUtils::getEdgeType(vIdLen, key);
+                // In-edges carry the negative edge type, so only the
+                // out-going copy of each edge feeds the index
+                if (edgeType < 0) {
+                    continue;
+                }
+                auto recordId = NebulaKeyUtils::keyWithNoVersion(key).str();
+                if (recordId == lastRecordId) {
+                    continue;
+                }
+                lastRecordId = std::move(recordId);
+                std::unique_ptr<RowReader> rowReader;
+                for (const auto& index : edgeIndexes) {
+                    if (index->get_schema_id().get_edge_type() != edgeType) {
+                        continue;
+                    }
+                    if (rowReader == nullptr) {
+                        rowReader = RowReader::getEdgePropReader(schemaMan, spaceId,
+                                                                 edgeType, val,
+                                                                 &edgeSchemaCache);
+                        if (rowReader == nullptr) {
+                            LOG(ERROR) << "Invalid row of edge " << edgeType << " in " << file;
+                            return kvstore::ResultCode::ERR_INVALID_DATA;
+                        }
+                    }
+                    std::vector<Value::Type> colsType;
+                    auto values = IndexKeyUtils::collectIndexValues(rowReader.get(),
+                                                                    index->get_fields(),
+                                                                    colsType);
+                    if (!values.ok()) {
+                        LOG(ERROR) << "Collect index values of edge " << edgeType
+                                   << " failed: " << values.status();
+                        return kvstore::ResultCode::ERR_INVALID_DATA;
+                    }
+                    auto src = NebulaKeyUtils::getSrcId(vIdLen, key);
+                    auto dst = NebulaKeyUtils::getDstId(vIdLen, key);
+                    auto rank = NebulaKeyUtils::getRank(vIdLen, key);
+                    indexData.emplace(IndexKeyUtils::edgeIndexKey(vIdLen, partId,
+                                                                  index->get_index_id(),
+                                                                  src.str(), rank, dst.str(),
+                                                                  std::move(values).value(),
+                                                                  colsType),
+                                      "");
+                }
+            }
+        }
+    }
+    if (indexData.empty()) {
+        return kvstore::ResultCode::SUCCEEDED;
+    }
+
+    auto path = folly::stringPrintf("%s/index-generated-%d.sst", outputDir.c_str(), partId);
+    rocksdb::SstFileWriter writer{rocksdb::EnvOptions(), rocksdb::Options()};
+    auto status = writer.Open(path);
+    if (!status.ok()) {
+        LOG(ERROR) << "Open index sst " << path << " failed: " << status.ToString();
+        return kvstore::ResultCode::ERR_IO_ERROR;
+    }
+    for (const auto& entry : indexData) {
+        status = writer.Put(entry.first, entry.second);
+        if (!status.ok()) {
+            LOG(ERROR) << "Write index sst " << path << " failed: " << status.ToString();
+            return kvstore::ResultCode::ERR_IO_ERROR;
+        }
+    }
+    status = writer.Finish();
+    if (!status.ok()) {
+        LOG(ERROR) << "Finish index sst " << path << " failed: " << status.ToString();
+        return kvstore::ResultCode::ERR_IO_ERROR;
+    }
+    LOG(INFO) << "Built " << indexData.size() << " index entries of part " << partId
+              << " into " << path;
+    return kvstore::ResultCode::SUCCEEDED;
+}
+
+}  // namespace storage
+}  // namespace nebula
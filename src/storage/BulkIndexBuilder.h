@@ -0,0 +1,40 @@
+/* Copyright (c) 2021 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_BULKINDEXBUILDER_H_
+#define STORAGE_BULKINDEXBUILDER_H_
+
+#include "common/base/Base.h"
+#include "common/meta/SchemaManager.h"
+#include "common/meta/IndexManager.h"
+#include "kvstore/Common.h"
+
+namespace nebula {
+namespace storage {
+
+// Transforms the staged, sorted data ssts of one part into one sorted
+// index sst before ingest, so bulk-loaded rows arrive with their index
+// entries and no post-ingest rebuild scan has to re-read them. The
+// routine runs offline against the staging directory: it decodes each
+// newest-version row with the same RowReader/IndexKeyUtils path the
+// rebuild tasks use, collects the index keys of every tag and edge
+// index of the space, and writes them as one extra sst into the same
+// directory, where the regular ingest picks it up
+class BulkIndexBuilder final {
+public:
+    BulkIndexBuilder() = delete;
+
+    static kvstore::ResultCode buildIndexSst(meta::SchemaManager* schemaMan,
+                                             meta::IndexManager* indexMan,
+                                             GraphSpaceID spaceId,
+                                             PartitionID partId,
+                                             const std::vector<std::string>& dataFiles,
+                                             const std::string& outputDir);
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_BULKINDEXBUILDER_H_
@@ -5,7 +5,11 @@
  */
 
 #include "storage/CommonUtils.h"
+#include "common/stats/Stats.h"
 #include "common/time/WallClock.h"
+#include "codec/FieldView.h"
+#include "kvstore/Part.h"
+#include "storage/StorageFlags.h"
 
 namespace nebula {
 namespace storage {
@@ -21,6 +25,17 @@ bool CommonUtils::checkDataExpiredForTTL(const meta::SchemaProviderIf* schema,
         return false;
     }
     auto now = time::WallClock::fastNowInSec();
+    if (reader->readerVer() == 2) {
+        // probe just the ttl field of the raw row, the reader decodes
+        // nothing for it. The layout comes from the schema the row was
+        // written with, which may be older than the one passed in
+        const auto* rowSchema = reader->getSchema();
+        auto index = rowSchema->getFieldIndex(ttlCol);
+        auto view = FieldView::of(rowSchema, reader->rowData(), index);
+        if (view.ok()) {
+            return !view.isNull() && now > (view.intVal() + ttlDuration);
+        }
+    }
     auto v = reader->getValueByName(ttlCol);
     if (now > (v.getInt() + ttlDuration)) {
         VLOG(2) << "ttl expired";
@@ -29,5 +44,33 @@ bool CommonUtils::checkDataExpiredForTTL(const meta::SchemaProviderIf* schema,
     return false;
 }
 
+void CommonUtils::recordEngineCalls(int64_t calls) {
+    static stats::Stats engineCallsStat("storage", "engine_calls_per_request");
+    stats::Stats::addStatsValue(&engineCallsStat, true, calls);
+}
+
+void CommonUtils::recordBlockReads(int64_t reads, int64_t bytes) {
+    static stats::Stats blockReadsStat("storage", "block_reads_per_request");
+    static stats::Stats blockReadBytesStat("storage", "block_read_bytes_per_request");
+    stats::Stats::addStatsValue(&blockReadsStat, true, reads);
+    stats::Stats::addStatsValue(&blockReadBytesStat, true, bytes);
+}
+
+int64_t CommonUtils::genVersion(StorageEnv* env, GraphSpaceID spaceId, PartitionID partId) {
+    int64_t nowUs = 0;
+    if (FLAGS_use_hlc_version) {
+        auto ret = env->kvstore_->part(spaceId, partId);
+        if (ok(ret)) {
+            nowUs = nebula::value(ret)->issueVersionTime();
+        }
+    }
+    if (nowUs == 0) {
+        nowUs = time::WallClock::fastNowInMicroSec();
+    }
+    auto version = std::numeric_limits<int64_t>::max() - nowUs;
+    // Switch version to big-endian, make sure the key is in ordered.
+    return folly::Endian::big(version);
+}
+
 }  // namespace storage
 }  // namespace nebula
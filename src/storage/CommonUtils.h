@@ -8,6 +8,8 @@
 #define STORAGE_COMMON_H_
 
 #include "common/base/Base.h"
+#include "common/time/WallClock.h"
+#include "storage/KeyLockMap.h"
 #include "common/meta/SchemaManager.h"
 #include "common/meta/IndexManager.h"
 #include "common/base/ConcurrentLRUCache.h"
@@ -18,26 +20,100 @@
 namespace nebula {
 namespace storage {
 
-using VertexCache = ConcurrentLRUCache<std::pair<VertexID, TagID>, std::string>;
+// A tag row cached with its fields decoded once at insert, so readers
+// of a cache hit skip the codec entirely
+struct CachedTagRow {
+    std::string           row;
+    SchemaVer             ver{-1};
+    std::vector<Value>    decoded;
+};
+
+using VertexCache = ConcurrentLRUCache<std::pair<VertexID, TagID>,
+                                       std::shared_ptr<const CachedTagRow>>;
+
+// Serves field reads of a cached tag row from its decoded values.
+// Read-only; the schema must be the one the row was decoded against
+class CachedRowReader final : public RowReader {
+public:
+    CachedRowReader(const meta::SchemaProviderIf* schema, const CachedTagRow* cached)
+        : cached_(cached) {
+        schema_ = schema;
+        data_ = cached_->row;
+    }
+
+    Value getValueByName(const std::string& prop) const noexcept override {
+        return getValueByIndex(schema_->getFieldIndex(prop));
+    }
+
+    Value getValueByIndex(const int64_t index) const noexcept override {
+        if (index < 0 || static_cast<size_t>(index) >= cached_->decoded.size()) {
+            return Value(NullType::UNKNOWN_PROP);
+        }
+        return cached_->decoded[index];
+    }
+
+    int32_t readerVer() const noexcept override {
+        return 2;
+    }
+
+    size_t headerLen() const noexcept override {
+        return 0;
+    }
+
+protected:
+    bool reset(meta::SchemaProviderIf const*, folly::StringPiece, int32_t) noexcept override {
+        LOG(FATAL) << "Not implemented";
+    }
+
+private:
+    const CachedTagRow* cached_;
+};
+
+// Approximate out-degree per (vertexId, edgeType), fed by the edge write
+// path and by full scans of sampled reads. It decides when a sampled
+// GetNeighbors may skip over the edge key range instead of scanning all
+// of it, so the counts only need to be roughly right
+using DegreeCache = ConcurrentLRUCache<std::pair<VertexID, EdgeType>, int64_t>;
+
+// A finished GetNeighbors result with the time it was produced, served
+// verbatim to byte-identical requests no older than
+// --neighbors_result_cache_ttl_ms. The staleness is bounded by
+// construction - entries age out, nothing invalidates them - so a hit
+// may miss writes of the last TTL window
+struct CachedNeighborsResult {
+    nebula::DataSet       dataset;
+    int64_t               producedUs{0};
+};
+
+using NeighborsResultCache =
+    ConcurrentLRUCache<std::string, std::shared_ptr<const CachedNeighborsResult>>;
 
 // unify TagID, EdgeType
 using SchemaID = TagID;
 static_assert(sizeof(SchemaID) == sizeof(EdgeType), "sizeof(TagID) != sizeof(EdgeType)");
 
+class WriteCoalescer;
+
 class StorageEnv {
 public:
     kvstore::KVStore*                               kvstore_{nullptr};
     meta::SchemaManager*                            schemaMan_{nullptr};
     meta::IndexManager*                             indexMan_{nullptr};
+    // Write-intent latches for the update key-lock path
+    KeyLockMap                                      keyLockMap_;
+    // Owned by the server; null when --write_coalesce_window_us is off
+    WriteCoalescer*                                 writeCoalescer_{nullptr};
 };
 
 enum class ResultStatus {
     NORMAL = 0,
     ILLEGAL_DATA = -1,
     FILTER_OUT = -2,
+    DEADLINE_EXCEEDED = -3,
 };
 
 struct PropContext;
+class MemoryQuota;
 
 // PlanContext stores some information during the process
 class PlanContext {
@@ -66,6 +142,51 @@ public:
     // used for update
     bool                                insert_ = false;
 
+    // The read snapshot pinned for the whole request, so every node of
+    // the plan observes the same state. Null when reads should go to
+    // the latest state, e.g. on the update path
+    const kvstore::SpaceSnapshot*       snapshot_{nullptr};
+
+    // Absolute time in microseconds after which plan execution aborts
+    // with a partial result, 0 means no deadline. The requests carry no
+    // deadline field, so the budget starts counting at arrival
+    int64_t                             deadlineUs_{0};
+
+    bool isDeadlineExceeded() const {
+        return deadlineUs_ > 0 && time::WallClock::fastNowInMicroSec() > deadlineUs_;
+    }
+
+    // Engine reads issued by the nodes of this plan, for the
+    // engine-calls-per-request stat. Concurrent parts each run over
+    // their own context, the processor sums them up
+    int64_t                             engineCalls_{0};
+
+    // Scan counters kept by the iterators, cheap enough to stay
+    // always on; they feed the slow-query log
+    int64_t                             keysScanned_{0};
+    int64_t                             staleVersionsSkipped_{0};
+    int64_t                             bytesRead_{0};
+
+    // Physical block reads of the plan, off rocksdb's perf context;
+    // only collected when --enable_io_accounting is on, 0 otherwise
+    int64_t                             blockReads_{0};
+    int64_t                             blockReadBytes_{0};
+
+    // The part this plan spent the longest on, for the slow-query log.
+    // 0 until the processor has timed a part
+    PartitionID                         slowestPart_{0};
+    int64_t                             slowestPartUs_{0};
+
+    // The memory quota of the request this plan runs for, owned by the
+    // processor and shared by the part contexts; the nodes charge the
+    // rows they buffer against it. Null means unaccounted
+    MemoryQuota*                        memQuota_{nullptr};
+
+    // Neighbor vids collected for the post-response block warming,
+    // bounded by --neighbor_prefetch_limit. Null when the prefetch is
+    // off; each part context points at its own vector
+    std::vector<VertexID>*              prefetchVids_{nullptr};
+
     ResultStatus                        resultStat_{ResultStatus::NORMAL};
 };
 
@@ -90,6 +211,23 @@ public:
         }
         return HostAddr(adminAddr.host, adminAddr.port + 1);
     }
+
+    // Feed the engine reads one request issued into the
+    // storage.engine_calls_per_request stat
+    static void recordEngineCalls(int64_t calls);
+
+    // Feed the physical reads one request caused into the
+    // storage.block_reads_per_request and
+    // storage.block_read_bytes_per_request stats; only called when
+    // --enable_io_accounting is on
+    static void recordBlockReads(int64_t reads, int64_t bytes);
+
+    // The version the mutate processors stamp into the data keys they
+    // write, already big-endian so newer versions sort first. Taken
+    // from the part's hybrid logical clock when --use_hlc_version is
+    // on, which keeps versions in issue order per part regardless of
+    // clock skew; from the raw wall clock otherwise
+    static int64_t genVersion(StorageEnv* env, GraphSpaceID spaceId, PartitionID partId);
 };
 
 }  // namespace storage
@@ -14,12 +14,144 @@
 #include "codec/RowReader.h"
 #include "kvstore/CompactionFilter.h"
 #include "storage/CommonUtils.h"
+#include <rocksdb/table_properties.h>
 
 DEFINE_bool(storage_kv_mode, false, "True for kv mode");
+DEFINE_int32(max_versions_per_record, 1,
+             "How many of the newest versions of each tag/edge record a "
+             "compaction keeps; older versions are dropped");
 
 namespace nebula {
 namespace storage {
 
+/**
+ * Resolves, once per schema version, everything needed to evaluate TTL
+ * on an encoded row without constructing a reader: the byte offset of
+ * the ttl column behind the version header and the expiry duration.
+ * Decoding every value through a reader makes full compactions
+ * CPU-bound on large spaces.
+ * */
+class TtlLayout final {
+public:
+    // The row never expires: its schema has no usable ttl column
+    static constexpr int64_t kNeverExpires = std::numeric_limits<int64_t>::max();
+    // The fixed-offset read does not apply; take the reader path
+    static constexpr int64_t kNeedReader = std::numeric_limits<int64_t>::min();
+
+    explicit TtlLayout(meta::SchemaManager* schemaMan) : schemaMan_(schemaMan) {}
+
+    // The absolute expiry timestamp of a vertex/edge row, in seconds
+    int64_t rowExpireTs(GraphSpaceID spaceId,
+                        size_t vIdLen,
+                        const folly::StringPiece& key,
+                        const folly::StringPiece& val) const {
+        if (val.empty()) {
+            return kNeedReader;
+        }
+        // Only rows in the v2 encoding carry the header this fast path
+        // relies on
+        auto header = static_cast<uint8_t>(val[0]);
+        if ((header & 0xF8) != 0x08) {
+            return kNeedReader;
+        }
+        size_t numVerBytes = header & 0x07;
+        if (val.size() < 1 + numVerBytes) {
+            return kNeedReader;
+        }
+        SchemaVer ver = 0;
+        ::memcpy(&ver, val.data() + 1, numVerBytes);
+
+        const Layout* layout = nullptr;
+        if (NebulaKeyUtils::isVertex(vIdLen, key)) {
+            layout = resolve(spaceId, false, NebulaKeyUtils::getTagId(vIdLen, key), ver);
+        } else if (NebulaKeyUtils::isEdge(vIdLen, key)) {
+            auto edgeType = NebulaKeyUtils::getEdgeType(vIdLen, key);
+            layout = resolve(spaceId, true, std::abs(edgeType), ver);
+        } else {
+            return kNeverExpires;
+        }
+
+        if (layout == nullptr) {
+            return kNeedReader;
+        }
+        if (!layout->hasTtl) {
+            return kNeverExpires;
+        }
+        if (!layout->fastOk) {
+            return kNeedReader;
+        }
+        size_t offset = 1 + numVerBytes + layout->relOffset;
+        if (offset + sizeof(int64_t) > val.size()) {
+            return kNeedReader;
+        }
+        int64_t v;
+        ::memcpy(&v, val.data() + offset, sizeof(v));
+        return v + layout->duration;
+    }
+
+private:
+    struct Layout {
+        bool hasTtl = false;
+        // False when the ttl column is nullable, so the null bit would
+        // have to be consulted anyway
+        bool fastOk = false;
+        // From the end of the version header to the ttl column
+        size_t relOffset = 0;
+        int64_t duration = 0;
+    };
+
+    const Layout* resolve(GraphSpaceID spaceId,
+                          bool isEdge,
+                          int32_t schemaId,
+                          SchemaVer ver) const {
+        auto cacheKey = (static_cast<int64_t>(schemaId) << 9)
+                      | (static_cast<int64_t>(isEdge) << 8)
+                      | (ver & 0xFF);
+        auto it = layouts_.find(cacheKey);
+        if (it != layouts_.end()) {
+            return &it->second;
+        }
+
+        auto schema = isEdge ? schemaMan_->getEdgeSchema(spaceId, schemaId, ver)
+                             : schemaMan_->getTagSchema(spaceId, schemaId, ver);
+        if (!schema) {
+            return nullptr;
+        }
+        Layout layout;
+        do {
+            const auto* nschema =
+                dynamic_cast<const meta::NebulaSchemaProvider*>(schema.get());
+            if (nschema == nullptr) {
+                break;
+            }
+            const auto schemaProp = nschema->getProp();
+            if (!schemaProp.get_ttl_col() || schemaProp.get_ttl_col()->empty()
+                    || !schemaProp.get_ttl_duration() || *schemaProp.get_ttl_duration() <= 0) {
+                break;
+            }
+            auto index = schema->getFieldIndex(*schemaProp.get_ttl_col());
+            if (index < 0) {
+                break;
+            }
+            auto field = schema->field(index);
+            if (field->type() != meta::cpp2::PropertyType::TIMESTAMP
+                    && field->type() != meta::cpp2::PropertyType::INT64) {
+                break;
+            }
+            layout.hasTtl = true;
+            layout.duration = *schemaProp.get_ttl_duration();
+            layout.fastOk = !field->nullable();
+            size_t numNullables = schema->getNumNullableFields();
+            size_t numNullBytes = numNullables > 0 ? ((numNullables - 1) >> 3) + 1 : 0;
+            layout.relOffset = numNullBytes + field->offset();
+        } while (false);
+        return &layouts_.emplace(cacheKey, layout).first->second;
+    }
+
+    mutable std::unordered_map<int64_t, Layout> layouts_;
+    meta::SchemaManager* schemaMan_;
+};
+
 class StorageCompactionFilter final : public kvstore::KVFilter {
 public:
     StorageCompactionFilter(meta::SchemaManager* schemaMan,
@@ -27,10 +159,33 @@ public:
                             size_t vIdLen)
         : schemaMan_(schemaMan)
         , indexMan_(indexMan)
-        , vIdLen_(vIdLen) {
+        , vIdLen_(vIdLen)
+        , ttlLayout_(schemaMan) {
         CHECK_NOTNULL(schemaMan_);
     }
 
+    ~StorageCompactionFilter() {
+        if (expiredKeys_ > 0) {
+            totalExpiredKeys().fetch_add(expiredKeys_, std::memory_order_relaxed);
+            totalExpiredBytes().fetch_add(expiredBytes_, std::memory_order_relaxed);
+            LOG(INFO) << "Compaction reclaimed " << expiredKeys_ << " expired records, "
+                      << expiredBytes_ << " bytes ("
+                      << totalExpiredBytes().load(std::memory_order_relaxed)
+                      << " bytes since start)";
+        }
+    }
+
+    // Cumulative over all compactions since the process started
+    static std::atomic<uint64_t>& totalExpiredKeys() {
+        static std::atomic<uint64_t> cnt{0};
+        return cnt;
+    }
+
+    static std::atomic<uint64_t>& totalExpiredBytes() {
+        static std::atomic<uint64_t> cnt{0};
+        return cnt;
+    }
+
     bool filter(GraphSpaceID spaceId,
                 const folly::StringPiece& key,
                 const folly::StringPiece& val) const override {
@@ -48,6 +203,8 @@ public:
             }
             if (!ttlValid(spaceId, key, val)) {
                 VLOG(3) << "TTL invalid for key " << key;
+                expiredKeys_++;
+                expiredBytes_ += key.size() + val.size();
                 return true;
             }
             if (filterVersions(key)) {
@@ -98,6 +255,15 @@ public:
 
     bool ttlValid(GraphSpaceID spaceId, const folly::StringPiece& key,
                   const folly::StringPiece& val) const {
+        auto expireTs = ttlLayout_.rowExpireTs(spaceId, vIdLen_, key, val);
+        if (expireTs == TtlLayout::kNeverExpires) {
+            return true;
+        }
+        if (expireTs != TtlLayout::kNeedReader) {
+            return time::WallClock::fastNowInSec() <= expireTs;
+        }
+        // The layout does not admit the fixed-offset read; decode the
+        // value through a reader
         if (NebulaKeyUtils::isVertex(vIdLen_, key)) {
             auto tagId = NebulaKeyUtils::getTagId(vIdLen_, key);
             auto schema = this->schemaMan_->getTagSchema(spaceId, tagId);
@@ -105,7 +271,8 @@ public:
                 VLOG(3) << "Space " << spaceId << ", Tag " << tagId << " invalid";
                 return false;
             }
-            auto reader = nebula::RowReader::getTagPropReader(schemaMan_, spaceId, tagId, val);
+            auto reader = nebula::RowReader::getTagPropReader(schemaMan_, spaceId, tagId, val,
+                                                              &tagSchemaCache_);
             return checkDataTtlValid(schema.get(), reader.get());
         } else if (NebulaKeyUtils::isEdge(vIdLen_, key)) {
             auto edgeType = NebulaKeyUtils::getEdgeType(vIdLen_, key);
@@ -117,7 +284,8 @@ public:
             auto reader = nebula::RowReader::getEdgePropReader(schemaMan_,
                                                                spaceId,
                                                                std::abs(edgeType),
-                                                               val);
+                                                               val,
+                                                               &edgeSchemaCache_);
             return checkDataTtlValid(schema.get(), reader.get());
         }
         return true;
@@ -149,13 +317,16 @@ public:
                     schema, reader, ttlCol, ttlDuration);
     }
 
+    // Keep the newest FLAGS_max_versions_per_record versions of every
+    // record. Versions sort newest first, so within one compaction the
+    // counter sees them in age order
     bool filterVersions(const folly::StringPiece& key) const {
         folly::StringPiece keyWithNoVersion = NebulaKeyUtils::keyWithNoVersion(key);
         if (keyWithNoVersion == lastKeyWithNoVersion_) {
-            // TODO(heng): we could support max-versions configuration in schema if needed.
-            return true;
+            return ++numVersions_ > FLAGS_max_versions_per_record;
         }
         lastKeyWithNoVersion_ = keyWithNoVersion.str();
+        numVersions_ = 1;
         return false;
     }
 
@@ -175,9 +346,120 @@ public:
 
 private:
     mutable std::string lastKeyWithNoVersion_;
+    mutable int32_t numVersions_ = 0;
     meta::SchemaManager* schemaMan_ = nullptr;
     meta::IndexManager* indexMan_ = nullptr;
     size_t vIdLen_;
+    TtlLayout ttlLayout_;
+    mutable uint64_t expiredKeys_ = 0;
+    mutable uint64_t expiredBytes_ = 0;
+    // The schemas this compaction has resolved for the reader-decoded
+    // ttl checks, so a long compaction over mixed-version rows does not
+    // ask the schema manager per row
+    mutable SchemaVerCache tagSchemaCache_;
+    mutable SchemaVerCache edgeSchemaCache_;
+};
+
+/**
+ * Records the min/max TTL expiry timestamp of the rows in each SST as
+ * user table properties. A maintenance pass can pick the files whose
+ * max expiry is behind the clock and compact just those, dropping the
+ * whole file without decoding a single row. Files holding any entry
+ * without a concrete expiry get no properties, since they can never be
+ * dropped wholesale.
+ * */
+class TtlTablePropertiesCollector final : public rocksdb::TablePropertiesCollector {
+public:
+    static constexpr const char* kMinExpireTs = "nebula.ttl.min_expire_ts";
+    static constexpr const char* kMaxExpireTs = "nebula.ttl.max_expire_ts";
+
+    TtlTablePropertiesCollector(meta::SchemaManager* schemaMan,
+                                GraphSpaceID spaceId,
+                                size_t vIdLen)
+        : ttlLayout_(schemaMan)
+        , spaceId_(spaceId)
+        , vIdLen_(vIdLen) {}
+
+    rocksdb::Status AddUserKey(const rocksdb::Slice& key,
+                               const rocksdb::Slice& value,
+                               rocksdb::EntryType type,
+                               rocksdb::SequenceNumber,
+                               uint64_t) override {
+        if (!allExpirable_) {
+            return rocksdb::Status::OK();
+        }
+        // Deletes and merges keep their own lifecycle
+        if (type != rocksdb::kEntryPut) {
+            allExpirable_ = false;
+            return rocksdb::Status::OK();
+        }
+        auto k = folly::StringPiece(key.data(), key.size());
+        if (!NebulaKeyUtils::isDataKey(k)) {
+            // System and index keys never expire
+            allExpirable_ = false;
+            return rocksdb::Status::OK();
+        }
+        auto expireTs = ttlLayout_.rowExpireTs(spaceId_, vIdLen_, k,
+                                               folly::StringPiece(value.data(), value.size()));
+        if (expireTs == TtlLayout::kNeverExpires || expireTs == TtlLayout::kNeedReader) {
+            allExpirable_ = false;
+            return rocksdb::Status::OK();
+        }
+        minExpireTs_ = std::min(minExpireTs_, expireTs);
+        maxExpireTs_ = std::max(maxExpireTs_, expireTs);
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status Finish(rocksdb::UserCollectedProperties* properties) override {
+        for (auto& prop : GetReadableProperties()) {
+            properties->emplace(prop.first, prop.second);
+        }
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::UserCollectedProperties GetReadableProperties() const override {
+        if (allExpirable_ && maxExpireTs_ >= minExpireTs_) {
+            return {{kMinExpireTs, folly::to<std::string>(minExpireTs_)},
+                    {kMaxExpireTs, folly::to<std::string>(maxExpireTs_)}};
+        }
+        return {};
+    }
+
+    const char* Name() const override {
+        return "TtlTablePropertiesCollector";
+    }
+
+private:
+    TtlLayout ttlLayout_;
+    GraphSpaceID spaceId_;
+    size_t vIdLen_;
+    bool allExpirable_ = true;
+    int64_t minExpireTs_ = std::numeric_limits<int64_t>::max();
+    int64_t maxExpireTs_ = std::numeric_limits<int64_t>::min();
+};
+
+class TtlTablePropertiesCollectorFactory final : public rocksdb::TablePropertiesCollectorFactory {
+public:
+    TtlTablePropertiesCollectorFactory(meta::SchemaManager* schemaMan,
+                                       GraphSpaceID spaceId,
+                                       size_t vIdLen)
+        : schemaMan_(schemaMan)
+        , spaceId_(spaceId)
+        , vIdLen_(vIdLen) {}
+
+    rocksdb::TablePropertiesCollector* CreateTablePropertiesCollector(
+            rocksdb::TablePropertiesCollectorFactory::Context) override {
+        return new TtlTablePropertiesCollector(schemaMan_, spaceId_, vIdLen_);
+    }
+
+    const char* Name() const override {
+        return "TtlTablePropertiesCollectorFactory";
+    }
+
+private:
+    meta::SchemaManager* schemaMan_ = nullptr;
+    GraphSpaceID spaceId_;
+    size_t vIdLen_;
 };
 
 class StorageCompactionFilterFactory final : public kvstore::KVCompactionFilterFactory {
@@ -227,6 +509,17 @@ public:
                                                                 customFilterIntervalSecs);
     }
 
+    std::shared_ptr<rocksdb::TablePropertiesCollectorFactory>
+    buildTablePropsFactory(GraphSpaceID spaceId) override {
+        auto vIdLen = schemaMan_->getSpaceVidLen(spaceId);
+        if (!vIdLen.ok()) {
+            return nullptr;
+        }
+        return std::make_shared<TtlTablePropertiesCollectorFactory>(schemaMan_,
+                                                                    spaceId,
+                                                                    vIdLen.value());
+    }
+
 private:
     meta::SchemaManager* schemaMan_ = nullptr;
     meta::IndexManager* indexMan_ = nullptr;
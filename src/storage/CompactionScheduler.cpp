@@ -0,0 +1,140 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/CompactionScheduler.h"
+#include "kvstore/RocksEngineConfig.h"
+
+DEFINE_string(compaction_offpeak_hours,
+              "",
+              "Off-peak window in local time as <HH>-<HH>, e.g. \"01-05\" or "
+              "\"23-06\" to span midnight. Inside the window the engines run "
+              "with --rocksdb_offpeak_rate_limit. Empty disables the window");
+
+DEFINE_int32(rocksdb_offpeak_rate_limit,
+             0,
+             "Write rate limit in MB/s used inside the off-peak window, "
+             "usually well above --rocksdb_rate_limit so compactions can "
+             "catch up. 0 keeps the normal limit");
+
+DEFINE_int32(compaction_latency_backoff_us,
+             0,
+             "Halve the background write rate limit whenever the moving "
+             "average request latency exceeds this many microseconds. "
+             "0 disables the latency backoff");
+
+DEFINE_int32(compaction_rate_limit_floor,
+             16,
+             "The lowest MB/s the latency backoff may throttle the "
+             "background writes down to");
+
+DEFINE_int32(compaction_check_interval_secs,
+             10,
+             "How often the compaction scheduler re-evaluates the rate limit");
+
+namespace nebula {
+namespace storage {
+
+// static
+ThreadCachedCounter& CompactionScheduler::latencySumUs() {
+    static ThreadCachedCounter sum;
+    return sum;
+}
+
+// static
+ThreadCachedCounter& CompactionScheduler::latencyCount() {
+    static ThreadCachedCounter count;
+    return count;
+}
+
+bool CompactionScheduler::start() {
+    if (FLAGS_rocksdb_rate_limit <= 0) {
+        LOG(INFO) << "No rate limiter installed (--rocksdb_rate_limit is off), "
+                  << "compaction scheduler not started";
+        return true;
+    }
+    currentRateMB_ = FLAGS_rocksdb_rate_limit;
+    bgThread_ = std::make_unique<thread::GenericWorker>();
+    if (!bgThread_->start()) {
+        LOG(ERROR) << "Failed to start the compaction scheduler thread";
+        return false;
+    }
+    bgThread_->addRepeatTask(FLAGS_compaction_check_interval_secs * 1000,
+                             &CompactionScheduler::tick,
+                             this);
+    LOG(INFO) << "Compaction scheduler started";
+    return true;
+}
+
+void CompactionScheduler::stop() {
+    if (bgThread_) {
+        bgThread_->stop();
+        bgThread_->wait();
+        bgThread_.reset();
+    }
+}
+
+// static
+bool CompactionScheduler::inOffpeakWindow() {
+    if (FLAGS_compaction_offpeak_hours.empty()) {
+        return false;
+    }
+    int32_t from, to;
+    if (sscanf(FLAGS_compaction_offpeak_hours.c_str(), "%d-%d", &from, &to) != 2
+            || from < 0 || from > 23 || to < 0 || to > 23) {
+        LOG_EVERY_N(ERROR, 100) << "Malformed --compaction_offpeak_hours \""
+                                << FLAGS_compaction_offpeak_hours << "\"";
+        return false;
+    }
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    if (from <= to) {
+        return local.tm_hour >= from && local.tm_hour < to;
+    }
+    // The window spans midnight
+    return local.tm_hour >= from || local.tm_hour < to;
+}
+
+void CompactionScheduler::tick() {
+    auto target = FLAGS_rocksdb_rate_limit;
+    if (inOffpeakWindow() && FLAGS_rocksdb_offpeak_rate_limit > 0) {
+        target = FLAGS_rocksdb_offpeak_rate_limit;
+    }
+
+    // Drain the per-thread latency slabs into one window and blend it
+    // into the moving average, so the request threads never touched
+    // anything shared to report
+    auto sumUs = latencySumUs().read();
+    auto count = latencyCount().read();
+    if (count > seenLatencyCount_) {
+        auto windowAvg = static_cast<uint64_t>(
+            (sumUs - seenLatencySumUs_) / (count - seenLatencyCount_));
+        avgLatencyUs_ = (avgLatencyUs_ * 3 + windowAvg) / 4;
+    }
+    seenLatencySumUs_ = sumUs;
+    seenLatencyCount_ = count;
+
+    auto avgUs = avgLatencyUs_;
+    if (FLAGS_compaction_latency_backoff_us > 0
+            && avgUs > static_cast<uint64_t>(FLAGS_compaction_latency_backoff_us)) {
+        // Multiplicative decrease while the foreground suffers
+        target = std::max(FLAGS_compaction_rate_limit_floor, currentRateMB_ / 2);
+    } else if (currentRateMB_ < target) {
+        // Additive recovery, so a single good interval does not swing
+        // the limit all the way back up
+        target = std::min(target, currentRateMB_ + std::max(target / 8, 1));
+    }
+
+    if (target != currentRateMB_) {
+        LOG(INFO) << "Adjust background write rate limit from " << currentRateMB_
+                  << "MB/s to " << target << "MB/s (avg latency " << avgUs << "us)";
+        currentRateMB_ = target;
+        store_->setEngineRateLimit(currentRateMB_);
+    }
+}
+
+}  // namespace storage
+}  // namespace nebula
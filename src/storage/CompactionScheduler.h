@@ -0,0 +1,80 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_COMPACTIONSCHEDULER_H_
+#define STORAGE_COMPACTIONSCHEDULER_H_
+
+#include "common/base/Base.h"
+#include "common/thread/GenericWorker.h"
+#include "kvstore/NebulaStore.h"
+#include "utils/ThreadCachedCounter.h"
+
+namespace nebula {
+namespace storage {
+
+/**
+ * Keeps the background write rate limit of the engines in step with the
+ * foreground load, so compaction debt stays bounded without crushing the
+ * read p99:
+ *
+ * - inside the off-peak window (--compaction_offpeak_hours) the limit is
+ *   raised to --rocksdb_offpeak_rate_limit, letting compactions catch up
+ *   while nobody is looking;
+ * - whenever the moving average request latency reported by the
+ *   processors exceeds --compaction_latency_backoff_us, the limit is
+ *   halved (down to --compaction_rate_limit_floor), and recovers
+ *   additively once the latency is back to normal.
+ *
+ * Only active when the engines were opened with a rate limiter, i.e.
+ * --rocksdb_rate_limit > 0.
+ * */
+class CompactionScheduler final {
+public:
+    explicit CompactionScheduler(kvstore::NebulaStore* store) : store_(store) {}
+
+    ~CompactionScheduler() {
+        stop();
+    }
+
+    bool start();
+
+    void stop();
+
+    // Called by the processors with the latency of every finished
+    // request. The increments land on per-thread slabs, so the busiest
+    // path of the process does not serialize on one shared cache line;
+    // tick() drains the slabs into the moving average the backoff is
+    // based on
+    static void reportLatency(uint64_t latencyUs) {
+        latencySumUs().add(latencyUs);
+        latencyCount().add(1);
+    }
+
+private:
+    void tick();
+
+    // Whether the local time is inside --compaction_offpeak_hours
+    static bool inOffpeakWindow();
+
+    static ThreadCachedCounter& latencySumUs();
+    static ThreadCachedCounter& latencyCount();
+
+    kvstore::NebulaStore* store_{nullptr};
+    std::unique_ptr<thread::GenericWorker> bgThread_;
+    // The limit currently installed on the engines, in MB/s
+    int32_t currentRateMB_{0};
+    // The counter totals tick() has drained so far, and the moving
+    // average blended from the per-tick windows; only the tick thread
+    // touches them
+    int64_t seenLatencySumUs_{0};
+    int64_t seenLatencyCount_{0};
+    uint64_t avgLatencyUs_{0};
+};
+
+}  // namespace storage
+}  // namespace nebula
+
+#endif  // STORAGE_COMPACTIONSCHEDULER_H_
@@ -5,6 +5,8 @@
  */
 
 #include "storage/GraphStorageServiceHandler.h"
+#include "common/time/WallClock.h"
+#include "utils/RequestTrace.h"
 #include "storage/mutate/AddVerticesProcessor.h"
 #include "storage/mutate/AddEdgesProcessor.h"
 #include "storage/mutate/DeleteVerticesProcessor.h"
@@ -19,59 +21,144 @@
     processor->process(req); \
     return f;
 
+#define RETURN_READ_FUTURE(processor) \
+    auto start = time::WallClock::fastNowInMicroSec(); \
+    auto f = processor->getFuture().ensure([this, start] { \
+        admission_.leaveRead(time::WallClock::fastNowInMicroSec() - start); \
+    }); \
+    processor->process(req); \
+    return f;
+
+#define RETURN_WRITE_FUTURE(processor) \
+    auto f = processor->getFuture().ensure([this] { \
+        admission_.leaveWrite(); \
+    }); \
+    processor->process(req); \
+    return f;
+
 namespace nebula {
 namespace storage {
 
+namespace {
+
+// Fails every part of a rejected request with E_CONSENSUS_ERROR - the
+// code raft returns when its log buffer is full, which clients already
+// retry with backoff - since the interface has no dedicated code for
+// admission rejection
+template<typename RESP>
+folly::Future<RESP> rejected(const std::vector<PartitionID>& parts) {
+    cpp2::ResponseCommon result;
+    std::vector<cpp2::PartitionResult> failedParts;
+    failedParts.reserve(parts.size());
+    for (auto partId : parts) {
+        cpp2::PartitionResult thriftRet;
+        thriftRet.set_code(cpp2::ErrorCode::E_CONSENSUS_ERROR);
+        thriftRet.set_part_id(partId);
+        failedParts.emplace_back(std::move(thriftRet));
+    }
+    result.set_latency_in_us(0);
+    result.set_failed_parts(std::move(failedParts));
+    RESP resp;
+    resp.set_result(std::move(result));
+    return folly::makeFuture<RESP>(std::move(resp));
+}
+
+template<typename REQ>
+std::vector<PartitionID> partsOf(const REQ& req) {
+    std::vector<PartitionID> parts;
+    parts.reserve(req.get_parts().size());
+    for (const auto& entry : req.get_parts()) {
+        parts.emplace_back(entry.first);
+    }
+    return parts;
+}
+
+}  // anonymous namespace
+
 // Vertice section
 folly::Future<cpp2::ExecResponse>
 GraphStorageServiceHandler::future_addVertices(const cpp2::AddVerticesRequest& req) {
-    auto* processor = AddVerticesProcessor::instance(env_, &addVerticesQpsStat_, &vertexCache_);
-    RETURN_FUTURE(processor);
+    if (!admission_.tryEnterWrite()) {
+        return rejected<cpp2::ExecResponse>(partsOf(req));
+    }
+    RequestTrace::maybeStart("addVertices");
+    auto* processor = AddVerticesProcessor::instance(env_, &addVerticesQpsStat_, vertexCache_);
+    RETURN_WRITE_FUTURE(processor);
 }
 
 folly::Future<cpp2::ExecResponse>
 GraphStorageServiceHandler::future_deleteVertices(const cpp2::DeleteVerticesRequest& req) {
-    auto* processor = DeleteVerticesProcessor::instance(env_, &delVerticesQpsStat_, &vertexCache_);
-    RETURN_FUTURE(processor);
+    if (!admission_.tryEnterWrite()) {
+        return rejected<cpp2::ExecResponse>(partsOf(req));
+    }
+    auto* processor = DeleteVerticesProcessor::instance(env_, &delVerticesQpsStat_, vertexCache_);
+    RETURN_WRITE_FUTURE(processor);
 }
 
 folly::Future<cpp2::UpdateResponse>
 GraphStorageServiceHandler::future_updateVertex(const cpp2::UpdateVertexRequest& req) {
-    auto* processor = UpdateVertexProcessor::instance(env_, &updateVertexQpsStat_, &vertexCache_);
-    RETURN_FUTURE(processor);
+    if (!admission_.tryEnterWrite()) {
+        return rejected<cpp2::UpdateResponse>({req.get_part_id()});
+    }
+    auto* processor = UpdateVertexProcessor::instance(env_, &updateVertexQpsStat_, vertexCache_);
+    RETURN_WRITE_FUTURE(processor);
 }
 
 // Edge section
 folly::Future<cpp2::ExecResponse>
 GraphStorageServiceHandler::future_addEdges(const cpp2::AddEdgesRequest& req) {
-    auto* processor = AddEdgesProcessor::instance(env_, &addEdgesQpsStat_);
-    RETURN_FUTURE(processor);
+    if (!admission_.tryEnterWrite()) {
+        return rejected<cpp2::ExecResponse>(partsOf(req));
+    }
+    RequestTrace::maybeStart("addEdges");
+    auto* processor = AddEdgesProcessor::instance(env_, &addEdgesQpsStat_, degreeCache_.get());
+    RETURN_WRITE_FUTURE(processor);
 }
 
 folly::Future<cpp2::ExecResponse>
 GraphStorageServiceHandler::future_deleteEdges(const cpp2::DeleteEdgesRequest& req) {
+    if (!admission_.tryEnterWrite()) {
+        return rejected<cpp2::ExecResponse>(partsOf(req));
+    }
     auto* processor = DeleteEdgesProcessor::instance(env_, &delEdgesQpsStat_);
-    RETURN_FUTURE(processor);
+    RETURN_WRITE_FUTURE(processor);
 }
 
 folly::Future<cpp2::UpdateResponse>
 GraphStorageServiceHandler::future_updateEdge(const cpp2::UpdateEdgeRequest& req) {
+    if (!admission_.tryEnterWrite()) {
+        return rejected<cpp2::UpdateResponse>({req.get_part_id()});
+    }
     auto* processor = UpdateEdgeProcessor::instance(env_, &updateEdgeQpsStat_);
-    RETURN_FUTURE(processor);
+    RETURN_WRITE_FUTURE(processor);
 }
 
 folly::Future<cpp2::GetNeighborsResponse>
 GraphStorageServiceHandler::future_getNeighbors(const cpp2::GetNeighborsRequest& req) {
+    if (!admission_.tryEnterRead()) {
+        return rejected<cpp2::GetNeighborsResponse>(partsOf(req));
+    }
+    stats::Stats::addStatsValue(&readerQueueDepthStat_, true,
+                                static_cast<int64_t>(readerPool_->getPendingTaskCount()));
+    RequestTrace::maybeStart("getNeighbors");
     auto* processor = GetNeighborsProcessor::instance(env_,
                                                       &getNeighborsQpsStat_,
-                                                      &vertexCache_);
-    RETURN_FUTURE(processor);
+                                                      vertexCache_,
+                                                      readerPool_.get(),
+                                                      degreeCache_.get(),
+                                                      readerLanes_.get(),
+                                                      neighborsResultCache_.get());
+    RETURN_READ_FUTURE(processor);
 }
 
 folly::Future<cpp2::GetPropResponse>
 GraphStorageServiceHandler::future_getProps(const cpp2::GetPropRequest& req) {
-    auto* processor = GetPropProcessor::instance(env_, &getPropQpsStat_, &vertexCache_);
-    RETURN_FUTURE(processor);
+    if (!admission_.tryEnterRead()) {
+        return rejected<cpp2::GetPropResponse>(partsOf(req));
+    }
+    RequestTrace::maybeStart("getProps");
+    auto* processor = GetPropProcessor::instance(env_, &getPropQpsStat_, vertexCache_);
+    RETURN_READ_FUTURE(processor);
 }
 
 }  // namespace storage
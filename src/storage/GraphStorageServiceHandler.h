@@ -11,8 +11,11 @@
 #include "common/stats/Stats.h"
 #include "common/stats/StatsManager.h"
 #include "common/interface/gen-cpp2/GraphStorageService.h"
-#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include "storage/AdmissionControl.h"
 #include "storage/CommonUtils.h"
+#include "storage/ReaderLanes.h"
 #include "storage/StorageFlags.h"
 
 namespace nebula {
@@ -22,10 +25,25 @@ class StorageEnv;
 
 class GraphStorageServiceHandler final : public cpp2::GraphStorageServiceSvIf {
 public:
-    explicit GraphStorageServiceHandler(StorageEnv* env)
+    explicit GraphStorageServiceHandler(StorageEnv* env, VertexCache* vertexCache = nullptr)
         : env_(env)
-        , vertexCache_(FLAGS_vertex_cache_num, FLAGS_vertex_cache_bucket_exp)
-        , readerPool_(std::make_unique<folly::IOThreadPoolExecutor>(FLAGS_reader_handlers)) {
+        , vertexCache_(vertexCache)
+        , readerPool_(std::make_unique<folly::CPUThreadPoolExecutor>(
+              FLAGS_reader_handlers > 0 ? FLAGS_reader_handlers
+                                        : std::thread::hardware_concurrency(),
+              std::make_shared<folly::NamedThreadFactory>("storage-reader"))) {
+        if (FLAGS_reader_executor_lanes > 0) {
+            readerLanes_ = std::make_unique<ReaderLanes>();
+        }
+        if (FLAGS_reservoir_sampling_degree_threshold > 0) {
+            degreeCache_ = std::make_unique<DegreeCache>(FLAGS_degree_cache_num,
+                                                         FLAGS_vertex_cache_bucket_exp);
+        }
+        if (FLAGS_neighbors_result_cache_ttl_ms > 0) {
+            neighborsResultCache_ = std::make_unique<NeighborsResultCache>(
+                    FLAGS_neighbors_result_cache_num,
+                    FLAGS_vertex_cache_bucket_exp);
+        }
         addVerticesQpsStat_ = stats::Stats("storage", "add_vertices");
         addEdgesQpsStat_ = stats::Stats("storage", "add_edges");
         delVerticesQpsStat_ = stats::Stats("storage", "del_vertices");
@@ -34,6 +52,7 @@ public:
         updateEdgeQpsStat_ = stats::Stats("storage", "update_edge");
         getNeighborsQpsStat_ = stats::Stats("storage", "get_neighbors");
         getPropQpsStat_ = stats::Stats("storage", "get_prop");
+        readerQueueDepthStat_ = stats::Stats("storage", "reader_queue_depth");
     }
 
     // Vertice section
@@ -64,8 +83,19 @@ public:
 
 private:
     StorageEnv*                                     env_{nullptr};
-    VertexCache                                     vertexCache_;
-    std::unique_ptr<folly::IOThreadPoolExecutor>    readerPool_;
+    // Owned by the server; null when --enable_vertex_cache is off
+    VertexCache*                                    vertexCache_{nullptr};
+    // Plan execution runs here, decoupled from the thrift workers that
+    // decode and validate the requests
+    std::unique_ptr<folly::CPUThreadPoolExecutor>   readerPool_;
+    // Part-pinned single-threaded lanes for the read path; null unless
+    // --reader_executor_lanes is set
+    std::unique_ptr<ReaderLanes>                    readerLanes_;
+    // Null unless --reservoir_sampling_degree_threshold is set
+    std::unique_ptr<DegreeCache>                    degreeCache_;
+    // Null unless --neighbors_result_cache_ttl_ms is set
+    std::unique_ptr<NeighborsResultCache>           neighborsResultCache_;
+    AdmissionControl                                admission_;
 
     stats::Stats                                    addVerticesQpsStat_;
     stats::Stats                                    addEdgesQpsStat_;
@@ -75,6 +105,8 @@ private:
     stats::Stats                                    updateEdgeQpsStat_;
     stats::Stats                                    getNeighborsQpsStat_;
     stats::Stats                                    getPropQpsStat_;
+    // Sampled reader pool backlog, for sizing --reader_handlers
+    stats::Stats                                    readerQueueDepthStat_;
 };
 
 }  // namespace storage
@@ -0,0 +1,149 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_KEYLOCKMAP_H_
+#define STORAGE_KEYLOCKMAP_H_
+
+#include "common/base/Base.h"
+#include <condition_variable>
+
+namespace nebula {
+namespace storage {
+
+/**
+ * A sharded table of write-intent latches keyed by the exact
+ * vertex/edge key an update touches. Non-conflicting updates inside one
+ * partition proceed concurrently through the normal batched log path,
+ * and only same-key updates serialize - instead of every conditional
+ * update serializing on the per-part atomic op queue.
+ * */
+class KeyLockMap final {
+public:
+    // Row state a releasing holder can pass to the next queued holder
+    // of the same latch: the newest versioned data key of the row it
+    // wrote and the encoded value, exactly what a fresh engine read
+    // would return once its batch commits. It only survives while
+    // someone is queued, so nothing stale outlives a latch chain
+    struct Handoff {
+        std::string key;
+        std::string row;
+    };
+
+    // Block until the key is latched by the caller
+    void lock(const std::string& key) {
+        auto& shard = shards_[shardIdx(key)];
+        std::unique_lock<std::mutex> guard(shard.mutex);
+        auto& entry = shard.keys[key];
+        if (!entry.held) {
+            entry.held = true;
+            return;
+        }
+        entry.waiters++;
+        // While we wait, the entry cannot be erased - unlock keeps it
+        // alive as long as waiters are registered. It can still move on
+        // a rehash, so look it up again instead of holding a reference
+        shard.cv.wait(guard, [&shard, &key] {
+            return !shard.keys.find(key)->second.held;
+        });
+        auto& woken = shard.keys.find(key)->second;
+        woken.waiters--;
+        woken.held = true;
+    }
+
+    void unlock(const std::string& key) {
+        unlock(key, nullptr);
+    }
+
+    // Release the key, leaving `handoff` for the next queued holder.
+    // Dropped when nobody is queued. Releasing without a handoff also
+    // clears whatever the previous holder left, so a holder that wrote
+    // the key through another path never lets a stale row survive it
+    void unlock(const std::string& key, std::unique_ptr<Handoff> handoff) {
+        auto& shard = shards_[shardIdx(key)];
+        {
+            std::lock_guard<std::mutex> guard(shard.mutex);
+            auto it = shard.keys.find(key);
+            DCHECK(it != shard.keys.end());
+            it->second.held = false;
+            if (it->second.waiters == 0) {
+                shard.keys.erase(it);
+            } else {
+                it->second.handoff = std::move(handoff);
+            }
+        }
+        shard.cv.notify_all();
+    }
+
+    // Take the row state the previous holder left, if any. Only the
+    // current holder of the key may call this
+    std::unique_ptr<Handoff> takeHandoff(const std::string& key) {
+        auto& shard = shards_[shardIdx(key)];
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        auto it = shard.keys.find(key);
+        if (it == shard.keys.end()) {
+            return nullptr;
+        }
+        return std::move(it->second.handoff);
+    }
+
+private:
+    // Power of two, so shardIdx is a mask
+    static constexpr size_t kShardNum = 64;
+
+    struct Entry {
+        bool held = false;
+        int32_t waiters = 0;
+        std::unique_ptr<Handoff> handoff;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::unordered_map<std::string, Entry> keys;
+    };
+
+    static size_t shardIdx(const std::string& key) {
+        return std::hash<std::string>()(key) & (kShardNum - 1);
+    }
+
+    Shard shards_[kShardNum];
+};
+
+
+class KeyLockGuard final {
+public:
+    KeyLockGuard(KeyLockMap* lockMap, std::string key)
+        : lockMap_(lockMap)
+        , key_(std::move(key)) {
+        lockMap_->lock(key_);
+    }
+
+    ~KeyLockGuard() {
+        lockMap_->unlock(key_, std::move(handoff_));
+    }
+
+    // Take the row state the previous holder left for this key
+    std::unique_ptr<KeyLockMap::Handoff> takeHandoff() {
+        return lockMap_->takeHandoff(key_);
+    }
+
+    // Leave row state for the next queued holder when the latch releases
+    void handoffOnRelease(std::unique_ptr<KeyLockMap::Handoff> handoff) {
+        handoff_ = std::move(handoff);
+    }
+
+    KeyLockGuard(const KeyLockGuard&) = delete;
+    KeyLockGuard& operator=(const KeyLockGuard&) = delete;
+
+private:
+    KeyLockMap* lockMap_;
+    std::string key_;
+    std::unique_ptr<KeyLockMap::Handoff> handoff_;
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_KEYLOCKMAP_H_
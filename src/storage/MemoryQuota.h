@@ -0,0 +1,114 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_MEMORYQUOTA_H_
+#define STORAGE_MEMORYQUOTA_H_
+
+#include "common/base/Base.h"
+#include "common/datatypes/Value.h"
+#include "common/stats/Stats.h"
+#include "storage/StorageFlags.h"
+
+namespace nebula {
+namespace storage {
+
+/**
+ * Memory accounting of one request. The processors charge the rows
+ * they buffer against a per-request budget and a process-wide one, so
+ * a single unselective request fails with a specific code instead of
+ * growing until the kernel kills the process. The accounting is an
+ * estimate - the encoded and decoded sizes of what the request holds
+ * on to - not an allocator; allocations outside the buffered results
+ * are not seen, which keeps the charge a single add on the hot row
+ * path.
+ *
+ * The counters are relaxed atomics and the high-water marks are kept
+ * racily, like the admission control signals: a quota is a protection
+ * bound, not a ledger. The per-request peak is fed into the
+ * storage.request_memory_bytes stat when the quota dies with its
+ * request.
+ * */
+class MemoryQuota final {
+public:
+    MemoryQuota() = default;
+
+    ~MemoryQuota() {
+        globalUsedBytes().fetch_sub(used_.load(std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+        recordPeak(peak_.load(std::memory_order_relaxed));
+    }
+
+    // Charge bytes against both budgets. Returns false when either is
+    // exceeded; the charge is kept regardless, the caller is expected
+    // to abort the request, which releases it
+    bool charge(int64_t bytes) {
+        auto used = used_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (used > peak_.load(std::memory_order_relaxed)) {
+            peak_.store(used, std::memory_order_relaxed);
+        }
+        auto global = globalUsedBytes().fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto requestLimit = FLAGS_request_memory_quota_mb * 1024 * 1024;
+        if (requestLimit > 0 && used > requestLimit) {
+            return false;
+        }
+        auto globalLimit = FLAGS_total_request_memory_quota_mb * 1024 * 1024;
+        if (globalLimit > 0 && global > globalLimit) {
+            return false;
+        }
+        return true;
+    }
+
+    int64_t used() const {
+        return used_.load(std::memory_order_relaxed);
+    }
+
+    int64_t peak() const {
+        return peak_.load(std::memory_order_relaxed);
+    }
+
+    // What every in-flight request holds together, process wide
+    static std::atomic<int64_t>& globalUsedBytes() {
+        static std::atomic<int64_t> usedBytes{0};
+        return usedBytes;
+    }
+
+    // The approximate footprint of a buffered value: the fixed Value
+    // slot plus the heap payload of strings and lists. Deliberately
+    // shallow on anything else - the bound protects against the bulk
+    // cases, edge prop lists and property strings
+    static int64_t estimate(const Value& value) {
+        int64_t bytes = sizeof(Value);
+        if (value.type() == Value::Type::STRING) {
+            bytes += value.getStr().size();
+        } else if (value.type() == Value::Type::LIST) {
+            for (const auto& inner : value.getList().values) {
+                bytes += estimate(inner);
+            }
+        }
+        return bytes;
+    }
+
+    static int64_t estimate(const std::vector<Value>& row) {
+        int64_t bytes = 0;
+        for (const auto& value : row) {
+            bytes += estimate(value);
+        }
+        return bytes;
+    }
+
+private:
+    static void recordPeak(int64_t peakBytes) {
+        static stats::Stats requestMemoryStat("storage", "request_memory_bytes");
+        stats::Stats::addStatsValue(&requestMemoryStat, true, peakBytes);
+    }
+
+    std::atomic<int64_t> used_{0};
+    std::atomic<int64_t> peak_{0};
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_MEMORYQUOTA_H_
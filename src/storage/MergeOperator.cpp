@@ -0,0 +1,185 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/MergeOperator.h"
+
+namespace nebula {
+namespace storage {
+
+namespace {
+
+constexpr size_t kOpSize = sizeof(uint32_t) + sizeof(int64_t);
+
+// The header prefix of a well-formed operand, or an empty piece
+folly::StringPiece patchHeader(const rocksdb::Slice& operand) {
+    if (operand.size() < 3 || operand[0] != kRowPatchMagic) {
+        return folly::StringPiece();
+    }
+    size_t hdrLen = static_cast<uint8_t>(operand[1]);
+    if (operand.size() < 2 + hdrLen + 1) {
+        return folly::StringPiece();
+    }
+    size_t count = static_cast<uint8_t>(operand[2 + hdrLen]);
+    if (operand.size() != 2 + hdrLen + 1 + count * kOpSize) {
+        return folly::StringPiece();
+    }
+    return folly::StringPiece(operand.data() + 2, hdrLen);
+}
+
+}  // Anonymous namespace
+
+
+std::string encodeRowPatch(const std::string& rowHeader, const std::vector<RowPatchOp>& ops) {
+    CHECK_LE(rowHeader.size(), std::numeric_limits<uint8_t>::max());
+    CHECK_LE(ops.size(), std::numeric_limits<uint8_t>::max());
+    std::string patch;
+    patch.reserve(3 + rowHeader.size() + ops.size() * kOpSize);
+    patch.append(1, kRowPatchMagic);
+    patch.append(1, static_cast<char>(rowHeader.size()));
+    patch.append(rowHeader);
+    patch.append(1, static_cast<char>(ops.size()));
+    for (const auto& op : ops) {
+        patch.append(reinterpret_cast<const char*>(&op.offset), sizeof(op.offset));
+        patch.append(reinterpret_cast<const char*>(&op.delta), sizeof(op.delta));
+    }
+    return patch;
+}
+
+
+bool applyRowPatch(const rocksdb::Slice& operand, std::string* row) {
+    auto hdr = patchHeader(operand);
+    if (hdr.empty()) {
+        return false;
+    }
+    // Offsets were computed against this schema version; a row written
+    // with a different version lays its fields out differently
+    if (row->size() < hdr.size()
+            || ::memcmp(row->data(), hdr.data(), hdr.size()) != 0) {
+        return false;
+    }
+
+    const char* cur = operand.data() + 2 + hdr.size() + 1;
+    size_t count = static_cast<uint8_t>(operand[2 + hdr.size()]);
+    // Validate every offset before touching the row, so a bad patch
+    // leaves it untouched
+    for (size_t i = 0; i < count; i++) {
+        uint32_t offset;
+        ::memcpy(&offset, cur + i * kOpSize, sizeof(offset));
+        if (offset + sizeof(int64_t) > row->size()) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t offset;
+        int64_t delta;
+        ::memcpy(&offset, cur + i * kOpSize, sizeof(offset));
+        ::memcpy(&delta, cur + i * kOpSize + sizeof(offset), sizeof(delta));
+        int64_t val;
+        ::memcpy(&val, row->data() + offset, sizeof(val));
+        val += delta;
+        ::memcpy(&(*row)[offset], &val, sizeof(val));
+    }
+    return true;
+}
+
+
+std::string encodeCounterDelta(int64_t delta) {
+    std::string operand;
+    operand.reserve(1 + sizeof(delta));
+    operand.append(1, kCounterMagic);
+    operand.append(reinterpret_cast<const char*>(&delta), sizeof(delta));
+    return operand;
+}
+
+
+folly::Optional<int64_t> counterDelta(const rocksdb::Slice& operand) {
+    if (operand.size() != 1 + sizeof(int64_t) || operand[0] != kCounterMagic) {
+        return folly::none;
+    }
+    int64_t delta;
+    ::memcpy(&delta, operand.data() + 1, sizeof(delta));
+    return delta;
+}
+
+
+bool NebulaOperator::FullMergeV2(const MergeOperationInput& merge_in,
+                                 MergeOperationOutput* merge_out) const {
+    if (!merge_in.operand_list.empty() &&
+            counterDelta(merge_in.operand_list.front()).hasValue()) {
+        // Counter merge: sum the deltas onto the base value. Unlike a
+        // row patch, a missing base is the normal first increment
+        int64_t value = 0;
+        if (merge_in.existing_value != nullptr &&
+                merge_in.existing_value->size() == sizeof(value)) {
+            ::memcpy(&value, merge_in.existing_value->data(), sizeof(value));
+        }
+        for (const auto& operand : merge_in.operand_list) {
+            auto delta = counterDelta(operand);
+            if (delta.hasValue()) {
+                value += delta.value();
+            } else {
+                LOG(ERROR) << "Malformed counter operand dropped";
+            }
+        }
+        merge_out->new_value.assign(reinterpret_cast<const char*>(&value), sizeof(value));
+        return true;
+    }
+    if (merge_in.existing_value == nullptr) {
+        // A patch cannot create a row: the base was removed between the
+        // existence check on the write path and this merge. Resolve to
+        // an empty value, which readers already treat as illegal data
+        LOG(ERROR) << "Row patch merge without a base row, dropping "
+                   << merge_in.operand_list.size() << " operands";
+        merge_out->new_value.clear();
+        return true;
+    }
+    merge_out->new_value.assign(merge_in.existing_value->data(),
+                                merge_in.existing_value->size());
+    for (const auto& operand : merge_in.operand_list) {
+        if (!applyRowPatch(operand, &merge_out->new_value)) {
+            // Usually a schema version bump between write and merge;
+            // keep the row, drop the patch
+            LOG(ERROR) << "Inapplicable row patch dropped";
+        }
+    }
+    return true;
+}
+
+
+bool NebulaOperator::PartialMerge(const rocksdb::Slice& key, const rocksdb::Slice& left_operand,
+                                  const rocksdb::Slice& right_operand, std::string* new_value,
+                                  rocksdb::Logger* logger) const {
+    UNUSED(key);
+    UNUSED(logger);
+    auto leftDelta = counterDelta(left_operand);
+    auto rightDelta = counterDelta(right_operand);
+    if (leftDelta.hasValue() && rightDelta.hasValue()) {
+        // Increments commute, two deltas fold into one
+        *new_value = encodeCounterDelta(leftDelta.value() + rightDelta.value());
+        return true;
+    }
+    auto leftHdr = patchHeader(left_operand);
+    auto rightHdr = patchHeader(right_operand);
+    if (leftHdr.empty() || rightHdr.empty() || leftHdr != rightHdr) {
+        // Keep the operands separate, FullMergeV2 sorts them out
+        return false;
+    }
+    size_t leftCount = static_cast<uint8_t>(left_operand[2 + leftHdr.size()]);
+    size_t rightCount = static_cast<uint8_t>(right_operand[2 + rightHdr.size()]);
+    if (leftCount + rightCount > std::numeric_limits<uint8_t>::max()) {
+        return false;
+    }
+    // Increments commute, so two patches against the same schema
+    // version combine by concatenating their ops
+    new_value->assign(left_operand.data(), left_operand.size());
+    (*new_value)[2 + leftHdr.size()] = static_cast<char>(leftCount + rightCount);
+    new_value->append(right_operand.data() + 2 + rightHdr.size() + 1,
+                      rightCount * kOpSize);
+    return true;
+}
+
+}  // namespace storage
+}  // namespace nebula
@@ -13,6 +13,56 @@
 namespace nebula {
 namespace storage {
 
+// The first byte of a row patch operand. Encoded rows start with a
+// version header in 0x00..0x0F, so a patch can never be mistaken for
+// a full row
+constexpr char kRowPatchMagic = '\xF6';
+
+// The first byte of a counter delta operand: magic(1) | delta(8).
+// Applied to values that are a plain little-endian int64, e.g. the
+// per-(vertex, edgeType) degree counters; an absent base counts as 0
+constexpr char kCounterMagic = '\xF7';
+
+// One in-place increment on a fixed-size integer field of an encoded
+// row, at its absolute byte offset
+struct RowPatchOp {
+    uint32_t offset;
+    int64_t delta;
+};
+
+/**
+ * Build a merge operand patching an encoded row in place:
+ *
+ *   magic(1) | hdrLen(1) | hdr | count(1) | count * (offset(4) | delta(8))
+ *
+ * hdr is the header + schema version prefix every row written with the
+ * same schema version starts with. Field offsets depend on the schema
+ * version, so a patch only applies to rows carrying an identical
+ * prefix; NebulaOperator drops it otherwise.
+ * */
+std::string encodeRowPatch(const std::string& rowHeader, const std::vector<RowPatchOp>& ops);
+
+// Apply one patch operand onto the encoded row in place. Returns false
+// without touching the row when the operand is malformed, the header
+// prefix does not match, or an offset falls outside the row
+bool applyRowPatch(const rocksdb::Slice& operand, std::string* row);
+
+// Build a counter delta operand adding `delta' to an int64 value
+std::string encodeCounterDelta(int64_t delta);
+
+// The delta a well-formed counter operand carries, folly::none for
+// anything else
+folly::Optional<int64_t> counterDelta(const rocksdb::Slice& operand);
+
+/**
+ * The merge operator backing the counter-style update fast path. The
+ * update processors issue row patches as merge operands instead of
+ * rewriting the whole row under the per-part atomic op lock; the
+ * patches are folded into the row here, at read and compaction time.
+ * Counter delta operands fold the same way onto plain int64 values,
+ * for the edge degree counters. Installed on the engines when
+ * --enable_merge_update or --enable_edge_degree_counter is on.
+ * */
 class NebulaOperator : public rocksdb::MergeOperator {
 public:
     const char* Name() const override {
@@ -21,28 +71,14 @@ public:
 
 private:
     bool FullMergeV2(const MergeOperationInput& merge_in,
-                     MergeOperationOutput* merge_out) const override {
-        UNUSED(merge_in);
-        UNUSED(merge_out);
-        LOG(ERROR) << "NebulaMergeOperator not supported yet";
-        return false;
-    }
+                     MergeOperationOutput* merge_out) const override;
 
     bool PartialMerge(const rocksdb::Slice& key, const rocksdb::Slice& left_operand,
                       const rocksdb::Slice& right_operand, std::string* new_value,
-                      rocksdb::Logger* logger) const override {
-        UNUSED(key);
-        UNUSED(left_operand);
-        UNUSED(right_operand);
-        UNUSED(new_value);
-        UNUSED(logger);
-        LOG(ERROR) << "NebulaMergeOperator not supported yet";
-        return false;
-    }
+                      rocksdb::Logger* logger) const override;
 };
 
 
 }  // namespace storage
 }  // namespace nebula
 #endif  // KVSTORE_MERGEOPERATOR_H_
-
@@ -0,0 +1,57 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_READERLANES_H_
+#define STORAGE_READERLANES_H_
+
+#include "common/base/Base.h"
+#include "common/thrift/ThriftTypes.h"
+#include <folly/hash/Hash.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include "storage/StorageFlags.h"
+
+namespace nebula {
+namespace storage {
+
+/**
+ * Experimental shard-per-core execution of the read path. Each lane is a
+ * single-threaded executor owning a fixed set of parts, decided by the
+ * same (spaceId, partId) hash the raft executor lanes use, so with equal
+ * lane counts a part's reads run on the thread whose cache already holds
+ * the part's raft and commit state. The per-part plan contexts of a
+ * concurrent request are private to their task anyway; pinning the parts
+ * to threads is what keeps a part's working set on one core instead of
+ * bouncing it across the shared reader pool.
+ * */
+class ReaderLanes final {
+public:
+    ReaderLanes() {
+        auto num = FLAGS_reader_executor_lanes;
+        CHECK_GT(num, 0);
+        lanes_.reserve(num);
+        for (int32_t i = 0; i < num; i++) {
+            lanes_.emplace_back(std::make_unique<folly::CPUThreadPoolExecutor>(
+                1,
+                std::make_shared<folly::NamedThreadFactory>(
+                    folly::stringPrintf("storage-lane-%d", i))));
+        }
+    }
+
+    // The lane owning the given part, the same assignment
+    // RaftexService::laneExecutor makes
+    folly::Executor* lane(GraphSpaceID spaceId, PartitionID partId) const {
+        auto idx = folly::hash::hash_combine(spaceId, partId) % lanes_.size();
+        return lanes_[idx].get();
+    }
+
+private:
+    std::vector<std::unique_ptr<folly::CPUThreadPoolExecutor>> lanes_;
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_READERLANES_H_
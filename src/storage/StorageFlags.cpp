@@ -18,14 +18,180 @@ DEFINE_int32(waiting_new_leader_interval_in_secs, 5,
 DEFINE_int32(rebuild_index_batch_num, 1024,
              "The batch size when rebuild index");
 
+DEFINE_int64(rebuild_index_rate_limit, 0,
+             "Max bytes of index entries a rebuild may write per second, "
+             "shared by all of its parts. 0 means no limit");
+
+DEFINE_int64(admin_task_io_rate_limit, 0,
+             "Default bytes-per-second I/O budget of an admin task whose "
+             "class has no budget flag of its own. Rebuilds use "
+             "--rebuild_index_rate_limit; compact and flush I/O is paced "
+             "inside the engine by --rocksdb_rate_limit. 0 means no limit");
+
 DEFINE_int32(vertex_cache_num, 16 * 1000 * 1000, "Total keys inside the cache");
 
 DEFINE_int32(vertex_cache_bucket_exp, 4, "Total buckets number is 1 << cache_bucket_exp");
 
 DEFINE_bool(enable_vertex_cache, true, "Enable vertex cache");
 
-DEFINE_int32(reader_handlers, 32, "Total reader handlers");
+DEFINE_bool(enable_update_key_lock, false,
+            "Serialize conditional updates on a per-key latch table and "
+            "append them through the normal batched log path, instead of "
+            "the per-part atomic op queue. Same-key races with plain "
+            "inserts keep the insert-wins semantics of concurrent writes");
+
+DEFINE_bool(enable_update_chain_read, false,
+            "Let an update queued on a key latch reuse the row the "
+            "previous holder wrote, skipping the engine read; updates of "
+            "a hot edge become memory-bound instead of read-bound. Only "
+            "effective with enable_update_key_lock. Chained reads can "
+            "miss a plain same-key put that bypasses the latch, an "
+            "ordering that is already racy without the chain");
+
+DEFINE_bool(enable_batched_index_writes, false,
+            "Maintain edge indexes on the normal batched log path: the "
+            "old-row lookups run on the processor thread under per-edge "
+            "latches and the assembled batch rides a plain log append, "
+            "instead of reading and rewriting inside the per-part atomic "
+            "op queue. Non-conflicting indexed inserts of one partition "
+            "no longer wait on each other");
+
+DEFINE_bool(enable_merge_update, false,
+            "Apply counter-style updates (prop = prop + constant) as rocksdb "
+            "merge operands instead of read-modify-write under the per-part "
+            "atomic op lock");
+
+DEFINE_bool(enable_edge_degree_counter, false,
+            "Maintain a per-(vertex, edgeType) out-degree counter in the "
+            "same write batch as the edge inserts and deletes, as rocksdb "
+            "merge operands on a system key. Degree reads become a point "
+            "lookup instead of a scan, and the sampling logic of "
+            "GetNeighbors seeds its degree cache from the counters. Only "
+            "counts writes issued while the flag is on; imports through "
+            "--bulk_load_import are not counted");
+
+DEFINE_bool(bulk_load_import, false,
+            "Stage insert batches as SST files in the download directory "
+            "instead of writing them through raft, for initial imports. "
+            "The data only becomes visible after an INGEST, the importer "
+            "must stage every replica of a part, and index entries are "
+            "left to the rebuild-index job afterwards");
+
+DEFINE_int32(reader_handlers, 32,
+             "Total reader handlers. 0 means one per core");
+
+DEFINE_bool(atomic_edge_writes, false,
+            "Commit the parts of one AddEdgesRequest atomically through a "
+            "two-part commit, so an edge and its reverse edge either both "
+            "land or neither does. The prepares run in parallel. Only "
+            "applies to multi-part requests without indexes, and every "
+            "part of the request has to be led by this host");
+
+DEFINE_int32(reader_executor_lanes, 0,
+             "Experimental: number of single-threaded lanes the read path "
+             "shards the parts onto, every part always running on the lane "
+             "thread that owns it. Works best set equal to "
+             "--raft_executor_lanes, which makes a part's reads share a "
+             "core with its raft work. 0 keeps the shared reader pool");
+
+DEFINE_bool(query_offload_execution, true,
+            "Run the read plans on the reader thread pool instead of the "
+            "thrift worker that decoded the request, so one heavy traversal "
+            "does not hold up the dispatch of the requests queued behind it. "
+            "Decoding and request validation stay on the thrift workers");
+
+DEFINE_bool(query_concurrently, false,
+            "Whether to run the parts of one read request concurrently on "
+            "the reader thread pool, so a fan-out request is not limited to "
+            "one core. Single-part requests always run inline");
 
 DEFINE_int32(max_edge_returned_per_vertex, INT_MAX, "Max edge number returnred searching vertex");
 
 DEFINE_bool(enable_reservoir_sampling, false, "Will do reservoir sampling if set true.");
+
+DEFINE_int64(reservoir_sampling_degree_threshold, 0,
+             "Approximate out-degree of a (vertex, edgeType) above which a sampled "
+             "GetNeighbors skips over the edge key range instead of scanning all of "
+             "it. 0 means sampled reads always scan the whole range");
+
+DEFINE_int32(degree_cache_num, 1000 * 1000,
+             "Total keys inside the approximate out-degree cache");
+
+DEFINE_int32(neighbors_result_cache_ttl_ms, 0,
+             "Serve a byte-identical GetNeighbors request from the result of "
+             "a previous one no older than this many milliseconds, instead "
+             "of scanning again. Hits may miss writes of the last TTL "
+             "window, so keep it small. 0 disables the result cache");
+
+DEFINE_int32(neighbors_result_cache_num, 8192,
+             "Total entries inside the GetNeighbors result cache");
+
+DEFINE_int32(max_concurrent_reads, 0,
+             "In-flight read requests admitted before new reads are rejected "
+             "with a retryable code. 0 means unbounded");
+
+DEFINE_int32(max_concurrent_writes, 0,
+             "In-flight write requests admitted before new writes are rejected "
+             "with a retryable code. 0 means unbounded");
+
+DEFINE_int64(read_latency_target_us, 0,
+             "Moving average read latency in microseconds above which new "
+             "writes are shed, so ingest bursts do not inflate read tail "
+             "latency. 0 disables the latency signal");
+
+DEFINE_int32(profile_plan_every_n, 0,
+             "Sample every Nth read plan for profiling: the inclusive "
+             "execution time of each of its plan nodes is recorded into the "
+             "storage.plan_<node> stats the web service exports. 0 disables "
+             "the sampling");
+
+DEFINE_int64(slow_query_threshold_us, 0,
+             "Read requests slower than this many microseconds log one "
+             "structured slow-query line with their scan statistics: engine "
+             "calls, keys scanned, stale versions skipped, bytes read, the "
+             "slowest part, and the per-node times when the plan was sampled "
+             "by --profile_plan_every_n. 0 disables the slow-query log");
+
+DEFINE_bool(enable_io_accounting, false,
+            "Tally the physical block reads and bytes of each read request "
+            "off rocksdb's perf context and log one IoAccounting line per "
+            "request, tagged with the processor and the space, so disk "
+            "saturation can be attributed to a workload instead of guessed. "
+            "The counters also feed the storage.block_reads_per_request "
+            "stats and the slow-query log");
+
+DEFINE_int64(query_deadline_us, 0,
+             "Per-request execution budget in microseconds. A read plan "
+             "running past it stops scanning and fails its remaining parts "
+             "with E_PARTIAL_RESULT, so a request whose client has long "
+             "timed out does not keep burning I/O on supernodes. 0 means "
+             "no deadline");
+
+DEFINE_int64(request_memory_quota_mb, 0,
+             "Estimated memory one request may buffer for its result before "
+             "it is aborted, converting a runaway request into a per-request "
+             "failure instead of an OOM kill. 0 means unbounded");
+
+DEFINE_int64(total_request_memory_quota_mb, 0,
+             "Estimated memory all in-flight requests may buffer together "
+             "before further buffering aborts, bounding the process under "
+             "many concurrent large requests. 0 means unbounded");
+
+DEFINE_int32(neighbor_prefetch_limit, 0,
+             "Up to this many of the neighbors a GetNeighbors request "
+             "returns get their vertex blocks warmed in the background "
+             "after the response is sent, so the next hop of a multi-hop "
+             "traversal reads them from cache. 0 disables the prefetch");
+
+DEFINE_int64(neighbor_prefetch_budget_us, 2000,
+             "Time budget in microseconds of one request's neighbor "
+             "prefetch; the warming stops when it is spent, so a cold "
+             "prefetch cannot occupy a reader thread for long");
+
+DEFINE_bool(use_hlc_version, false,
+            "Mint edge/vertex versions from the part's hybrid logical "
+            "clock instead of the raw wall clock. The clock never moves "
+            "behind a version the part has already committed, so versions "
+            "stay in issue order per part regardless of clock skew between "
+            "hosts, and readers can trust that the first version they "
+            "encounter is the latest one");
@@ -21,16 +21,72 @@ DECLARE_int32(waiting_new_leader_interval_in_secs);
 
 DECLARE_int32(rebuild_index_batch_num);
 
+DECLARE_int64(rebuild_index_rate_limit);
+
+DECLARE_int64(admin_task_io_rate_limit);
+
 DECLARE_int32(vertex_cache_num);
 
 DECLARE_int32(vertex_cache_bucket_exp);
 
 DECLARE_bool(enable_vertex_cache);
 
+DECLARE_bool(enable_update_key_lock);
+
+DECLARE_bool(enable_update_chain_read);
+
+DECLARE_bool(enable_batched_index_writes);
+
+DECLARE_bool(enable_merge_update);
+
+DECLARE_bool(enable_edge_degree_counter);
+
+DECLARE_bool(bulk_load_import);
+
+DECLARE_bool(atomic_edge_writes);
+
 DECLARE_int32(reader_handlers);
 
+DECLARE_int32(reader_executor_lanes);
+
+DECLARE_bool(query_offload_execution);
+
+DECLARE_bool(query_concurrently);
+
 DECLARE_int32(max_edge_returned_per_vertex);
 
 DECLARE_bool(enable_reservoir_sampling);
 
+DECLARE_int64(reservoir_sampling_degree_threshold);
+
+DECLARE_int32(degree_cache_num);
+
+DECLARE_int32(neighbors_result_cache_ttl_ms);
+
+DECLARE_int32(neighbors_result_cache_num);
+
+DECLARE_int32(max_concurrent_reads);
+
+DECLARE_int32(max_concurrent_writes);
+
+DECLARE_int64(read_latency_target_us);
+
+DECLARE_int32(profile_plan_every_n);
+
+DECLARE_int64(slow_query_threshold_us);
+
+DECLARE_bool(enable_io_accounting);
+
+DECLARE_int64(query_deadline_us);
+
+DECLARE_int64(request_memory_quota_mb);
+
+DECLARE_int64(total_request_memory_quota_mb);
+
+DECLARE_int32(neighbor_prefetch_limit);
+
+DECLARE_int64(neighbor_prefetch_budget_us);
+
+DECLARE_bool(use_hlc_version);
+
 #endif  // STORAGE_STORAGEFLAGS_H_
@@ -11,16 +11,24 @@
 #include "common/meta/ServerBasedSchemaManager.h"
 #include "common/hdfs/HdfsCommandHelper.h"
 #include "common/thread/GenericThreadPool.h"
+#include "common/time/WallClock.h"
 #include "storage/BaseProcessor.h"
+#include "storage/BulkIndexBuilder.h"
 #include "storage/CompactionFilter.h"
+#include "storage/MergeOperator.h"
 #include "storage/StorageFlags.h"
 #include "storage/StorageAdminServiceHandler.h"
 #include "storage/GraphStorageServiceHandler.h"
 #include "storage/http/StorageHttpDownloadHandler.h"
 #include "storage/http/StorageHttpIngestHandler.h"
 #include "storage/http/StorageHttpAdminHandler.h"
+#include "storage/http/StorageHttpCacheHandler.h"
+#include "storage/http/StorageHttpEngineHandler.h"
 #include "kvstore/PartManager.h"
+#include "utils/NebulaKeyUtils.h"
 #include <thrift/lib/cpp/concurrency/ThreadManager.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <sched.h>
 
 DEFINE_int32(port, 44500, "Storage daemon listening port");
 DEFINE_bool(reuse_port, true, "Whether to turn on the SO_REUSEPORT option");
@@ -28,10 +36,78 @@ DEFINE_int32(num_io_threads, 16, "Number of IO threads");
 DEFINE_int32(num_worker_threads, 32, "Number of workers");
 DEFINE_int32(storage_http_thread_num, 3, "Number of storage daemon's http thread");
 DEFINE_bool(local_config, false, "meta client will not retrieve latest configuration from meta");
+DEFINE_string(wal_path, "", "Root path for the raft WALs. Leave it empty to keep each WAL "
+                            "beside its data. Point it at a fast device (e.g. Optane/NVMe) "
+                            "to move only the WALs there while the SSTs stay on data_path. "
+                            "Note that existing WALs are not migrated, and checkpoints can "
+                            "not hard-link a WAL living on a different device");
+DEFINE_string(io_thread_cpus, "",
+              "Comma separated list of cpu ids, ranges allowed (e.g. \"0-7,16-23\"), "
+              "the IO threads are pinned to round-robin. The rpc and raft event "
+              "loops all run on these threads, so a list covering a single NUMA "
+              "node keeps their queues and the memory they touch on one socket. "
+              "Empty leaves placement to the scheduler");
+DEFINE_int32(min_compress_bytes, 256 * 1024,
+             "Responses at least this large are compressed on the wire when "
+             "the client asked for a compression transform in its request "
+             "header. Smaller responses go out uncompressed, the CPU cost "
+             "outweighs the saved bytes there. 0 compresses everything");
 
 namespace nebula {
 namespace storage {
 
+namespace {
+
+std::vector<int> parseCpuList(const std::string& spec) {
+    std::vector<int> cpus;
+    std::vector<std::string> parts;
+    folly::split(',', spec, parts, true);
+    for (const auto& part : parts) {
+        auto dash = part.find('-');
+        if (dash == std::string::npos) {
+            cpus.emplace_back(folly::to<int>(folly::trimWhitespace(part)));
+        } else {
+            auto begin = folly::to<int>(folly::trimWhitespace(part.substr(0, dash)));
+            auto end = folly::to<int>(folly::trimWhitespace(part.substr(dash + 1)));
+            for (int cpu = begin; cpu <= end; cpu++) {
+                cpus.emplace_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+// Pins every new thread to the next cpu of the list before it runs,
+// so everything the thread allocates is born on that cpu's node
+class PinnedThreadFactory : public folly::NamedThreadFactory {
+public:
+    PinnedThreadFactory(folly::StringPiece prefix, std::vector<int> cpus)
+        : folly::NamedThreadFactory(prefix)
+        , cpus_(std::move(cpus)) {
+        CHECK(!cpus_.empty());
+    }
+
+    std::thread newThread(folly::Func&& func) override {
+        auto cpu = cpus_[next_++ % cpus_.size()];
+        return folly::NamedThreadFactory::newThread(
+            [cpu, func = std::move(func)] () mutable {
+                cpu_set_t cpuset;
+                CPU_ZERO(&cpuset);
+                CPU_SET(cpu, &cpuset);
+                if (sched_setaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+                    PLOG(WARNING) << "Failed to pin io thread to cpu " << cpu;
+                }
+                func();
+            });
+    }
+
+private:
+    std::vector<int>     cpus_;
+    std::atomic<size_t>  next_{0};
+};
+
+}  // anonymous namespace
+
 StorageServer::StorageServer(HostAddr localHost,
                              std::vector<HostAddr> metaAddrs,
                              std::vector<std::string> dataPaths)
@@ -44,11 +120,41 @@ StorageServer::~StorageServer() {
 std::unique_ptr<kvstore::KVStore> StorageServer::getStoreInstance() {
     kvstore::KVOptions options;
     options.dataPaths_ = dataPaths_;
+    options.walPath_ = FLAGS_wal_path;
     options.partMan_ = std::make_unique<kvstore::MetaServerBasedPartManager>(
                                                 localHost_,
                                                 metaClient_.get());
     options.cffBuilder_ = std::make_unique<StorageCompactionFilterFactoryBuilder>(schemaMan_.get(),
                                                                                   indexMan_.get());
+    options.spaceSchemaMan_ = schemaMan_.get();
+    options.ingestIndexBuilderFn_ = [this](GraphSpaceID spaceId,
+                                           PartitionID partId,
+                                           const std::vector<std::string>& dataFiles,
+                                           const std::string& outputDir) {
+        return BulkIndexBuilder::buildIndexSst(schemaMan_.get(), indexMan_.get(),
+                                               spaceId, partId, dataFiles, outputDir);
+    };
+    if (FLAGS_enable_merge_update || FLAGS_enable_edge_degree_counter) {
+        options.mergeOp_ = std::make_shared<storage::NebulaOperator>();
+    }
+    if (FLAGS_enable_vertex_cache) {
+        vertexCache_ = std::make_unique<VertexCache>(FLAGS_vertex_cache_num,
+                                                     FLAGS_vertex_cache_bucket_exp);
+        // Every committed write to a vertex drops its cache entry, on
+        // leaders and followers alike, so a part gaining leadership
+        // never serves rows the cache remembers from before
+        options.committedKeyFn_ = [this](GraphSpaceID spaceId,
+                                         PartitionID partId,
+                                         const folly::StringPiece& key) {
+            auto vIdLen = schemaMan_->getSpaceVidLen(spaceId);
+            if (!vIdLen.ok() || !NebulaKeyUtils::isVertex(vIdLen.value(), key)) {
+                return;
+            }
+            auto vId = NebulaKeyUtils::getVertexId(vIdLen.value(), key).str();
+            auto tagId = NebulaKeyUtils::getTagId(vIdLen.value(), key);
+            vertexCache_->evict(std::make_pair(std::move(vId), tagId), partId);
+        };
+    }
     if (FLAGS_store_type == "nebula") {
         auto nbStore = std::make_unique<kvstore::NebulaStore>(std::move(options),
                                                               ioThreadPool_,
@@ -89,13 +195,69 @@ bool StorageServer::initWebService() {
     router.get("/admin").handler([this](web::PathParams&&) {
         return new storage::StorageHttpAdminHandler(schemaMan_.get(), kvstore_.get());
     });
+    router.get("/cache").handler([](web::PathParams&&) {
+        return new storage::StorageHttpCacheHandler();
+    });
+    router.get("/engine").handler([this](web::PathParams&&) {
+        auto* handler = new storage::StorageHttpEngineHandler();
+        // getStoreInstance() only ever builds a NebulaStore
+        handler->init(static_cast<kvstore::NebulaStore*>(kvstore_.get()));
+        return handler;
+    });
 
     auto status = webSvc_->start();
     return status.ok();
 }
 
+void StorageServer::warmupMetaCache() {
+    auto startUs = time::WallClock::fastNowInMicroSec();
+    auto partsMap = kvstore_->partManager()->parts(localHost_);
+    size_t numSchemas = 0;
+    size_t numIndexes = 0;
+    for (const auto& spaceEntry : partsMap) {
+        auto spaceId = spaceEntry.first;
+        // The vid length and the schemas of every version land in the
+        // managers' caches, which is what the processors consult on
+        // each request
+        auto vidLen = schemaMan_->getSpaceVidLen(spaceId);
+        if (!vidLen.ok()) {
+            LOG(WARNING) << "Failed to preload space " << spaceId
+                         << ": " << vidLen.status();
+            continue;
+        }
+        auto tags = schemaMan_->getAllVerTagSchema(spaceId);
+        if (tags.ok()) {
+            numSchemas += tags.value().size();
+        }
+        auto edges = schemaMan_->getAllVerEdgeSchema(spaceId);
+        if (edges.ok()) {
+            numSchemas += edges.value().size();
+        }
+        // The write path asks for the index list on every batch; warm
+        // it up as well
+        auto tagIndexes = indexMan_->getTagIndexes(spaceId);
+        if (tagIndexes.ok()) {
+            numIndexes += tagIndexes.value().size();
+        }
+        auto edgeIndexes = indexMan_->getEdgeIndexes(spaceId);
+        if (edgeIndexes.ok()) {
+            numIndexes += edgeIndexes.value().size();
+        }
+    }
+    LOG(INFO) << "Preloaded " << numSchemas << " schemas and " << numIndexes
+              << " indexes of " << partsMap.size() << " spaces in "
+              << time::WallClock::fastNowInMicroSec() - startUs << " us";
+}
+
 bool StorageServer::start() {
-    ioThreadPool_ = std::make_shared<folly::IOThreadPoolExecutor>(FLAGS_num_io_threads);
+    if (FLAGS_io_thread_cpus.empty()) {
+        ioThreadPool_ = std::make_shared<folly::IOThreadPoolExecutor>(FLAGS_num_io_threads);
+    } else {
+        ioThreadPool_ = std::make_shared<folly::IOThreadPoolExecutor>(
+            FLAGS_num_io_threads,
+            std::make_shared<PinnedThreadFactory>("IOThreadPool",
+                                                  parseCpuList(FLAGS_io_thread_cpus)));
+    }
     workers_ = apache::thrift::concurrency::PriorityThreadManager::newPriorityThreadManager(
                                  FLAGS_num_worker_threads, true /*stats*/);
     workers_->setNamePrefix("executor");
@@ -132,6 +294,15 @@ bool StorageServer::start() {
         return false;
     }
 
+    auto* nbStore = dynamic_cast<kvstore::NebulaStore*>(kvstore_.get());
+    if (nbStore != nullptr) {
+        compactionScheduler_ = std::make_unique<storage::CompactionScheduler>(nbStore);
+        if (!compactionScheduler_->start()) {
+            LOG(ERROR) << "Start compaction scheduler failed!";
+            return false;
+        }
+    }
+
     if (!initWebService()) {
         LOG(ERROR) << "Init webservice failed!";
         return false;
@@ -148,9 +319,23 @@ bool StorageServer::start() {
     env_->indexMan_ = indexMan_.get();
     env_->schemaMan_ = schemaMan_.get();
 
+    if (FLAGS_write_coalesce_window_us > 0) {
+        writeCoalescer_ = std::make_unique<WriteCoalescer>(kvstore_.get());
+        if (!writeCoalescer_->start()) {
+            LOG(ERROR) << "Start write coalescer failed!";
+            return false;
+        }
+        env_->writeCoalescer_ = writeCoalescer_.get();
+    }
+
+    // Cold caches cost the first requests after a deploy a meta round
+    // trip each; fill them before the servers accept anything
+    warmupMetaCache();
+
     storageThread_.reset(new std::thread([this] {
         try {
-            auto handler = std::make_shared<GraphStorageServiceHandler>(env_.get());
+            auto handler = std::make_shared<GraphStorageServiceHandler>(env_.get(),
+                                                                         vertexCache_.get());
             storageServer_ = std::make_unique<apache::thrift::ThriftServer>();
             storageServer_->setPort(FLAGS_port);
             storageServer_->setReusePort(FLAGS_reuse_port);
@@ -158,6 +343,10 @@ bool StorageServer::start() {
             storageServer_->setIOThreadPool(ioThreadPool_);
             storageServer_->setThreadManager(workers_);
             storageServer_->setStopWorkersOnStopListening(false);
+            // Compression is negotiated per request: the server only
+            // compresses a response when the client sent a transform in
+            // its header, and only past the size threshold
+            storageServer_->setMinCompressBytes(FLAGS_min_compress_bytes);
             storageServer_->setInterface(std::move(handler));
 
             storageSvcStatus_.store(STATUS_RUNNING);
@@ -218,10 +407,18 @@ void StorageServer::stop() {
 
     webSvc_.reset();
 
+    if (compactionScheduler_) {
+        compactionScheduler_->stop();
+    }
+
     if (taskMgr_) {
         taskMgr_->shutdown();
     }
 
+    if (writeCoalescer_) {
+        writeCoalescer_->stop();
+    }
+
     if (metaClient_) {
         metaClient_->stop();
     }
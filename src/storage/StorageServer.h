@@ -16,6 +16,8 @@
 #include "kvstore/NebulaStore.h"
 #include "storage/CommonUtils.h"
 #include "storage/admin/AdminTaskManager.h"
+#include "storage/CompactionScheduler.h"
+#include "storage/WriteCoalescer.h"
 
 namespace nebula {
 
@@ -50,6 +52,12 @@ private:
 
     bool initWebService();
 
+    // Preload the schemas and indexes of every hosted space into the
+    // schema and index manager caches before the thrift servers accept
+    // requests, so the first requests after a restart do not pay the
+    // meta lookups to populate them
+    void warmupMetaCache();
+
     std::shared_ptr<folly::IOThreadPoolExecutor> ioThreadPool_;
     std::shared_ptr<apache::thrift::concurrency::ThreadManager> workers_;
 
@@ -69,6 +77,11 @@ private:
     std::unique_ptr<meta::SchemaManager> schemaMan_;
     std::unique_ptr<meta::IndexManager> indexMan_;
     std::unique_ptr<storage::StorageEnv> env_;
+    std::unique_ptr<storage::CompactionScheduler> compactionScheduler_;
+    std::unique_ptr<storage::WriteCoalescer> writeCoalescer_;
+    // Shared by the query processors and invalidated from the commit
+    // path of every part
+    std::unique_ptr<VertexCache> vertexCache_;
 
     std::atomic_bool stopped_{false};
     HostAddr localHost_;
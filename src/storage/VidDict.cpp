@@ -0,0 +1,95 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/VidDict.h"
+
+namespace nebula {
+namespace storage {
+
+ErrorOr<kvstore::ResultCode, LocalVertexID> VidDict::localId(kvstore::KVStore* store,
+                                                             GraphSpaceID spaceId,
+                                                             PartitionID partId,
+                                                             const VertexID& vId) {
+    std::string value;
+    auto ret = store->get(spaceId, partId,
+                          NebulaKeyUtils::systemVidAliasKey(partId, vId),
+                          &value, true);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        return ret;
+    }
+    if (value.size() != sizeof(LocalVertexID)) {
+        LOG(ERROR) << "Bad vid alias value size " << value.size()
+                   << " of space " << spaceId << ", part " << partId;
+        return kvstore::ResultCode::ERR_UNKNOWN;
+    }
+    return readInt<LocalVertexID>(value.data(), value.size());
+}
+
+ErrorOr<kvstore::ResultCode, std::string> VidDict::userVid(kvstore::KVStore* store,
+                                                           GraphSpaceID spaceId,
+                                                           PartitionID partId,
+                                                           LocalVertexID localId) {
+    std::string value;
+    auto ret = store->get(spaceId, partId,
+                          NebulaKeyUtils::systemVidAliasRevKey(partId, localId),
+                          &value, true);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        return ret;
+    }
+    return value;
+}
+
+ErrorOr<kvstore::ResultCode, LocalVertexID> VidDict::getOrAssign(kvstore::KVStore* store,
+                                                                 GraphSpaceID spaceId,
+                                                                 PartitionID partId,
+                                                                 const VertexID& vId,
+                                                                 VidDict::PendingBatch& batch) {
+    auto pending = batch.assigned.find(vId);
+    if (pending != batch.assigned.end()) {
+        return pending->second;
+    }
+    auto known = localId(store, spaceId, partId, vId);
+    if (ok(known)) {
+        return value(known);
+    }
+    if (error(known) != kvstore::ResultCode::ERR_KEY_NOT_FOUND) {
+        return error(known);
+    }
+    if (batch.nextId == 0) {
+        // First assignment of this batch, pick up where the part's
+        // count key left off; 0 stays reserved as invalid
+        std::string count;
+        auto ret = store->get(spaceId, partId,
+                              NebulaKeyUtils::systemVidAliasCountKey(partId),
+                              &count, true);
+        if (ret == kvstore::ResultCode::SUCCEEDED) {
+            batch.nextId = readInt<LocalVertexID>(count.data(), count.size());
+        } else if (ret == kvstore::ResultCode::ERR_KEY_NOT_FOUND) {
+            batch.nextId = 1;
+        } else {
+            return ret;
+        }
+    }
+    auto localVid = batch.nextId++;
+    batch.kvs.emplace_back(NebulaKeyUtils::systemVidAliasKey(partId, vId),
+                           std::string(reinterpret_cast<const char*>(&localVid),
+                                       sizeof(LocalVertexID)));
+    batch.kvs.emplace_back(NebulaKeyUtils::systemVidAliasRevKey(partId, localVid), vId);
+    batch.assigned.emplace(vId, localVid);
+    return localVid;
+}
+
+void VidDict::finish(PartitionID partId, VidDict::PendingBatch& batch) {
+    if (batch.assigned.empty()) {
+        return;
+    }
+    batch.kvs.emplace_back(NebulaKeyUtils::systemVidAliasCountKey(partId),
+                           std::string(reinterpret_cast<const char*>(&batch.nextId),
+                                       sizeof(LocalVertexID)));
+}
+
+}  // namespace storage
+}  // namespace nebula
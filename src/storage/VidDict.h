@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_VIDDICT_H_
+#define STORAGE_VIDDICT_H_
+
+#include "common/base/Base.h"
+#include "utils/NebulaKeyUtils.h"
+#include "kvstore/KVStore.h"
+
+namespace nebula {
+namespace storage {
+
+/**
+ * The translation layer of the per-part vid dictionary: user vids map
+ * to dense 4 byte aliases (LocalVertexID), so data keys of an aliased
+ * space carry 4 bytes where up to vid-length bytes would go.
+ *
+ * The dictionary entries are plain kvs under the part's
+ * systemVidAliasPrefix. New aliases are handed out at write time and
+ * ride in the same batch as the data referencing them, so replicas and
+ * snapshots always carry a dictionary covering their data. Assignment
+ * reads the part's count key and is NOT safe against concurrent
+ * assigners of the same part; callers must serialize per part, e.g.
+ * under the processors' part-level key locks.
+ * */
+class VidDict final {
+public:
+    VidDict() = delete;
+
+    /**
+     * Aliases assigned into one batch before it commits: the dictionary
+     * kvs to append to the data batch plus the lookaside the still
+     * uncommitted aliases resolve through
+     * */
+    struct PendingBatch {
+        std::vector<kvstore::KV> kvs;
+        std::unordered_map<std::string, LocalVertexID> assigned;
+        LocalVertexID nextId{0};
+    };
+
+    /**
+     * The alias of vId, or ERR_KEY_NOT_FOUND when the part never saw
+     * the vid
+     * */
+    static ErrorOr<kvstore::ResultCode, LocalVertexID> localId(kvstore::KVStore* store,
+                                                               GraphSpaceID spaceId,
+                                                               PartitionID partId,
+                                                               const VertexID& vId);
+
+    /**
+     * The user vid behind one alias, or ERR_KEY_NOT_FOUND
+     * */
+    static ErrorOr<kvstore::ResultCode, std::string> userVid(kvstore::KVStore* store,
+                                                             GraphSpaceID spaceId,
+                                                             PartitionID partId,
+                                                             LocalVertexID localId);
+
+    /**
+     * The alias of vId, assigning a fresh one into `batch` when neither
+     * the engine nor the batch knows the vid yet
+     * */
+    static ErrorOr<kvstore::ResultCode, LocalVertexID> getOrAssign(kvstore::KVStore* store,
+                                                                   GraphSpaceID spaceId,
+                                                                   PartitionID partId,
+                                                                   const VertexID& vId,
+                                                                   PendingBatch& batch);
+
+    /**
+     * Append the updated count key to the batch; call once after the
+     * last getOrAssign, before the batch is committed
+     * */
+    static void finish(PartitionID partId, PendingBatch& batch);
+};
+
+}  // namespace storage
+}  // namespace nebula
+
+#endif  // STORAGE_VIDDICT_H_
@@ -0,0 +1,184 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/WriteCoalescer.h"
+#include "common/time/WallClock.h"
+
+DEFINE_int64(write_coalesce_window_us,
+             0,
+             "How long a small write may park waiting for other writes to "
+             "the same partition before its merged batch commits, in "
+             "microseconds. 0 disables server-side write coalescing");
+
+DEFINE_int32(write_coalesce_max_batch_kvs,
+             512,
+             "A pending per-partition batch commits as soon as it holds this "
+             "many key/values, without waiting out the window. Requests "
+             "carrying at least half of it alone bypass coalescing");
+
+namespace nebula {
+namespace storage {
+
+bool WriteCoalescer::start() {
+    bgThread_ = std::make_unique<thread::GenericWorker>();
+    if (!bgThread_->start()) {
+        LOG(ERROR) << "Failed to start the write coalescer thread";
+        return false;
+    }
+    // ticking at half the window keeps the extra commit delay of a
+    // parked request below 1.5 windows
+    auto intervalMs = std::max<int64_t>(FLAGS_write_coalesce_window_us / 2000, 1);
+    bgThread_->addRepeatTask(intervalMs, &WriteCoalescer::tick, this);
+    LOG(INFO) << "Write coalescer started, window " << FLAGS_write_coalesce_window_us
+              << "us, max batch " << FLAGS_write_coalesce_max_batch_kvs << " key/values";
+    return true;
+}
+
+void WriteCoalescer::stop() {
+    if (bgThread_) {
+        bgThread_->stop();
+        bgThread_->wait();
+        bgThread_.reset();
+    }
+    // fail nothing on the way out: commit whatever is still parked
+    std::map<std::pair<GraphSpaceID, PartitionID>, Batch> pending;
+    std::map<std::pair<GraphSpaceID, PartitionID>, RemoveBatch> pendingRemoves;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        pending.swap(batches_);
+        pendingRemoves.swap(removeBatches_);
+    }
+    for (auto& entry : pending) {
+        flush(entry.first.first, entry.first.second, std::move(entry.second));
+    }
+    for (auto& entry : pendingRemoves) {
+        flushRemove(entry.first.first, entry.first.second, std::move(entry.second));
+    }
+}
+
+void WriteCoalescer::asyncMultiPut(GraphSpaceID spaceId,
+                                   PartitionID partId,
+                                   std::vector<kvstore::KV> data,
+                                   kvstore::KVCallback cb) {
+    auto maxBatch = static_cast<size_t>(FLAGS_write_coalesce_max_batch_kvs);
+    if (data.size() >= maxBatch / 2) {
+        // already a decent raft batch, the window would only add latency
+        store_->asyncMultiPut(spaceId, partId, std::move(data), std::move(cb));
+        return;
+    }
+
+    Batch ready;
+    bool flushNow = false;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto& batch = batches_[std::make_pair(spaceId, partId)];
+        if (batch.data.empty()) {
+            batch.firstArrivalUs = time::WallClock::fastNowInMicroSec();
+        }
+        batch.data.insert(batch.data.end(),
+                          std::make_move_iterator(data.begin()),
+                          std::make_move_iterator(data.end()));
+        batch.callbacks.emplace_back(std::move(cb));
+        if (batch.data.size() >= maxBatch) {
+            ready = std::move(batch);
+            batches_.erase(std::make_pair(spaceId, partId));
+            flushNow = true;
+        }
+    }
+    if (flushNow) {
+        flush(spaceId, partId, std::move(ready));
+    }
+}
+
+void WriteCoalescer::asyncMultiRemove(GraphSpaceID spaceId,
+                                      PartitionID partId,
+                                      std::vector<std::string> keys,
+                                      kvstore::KVCallback cb) {
+    auto maxBatch = static_cast<size_t>(FLAGS_write_coalesce_max_batch_kvs);
+    if (keys.size() >= maxBatch / 2) {
+        store_->asyncMultiRemove(spaceId, partId, std::move(keys), std::move(cb));
+        return;
+    }
+
+    RemoveBatch ready;
+    bool flushNow = false;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto& batch = removeBatches_[std::make_pair(spaceId, partId)];
+        if (batch.keys.empty()) {
+            batch.firstArrivalUs = time::WallClock::fastNowInMicroSec();
+        }
+        batch.keys.insert(batch.keys.end(),
+                          std::make_move_iterator(keys.begin()),
+                          std::make_move_iterator(keys.end()));
+        batch.callbacks.emplace_back(std::move(cb));
+        if (batch.keys.size() >= maxBatch) {
+            ready = std::move(batch);
+            removeBatches_.erase(std::make_pair(spaceId, partId));
+            flushNow = true;
+        }
+    }
+    if (flushNow) {
+        flushRemove(spaceId, partId, std::move(ready));
+    }
+}
+
+void WriteCoalescer::tick() {
+    auto deadline = time::WallClock::fastNowInMicroSec() - FLAGS_write_coalesce_window_us;
+    std::vector<std::pair<std::pair<GraphSpaceID, PartitionID>, Batch>> due;
+    std::vector<std::pair<std::pair<GraphSpaceID, PartitionID>, RemoveBatch>> dueRemoves;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (auto it = batches_.begin(); it != batches_.end();) {
+            if (it->second.firstArrivalUs <= deadline) {
+                due.emplace_back(it->first, std::move(it->second));
+                it = batches_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = removeBatches_.begin(); it != removeBatches_.end();) {
+            if (it->second.firstArrivalUs <= deadline) {
+                dueRemoves.emplace_back(it->first, std::move(it->second));
+                it = removeBatches_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    for (auto& entry : due) {
+        flush(entry.first.first, entry.first.second, std::move(entry.second));
+    }
+    for (auto& entry : dueRemoves) {
+        flushRemove(entry.first.first, entry.first.second, std::move(entry.second));
+    }
+}
+
+void WriteCoalescer::flush(GraphSpaceID spaceId, PartitionID partId, Batch batch) {
+    auto callbacks = std::make_shared<std::vector<kvstore::KVCallback>>(
+        std::move(batch.callbacks));
+    store_->asyncMultiPut(spaceId, partId, std::move(batch.data),
+                          [callbacks] (kvstore::ResultCode code) {
+        // demultiplex the batch result to every merged request
+        for (auto& cb : *callbacks) {
+            cb(code);
+        }
+    });
+}
+
+void WriteCoalescer::flushRemove(GraphSpaceID spaceId, PartitionID partId, RemoveBatch batch) {
+    auto callbacks = std::make_shared<std::vector<kvstore::KVCallback>>(
+        std::move(batch.callbacks));
+    store_->asyncMultiRemove(spaceId, partId, std::move(batch.keys),
+                             [callbacks] (kvstore::ResultCode code) {
+        for (auto& cb : *callbacks) {
+            cb(code);
+        }
+    });
+}
+
+}  // namespace storage
+}  // namespace nebula
@@ -0,0 +1,90 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_WRITECOALESCER_H_
+#define STORAGE_WRITECOALESCER_H_
+
+#include "common/base/Base.h"
+#include "common/thread/GenericWorker.h"
+#include "kvstore/KVStore.h"
+
+DECLARE_int64(write_coalesce_window_us);
+DECLARE_int32(write_coalesce_max_batch_kvs);
+
+namespace nebula {
+namespace storage {
+
+/**
+ * Merges the writes of separate requests to the same partition into one
+ * asyncMultiPut, so collectors sending many 1-3 edge requests still fill
+ * reasonable raft batches. A request parks in the per-partition pending
+ * batch until either the batch holds enough key/values or the oldest
+ * parked request has waited --write_coalesce_window_us; the merged
+ * batch commits as one raft round and every parked request gets the
+ * batch result through its own callback. Requests already carrying a
+ * large payload skip the window and go straight to the store.
+ *
+ * Removes coalesce the same way into per-partition asyncMultiRemove
+ * batches, kept separate from the put batches. Puts and removes parked
+ * in the same window are concurrent writes, so the order the two
+ * merged batches commit in is as valid as any interleaving the store
+ * could have picked for the original requests.
+ * */
+class WriteCoalescer final {
+public:
+    explicit WriteCoalescer(kvstore::KVStore* store) : store_(store) {}
+
+    ~WriteCoalescer() {
+        stop();
+    }
+
+    bool start();
+
+    void stop();
+
+    // Drop-in for KVStore::asyncMultiPut, the callback fires with the
+    // result of the merged batch the data ended up in
+    void asyncMultiPut(GraphSpaceID spaceId,
+                       PartitionID partId,
+                       std::vector<kvstore::KV> data,
+                       kvstore::KVCallback cb);
+
+    // Drop-in for KVStore::asyncMultiRemove with the same contract
+    void asyncMultiRemove(GraphSpaceID spaceId,
+                          PartitionID partId,
+                          std::vector<std::string> keys,
+                          kvstore::KVCallback cb);
+
+private:
+    struct Batch {
+        std::vector<kvstore::KV>            data;
+        std::vector<kvstore::KVCallback>    callbacks;
+        int64_t                             firstArrivalUs{0};
+    };
+
+    struct RemoveBatch {
+        std::vector<std::string>            keys;
+        std::vector<kvstore::KVCallback>    callbacks;
+        int64_t                             firstArrivalUs{0};
+    };
+
+    // Flushes every pending batch whose oldest request waited out the window
+    void tick();
+
+    void flush(GraphSpaceID spaceId, PartitionID partId, Batch batch);
+
+    void flushRemove(GraphSpaceID spaceId, PartitionID partId, RemoveBatch batch);
+
+    kvstore::KVStore*                                       store_{nullptr};
+    std::unique_ptr<thread::GenericWorker>                  bgThread_;
+    std::mutex                                              lock_;
+    std::map<std::pair<GraphSpaceID, PartitionID>, Batch>   batches_;
+    std::map<std::pair<GraphSpaceID, PartitionID>, RemoveBatch> removeBatches_;
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_WRITECOALESCER_H_
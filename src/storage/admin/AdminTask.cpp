@@ -7,12 +7,51 @@
 #include "storage/admin/AdminTask.h"
 #include "storage/admin/CompactTask.h"
 #include "storage/admin/FlushTask.h"
+#include "storage/admin/RebuildEdgeIndexTask.h"
+#include "storage/admin/RebuildTagIndexTask.h"
+#include "storage/AdmissionControl.h"
+#include "storage/StorageFlags.h"
+#include "common/time/WallClock.h"
+#include <thread>
 
 namespace nebula {
 namespace storage {
 
 using AdminCmd = nebula::meta::cpp2::AdminCmd;
 
+void AdminTask::chargeIO(size_t bytes) {
+    auto rate = ioRateBytes_;
+    auto target = FLAGS_read_latency_target_us;
+    if (rate > 0 && target > 0 &&
+            AdmissionControl::readLatencyAvgUs().load(std::memory_order_relaxed) > target) {
+        rate = std::max<int64_t>(rate / 4, 1);
+    }
+    if (rate <= 0 || bytes == 0) {
+        return;
+    }
+    int64_t sleepUs = 0;
+    {
+        std::lock_guard<std::mutex> lg(ioLock_);
+        auto nowUs = time::WallClock::fastNowInMicroSec();
+        if (ioLastUs_ != 0) {
+            ioAllowance_ += (nowUs - ioLastUs_) * rate / 1000000;
+        }
+        ioLastUs_ = nowUs;
+        // Cap the budget at one second's worth so an idle stretch does
+        // not bank an unbounded burst
+        if (ioAllowance_ > rate) {
+            ioAllowance_ = rate;
+        }
+        ioAllowance_ -= bytes;
+        if (ioAllowance_ < 0) {
+            sleepUs = -ioAllowance_ * 1000000 / rate;
+        }
+    }
+    if (sleepUs > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(sleepUs));
+    }
+}
+
 std::shared_ptr<AdminTask>
 AdminTaskFactory::createAdminTask(TaskContext&& ctx) {
     FLOG_INFO("%s (%d, %d)", __func__, ctx.jobId_, ctx.taskId_);
@@ -25,7 +64,10 @@ AdminTaskFactory::createAdminTask(TaskContext&& ctx) {
         ret = std::make_shared<FlushTask>(std::move(ctx));
         break;
     case AdminCmd::REBUILD_TAG_INDEX:
+        ret = std::make_shared<RebuildTagIndexTask>(std::move(ctx));
+        break;
     case AdminCmd::REBUILD_EDGE_INDEX:
+        ret = std::make_shared<RebuildEdgeIndexTask>(std::move(ctx));
         break;
     default:
         break;
@@ -10,6 +10,8 @@
 #include <folly/executors/task_queue/UnboundedBlockingQueue.h>
 #include "storage/admin/TaskUtils.h"
 #include "common/interface/gen-cpp2/storage_types.h"
+#include "common/meta/IndexManager.h"
+#include "common/meta/SchemaManager.h"
 #include "common/thrift/ThriftTypes.h"
 #include "kvstore/Common.h"
 #include "kvstore/NebulaStore.h"
@@ -47,19 +49,27 @@ struct TaskContext {
     TaskContext() = default;
     TaskContext(const cpp2::AddAdminTaskRequest& req,
                 kvstore::KVStore* store,
+                meta::SchemaManager* schemaMan,
+                meta::IndexManager* indexMan,
                 CallBack cb)
             : cmd_(req.get_cmd())
             , jobId_(req.get_job_id())
             , taskId_(req.get_task_id())
             , spaceId_(req.get_para().get_space_id())
+            , parameters_(req.get_para())
             , store_(store)
+            , schemaMan_(schemaMan)
+            , indexMan_(indexMan)
             , onFinish_(cb) {}
     nebula::meta::cpp2::AdminCmd    cmd_;
     int32_t                         jobId_{-1};
     int32_t                         taskId_{-1};
     int32_t                         spaceId_{-1};
+    cpp2::TaskPara                  parameters_;
     TaskPriority                    pri_{TaskPriority::MID};
     kvstore::KVStore*               store_{nullptr};
+    meta::SchemaManager*            schemaMan_{nullptr};
+    meta::IndexManager*             indexMan_{nullptr};
     CallBack                        onFinish_;
     size_t                          concurrentReq_{INT_MAX};
 };
@@ -96,6 +106,10 @@ public:
         return ctx_.jobId_;;
     }
 
+    virtual nebula::meta::cpp2::AdminCmd cmd() const {
+        return ctx_.cmd_;
+    }
+
     virtual int getTaskId() {
         return ctx_.taskId_;
     }
@@ -125,6 +139,34 @@ public:
         rc_.compare_exchange_strong(suc, cpp2::ErrorCode::E_USER_CANCEL);
     }
 
+    // A paused task keeps its queued sub-tasks; the task manager parks
+    // its workers between sub-task invocations until resume()
+    virtual void pause() {
+        FLOG_INFO("task(%d, %d) paused", ctx_.jobId_, ctx_.taskId_);
+        paused_ = true;
+    }
+
+    virtual void resume() {
+        FLOG_INFO("task(%d, %d) resumed", ctx_.jobId_, ctx_.taskId_);
+        paused_ = false;
+    }
+
+    virtual bool isPaused() const {
+        return paused_;
+    }
+
+    // The bytes-per-second I/O budget of this task's class, shared by
+    // all of its sub-tasks. 0 means no budget
+    void setIORate(int64_t bytesPerSec) {
+        ioRateBytes_ = bytesPerSec;
+    }
+
+    // Charge `bytes` against the budget, sleeping once the budget of
+    // the current second is spent. While the foreground read latency
+    // sits above --read_latency_target_us only a quarter of the budget
+    // is handed out, so maintenance yields to production traffic first
+    void chargeIO(size_t bytes);
+
 public:
     std::atomic<size_t>         unFinishedSubTask_;
     SubTaskQueue                subtasks_;
@@ -132,6 +174,13 @@ public:
 protected:
     TaskContext                     ctx_;
     std::atomic<cpp2::ErrorCode>    rc_{cpp2::ErrorCode::SUCCEEDED};
+    std::atomic<bool>               paused_{false};
+
+private:
+    int64_t                         ioRateBytes_{0};
+    std::mutex                      ioLock_;
+    int64_t                         ioAllowance_{0};
+    int64_t                         ioLastUs_{0};
 };
 
 class AdminTaskFactory {
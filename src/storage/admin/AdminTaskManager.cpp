@@ -6,6 +6,8 @@
 
 #include "storage/admin/AdminTaskManager.h"
 #include "storage/admin/AdminTask.h"
+#include "storage/AdmissionControl.h"
+#include "storage/StorageFlags.h"
 
 DEFINE_uint32(max_task_concurrency, 10, "The tasks number could be invoked simultaneously");
 DEFINE_uint32(max_concurrent_subtasks, 10, "The sub tasks could be invoked simultaneously");
@@ -16,6 +18,17 @@ namespace storage {
 using ResultCode = nebula::kvstore::ResultCode;
 using TaskHandle = std::pair<int, int>;     // jobid + taskid
 
+// static
+int64_t AdminTaskManager::ioBudgetFor(nebula::meta::cpp2::AdminCmd cmd) {
+    switch (cmd) {
+    case nebula::meta::cpp2::AdminCmd::REBUILD_TAG_INDEX:
+    case nebula::meta::cpp2::AdminCmd::REBUILD_EDGE_INDEX:
+        return FLAGS_rebuild_index_rate_limit;
+    default:
+        return FLAGS_admin_task_io_rate_limit;
+    }
+}
+
 bool AdminTaskManager::init() {
     LOG(INFO) << "max concurrenct subtasks: " << FLAGS_max_concurrent_subtasks;
     pool_ = std::make_unique<ThreadPool>(FLAGS_max_concurrent_subtasks);
@@ -34,6 +47,7 @@ void AdminTaskManager::addAsyncTask(std::shared_ptr<AdminTask> task) {
     LOG(INFO) << folly::stringPrintf("try enqueue task(%d, %d), con req=%zu",
                                      task->getJobId(), task->getTaskId(),
                                      task->getConcurrentReq());
+    task->setIORate(ioBudgetFor(task->cmd()));
     tasks_.insert(handle, task);
     taskQueue_.add(handle);
     LOG(INFO) << folly::stringPrintf("enqueue task(%d, %d), con req=%zu",
@@ -56,6 +70,28 @@ cpp2::ErrorCode AdminTaskManager::cancelJob(int jobId) {
     return ret;
 }
 
+cpp2::ErrorCode AdminTaskManager::pauseJob(int jobId) {
+    auto ret = cpp2::ErrorCode::E_KEY_NOT_FOUND;
+    for (auto it = tasks_.begin(); it != tasks_.end(); ++it) {
+        if (it->first.first == jobId) {
+            it->second->pause();
+            ret = cpp2::ErrorCode::SUCCEEDED;
+        }
+    }
+    return ret;
+}
+
+cpp2::ErrorCode AdminTaskManager::resumeJob(int jobId) {
+    auto ret = cpp2::ErrorCode::E_KEY_NOT_FOUND;
+    for (auto it = tasks_.begin(); it != tasks_.end(); ++it) {
+        if (it->first.first == jobId) {
+            it->second->resume();
+            ret = cpp2::ErrorCode::SUCCEEDED;
+        }
+    }
+    return ret;
+}
+
 cpp2::ErrorCode AdminTaskManager::cancelTask(int jobId, int taskId) {
     if (taskId < 0) {
         return cancelJob(jobId);
@@ -149,6 +185,18 @@ void AdminTaskManager::runSubTask(TaskHandle handle) {
         return;
     }
     auto task = it->second;
+    // Yield the worker while the task is paused or the foreground read
+    // latency sits above its target; the sub-task stays queued and the
+    // requeue lets other jobs' work through in the meantime
+    auto target = FLAGS_read_latency_target_us;
+    bool hot = target > 0 &&
+               AdmissionControl::readLatencyAvgUs().load(std::memory_order_relaxed) > target;
+    if ((task->isPaused() || hot) &&
+            !shutdown_ && task->status() == cpp2::ErrorCode::SUCCEEDED) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        pool_->add(std::bind(&AdminTaskManager::runSubTask, this, handle));
+        return;
+    }
     std::chrono::milliseconds take_dura{10};
     if (auto subTask = task->subtasks_.try_take_for(take_dura)) {
         if (task->status() == cpp2::ErrorCode::SUCCEEDED) {
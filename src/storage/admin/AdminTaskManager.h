@@ -44,6 +44,11 @@ public:
     cpp2::ErrorCode cancelJob(int jobId);
     cpp2::ErrorCode cancelTask(int jobId, int taskId = -1);
 
+    // Park/unpark every task of a job between sub-task invocations;
+    // queued sub-tasks and checkpoints are kept
+    cpp2::ErrorCode pauseJob(int jobId);
+    cpp2::ErrorCode resumeJob(int jobId);
+
     bool init();
 
     void shutdown();
@@ -51,6 +56,8 @@ public:
 private:
     void schedule();
     void runSubTask(TaskHandle handle);
+    // The bytes-per-second I/O budget of a task class
+    static int64_t ioBudgetFor(nebula::meta::cpp2::AdminCmd cmd);
 
 private:
     bool                                    shutdown_{false};
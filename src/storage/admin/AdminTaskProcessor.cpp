@@ -26,7 +26,7 @@ void AdminTaskProcessor::process(const cpp2::AddAdminTaskRequest& req) {
         onFinished();
     };
 
-    TaskContext ctx(req, store, cb);
+    TaskContext ctx(req, store, env_->schemaMan_, env_->indexMan_, cb);
     auto task = AdminTaskFactory::createAdminTask(std::move(ctx));
     if (task) {
         runDirectly = false;
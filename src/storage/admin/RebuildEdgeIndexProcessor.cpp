@@ -34,7 +34,8 @@ void RebuildEdgeIndexProcessor::process(const cpp2::RebuildIndexRequest& req) {
         if (req.get_is_offline()) {
             std::unique_ptr<kvstore::KVIterator> iter;
             auto prefix = NebulaKeyUtils::prefix(part);
-            auto ret = kvstore_->prefix(space, part, prefix, &iter);
+            auto ret = kvstore_->prefix(space, part, prefix, &iter,
+                                        false, kvstore::ScanHint::BULK);
             if (ret != kvstore::ResultCode::SUCCEEDED) {
                 LOG(ERROR) << "Processing Part " << part << " Failed";
                 this->pushResultCode(to(ret), part);
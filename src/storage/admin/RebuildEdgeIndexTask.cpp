@@ -0,0 +1,68 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/admin/RebuildEdgeIndexTask.h"
+#include "codec/RowReader.h"
+#include "utils/IndexKeyUtils.h"
+#include "utils/NebulaKeyUtils.h"
+
+namespace nebula {
+namespace storage {
+
+StatusOr<std::shared_ptr<meta::cpp2::IndexItem>>
+RebuildEdgeIndexTask::getIndex(GraphSpaceID space, IndexID indexId) {
+    return ctx_.indexMan_->getEdgeIndex(space, indexId);
+}
+
+StatusOr<size_t> RebuildEdgeIndexTask::genIndexEntry(PartitionID part,
+                                                     const folly::StringPiece& key,
+                                                     const folly::StringPiece& val,
+                                                     std::string& lastRecordId,
+                                                     SchemaVerCache* schemaCache,
+                                                     IndexStats* stats,
+                                                     std::vector<kvstore::KV>& data) {
+    auto edgeType = index_->get_schema_id().get_edge_type();
+    // In-edges carry the negative edge type, so only the out-going copy
+    // of each edge passes this filter
+    if (!NebulaKeyUtils::isEdge(vIdLen_, key) ||
+        NebulaKeyUtils::getEdgeType(vIdLen_, key) != edgeType) {
+        return 0;
+    }
+
+    // The versions of one edge sit next to each other in the scan,
+    // newest first; only the newest one feeds the index
+    auto recordId = NebulaKeyUtils::keyWithNoVersion(key).str();
+    if (recordId == lastRecordId) {
+        return 0;
+    }
+    lastRecordId = std::move(recordId);
+
+    auto reader = RowReader::getEdgePropReader(ctx_.schemaMan_, ctx_.spaceId_, edgeType, val,
+                                               schemaCache);
+    if (reader == nullptr) {
+        return Status::Error("Invalid row of edge %d", edgeType);
+    }
+    std::vector<Value::Type> colsType;
+    auto values = IndexKeyUtils::collectIndexValues(reader.get(), index_->get_fields(), colsType);
+    if (!values.ok()) {
+        return values.status();
+    }
+    stats->addRow(values.value().empty() ? std::string()
+                                         : IndexKeyUtils::encodeValue(values.value()[0]));
+
+    auto src = NebulaKeyUtils::getSrcId(vIdLen_, key);
+    auto dst = NebulaKeyUtils::getDstId(vIdLen_, key);
+    auto rank = NebulaKeyUtils::getRank(vIdLen_, key);
+    auto indexKey = IndexKeyUtils::edgeIndexKey(vIdLen_, part, index_->get_index_id(),
+                                                src.str(), rank, dst.str(),
+                                                std::move(values).value(), colsType);
+    auto bytes = indexKey.size();
+    data.emplace_back(std::move(indexKey), "");
+    return bytes;
+}
+
+}  // namespace storage
+}  // namespace nebula
@@ -0,0 +1,200 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/admin/RebuildIndexTask.h"
+#include <folly/synchronization/Baton.h>
+#include "common/time/WallClock.h"
+#include "storage/StorageFlags.h"
+#include "utils/NebulaKeyUtils.h"
+
+namespace nebula {
+namespace storage {
+
+ErrorOr<cpp2::ErrorCode, std::vector<AdminSubTask>>
+RebuildIndexTask::genSubTasks() {
+    auto space = ctx_.spaceId_;
+    if (ctx_.parameters_.task_specfic_paras.empty()) {
+        LOG(ERROR) << "Index id is missing in the task parameters";
+        return cpp2::ErrorCode::E_INVALID_TASK_PARA;
+    }
+
+    IndexID indexId;
+    try {
+        indexId = folly::to<IndexID>(ctx_.parameters_.task_specfic_paras[0]);
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Bad index id \"" << ctx_.parameters_.task_specfic_paras[0]
+                   << "\": " << e.what();
+        return cpp2::ErrorCode::E_INVALID_TASK_PARA;
+    }
+
+    auto itemRet = getIndex(space, indexId);
+    if (!itemRet.ok()) {
+        LOG(ERROR) << "Index " << indexId << " Not Found";
+        return cpp2::ErrorCode::E_INDEX_NOT_FOUND;
+    }
+    index_ = itemRet.value();
+
+    auto vIdLenRet = ctx_.schemaMan_->getSpaceVidLen(space);
+    if (!vIdLenRet.ok()) {
+        LOG(ERROR) << "Space " << space << " Not Found";
+        return cpp2::ErrorCode::E_SPACE_NOT_FOUND;
+    }
+    vIdLen_ = vIdLenRet.value();
+
+    LOG(INFO) << "Rebuild Index Space " << space << " Index " << indexId
+              << " Parts " << ctx_.parameters_.parts.size();
+
+    std::vector<AdminSubTask> tasks;
+    using FuncObj = std::function<kvstore::ResultCode()>;
+    for (auto part : ctx_.parameters_.parts) {
+        FuncObj obj = std::bind(&RebuildIndexTask::buildIndexPart, this, part);
+        tasks.emplace_back(obj);
+    }
+    return tasks;
+}
+
+kvstore::ResultCode RebuildIndexTask::buildIndexPart(PartitionID part) {
+    auto space = ctx_.spaceId_;
+    auto prefix = NebulaKeyUtils::partPrefix(part);
+    auto checkpointKey = NebulaKeyUtils::systemRebuildIndexKey(part, index_->get_index_id());
+
+    // Resume from the checkpoint a previous run left behind, if any.
+    // Everything up to the checkpointed key has been indexed already;
+    // re-indexing the checkpointed key itself is harmless
+    auto start = prefix;
+    std::string savedKey;
+    IndexStats stats;
+    auto ret = ctx_.store_->get(space, part, checkpointKey, &savedKey);
+    if (ret == kvstore::ResultCode::SUCCEEDED) {
+        if (!savedKey.empty()) {
+            LOG(INFO) << "Resume rebuilding index of Part " << part << " from checkpoint";
+            start = savedKey;
+            // Keep counting into the statistics of the interrupted run,
+            // so they end up covering the whole part
+            std::string rawStats;
+            auto statsKey = NebulaKeyUtils::systemIndexStatsKey(part, index_->get_index_id());
+            if (ctx_.store_->get(space, part, statsKey, &rawStats)
+                    == kvstore::ResultCode::SUCCEEDED) {
+                auto savedStats = IndexStats::decode(rawStats);
+                if (savedStats.ok()) {
+                    stats = std::move(savedStats).value();
+                }
+            }
+        }
+    } else if (ret != kvstore::ResultCode::ERR_KEY_NOT_FOUND) {
+        return ret;
+    }
+
+    std::unique_ptr<kvstore::KVIterator> iter;
+    ret = ctx_.store_->rangeWithPrefix(space, part, start, prefix, &iter,
+                                       false, kvstore::ScanHint::BULK);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        LOG(ERROR) << "Processing Part " << part << " Failed";
+        return ret;
+    }
+
+    std::vector<kvstore::KV> data;
+    data.reserve(FLAGS_rebuild_index_batch_num);
+    size_t batchBytes = 0;
+    std::string lastRecordId;
+    std::string lastKey;
+    SchemaVerCache schemaCache;
+    while (iter && iter->valid()) {
+        if (data.size() >= static_cast<size_t>(FLAGS_rebuild_index_batch_num)) {
+            if (status() != cpp2::ErrorCode::SUCCEEDED) {
+                // The task was cancelled. The checkpoint already written
+                // lets a later run pick up where this one stopped
+                LOG(INFO) << "Rebuild of Part " << part << " stopped at checkpoint";
+                return kvstore::ResultCode::SUCCEEDED;
+            }
+            chargeIO(batchBytes);
+            auto result = writeBatch(part, std::move(data));
+            if (result != kvstore::ResultCode::SUCCEEDED) {
+                LOG(ERROR) << "Write Part " << part << " Index Failed";
+                return result;
+            }
+            result = saveCheckpoint(part, lastKey, stats);
+            if (result != kvstore::ResultCode::SUCCEEDED) {
+                return result;
+            }
+            data.clear();
+            data.reserve(FLAGS_rebuild_index_batch_num);
+            batchBytes = 0;
+        }
+
+        auto key = iter->key();
+        auto staged = genIndexEntry(part, key, iter->val(), lastRecordId,
+                                    &schemaCache, &stats, data);
+        if (!staged.ok()) {
+            LOG(ERROR) << "Part " << part << ": " << staged.status();
+            return kvstore::ResultCode::ERR_INVALID_DATA;
+        }
+        batchBytes += staged.value();
+        lastKey = key.str();
+        iter->next();
+    }
+
+    chargeIO(batchBytes);
+    data.emplace_back(NebulaKeyUtils::systemIndexStatsKey(part, index_->get_index_id()),
+                      stats.encode());
+    auto result = writeBatch(part, std::move(data));
+    if (result != kvstore::ResultCode::SUCCEEDED) {
+        LOG(ERROR) << "Write Part " << part << " Index Failed";
+        return result;
+    }
+    LOG(INFO) << "Part " << part << " index " << index_->get_index_id()
+              << " rebuilt: " << stats.rowCount() << " rows, ~"
+              << stats.distinctLeading() << " distinct leading values";
+    removeCheckpoint(part);
+    return kvstore::ResultCode::SUCCEEDED;
+}
+
+kvstore::ResultCode RebuildIndexTask::writeBatch(PartitionID part,
+                                                 std::vector<kvstore::KV>&& data) {
+    if (data.empty()) {
+        return kvstore::ResultCode::SUCCEEDED;
+    }
+    folly::Baton<true, std::atomic> baton;
+    auto ret = kvstore::ResultCode::SUCCEEDED;
+    ctx_.store_->asyncMultiPut(ctx_.spaceId_, part, std::move(data),
+                               [&ret, &baton] (kvstore::ResultCode code) {
+        if (kvstore::ResultCode::SUCCEEDED != code) {
+            ret = code;
+        }
+        baton.post();
+    });
+    baton.wait();
+    return ret;
+}
+
+kvstore::ResultCode RebuildIndexTask::saveCheckpoint(PartitionID part,
+                                                     const std::string& lastKey,
+                                                     const IndexStats& stats) {
+    std::vector<kvstore::KV> data;
+    data.emplace_back(NebulaKeyUtils::systemRebuildIndexKey(part, index_->get_index_id()),
+                      lastKey);
+    data.emplace_back(NebulaKeyUtils::systemIndexStatsKey(part, index_->get_index_id()),
+                      stats.encode());
+    return writeBatch(part, std::move(data));
+}
+
+void RebuildIndexTask::removeCheckpoint(PartitionID part) {
+    auto checkpointKey = NebulaKeyUtils::systemRebuildIndexKey(part, index_->get_index_id());
+    folly::Baton<true, std::atomic> baton;
+    ctx_.store_->asyncRemove(ctx_.spaceId_, part, checkpointKey,
+                             [part, &baton] (kvstore::ResultCode code) {
+        if (kvstore::ResultCode::SUCCEEDED != code) {
+            // Not fatal: a stale checkpoint only makes the next rebuild
+            // of this index resume near the end of the part
+            LOG(WARNING) << "Remove rebuild checkpoint of Part " << part << " Failed";
+        }
+        baton.post();
+    });
+    baton.wait();
+}
+
+}  // namespace storage
+}  // namespace nebula
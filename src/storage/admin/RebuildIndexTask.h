@@ -0,0 +1,71 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_ADMIN_REBUILDINDEXTASK_H_
+#define STORAGE_ADMIN_REBUILDINDEXTASK_H_
+
+#include "common/interface/gen-cpp2/meta_types.h"
+#include "codec/RowReader.h"
+#include "kvstore/NebulaStore.h"
+#include "storage/admin/AdminTask.h"
+#include "storage/index/IndexStats.h"
+
+namespace nebula {
+namespace storage {
+
+// Rebuilds one index as an admin task. Every part of the request
+// becomes its own subtask, so the task manager runs parts concurrently
+// up to the job's concurrency. After each written batch the scan
+// position is checkpointed under a system key, so a rebuild interrupted
+// by a restart resumes from the checkpoint instead of rescanning the
+// part, and all parts charge their writes against the task's shared
+// bytes-per-second budget (--rebuild_index_rate_limit, assigned by the
+// task manager) so a rebuild cannot saturate the disks serving online
+// traffic.
+class RebuildIndexTask : public AdminTask {
+public:
+    explicit RebuildIndexTask(TaskContext&& ctx) : AdminTask(std::move(ctx)) {}
+
+    ErrorOr<cpp2::ErrorCode, std::vector<AdminSubTask>> genSubTasks() override;
+
+protected:
+    // Look the index item up in the meta cache
+    virtual StatusOr<std::shared_ptr<meta::cpp2::IndexItem>>
+    getIndex(GraphSpaceID space, IndexID indexId) = 0;
+
+    // Called for every record of the part scan, in key order. Stages the
+    // index entry of a record the index covers, counts it into `stats`,
+    // and returns the number of bytes staged; records of other schemas
+    // and stale versions contribute nothing. `lastRecordId` and
+    // `schemaCache` are per-part scratch: the former lets the subclass
+    // skip older versions of the record it just indexed, the latter
+    // spares the per-row schema version resolution
+    virtual StatusOr<size_t> genIndexEntry(PartitionID part,
+                                           const folly::StringPiece& key,
+                                           const folly::StringPiece& val,
+                                           std::string& lastRecordId,
+                                           SchemaVerCache* schemaCache,
+                                           IndexStats* stats,
+                                           std::vector<kvstore::KV>& data) = 0;
+
+    kvstore::ResultCode buildIndexPart(PartitionID part);
+
+    size_t                                  vIdLen_{0};
+    std::shared_ptr<meta::cpp2::IndexItem>  index_;
+
+private:
+    kvstore::ResultCode writeBatch(PartitionID part, std::vector<kvstore::KV>&& data);
+    // The statistics are persisted with every checkpoint, so they stay
+    // consistent with the checkpointed scan position across a resume
+    kvstore::ResultCode saveCheckpoint(PartitionID part,
+                                       const std::string& lastKey,
+                                       const IndexStats& stats);
+    void removeCheckpoint(PartitionID part);
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_ADMIN_REBUILDINDEXTASK_H_
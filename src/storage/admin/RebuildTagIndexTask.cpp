@@ -0,0 +1,62 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/admin/RebuildTagIndexTask.h"
+#include "codec/RowReader.h"
+#include "utils/IndexKeyUtils.h"
+#include "utils/NebulaKeyUtils.h"
+
+namespace nebula {
+namespace storage {
+
+StatusOr<std::shared_ptr<meta::cpp2::IndexItem>>
+RebuildTagIndexTask::getIndex(GraphSpaceID space, IndexID indexId) {
+    return ctx_.indexMan_->getTagIndex(space, indexId);
+}
+
+StatusOr<size_t> RebuildTagIndexTask::genIndexEntry(PartitionID part,
+                                                    const folly::StringPiece& key,
+                                                    const folly::StringPiece& val,
+                                                    std::string& lastRecordId,
+                                                    SchemaVerCache* schemaCache,
+                                                    IndexStats* stats,
+                                                    std::vector<kvstore::KV>& data) {
+    auto tagId = index_->get_schema_id().get_tag_id();
+    if (!NebulaKeyUtils::isVertex(vIdLen_, key) ||
+        NebulaKeyUtils::getTagId(vIdLen_, key) != tagId) {
+        return 0;
+    }
+
+    // The versions of one vertex tag sit next to each other in the
+    // scan, newest first; only the newest one feeds the index
+    auto vId = NebulaKeyUtils::getVertexId(vIdLen_, key);
+    if (vId == lastRecordId) {
+        return 0;
+    }
+    lastRecordId = vId.str();
+
+    auto reader = RowReader::getTagPropReader(ctx_.schemaMan_, ctx_.spaceId_, tagId, val,
+                                              schemaCache);
+    if (reader == nullptr) {
+        return Status::Error("Invalid row of tag %d", tagId);
+    }
+    std::vector<Value::Type> colsType;
+    auto values = IndexKeyUtils::collectIndexValues(reader.get(), index_->get_fields(), colsType);
+    if (!values.ok()) {
+        return values.status();
+    }
+    stats->addRow(values.value().empty() ? std::string()
+                                         : IndexKeyUtils::encodeValue(values.value()[0]));
+
+    auto indexKey = IndexKeyUtils::vertexIndexKey(vIdLen_, part, index_->get_index_id(),
+                                                  vId.str(), std::move(values).value(), colsType);
+    auto bytes = indexKey.size();
+    data.emplace_back(std::move(indexKey), "");
+    return bytes;
+}
+
+}  // namespace storage
+}  // namespace nebula
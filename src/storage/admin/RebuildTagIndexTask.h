@@ -0,0 +1,34 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_ADMIN_REBUILDTAGINDEXTASK_H_
+#define STORAGE_ADMIN_REBUILDTAGINDEXTASK_H_
+
+#include "storage/admin/RebuildIndexTask.h"
+
+namespace nebula {
+namespace storage {
+
+class RebuildTagIndexTask : public RebuildIndexTask {
+public:
+    explicit RebuildTagIndexTask(TaskContext&& ctx) : RebuildIndexTask(std::move(ctx)) {}
+
+protected:
+    StatusOr<std::shared_ptr<meta::cpp2::IndexItem>>
+    getIndex(GraphSpaceID space, IndexID indexId) override;
+
+    StatusOr<size_t> genIndexEntry(PartitionID part,
+                                   const folly::StringPiece& key,
+                                   const folly::StringPiece& val,
+                                   std::string& lastRecordId,
+                                   SchemaVerCache* schemaCache,
+                                   IndexStats* stats,
+                                   std::vector<kvstore::KV>& data) override;
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_ADMIN_REBUILDTAGINDEXTASK_H_
@@ -14,11 +14,23 @@ Value StorageExpressionContext::readValue(const std::string& propName) const {
     if (!schema_) {
         return Value::kNullValue;
     }
-    auto field = schema_->field(propName);
+    auto* readerSchema = reader_->getSchema();
+    auto& cached = fieldCache_[propName];
+    if (cached.readerSchema != readerSchema) {
+        auto field = schema_->field(propName);
+        cached.readerSchema = readerSchema;
+        cached.index = field != nullptr ? readerSchema->getFieldIndex(propName) : -1;
+        cached.field = field;
+    }
+    auto* field = cached.field;
     if (!field) {
        return Value::kNullValue;
     }
-    auto value = reader_->getValueByName(propName);
+    // The prop may not be in the row's schema version yet, which reads
+    // as an unknown prop
+    auto value = cached.index >= 0
+        ? reader_->getValueByIndex(cached.index)
+        : Value(NullType::UNKNOWN_PROP);
     if (value.type() == Value::Type::NULLVALUE) {
         // read null value
         auto nullType = value.getNull();
@@ -49,12 +61,12 @@ Value StorageExpressionContext::getEdgeProp(const std::string& edgeName,
             return readValue(prop);
         }
     } else {
-        auto iter = edgeFilters_.find(std::make_pair(edgeName, prop));
-        if (iter == edgeFilters_.end()) {
+        auto* value = edgeFilters_.find(edgeName, prop);
+        if (value == nullptr) {
             return Value::kNullValue;
         }
         VLOG(1) << "Hit srcProp filter for edge " << edgeName << ", prop " << prop;
-        return iter->second;
+        return *value;
     }
 }
 
@@ -66,12 +78,12 @@ Value StorageExpressionContext::getSrcProp(const std::string& tagName,
         }
         return readValue(prop);
     } else {
-        auto iter = tagFilters_.find(std::make_pair(tagName, prop));
-        if (iter == tagFilters_.end()) {
+        auto* value = tagFilters_.find(tagName, prop);
+        if (value == nullptr) {
             return Value::kNullValue;
         }
         VLOG(1) << "Hit srcProp filter for tag " << tagName << ", prop " << prop;
-        return iter->second;
+        return *value;
     }
 }
 
@@ -15,6 +15,90 @@
 namespace nebula {
 namespace storage {
 
+// Flat open-addressing map from a (tag/edge name, prop) pair to the
+// value set for filter evaluation. A plan sets and clears the same
+// small key set once per vertex, so the table keeps its slots across
+// clears, including the capacity of the key strings: clear() only
+// bumps an epoch and stale slots are reclaimed as they are probed,
+// which avoids the per-vertex node allocations of an unordered_map
+class FilterPropTable {
+public:
+    FilterPropTable() : slots_(kInitCapacity) {}
+
+    void set(const std::string& name, const std::string& prop, Value value) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            grow();
+        }
+        auto hash = hashKey(name, prop);
+        auto& slot = slots_[probe(hash, name, prop)];
+        if (slot.epoch != epoch_) {
+            slot.epoch = epoch_;
+            slot.hash = hash;
+            slot.name.assign(name);
+            slot.prop.assign(prop);
+            ++size_;
+        }
+        slot.value = std::move(value);
+    }
+
+    const Value* find(const std::string& name, const std::string& prop) const {
+        const auto& slot = slots_[probe(hashKey(name, prop), name, prop)];
+        return slot.epoch == epoch_ ? &slot.value : nullptr;
+    }
+
+    void clear() {
+        ++epoch_;
+        size_ = 0;
+    }
+
+private:
+    struct Slot {
+        uint64_t      hash{0};
+        // holds a live entry only when this matches the table's epoch,
+        // anything older is free space
+        uint64_t      epoch{0};
+        std::string   name;
+        std::string   prop;
+        Value         value;
+    };
+
+    static uint64_t hashKey(const std::string& name, const std::string& prop) {
+        auto hash = folly::hash::SpookyHashV2::Hash64(name.data(), name.size(), 0);
+        return folly::hash::SpookyHashV2::Hash64(prop.data(), prop.size(), hash);
+    }
+
+    // Returns the index of the live entry of the key, or of the free
+    // slot where it would go. Probe chains contain only live slots, so
+    // a stale slot ends the probe
+    size_t probe(uint64_t hash, const std::string& name, const std::string& prop) const {
+        auto mask = slots_.size() - 1;
+        auto idx = hash & mask;
+        while (true) {
+            const auto& slot = slots_[idx];
+            if (slot.epoch != epoch_ ||
+                    (slot.hash == hash && slot.name == name && slot.prop == prop)) {
+                return idx;
+            }
+            idx = (idx + 1) & mask;
+        }
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        old.swap(slots_);
+        for (auto& slot : old) {
+            if (slot.epoch == epoch_) {
+                slots_[probe(slot.hash, slot.name, slot.prop)] = std::move(slot);
+            }
+        }
+    }
+
+    static constexpr size_t kInitCapacity = 16;
+    std::vector<Slot>   slots_;
+    size_t              size_ = 0;
+    uint64_t            epoch_ = 1;
+};
+
 /*
 StorageExpressionContext supports both read value from a RowReader, or user set value by
 `setTagProp` and `setEdgeProp`.
@@ -89,11 +173,15 @@ public:
         key_ = "";
         name_ = "";
         schema_ = nullptr;
+        fieldCache_.clear();
     }
 
     void resetSchema(const std::string& name,
                      const meta::NebulaSchemaProvider* schema,
                      bool isEdge) {
+        if (schema != schema_) {
+            fieldCache_.clear();
+        }
         name_ = name;
         schema_ = schema;
         isEdge_ = isEdge;
@@ -102,13 +190,13 @@ public:
     void setTagProp(const std::string& tagName,
                     const std::string& prop,
                     nebula::Value value) {
-        tagFilters_[std::make_pair(tagName, prop)] = std::move(value);
+        tagFilters_.set(tagName, prop, std::move(value));
     }
 
     void setEdgeProp(const std::string& edgeName,
                      const std::string& prop,
                      nebula::Value value) {
-        edgeFilters_[std::make_pair(edgeName, prop)] = std::move(value);
+        edgeFilters_.set(edgeName, prop, std::move(value));
     }
 
     void clear() {
@@ -129,11 +217,27 @@ private:
     const meta::NebulaSchemaProvider  *schema_;
     bool                               isEdge_;
 
+    // A prop name resolved against the current schemas. A filter
+    // evaluates the same props for every row, so the name lookups run
+    // once per schema instead of once per row; the entry is re-resolved
+    // when a row of another schema version shows up
+    struct ResolvedField {
+        // The schema of the row the index was resolved against
+        const meta::SchemaProviderIf          *readerSchema;
+        // Field index in readerSchema, -1 when the prop is not in that
+        // version
+        int64_t                                index;
+        // The field in the latest schema_, for default value handling;
+        // nullptr when the prop does not exist at all
+        const meta::SchemaProviderIf::Field   *field;
+    };
+    mutable std::unordered_map<std::string, ResolvedField> fieldCache_;
+
     // <tagName, property> -> value
-    std::unordered_map<std::pair<std::string, std::string>, nebula::Value> tagFilters_;
+    FilterPropTable tagFilters_;
 
     // <edgeName, property> -> value
-    std::unordered_map<std::pair<std::string, std::string>, nebula::Value> edgeFilters_;
+    FilterPropTable edgeFilters_;
 };
 
 }  // namespace storage
@@ -20,11 +20,36 @@ struct PropStat {
 
     explicit PropStat(const cpp2::StatType& statType) : statType_(statType) {}
 
+    // The accumulation kernel of the stat, selected once per request
+    // from the stat type and the field type, so the per-row update is
+    // a raw int64/double operation instead of Value arithmetic with a
+    // type branch per row. GENERIC is the Value fallback for anything
+    // the monomorphic kernels do not cover; a kernel also demotes
+    // itself to GENERIC when a row yields a non-numeric value, e.g. a
+    // null of a nullable field, keeping the null propagation of the
+    // Value path
+    enum class Kernel : uint8_t {
+        GENERIC = 0,
+        SUM_INT,     // also AVG over an integer field
+        SUM_FLOAT,   // also AVG over a float field
+        MIN_INT,
+        MIN_FLOAT,
+        MAX_INT,
+        MAX_FLOAT,
+    };
+
     cpp2::StatType statType_;
     mutable Value sum_ = 0L;
     mutable Value count_ = 0L;
     mutable Value min_ = std::numeric_limits<int64_t>::max();
     mutable Value max_ = std::numeric_limits<int64_t>::min();
+
+    mutable Kernel kernel_ = Kernel::GENERIC;
+    // The raw accumulators of the monomorphic kernels: accI_ holds the
+    // int sum/min/max, accD_ the float one, countI_ the rows folded in
+    mutable int64_t accI_ = 0;
+    mutable double accD_ = 0.0;
+    mutable int64_t countI_ = 0;
 };
 
 // AggregateNode will only be used in GetNeighbors for now, it need to calculate some stat of all
@@ -39,7 +64,9 @@ public:
                   EdgeContext* edgeContext)
         : IterateNode<T>(upstream)
         , planContext_(planCtx)
-        , edgeContext_(edgeContext) {}
+        , edgeContext_(edgeContext) {
+        this->name_ = "AggregateNode";
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
         auto ret = RelNode<T>::execute(partId, vId);
@@ -70,6 +97,9 @@ public:
         nebula::List result;
         result.values.reserve(stats_.size());
         for (const auto& stat : stats_) {
+            // fold the raw accumulator of a monomorphic kernel into the
+            // Value fields the emission below reads
+            demoteToGeneric(stat);
             if (stat.statType_ == cpp2::StatType::SUM) {
                 result.values.emplace_back(stat.sum_);
             } else if (stat.statType_ == cpp2::StatType::COUNT) {
@@ -112,6 +142,8 @@ private:
                     if (ctx.hasStat_) {
                         for (size_t i = 0; i < ctx.statType_.size(); i++) {
                             PropStat stat(ctx.statType_[i]);
+                            stat.kernel_ = selectKernel(ctx.statType_[i], ctx);
+                            initKernel(stat);
                             stats_[ctx.statIndex_[i]] = std::move(stat);
                         }
                     }
@@ -129,20 +161,164 @@ private:
         for (const auto& prop : *props) {
             if (prop.hasStat_) {
                 for (const auto statIndex : prop.statIndex_) {
+                    auto& stat = stats_[statIndex];
+                    if (stat.statType_ == cpp2::StatType::COUNT) {
+                        // COUNT never looks at the value, so don't
+                        // decode it; in the count-only scan mode there
+                        // is no reader at all
+                        stat.count_ = stat.count_ + 1;
+                        continue;
+                    }
                     VLOG(2) << "Collect stat prop " << prop.name_ << ", type " << edgeType;
                     auto value = QueryUtils::readEdgeProp(srcId, edgeType, edgeRank, dstId,
                                                           reader, prop);
                     if (!value.ok()) {
                         return kvstore::ResultCode::ERR_EDGE_PROP_NOT_FOUND;
                     }
-                    addStatValue(std::move(value).value(), stats_[statIndex]);
+                    addStatValue(std::move(value).value(), stat);
                 }
             }
         }
         return kvstore::ResultCode::SUCCEEDED;
     }
 
+    static PropStat::Kernel selectKernel(const cpp2::StatType& statType,
+                                         const PropContext& ctx) {
+        if (ctx.field_ == nullptr) {
+            return PropStat::Kernel::GENERIC;
+        }
+        auto fType = ctx.field_->type();
+        bool isInt = fType == meta::cpp2::PropertyType::INT64 ||
+                     fType == meta::cpp2::PropertyType::INT32 ||
+                     fType == meta::cpp2::PropertyType::INT16 ||
+                     fType == meta::cpp2::PropertyType::INT8;
+        bool isFloat = fType == meta::cpp2::PropertyType::FLOAT ||
+                       fType == meta::cpp2::PropertyType::DOUBLE;
+        if (!isInt && !isFloat) {
+            return PropStat::Kernel::GENERIC;
+        }
+        switch (statType) {
+            case cpp2::StatType::SUM:
+            case cpp2::StatType::AVG:
+                return isInt ? PropStat::Kernel::SUM_INT : PropStat::Kernel::SUM_FLOAT;
+            case cpp2::StatType::MIN:
+                return isInt ? PropStat::Kernel::MIN_INT : PropStat::Kernel::MIN_FLOAT;
+            case cpp2::StatType::MAX:
+                return isInt ? PropStat::Kernel::MAX_INT : PropStat::Kernel::MAX_FLOAT;
+            case cpp2::StatType::COUNT:
+                break;
+        }
+        return PropStat::Kernel::GENERIC;
+    }
+
+    static void initKernel(PropStat& stat) {
+        switch (stat.kernel_) {
+            case PropStat::Kernel::MIN_INT:
+                stat.accI_ = std::numeric_limits<int64_t>::max();
+                break;
+            case PropStat::Kernel::MAX_INT:
+                stat.accI_ = std::numeric_limits<int64_t>::min();
+                break;
+            case PropStat::Kernel::MIN_FLOAT:
+                stat.accD_ = std::numeric_limits<double>::max();
+                break;
+            case PropStat::Kernel::MAX_FLOAT:
+                stat.accD_ = std::numeric_limits<double>::lowest();
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Fold the raw accumulator into the Value fields and continue on
+    // the generic path. With no rows folded in, the raw sentinels lose
+    // every Value comparison below, so the Value fields are unchanged
+    static void demoteToGeneric(const PropStat& stat) {
+        switch (stat.kernel_) {
+            case PropStat::Kernel::SUM_INT:
+                if (stat.countI_ > 0) {
+                    stat.sum_ = stat.sum_ + stat.accI_;
+                    stat.count_ = stat.count_ + stat.countI_;
+                }
+                break;
+            case PropStat::Kernel::SUM_FLOAT:
+                if (stat.countI_ > 0) {
+                    stat.sum_ = stat.sum_ + stat.accD_;
+                    stat.count_ = stat.count_ + stat.countI_;
+                }
+                break;
+            case PropStat::Kernel::MIN_INT:
+                stat.min_ = Value(stat.accI_) < stat.min_ ? Value(stat.accI_) : stat.min_;
+                break;
+            case PropStat::Kernel::MIN_FLOAT:
+                stat.min_ = Value(stat.accD_) < stat.min_ ? Value(stat.accD_) : stat.min_;
+                break;
+            case PropStat::Kernel::MAX_INT:
+                stat.max_ = Value(stat.accI_) > stat.max_ ? Value(stat.accI_) : stat.max_;
+                break;
+            case PropStat::Kernel::MAX_FLOAT:
+                stat.max_ = Value(stat.accD_) > stat.max_ ? Value(stat.accD_) : stat.max_;
+                break;
+            case PropStat::Kernel::GENERIC:
+                return;
+        }
+        stat.kernel_ = PropStat::Kernel::GENERIC;
+        stat.accI_ = 0;
+        stat.accD_ = 0.0;
+        stat.countI_ = 0;
+    }
+
     void addStatValue(const Value& value, PropStat& stat) {
+        switch (stat.kernel_) {
+            case PropStat::Kernel::SUM_INT:
+                if (LIKELY(value.isInt())) {
+                    stat.accI_ += value.getInt();
+                    stat.countI_++;
+                    return;
+                }
+                break;
+            case PropStat::Kernel::SUM_FLOAT:
+                if (LIKELY(value.isFloat())) {
+                    stat.accD_ += value.getFloat();
+                    stat.countI_++;
+                    return;
+                }
+                break;
+            case PropStat::Kernel::MIN_INT:
+                if (LIKELY(value.isInt())) {
+                    stat.accI_ = std::min(stat.accI_, value.getInt());
+                    return;
+                }
+                break;
+            case PropStat::Kernel::MIN_FLOAT:
+                if (LIKELY(value.isFloat())) {
+                    stat.accD_ = std::min(stat.accD_, value.getFloat());
+                    return;
+                }
+                break;
+            case PropStat::Kernel::MAX_INT:
+                if (LIKELY(value.isInt())) {
+                    stat.accI_ = std::max(stat.accI_, value.getInt());
+                    return;
+                }
+                break;
+            case PropStat::Kernel::MAX_FLOAT:
+                if (LIKELY(value.isFloat())) {
+                    stat.accD_ = std::max(stat.accD_, value.getFloat());
+                    return;
+                }
+                break;
+            case PropStat::Kernel::GENERIC:
+                addStatValueGeneric(value, stat);
+                return;
+        }
+        // a row the kernel cannot fold, e.g. a null of a nullable
+        // field: demote and let the Value path decide what it means
+        demoteToGeneric(stat);
+        addStatValueGeneric(value, stat);
+    }
+
+    void addStatValueGeneric(const Value& value, PropStat& stat) {
         if (stat.statType_ == cpp2::StatType::SUM || stat.statType_ == cpp2::StatType::AVG) {
             stat.sum_ = stat.sum_ + value;
             stat.count_ = stat.count_ + 1;
@@ -8,6 +8,7 @@
 #define STORAGE_EXEC_EDGENODE_H_
 
 #include "common/base/Base.h"
+#include "storage/StorageFlags.h"
 #include "storage/exec/RelNode.h"
 #include "storage/exec/StorageIterator.h"
 
@@ -110,7 +111,18 @@ public:
                   const std::vector<PropContext>* props,
                   ExpressionContext* expCtx = nullptr,
                   Expression* exp = nullptr)
-        : EdgeNode(planCtx, ctx, edgeType, props, expCtx, exp) {}
+        : EdgeNode(planCtx, ctx, edgeType, props, expCtx, exp) {
+        name_ = "FetchEdgeNode";
+    }
+
+    // Serve the next execute() from a row the caller already holds in
+    // memory instead of the engine, one-shot. Used by chained same-key
+    // updates, which hand the row they wrote to the next queued update
+    void injectRow(std::string key, std::string row) {
+        injectedKey_ = std::move(key);
+        injectedRow_ = std::move(row);
+        hasInjectedRow_ = true;
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const cpp2::EdgeKey& edgeKey) override {
         auto ret = RelNode::execute(partId, edgeKey);
@@ -130,8 +142,28 @@ public:
                                              edgeKey.edge_type,
                                              edgeKey.ranking,
                                              edgeKey.dst);
+        if (hasInjectedRow_) {
+            hasInjectedRow_ = false;
+            // The injected row still runs through SingleEdgeIterator, so
+            // TTL and schema checks apply to it like to an engine read
+            if (NebulaKeyUtils::keyWithNoVersion(injectedKey_) == prefix_) {
+                iter_.reset(new SingleEdgeIterator(
+                    planContext_,
+                    std::make_unique<kvstore::SingleRecordIterator>(std::move(injectedKey_),
+                                                                    std::move(injectedRow_)),
+                    edgeType_, schemas_, &ttl_, false));
+                return kvstore::ResultCode::SUCCEEDED;
+            }
+            // Not the edge this execution reads; fall through to the
+            // engine rather than trust a mismatched row
+            injectedKey_.clear();
+            injectedRow_.clear();
+        }
         std::unique_ptr<kvstore::KVIterator> iter;
-        ret = planContext_->env_->kvstore_->prefix(planContext_->spaceId_, partId, prefix_, &iter);
+        planContext_->engineCalls_++;
+        ret = planContext_->env_->kvstore_->prefix(planContext_->spaceId_, partId, prefix_, &iter,
+                                                   false, kvstore::ScanHint::DEFAULT,
+                                                   planContext_->snapshot_);
         if (ret == kvstore::ResultCode::SUCCEEDED && iter && iter->valid()) {
             iter_.reset(new SingleEdgeIterator(
                 planContext_, std::move(iter), edgeType_, schemas_, &ttl_, false));
@@ -140,6 +172,11 @@ public:
         }
         return kvstore::ResultCode::SUCCEEDED;
     }
+
+private:
+    std::string injectedKey_;
+    std::string injectedRow_;
+    bool hasInjectedRow_{false};
 };
 
 // SingleEdgeNode is used to scan all edges of a specified edgeType of the same srcId
@@ -150,8 +187,39 @@ public:
                    EdgeType edgeType,
                    const std::vector<PropContext>* props,
                    ExpressionContext* expCtx = nullptr,
-                   Expression* exp = nullptr)
-        : EdgeNode(planCtx, ctx, edgeType, props, expCtx, exp) {}
+                   Expression* exp = nullptr,
+                   int64_t limit = 0,
+                   bool sample = false)
+        : EdgeNode(planCtx, ctx, edgeType, props, expCtx, exp)
+        , limit_(limit)
+        , sample_(sample) {
+        name_ = "SingleEdgeNode";
+        // The scan may run on keys alone when nothing reads the edge
+        // value: no filter, no TTL on the edge type, no sampling, no
+        // returned prop living in the value, and every stat a COUNT.
+        // Typical for degree-only requests
+        countOnly_ = exp == nullptr && !sample_ && !ttl_.hasValue();
+        if (countOnly_) {
+            for (const auto& prop : *props_) {
+                if ((prop.returned_ || prop.filtered_) &&
+                        prop.propInKeyType_ == PropContext::PropInKeyType::NONE) {
+                    countOnly_ = false;
+                    break;
+                }
+                if (prop.hasStat_) {
+                    for (const auto& statType : prop.statType_) {
+                        if (statType != cpp2::StatType::COUNT) {
+                            countOnly_ = false;
+                            break;
+                        }
+                    }
+                    if (!countOnly_) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
         auto ret = RelNode::execute(partId, vId);
@@ -161,17 +229,62 @@ public:
 
         VLOG(1) << "partId " << partId << ", vId " << vId << ", edgeType " << edgeType_
                 << ", prop size " << props_->size();
+        auto limit = limit_;
+        int64_t degree = 0;
+        if (sample_) {
+            // The scan may only stop early when the positions to keep
+            // are known up front, which needs the approximate degree.
+            // Otherwise the downstream reservoir sees the whole range
+            limit = 0;
+            if (limit_ > 0 && FLAGS_reservoir_sampling_degree_threshold > 0 &&
+                    edgeContext_->degreeCache_ != nullptr) {
+                auto cacheKey = std::make_pair(vId, edgeType_);
+                auto result = edgeContext_->degreeCache_->get(cacheKey, partId);
+                int64_t approx = result.ok() ? result.value() : -1;
+                if (approx < 0 && FLAGS_enable_edge_degree_counter) {
+                    // Cache miss: seed it from the persistent counter
+                    // the edge write path maintains, one point lookup
+                    // instead of waiting for a full scan to count
+                    std::string val;
+                    auto code = planContext_->env_->kvstore_->get(
+                            planContext_->spaceId_, partId,
+                            NebulaKeyUtils::systemDegreeKey(partId, vId, edgeType_), &val);
+                    if (code == kvstore::ResultCode::SUCCEEDED &&
+                            val.size() == sizeof(int64_t)) {
+                        ::memcpy(&approx, val.data(), sizeof(approx));
+                        approx = std::max<int64_t>(approx, 0);
+                        edgeContext_->degreeCache_->insert(cacheKey, approx, partId);
+                    }
+                }
+                if (approx > limit_ && approx >= FLAGS_reservoir_sampling_degree_threshold) {
+                    degree = approx;
+                    limit = limit_;
+                }
+            }
+        }
         std::unique_ptr<kvstore::KVIterator> iter;
-        prefix_ = NebulaKeyUtils::edgePrefix(planContext_->vIdLen_, partId, vId, edgeType_);
-        ret = planContext_->env_->kvstore_->prefix(planContext_->spaceId_, partId, prefix_, &iter);
+        NebulaKeyUtils::edgePrefixTo(prefix_, planContext_->vIdLen_, partId, vId, edgeType_);
+        planContext_->engineCalls_++;
+        ret = planContext_->env_->kvstore_->prefix(planContext_->spaceId_, partId, prefix_, &iter,
+                                                   false, kvstore::ScanHint::DEFAULT,
+                                                   planContext_->snapshot_);
         if (ret == kvstore::ResultCode::SUCCEEDED && iter && iter->valid()) {
             iter_.reset(new SingleEdgeIterator(
-                planContext_, std::move(iter), edgeType_, schemas_, &ttl_));
+                planContext_, std::move(iter), edgeType_, schemas_, &ttl_, true, limit, degree,
+                countOnly_));
         } else {
             iter_.reset();
         }
         return kvstore::ResultCode::SUCCEEDED;
     }
+
+private:
+    // Pushed-down limit on valid edges per vertex, 0 means unlimited
+    int64_t limit_ = 0;
+    // True when the request samples edges instead of returning them all
+    bool sample_ = false;
+    // True when the scan only counts valid keys and never decodes values
+    bool countOnly_ = false;
 };
 
 }  // namespace storage
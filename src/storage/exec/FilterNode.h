@@ -35,7 +35,9 @@ public:
         : IterateNode<T>(upstream)
         , planContext_(planCtx)
         , expCtx_(expCtx)
-        , filterExp_(exp) {}
+        , filterExp_(exp) {
+        this->name_ = "FilterNode";
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const T& vId) override {
         auto ret = RelNode<T>::execute(partId, vId);
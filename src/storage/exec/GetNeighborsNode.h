@@ -9,6 +9,8 @@
 
 #include "common/base/Base.h"
 #include "common/algorithm/ReservoirSampling.h"
+#include "storage/StorageFlags.h"
+#include "storage/MemoryQuota.h"
 #include "storage/exec/AggregateNode.h"
 #include "storage/exec/HashJoinNode.h"
 
@@ -33,9 +35,17 @@ public:
         , aggregateNode_(aggregateNode)
         , edgeContext_(edgeContext)
         , resultDataSet_(resultDataSet)
-        , limit_(limit) {}
+        , limit_(limit) {
+        name_ = "GetNeighborsNode";
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
+        // checked before the dependencies run, so an expired request
+        // fails its remaining vertices without scanning them
+        if (planContext_->isDeadlineExceeded()) {
+            return kvstore::ResultCode::ERR_PARTIAL_RESULT;
+        }
+
         auto ret = RelNode::execute(partId, vId);
         if (ret != kvstore::ResultCode::SUCCEEDED) {
             return ret;
@@ -46,6 +56,7 @@ public:
         }
 
         std::vector<Value> row;
+        row.reserve(resultDataSet_->colNames.size());
         // vertexId is the first column
         row.emplace_back(vId);
         // second column is reserved for stat
@@ -60,10 +71,14 @@ public:
         row.resize(row.size() + edgeContext_->propContexts_.size() + 1,
                    NullType::__NULL__);
 
-        ret = iterateEdges(row);
+        ret = iterateEdges(partId, row);
         if (ret != kvstore::ResultCode::SUCCEEDED) {
             return ret;
         }
+        if (planContext_->resultStat_ == ResultStatus::DEADLINE_EXCEEDED) {
+            // the edge scan was cut short, drop the truncated row
+            return kvstore::ResultCode::ERR_PARTIAL_RESULT;
+        }
 
         aggregateNode_->calculateStat();
         if (aggregateNode_->result().type() == Value::Type::LIST) {
@@ -71,6 +86,10 @@ public:
             row[1].setList(aggregateNode_->mutableResult().moveList());
         }
 
+        if (planContext_->memQuota_ != nullptr &&
+                !planContext_->memQuota_->charge(MemoryQuota::estimate(row))) {
+            return kvstore::ResultCode::ERR_OUT_OF_MEMORY;
+        }
         resultDataSet_->rows.emplace_back(std::move(row));
         return kvstore::ResultCode::SUCCEEDED;
     }
@@ -78,7 +97,8 @@ public:
 protected:
     GetNeighborsNode() = default;
 
-    virtual kvstore::ResultCode iterateEdges(std::vector<Value>& row) {
+    virtual kvstore::ResultCode iterateEdges(PartitionID partId, std::vector<Value>& row) {
+        UNUSED(partId);
         int64_t edgeRowCount = 0;
         nebula::List list;
         for (; aggregateNode_->valid(); aggregateNode_->next(), ++edgeRowCount) {
@@ -108,6 +128,15 @@ protected:
             }
             auto& cell = row[columnIdx].mutableList();
             cell.values.emplace_back(std::move(list));
+
+            if (planContext_->prefetchVids_ != nullptr &&
+                    planContext_->prefetchVids_->size() <
+                        static_cast<size_t>(FLAGS_neighbor_prefetch_limit)) {
+                // remember the neighbor for the post-response warming
+                auto dstId = NebulaKeyUtils::getDstId(planContext_->vIdLen_, key);
+                planContext_->prefetchVids_->emplace_back(
+                    dstId.subpiece(0, dstId.find_first_of('\0')).toString());
+            }
         }
         return kvstore::ResultCode::SUCCEEDED;
     }
@@ -129,7 +158,9 @@ public:
                            nebula::DataSet* resultDataSet,
                            int64_t limit)
         : GetNeighborsNode(planCtx, hashJoinNode, aggregateNode, edgeContext, resultDataSet, limit)
-        , sampler_(std::make_unique<nebula::algorithm::ReservoirSampling<Sample>>(limit_)) {}
+        , sampler_(std::make_unique<nebula::algorithm::ReservoirSampling<Sample>>(limit_)) {
+        name_ = "GetNeighborsSampleNode";
+    }
 
 private:
     using Sample = std::tuple<EdgeType,
@@ -138,17 +169,33 @@ private:
                               const std::vector<PropContext>*,
                               size_t>;
 
-    kvstore::ResultCode iterateEdges(std::vector<Value>& row) override {
+    kvstore::ResultCode iterateEdges(PartitionID partId, std::vector<Value>& row) override {
         int64_t edgeRowCount = 0;
         nebula::List list;
+        std::unordered_map<EdgeType, int64_t> degrees;
         for (; aggregateNode_->valid(); aggregateNode_->next(), ++edgeRowCount) {
             auto val = aggregateNode_->val();
             auto key = aggregateNode_->key();
             auto edgeType = planContext_->edgeType_;
             auto props = planContext_->props_;
             auto columnIdx = planContext_->columnIdx_;
+            degrees[edgeType]++;
             sampler_->sampling(std::make_tuple(edgeType, val.str(), key.str(), props, columnIdx));
         }
+        // Remember the degree of every fully scanned edge type which
+        // turned out to exceed the threshold, so the next sampled read
+        // of this vertex can skip over the range instead. Pre-sampled
+        // ranges stream at most limit records and never reach it
+        if (FLAGS_reservoir_sampling_degree_threshold > 0 &&
+                edgeContext_->degreeCache_ != nullptr) {
+            for (const auto& degree : degrees) {
+                if (degree.second >= FLAGS_reservoir_sampling_degree_threshold) {
+                    edgeContext_->degreeCache_->insert(
+                            std::make_pair(row[0].getStr(), degree.first),
+                            degree.second, partId);
+                }
+            }
+        }
 
         std::unique_ptr<RowReader> reader;
         auto samples = std::move(*sampler_).samples();
@@ -165,14 +212,16 @@ private:
                 reader = RowReader::getEdgePropReader(planContext_->env_->schemaMan_,
                                                       planContext_->spaceId_,
                                                       std::abs(edgeType),
-                                                      val);
+                                                      val,
+                                                      &schemaCache_);
                 if (!reader) {
                     continue;
                 }
             } else if (!reader->resetEdgePropReader(planContext_->env_->schemaMan_,
                                                     planContext_->spaceId_,
                                                     std::abs(edgeType),
-                                                    val)) {
+                                                    val,
+                                                    &schemaCache_)) {
                 continue;
             }
 
@@ -193,6 +242,10 @@ private:
     }
 
     std::unique_ptr<nebula::algorithm::ReservoirSampling<Sample>> sampler_;
+    // The schemas the sample decoding has resolved, kept across the
+    // rows of the request so mixed-version samples do not ask the
+    // schema manager per sample
+    SchemaVerCache schemaCache_;
 };
 
 }  // namespace storage
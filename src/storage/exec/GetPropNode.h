@@ -8,6 +8,7 @@
 #define STORAGE_EXEC_GETPROPNODE_H_
 
 #include "common/base/Base.h"
+#include "storage/MemoryQuota.h"
 #include "storage/exec/TagNode.h"
 #include "storage/exec/EdgeNode.h"
 
@@ -17,9 +18,13 @@ namespace storage {
 class GetTagPropNode : public QueryNode<VertexID> {
 public:
     explicit GetTagPropNode(std::vector<TagNode*> tagNodes,
-                            nebula::DataSet* resultDataSet)
+                            nebula::DataSet* resultDataSet,
+                            MemoryQuota* memQuota = nullptr)
         : tagNodes_(std::move(tagNodes))
-        , resultDataSet_(resultDataSet) {}
+        , resultDataSet_(resultDataSet)
+        , memQuota_(memQuota) {
+        name_ = "GetTagPropNode";
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
         auto ret = RelNode::execute(partId, vId);
@@ -28,6 +33,7 @@ public:
         }
 
         std::vector<Value> row;
+        row.reserve(resultDataSet_->colNames.size());
         // vertexId is the first column
         row.emplace_back(vId);
         for (auto* tagNode : tagNodes_) {
@@ -63,6 +69,9 @@ public:
                 return ret;
             }
         }
+        if (memQuota_ != nullptr && !memQuota_->charge(MemoryQuota::estimate(row))) {
+            return kvstore::ResultCode::ERR_OUT_OF_MEMORY;
+        }
         resultDataSet_->rows.emplace_back(std::move(row));
         return kvstore::ResultCode::SUCCEEDED;
     }
@@ -70,16 +79,21 @@ public:
 private:
     std::vector<TagNode*> tagNodes_;
     nebula::DataSet* resultDataSet_;
+    MemoryQuota* memQuota_;
 };
 
 class GetEdgePropNode : public QueryNode<cpp2::EdgeKey> {
 public:
     GetEdgePropNode(std::vector<EdgeNode<cpp2::EdgeKey>*> edgeNodes,
                     size_t vIdLen,
-                    nebula::DataSet* resultDataSet)
+                    nebula::DataSet* resultDataSet,
+                    MemoryQuota* memQuota = nullptr)
         : edgeNodes_(std::move(edgeNodes))
         , vIdLen_(vIdLen)
-        , resultDataSet_(resultDataSet) {}
+        , resultDataSet_(resultDataSet)
+        , memQuota_(memQuota) {
+        name_ = "GetEdgePropNode";
+    }
 
     kvstore::ResultCode execute(PartitionID partId, const cpp2::EdgeKey& edgeKey) override {
         auto ret = RelNode::execute(partId, edgeKey);
@@ -88,6 +102,7 @@ public:
         }
 
         std::vector<Value> row;
+        row.reserve(resultDataSet_->colNames.size());
         for (auto* edgeNode : edgeNodes_) {
             ret = edgeNode->collectEdgePropsIfValid(
                 [&row] (const std::vector<PropContext>* props) -> kvstore::ResultCode {
@@ -122,6 +137,9 @@ public:
                 return ret;
             }
         }
+        if (memQuota_ != nullptr && !memQuota_->charge(MemoryQuota::estimate(row))) {
+            return kvstore::ResultCode::ERR_OUT_OF_MEMORY;
+        }
         resultDataSet_->rows.emplace_back(std::move(row));
         return kvstore::ResultCode::SUCCEEDED;
     }
@@ -130,6 +148,7 @@ private:
     std::vector<EdgeNode<cpp2::EdgeKey>*> edgeNodes_;
     size_t vIdLen_;
     nebula::DataSet* resultDataSet_;
+    MemoryQuota* memQuota_;
 };
 
 }  // namespace storage
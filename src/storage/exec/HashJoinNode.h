@@ -36,6 +36,7 @@ public:
         , edgeContext_(edgeContext)
         , expCtx_(expCtx) {
         UNUSED(tagContext_);
+        name_ = "HashJoinNode";
     }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
@@ -49,6 +50,7 @@ public:
         }
         result_.setList(nebula::List());
         auto& result = result_.mutableList();
+        result.values.reserve(tagNodes_.size());
         if (planContext_->resultStat_ == ResultStatus::ILLEGAL_DATA) {
             return kvstore::ResultCode::ERR_INVALID_DATA;
         }
@@ -19,7 +19,23 @@ public:
     static StatusOr<nebula::Value> readValue(RowReader* reader,
                                              const std::string& propName,
                                              const meta::SchemaProviderIf::Field* field) {
-        auto value = reader->getValueByName(propName);
+        return checkPropValue(reader->getValueByName(propName), propName, field);
+    }
+
+    // Read a prop through its PropContext. When the row is encoded at
+    // the schema version the context was resolved against, the field is
+    // read by its precomputed index, skipping the per-row name lookup
+    static StatusOr<nebula::Value> readValue(RowReader* reader, const PropContext& prop) {
+        if (prop.fieldIndex_ >= 0 && reader->schemaVer() == prop.schemaVer_) {
+            return checkPropValue(reader->getValueByIndex(prop.fieldIndex_),
+                                  prop.name_, prop.field_);
+        }
+        return readValue(reader, prop.name_, prop.field_);
+    }
+
+    static StatusOr<nebula::Value> checkPropValue(Value value,
+                                                  const std::string& propName,
+                                                  const meta::SchemaProviderIf::Field* field) {
         if (value.type() == Value::Type::NULLVALUE) {
             // read null value
             auto nullType = value.getNull();
@@ -66,7 +82,7 @@ public:
         switch (prop.propInKeyType_) {
             // prop in value
             case PropContext::PropInKeyType::NONE: {
-                return readValue(reader, prop.name_, prop.field_);
+                return readValue(reader, prop);
             }
             case PropContext::PropInKeyType::SRC: {
                 return srcId.subpiece(0, srcId.find_first_of('\0'));
@@ -40,7 +40,15 @@ class RelNode {
 public:
     virtual kvstore::ResultCode execute(PartitionID partId, const T& input) {
         for (auto* dependency : dependencies_) {
-            auto ret = dependency->execute(partId, input);
+            kvstore::ResultCode ret;
+            if (UNLIKELY(profile_)) {
+                auto start = time::WallClock::fastNowInMicroSec();
+                ret = dependency->execute(partId, input);
+                dependency->execTimeUs_ += time::WallClock::fastNowInMicroSec() - start;
+                dependency->execCalls_++;
+            } else {
+                ret = dependency->execute(partId, input);
+            }
             if (ret != kvstore::ResultCode::SUCCEEDED) {
                 return ret;
             }
@@ -48,6 +56,23 @@ public:
         return kvstore::ResultCode::SUCCEEDED;
     }
 
+    // Run the node tree once per input. The default loops the
+    // single-input execute(), carrying on after a failed input and
+    // returning the first failure; a node whose per-input work can be
+    // amortized may override it and process the whole batch in one
+    // pass before handing it on
+    virtual kvstore::ResultCode executeBatch(PartitionID partId, const std::vector<T>& inputs) {
+        auto result = kvstore::ResultCode::SUCCEEDED;
+        for (const auto& input : inputs) {
+            auto ret = execute(partId, input);
+            if (ret != kvstore::ResultCode::SUCCEEDED
+                    && result == kvstore::ResultCode::SUCCEEDED) {
+                result = ret;
+            }
+        }
+        return result;
+    }
+
     void addDependency(RelNode<T>* dep) {
         dependencies_.emplace_back(dep);
         dep->hasDependents_ = true;
@@ -62,6 +87,13 @@ public:
     std::string name_;
     std::vector<RelNode<T>*> dependencies_;
     bool hasDependents_ = false;
+
+    // Set when this plan run is sampled for profiling: every dependency
+    // call is timed into the callee's counters. The recorded spans are
+    // inclusive of the callee's own dependencies
+    bool profile_ = false;
+    int64_t execTimeUs_ = 0;
+    int64_t execCalls_ = 0;
 };
 
 // QueryNode is the node which would read data from kvstore, it usually generate a row in response
@@ -86,11 +118,12 @@ protected:
             size_t vIdLen,
             const std::vector<PropContext>* props,
             nebula::List& list) {
+        auto srcId = NebulaKeyUtils::getSrcId(vIdLen, key);
+        auto edgeRank = NebulaKeyUtils::getRank(vIdLen, key);
+        auto dstId = NebulaKeyUtils::getDstId(vIdLen, key);
+        list.values.reserve(props->size());
         for (const auto& prop : *props) {
             if (prop.returned_) {
-                auto srcId = NebulaKeyUtils::getSrcId(vIdLen, key);
-                auto edgeRank = NebulaKeyUtils::getRank(vIdLen, key);
-                auto dstId = NebulaKeyUtils::getDstId(vIdLen, key);
                 VLOG(2) << "Collect prop " << prop.name_ << ", type " << edgeType;
                 auto value = QueryUtils::readEdgeProp(srcId, edgeType, edgeRank, dstId,
                                                       reader, prop);
@@ -113,9 +146,10 @@ protected:
             const std::vector<PropContext>* props,
             nebula::List& list,
             StorageExpressionContext* ctx = nullptr) {
+        list.values.reserve(props->size());
         for (auto& prop : *props) {
             VLOG(2) << "Collect prop " << prop.name_ << ", type " << tagId;
-            auto status = QueryUtils::readValue(reader, prop.name_, prop.field_);
+            auto status = QueryUtils::readValue(reader, prop);
             if (!status.ok()) {
                 return kvstore::ResultCode::ERR_TAG_PROP_NOT_FOUND;
             }
@@ -8,6 +8,7 @@
 #define STORAGE_EXEC_STORAGEITERATOR_H_
 
 #include "common/base/Base.h"
+#include "codec/RowReaderWrapper.h"
 #include "kvstore/KVIterator.h"
 #include "storage/CommonUtils.h"
 
@@ -58,7 +59,7 @@ public:
     }
 
     bool valid() const override {
-        return lookupOne_ && reader_ != nullptr;
+        return lookupOne_ && reader_.currReader() != nullptr;
     }
 
     void next() override {
@@ -74,23 +75,26 @@ public:
     }
 
     RowReader* reader() const override {
-        return reader_.get();
+        return reader_.currReader();
     }
 
 protected:
     // return true when the value iter to a valid tag value
     bool check(folly::StringPiece val) {
-        reader_ = RowReader::getRowReader(*schemas_, val);
-        if (!reader_) {
+        planContext_->keysScanned_++;
+        planContext_->bytesRead_ += val.size();
+        if (!reader_.reset(*schemas_, val)) {
+            reader_.clear();
             planContext_->resultStat_ = ResultStatus::ILLEGAL_DATA;
             return false;
         }
 
         if (ttl_->hasValue()) {
             auto ttlValue = ttl_->value();
-            if (CommonUtils::checkDataExpiredForTTL(schemas_->back().get(), reader_.get(),
+            if (CommonUtils::checkDataExpiredForTTL(schemas_->back().get(),
+                                                    reader_.currReader(),
                                                     ttlValue.first, ttlValue.second)) {
-                reader_.reset();
+                reader_.clear();
                 return false;
             }
         }
@@ -105,7 +109,9 @@ protected:
     const folly::Optional<std::pair<std::string, int64_t>>               *ttl_ = nullptr;
     bool                                                                  lookupOne_ = true;
 
-    std::unique_ptr<RowReader>                                            reader_;
+    // Reset in place per row; reads go through currReader() so they hit
+    // the concrete reader without the wrapper's forwarding hop
+    RowReaderWrapper                                                      reader_;
 };
 
 // Iterator of single specified type
@@ -117,29 +123,57 @@ public:
             EdgeType edgeType,
             const std::vector<std::shared_ptr<const meta::NebulaSchemaProvider>>* schemas,
             const folly::Optional<std::pair<std::string, int64_t>>* ttl,
-            bool moveToValidRecord = true)
+            bool moveToValidRecord = true,
+            int64_t limit = 0,
+            int64_t sampleDegree = 0,
+            bool countOnly = false)
         : planContext_(planCtx)
         , iter_(std::move(iter))
         , edgeType_(edgeType)
         , schemas_(schemas)
         , ttl_(ttl)
-        , moveToValidRecord_(moveToValidRecord) {
+        , moveToValidRecord_(moveToValidRecord)
+        , limit_(limit)
+        , countOnly_(countOnly) {
         CHECK(!!iter_);
         lookupOne_ = true;
+        if (limit_ > 0 && sampleDegree > limit_) {
+            // Sample limit positions uniformly over the approximate
+            // record count of the range, instead of streaming every
+            // record through a reservoir. Duplicate draws are dropped,
+            // so the sample may come out slightly smaller than limit
+            samplePositions_.reserve(limit_);
+            for (int64_t i = 0; i < limit_; i++) {
+                samplePositions_.emplace_back(folly::Random::rand64(sampleDegree));
+            }
+            std::sort(samplePositions_.begin(), samplePositions_.end());
+            samplePositions_.erase(
+                std::unique(samplePositions_.begin(), samplePositions_.end()),
+                samplePositions_.end());
+        }
+        iter_->nextBatch(kBatchSize, &batch_);
         // If moveToValidRecord is true, iterator will try to move to first valid record,
         // which is used in GetNeighbors. If it is false, it will only check the latest record,
         // which is used in GetProps and UpdateEdge.
-        if (moveToValidRecord_) {
-            while (iter_->valid() && !check()) {
-                iter_->next();
+        if (!samplePositions_.empty()) {
+            if (batch_.empty() || !seekToRawPos(samplePositions_[0]) || !check()) {
+                moveToNextSample();
             }
-        } else {
+        } else if (moveToValidRecord_) {
+            while (batchIdx_ < batch_.size() && !check()) {
+                if (staleStreak_ >= kStaleSeekThreshold && seekPastStaleVersions()) {
+                    // already standing on the first key past the chain
+                    continue;
+                }
+                nextRecord();
+            }
+        } else if (batchIdx_ < batch_.size()) {
             check();
         }
     }
 
     bool valid() const override {
-        return lookupOne_ && reader_ != nullptr;
+        return lookupOne_ && hasRecord_;
     }
 
     void next() override {
@@ -147,25 +181,45 @@ public:
             lookupOne_ = false;
             return;
         }
+        if (limit_ > 0 && ++edgeCount_ >= limit_) {
+            // The limit of valid edges has been consumed, stop pulling
+            // from the engine instead of draining the whole prefix. As
+            // edge keys sort by rank, these are the top-N by rank
+            reader_.clear();
+            hasRecord_ = false;
+            return;
+        }
+        if (!samplePositions_.empty()) {
+            moveToNextSample();
+            return;
+        }
         do {
-            iter_->next();
-            if (!iter_->valid()) {
-                reader_.reset();
+            if (staleStreak_ >= kStaleSeekThreshold && seekPastStaleVersions()) {
+                if (batch_.empty()) {
+                    reader_.clear();
+                    hasRecord_ = false;
+                    break;
+                }
+                // already standing on the first key past the version
+                // chain, go straight to checking it
+            } else if (!nextRecord()) {
+                reader_.clear();
+                hasRecord_ = false;
                 break;
             }
         } while (!check());
     }
 
     folly::StringPiece key() const override {
-        return iter_->key();
+        return batch_.key(batchIdx_);
     }
 
     folly::StringPiece val() const override {
-        return iter_->val();
+        return batch_.val(batchIdx_);
     }
 
     RowReader* reader() const override {
-        return reader_.get();
+        return reader_.currReader();
     }
 
     EdgeType edgeType() const {
@@ -173,25 +227,117 @@ public:
     }
 
 protected:
+    // Step to the next record, refilling the batch from the engine
+    // iterator when the current one is exhausted. Returns false once
+    // both the batch and the iterator are drained
+    bool nextRecord() {
+        if (++batchIdx_ >= batch_.size()) {
+            if (planContext_->isDeadlineExceeded()) {
+                // Stop the scan at the batch boundary instead of
+                // draining a supernode for a client that gave up
+                planContext_->resultStat_ = ResultStatus::DEADLINE_EXCEEDED;
+                return false;
+            }
+            iter_->nextBatch(kBatchSize, &batch_);
+            batchIdx_ = 0;
+        }
+        return batchIdx_ < batch_.size();
+    }
+
+    // Move the current record to the given raw position of the range,
+    // skipping the records in between without copying or decoding them.
+    // Returns false when the range ends before the position, which
+    // happens when the approximate degree overestimates the real count
+    bool seekToRawPos(int64_t target) {
+        if (batchIdx_ >= batch_.size()) {
+            return false;
+        }
+        auto left = static_cast<int64_t>(batch_.size() - batchIdx_) - 1;
+        auto dist = target - rawPos_;
+        DCHECK_GE(dist, 0);
+        if (dist <= left) {
+            batchIdx_ += dist;
+        } else {
+            // the records between the batch end and the target are
+            // skipped inside the engine iterator
+            auto toSkip = static_cast<size_t>(dist - left - 1);
+            if (iter_->skip(toSkip) < toSkip) {
+                return false;
+            }
+            iter_->nextBatch(kBatchSize, &batch_);
+            batchIdx_ = 0;
+            if (batch_.empty()) {
+                return false;
+            }
+        }
+        rawPos_ = target;
+        return true;
+    }
+
+    // Jump the engine iterator to the first key after every version of
+    // the edge currently looked at, instead of stepping through a long
+    // version chain one record at a time. Only attempted after
+    // kStaleSeekThreshold consecutive stale versions, so short chains
+    // keep the cheaper Next path. Returns false when the engine cannot
+    // seek; the position is unchanged then
+    bool seekPastStaleVersions() {
+        staleStreak_ = 0;
+        auto noVersion = NebulaKeyUtils::keyWithNoVersion(batch_.key(batchIdx_)).str();
+        if (!iter_->seek(NebulaKeyUtils::prefixNext(noVersion))) {
+            return false;
+        }
+        iter_->nextBatch(kBatchSize, &batch_);
+        batchIdx_ = 0;
+        return true;
+    }
+
+    // Step to the next sampled position; positions holding an old
+    // version or an expired edge are dropped rather than replaced
+    void moveToNextSample() {
+        while (++sampleIdx_ < samplePositions_.size()) {
+            if (!seekToRawPos(samplePositions_[sampleIdx_])) {
+                break;
+            }
+            if (check()) {
+                return;
+            }
+        }
+        reader_.clear();
+        hasRecord_ = false;
+    }
+
     // return true when the value iter to a valid edge value
     bool check() {
-        reader_.reset();
-        auto key = iter_->key();
+        reader_.clear();
+        hasRecord_ = false;
+        auto key = batch_.key(batchIdx_);
+        planContext_->keysScanned_++;
+        planContext_->bytesRead_ += key.size();
         auto rank = NebulaKeyUtils::getRank(planContext_->vIdLen_, key);
         auto dstId = NebulaKeyUtils::getDstId(planContext_->vIdLen_, key);
         if (!firstLoop_ && rank == lastRank_ && lastDstId_ == dstId) {
             // pass old version data of same edge
+            ++staleStreak_;
+            planContext_->staleVersionsSkipped_++;
             return false;
         }
+        staleStreak_ = 0;
+
+        if (countOnly_) {
+            // nothing downstream reads the value, so the record counts
+            // as valid from its key alone, without touching the codec.
+            // Only selected when the edge type carries no TTL
+            firstLoop_ = false;
+            lastRank_ = rank;
+            lastDstId_ = dstId.str();
+            hasRecord_ = true;
+            return true;
+        }
 
-        auto val = iter_->val();
-        if (!reader_) {
-            reader_ = RowReader::getRowReader(*schemas_, val);
-            if (!reader_) {
-                planContext_->resultStat_ = ResultStatus::ILLEGAL_DATA;
-                return false;
-            }
-        } else if (!reader_->reset(*schemas_, val)) {
+        auto val = batch_.val(batchIdx_);
+        planContext_->bytesRead_ += val.size();
+        if (!reader_.reset(*schemas_, val)) {
+            reader_.clear();
             planContext_->resultStat_ = ResultStatus::ILLEGAL_DATA;
             return false;
         }
@@ -202,13 +348,15 @@ protected:
 
         if (ttl_->hasValue()) {
             auto ttlValue = ttl_->value();
-            if (CommonUtils::checkDataExpiredForTTL(schemas_->back().get(), reader_.get(),
+            if (CommonUtils::checkDataExpiredForTTL(schemas_->back().get(),
+                                                    reader_.currReader(),
                                                     ttlValue.first, ttlValue.second)) {
-                reader_.reset();
+                reader_.clear();
                 return false;
             }
         }
 
+        hasRecord_ = true;
         return true;
     }
 
@@ -219,11 +367,42 @@ protected:
     const folly::Optional<std::pair<std::string, int64_t>>               *ttl_ = nullptr;
     bool                                                                  moveToValidRecord_{true};
     bool                                                                  lookupOne_ = true;
-
-    std::unique_ptr<RowReader>                                            reader_;
+    // Stop the scan once this many valid edges were returned, 0 means
+    // unlimited. Only set when every scanned edge ends up in the
+    // response, so the early stop cannot change the result
+    int64_t                                                               limit_ = 0;
+    int64_t                                                               edgeCount_ = 0;
+    // Count valid records from keys alone, leaving the value undecoded
+    // and reader() null; only set when nothing downstream needs a value
+    bool                                                                  countOnly_ = false;
+    // Whether the iterator points at a valid record. In the normal mode
+    // this tracks reader_, in count-only mode there is no reader
+    bool                                                                  hasRecord_ = false;
+
+    // Reset in place per record instead of re-created; reads go through
+    // currReader() so the loop dispatches straight into the concrete
+    // reader of the scanned version
+    RowReaderWrapper                                                      reader_;
     EdgeRanking                                                           lastRank_ = 0;
     VertexID                                                              lastDstId_ = "";
     bool                                                                  firstLoop_ = true;
+    // Consecutive stale versions of one edge seen by check(); once it
+    // reaches the threshold the scan seeks past the chain in the engine
+    static constexpr size_t kStaleSeekThreshold = 16;
+    size_t                                                                staleStreak_ = 0;
+
+    // Edges are consumed through cache-resident batches pulled from the
+    // engine iterator in one call each, instead of a virtual
+    // valid/key/val/next round-trip per edge
+    static constexpr size_t kBatchSize = 64;
+    kvstore::KVBatch                                                      batch_;
+    size_t                                                                batchIdx_ = 0;
+
+    // Sorted raw positions to visit when the range is sampled instead
+    // of scanned; empty in the normal full-scan mode
+    std::vector<int64_t>                                                  samplePositions_;
+    size_t                                                                sampleIdx_ = 0;
+    int64_t                                                               rawPos_ = 0;
 };
 
 // Iterator of multiple SingleEdgeIterator, it will iterate over edges of different types
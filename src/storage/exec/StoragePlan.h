@@ -8,8 +8,10 @@
 #define STORAGE_EXEC_STORAGEPLAN_H_
 
 #include "common/base/Base.h"
+#include "common/stats/Stats.h"
 #include "storage/exec/RelNode.h"
 #include "storage/CommonUtils.h"
+#include "storage/StorageFlags.h"
 
 namespace nebula {
 namespace storage {
@@ -35,9 +37,77 @@ template<typename T>
 class StoragePlan {
 public:
     kvstore::ResultCode go(PartitionID partId, const T& input) {
-        // find all leaf nodes, and a dummy output node depends on all leaf node.
+        resolve();
+        auto ret = nodes_[outputIdx_]->execute(partId, input);
+        if (UNLIKELY(profiling_)) {
+            recordProfile();
+        }
+        return ret;
+    }
+
+    // Run the plan once per input, resolving the topology only once
+    // for the whole batch. Unlike the single-input go(), a failed
+    // input does not stop the batch; the first failure is returned
+    // once every input has run
+    kvstore::ResultCode go(PartitionID partId, const std::vector<T>& inputs) {
+        resolve();
+        auto ret = nodes_[outputIdx_]->executeBatch(partId, inputs);
+        if (UNLIKELY(profiling_)) {
+            recordProfile();
+        }
+        return ret;
+    }
+
+    // Sample this plan for profiling when --profile_plan_every_n says
+    // so: its nodes get timed and their inclusive execution time lands
+    // in the storage.plan_<node> stats after each go()
+    void maybeProfile() {
+        if (FLAGS_profile_plan_every_n <= 0) {
+            return;
+        }
+        // Each thread samples every Nth of its own plans; across the
+        // worker pool that is the same one-in-N rate, without a shared
+        // counter line every plan has to bump
+        static thread_local uint64_t planCount = 0;
+        if (planCount++ % FLAGS_profile_plan_every_n != 0) {
+            return;
+        }
+        profiling_ = true;
+        for (auto& node : nodes_) {
+            node->profile_ = true;
+        }
+    }
+
+    int32_t addNode(std::unique_ptr<RelNode<T>> node) {
+        nodes_.emplace_back(std::move(node));
+        return nodes_.size() - 1;
+    }
+
+    // Size the node storage up front when the builder knows how many
+    // nodes the plan will hold, so addNode does not regrow it
+    void reserve(size_t numNodes) {
+        // one extra slot for the dummy output node added by resolve()
+        nodes_.reserve(numNodes + 1);
+    }
+
+    RelNode<T>* getNode(size_t idx) {
+        CHECK_LT(idx, nodes_.size());
+        return nodes_[idx].get();
+    }
+
+    // Per-node "name=timeUs/calls" summary of the last profiled go(),
+    // empty when this plan was not sampled. The slow-query log attaches
+    // it when both happen to hit the same request
+    const std::string& profileDesc() const {
+        return profileDesc_;
+    }
+
+private:
+    // find all leaf nodes, and a dummy output node depends on all leaf node.
+    void resolve() {
         if (firstLoop_) {
             auto output = std::make_unique<RelNode<T>>();
+            output->profile_ = profiling_;
             for (const auto& node : nodes_) {
                 if (!node->hasDependents_) {
                     // add dependency of output node
@@ -48,22 +118,43 @@ public:
             firstLoop_ = false;
         }
         CHECK_GE(outputIdx_, 0);
-        CHECK_LT(outputIdx_, nodes_.size());
-        return nodes_[outputIdx_]->execute(partId, input);
+        CHECK_LT(outputIdx_, static_cast<int32_t>(nodes_.size()));
     }
 
-    int32_t addNode(std::unique_ptr<RelNode<T>> node) {
-        nodes_.emplace_back(std::move(node));
-        return nodes_.size() - 1;
+    // One stats entry per named node type, shared by every sampled plan
+    // of the process. The web service exports them like any other stat
+    static stats::Stats* profileStats(const std::string& name) {
+        static std::mutex smut;
+        static std::unordered_map<std::string, std::unique_ptr<stats::Stats>> registry;
+        std::lock_guard<std::mutex> lg(smut);
+        auto& stat = registry[name];
+        if (!stat) {
+            stat = std::make_unique<stats::Stats>("storage", "plan_" + name);
+        }
+        return stat.get();
     }
 
-    RelNode<T>* getNode(size_t idx) {
-        CHECK_LT(idx, nodes_.size());
-        return nodes_[idx].get();
+    void recordProfile() {
+        profileDesc_.clear();
+        for (auto& node : nodes_) {
+            if (node->name_.empty() || node->execCalls_ == 0) {
+                continue;
+            }
+            stats::Stats::addStatsValue(profileStats(node->name_), true, node->execTimeUs_);
+            profileDesc_.append(node->name_)
+                        .append("=")
+                        .append(folly::to<std::string>(node->execTimeUs_))
+                        .append("/")
+                        .append(folly::to<std::string>(node->execCalls_))
+                        .append(" ");
+            node->execTimeUs_ = 0;
+            node->execCalls_ = 0;
+        }
     }
 
-private:
     bool firstLoop_ = true;
+    bool profiling_ = false;
+    std::string profileDesc_;
     int32_t outputIdx_ = -1;
     std::vector<std::unique_ptr<RelNode<T>>> nodes_;
 };
@@ -8,6 +8,7 @@
 #define STORAGE_EXEC_TAGNODE_H_
 
 #include "common/base/Base.h"
+#include "codec/RowDecodePlan.h"
 #include "storage/exec/RelNode.h"
 #include "storage/exec/StorageIterator.h"
 
@@ -30,12 +31,18 @@ public:
         , expCtx_(expCtx)
         , exp_(exp) {
         UNUSED(expCtx_); UNUSED(exp_);
+        name_ = "TagNode";
         auto schemaIter = tagContext_->schemas_.find(tagId_);
         CHECK(schemaIter != tagContext_->schemas_.end());
         CHECK(!schemaIter->second.empty());
         schemas_ = &(schemaIter->second);
         ttl_ = QueryUtils::getTagTTLInfo(tagContext_, tagId_);
         tagName_ = tagContext_->tagNames_[tagId_];
+        if (FLAGS_enable_vertex_cache && tagContext_->vertexCache_ != nullptr) {
+            // one specialized decode routine for the rows this node will
+            // insert into the cache, all written with the newest schema
+            decodePlan_ = std::make_unique<RowDecodePlan>(schemas_->back().get());
+        }
     }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
@@ -45,23 +52,73 @@ public:
         }
         VLOG(1) << "partId " << partId << ", vId " << vId << ", tagId " << tagId_
                 << ", prop size " << props_->size();
+        cachedReader_.reset();
+        cachedRow_.reset();
 
         // when update, has already evicted
         if (FLAGS_enable_vertex_cache && tagContext_->vertexCache_ != nullptr) {
             auto result = tagContext_->vertexCache_->get(std::make_pair(vId, tagId_), partId);
             if (result.ok()) {
-                cacheResult_ = std::move(result).value();
-                iter_.reset(new SingleTagIterator(planContext_, cacheResult_, schemas_, &ttl_));
+                cachedRow_ = std::move(result).value();
+                iter_.reset();
+                auto* schema = schemaOfVersion(cachedRow_->ver);
+                if (schema != nullptr) {
+                    // serve prop reads from the decoded fields
+                    cachedReader_ =
+                        std::make_unique<CachedRowReader>(schema, cachedRow_.get());
+                    if (ttl_.hasValue() &&
+                            CommonUtils::checkDataExpiredForTTL(schemas_->back().get(),
+                                                                cachedReader_.get(),
+                                                                ttl_.value().first,
+                                                                ttl_.value().second)) {
+                        // expired reads the same as a missing tag
+                        cachedReader_.reset();
+                    }
+                } else {
+                    // a row of a schema version we no longer hold,
+                    // decode it as usual
+                    iter_.reset(new SingleTagIterator(planContext_, cachedRow_->row,
+                                                      schemas_, &ttl_));
+                }
                 return kvstore::ResultCode::SUCCEEDED;
             }
         }
 
-        std::unique_ptr<kvstore::KVIterator> iter;
-        prefix_ = NebulaKeyUtils::vertexPrefix(planContext_->vIdLen_, partId, vId, tagId_);
-        ret = planContext_->env_->kvstore_->prefix(planContext_->spaceId_, partId, prefix_, &iter);
-        if (ret == kvstore::ResultCode::SUCCEEDED && iter && iter->valid()) {
-            iter_.reset(new SingleTagIterator(planContext_, std::move(iter), tagId_,
-                                              schemas_, &ttl_));
+        NebulaKeyUtils::vertexPrefixTo(prefix_, planContext_->vIdLen_, partId, vId, tagId_);
+        // the prefix is the full version-stripped key, so the part's
+        // existence filter can rule the row out without an engine read
+        if (!planContext_->env_->kvstore_->maybeExists(planContext_->spaceId_, partId, prefix_)) {
+            iter_.reset();
+            return kvstore::ResultCode::SUCCEEDED;
+        }
+        planContext_->engineCalls_++;
+        // versions are encoded descending, so the first key under the
+        // prefix is the latest one; getLatest reads it without an
+        // iterator object
+        ret = planContext_->env_->kvstore_->getLatest(planContext_->spaceId_, partId, prefix_,
+                                                      &row_, false, planContext_->snapshot_);
+        if (ret == kvstore::ResultCode::SUCCEEDED) {
+            iter_.reset(new SingleTagIterator(planContext_, row_, schemas_, &ttl_));
+            if (FLAGS_enable_vertex_cache && tagContext_->vertexCache_ != nullptr &&
+                    iter_->valid()) {
+                // decode once into the cache, so later requests touching
+                // this vertex skip both the read and the codec
+                auto* reader = iter_->reader();
+                auto row = std::make_shared<CachedTagRow>();
+                row->row = row_;
+                row->ver = reader->schemaVer();
+                auto numFields = reader->numFields();
+                row->decoded.reserve(numFields);
+                if (!decodePlan_->decode(row->row, row->decoded)) {
+                    // a row of an older schema version, decode it
+                    // through the reader
+                    for (size_t i = 0; i < numFields; i++) {
+                        row->decoded.emplace_back(reader->getValueByIndex(i));
+                    }
+                }
+                tagContext_->vertexCache_->insert(std::make_pair(vId, tagId_),
+                                                  std::move(row), partId);
+            }
         } else {
             iter_.reset();
         }
@@ -70,6 +127,9 @@ public:
 
     kvstore::ResultCode collectTagPropsIfValid(NullHandler nullHandler,
                                                TagPropHandler valueHandler) {
+        if (cachedReader_ != nullptr) {
+            return valueHandler(tagId_, cachedReader_.get(), props_);
+        }
         if (!iter_ || !iter_->valid()) {
             return nullHandler(props_);
         }
@@ -77,7 +137,7 @@ public:
     }
 
     bool valid() const override {
-        return iter_ && iter_->valid();
+        return cachedReader_ != nullptr || (iter_ && iter_->valid());
     }
 
     void next() override {
@@ -93,6 +153,9 @@ public:
     }
 
     RowReader* reader() const override {
+        if (cachedReader_ != nullptr) {
+            return cachedReader_.get();
+        }
         if (iter_) {
             return iter_->reader();
         }
@@ -104,6 +167,15 @@ public:
     }
 
 private:
+    const meta::NebulaSchemaProvider* schemaOfVersion(SchemaVer ver) const {
+        for (const auto& schema : *schemas_) {
+            if (schema->getVersion() == ver) {
+                return schema.get();
+            }
+        }
+        return nullptr;
+    }
+
     PlanContext                                                          *planContext_;
     TagContext                                                           *tagContext_;
     TagID                                                                 tagId_;
@@ -116,7 +188,14 @@ private:
 
     std::unique_ptr<StorageIterator>                                      iter_;
     std::string                                                           prefix_;
-    std::string                                                           cacheResult_;
+    // the latest-version row read through getLatest; iter_ references
+    // it, so it must stay alive as long as iter_ does
+    std::string                                                           row_;
+    // a vertex cache hit, served through cachedReader_ without decoding
+    std::shared_ptr<const CachedTagRow>                                   cachedRow_;
+    std::unique_ptr<CachedRowReader>                                      cachedReader_;
+    // built when this node fills the cache, for newest-version rows
+    std::unique_ptr<RowDecodePlan>                                        decodePlan_;
 };
 
 }  // namespace storage
@@ -10,8 +10,11 @@
 #include "common/base/Base.h"
 #include "common/expression/Expression.h"
 #include "storage/context/StorageExpressionContext.h"
+#include "storage/StorageFlags.h"
 #include "storage/exec/TagNode.h"
+#include "storage/exec/EdgeNode.h"
 #include "storage/exec/FilterNode.h"
+#include "storage/MergeOperator.h"
 #include "kvstore/LogEncoder.h"
 
 namespace nebula {
@@ -27,57 +30,62 @@ public:
                   std::vector<storage::cpp2::UpdatedProp>& updatedProps,
                   FilterNode<VertexID>* filterNode,
                   bool insertable,
-                  StorageExpressionContext* expCtx = nullptr)
+                  StorageExpressionContext* expCtx = nullptr,
+                  std::vector<std::pair<std::string, int64_t>> mergeIncrements = {})
         : planContext_(planCtx)
         , tagContext_(tagContext)
         , indexes_(indexes)
         , updatedProps_(updatedProps)
         , filterNode_(filterNode)
         , insertable_(insertable)
-        , expCtx_(expCtx) {
+        , expCtx_(expCtx)
+        , mergeIncrements_(std::move(mergeIncrements)) {
             tagId_ = planContext_->tagId_;
         }
 
     kvstore::ResultCode execute(PartitionID partId, const VertexID& vId) override {
         CHECK_NOTNULL(planContext_->env_->kvstore_);
 
+        if (!mergeIncrements_.empty()) {
+            auto ret = tryMergeUpdate(partId, vId);
+            if (ret != kvstore::ResultCode::ERR_UNSUPPORTED) {
+                return ret;
+            }
+            // The store has no merge operator, or the row was written
+            // with an older schema version; take the atomic op path
+        }
+
+        if (FLAGS_enable_update_key_lock) {
+            // Serialize on the exact vertex being updated, then append
+            // through the normal batched log path. Updates of different
+            // vertices in one partition no longer wait on each other
+            KeyLockGuard lg(&planContext_->env_->keyLockMap_,
+                            NebulaKeyUtils::vertexPrefix(planContext_->vIdLen_,
+                                                         partId, vId, tagId_));
+            auto batch = runUpdate(partId, vId);
+            if (batch == folly::none) {
+                return this->exeResult_ == kvstore::ResultCode::SUCCEEDED
+                     ? kvstore::ResultCode::ERR_ATOMIC_OP_FAILED
+                     : this->exeResult_.load();
+            }
+            folly::Baton<true, std::atomic> baton;
+            auto ret = kvstore::ResultCode::SUCCEEDED;
+            planContext_->env_->kvstore_->asyncAppendBatch(planContext_->spaceId_, partId,
+                std::move(batch).value(),
+                [&ret, &baton] (kvstore::ResultCode code) {
+                    ret = code;
+                    baton.post();
+                });
+            baton.wait();
+            return ret;
+        }
+
         folly::Baton<true, std::atomic> baton;
         auto ret = kvstore::ResultCode::SUCCEEDED;
         planContext_->env_->kvstore_->asyncAtomicOp(planContext_->spaceId_, partId,
             [&partId, &vId, this] ()
             -> folly::Optional<std::string> {
-                this->exeResult_ = RelNode::execute(partId, vId);
-
-                if (this->exeResult_ == kvstore::ResultCode::SUCCEEDED) {
-                    if (this->planContext_->resultStat_ == ResultStatus::ILLEGAL_DATA) {
-                        this->exeResult_ = kvstore::ResultCode::ERR_INVALID_DATA;
-                        return folly::none;
-                    } else if (this->planContext_->resultStat_ ==  ResultStatus::FILTER_OUT) {
-                        this->exeResult_ = kvstore::ResultCode::ERR_RESULT_FILTERED;
-                        return folly::none;
-                    }
-
-                    this->reader_ = filterNode_->reader();
-                    // reset StorageExpressionContext reader_ to nullptr
-                    this->expCtx_->reset();
-
-                    if (!this->reader_ && this->insertable_) {
-                        this->exeResult_ = this->insertTagProps(partId, vId);
-                    } else if (this->reader_) {
-                        this->key_ = filterNode_->key().str();
-                        this->exeResult_ = this->collTagProp();
-                    } else {
-                        this->exeResult_ = kvstore::ResultCode::ERR_KEY_NOT_FOUND;
-                    }
-
-                    if (this->exeResult_ != kvstore::ResultCode::SUCCEEDED) {
-                        return folly::none;
-                    }
-                    return this->updateAndWriteBack(partId, vId);
-                } else {
-                    // if tagnode/edgenode error
-                    return folly::none;
-                }
+                return this->runUpdate(partId, vId);
             },
             [&ret, &baton, this] (kvstore::ResultCode code) {
                 if (code == kvstore::ResultCode::ERR_ATOMIC_OP_FAILED &&
@@ -93,6 +101,99 @@ public:
         return ret;
     }
 
+    // The read-modify-write cycle of one update: run the read plan,
+    // collect or insert the props, and encode the rewritten row (plus
+    // any index updates) as a batch. Returns none with exeResult_ set
+    // on failure
+    folly::Optional<std::string> runUpdate(PartitionID partId, const VertexID& vId) {
+        this->exeResult_ = RelNode::execute(partId, vId);
+
+        if (this->exeResult_ == kvstore::ResultCode::SUCCEEDED) {
+            if (this->planContext_->resultStat_ == ResultStatus::ILLEGAL_DATA) {
+                this->exeResult_ = kvstore::ResultCode::ERR_INVALID_DATA;
+                return folly::none;
+            } else if (this->planContext_->resultStat_ ==  ResultStatus::FILTER_OUT) {
+                this->exeResult_ = kvstore::ResultCode::ERR_RESULT_FILTERED;
+                return folly::none;
+            }
+
+            this->reader_ = filterNode_->reader();
+            // reset StorageExpressionContext reader_ to nullptr
+            this->expCtx_->reset();
+
+            if (!this->reader_ && this->insertable_) {
+                this->exeResult_ = this->insertTagProps(partId, vId);
+            } else if (this->reader_) {
+                this->key_ = filterNode_->key().str();
+                this->exeResult_ = this->collTagProp();
+            } else {
+                this->exeResult_ = kvstore::ResultCode::ERR_KEY_NOT_FOUND;
+            }
+
+            if (this->exeResult_ != kvstore::ResultCode::SUCCEEDED) {
+                return folly::none;
+            }
+            return this->updateAndWriteBack(partId, vId);
+        } else {
+            // if tagnode/edgenode error
+            return folly::none;
+        }
+    }
+
+    // The fast path for counter-style updates: read the vertex once to
+    // find its key and check it exists, then apply the increments as a
+    // merge operand through the normal batched log path. Non-conflicting
+    // updates no longer serialize on the per-part atomic op lock, and
+    // concurrent increments on one vertex all take effect since merge
+    // operands commute
+    kvstore::ResultCode tryMergeUpdate(PartitionID partId, const VertexID& vId) {
+        auto code = RelNode::execute(partId, vId);
+        if (code != kvstore::ResultCode::SUCCEEDED) {
+            return code;
+        }
+        if (planContext_->resultStat_ == ResultStatus::ILLEGAL_DATA) {
+            return kvstore::ResultCode::ERR_INVALID_DATA;
+        }
+        reader_ = filterNode_->reader();
+        this->expCtx_->reset();
+        if (!reader_) {
+            return kvstore::ResultCode::ERR_KEY_NOT_FOUND;
+        }
+        code = getLatestTagSchemaAndName();
+        if (code != kvstore::ResultCode::SUCCEEDED) {
+            return code;
+        }
+        if (reader_->schemaVer() != schema_->getVersion()) {
+            // Patch offsets are computed against the latest schema;
+            // older rows need the rewrite path to upgrade
+            return kvstore::ResultCode::ERR_UNSUPPORTED;
+        }
+
+        RowWriterV2 writer(schema_);
+        std::vector<RowPatchOp> ops;
+        ops.reserve(mergeIncrements_.size());
+        for (const auto& incr : mergeIncrements_) {
+            auto index = schema_->getFieldIndex(incr.first);
+            auto offset = index < 0 ? -1 : writer.fieldOffset(index);
+            if (offset < 0) {
+                return kvstore::ResultCode::ERR_TAG_PROP_NOT_FOUND;
+            }
+            ops.emplace_back(RowPatchOp{static_cast<uint32_t>(offset), incr.second});
+        }
+        auto patch = encodeRowPatch(writer.header(), ops);
+        key_ = filterNode_->key().str();
+
+        folly::Baton<true, std::atomic> baton;
+        auto ret = kvstore::ResultCode::SUCCEEDED;
+        planContext_->env_->kvstore_->asyncMerge(planContext_->spaceId_, partId, key_, patch,
+            [&ret, &baton] (kvstore::ResultCode c) {
+                ret = c;
+                baton.post();
+            });
+        baton.wait();
+        return ret;
+    }
+
     kvstore::ResultCode getLatestTagSchemaAndName() {
         auto schemaIter = tagContext_->schemas_.find(tagId_);
         if (schemaIter == tagContext_->schemas_.end() ||
@@ -147,10 +248,8 @@ public:
         }
 
         // build key, value is emtpy
-        auto version =
-            std::numeric_limits<int64_t>::max() - time::WallClock::fastNowInMicroSec();
-        // Switch version to big-endian, make sure the key is in ordered.
-        version = folly::Endian::big(version);
+        auto version = CommonUtils::genVersion(planContext_->env_,
+                                               planContext_->spaceId_, partId);
         key_ = NebulaKeyUtils::vertexKey(planContext_->vIdLen_,
                                          partId, vId, tagId_, version);
         rowWriter_ = std::make_unique<RowWriterV2>(schema_);
@@ -311,6 +410,8 @@ private:
     std::atomic<kvstore::ResultCode>                                        exeResult_;
 
     StorageExpressionContext                                               *expCtx_;
+    // Non-empty when the update qualifies for the merge fast path
+    std::vector<std::pair<std::string, int64_t>>                            mergeIncrements_;
 };
 
 // Only use for update edge
@@ -323,13 +424,15 @@ public:
                    std::vector<storage::cpp2::UpdatedProp>& updatedProps,
                    FilterNode<cpp2::EdgeKey>* filterNode,
                    bool insertable,
-                   StorageExpressionContext* expCtx = nullptr)
+                   StorageExpressionContext* expCtx = nullptr,
+                   FetchEdgeNode* fetchNode = nullptr)
         : planContext_(planCtx)
         , edgeContext_(edgeContext)
         , indexes_(indexes)
         , updatedProps_(updatedProps)
         , filterNode_(filterNode)
         , insertable_(insertable)
+        , fetchNode_(fetchNode)
         , expCtx_(expCtx) {
             edgeType_ = planContext_->edgeType_;
         }
@@ -337,46 +440,52 @@ public:
     kvstore::ResultCode execute(PartitionID partId, const cpp2::EdgeKey& edgeKey) override {
         CHECK_NOTNULL(planContext_->env_->kvstore_);
 
+        if (FLAGS_enable_update_key_lock) {
+            KeyLockGuard lg(&planContext_->env_->keyLockMap_,
+                            NebulaKeyUtils::edgePrefix(planContext_->vIdLen_, partId,
+                                                       edgeKey.src, edgeKey.edge_type,
+                                                       edgeKey.ranking, edgeKey.dst));
+            if (FLAGS_enable_update_chain_read && fetchNode_ != nullptr) {
+                // An update queued behind the previous holder of this
+                // latch: it left the row it wrote, so the read can be
+                // served from memory instead of the engine
+                auto handoff = lg.takeHandoff();
+                if (handoff != nullptr) {
+                    fetchNode_->injectRow(std::move(handoff->key), std::move(handoff->row));
+                }
+            }
+            auto batch = runUpdate(partId, edgeKey);
+            if (batch == folly::none) {
+                return this->exeResult_ == kvstore::ResultCode::SUCCEEDED
+                     ? kvstore::ResultCode::ERR_ATOMIC_OP_FAILED
+                     : this->exeResult_.load();
+            }
+            folly::Baton<true, std::atomic> baton;
+            auto ret = kvstore::ResultCode::SUCCEEDED;
+            planContext_->env_->kvstore_->asyncAppendBatch(planContext_->spaceId_, partId,
+                std::move(batch).value(),
+                [&ret, &baton] (kvstore::ResultCode code) {
+                    ret = code;
+                    baton.post();
+                });
+            baton.wait();
+            if (ret == kvstore::ResultCode::SUCCEEDED &&
+                FLAGS_enable_update_chain_read && !wroteKey_.empty()) {
+                // The batch is committed before the latch releases, so
+                // the row we leave is exactly what the next queued
+                // update would read back from the engine
+                lg.handoffOnRelease(std::make_unique<KeyLockMap::Handoff>(
+                    KeyLockMap::Handoff{std::move(wroteKey_), std::move(wroteVal_)}));
+            }
+            return ret;
+        }
+
         folly::Baton<true, std::atomic> baton;
         auto ret = kvstore::ResultCode::SUCCEEDED;
         planContext_->env_->kvstore_->asyncAtomicOp(planContext_->spaceId_, partId,
             [&partId, &edgeKey, this] ()
             -> folly::Optional<std::string> {
-                this->exeResult_ = RelNode::execute(partId, edgeKey);
-                if (this->exeResult_ == kvstore::ResultCode::SUCCEEDED) {
-                    if (edgeKey.edge_type != this->edgeType_) {
-                        this->exeResult_ = kvstore::ResultCode::ERR_KEY_NOT_FOUND;
-                        return folly::none;
-                    }
-                    if (this->planContext_->resultStat_ == ResultStatus::ILLEGAL_DATA) {
-                        this->exeResult_ = kvstore::ResultCode::ERR_INVALID_DATA;
-                        return folly::none;
-                    } else if (this->planContext_->resultStat_ ==  ResultStatus::FILTER_OUT) {
-                        this->exeResult_ = kvstore::ResultCode::ERR_RESULT_FILTERED;
-                        return folly::none;
-                    }
-
-                    this->reader_ = filterNode_->reader();
-                    // reset StorageExpressionContext reader_ to nullptr
-                    this->expCtx_->reset();
-
-                    if (!this->reader_ && this->insertable_) {
-                        this->exeResult_ = this->insertEdgeProps(partId, edgeKey);
-                    } else if (this->reader_) {
-                        this->key_ = filterNode_->key().str();
-                        this->exeResult_ = this->collEdgeProp(edgeKey);
-                    } else {
-                        this->exeResult_ = kvstore::ResultCode::ERR_KEY_NOT_FOUND;
-                    }
-
-                    if (this->exeResult_ != kvstore::ResultCode::SUCCEEDED) {
-                        return folly::none;
-                    }
-                    return this->updateAndWriteBack(partId, edgeKey);
-                } else {
-                    // If filter out, StorageExpressionContext is set in filterNode
-                    return folly::none;
-                }
+                return this->runUpdate(partId, edgeKey);
             },
             [&ret, &baton, this] (kvstore::ResultCode code) {
                 if (code == kvstore::ResultCode::ERR_ATOMIC_OP_FAILED &&
@@ -392,6 +501,46 @@ public:
         return ret;
     }
 
+    // The read-modify-write cycle of one update, see
+    // UpdateTagNode::runUpdate
+    folly::Optional<std::string> runUpdate(PartitionID partId, const cpp2::EdgeKey& edgeKey) {
+        this->exeResult_ = RelNode::execute(partId, edgeKey);
+        if (this->exeResult_ == kvstore::ResultCode::SUCCEEDED) {
+            if (edgeKey.edge_type != this->edgeType_) {
+                this->exeResult_ = kvstore::ResultCode::ERR_KEY_NOT_FOUND;
+                return folly::none;
+            }
+            if (this->planContext_->resultStat_ == ResultStatus::ILLEGAL_DATA) {
+                this->exeResult_ = kvstore::ResultCode::ERR_INVALID_DATA;
+                return folly::none;
+            } else if (this->planContext_->resultStat_ ==  ResultStatus::FILTER_OUT) {
+                this->exeResult_ = kvstore::ResultCode::ERR_RESULT_FILTERED;
+                return folly::none;
+            }
+
+            this->reader_ = filterNode_->reader();
+            // reset StorageExpressionContext reader_ to nullptr
+            this->expCtx_->reset();
+
+            if (!this->reader_ && this->insertable_) {
+                this->exeResult_ = this->insertEdgeProps(partId, edgeKey);
+            } else if (this->reader_) {
+                this->key_ = filterNode_->key().str();
+                this->exeResult_ = this->collEdgeProp(edgeKey);
+            } else {
+                this->exeResult_ = kvstore::ResultCode::ERR_KEY_NOT_FOUND;
+            }
+
+            if (this->exeResult_ != kvstore::ResultCode::SUCCEEDED) {
+                return folly::none;
+            }
+            return this->updateAndWriteBack(partId, edgeKey);
+        } else {
+            // If filter out, StorageExpressionContext is set in filterNode
+            return folly::none;
+        }
+    }
+
     kvstore::ResultCode getLatestEdgeSchemaAndName() {
         auto schemaIter = edgeContext_->schemas_.find(std::abs(edgeType_));
         if (schemaIter == edgeContext_->schemas_.end() ||
@@ -452,10 +601,8 @@ public:
         }
 
         // build key, value is emtpy
-        auto version =
-            std::numeric_limits<int64_t>::max() - time::WallClock::fastNowInMicroSec();
-        // Switch version to big-endian, make sure the key is in ordered.
-        version = folly::Endian::big(version);
+        auto version = CommonUtils::genVersion(planContext_->env_,
+                                               planContext_->spaceId_, partId);
         key_ = NebulaKeyUtils::edgeKey(planContext_->vIdLen_,
                                        partId,
                                        edgeKey.src,
@@ -582,6 +729,11 @@ public:
                 }
             }
         }
+        if (FLAGS_enable_update_chain_read) {
+            // Kept aside for the latch handoff once the batch commits
+            wroteKey_ = key_;
+            wroteVal_ = nVal;
+        }
         // step 3, insert new edge data
         batchHolder->put(std::move(key_), std::move(nVal));
         return encodeBatchValue(batchHolder->getBatch());
@@ -621,6 +773,11 @@ private:
 
     std::string                                                             key_;
     RowReader                                                              *reader_{nullptr};
+    // The fetch node of this plan, only needed for chained reads
+    FetchEdgeNode                                                          *fetchNode_{nullptr};
+    // The data key and row the update wrote, kept for the latch handoff
+    std::string                                                             wroteKey_;
+    std::string                                                             wroteVal_;
 
     const meta::NebulaSchemaProvider                                       *schema_{nullptr};
     std::string                                                             edgeName_;
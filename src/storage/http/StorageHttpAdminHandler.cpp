@@ -5,8 +5,11 @@
  */
 
 #include "storage/http/StorageHttpAdminHandler.h"
+#include "storage/admin/AdminTaskManager.h"
 #include "common/webservice/Common.h"
 #include "common/process/ProcessUtils.h"
+#include "utils/CpuProfiler.h"
+#include "utils/NebulaKeyUtils.h"
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/lib/http/ProxygenErrorEnum.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
@@ -31,6 +34,76 @@ void StorageHttpAdminHandler::onRequest(std::unique_ptr<HTTPMessage> headers) no
         resp_ = folly::stringPrintf("Error inside");
         return;
     }
+    auto* taskOp = headers->getQueryParamPtr("op");
+    if (taskOp != nullptr && (*taskOp == "pause_task" || *taskOp == "resume_task")) {
+        // Job-scoped ops: park or unpark the admin tasks of a job on
+        // this storaged; no space is involved
+        auto* job = headers->getQueryParamPtr("job");
+        if (job == nullptr) {
+            err_ = HttpCode::SUCCEEDED;
+            resp_ = "Job should not be empty. "
+                    "Usage: http:://ip:port/admin?op=pause_task&job=xx";
+            return;
+        }
+        int jobId = 0;
+        try {
+            jobId = folly::to<int>(*job);
+        } catch (const std::exception&) {
+            err_ = HttpCode::SUCCEEDED;
+            resp_ = folly::stringPrintf("Bad job id %s", job->c_str());
+            return;
+        }
+        auto* taskMan = AdminTaskManager::instance();
+        auto rc = *taskOp == "pause_task" ? taskMan->pauseJob(jobId)
+                                          : taskMan->resumeJob(jobId);
+        err_ = HttpCode::SUCCEEDED;
+        resp_ = rc == cpp2::ErrorCode::SUCCEEDED
+              ? "ok" : folly::stringPrintf("Job %d not found", jobId);
+        return;
+    }
+
+    if (taskOp != nullptr && *taskOp == "start_profile") {
+        // Process-scoped: sample the whole storaged, no space involved
+        int32_t freq = 99;
+        int32_t duration = 30;
+        auto* freqStr = headers->getQueryParamPtr("freq");
+        auto* durationStr = headers->getQueryParamPtr("duration");
+        try {
+            if (freqStr != nullptr) {
+                freq = folly::to<int32_t>(*freqStr);
+            }
+            if (durationStr != nullptr) {
+                duration = folly::to<int32_t>(*durationStr);
+            }
+        } catch (const std::exception&) {
+            err_ = HttpCode::SUCCEEDED;
+            resp_ = "Bad freq or duration. "
+                    "Usage: http:://ip:port/admin?op=start_profile&freq=99&duration=30";
+            return;
+        }
+        err_ = HttpCode::SUCCEEDED;
+        resp_ = CpuProfiler::start(freq, duration)
+              ? "ok" : "Profiler already running or failed to start";
+        return;
+    }
+    if (taskOp != nullptr && *taskOp == "stop_profile") {
+        // The body is the folded stacks, ready to pipe into a
+        // flamegraph script
+        err_ = HttpCode::SUCCEEDED;
+        resp_ = CpuProfiler::stop();
+        return;
+    }
+    if (taskOp != nullptr && *taskOp == "snapshot_queue") {
+        // Running and queued snapshot streams of the whole store, one
+        // line each; no space is involved
+        err_ = HttpCode::SUCCEEDED;
+        resp_ = kv_->snapshotScheduleStatus();
+        if (resp_.empty()) {
+            resp_ = "no snapshot streams running or queued";
+        }
+        return;
+    }
+
     auto* space = headers->getQueryParamPtr("space");
     if (space == nullptr) {
         err_ = HttpCode::SUCCEEDED;
@@ -66,6 +139,83 @@ void StorageHttpAdminHandler::onRequest(std::unique_ptr<HTTPMessage> headers) no
             err_ = HttpCode::SUCCEEDED;
             return;
         }
+    } else if (*op == "cardinality") {
+        // Approximate per-part vertex and edge counts off the sst
+        // table properties, one line each; upper bounds that every
+        // compaction tightens
+        resp_ = kv_->cardinalityStatus(spaceId);
+        if (resp_.empty()) {
+            resp_ = "no cardinality stats, is --enable_cardinality_stats on?";
+        }
+        err_ = HttpCode::SUCCEEDED;
+        return;
+    } else if (*op == "degree") {
+        // O(1) out-degree read off the counters the edge write path
+        // maintains when --enable_edge_degree_counter is on. Absent
+        // counters read as 0
+        auto* part = headers->getQueryParamPtr("part");
+        auto* vid = headers->getQueryParamPtr("vid");
+        auto* type = headers->getQueryParamPtr("edgetype");
+        if (part == nullptr || vid == nullptr || type == nullptr) {
+            resp_ = "Usage: http:://ip:port/admin"
+                    "?space=xx&op=degree&part=xx&vid=xx&edgetype=xx";
+            err_ = HttpCode::SUCCEEDED;
+            return;
+        }
+        PartitionID partId = 0;
+        EdgeType edgeType = 0;
+        try {
+            partId = folly::to<PartitionID>(*part);
+            edgeType = folly::to<EdgeType>(*type);
+        } catch (const std::exception&) {
+            resp_ = folly::stringPrintf("Bad part %s or edgetype %s",
+                                        part->c_str(), type->c_str());
+            err_ = HttpCode::SUCCEEDED;
+            return;
+        }
+        std::string value;
+        auto status = kv_->get(spaceId, partId,
+                               NebulaKeyUtils::systemDegreeKey(partId, *vid, edgeType),
+                               &value, true);
+        int64_t degree = 0;
+        if (status == kvstore::ResultCode::SUCCEEDED && value.size() == sizeof(degree)) {
+            ::memcpy(&degree, value.data(), sizeof(degree));
+            degree = std::max<int64_t>(degree, 0);
+        } else if (status != kvstore::ResultCode::SUCCEEDED &&
+                   status != kvstore::ResultCode::ERR_KEY_NOT_FOUND) {
+            resp_ = folly::stringPrintf("Degree read failed! error=%d",
+                                        static_cast<int32_t>(status));
+            err_ = HttpCode::SUCCEEDED;
+            return;
+        }
+        resp_ = folly::to<std::string>(degree);
+        err_ = HttpCode::SUCCEEDED;
+        return;
+    } else if (*op == "migrate_part") {
+        // Live intra-host move of one part onto the engine rooted
+        // under the given data path; runs inline like compact
+        auto* part = headers->getQueryParamPtr("part");
+        auto* path = headers->getQueryParamPtr("path");
+        if (part == nullptr || path == nullptr) {
+            resp_ = "Usage: http:://ip:port/admin"
+                    "?space=xx&op=migrate_part&part=xx&path=/data/path";
+            err_ = HttpCode::SUCCEEDED;
+            return;
+        }
+        PartitionID partId = 0;
+        try {
+            partId = folly::to<PartitionID>(*part);
+        } catch (const std::exception&) {
+            resp_ = folly::stringPrintf("Bad part %s", part->c_str());
+            err_ = HttpCode::SUCCEEDED;
+            return;
+        }
+        auto status = kv_->migratePart(spaceId, partId, *path);
+        resp_ = status == kvstore::ResultCode::SUCCEEDED
+              ? "ok"
+              : folly::stringPrintf("Migrate failed! error=%d", static_cast<int32_t>(status));
+        err_ = HttpCode::SUCCEEDED;
+        return;
     } else {
         resp_ = folly::stringPrintf("Unknown operation %s", op->c_str());
         err_ = HttpCode::SUCCEEDED;
@@ -0,0 +1,84 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/http/StorageHttpCacheHandler.h"
+#include "common/webservice/Common.h"
+#include "kvstore/RocksEngineConfig.h"
+#include <folly/json.h>
+#include <proxygen/httpserver/RequestHandler.h>
+#include <proxygen/lib/http/ProxygenErrorEnum.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+
+namespace nebula {
+namespace storage {
+
+using proxygen::HTTPMessage;
+using proxygen::HTTPMethod;
+using proxygen::ProxygenError;
+using proxygen::UpgradeProtocol;
+using proxygen::ResponseBuilder;
+
+void StorageHttpCacheHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
+    if (headers->getMethod().value() != HTTPMethod::GET) {
+        // Unsupported method
+        err_ = HttpCode::E_UNSUPPORTED_METHOD;
+        return;
+    }
+
+    folly::dynamic caches = folly::dynamic::array();
+    for (auto& cache : kvstore::allBlockCaches()) {
+        folly::dynamic stat = folly::dynamic::object();
+        stat["name"] = cache.first;
+        stat["capacity"] = static_cast<int64_t>(cache.second->GetCapacity());
+        stat["usage"] = static_cast<int64_t>(cache.second->GetUsage());
+        stat["pinned_usage"] = static_cast<int64_t>(cache.second->GetPinnedUsage());
+        caches.push_back(std::move(stat));
+    }
+    resp_ = folly::toPrettyJson(caches);
+    err_ = HttpCode::SUCCEEDED;
+}
+
+
+void StorageHttpCacheHandler::onBody(std::unique_ptr<folly::IOBuf>) noexcept {
+    // Do nothing, we only support GET
+}
+
+
+void StorageHttpCacheHandler::onEOM() noexcept {
+    switch (err_) {
+        case HttpCode::E_UNSUPPORTED_METHOD:
+            ResponseBuilder(downstream_)
+                .status(405, "Method Not Allowed")
+                .sendWithEOM();
+            return;
+        default:
+            break;
+    }
+
+    ResponseBuilder(downstream_)
+        .status(200, "OK")
+        .body(resp_)
+        .sendWithEOM();
+}
+
+
+void StorageHttpCacheHandler::onUpgrade(UpgradeProtocol) noexcept {
+    // Do nothing
+}
+
+
+void StorageHttpCacheHandler::requestComplete() noexcept {
+    delete this;
+}
+
+
+void StorageHttpCacheHandler::onError(ProxygenError error) noexcept {
+    LOG(ERROR) << "Web service StorageHttpCacheHandler got error: "
+               << proxygen::getErrorString(error);
+}
+
+}  // namespace storage
+}  // namespace nebula
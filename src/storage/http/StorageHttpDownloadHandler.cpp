@@ -13,8 +13,15 @@
 #include <proxygen/httpserver/RequestHandler.h>
 #include <proxygen/lib/http/ProxygenErrorEnum.h>
 #include <proxygen/httpserver/ResponseBuilder.h>
+#include <folly/TokenBucket.h>
+#include <folly/hash/Checksum.h>
+#include <fstream>
 
-DEFINE_int32(download_thread_num, 3, "download thread number");
+DEFINE_int32(download_thread_num, 3, "Number of files downloaded in parallel");
+
+DEFINE_int32(download_bandwidth_mbs, 0,
+             "Cap on this host's total download rate in MB/s, shared by all "
+             "concurrent transfers. 0 means unlimited");
 
 namespace nebula {
 namespace storage {
@@ -152,8 +159,11 @@ bool StorageHttpDownloadHandler::downloadSSTFiles(const std::string& hdfsHost,
         return false;
     }
 
-    std::vector<folly::SemiFuture<bool>> futures;
-
+    // Enumerate every file of every part first, then spread the file
+    // transfers over the workers: part directories differ wildly in
+    // size, and per-part granularity leaves threads idle at the tail.
+    // Files a previous, interrupted run already completed are skipped
+    auto tasks = std::make_shared<std::vector<DownloadTask>>();
     for (auto& part : parts) {
         PartitionID partId;
         try {
@@ -164,19 +174,46 @@ bool StorageHttpDownloadHandler::downloadSSTFiles(const std::string& hdfsHost,
             return false;
         }
 
-        auto downloader = [hdfsHost, hdfsPort, hdfsPath, partId, this]() {
-            auto hdfsPartPath = folly::stringPrintf("%s/%d", hdfsPath.c_str(), partId);
-            auto partResult = kvstore_->part(spaceID_, partId);
-            if (!ok(partResult)) {
-                LOG(ERROR) << "Can't found space: " << spaceID_ << ", part: " << partId;
-                return false;
-            }
+        auto partResult = kvstore_->part(spaceID_, partId);
+        if (!ok(partResult)) {
+            isRunning.clear();
+            LOG(ERROR) << "Can't found space: " << spaceID_ << ", part: " << partId;
+            return false;
+        }
 
-            auto localPath = folly::stringPrintf("%s/download/",
-                                                 value(partResult)->engine()->getDataRoot());
-            auto result = this->helper_->copyToLocal(hdfsHost, hdfsPort,
-                                                     hdfsPartPath, localPath);
-            return result.ok() && result.value().empty();
+        auto hdfsPartPath = folly::stringPrintf("%s/%d", hdfsPath.c_str(), partId);
+        auto localDir = folly::stringPrintf("%s/download/%d",
+                                            value(partResult)->engine()->getDataRoot(),
+                                            partId);
+        if (!fs::FileUtils::makeDir(localDir)) {
+            isRunning.clear();
+            LOG(ERROR) << "Failed to create " << localDir;
+            return false;
+        }
+        if (!listPartFiles(hdfsHost, hdfsPort, hdfsPartPath, localDir, *tasks)) {
+            isRunning.clear();
+            return false;
+        }
+    }
+    LOG(INFO) << "Download " << tasks->size() << " files with "
+              << FLAGS_download_thread_num << " workers";
+
+    std::vector<folly::SemiFuture<bool>> futures;
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    auto workerNum = std::min(static_cast<size_t>(FLAGS_download_thread_num), tasks->size());
+    for (size_t i = 0; i < workerNum; i++) {
+        auto downloader = [hdfsHost, hdfsPort, tasks, next, this]() {
+            bool succeeded = true;
+            while (true) {
+                auto idx = next->fetch_add(1);
+                if (idx >= tasks->size()) {
+                    break;
+                }
+                if (!downloadFile(hdfsHost, hdfsPort, (*tasks)[idx])) {
+                    succeeded = false;
+                }
+            }
+            return succeeded;
         };
         auto future = pool_->addTask(downloader);
         futures.push_back(std::move(future));
@@ -201,5 +238,113 @@ bool StorageHttpDownloadHandler::downloadSSTFiles(const std::string& hdfsHost,
     return successfully;
 }
 
+bool StorageHttpDownloadHandler::listPartFiles(const std::string& hdfsHost,
+                                               int32_t hdfsPort,
+                                               const std::string& hdfsPartPath,
+                                               const std::string& localDir,
+                                               std::vector<DownloadTask>& tasks) {
+    auto result = helper_->ls(hdfsHost, hdfsPort, hdfsPartPath);
+    if (!result.ok()) {
+        LOG(ERROR) << "List " << hdfsPartPath << " failed";
+        return false;
+    }
+    std::vector<std::string> lines;
+    folly::split("\n", result.value(), lines, true);
+    for (auto& line : lines) {
+        // Skip the "Found N items" header and sub-directories
+        if (line.empty() || line[0] != '-') {
+            continue;
+        }
+        std::vector<std::string> fields;
+        folly::split(" ", line, fields, true);
+        if (fields.size() < 8) {
+            LOG(ERROR) << "Unexpected ls entry \"" << line << "\"";
+            return false;
+        }
+        int64_t size;
+        try {
+            size = folly::to<int64_t>(fields[4]);
+        } catch (const std::exception& ex) {
+            LOG(ERROR) << "Unexpected file size in ls entry \"" << line << "\"";
+            return false;
+        }
+        const auto& hdfsFile = fields.back();
+        auto name = hdfsFile.substr(hdfsFile.find_last_of('/') + 1);
+        auto localFile = folly::stringPrintf("%s/%s", localDir.c_str(), name.c_str());
+        // Resume support: a file whose previous transfer completed and
+        // was verified is not fetched again
+        if (fs::FileUtils::fileType(localFile.c_str()) == fs::FileType::REGULAR
+                && static_cast<int64_t>(fs::FileUtils::fileSize(localFile.c_str())) == size
+                && fs::FileUtils::exist(localFile + ".crc")) {
+            VLOG(1) << "Skip " << localFile << ", already downloaded";
+            continue;
+        }
+        tasks.emplace_back(DownloadTask{hdfsFile, localFile, size});
+    }
+    return true;
+}
+
+bool StorageHttpDownloadHandler::downloadFile(const std::string& hdfsHost,
+                                              int32_t hdfsPort,
+                                              const DownloadTask& task) {
+    auto command = folly::stringPrintf("hdfs dfs -cat \"hdfs://%s:%d%s\"",
+                                       hdfsHost.c_str(), hdfsPort, task.hdfsFile.c_str());
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        LOG(ERROR) << "Failed to run \"" << command << "\"";
+        return false;
+    }
+    auto tmpFile = task.localFile + ".tmp";
+    std::ofstream out(tmpFile, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!out.is_open()) {
+        LOG(ERROR) << "Open " << tmpFile << " failed";
+        pclose(pipe);
+        return false;
+    }
+
+    // One bucket per process, so the cap is per host and shared by all
+    // concurrent transfers. Reading the pipe slowly backpressures the
+    // hdfs client, so the limit holds on the wire as well
+    static folly::DynamicTokenBucket bucket;
+    constexpr size_t kChunkSize = 1UL << 20;
+    auto buffer = std::make_unique<char[]>(kChunkSize);
+    int64_t bytes = 0;
+    uint32_t crc = 0;
+    while (true) {
+        auto readBytes = ::fread(buffer.get(), 1, kChunkSize, pipe);
+        if (readBytes == 0) {
+            break;
+        }
+        if (FLAGS_download_bandwidth_mbs > 0) {
+            double rate = FLAGS_download_bandwidth_mbs * 1024.0 * 1024.0;
+            bucket.consumeWithBorrowAndWait(readBytes, rate, rate);
+        }
+        // The checksum rides along with the transfer instead of a
+        // second pass over the file afterwards
+        crc = folly::crc32c(reinterpret_cast<const uint8_t*>(buffer.get()), readBytes, crc);
+        out.write(buffer.get(), readBytes);
+        bytes += readBytes;
+    }
+    bool writeOk = out.good();
+    out.close();
+    auto status = pclose(pipe);
+    if (status != 0 || !writeOk || bytes != task.size) {
+        LOG(ERROR) << "Download " << task.hdfsFile << " failed: exit status " << status
+                   << ", got " << bytes << " of " << task.size << " bytes";
+        ::unlink(tmpFile.c_str());
+        return false;
+    }
+    if (::rename(tmpFile.c_str(), task.localFile.c_str()) != 0) {
+        LOG(ERROR) << "Rename " << tmpFile << " failed: " << ::strerror(errno);
+        return false;
+    }
+    // Persisted last: its presence is what marks the file complete, so
+    // a restarted download can trust the files it skips
+    std::ofstream crcOut(task.localFile + ".crc", std::ios::out | std::ios::trunc);
+    crcOut << crc;
+    VLOG(1) << "Downloaded " << task.localFile << ", " << bytes << " bytes, crc32c " << crc;
+    return true;
+}
+
 }  // namespace storage
 }  // namespace nebula
@@ -41,11 +41,31 @@ public:
     void onError(proxygen::ProxygenError error) noexcept override;
 
 private:
+    // One file to fetch: the hdfs source, the local target, and the
+    // size the hdfs listing reported
+    struct DownloadTask {
+        std::string hdfsFile;
+        std::string localFile;
+        int64_t     size;
+    };
+
     bool downloadSSTFiles(const std::string& url,
                           int port,
                           const std::string& path,
                           const std::vector<std::string>& parts);
 
+    // Enumerate one part directory and append a task per file that is
+    // not already complete locally
+    bool listPartFiles(const std::string& hdfsHost,
+                       int32_t hdfsPort,
+                       const std::string& hdfsPartPath,
+                       const std::string& localDir,
+                       std::vector<DownloadTask>& tasks);
+
+    // Stream one file down, rate limited and checksummed on the fly
+    bool downloadFile(const std::string& hdfsHost,
+                      int32_t hdfsPort,
+                      const DownloadTask& task);
 
 private:
     HttpCode err_{HttpCode::SUCCEEDED};
@@ -0,0 +1,126 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/http/StorageHttpEngineHandler.h"
+#include "common/webservice/Common.h"
+#include "kvstore/EventListner.h"
+#include <folly/json.h>
+#include <proxygen/httpserver/RequestHandler.h>
+#include <proxygen/lib/http/ProxygenErrorEnum.h>
+#include <proxygen/httpserver/ResponseBuilder.h>
+
+namespace nebula {
+namespace storage {
+
+using proxygen::HTTPMessage;
+using proxygen::HTTPMethod;
+using proxygen::ProxygenError;
+using proxygen::UpgradeProtocol;
+using proxygen::ResponseBuilder;
+
+namespace {
+
+// The per-engine GetProperty set a write-stall diagnosis needs; the
+// statistics tickers cover the rest when they are enabled
+const std::vector<std::string> kEngineProperties = {
+    "rocksdb.levelstats",
+    "rocksdb.estimate-pending-compaction-bytes",
+    "rocksdb.compaction-pending",
+    "rocksdb.num-running-compactions",
+    "rocksdb.num-running-flushes",
+    "rocksdb.mem-table-flush-pending",
+    "rocksdb.cur-size-all-mem-tables",
+    "rocksdb.num-immutable-mem-table",
+    "rocksdb.actual-delayed-write-rate",
+    "rocksdb.is-write-stopped",
+    "rocksdb.block-cache-capacity",
+    "rocksdb.block-cache-usage",
+    "rocksdb.estimate-num-keys",
+    "rocksdb.total-sst-files-size",
+    "rocksdb.estimate-live-data-size",
+};
+
+}  // anonymous namespace
+
+void StorageHttpEngineHandler::onRequest(std::unique_ptr<HTTPMessage> headers) noexcept {
+    if (headers->getMethod().value() != HTTPMethod::GET) {
+        // Unsupported method
+        err_ = HttpCode::E_UNSUPPORTED_METHOD;
+        return;
+    }
+
+    folly::dynamic engines = folly::dynamic::array();
+    for (auto& status : store_->engineStatus(kEngineProperties)) {
+        folly::dynamic engine = folly::dynamic::object();
+        engine["space"] = status.spaceId;
+        engine["path"] = status.path;
+        folly::dynamic properties = folly::dynamic::object();
+        for (auto& prop : status.properties) {
+            properties[prop.first] = prop.second;
+        }
+        engine["properties"] = std::move(properties);
+        folly::dynamic tickers = folly::dynamic::object();
+        for (auto& ticker : status.statistics) {
+            tickers[ticker.first] = ticker.second;
+        }
+        engine["statistics"] = std::move(tickers);
+        engines.push_back(std::move(engine));
+    }
+
+    folly::dynamic result = folly::dynamic::object();
+    result["engines"] = std::move(engines);
+    // the stall transitions are process-wide, counted by the listener
+    // shared across the engines
+    folly::dynamic stalls = folly::dynamic::object();
+    stalls["delayed"] = kvstore::EventListener::stallDelayed().load(std::memory_order_relaxed);
+    stalls["stopped"] = kvstore::EventListener::stallStopped().load(std::memory_order_relaxed);
+    result["write_stalls"] = std::move(stalls);
+
+    resp_ = folly::toPrettyJson(result);
+    err_ = HttpCode::SUCCEEDED;
+}
+
+
+void StorageHttpEngineHandler::onBody(std::unique_ptr<folly::IOBuf>) noexcept {
+    // Do nothing, we only support GET
+}
+
+
+void StorageHttpEngineHandler::onEOM() noexcept {
+    switch (err_) {
+        case HttpCode::E_UNSUPPORTED_METHOD:
+            ResponseBuilder(downstream_)
+                .status(405, "Method Not Allowed")
+                .sendWithEOM();
+            return;
+        default:
+            break;
+    }
+
+    ResponseBuilder(downstream_)
+        .status(200, "OK")
+        .body(resp_)
+        .sendWithEOM();
+}
+
+
+void StorageHttpEngineHandler::onUpgrade(UpgradeProtocol) noexcept {
+    // Do nothing
+}
+
+
+void StorageHttpEngineHandler::requestComplete() noexcept {
+    delete this;
+}
+
+
+void StorageHttpEngineHandler::onError(ProxygenError error) noexcept {
+    LOG(ERROR) << "Web service StorageHttpEngineHandler got error: "
+               << proxygen::getErrorString(error);
+}
+
+}  // namespace storage
+}  // namespace nebula
@@ -0,0 +1,54 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_HTTP_STORAGEHTTPENGINEHANDLER_H_
+#define STORAGE_HTTP_STORAGEHTTPENGINEHANDLER_H_
+
+#include "common/base/Base.h"
+#include "common/webservice/Common.h"
+#include "kvstore/NebulaStore.h"
+#include <proxygen/httpserver/RequestHandler.h>
+
+namespace nebula {
+namespace storage {
+
+using nebula::HttpCode;
+
+// Reports the rocksdb internals of every engine as JSON, one entry per
+// (space, engine path): the level layout, pending compaction bytes,
+// stall state and cache usage from GetProperty, the statistics tickers
+// when --enable_rocksdb_statistics is on, plus the process-wide
+// write-stall transition counters the EventListener keeps
+class StorageHttpEngineHandler : public proxygen::RequestHandler {
+public:
+    StorageHttpEngineHandler() = default;
+
+    void init(kvstore::NebulaStore* store) {
+        store_ = store;
+    }
+
+    void onRequest(std::unique_ptr<proxygen::HTTPMessage> headers) noexcept override;
+
+    void onBody(std::unique_ptr<folly::IOBuf> body)  noexcept override;
+
+    void onEOM() noexcept override;
+
+    void onUpgrade(proxygen::UpgradeProtocol protocol) noexcept override;
+
+    void requestComplete() noexcept override;
+
+    void onError(proxygen::ProxygenError error) noexcept override;
+
+private:
+    kvstore::NebulaStore* store_{nullptr};
+    HttpCode err_{HttpCode::SUCCEEDED};
+    std::string resp_;
+};
+
+}  // namespace storage
+}  // namespace nebula
+
+#endif  // STORAGE_HTTP_STORAGEHTTPENGINEHANDLER_H_
@@ -35,6 +35,19 @@ void StorageHttpIngestHandler::onRequest(std::unique_ptr<HTTPMessage> headers) n
     }
 
     space_ = headers->getIntQueryParam("space");
+
+    // Optional: verify the sst checksums before anything becomes
+    // visible, pre-warm the block cache with the ingested ranges, and
+    // generate the index ssts of the staged rows alongside the data
+    if (headers->hasQueryParam("verify")) {
+        verify_ = headers->getIntQueryParam("verify") != 0;
+    }
+    if (headers->hasQueryParam("prewarm")) {
+        prewarm_ = headers->getIntQueryParam("prewarm") != 0;
+    }
+    if (headers->hasQueryParam("build_index")) {
+        buildIndex_ = headers->getIntQueryParam("build_index") != 0;
+    }
 }
 
 void StorageHttpIngestHandler::onBody(std::unique_ptr<folly::IOBuf>) noexcept {
@@ -91,7 +104,7 @@ void StorageHttpIngestHandler::onError(ProxygenError error) noexcept {
 }
 
 bool StorageHttpIngestHandler::ingestSSTFiles(GraphSpaceID space) {
-    auto code = kvstore_->ingest(space);
+    auto code = kvstore_->ingest(space, verify_, prewarm_, buildIndex_);
     if (code == kvstore::ResultCode::SUCCEEDED) {
         return true;
     } else {
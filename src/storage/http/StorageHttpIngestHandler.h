@@ -41,6 +41,9 @@ private:
     HttpCode err_{HttpCode::SUCCEEDED};
     nebula::kvstore::KVStore *kvstore_;
     GraphSpaceID space_;
+    bool verify_{false};
+    bool prewarm_{false};
+    bool buildIndex_{false};
 };
 
 }  // namespace storage
@@ -9,6 +9,7 @@
 
 #include "common/stats/Stats.h"
 #include "storage/index/IndexPolicyMaker.h"
+#include "storage/index/IndexStats.h"
 
 namespace nebula {
 namespace storage {
@@ -25,10 +26,12 @@ protected:
                            meta::IndexManager* indexMan,
                            stats::Stats* stats,
                            VertexCache* cache,
+                           folly::Executor* executor = nullptr,
                            bool isEdgeIndex = false)
         : BaseProcessor<RESP>(kvstore, schemaMan, stats)
         , IndexPolicyMaker(schemaMan, indexMan)
         , vertexCache_(cache)
+        , executor_(executor)
         , isEdgeIndex_(isEdgeIndex) {}
 
     void putResultCodes(cpp2::ErrorCode code, const std::vector<PartitionID>& parts) {
@@ -71,6 +74,8 @@ private:
 
     std::string getRowFromReader(RowReader* reader);
 
+    std::string getRowFromIndexKey(const folly::StringPiece& key);
+
     bool conditionsCheck(const folly::StringPiece& key);
 
     OptVariantType decodeValue(const folly::StringPiece& key,
@@ -82,14 +87,24 @@ private:
 protected:
     GraphSpaceID                           spaceId_;
     VertexCache*                           vertexCache_{nullptr};
+    // Fan the per-part scans out on this pool when set; the parts of
+    // an index lookup are independent of each other
+    folly::Executor*                       executor_{nullptr};
+    // Guards the result rows and error codes when parts run in parallel
+    std::mutex                             lock_;
     std::shared_ptr<SchemaWriter>          schema_{nullptr};
     std::vector<cpp2::VertexIndexData>     vertexRows_;
     std::vector<cpp2::Edge>                edgeRows_;
 
 private:
-    int                                    rowNum_{0};
+    // The global row limit counter, shared across the parts so a
+    // satisfied limit stops the remaining scans early
+    std::atomic<int32_t>                   rowNum_{0};
     int32_t                                tagOrEdge_;
     bool                                   isEdgeIndex_{false};
+    // True when every return column is embedded in the index key, so
+    // the base row is never fetched
+    bool                                   covered_{false};
     int32_t                                vColNum_{0};
     std::vector<PropContext>               props_;
     std::map<std::string, nebula::cpp2::SupportedType> indexCols_;
@@ -109,6 +109,18 @@ cpp2::ErrorCode IndexExecutor<RESP>::checkReturnColumns(const std::vector<std::s
             }
             schema_->appendCol(col, std::move(ftype).get_type());
         }   // end for
+        /**
+         * The index covers the request when every return column is one of
+         * the indexed columns. Rows are then rebuilt from the index key
+         * alone and the base data is never fetched.
+         */
+        covered_ = true;
+        for (auto& col : cols) {
+            if (indexCols_.find(col) == indexCols_.end()) {
+                covered_ = false;
+                break;
+            }
+        }
     }
     return cpp2::ErrorCode::SUCCEEDED;
 }
@@ -118,7 +130,27 @@ kvstore::ResultCode IndexExecutor<RESP>::executeExecutionPlan(PartitionID part)
     std::string prefix = NebulaKeyUtils::indexPrefix(part, index_->get_index_id())
                         .append(prefix_);
     std::unique_ptr<kvstore::KVIterator> iter;
-    std::vector<std::string> keys;
+    /**
+     * Consult the selectivity statistics the last rebuild of this index
+     * left behind, and call out scans whose equality prefix selects a
+     * pathological number of rows — those are the graph layer picking
+     * the wrong index.
+     */
+    std::string rawStats;
+    if (this->kvstore_->get(spaceId_, part,
+                            NebulaKeyUtils::systemIndexStatsKey(part, index_->get_index_id()),
+                            &rawStats) == kvstore::ResultCode::SUCCEEDED) {
+        auto stats = IndexStats::decode(rawStats);
+        if (stats.ok()) {
+            auto estimate = prefix_.empty() ? stats.value().rowCount()
+                                            : stats.value().rowsPerValue();
+            if (estimate > FLAGS_max_rows_returned_per_lookup) {
+                LOG(WARNING) << "Low selectivity scan of index " << index_->get_index_id()
+                             << ": part " << part << " estimated to hit "
+                             << estimate << " rows";
+            }
+        }
+    }
     auto ret = this->kvstore_->prefix(spaceId_,
                                       part,
                                       prefix,
@@ -126,6 +158,11 @@ kvstore::ResultCode IndexExecutor<RESP>::executeExecutionPlan(PartitionID part)
     if (ret != nebula::kvstore::SUCCEEDED) {
         return ret;
     }
+    /**
+     * Rows are fetched as the scan walks, so the memory of a lookup is
+     * bounded by the row limit instead of the match count of the
+     * prefix; the limit stops the iterator loop itself.
+     */
     while (iter->valid() &&
            rowNum_ < FLAGS_max_rows_returned_per_lookup) {
         auto key = iter->key();
@@ -136,14 +173,11 @@ kvstore::ResultCode IndexExecutor<RESP>::executeExecutionPlan(PartitionID part)
             iter->next();
             continue;
         }
-        keys.emplace_back(key);
-        iter->next();
-    }
-    for (auto& item : keys) {
-        ret = getDataRow(part, item);
+        ret = getDataRow(part, key);
         if (ret != kvstore::ResultCode::SUCCEEDED) {
             return ret;
         }
+        iter->next();
     }
     return ret;
 }
@@ -156,6 +190,7 @@ kvstore::ResultCode IndexExecutor<RESP>::getDataRow(PartitionID partId,
         cpp2::Edge data;
         ret = getEdgeRow(partId, key, &data);
         if (ret == kvstore::SUCCEEDED) {
+            std::lock_guard<std::mutex> lg(lock_);
             edgeRows_.emplace_back(std::move(data));
             ++rowNum_;
         }
@@ -163,6 +198,7 @@ kvstore::ResultCode IndexExecutor<RESP>::getDataRow(PartitionID partId,
         cpp2::VertexIndexData data;
         ret = getVertexRow(partId, key, &data);
         if (ret == kvstore::SUCCEEDED) {
+            std::lock_guard<std::mutex> lg(lock_);
             vertexRows_.emplace_back(std::move(data));
             ++rowNum_;
         }
@@ -179,11 +215,15 @@ kvstore::ResultCode IndexExecutor<RESP>::getVertexRow(PartitionID partId,
     if (schema_ == nullptr) {
         return kvstore::ResultCode::SUCCEEDED;
     }
+    if (covered_) {
+        data->set_props(getRowFromIndexKey(key));
+        return kvstore::ResultCode::SUCCEEDED;
+    }
     if (FLAGS_enable_vertex_cache && vertexCache_ != nullptr) {
         auto result = vertexCache_->get(std::make_pair(vId, tagOrEdge_), partId);
         if (result.ok()) {
             auto v = std::move(result).value();
-            auto reader = RowReader::getTagPropReader(schemaMan_, v, spaceId_, tagOrEdge_);
+            auto reader = RowReader::getTagPropReader(schemaMan_, v->row, spaceId_, tagOrEdge_);
             auto row = getRowFromReader(reader.get());
             data->set_props(std::move(row));
             VLOG(3) << "Hit cache for vId " << vId << ", tagId " << tagOrEdge_;
@@ -207,8 +247,16 @@ kvstore::ResultCode IndexExecutor<RESP>::getVertexRow(PartitionID partId,
         auto row = getRowFromReader(reader.get());
         data->set_props(std::move(row));
         if (FLAGS_enable_vertex_cache && vertexCache_ != nullptr) {
+            auto cached = std::make_shared<CachedTagRow>();
+            cached->row = iter->val().str();
+            cached->ver = reader->schemaVer();
+            auto numFields = reader->numFields();
+            cached->decoded.reserve(numFields);
+            for (size_t i = 0; i < numFields; i++) {
+                cached->decoded.emplace_back(reader->getValueByIndex(i));
+            }
             vertexCache_->insert(std::make_pair(vId, tagOrEdge_),
-                                 iter->val().str(), partId);
+                                 std::move(cached), partId);
             VLOG(3) << "Insert cache for vId " << vId << ", tagId " << tagOrEdge_;
         }
     } else {
@@ -234,6 +282,10 @@ kvstore::ResultCode IndexExecutor<RESP>::getEdgeRow(PartitionID partId,
     if (schema_ == nullptr) {
         return kvstore::ResultCode::SUCCEEDED;
     }
+    if (covered_) {
+        data->set_props(getRowFromIndexKey(key));
+        return kvstore::ResultCode::SUCCEEDED;
+    }
     auto prefix = NebulaKeyUtils::edgePrefix(partId, src, tagOrEdge_, rank, dst);
     std::unique_ptr<kvstore::KVIterator> iter;
     auto ret = this->kvstore_->prefix(spaceId_, partId, prefix, &iter);
@@ -268,6 +320,33 @@ std::string IndexExecutor<RESP>::getRowFromReader(RowReader* reader) {
     return writer.encode();
 }
 
+template<typename RESP>
+std::string IndexExecutor<RESP>::getRowFromIndexKey(const folly::StringPiece& key) {
+    RowWriter writer;
+    for (auto& prop : props_) {
+        auto val = decodeValue(key, prop.prop_.get_name());
+        if (!val.ok()) {
+            LOG(ERROR) << "Skip the bad value for prop " << prop.prop_.get_name();
+            continue;
+        }
+        switch (val.value().which()) {
+            case VAR_INT64:
+                writer << boost::get<int64_t>(val.value());
+                break;
+            case VAR_DOUBLE:
+                writer << boost::get<double>(val.value());
+                break;
+            case VAR_BOOL:
+                writer << boost::get<bool>(val.value());
+                break;
+            case VAR_STR:
+                writer << boost::get<std::string>(val.value());
+                break;
+        }
+    }
+    return writer.encode();
+}
+
 template<typename RESP>
 bool IndexExecutor<RESP>::conditionsCheck(const folly::StringPiece& key) {
     UNUSED(key);
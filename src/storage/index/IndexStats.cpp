@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/index/IndexStats.h"
+#include <folly/hash/Hash.h>
+#include <cmath>
+
+namespace nebula {
+namespace storage {
+
+void IndexStats::addRow(const std::string& leadingValue) {
+    ++rowCount_;
+    uint64_t h = folly::hash::fnv64(leadingValue);
+    auto bucket = h & (kNumRegisters - 1);
+    // Rank is the position of the first set bit of the remaining hash
+    // bits; an all-zero remainder gets the maximum rank
+    uint64_t rest = h >> 8;
+    uint8_t rank = rest == 0 ? 57 : static_cast<uint8_t>(__builtin_ctzll(rest) + 1);
+    if (rank > registers_[bucket]) {
+        registers_[bucket] = rank;
+    }
+}
+
+int64_t IndexStats::distinctLeading() const {
+    constexpr double m = kNumRegisters;
+    // Bias correction constant for m = 256
+    constexpr double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (auto reg : registers_) {
+        sum += std::pow(2.0, -static_cast<double>(reg));
+        if (reg == 0) {
+            ++zeros;
+        }
+    }
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros != 0) {
+        // Linear counting is more accurate at the low end
+        estimate = m * std::log(m / zeros);
+    }
+    auto distinct = static_cast<int64_t>(estimate);
+    // The sketch can overshoot the exact count slightly; the row count
+    // is a hard upper bound
+    return std::min(std::max<int64_t>(distinct, rowCount_ > 0 ? 1 : 0), rowCount_);
+}
+
+int64_t IndexStats::rowsPerValue() const {
+    auto distinct = distinctLeading();
+    return distinct == 0 ? 0 : rowCount_ / distinct;
+}
+
+void IndexStats::merge(const IndexStats& other) {
+    rowCount_ += other.rowCount_;
+    for (size_t i = 0; i < kNumRegisters; i++) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+std::string IndexStats::encode() const {
+    std::string raw;
+    raw.reserve(sizeof(int64_t) + kNumRegisters);
+    raw.append(reinterpret_cast<const char*>(&rowCount_), sizeof(int64_t))
+       .append(reinterpret_cast<const char*>(registers_.data()), kNumRegisters);
+    return raw;
+}
+
+// static
+StatusOr<IndexStats> IndexStats::decode(const folly::StringPiece& raw) {
+    if (raw.size() != sizeof(int64_t) + kNumRegisters) {
+        return Status::Error("Invalid index stats size %zu", raw.size());
+    }
+    IndexStats stats;
+    memcpy(&stats.rowCount_, raw.data(), sizeof(int64_t));
+    memcpy(stats.registers_.data(), raw.data() + sizeof(int64_t), kNumRegisters);
+    return stats;
+}
+
+}  // namespace storage
+}  // namespace nebula
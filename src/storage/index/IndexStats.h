@@ -0,0 +1,59 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_INDEX_INDEXSTATS_H_
+#define STORAGE_INDEX_INDEXSTATS_H_
+
+#include <array>
+
+#include "common/base/Base.h"
+#include "common/base/StatusOr.h"
+
+namespace nebula {
+namespace storage {
+
+// Selectivity statistics of one index within one part: a row count and
+// a HyperLogLog sketch of the distinct values of the leading index
+// column. The rebuild task maintains them while it scans and persists
+// them under NebulaKeyUtils::systemIndexStatsKey; readers decode the
+// per-part blobs and merge() them when they want space-wide numbers.
+// The sketch is mergeable because disjoint key ranges only ever raise
+// register values, so a resumed rebuild can keep counting into the
+// stats its interrupted run saved.
+class IndexStats final {
+public:
+    // Register count of the sketch; at 256 registers the distinct
+    // estimate is within roughly 7% and the encoded blob stays small
+    static constexpr size_t kNumRegisters = 256;
+
+    // Count one index row, sketching the encoded leading column value
+    void addRow(const std::string& leadingValue);
+
+    int64_t rowCount() const {
+        return rowCount_;
+    }
+
+    // Estimated number of distinct leading column values
+    int64_t distinctLeading() const;
+
+    // Average number of rows one leading column value selects, i.e.
+    // the expected cost of an equality lookup on the leading column
+    int64_t rowsPerValue() const;
+
+    void merge(const IndexStats& other);
+
+    std::string encode() const;
+
+    static StatusOr<IndexStats> decode(const folly::StringPiece& raw);
+
+private:
+    int64_t                                 rowCount_{0};
+    std::array<uint8_t, kNumRegisters>      registers_{};
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_INDEX_INDEXSTATS_H_
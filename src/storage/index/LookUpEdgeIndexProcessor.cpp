@@ -5,6 +5,7 @@
  */
 
 #include "storage/index/LookUpEdgeIndexProcessor.h"
+#include "storage/StorageFlags.h"
 
 namespace nebula {
 namespace storage {
@@ -29,8 +30,13 @@ void LookUpEdgeIndexProcessor::process(const cpp2::LookUpIndexRequest& req) {
     }
 
     /**
-     * step 3 : execute index scan.
+     * step 3 : execute index scan. The parts are independent of each
+     * other, so fan them out when a worker pool is available.
      */
+    if (FLAGS_query_concurrently && executor_ != nullptr && req.get_parts().size() > 1) {
+        runConcurrently(req);
+        return;
+    }
     for (auto partId : req.get_parts()) {
         auto code = executeExecutionPlan(partId);
         if (code != kvstore::ResultCode::SUCCEEDED) {
@@ -47,6 +53,38 @@ void LookUpEdgeIndexProcessor::process(const cpp2::LookUpIndexRequest& req) {
         }
     }
 
+    onProcessFinished();
+    this->onFinished();
+}
+
+void LookUpEdgeIndexProcessor::runConcurrently(const cpp2::LookUpIndexRequest& req) {
+    std::vector<folly::Future<folly::Unit>> futures;
+    for (auto partId : req.get_parts()) {
+        futures.emplace_back(folly::via(executor_, [this, partId] () {
+            // executeExecutionPlan appends its rows under lock_ and
+            // checks the shared row limit, so the parts only meet at
+            // the result merge and at the early-stop counter
+            auto code = executeExecutionPlan(partId);
+            if (code != kvstore::ResultCode::SUCCEEDED) {
+                VLOG(1) << "Error! ret = " << static_cast<int32_t>(code)
+                        << ", spaceId = " << spaceId_
+                        << ", partId =  " << partId;
+                std::lock_guard<std::mutex> lg(this->lock_);
+                if (code == kvstore::ResultCode::ERR_LEADER_CHANGED) {
+                    this->handleLeaderChanged(spaceId_, partId);
+                } else {
+                    this->pushResultCode(this->to(code), partId);
+                }
+            }
+        }));
+    }
+    folly::collectAll(futures).thenValue([this] (auto&&) {
+        onProcessFinished();
+        this->onFinished();
+    });
+}
+
+void LookUpEdgeIndexProcessor::onProcessFinished() {
     /**
      * step 4 : collect result.
      */
@@ -61,9 +99,7 @@ void LookUpEdgeIndexProcessor::process(const cpp2::LookUpIndexRequest& req) {
         this->resp_.set_schema(std::move(s));
     }
     this->resp_.set_rows(std::move(edgeRows_));
-    this->onFinished();
 }
 
 }  // namespace storage
 }  // namespace nebula
-
@@ -19,8 +19,9 @@ public:
     static LookUpEdgeIndexProcessor* instance(kvstore::KVStore* kvstore,
                                               meta::SchemaManager* schemaMan,
                                               meta::IndexManager* indexMan,
-                                              stats::Stats* stats) {
-        return new LookUpEdgeIndexProcessor(kvstore, schemaMan, indexMan, stats);
+                                              stats::Stats* stats,
+                                              folly::Executor* executor = nullptr) {
+        return new LookUpEdgeIndexProcessor(kvstore, schemaMan, indexMan, stats, executor);
     }
 
     void process(const cpp2::LookUpIndexRequest& req);
@@ -29,9 +30,16 @@ private:
     explicit LookUpEdgeIndexProcessor(kvstore::KVStore* kvstore,
                                       meta::SchemaManager* schemaMan,
                                       meta::IndexManager* indexMan,
-                                      stats::Stats* stats)
+                                      stats::Stats* stats,
+                                      folly::Executor* executor = nullptr)
         : IndexExecutor<cpp2::LookUpEdgeIndexResp>
-            (kvstore, schemaMan, indexMan, stats, nullptr, true) {}
+            (kvstore, schemaMan, indexMan, stats, nullptr, executor, true) {}
+
+    // Run every part of the request as its own task on executor_,
+    // finishing the response once all parts have been scanned
+    void runConcurrently(const cpp2::LookUpIndexRequest& req);
+
+    void onProcessFinished();
 };
 }  // namespace storage
 }  // namespace nebula
@@ -20,8 +20,10 @@ public:
                                                 meta::SchemaManager* schemaMan,
                                                 meta::IndexManager* indexMan,
                                                 stats::Stats* stats,
-                                                VertexCache* cache = nullptr) {
-        return new LookUpVertexIndexProcessor(kvstore, schemaMan, indexMan, stats, cache);
+                                                VertexCache* cache = nullptr,
+                                                folly::Executor* executor = nullptr) {
+        return new LookUpVertexIndexProcessor(kvstore, schemaMan, indexMan, stats,
+                                              cache, executor);
     }
 
     void process(const cpp2::LookUpIndexRequest& req);
@@ -31,9 +33,16 @@ private:
                                         meta::SchemaManager* schemaMan,
                                         meta::IndexManager* indexMan,
                                         stats::Stats* stats,
-                                        VertexCache* cache = nullptr)
+                                        VertexCache* cache = nullptr,
+                                        folly::Executor* executor = nullptr)
         : IndexExecutor<cpp2::LookUpVertexIndexResp>
-                (kvstore, schemaMan, indexMan, stats, cache) {}
+                (kvstore, schemaMan, indexMan, stats, cache, executor) {}
+
+    // Run every part of the request as its own task on executor_,
+    // finishing the response once all parts have been scanned
+    void runConcurrently(const cpp2::LookUpIndexRequest& req);
+
+    void onProcessFinished();
 };
 }  // namespace storage
 }  // namespace nebula
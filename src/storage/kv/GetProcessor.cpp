@@ -15,37 +15,54 @@ void GetProcessor::process(const cpp2::KVGetRequest& req) {
     GraphSpaceID spaceId = req.get_space_id();
     bool returnPartly = req.get_return_partly();
 
-    std::unordered_map<std::string, std::string> pairs;
-    size_t size = 0;
-    for (auto& part : req.get_parts()) {
-        size += part.second.size();
-    }
-    pairs.reserve(size);
-
+    // The raw keys the client asked for, kept in the same order as the
+    // encoded keys handed to the store, so the response can be keyed by
+    // the raw key when the reads come back
+    std::vector<std::pair<PartitionID, std::vector<std::string>>> rawKeysOfPart;
+    std::vector<std::pair<PartitionID, std::vector<std::string>>> keysOfPart;
+    rawKeysOfPart.reserve(req.get_parts().size());
+    keysOfPart.reserve(req.get_parts().size());
     for (auto& part : req.get_parts()) {
         auto partId = part.first;
         auto& keys = part.second;
         std::vector<std::string> kvKeys;
-        kvKeys.reserve(part.second.size());
+        kvKeys.reserve(keys.size());
         std::transform(keys.begin(), keys.end(), std::back_inserter(kvKeys),
                        [partId] (const auto& key) { return NebulaKeyUtils::kvKey(partId, key); });
-        std::vector<std::string> values;
-        auto ret = env_->kvstore_->multiGet(spaceId, partId, kvKeys, &values);
-        if ((ret.first == kvstore::ResultCode::SUCCEEDED) ||
-            (ret.first == kvstore::ResultCode::ERR_PARTIAL_RESULT && returnPartly)) {
-            auto& status = ret.second;
-            for (size_t i = 0; i < kvKeys.size(); i++) {
-                if (status[i].ok()) {
-                    pairs.emplace(keys[i], values[i]);
+        rawKeysOfPart.emplace_back(partId, keys);
+        keysOfPart.emplace_back(partId, std::move(kvKeys));
+    }
+
+    // Read all parts in parallel, and assemble the response when the
+    // last of them finished
+    env_->kvstore_->asyncMultiGet(spaceId, std::move(keysOfPart))
+        .thenValue([this, spaceId, returnPartly, rawKeysOfPart = std::move(rawKeysOfPart)] (
+                std::vector<kvstore::KVStore::PartMultiGetResult>&& results) {
+            std::unordered_map<std::string, std::string> pairs;
+            size_t size = 0;
+            for (auto& part : rawKeysOfPart) {
+                size += part.second.size();
+            }
+            pairs.reserve(size);
+
+            for (size_t idx = 0; idx < results.size(); idx++) {
+                auto& result = results[idx];
+                auto& rawKeys = rawKeysOfPart[idx].second;
+                if ((result.code == kvstore::ResultCode::SUCCEEDED) ||
+                    (result.code == kvstore::ResultCode::ERR_PARTIAL_RESULT && returnPartly)) {
+                    for (size_t i = 0; i < rawKeys.size(); i++) {
+                        if (result.statuses[i].ok()) {
+                            pairs.emplace(rawKeys[i], std::move(result.values[i]));
+                        }
+                    }
+                } else {
+                    handleErrorCode(result.code, spaceId, result.partId);
                 }
             }
-        } else {
-            handleErrorCode(ret.first, spaceId, partId);
-        }
-    }
 
-    resp_.set_key_values(std::move(pairs));
-    this->onFinished();
+            resp_.set_key_values(std::move(pairs));
+            this->onFinished();
+        });
 }
 
 }  // namespace storage
@@ -5,21 +5,22 @@
  */
 
 #include "storage/mutate/AddEdgesProcessor.h"
-#include "common/time/WallClock.h"
+#include "storage/mutate/EdgeTxCoordinator.h"
 #include "utils/NebulaKeyUtils.h"
 #include "utils/IndexKeyUtils.h"
 #include <algorithm>
+#include <folly/hash/Hash.h>
+#include "codec/RowBatchEncoder.h"
 #include "codec/RowWriterV2.h"
+#include "storage/MergeOperator.h"
+#include "storage/StorageFlags.h"
+
+DECLARE_int32(mutate_dedup_window);
 
 namespace nebula {
 namespace storage {
 
 void AddEdgesProcessor::process(const cpp2::AddEdgesRequest& req) {
-    auto version =
-        std::numeric_limits<int64_t>::max() - time::WallClock::fastNowInMicroSec();
-    // Switch version to big-endian, make sure the key is in ordered.
-    version = folly::Endian::big(version);
-
     spaceId_ = req.get_space_id();
     const auto& partEdges = req.get_parts();
     const auto& propNames = req.get_prop_names();
@@ -45,12 +46,29 @@ void AddEdgesProcessor::process(const cpp2::AddEdgesRequest& req) {
     }
 
     CHECK_NOTNULL(env_->kvstore_);
+    // Two-part commit across the parts of this request; the counter
+    // merges and the index mutations would need to ride the prepare
+    // batches, so those modes keep the independent per-part rounds
+    bool atomicMode = FLAGS_atomic_edge_writes
+                      && partEdges.size() > 1
+                      && indexes_.empty()
+                      && !FLAGS_bulk_load_import
+                      && !FLAGS_enable_edge_degree_counter;
+    std::vector<EdgeTxCoordinator::Participant> txParts;
+    // One encoder per edge type, resolving the prop names and sizing
+    // the row buffers once instead of per row. The MRU pointer skips
+    // even the map lookup for runs of edges of the same type
+    std::unordered_map<EdgeType, RowBatchEncoder> encoders;
+    RowBatchEncoder* encoder = nullptr;
+    EdgeType encoderType = 0;
     for (auto& part : partEdges) {
         auto partId = part.first;
         const auto& newEdges = part.second;
+        auto version = CommonUtils::genVersion(env_, spaceId_, partId);
 
         std::vector<kvstore::KV> data;
         data.reserve(32);
+        std::map<std::pair<VertexID, EdgeType>, int64_t> degreeDeltas;
         for (auto& newEdge : newEdges) {
             auto edgeKey = newEdge.key;
             VLOG(3) << "PartitionID: " << partId << ", VertexID: " << edgeKey.src
@@ -74,18 +92,27 @@ void AddEdgesProcessor::process(const cpp2::AddEdgesRequest& req) {
                                                 edgeKey.ranking,
                                                 edgeKey.dst,
                                                 version);
-            auto schema = env_->schemaMan_->getEdgeSchema(spaceId_,
-                                                          std::abs(edgeKey.edge_type));
-            if (!schema) {
-                LOG(ERROR) << "Space " << spaceId_ << ", Edge "
-                            << edgeKey.edge_type << " invalid";
-                pushResultCode(cpp2::ErrorCode::E_EDGE_NOT_FOUND, partId);
-                onFinished();
-                return;
+            auto edgeType = std::abs(edgeKey.edge_type);
+            if (encoder == nullptr || encoderType != edgeType) {
+                auto encIter = encoders.find(edgeType);
+                if (encIter == encoders.end()) {
+                    auto schema = pinEdgeSchema(spaceId_, edgeType);
+                    if (!schema) {
+                        LOG(ERROR) << "Space " << spaceId_ << ", Edge "
+                                    << edgeKey.edge_type << " invalid";
+                        pushResultCode(cpp2::ErrorCode::E_EDGE_NOT_FOUND, partId);
+                        onFinished();
+                        return;
+                    }
+                    encIter = encoders.emplace(edgeType,
+                                               RowBatchEncoder(schema, propNames)).first;
+                }
+                encoder = &encIter->second;
+                encoderType = edgeType;
             }
 
             auto props = newEdge.get_props();
-            auto retEnc = encodeRowVal(schema.get(), propNames, props);
+            auto retEnc = encoder->encode(props);
             if (!retEnc.ok()) {
                 LOG(ERROR) << retEnc.status();
                 pushResultCode(cpp2::ErrorCode::E_DATA_TYPE_MISMATCH, partId);
@@ -93,14 +120,99 @@ void AddEdgesProcessor::process(const cpp2::AddEdgesRequest& req) {
                 return;
             }
 
+            if (degreeCache_ != nullptr || FLAGS_enable_edge_degree_counter) {
+                degreeDeltas[std::make_pair(edgeKey.src, edgeKey.edge_type)]++;
+            }
             data.emplace_back(std::move(key), std::move(retEnc.value()));
         }
+        // Bump the approximate out-degrees. Re-inserted edges count
+        // again and concurrent writers may race on an entry, which is
+        // fine: the counts only steer the sampling pushdown
+        if (degreeCache_ != nullptr) {
+            for (const auto& delta : degreeDeltas) {
+                auto current = degreeCache_->get(delta.first, partId);
+                auto degree = current.ok() ? current.value() : 0;
+                degreeCache_->insert(delta.first, degree + delta.second, partId);
+            }
+        }
+        if (atomicMode) {
+            txParts.emplace_back(EdgeTxCoordinator::Participant{partId, std::move(data)});
+            continue;
+        }
+        if (FLAGS_bulk_load_import) {
+            // Same as the vertex bulk path: sort and dedup the batch for
+            // the sst writer, leave index entries to the rebuild job
+            std::map<std::string, std::string> rows;
+            for (auto& kv : data) {
+                rows[std::move(kv.first)] = std::move(kv.second);
+            }
+            std::vector<kvstore::KV> sorted(std::make_move_iterator(rows.begin()),
+                                            std::make_move_iterator(rows.end()));
+            auto code = env_->kvstore_->writeBulkSst(spaceId_, partId, sorted);
+            handleAsync(spaceId_, partId, code);
+            continue;
+        }
         if (indexes_.empty()) {
-            doPut(spaceId_, partId, std::move(data));
+            if (FLAGS_mutate_dedup_window > 0) {
+                // A graph-layer retry re-encodes the same edges with
+                // fresh versions, so the fingerprint hashes the
+                // version-stripped keys: the retried batch maps to the
+                // id of its first attempt and commitLogs drops it
+                uint64_t dedupId = folly::hash::fnv64_buf(&partId, sizeof(partId));
+                kvstore::BatchHolder batchHolder;
+                for (auto& kv : data) {
+                    auto stripped = NebulaKeyUtils::keyWithNoVersion(kv.first);
+                    dedupId = folly::hash::fnv64_buf(stripped.data(), stripped.size(), dedupId);
+                    dedupId = folly::hash::fnv64_buf(kv.second.data(), kv.second.size(), dedupId);
+                    batchHolder.put(std::move(kv.first), std::move(kv.second));
+                }
+                // The counter merges stay outside the fingerprint: a
+                // retried batch maps to the same id, is dropped whole,
+                // and its increments are dropped with it
+                if (FLAGS_enable_edge_degree_counter) {
+                    for (const auto& delta : degreeDeltas) {
+                        batchHolder.merge(NebulaKeyUtils::systemDegreeKey(partId,
+                                                                          delta.first.first,
+                                                                          delta.first.second),
+                                          encodeCounterDelta(delta.second));
+                    }
+                }
+                auto callback = [partId, this](kvstore::ResultCode code) {
+                    handleAsync(spaceId_, partId, code);
+                };
+                env_->kvstore_->asyncAppendBatch(
+                    spaceId_, partId,
+                    kvstore::encodeDedupBatch(dedupId, batchHolder.getBatch()),
+                    std::move(callback));
+            } else if (FLAGS_enable_edge_degree_counter) {
+                // The counter updates must commit with the edges, so
+                // the plain multi-put becomes a batch carrying both
+                kvstore::BatchHolder batchHolder;
+                for (auto& kv : data) {
+                    batchHolder.put(std::move(kv.first), std::move(kv.second));
+                }
+                for (const auto& delta : degreeDeltas) {
+                    batchHolder.merge(NebulaKeyUtils::systemDegreeKey(partId,
+                                                                      delta.first.first,
+                                                                      delta.first.second),
+                                      encodeCounterDelta(delta.second));
+                }
+                auto callback = [partId, this](kvstore::ResultCode code) {
+                    handleAsync(spaceId_, partId, code);
+                };
+                env_->kvstore_->asyncAppendBatch(spaceId_, partId,
+                                                 kvstore::encodeBatchValue(batchHolder.getBatch()),
+                                                 std::move(callback));
+            } else {
+                doPut(spaceId_, partId, std::move(data));
+            }
+        } else if (FLAGS_enable_batched_index_writes) {
+            addEdgesBatched(partId, std::move(data), std::move(degreeDeltas));
         } else {
-             auto atomic = [partId, edges = std::move(data), this]()
+             auto atomic = [partId, edges = std::move(data),
+                           deltas = std::move(degreeDeltas), this]()
                           -> folly::Optional<std::string> {
-                return addEdges(partId, edges);
+                return addEdges(partId, edges, deltas);
             };
             auto callback = [partId, this](kvstore::ResultCode code) {
                 handleAsync(spaceId_, partId, code);
@@ -108,11 +220,27 @@ void AddEdgesProcessor::process(const cpp2::AddEdgesRequest& req) {
             this->env_->kvstore_->asyncAtomicOp(spaceId_, partId, atomic, callback);
         }
     }
+    if (atomicMode) {
+        std::vector<PartitionID> partIds;
+        partIds.reserve(txParts.size());
+        for (const auto& part : txParts) {
+            partIds.emplace_back(part.partId);
+        }
+        EdgeTxCoordinator::commit(env_->kvstore_, spaceId_, std::move(txParts))
+            .thenValue([this, partIds = std::move(partIds)] (kvstore::ResultCode code) {
+                // All-or-nothing: the one decision applies to every part
+                for (auto partId : partIds) {
+                    handleAsync(spaceId_, partId, code);
+                }
+            });
+    }
 }
 
 folly::Optional<std::string>
 AddEdgesProcessor::addEdges(PartitionID partId,
-                            const std::vector<kvstore::KV>& edges) {
+                            const std::vector<kvstore::KV>& edges,
+                            const std::map<std::pair<VertexID, EdgeType>,
+                                           int64_t>& degreeDeltas) {
     std::unique_ptr<kvstore::BatchHolder> batchHolder = std::make_unique<kvstore::BatchHolder>();
 
     /*
@@ -167,10 +295,17 @@ AddEdgesProcessor::addEdges(PartitionID partId,
                  * step 2 , Insert new edge index
                  */
                 if (nReader == nullptr) {
-                    nReader = RowReader::getEdgePropReader(this->env_->schemaMan_,
-                                                           spaceId_,
-                                                           edgeType,
-                                                           e.second);
+                    // rows of this request were encoded against the
+                    // pinned schema, so its reader applies directly
+                    const auto* schema = findPinnedEdgeSchema(std::abs(edgeType));
+                    if (schema != nullptr) {
+                        nReader = RowReader::getRowReader(schema, e.second);
+                    } else {
+                        nReader = RowReader::getEdgePropReader(this->env_->schemaMan_,
+                                                               spaceId_,
+                                                               edgeType,
+                                                               e.second);
+                    }
                     if (nReader == nullptr) {
                         LOG(ERROR) << "Bad format row";
                         return folly::none;
@@ -190,9 +325,188 @@ AddEdgesProcessor::addEdges(PartitionID partId,
         batchHolder->put(std::move(key), std::move(prop));
     }
 
+    if (FLAGS_enable_edge_degree_counter) {
+        for (const auto& delta : degreeDeltas) {
+            batchHolder->merge(NebulaKeyUtils::systemDegreeKey(partId,
+                                                               delta.first.first,
+                                                               delta.first.second),
+                               encodeCounterDelta(delta.second));
+        }
+    }
+
     return encodeBatchValue(batchHolder->getBatch());
 }
 
+void AddEdgesProcessor::addEdgesBatched(PartitionID partId,
+                                        std::vector<kvstore::KV>&& edges,
+                                        std::map<std::pair<VertexID, EdgeType>,
+                                                 int64_t>&& degreeDeltas) {
+    // Same last-writer-wins dedup of repeated edges as addEdges()
+    std::map<std::string, std::string> newEdges;
+    for (auto& kv : edges) {
+        newEdges[std::move(kv.first)] = std::move(kv.second);
+    }
+
+    // The indexes each edge type carries, resolved once per part
+    // instead of scanning the whole index list per edge
+    std::unordered_map<EdgeType,
+                       std::vector<std::shared_ptr<nebula::meta::cpp2::IndexItem>>> indexesOf;
+    for (const auto& index : indexes_) {
+        indexesOf[index->get_schema_id().get_edge_type()].emplace_back(index);
+    }
+
+    // Latch every indexed edge before reading its old row, so no
+    // concurrent write of the same edge can slip between the lookup
+    // and the append. The latch key is the version-stripped prefix the
+    // update key-lock path uses, so the two paths serialize against
+    // each other. newEdges iterates in key order and every request
+    // acquires in that order, so requests latching overlapping sets
+    // cannot deadlock
+    auto latched = std::make_shared<std::vector<std::string>>();
+    latched->reserve(newEdges.size());
+    std::vector<std::string> prefixes;
+    prefixes.reserve(newEdges.size());
+    for (const auto& e : newEdges) {
+        if (indexesOf.count(NebulaKeyUtils::getEdgeType(spaceVidLen_, e.first)) == 0) {
+            // Plain puts are last-writer-wins with or without the latch
+            prefixes.emplace_back();
+            continue;
+        }
+        auto prefix = NebulaKeyUtils::edgePrefix(
+                spaceVidLen_,
+                partId,
+                NebulaKeyUtils::getSrcId(spaceVidLen_, e.first).str(),
+                NebulaKeyUtils::getEdgeType(spaceVidLen_, e.first),
+                NebulaKeyUtils::getRank(spaceVidLen_, e.first),
+                NebulaKeyUtils::getDstId(spaceVidLen_, e.first).str());
+        env_->keyLockMap_.lock(prefix);
+        latched->emplace_back(prefix);
+        prefixes.emplace_back(std::move(prefix));
+    }
+    auto unlockAll = [this, &latched] {
+        for (const auto& key : *latched) {
+            env_->keyLockMap_.unlock(key);
+        }
+    };
+
+    // The old-row lookups, hoisted out of the key generation and issued
+    // back to back in key order under one pinned version. The data keys
+    // carry a version suffix, so the latest row is a prefix seek rather
+    // than an exact get - this is as close to a multiGet as the
+    // versioned layout allows. Pinning after all latches are held is
+    // safe: a conflicting writer blocks on its latch and commits after
+    // we release
+    std::vector<std::string> oldRows(prefixes.size());
+    {
+        auto snapshot = env_->kvstore_->beginSnapshot(spaceId_);
+        for (size_t i = 0; i < prefixes.size(); i++) {
+            if (prefixes[i].empty()) {
+                continue;
+            }
+            // In an append-mostly workload most edges are new; the
+            // existence filter spares those inserts the engine probe
+            if (!env_->kvstore_->maybeExists(spaceId_, partId, prefixes[i])) {
+                continue;
+            }
+            std::unique_ptr<kvstore::KVIterator> iter;
+            auto ret = env_->kvstore_->prefix(spaceId_, partId, prefixes[i], &iter,
+                                              false, kvstore::ScanHint::DEFAULT,
+                                              snapshot.get());
+            if (ret != kvstore::ResultCode::SUCCEEDED) {
+                LOG(ERROR) << "Error! ret = " << static_cast<int32_t>(ret)
+                           << ", spaceId " << spaceId_;
+                unlockAll();
+                handleAsync(spaceId_, partId, ret);
+                return;
+            }
+            if (iter && iter->valid()) {
+                oldRows[i] = iter->val().str();
+            }
+        }
+    }
+
+    // One pass generating the index keys: per edge one reader over the
+    // old row, one over the new, then every matching index key off the
+    // pair, with the data put and the counter merges in the same batch
+    kvstore::BatchHolder batchHolder;
+    size_t i = 0;
+    for (const auto& e : newEdges) {
+        auto edgeType = NebulaKeyUtils::getEdgeType(spaceVidLen_, e.first);
+        auto idxIter = indexesOf.find(edgeType);
+        if (idxIter != indexesOf.end()) {
+            std::unique_ptr<RowReader> oReader;
+            if (!oldRows[i].empty()) {
+                oReader = RowReader::getEdgePropReader(env_->schemaMan_,
+                                                       spaceId_,
+                                                       edgeType,
+                                                       oldRows[i]);
+                if (oReader == nullptr) {
+                    LOG(ERROR) << "Bad format row";
+                    unlockAll();
+                    // what the raft layer reports when addEdges() bails
+                    handleAsync(spaceId_, partId, kvstore::ResultCode::ERR_ATOMIC_OP_FAILED);
+                    return;
+                }
+            }
+            std::unique_ptr<RowReader> nReader;
+            // rows of this request were encoded against the pinned
+            // schema, so its reader applies directly
+            const auto* schema = findPinnedEdgeSchema(std::abs(edgeType));
+            if (schema != nullptr) {
+                nReader = RowReader::getRowReader(schema, e.second);
+            } else {
+                nReader = RowReader::getEdgePropReader(env_->schemaMan_,
+                                                       spaceId_,
+                                                       edgeType,
+                                                       e.second);
+            }
+            if (nReader == nullptr) {
+                LOG(ERROR) << "Bad format row";
+                unlockAll();
+                handleAsync(spaceId_, partId, kvstore::ResultCode::ERR_ATOMIC_OP_FAILED);
+                return;
+            }
+            for (const auto& index : idxIter->second) {
+                if (oReader != nullptr) {
+                    auto oi = indexKey(partId, oReader.get(), e.first, index);
+                    if (!oi.empty()) {
+                        batchHolder.remove(std::move(oi));
+                    }
+                }
+                auto ni = indexKey(partId, nReader.get(), e.first, index);
+                if (!ni.empty()) {
+                    batchHolder.put(std::move(ni), "");
+                }
+            }
+        }
+        auto key = e.first;
+        auto prop = e.second;
+        batchHolder.put(std::move(key), std::move(prop));
+        i++;
+    }
+
+    if (FLAGS_enable_edge_degree_counter) {
+        for (const auto& delta : degreeDeltas) {
+            batchHolder.merge(NebulaKeyUtils::systemDegreeKey(partId,
+                                                              delta.first.first,
+                                                              delta.first.second),
+                              encodeCounterDelta(delta.second));
+        }
+    }
+
+    // The latches stay held until the append commits, so a latched
+    // reader never observes the state between our lookup and our write
+    env_->kvstore_->asyncAppendBatch(
+        spaceId_, partId,
+        encodeBatchValue(batchHolder.getBatch()),
+        [partId, latched, this] (kvstore::ResultCode code) {
+            for (const auto& key : *latched) {
+                env_->keyLockMap_.unlock(key);
+            }
+            handleAsync(spaceId_, partId, code);
+        });
+}
+
 folly::Optional<std::string>
 AddEdgesProcessor::findObsoleteIndex(PartitionID partId, const folly::StringPiece& rawKey) {
     auto prefix = NebulaKeyUtils::edgePrefix(spaceVidLen_,
@@ -202,6 +516,11 @@ AddEdgesProcessor::findObsoleteIndex(PartitionID partId, const folly::StringPiec
                                              NebulaKeyUtils::getRank(spaceVidLen_, rawKey),
                                              NebulaKeyUtils::getDstId(spaceVidLen_, rawKey).str());
     std::unique_ptr<kvstore::KVIterator> iter;
+    // In an append-mostly workload most edges are new; the existence
+    // filter spares those inserts the engine probe
+    if (!this->env_->kvstore_->maybeExists(this->spaceId_, partId, prefix)) {
+        return std::string();
+    }
     auto ret = this->env_->kvstore_->prefix(this->spaceId_, partId, prefix, &iter);
     if (ret != kvstore::ResultCode::SUCCEEDED) {
         LOG(ERROR) << "Error! ret = " << static_cast<int32_t>(ret)
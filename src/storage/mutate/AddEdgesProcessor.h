@@ -18,18 +18,31 @@ namespace storage {
 class AddEdgesProcessor : public BaseProcessor<cpp2::ExecResponse> {
 public:
     static AddEdgesProcessor* instance(StorageEnv* env,
-                                       stats::Stats* stats) {
-        return new AddEdgesProcessor(env, stats);
+                                       stats::Stats* stats,
+                                       DegreeCache* degreeCache = nullptr) {
+        return new AddEdgesProcessor(env, stats, degreeCache);
     }
 
     void process(const cpp2::AddEdgesRequest& req);
 
 private:
-    AddEdgesProcessor(StorageEnv* env, stats::Stats* stats)
-        : BaseProcessor<cpp2::ExecResponse>(env, stats) {}
+    AddEdgesProcessor(StorageEnv* env, stats::Stats* stats, DegreeCache* degreeCache)
+        : BaseProcessor<cpp2::ExecResponse>(env, stats)
+        , degreeCache_(degreeCache) {}
 
     folly::Optional<std::string> addEdges(PartitionID partId,
-                                          const std::vector<kvstore::KV>& edges);
+                                          const std::vector<kvstore::KV>& edges,
+                                          const std::map<std::pair<VertexID, EdgeType>,
+                                                         int64_t>& degreeDeltas);
+
+    // The --enable_batched_index_writes variant of addEdges: the same
+    // batch is assembled on the processor thread under per-edge latches
+    // and appended through the normal batched log path, instead of
+    // inside the per-part atomic op queue
+    void addEdgesBatched(PartitionID partId,
+                         std::vector<kvstore::KV>&& edges,
+                         std::map<std::pair<VertexID, EdgeType>,
+                                  int64_t>&& degreeDeltas);
 
     folly::Optional<std::string> findObsoleteIndex(PartitionID partId,
                                                    const folly::StringPiece& rawKey);
@@ -42,6 +55,9 @@ private:
 private:
     GraphSpaceID                                                spaceId_;
     std::vector<std::shared_ptr<nebula::meta::cpp2::IndexItem>> indexes_;
+    // Approximate out-degrees fed by every added edge; null when the
+    // degree-aware sampling is disabled
+    DegreeCache                                                *degreeCache_{nullptr};
 };
 
 }  // namespace storage
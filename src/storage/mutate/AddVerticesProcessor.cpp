@@ -8,21 +8,18 @@
 #include "utils/NebulaKeyUtils.h"
 #include "utils/IndexKeyUtils.h"
 #include <algorithm>
-#include "common/time/WallClock.h"
+#include <folly/hash/Hash.h>
+#include "codec/RowBatchEncoder.h"
 #include "codec/RowWriterV2.h"
 #include "storage/StorageFlags.h"
 
 DECLARE_bool(enable_vertex_cache);
+DECLARE_int32(mutate_dedup_window);
 
 namespace nebula {
 namespace storage {
 
 void AddVerticesProcessor::process(const cpp2::AddVerticesRequest& req) {
-    auto version =
-        std::numeric_limits<int64_t>::max() - time::WallClock::fastNowInMicroSec();
-    // Switch version to big-endian, make sure the key is in ordered.
-    version = folly::Endian::big(version);
-
     spaceId_ = req.get_space_id();
     const auto& partVertices = req.get_parts();
     const auto& propNamesMap = req.get_prop_names();
@@ -47,9 +44,16 @@ void AddVerticesProcessor::process(const cpp2::AddVerticesRequest& req) {
     }
 
     CHECK_NOTNULL(env_->kvstore_);
+    // One encoder per tag, resolving the prop names and sizing the row
+    // buffers once instead of per row. The MRU pointer skips even the
+    // map lookup for runs of rows carrying the same tag
+    std::unordered_map<TagID, RowBatchEncoder> encoders;
+    RowBatchEncoder* encoder = nullptr;
+    TagID encoderTag = 0;
     for (auto& part : partVertices) {
         auto partId = part.first;
         const auto& vertices = part.second;
+        auto version = CommonUtils::genVersion(env_, spaceId_, partId);
 
         std::vector<kvstore::KV> data;
         data.reserve(32);
@@ -72,22 +76,30 @@ void AddVerticesProcessor::process(const cpp2::AddVerticesRequest& req) {
 
                 auto key = NebulaKeyUtils::vertexKey(spaceVidLen_, partId, vid,
                                                      tagId, version);
-                auto schema = env_->schemaMan_->getTagSchema(spaceId_, tagId);
-                if (!schema) {
-                    LOG(ERROR) << "Space " << spaceId_ << ", Tag " << tagId << " invalid";
-                    pushResultCode(cpp2::ErrorCode::E_TAG_NOT_FOUND, partId);
-                    onFinished();
-                    return;
+                if (encoder == nullptr || encoderTag != tagId) {
+                    auto encIter = encoders.find(tagId);
+                    if (encIter == encoders.end()) {
+                        auto schema = pinTagSchema(spaceId_, tagId);
+                        if (!schema) {
+                            LOG(ERROR) << "Space " << spaceId_ << ", Tag " << tagId << " invalid";
+                            pushResultCode(cpp2::ErrorCode::E_TAG_NOT_FOUND, partId);
+                            onFinished();
+                            return;
+                        }
+                        auto iter = propNamesMap.find(tagId);
+                        std::vector<std::string> propNames;
+                        if (iter != propNamesMap.end()) {
+                            propNames = iter->second;
+                        }
+                        encIter = encoders.emplace(tagId,
+                                                   RowBatchEncoder(schema, propNames)).first;
+                    }
+                    encoder = &encIter->second;
+                    encoderTag = tagId;
                 }
 
                 auto props = newTag.get_props();
-                auto iter = propNamesMap.find(tagId);
-                std::vector<std::string> propNames;
-                if (iter != propNamesMap.end()) {
-                    propNames = iter->second;
-                }
-
-                auto retEnc = encodeRowVal(schema.get(), propNames, props);
+                auto retEnc = encoder->encode(props);
                 if (!retEnc.ok()) {
                     LOG(ERROR) << retEnc.status();
                     pushResultCode(cpp2::ErrorCode::E_DATA_TYPE_MISMATCH, partId);
@@ -103,8 +115,45 @@ void AddVerticesProcessor::process(const cpp2::AddVerticesRequest& req) {
                 }
             }
         }
+        if (FLAGS_bulk_load_import) {
+            // The sst writer needs ascending unique keys; the map both
+            // sorts the batch and collapses duplicates, like addVertices
+            // does for the index path. Index entries are not staged —
+            // the rebuild-index job recreates them after the ingest
+            std::map<std::string, std::string> rows;
+            for (auto& kv : data) {
+                rows[std::move(kv.first)] = std::move(kv.second);
+            }
+            std::vector<kvstore::KV> sorted(std::make_move_iterator(rows.begin()),
+                                            std::make_move_iterator(rows.end()));
+            auto code = env_->kvstore_->writeBulkSst(spaceId_, partId, sorted);
+            handleAsync(spaceId_, partId, code);
+            continue;
+        }
         if (indexes_.empty()) {
-            doPut(spaceId_, partId, std::move(data));
+            if (FLAGS_mutate_dedup_window > 0) {
+                // Retries carry the same rows under fresh versions, so
+                // hashing the version-stripped keys plus the encoded
+                // rows gives the retry the id of its first attempt and
+                // the part skips the re-apply
+                uint64_t dedupId = folly::hash::fnv64_buf(&partId, sizeof(partId));
+                kvstore::BatchHolder batchHolder;
+                for (auto& kv : data) {
+                    auto stripped = NebulaKeyUtils::keyWithNoVersion(kv.first);
+                    dedupId = folly::hash::fnv64_buf(stripped.data(), stripped.size(), dedupId);
+                    dedupId = folly::hash::fnv64_buf(kv.second.data(), kv.second.size(), dedupId);
+                    batchHolder.put(std::move(kv.first), std::move(kv.second));
+                }
+                auto callback = [partId, this](kvstore::ResultCode code) {
+                    handleAsync(spaceId_, partId, code);
+                };
+                env_->kvstore_->asyncAppendBatch(
+                    spaceId_, partId,
+                    kvstore::encodeDedupBatch(dedupId, batchHolder.getBatch()),
+                    std::move(callback));
+            } else {
+                doPut(spaceId_, partId, std::move(data));
+            }
         } else {
             auto atomic = [partId, vertices = std::move(data), this]()
                           -> folly::Optional<std::string> {
@@ -175,10 +224,17 @@ AddVerticesProcessor::addVertices(PartitionID partId,
                  * step 2 , Insert new vertex index
                  */
                 if (nReader == nullptr) {
-                    nReader = RowReader::getTagPropReader(this->env_->schemaMan_,
-                                                          spaceId_,
-                                                          tagId,
-                                                          v.second);
+                    // rows of this request were encoded against the
+                    // pinned schema, so its reader applies directly
+                    const auto* schema = findPinnedTagSchema(tagId);
+                    if (schema != nullptr) {
+                        nReader = RowReader::getRowReader(schema, v.second);
+                    } else {
+                        nReader = RowReader::getTagPropReader(this->env_->schemaMan_,
+                                                              spaceId_,
+                                                              tagId,
+                                                              v.second);
+                    }
                     if (nReader == nullptr) {
                         LOG(ERROR) << "Bad format row";
                         return folly::none;
@@ -8,6 +8,8 @@
 #include <algorithm>
 #include "utils/NebulaKeyUtils.h"
 #include "utils/IndexKeyUtils.h"
+#include "storage/MergeOperator.h"
+#include "storage/StorageFlags.h"
 
 namespace nebula {
 namespace storage {
@@ -37,12 +39,14 @@ void DeleteEdgesProcessor::process(const cpp2::DeleteEdgesRequest& req) {
 
     CHECK_NOTNULL(env_->kvstore_);
     if (indexes_.empty()) {
-        // Operate every part, the graph layer guarantees the unique of the edgeKey
-        std::vector<std::string> keys;
-        keys.reserve(32);
+        // Operate every part, the graph layer guarantees the unique of the edgeKey.
+        // Every edge becomes one range tombstone covering all its versions, so
+        // there is no need to read the versions back before deleting them
         for (auto& part : partEdges) {
             auto partId = part.first;
-            keys.clear();
+            std::vector<kvstore::KV> ranges;
+            ranges.reserve(part.second.size());
+            std::map<std::pair<VertexID, EdgeType>, int64_t> degreeDeltas;
             for (auto& edgeKey : part.second) {
                 if (!NebulaKeyUtils::isValidVidLen(spaceVidLen_, edgeKey.src, edgeKey.dst)) {
                     LOG(ERROR) << "Space " << spaceId_ << " vertex length invalid, "
@@ -66,22 +70,35 @@ void DeleteEdgesProcessor::process(const cpp2::DeleteEdgesRequest& req) {
                                                    edgeKey.ranking,
                                                    edgeKey.dst,
                                                    std::numeric_limits<int64_t>::max());
-                std::unique_ptr<kvstore::KVIterator> iter;
-                auto retRes = env_->kvstore_->range(spaceId_, partId, start, end, &iter);
-                if (retRes != kvstore::ResultCode::SUCCEEDED) {
-                    VLOG(3) << "Error! ret = " << static_cast<int32_t>(retRes)
-                            << ", spaceID " << spaceId_;
-                    this->handleErrorCode(retRes, spaceId_, partId);
-                    this->onFinished();
-                    return;
+                ranges.emplace_back(std::move(start), std::move(end));
+                if (FLAGS_enable_edge_degree_counter) {
+                    degreeDeltas[std::make_pair(edgeKey.src, edgeKey.edge_type)]--;
+                }
+            }
+            if (FLAGS_enable_edge_degree_counter) {
+                // The decrements must commit with the tombstones, so
+                // both ride one batch. Deleting an absent edge still
+                // decrements; the counters are approximate, like the
+                // degree cache they feed
+                kvstore::BatchHolder batchHolder;
+                for (auto& range : ranges) {
+                    batchHolder.rangeRemove(std::move(range.first), std::move(range.second));
                 }
-                while (iter && iter->valid()) {
-                    auto key = iter->key();
-                    keys.emplace_back(key.data(), key.size());
-                    iter->next();
+                for (const auto& delta : degreeDeltas) {
+                    batchHolder.merge(NebulaKeyUtils::systemDegreeKey(partId,
+                                                                      delta.first.first,
+                                                                      delta.first.second),
+                                      encodeCounterDelta(delta.second));
                 }
+                auto callback = [partId, this](kvstore::ResultCode code) {
+                    handleAsync(spaceId_, partId, code);
+                };
+                env_->kvstore_->asyncAppendBatch(spaceId_, partId,
+                                                 kvstore::encodeBatchValue(batchHolder.getBatch()),
+                                                 std::move(callback));
+            } else {
+                doRemoveRange(spaceId_, partId, std::move(ranges));
             }
-            doRemove(spaceId_, partId, keys);
         }
     } else {
         std::for_each(partEdges.begin(), partEdges.end(), [this](auto &part) {
@@ -103,6 +120,10 @@ folly::Optional<std::string>
 DeleteEdgesProcessor::deleteEdges(PartitionID partId,
                                   const std::vector<cpp2::EdgeKey>& edges) {
     std::unique_ptr<kvstore::BatchHolder> batchHolder = std::make_unique<kvstore::BatchHolder>();
+    std::map<std::pair<VertexID, EdgeType>, int64_t> degreeDeltas;
+    // Local to this part's op: the ops of different parts may run on
+    // different raft threads concurrently
+    SchemaVerCache schemaCache;
     for (auto& edge : edges) {
         auto type = edge.edge_type;
         auto srcId = edge.src;
@@ -130,7 +151,8 @@ DeleteEdgesProcessor::deleteEdges(PartitionID partId,
                             reader = RowReader::getEdgePropReader(this->env_->schemaMan_,
                                                                   spaceId_,
                                                                   type,
-                                                                  iter->val());
+                                                                  iter->val(),
+                                                                  &schemaCache);
                             if (reader == nullptr) {
                                 LOG(WARNING) << "Bad format row!";
                                 return folly::none;
@@ -158,6 +180,17 @@ DeleteEdgesProcessor::deleteEdges(PartitionID partId,
             batchHolder->remove(iter->key().str());
             iter->next();
         }
+        // The scan told us whether the edge was there, so only edges
+        // that existed decrement their counter
+        if (FLAGS_enable_edge_degree_counter && !isLatestVE) {
+            degreeDeltas[std::make_pair(srcId, type)]--;
+        }
+    }
+    for (const auto& delta : degreeDeltas) {
+        batchHolder->merge(NebulaKeyUtils::systemDegreeKey(partId,
+                                                           delta.first.first,
+                                                           delta.first.second),
+                           encodeCounterDelta(delta.second));
     }
     return encodeBatchValue(batchHolder->getBatch());
 }
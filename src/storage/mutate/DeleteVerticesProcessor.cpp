@@ -36,16 +36,32 @@ void DeleteVerticesProcessor::process(const cpp2::DeleteVerticesRequest& req) {
     }
 
     CHECK_NOTNULL(env_->kvstore_);
+    // With range tombstones no scan tells us which tags a vertex
+    // carries, so evict every (vid, tag) pair of the space; evicting
+    // an absent entry is a no-op
+    if (FLAGS_enable_vertex_cache && vertexCache_ != nullptr) {
+        auto tags = env_->schemaMan_->getAllVerTagSchema(spaceId_);
+        if (tags.ok()) {
+            for (auto& part : partVertices) {
+                for (auto& vid : part.second) {
+                    for (auto& tag : tags.value()) {
+                        vertexCache_->evict(std::make_pair(vid, tag.first), part.first);
+                    }
+                }
+            }
+        }
+    }
+
     if (indexes_.empty()) {
-        // Operate every part, the graph layer guarantees the unique of the vid
-        std::vector<std::string> keys;
-        keys.reserve(32);
+        // Operate every part, the graph layer guarantees the unique of the vid.
+        // Each vertex becomes one range tombstone over its whole key span, so
+        // the delete does not read or enumerate anything, however many tags,
+        // versions or leftover out-edges sit under the vid
         for (auto& part : partVertices) {
             auto partId = part.first;
-            const auto& vertexIds = part.second;
-            keys.clear();
-
-            for (auto& vid : vertexIds) {
+            std::vector<kvstore::KV> ranges;
+            ranges.reserve(part.second.size());
+            for (auto& vid : part.second) {
                 if (!NebulaKeyUtils::isValidVidLen(spaceVidLen_, vid)) {
                     LOG(ERROR) << "Space " << spaceId_ << ", vertex length invalid, "
                                << " space vid len: " << spaceVidLen_ << ",  vid is " << vid;
@@ -53,33 +69,11 @@ void DeleteVerticesProcessor::process(const cpp2::DeleteVerticesRequest& req) {
                     onFinished();
                     return;
                 }
-
-                auto prefix = NebulaKeyUtils::vertexPrefix(spaceVidLen_, partId, vid);
-                std::unique_ptr<kvstore::KVIterator> iter;
-                auto retRes = env_->kvstore_->prefix(spaceId_, partId, prefix, &iter);
-                if (retRes != kvstore::ResultCode::SUCCEEDED) {
-                    VLOG(3) << "Error! ret = " << static_cast<int32_t>(retRes)
-                            << ", spaceID " << spaceId_;
-                    this->handleErrorCode(retRes, spaceId_, partId);
-                    this->onFinished();
-                    return;
-                }
-                while (iter->valid()) {
-                    auto key = iter->key();
-                    if (NebulaKeyUtils::isVertex(spaceVidLen_, key)) {
-                        auto tagId = NebulaKeyUtils::getTagId(spaceVidLen_, key);
-                        // Evict vertices from cache
-                        if (FLAGS_enable_vertex_cache && vertexCache_ != nullptr) {
-                            VLOG(3) << "Evict vertex cache for VID " << vid
-                                    << ", TagID " << tagId;
-                            vertexCache_->evict(std::make_pair(vid, tagId), partId);
-                        }
-                        keys.emplace_back(key.str());
-                    }
-                    iter->next();
-                }
+                auto start = NebulaKeyUtils::vertexPrefix(spaceVidLen_, partId, vid);
+                auto end = NebulaKeyUtils::prefixNext(start);
+                ranges.emplace_back(std::move(start), std::move(end));
             }
-            doRemove(spaceId_, partId, keys);
+            doRemoveRange(spaceId_, partId, std::move(ranges));
         }
     } else {
         std::for_each(req.parts.begin(), req.parts.end(), [this](auto &pv) {
@@ -103,76 +97,62 @@ folly::Optional<std::string>
 DeleteVerticesProcessor::deleteVertices(PartitionID partId,
                                         const std::vector<VertexID>& vertices) {
     std::unique_ptr<kvstore::BatchHolder> batchHolder = std::make_unique<kvstore::BatchHolder>();
+    // Group the indexes by tag, so each vertex probes only the tags
+    // actually carrying an index instead of scanning its whole key span
+    std::unordered_map<TagID, std::vector<std::shared_ptr<nebula::meta::cpp2::IndexItem>>>
+        indexesByTag;
+    for (auto& index : indexes_) {
+        indexesByTag[index->get_schema_id().get_tag_id()].emplace_back(index);
+    }
+
+    // Local to this part's op: the ops of different parts may run on
+    // different raft threads concurrently
+    SchemaVerCache schemaCache;
     for (auto& vertex : vertices) {
-        auto prefix = NebulaKeyUtils::vertexPrefix(spaceVidLen_, partId, vertex);
-        std::unique_ptr<kvstore::KVIterator> iter;
-        auto ret = this->env_->kvstore_->prefix(this->spaceId_, partId, prefix, &iter);
-        if (ret != kvstore::ResultCode::SUCCEEDED) {
-            VLOG(3) << "Error! ret = " << static_cast<int32_t>(ret)
-                    << ", spaceId " << spaceId_;
-            return folly::none;
-        }
-        TagID latestVVId = -1;
-        while (iter->valid()) {
-            auto key = iter->key();
-            auto tagId = NebulaKeyUtils::getTagId(spaceVidLen_, key);
-            if (FLAGS_enable_vertex_cache && vertexCache_ != nullptr) {
-                if (NebulaKeyUtils::isVertex(spaceVidLen_, key)) {
-                    VLOG(3) << "Evict vertex cache for vertex ID " << vertex << ", tagId " << tagId;
-                    vertexCache_->evict(std::make_pair(vertex, tagId), partId);
-                }
+        for (auto& entry : indexesByTag) {
+            auto tagId = entry.first;
+            auto prefix = NebulaKeyUtils::vertexPrefix(spaceVidLen_, partId, vertex, tagId);
+            std::unique_ptr<kvstore::KVIterator> iter;
+            auto ret = this->env_->kvstore_->prefix(this->spaceId_, partId, prefix, &iter);
+            if (ret != kvstore::ResultCode::SUCCEEDED) {
+                VLOG(3) << "Error! ret = " << static_cast<int32_t>(ret)
+                        << ", spaceId " << spaceId_;
+                return folly::none;
             }
-
-            /**
-            * example ,the prefix result as below :
-            *     V1_tag1_version3
-            *     V1_tag1_version2
-             *     V1_tag1_version1
-             *     V1_tag2_version3
-             *     V1_tag2_version2
-             *     V1_tag2_version1
-             *     V1_tag3_version3
-             *     V1_tag3_version2
-             *     V1_tag3_version1
-             * Because index depends on latest version of tag.
-             * So only V1_tag1_version3, V1_tag2_version3 and V1_tag3_version3 are needed,
-             * Using newlyVertexId to identify if it is the latest version
-             */
-            if (latestVVId != tagId) {
-                std::unique_ptr<RowReader> reader;
-                for (auto& index : indexes_) {
-                    auto indexId = index->get_index_id();
-                    if (index->get_schema_id().get_tag_id() == tagId) {
-                        if (reader == nullptr) {
-                            reader = RowReader::getTagPropReader(this->env_->schemaMan_,
-                                                                 spaceId_,
-                                                                 tagId,
-                                                                 iter->val());
-                            if (reader == nullptr) {
-                                LOG(WARNING) << "Bad format row";
-                                return folly::none;
-                            }
-                        }
-                        std::vector<Value::Type> colsType;
-                        const auto& cols = index->get_fields();
-                        auto values = IndexKeyUtils::collectIndexValues(reader.get(),
-                                                                        cols, colsType);
-                        if (!values.ok()) {
-                            continue;
-                        }
-                        auto indexKey = IndexKeyUtils::vertexIndexKey(spaceVidLen_, partId,
-                                                                      indexId,
-                                                                      vertex,
-                                                                      values.value(),
-                                                                      colsType);
-                        batchHolder->remove(std::move(indexKey));
-                    }
+            if (!iter || !iter->valid()) {
+                continue;
+            }
+            // Index entries track the latest version of the tag, which
+            // sorts first under the prefix
+            auto reader = RowReader::getTagPropReader(this->env_->schemaMan_,
+                                                      spaceId_,
+                                                      tagId,
+                                                      iter->val(),
+                                                      &schemaCache);
+            if (reader == nullptr) {
+                LOG(WARNING) << "Bad format row";
+                return folly::none;
+            }
+            for (auto& index : entry.second) {
+                std::vector<Value::Type> colsType;
+                auto values = IndexKeyUtils::collectIndexValues(reader.get(),
+                                                                index->get_fields(),
+                                                                colsType);
+                if (!values.ok()) {
+                    continue;
                 }
-                latestVVId = tagId;
+                auto indexKey = IndexKeyUtils::vertexIndexKey(spaceVidLen_, partId,
+                                                              index->get_index_id(),
+                                                              vertex,
+                                                              values.value(),
+                                                              colsType);
+                batchHolder->remove(std::move(indexKey));
             }
-            batchHolder->remove(key.str());
-            iter->next();
         }
+        // One tombstone drops every tag, every version, in one op
+        auto start = NebulaKeyUtils::vertexPrefix(spaceVidLen_, partId, vertex);
+        auto end = NebulaKeyUtils::prefixNext(start);
+        batchHolder->rangeRemove(std::move(start), std::move(end));
     }
     return encodeBatchValue(batchHolder->getBatch());
 }
@@ -0,0 +1,345 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "storage/mutate/EdgeTxCoordinator.h"
+#include "common/time/WallClock.h"
+#include <folly/synchronization/Baton.h>
+#include "utils/NebulaKeyUtils.h"
+#include "kvstore/LogEncoder.h"
+
+namespace nebula {
+namespace storage {
+
+namespace {
+
+constexpr char kTxPrepared = 0x01;
+constexpr char kTxCommitted = 0x02;
+
+// Leave records of transactions younger than this alone: they may
+// still be in flight and their coordinator decides, not the resolver
+constexpr int64_t kResolveAfterUs = 5 * 1000 * 1000;
+
+void appendInt32(std::string& buf, int32_t v) {
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(int32_t));
+}
+
+// Record value: state byte, coordinator part, the participant list,
+// and the data keys the prepare of this part wrote
+std::string encodeRecord(char state,
+                         PartitionID coordPart,
+                         const std::vector<PartitionID>& parts,
+                         const std::vector<kvstore::KV>& data) {
+    std::string val;
+    val.append(1, state);
+    appendInt32(val, coordPart);
+    appendInt32(val, static_cast<int32_t>(parts.size()));
+    for (auto partId : parts) {
+        appendInt32(val, partId);
+    }
+    appendInt32(val, static_cast<int32_t>(data.size()));
+    for (const auto& kv : data) {
+        appendInt32(val, static_cast<int32_t>(kv.first.size()));
+        val.append(kv.first);
+    }
+    return val;
+}
+
+struct TxRecord {
+    char state;
+    PartitionID coordPart;
+    std::vector<PartitionID> parts;
+    std::vector<std::string> keys;
+};
+
+bool decodeRecord(folly::StringPiece val, TxRecord& rec) {
+    size_t offset = 0;
+    auto readI32 = [&val, &offset] (int32_t& out) {
+        if (offset + sizeof(int32_t) > val.size()) {
+            return false;
+        }
+        out = readInt<int32_t>(val.data() + offset, sizeof(int32_t));
+        offset += sizeof(int32_t);
+        return true;
+    };
+    if (val.empty()) {
+        return false;
+    }
+    rec.state = val[0];
+    offset = 1;
+    if (!readI32(rec.coordPart)) {
+        return false;
+    }
+    int32_t numParts = 0;
+    if (!readI32(numParts) || numParts < 0) {
+        return false;
+    }
+    rec.parts.reserve(numParts);
+    for (int32_t i = 0; i < numParts; i++) {
+        PartitionID partId;
+        if (!readI32(partId)) {
+            return false;
+        }
+        rec.parts.emplace_back(partId);
+    }
+    int32_t numKeys = 0;
+    if (!readI32(numKeys) || numKeys < 0) {
+        return false;
+    }
+    rec.keys.reserve(numKeys);
+    for (int32_t i = 0; i < numKeys; i++) {
+        int32_t len = 0;
+        if (!readI32(len) || len < 0 || offset + len > val.size()) {
+            return false;
+        }
+        rec.keys.emplace_back(val.data() + offset, len);
+        offset += len;
+    }
+    return true;
+}
+
+int64_t newTxId() {
+    static std::atomic<uint16_t> seq{0};
+    return (time::WallClock::fastNowInMicroSec() << 16)
+            | seq.fetch_add(1, std::memory_order_relaxed);
+}
+
+folly::Future<kvstore::ResultCode> applyBatch(kvstore::KVStore* store,
+                                              GraphSpaceID spaceId,
+                                              PartitionID partId,
+                                              std::string batch) {
+    folly::Promise<kvstore::ResultCode> pro;
+    auto fut = pro.getFuture();
+    store->asyncAppendBatch(spaceId, partId, std::move(batch),
+                            [pro = std::move(pro)] (kvstore::ResultCode code) mutable {
+        pro.setValue(code);
+    });
+    return fut;
+}
+
+kvstore::ResultCode applyBatchSync(kvstore::KVStore* store,
+                                   GraphSpaceID spaceId,
+                                   PartitionID partId,
+                                   std::string batch) {
+    kvstore::ResultCode result;
+    folly::Baton<true, std::atomic> baton;
+    store->asyncAppendBatch(spaceId, partId, std::move(batch),
+                            [&result, &baton] (kvstore::ResultCode code) {
+        result = code;
+        baton.post();
+    });
+    baton.wait();
+    return result;
+}
+
+}  // anonymous namespace
+
+folly::Future<kvstore::ResultCode> EdgeTxCoordinator::commit(kvstore::KVStore* store,
+                                                             GraphSpaceID spaceId,
+                                                             std::vector<Participant> parts) {
+    CHECK_GT(parts.size(), 1UL);
+    std::vector<PartitionID> partIds;
+    partIds.reserve(parts.size());
+    for (const auto& part : parts) {
+        partIds.emplace_back(part.partId);
+    }
+    auto coordPart = *std::min_element(partIds.begin(), partIds.end());
+    // Heal what older crashes left on these parts before piling a new
+    // transaction on top; with no dangling records this is one empty
+    // prefix seek per part
+    for (auto partId : partIds) {
+        resolvePart(store, spaceId, partId);
+    }
+    auto txId = newTxId();
+
+    std::vector<folly::Future<kvstore::ResultCode>> prepares;
+    prepares.reserve(parts.size());
+    // The undo of each part's prepare, applied on rollback; the
+    // resolver rebuilds the same thing from the record if we crash
+    auto undoBatches = std::make_shared<std::unordered_map<PartitionID, std::string>>();
+    for (auto& part : parts) {
+        auto record = encodeRecord(kTxPrepared, coordPart, partIds, part.data);
+        kvstore::BatchHolder prepare;
+        kvstore::BatchHolder undo;
+        for (auto& kv : part.data) {
+            undo.remove(std::string(kv.first));
+            prepare.put(std::move(kv.first), std::move(kv.second));
+        }
+        undo.remove(NebulaKeyUtils::systemEdgeTxKey(part.partId, txId));
+        prepare.put(NebulaKeyUtils::systemEdgeTxKey(part.partId, txId), std::move(record));
+        (*undoBatches)[part.partId] = kvstore::encodeBatchValue(undo.getBatch());
+        prepares.emplace_back(applyBatch(store, spaceId, part.partId,
+                                         kvstore::encodeBatchValue(prepare.getBatch())));
+    }
+
+    return folly::collectAll(prepares).thenValue(
+            [store, spaceId, coordPart, txId, partIds = std::move(partIds), undoBatches]
+            (std::vector<folly::Try<kvstore::ResultCode>>&& tries) mutable
+                    -> folly::Future<kvstore::ResultCode> {
+        auto failed = kvstore::ResultCode::SUCCEEDED;
+        for (const auto& t : tries) {
+            if (t.value() != kvstore::ResultCode::SUCCEEDED) {
+                failed = t.value();
+                break;
+            }
+        }
+        if (failed != kvstore::ResultCode::SUCCEEDED) {
+            // Roll back the parts that did prepare; a part whose
+            // prepare failed wrote nothing, its batch is atomic. Best
+            // effort - whatever this misses the resolver aborts later
+            for (size_t i = 0; i < tries.size(); i++) {
+                if (tries[i].value() == kvstore::ResultCode::SUCCEEDED) {
+                    applyBatch(store, spaceId, partIds[i],
+                               std::move((*undoBatches)[partIds[i]]));
+                }
+            }
+            return failed;
+        }
+        // The commit point: flip the coordinator record. The committed
+        // record drops its key list, committed data is never undone
+        kvstore::BatchHolder flip;
+        flip.put(NebulaKeyUtils::systemEdgeTxKey(coordPart, txId),
+                 encodeRecord(kTxCommitted, coordPart, partIds, {}));
+        return applyBatch(store, spaceId, coordPart,
+                          kvstore::encodeBatchValue(flip.getBatch()))
+            .thenValue([store, spaceId, coordPart, txId, partIds = std::move(partIds)]
+                       (kvstore::ResultCode code) -> kvstore::ResultCode {
+                if (code != kvstore::ResultCode::SUCCEEDED) {
+                    // Prepared everywhere but the decision never made
+                    // it down; the resolver aborts the leftovers
+                    return code;
+                }
+                // Clean up participants first, the coordinator record
+                // last, so a leftover prepared record always finds the
+                // decision it needs. Best effort again
+                std::vector<folly::Future<kvstore::ResultCode>> cleanups;
+                for (auto partId : partIds) {
+                    if (partId == coordPart) {
+                        continue;
+                    }
+                    kvstore::BatchHolder drop;
+                    drop.remove(NebulaKeyUtils::systemEdgeTxKey(partId, txId));
+                    cleanups.emplace_back(applyBatch(store, spaceId, partId,
+                                                     kvstore::encodeBatchValue(drop.getBatch())));
+                }
+                folly::collectAll(cleanups).thenValue(
+                        [store, spaceId, coordPart, txId]
+                        (std::vector<folly::Try<kvstore::ResultCode>>&& results) {
+                    for (const auto& t : results) {
+                        if (t.value() != kvstore::ResultCode::SUCCEEDED) {
+                            return;
+                        }
+                    }
+                    kvstore::BatchHolder drop;
+                    drop.remove(NebulaKeyUtils::systemEdgeTxKey(coordPart, txId));
+                    applyBatch(store, spaceId, coordPart,
+                               kvstore::encodeBatchValue(drop.getBatch()));
+                });
+                return kvstore::ResultCode::SUCCEEDED;
+            });
+    });
+}
+
+kvstore::ResultCode EdgeTxCoordinator::resolvePart(kvstore::KVStore* store,
+                                                   GraphSpaceID spaceId,
+                                                   PartitionID partId) {
+    auto prefix = NebulaKeyUtils::systemEdgeTxPrefix(partId);
+    std::unique_ptr<kvstore::KVIterator> iter;
+    auto ret = store->prefix(spaceId, partId, prefix, &iter);
+    if (ret != kvstore::ResultCode::SUCCEEDED) {
+        return ret;
+    }
+    auto nowUs = time::WallClock::fastNowInMicroSec();
+    for (; iter->valid(); iter->next()) {
+        auto key = iter->key();
+        auto txId = readInt<int64_t>(key.data() + kSystemLen, sizeof(int64_t));
+        if (nowUs - (txId >> 16) < kResolveAfterUs) {
+            continue;
+        }
+        TxRecord rec;
+        if (!decodeRecord(iter->val(), rec)) {
+            LOG(ERROR) << "Corrupt edge tx record of space " << spaceId
+                       << ", part " << partId << ", tx " << txId;
+            continue;
+        }
+        if (rec.state == kTxCommitted) {
+            // A crash mid-cleanup left the decision behind. It may only
+            // go once no participant still points at it, so retry their
+            // cleanup here and keep the decision if any is out of reach
+            bool allGone = true;
+            for (auto part : rec.parts) {
+                if (part == partId) {
+                    continue;
+                }
+                std::string value;
+                auto code = store->get(spaceId, part,
+                                       NebulaKeyUtils::systemEdgeTxKey(part, txId), &value);
+                if (code == kvstore::ResultCode::ERR_KEY_NOT_FOUND) {
+                    continue;
+                }
+                if (code == kvstore::ResultCode::SUCCEEDED) {
+                    kvstore::BatchHolder drop;
+                    drop.remove(NebulaKeyUtils::systemEdgeTxKey(part, txId));
+                    code = applyBatchSync(store, spaceId, part,
+                                          kvstore::encodeBatchValue(drop.getBatch()));
+                    if (code == kvstore::ResultCode::SUCCEEDED) {
+                        continue;
+                    }
+                }
+                allGone = false;
+            }
+            if (allGone) {
+                kvstore::BatchHolder drop;
+                drop.remove(key.str());
+                applyBatchSync(store, spaceId, partId,
+                               kvstore::encodeBatchValue(drop.getBatch()));
+            }
+            continue;
+        }
+        // A prepared record: committed only if the coordinator says so.
+        // The decision outlives every participant record, so a missing
+        // or still-prepared coordinator record means the transaction
+        // never committed and this part's writes are undone
+        bool committed = false;
+        if (rec.coordPart != partId) {
+            std::string value;
+            auto code = store->get(spaceId, rec.coordPart,
+                                   NebulaKeyUtils::systemEdgeTxKey(rec.coordPart, txId),
+                                   &value);
+            if (code == kvstore::ResultCode::SUCCEEDED) {
+                committed = !value.empty() && value[0] == kTxCommitted;
+            } else if (code != kvstore::ResultCode::ERR_KEY_NOT_FOUND) {
+                // The coordinator part is not readable from here, leave
+                // the record for a resolver that can reach it
+                VLOG(1) << "Cannot reach coordinator part " << rec.coordPart
+                        << " of edge tx " << txId << ", error code "
+                        << static_cast<int32_t>(code);
+                continue;
+            }
+        }
+        kvstore::BatchHolder undo;
+        if (!committed) {
+            for (auto& dataKey : rec.keys) {
+                undo.remove(std::move(dataKey));
+            }
+        }
+        undo.remove(key.str());
+        auto code = applyBatchSync(store, spaceId, partId,
+                                   kvstore::encodeBatchValue(undo.getBatch()));
+        if (code != kvstore::ResultCode::SUCCEEDED) {
+            LOG(ERROR) << "Failed to resolve edge tx " << txId << " of space "
+                       << spaceId << ", part " << partId << ", error code "
+                       << static_cast<int32_t>(code);
+        } else {
+            LOG(INFO) << "Resolved edge tx " << txId << " of space " << spaceId
+                      << ", part " << partId
+                      << (committed ? ", kept its writes" : ", undid its writes");
+        }
+    }
+    return kvstore::ResultCode::SUCCEEDED;
+}
+
+}  // namespace storage
+}  // namespace nebula
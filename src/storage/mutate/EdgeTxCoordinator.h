@@ -0,0 +1,63 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef STORAGE_MUTATE_EDGETXCOORDINATOR_H_
+#define STORAGE_MUTATE_EDGETXCOORDINATOR_H_
+
+#include "common/base/Base.h"
+#include <folly/futures/Future.h>
+#include "kvstore/KVStore.h"
+
+namespace nebula {
+namespace storage {
+
+/**
+ * Lightweight two-part commit for edge writes spanning several parts of
+ * one request, typically an edge and its reverse edge. Prepare runs on
+ * all participants in parallel: each part commits its edge data plus an
+ * in-flight record through one raft round. Once every prepare succeeded
+ * the coordinator part - the lowest participating part - flips its own
+ * record to committed, which is the commit point, and the records are
+ * then cleaned up participants first, coordinator last.
+ *
+ * Crash resolution keys off that order: a prepared record whose
+ * coordinator record says committed only needs its cleanup retried,
+ * while one whose coordinator record is still prepared, or already
+ * gone, belongs to a transaction that never committed, and the data
+ * keys it lists are removed again. Every record carries the keys its
+ * prepare wrote, so the undo needs no replay, and the versioned edge
+ * keys make it restore whatever version was current before.
+ *
+ * Every participant has to be led by this host - the client only
+ * routes a part here when it is - and resolution equally only touches
+ * local parts, skipping what it cannot reach.
+ * */
+class EdgeTxCoordinator final {
+public:
+    EdgeTxCoordinator() = delete;
+
+    struct Participant {
+        PartitionID partId;
+        std::vector<kvstore::KV> data;
+    };
+
+    // Commit the participants' data atomically, prepares running in
+    // parallel. All-or-nothing: the returned code applies to every part
+    static folly::Future<kvstore::ResultCode> commit(kvstore::KVStore* store,
+                                                     GraphSpaceID spaceId,
+                                                     std::vector<Participant> parts);
+
+    // Resolve the dangling transactions the part is still a participant
+    // or coordinator of; commit() runs it on every participant first,
+    // so a restarted host heals on its next atomic write
+    static kvstore::ResultCode resolvePart(kvstore::KVStore* store,
+                                           GraphSpaceID spaceId,
+                                           PartitionID partId);
+};
+
+}  // namespace storage
+}  // namespace nebula
+#endif  // STORAGE_MUTATE_EDGETXCOORDINATOR_H_
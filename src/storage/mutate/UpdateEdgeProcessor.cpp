@@ -132,7 +132,8 @@ StoragePlan<cpp2::EdgeKey> UpdateEdgeProcessor::buildPlan(nebula::DataSet* resul
                                                        updatedProps_,
                                                        filterNode.get(),
                                                        insertable_,
-                                                       expCtx_.get());
+                                                       expCtx_.get(),
+                                                       edgeUpdate.get());
     updateNode->addDependency(filterNode.get());
 
     auto resultNode = std::make_unique<UpdateResNode<cpp2::EdgeKey>>(planContext_.get(),
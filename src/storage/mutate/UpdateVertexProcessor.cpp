@@ -55,6 +55,8 @@ void UpdateVertexProcessor::process(const cpp2::UpdateVertexRequest& req) {
         indexes_ = std::move(iRet).value();
     }
 
+    buildMergeIncrements();
+
     VLOG(3) << "Update vertex, spaceId: " << spaceId_
             << ", partId: " << partId << ", vId: " << vId;
     auto plan = buildPlan(&resultDataSet_);
@@ -129,7 +131,8 @@ StoragePlan<VertexID> UpdateVertexProcessor::buildPlan(nebula::DataSet* result)
                                                       updatedProps_,
                                                       filterNode.get(),
                                                       insertable_,
-                                                      expCtx_.get());
+                                                      expCtx_.get(),
+                                                      mergeIncrements_);
     updateNode->addDependency(filterNode.get());
 
     auto resultNode = std::make_unique<UpdateResNode<VertexID>>(planContext_.get(),
@@ -145,6 +148,62 @@ StoragePlan<VertexID> UpdateVertexProcessor::buildPlan(nebula::DataSet* result)
     return plan;
 }
 
+void UpdateVertexProcessor::buildMergeIncrements() {
+    mergeIncrements_.clear();
+    if (!FLAGS_enable_merge_update || insertable_ || filterExp_ != nullptr
+            || !returnPropsExp_.empty() || !indexes_.empty()
+            || tagContext_.ttlInfo_.count(tagId_) != 0) {
+        return;
+    }
+    auto schemaIter = tagContext_.schemas_.find(tagId_);
+    if (schemaIter == tagContext_.schemas_.end() || schemaIter->second.empty()) {
+        return;
+    }
+    const auto* schema = schemaIter->second.back().get();
+    auto tagNameRet = env_->schemaMan_->toTagName(spaceId_, tagId_);
+    if (!tagNameRet.ok()) {
+        return;
+    }
+    const auto& tagName = tagNameRet.value();
+
+    std::vector<std::pair<std::string, int64_t>> increments;
+    for (auto& prop : updatedProps_) {
+        auto updateExp = Expression::decode(prop.get_value());
+        if (!updateExp || updateExp->kind() != Expression::Kind::kAdd) {
+            return;
+        }
+        auto* addExp = static_cast<const ArithmeticExpression*>(updateExp.get());
+        // Accept both prop + constant and constant + prop
+        auto* left = addExp->left();
+        auto* right = addExp->right();
+        if (left->kind() == Expression::Kind::kConstant) {
+            std::swap(left, right);
+        }
+        if (left->kind() != Expression::Kind::kSrcProperty
+                || right->kind() != Expression::Kind::kConstant) {
+            return;
+        }
+        auto* propExp = static_cast<const SourcePropertyExpression*>(left);
+        if (*propExp->sym() != tagName || *propExp->prop() != prop.get_name()) {
+            return;
+        }
+        const auto& delta = static_cast<const ConstantExpression*>(right)->value();
+        if (delta.type() != Value::Type::INT) {
+            return;
+        }
+        // Patches add in place at a fixed offset, so the field must be
+        // a fixed-size integer without a NULL bit
+        auto field = schema->field(prop.get_name());
+        if (field == nullptr || field->nullable()
+                || field->type() != meta::cpp2::PropertyType::INT64) {
+            return;
+        }
+        increments.emplace_back(prop.get_name(), delta.getInt());
+    }
+    mergeIncrements_ = std::move(increments);
+}
+
+
 // Get all tag schema in spaceID
 cpp2::ErrorCode UpdateVertexProcessor::buildTagSchema() {
     auto tags = env_->schemaMan_->getAllVerTagSchema(spaceId_);
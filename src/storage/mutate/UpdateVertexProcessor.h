@@ -42,6 +42,14 @@ private:
     // filter expression, update props expression
     cpp2::ErrorCode buildTagContext(const cpp2::UpdateVertexRequest& req);
 
+    // Fill mergeIncrements_ when every updated prop is a plain
+    // increment (prop = prop + constant) on a non-nullable INT64 field
+    // of the latest schema and nothing else constrains the update (no
+    // condition, no returned props, no indexes, no TTL, not an upsert).
+    // Such updates go through the merge operator instead of the
+    // serialized read-modify-write in UpdateTagNode
+    void buildMergeIncrements();
+
     void onProcessFinished() override;
 
     std::vector<Expression*> getReturnPropsExp() {
@@ -70,6 +78,10 @@ private:
 
     // condition expression
     std::unique_ptr<Expression>                                     filterExp_;
+
+    // <prop name, delta> per updated prop when the update qualifies
+    // for the merge fast path, empty otherwise
+    std::vector<std::pair<std::string, int64_t>>                    mergeIncrements_;
 };
 
 }  // namespace storage
@@ -5,6 +5,9 @@
  */
 
 #include "storage/query/GetNeighborsProcessor.h"
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+#include "kvstore/IoAccounting.h"
+#include "storage/ReaderLanes.h"
 #include "storage/StorageFlags.h"
 #include "storage/exec/TagNode.h"
 #include "storage/exec/EdgeNode.h"
@@ -26,7 +29,43 @@ void GetNeighborsProcessor::process(const cpp2::GetNeighborsRequest& req) {
         onFinished();
         return;
     }
+    if (resultCache_ != nullptr && !req.get_parts().empty()) {
+        // The key is the serialized request, so a hit is byte-identical
+        // by construction and hashes of different requests cannot alias
+        apache::thrift::CompactSerializer::serialize(req, &cacheKey_);
+        cacheHint_ = req.get_parts().begin()->first;
+        auto hit = resultCache_->get(cacheKey_, cacheHint_);
+        if (hit.ok()) {
+            auto entry = std::move(hit).value();
+            if (time::WallClock::fastNowInMicroSec() - entry->producedUs <=
+                    FLAGS_neighbors_result_cache_ttl_ms * 1000L) {
+                resp_.set_vertices(entry->dataset);
+                onFinished();
+                return;
+            }
+            // Expired entries stay until the insert below replaces
+            // them; the TTL check keeps them from being served
+        }
+    }
     planContext_ = std::make_unique<PlanContext>(env_, spaceId_, spaceVidLen_);
+    if (FLAGS_query_deadline_us > 0) {
+        planContext_->deadlineUs_ =
+            time::WallClock::fastNowInMicroSec() + FLAGS_query_deadline_us;
+    }
+    edgeContext_.degreeCache_ = degreeCache_;
+    // Pin one read snapshot for the whole plan, so the tag and edge
+    // scans of this request all observe the same state
+    snapshot_ = env_->kvstore_->beginSnapshot(spaceId_);
+    planContext_->snapshot_ = snapshot_.get();
+    planContext_->memQuota_ = &memQuota_;
+    if (FLAGS_neighbor_prefetch_limit > 0) {
+        prefetchVids_.reserve(FLAGS_neighbor_prefetch_limit);
+        planContext_->prefetchVids_ = &prefetchVids_;
+        prefetchParts_.reserve(req.get_parts().size());
+        for (const auto& partEntry : req.get_parts()) {
+            prefetchParts_.emplace_back(partEntry.first);
+        }
+    }
     expCtx_ = std::make_unique<StorageExpressionContext>(spaceVidLen_);
 
     retCode = checkAndBuildContexts(req);
@@ -47,29 +86,181 @@ void GetNeighborsProcessor::process(const cpp2::GetNeighborsRequest& req) {
         }
     }
 
-    auto plan = buildPlan(&resultDataSet_, limit, random);
-    std::unordered_set<PartitionID> failedParts;
+    if (lanes_ != nullptr) {
+        // Shard-per-core mode: every part runs on the single lane
+        // thread that owns it, even when the request has one part
+        runConcurrently(req, limit, random);
+        return;
+    }
+    if (FLAGS_query_concurrently && executor_ != nullptr && req.get_parts().size() > 1) {
+        runConcurrently(req, limit, random);
+        return;
+    }
+    if (FLAGS_query_offload_execution && executor_ != nullptr) {
+        runOffloaded(req, limit, random);
+        return;
+    }
+
+    auto plan = buildPlan(planContext_.get(), expCtx_.get(), filter_.get(),
+                          &resultDataSet_, limit, random);
+    plan.maybeProfile();
     for (const auto& partEntry : req.get_parts()) {
         auto partId = partEntry.first;
+        std::vector<VertexID> input;
+        input.reserve(partEntry.second.size());
         for (const auto& row : partEntry.second) {
             CHECK_GE(row.values.size(), 1);
-            auto vId = row.values[0].getStr();
-
             // the first column of each row would be the vertex id
-            auto ret = plan.go(partId, vId);
-            if (ret != kvstore::ResultCode::SUCCEEDED) {
-                if (failedParts.find(partId) == failedParts.end()) {
-                    failedParts.emplace(partId);
-                    handleErrorCode(ret, spaceId_, partId);
-                }
-            }
+            input.emplace_back(row.values[0].getStr());
+        }
+        auto startUs = time::WallClock::fastNowInMicroSec();
+        kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+        auto ret = plan.go(partId, input);
+        planContext_->blockReads_ += io.blockReads();
+        planContext_->blockReadBytes_ += io.blockReadBytes();
+        auto partUs = time::WallClock::fastNowInMicroSec() - startUs;
+        if (partUs > planContext_->slowestPartUs_) {
+            planContext_->slowestPartUs_ = partUs;
+            planContext_->slowestPart_ = partId;
+        }
+        if (ret != kvstore::ResultCode::SUCCEEDED) {
+            handleErrorCode(ret, spaceId_, partId);
         }
     }
+    planProfile_ = plan.profileDesc();
     onProcessFinished();
     onFinished();
 }
 
-StoragePlan<VertexID> GetNeighborsProcessor::buildPlan(nebula::DataSet* result,
+void GetNeighborsProcessor::runOffloaded(const cpp2::GetNeighborsRequest& req,
+                                         int64_t limit,
+                                         bool random) {
+    // The task may outlive the request, so it owns a copy of the input;
+    // the contexts are members and live until onFinished()
+    std::vector<std::pair<PartitionID, std::vector<VertexID>>> parts;
+    parts.reserve(req.get_parts().size());
+    for (const auto& partEntry : req.get_parts()) {
+        std::vector<VertexID> input;
+        input.reserve(partEntry.second.size());
+        for (const auto& row : partEntry.second) {
+            CHECK_GE(row.values.size(), 1);
+            input.emplace_back(row.values[0].getStr());
+        }
+        parts.emplace_back(partEntry.first, std::move(input));
+    }
+    executor_->add([this, limit, random, parts = std::move(parts)] () {
+        auto plan = buildPlan(planContext_.get(), expCtx_.get(), filter_.get(),
+                              &resultDataSet_, limit, random);
+        plan.maybeProfile();
+        for (const auto& part : parts) {
+            auto startUs = time::WallClock::fastNowInMicroSec();
+            kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+            auto ret = plan.go(part.first, part.second);
+            planContext_->blockReads_ += io.blockReads();
+            planContext_->blockReadBytes_ += io.blockReadBytes();
+            auto partUs = time::WallClock::fastNowInMicroSec() - startUs;
+            if (partUs > planContext_->slowestPartUs_) {
+                planContext_->slowestPartUs_ = partUs;
+                planContext_->slowestPart_ = part.first;
+            }
+            if (ret != kvstore::ResultCode::SUCCEEDED) {
+                handleErrorCode(ret, spaceId_, part.first);
+            }
+        }
+        planProfile_ = plan.profileDesc();
+        onProcessFinished();
+        onFinished();
+    });
+}
+
+void GetNeighborsProcessor::runConcurrently(const cpp2::GetNeighborsRequest& req,
+                                            int64_t limit,
+                                            bool random) {
+    // The tasks may outlive the request, so they own copies of their
+    // input
+    std::string filterStr;
+    if (req.traverse_spec.__isset.filter) {
+        filterStr = *req.traverse_spec.get_filter();
+    }
+    std::vector<folly::Future<folly::Unit>> futures;
+    for (const auto& partEntry : req.get_parts()) {
+        auto partId = partEntry.first;
+        std::vector<VertexID> input;
+        input.reserve(partEntry.second.size());
+        for (const auto& row : partEntry.second) {
+            CHECK_GE(row.values.size(), 1);
+            input.emplace_back(row.values[0].getStr());
+        }
+        auto* executor = lanes_ != nullptr ? lanes_->lane(spaceId_, partId) : executor_;
+        futures.emplace_back(folly::via(
+                executor,
+                [this, partId, limit, random, filterStr, input = std::move(input)] () {
+            // The plan nodes keep per-vertex state in their contexts,
+            // so every part runs its own plan over its own contexts;
+            // only the pinned snapshot and the result merge are shared
+            PlanContext planCtx(env_, spaceId_, spaceVidLen_);
+            planCtx.snapshot_ = snapshot_.get();
+            planCtx.deadlineUs_ = planContext_->deadlineUs_;
+            planCtx.memQuota_ = &memQuota_;
+            std::vector<VertexID> prefetchVids;
+            if (FLAGS_neighbor_prefetch_limit > 0) {
+                planCtx.prefetchVids_ = &prefetchVids;
+            }
+            StorageExpressionContext expCtx(spaceVidLen_);
+            std::unique_ptr<Expression> filter;
+            if (!filterStr.empty()) {
+                filter = Expression::decode(filterStr);
+            }
+            nebula::DataSet dataSet;
+            dataSet.colNames = resultDataSet_.colNames;
+            auto plan = buildPlan(&planCtx, &expCtx, filter.get(), &dataSet, limit, random);
+            plan.maybeProfile();
+            auto startUs = time::WallClock::fastNowInMicroSec();
+            kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+            auto ret = plan.go(partId, input);
+            planCtx.blockReads_ = io.blockReads();
+            planCtx.blockReadBytes_ = io.blockReadBytes();
+            auto partUs = time::WallClock::fastNowInMicroSec() - startUs;
+            std::lock_guard<std::mutex> lg(lock_);
+            if (ret != kvstore::ResultCode::SUCCEEDED) {
+                handleErrorCode(ret, spaceId_, partId);
+            }
+            auto room = static_cast<int64_t>(FLAGS_neighbor_prefetch_limit)
+                      - static_cast<int64_t>(prefetchVids_.size());
+            if (room > 0 && !prefetchVids.empty()) {
+                auto taken = std::min(prefetchVids.size(), static_cast<size_t>(room));
+                prefetchVids_.insert(prefetchVids_.end(),
+                                     std::make_move_iterator(prefetchVids.begin()),
+                                     std::make_move_iterator(prefetchVids.begin() + taken));
+            }
+            planContext_->engineCalls_ += planCtx.engineCalls_;
+            planContext_->keysScanned_ += planCtx.keysScanned_;
+            planContext_->staleVersionsSkipped_ += planCtx.staleVersionsSkipped_;
+            planContext_->bytesRead_ += planCtx.bytesRead_;
+            planContext_->blockReads_ += planCtx.blockReads_;
+            planContext_->blockReadBytes_ += planCtx.blockReadBytes_;
+            if (partUs > planContext_->slowestPartUs_) {
+                planContext_->slowestPartUs_ = partUs;
+                planContext_->slowestPart_ = partId;
+            }
+            if (!plan.profileDesc().empty()) {
+                planProfile_ = plan.profileDesc();
+            }
+            resultDataSet_.rows.insert(resultDataSet_.rows.end(),
+                                       std::make_move_iterator(dataSet.rows.begin()),
+                                       std::make_move_iterator(dataSet.rows.end()));
+        }));
+    }
+    folly::collectAll(futures).thenValue([this] (auto&&) {
+        onProcessFinished();
+        onFinished();
+    });
+}
+
+StoragePlan<VertexID> GetNeighborsProcessor::buildPlan(PlanContext* planCtx,
+                                                       StorageExpressionContext* expCtx,
+                                                       Expression* filter,
+                                                       nebula::DataSet* result,
                                                        int64_t limit,
                                                        bool random) {
     /*
@@ -94,47 +285,59 @@ StoragePlan<VertexID> GetNeighborsProcessor::buildPlan(nebula::DataSet* result,
     +------------------+        +------------------+
     */
     StoragePlan<VertexID> plan;
+    // tag and edge scan nodes plus hash join, filter, aggregate, output
+    plan.reserve(tagContext_.propContexts_.size() + edgeContext_.propContexts_.size() + 4);
     std::vector<TagNode*> tags;
+    tags.reserve(tagContext_.propContexts_.size());
     for (const auto& tc : tagContext_.propContexts_) {
         auto tag = std::make_unique<TagNode>(
-                planContext_.get(), &tagContext_, tc.first, &tc.second);
+                planCtx, &tagContext_, tc.first, &tc.second);
         tags.emplace_back(tag.get());
         plan.addNode(std::move(tag));
     }
     std::vector<EdgeNode<VertexID>*> edges;
+    edges.reserve(edgeContext_.propContexts_.size());
+    // The limit can only stop the edge scans early when every scanned
+    // edge makes it into the response: a filter drops edges mid-stream,
+    // and the sampler has to see the whole stream to stay uniform. A
+    // sampled scan of a vertex whose approximate degree is known may
+    // instead skip to pre-drawn positions of the range
+    int64_t pushedLimit = filter == nullptr && !random ? limit : 0;
+    bool sample = filter == nullptr && random;
     for (const auto& ec : edgeContext_.propContexts_) {
         auto edge = std::make_unique<SingleEdgeNode>(
-                planContext_.get(), &edgeContext_, ec.first, &ec.second);
+                planCtx, &edgeContext_, ec.first, &ec.second, expCtx, filter,
+                sample ? limit : pushedLimit, sample);
         edges.emplace_back(edge.get());
         plan.addNode(std::move(edge));
     }
 
     auto hashJoin = std::make_unique<HashJoinNode>(
-            planContext_.get(), tags, edges, &tagContext_, &edgeContext_, expCtx_.get());
+            planCtx, tags, edges, &tagContext_, &edgeContext_, expCtx);
     for (auto* tag : tags) {
         hashJoin->addDependency(tag);
     }
     for (auto* edge : edges) {
         hashJoin->addDependency(edge);
     }
-    auto filter = std::make_unique<FilterNode<VertexID>>(
-            planContext_.get(), hashJoin.get(), expCtx_.get(), filter_.get());
-    filter->addDependency(hashJoin.get());
+    auto filterNode = std::make_unique<FilterNode<VertexID>>(
+            planCtx, hashJoin.get(), expCtx, filter);
+    filterNode->addDependency(hashJoin.get());
     auto agg = std::make_unique<AggregateNode<VertexID>>(
-            planContext_.get(), filter.get(), &edgeContext_);
-    agg->addDependency(filter.get());
+            planCtx, filterNode.get(), &edgeContext_);
+    agg->addDependency(filterNode.get());
     std::unique_ptr<GetNeighborsNode> output;
     if (random) {
         output = std::make_unique<GetNeighborsSampleNode>(
-                planContext_.get(), hashJoin.get(), agg.get(), &edgeContext_, result, limit);
+                planCtx, hashJoin.get(), agg.get(), &edgeContext_, result, limit);
     } else {
         output = std::make_unique<GetNeighborsNode>(
-                planContext_.get(), hashJoin.get(), agg.get(), &edgeContext_, result, limit);
+                planCtx, hashJoin.get(), agg.get(), &edgeContext_, result, limit);
     }
     output->addDependency(agg.get());
 
     plan.addNode(std::move(hashJoin));
-    plan.addNode(std::move(filter));
+    plan.addNode(std::move(filterNode));
     plan.addNode(std::move(agg));
     plan.addNode(std::move(output));
     return plan;
@@ -357,7 +560,67 @@ cpp2::ErrorCode GetNeighborsProcessor::checkStatType(const meta::SchemaProviderI
 }
 
 void GetNeighborsProcessor::onProcessFinished() {
+    CommonUtils::recordEngineCalls(planContext_->engineCalls_);
+    maybeLogSlowQuery("GetNeighbors", resultDataSet_.rows.size(), planProfile_);
+    if (resultCache_ != nullptr && !cacheKey_.empty() && codes_.empty()) {
+        // Only complete results are worth repeating; a failed or
+        // truncated one would pin its errors for a whole TTL window
+        auto entry = std::make_shared<CachedNeighborsResult>();
+        entry->dataset = resultDataSet_;
+        entry->producedUs = time::WallClock::fastNowInMicroSec();
+        resultCache_->insert(std::move(cacheKey_), std::move(entry), cacheHint_);
+    }
     resp_.set_vertices(std::move(resultDataSet_));
+    maybePrefetchNeighbors();
+}
+
+void GetNeighborsProcessor::maybePrefetchNeighbors() {
+    if (prefetchVids_.empty() || prefetchParts_.empty() || executor_ == nullptr) {
+        return;
+    }
+    // A hub neighbor shows up once per source vertex, warm it once
+    std::sort(prefetchVids_.begin(), prefetchVids_.end());
+    prefetchVids_.erase(std::unique(prefetchVids_.begin(), prefetchVids_.end()),
+                        prefetchVids_.end());
+    auto* env = env_;
+    auto spaceId = spaceId_;
+    auto vIdLen = spaceVidLen_;
+    executor_->add([env, spaceId, vIdLen,
+                    parts = std::move(prefetchParts_),
+                    vids = std::move(prefetchVids_)] {
+        // how many records of one vertex to touch: enough to fault the
+        // data block of the vertex in, not a full scan of a supernode
+        constexpr int32_t kPrefetchRecordsPerVertex = 4;
+        auto deadline =
+            time::WallClock::fastNowInMicroSec() + FLAGS_neighbor_prefetch_budget_us;
+        for (const auto& vId : vids) {
+            if (time::WallClock::fastNowInMicroSec() > deadline) {
+                return;
+            }
+            if (vId.size() > vIdLen) {
+                continue;
+            }
+            // The neighbor's owning part is not derivable here - the
+            // vid hashing lives in the clients - so seek it in each
+            // part of this request until found. A seek in a part not
+            // holding the vertex stops at the sst index and prefix
+            // bloom level; neighbors hosted elsewhere miss everywhere
+            // within the budget
+            for (auto partId : parts) {
+                auto prefix = NebulaKeyUtils::vertexPrefix(vIdLen, partId, vId);
+                std::unique_ptr<kvstore::KVIterator> iter;
+                // followers warm too, the read never leaves this host
+                auto ret = env->kvstore_->prefix(spaceId, partId, prefix, &iter, true);
+                if (ret != kvstore::ResultCode::SUCCEEDED || !iter->valid()) {
+                    continue;
+                }
+                for (int32_t i = 0; iter->valid() && i < kPrefetchRecordsPerVertex;
+                     iter->next(), i++) {
+                }
+                break;
+            }
+        }
+    });
 }
 
 }  // namespace storage
@@ -15,6 +15,8 @@
 namespace nebula {
 namespace storage {
 
+class ReaderLanes;
+
 class GetNeighborsProcessor
     : public QueryBaseProcessor<cpp2::GetNeighborsRequest, cpp2::GetNeighborsResponse> {
     FRIEND_TEST(ScanEdgePropBench, EdgeTypePrefixScanVsVertexPrefixScan);
@@ -22,8 +24,13 @@ class GetNeighborsProcessor
 public:
     static GetNeighborsProcessor* instance(StorageEnv* env,
                                            stats::Stats* stats,
-                                           VertexCache* cache) {
-        return new GetNeighborsProcessor(env, stats, cache);
+                                           VertexCache* cache,
+                                           folly::Executor* executor = nullptr,
+                                           DegreeCache* degreeCache = nullptr,
+                                           ReaderLanes* lanes = nullptr,
+                                           NeighborsResultCache* resultCache = nullptr) {
+        return new GetNeighborsProcessor(env, stats, cache, executor, degreeCache, lanes,
+                                         resultCache);
     }
 
     void process(const cpp2::GetNeighborsRequest& req) override;
@@ -31,14 +38,40 @@ public:
 protected:
     GetNeighborsProcessor(StorageEnv* env,
                           stats::Stats* stats,
-                          VertexCache* cache)
+                          VertexCache* cache,
+                          folly::Executor* executor,
+                          DegreeCache* degreeCache,
+                          ReaderLanes* lanes,
+                          NeighborsResultCache* resultCache)
         : QueryBaseProcessor<cpp2::GetNeighborsRequest,
-                             cpp2::GetNeighborsResponse>(env, stats, cache) {}
+                             cpp2::GetNeighborsResponse>(env, stats, cache)
+        , executor_(executor)
+        , degreeCache_(degreeCache)
+        , lanes_(lanes)
+        , resultCache_(resultCache) {}
 
-    StoragePlan<VertexID> buildPlan(nebula::DataSet* result,
+    StoragePlan<VertexID> buildPlan(PlanContext* planCtx,
+                                    StorageExpressionContext* expCtx,
+                                    Expression* filter,
+                                    nebula::DataSet* result,
                                     int64_t limit = 0,
                                     bool random = false);
 
+    // Run every part of the request as its own task on executor_, or
+    // on the part's owning lane in shard-per-core mode, each over its
+    // own plan, merging the per-part results into resultDataSet_ once
+    // all parts have finished
+    void runConcurrently(const cpp2::GetNeighborsRequest& req,
+                         int64_t limit,
+                         bool random);
+
+    // Run the whole request as one task on executor_, part after part
+    // over a single plan, so the thrift worker that decoded it goes
+    // back to dispatching
+    void runOffloaded(const cpp2::GetNeighborsRequest& req,
+                      int64_t limit,
+                      bool random);
+
     void onProcessFinished() override;
 
     cpp2::ErrorCode checkAndBuildContexts(const cpp2::GetNeighborsRequest& req) override;
@@ -54,8 +87,40 @@ protected:
     cpp2::ErrorCode checkStatType(const meta::SchemaProviderIf::Field* field,
                                   cpp2::StatType statType);
 
+    // Warm the vertex blocks of the collected neighbors on executor_
+    // after the response is on its way, so the next hop of the
+    // traversal finds them in cache. The task owns its inputs; the
+    // processor is gone by the time it runs
+    void maybePrefetchNeighbors();
+
 private:
     std::unique_ptr<StorageExpressionContext> expCtx_;
+    // Per-node summary of the sampled plan of this request, empty
+    // unless --profile_plan_every_n picked it; the slow-query log
+    // attaches it
+    std::string planProfile_;
+    // Runs the per-part tasks of a concurrent request; null when the
+    // request should run inline
+    folly::Executor* executor_{nullptr};
+    // Approximate out-degrees for the sampling pushdown; null when the
+    // degree-aware sampling is disabled
+    DegreeCache* degreeCache_{nullptr};
+    // Part-pinned lanes of the shard-per-core mode; when set, every
+    // part of the request runs on the lane thread owning it instead of
+    // executor_
+    ReaderLanes* lanes_{nullptr};
+    // Neighbors collected for the post-response block warming, bounded
+    // by --neighbor_prefetch_limit, and the parts of this request as
+    // the candidate locations to seek them in
+    std::vector<VertexID> prefetchVids_;
+    std::vector<PartitionID> prefetchParts_;
+    // Recent results served to byte-identical requests; null when
+    // --neighbors_result_cache_ttl_ms is off
+    NeighborsResultCache* resultCache_{nullptr};
+    // The serialized request, doubling as the cache key; empty when
+    // this request does not take part in the result cache
+    std::string cacheKey_;
+    PartitionID cacheHint_{0};
 };
 
 }  // namespace storage
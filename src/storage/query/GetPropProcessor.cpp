@@ -5,6 +5,9 @@
  */
 
 #include "storage/query/GetPropProcessor.h"
+#include "codec/RowDecodePlan.h"
+#include "kvstore/IoAccounting.h"
+#include "storage/StorageFlags.h"
 #include "storage/exec/GetPropNode.h"
 
 namespace nebula {
@@ -21,6 +24,14 @@ void GetPropProcessor::process(const cpp2::GetPropRequest& req) {
         return;
     }
     planContext_ = std::make_unique<PlanContext>(env_, spaceId_, spaceVidLen_);
+    if (FLAGS_query_deadline_us > 0) {
+        planContext_->deadlineUs_ =
+            time::WallClock::fastNowInMicroSec() + FLAGS_query_deadline_us;
+    }
+    // Pin one read snapshot for the whole plan, so the tag and edge
+    // scans of this request all observe the same state
+    snapshot_ = env_->kvstore_->beginSnapshot(spaceId_);
+    planContext_->snapshot_ = snapshot_.get();
 
     retCode = checkAndBuildContexts(req);
     if (retCode != cpp2::ErrorCode::SUCCEEDED) {
@@ -31,54 +42,287 @@ void GetPropProcessor::process(const cpp2::GetPropRequest& req) {
         return;
     }
 
-    std::unordered_set<PartitionID> failedParts;
+    if (!isEdge_ && existsOnly_) {
+        runExistenceCheck(req);
+        onProcessFinished();
+        onFinished();
+        return;
+    }
+
+    if (!isEdge_ && tagContext_.propContexts_.size() == 1) {
+        runSingleTagFetch(req);
+        onProcessFinished();
+        onFinished();
+        return;
+    }
+
     if (!isEdge_) {
         auto plan = buildTagPlan(&resultDataSet_);
+        plan.maybeProfile();
         for (const auto& partEntry : req.get_parts()) {
             auto partId = partEntry.first;
+            std::vector<VertexID> input;
+            input.reserve(partEntry.second.size());
             for (const auto& row : partEntry.second) {
-                auto vId = row.values[0].getStr();
-                auto ret = plan.go(partId, vId);
-                if (ret != kvstore::ResultCode::SUCCEEDED &&
-                    failedParts.find(partId) == failedParts.end()) {
-                    failedParts.emplace(partId);
-                    handleErrorCode(ret, spaceId_, partId);
-                }
+                input.emplace_back(row.values[0].getStr());
+            }
+            auto startUs = time::WallClock::fastNowInMicroSec();
+            kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+            auto ret = plan.go(partId, input);
+            planContext_->blockReads_ += io.blockReads();
+            planContext_->blockReadBytes_ += io.blockReadBytes();
+            auto partUs = time::WallClock::fastNowInMicroSec() - startUs;
+            if (partUs > planContext_->slowestPartUs_) {
+                planContext_->slowestPartUs_ = partUs;
+                planContext_->slowestPart_ = partId;
+            }
+            if (ret != kvstore::ResultCode::SUCCEEDED) {
+                handleErrorCode(ret, spaceId_, partId);
             }
         }
+        planProfile_ = plan.profileDesc();
     } else {
         auto plan = buildEdgePlan(&resultDataSet_);
+        plan.maybeProfile();
         for (const auto& partEntry : req.get_parts()) {
             auto partId = partEntry.first;
+            std::vector<cpp2::EdgeKey> input;
+            input.reserve(partEntry.second.size());
             for (const auto& row : partEntry.second) {
                 cpp2::EdgeKey edgeKey;
                 edgeKey.src = row.values[0].getStr();
                 edgeKey.edge_type = row.values[1].getInt();
                 edgeKey.ranking = row.values[2].getInt();
                 edgeKey.dst = row.values[3].getStr();
-                auto ret = plan.go(partId, edgeKey);
-                if (ret != kvstore::ResultCode::SUCCEEDED &&
-                    failedParts.find(partId) == failedParts.end()) {
-                    failedParts.emplace(partId);
-                    handleErrorCode(ret, spaceId_, partId);
-                }
+                input.emplace_back(std::move(edgeKey));
+            }
+            auto startUs = time::WallClock::fastNowInMicroSec();
+            kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+            auto ret = plan.go(partId, input);
+            planContext_->blockReads_ += io.blockReads();
+            planContext_->blockReadBytes_ += io.blockReadBytes();
+            auto partUs = time::WallClock::fastNowInMicroSec() - startUs;
+            if (partUs > planContext_->slowestPartUs_) {
+                planContext_->slowestPartUs_ = partUs;
+                planContext_->slowestPart_ = partId;
+            }
+            if (ret != kvstore::ResultCode::SUCCEEDED) {
+                handleErrorCode(ret, spaceId_, partId);
             }
         }
+        planProfile_ = plan.profileDesc();
     }
     onProcessFinished();
     onFinished();
 }
 
+// Hydrating N known vertices from one tag does not need the plan
+// machinery: check the vertex cache, otherwise seek the tag prefix and
+// take the first record, which is the latest version. An exact-key
+// MultiGet is not possible because the key embeds the write-time
+// version, so the per-vertex read stays a prefix seek
+void GetPropProcessor::runSingleTagFetch(const cpp2::GetPropRequest& req) {
+    kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+    SCOPE_EXIT {
+        planContext_->blockReads_ += io.blockReads();
+        planContext_->blockReadBytes_ += io.blockReadBytes();
+    };
+    auto tagId = tagContext_.propContexts_.front().first;
+    const auto* props = &tagContext_.propContexts_.front().second;
+    const auto& schemas = tagContext_.schemas_[tagId];
+    auto ttl = QueryUtils::getTagTTLInfo(&tagContext_, tagId);
+
+    std::unique_ptr<RowDecodePlan> decodePlan;
+    if (FLAGS_enable_vertex_cache && tagContext_.vertexCache_ != nullptr) {
+        decodePlan = std::make_unique<RowDecodePlan>(schemas.back().get());
+    }
+    std::string prefix;
+    for (const auto& partEntry : req.get_parts()) {
+        auto partId = partEntry.first;
+        for (const auto& inputRow : partEntry.second) {
+            const auto& vId = inputRow.values[0].getStr();
+            folly::StringPiece rawVal;
+            std::shared_ptr<const CachedTagRow> cacheEntry;
+            std::unique_ptr<kvstore::KVIterator> iter;
+            bool found = false;
+            if (FLAGS_enable_vertex_cache && tagContext_.vertexCache_ != nullptr) {
+                auto result = tagContext_.vertexCache_->get(std::make_pair(vId, tagId), partId);
+                if (result.ok()) {
+                    cacheEntry = std::move(result).value();
+                    rawVal = cacheEntry->row;
+                    found = true;
+                }
+            }
+            if (!found) {
+                NebulaKeyUtils::vertexPrefixTo(prefix, spaceVidLen_, partId, vId, tagId);
+                planContext_->engineCalls_++;
+                auto code = env_->kvstore_->prefix(spaceId_, partId, prefix, &iter, false,
+                                                   kvstore::ScanHint::DEFAULT,
+                                                   planContext_->snapshot_);
+                if (code != kvstore::ResultCode::SUCCEEDED) {
+                    handleErrorCode(code, spaceId_, partId);
+                    break;
+                }
+                if (iter && iter->valid()) {
+                    rawVal = iter->val();
+                    found = true;
+                }
+            }
+
+            std::unique_ptr<RowReader> reader;
+            if (found) {
+                if (cacheEntry != nullptr) {
+                    // serve the read from the decoded fields when we still
+                    // hold the schema the row was decoded against
+                    for (const auto& schema : schemas) {
+                        if (schema->getVersion() == cacheEntry->ver) {
+                            reader = std::make_unique<CachedRowReader>(schema.get(),
+                                                                       cacheEntry.get());
+                            break;
+                        }
+                    }
+                }
+                if (!reader) {
+                    reader = RowReader::getRowReader(schemas, rawVal);
+                }
+                if (!reader) {
+                    planContext_->resultStat_ = ResultStatus::ILLEGAL_DATA;
+                    found = false;
+                } else if (ttl.hasValue() &&
+                           CommonUtils::checkDataExpiredForTTL(schemas.back().get(),
+                                                               reader.get(),
+                                                               ttl.value().first,
+                                                               ttl.value().second)) {
+                    found = false;
+                } else if (cacheEntry == nullptr &&
+                           FLAGS_enable_vertex_cache && tagContext_.vertexCache_ != nullptr) {
+                    auto cached = std::make_shared<CachedTagRow>();
+                    cached->row = rawVal.str();
+                    cached->ver = reader->schemaVer();
+                    auto numFields = reader->numFields();
+                    cached->decoded.reserve(numFields);
+                    if (!decodePlan->decode(cached->row, cached->decoded)) {
+                        // an older schema version, decode through the reader
+                        for (size_t i = 0; i < numFields; i++) {
+                            cached->decoded.emplace_back(reader->getValueByIndex(i));
+                        }
+                    }
+                    tagContext_.vertexCache_->insert(std::make_pair(vId, tagId),
+                                                     std::move(cached), partId);
+                }
+            }
+
+            std::vector<Value> row;
+            row.reserve(resultDataSet_.colNames.size());
+            // vertexId is the first column
+            row.emplace_back(vId);
+            if (!found) {
+                // same shape as the plan path: a missing or expired tag
+                // row yields null cells
+                for (const auto& prop : *props) {
+                    if (prop.returned_) {
+                        row.emplace_back(NullType::__NULL__);
+                    }
+                }
+            } else {
+                auto ret = kvstore::ResultCode::SUCCEEDED;
+                for (const auto& prop : *props) {
+                    auto status = QueryUtils::readValue(reader.get(), prop);
+                    if (!status.ok()) {
+                        ret = kvstore::ResultCode::ERR_TAG_PROP_NOT_FOUND;
+                        break;
+                    }
+                    if (prop.returned_) {
+                        row.emplace_back(std::move(status).value());
+                    }
+                }
+                if (ret != kvstore::ResultCode::SUCCEEDED) {
+                    handleErrorCode(ret, spaceId_, partId);
+                    break;
+                }
+            }
+            resultDataSet_.rows.emplace_back(std::move(row));
+        }
+    }
+}
+
+// The upsert probe of the graph layer: whether each vertex carries the
+// requested tags, not what their rows say. The per-part existence
+// filter screens out definitely-absent vertices without an engine
+// call; present ones cost one prefix seek whose value is never
+// decoded, except for tags with TTL where expiry lives in the row
+void GetPropProcessor::runExistenceCheck(const cpp2::GetPropRequest& req) {
+    kvstore::IoAccountingScope io(FLAGS_enable_io_accounting);
+    SCOPE_EXIT {
+        planContext_->blockReads_ += io.blockReads();
+        planContext_->blockReadBytes_ += io.blockReadBytes();
+    };
+    std::string prefix;
+    for (const auto& partEntry : req.get_parts()) {
+        auto partId = partEntry.first;
+        for (const auto& inputRow : partEntry.second) {
+            const auto& vId = inputRow.values[0].getStr();
+            std::vector<Value> row;
+            row.reserve(resultDataSet_.colNames.size());
+            // vertexId is the first column
+            row.emplace_back(vId);
+            for (const auto& tc : tagContext_.propContexts_) {
+                auto tagId = tc.first;
+                auto ttl = QueryUtils::getTagTTLInfo(&tagContext_, tagId);
+                bool found = false;
+                if (!ttl.hasValue() &&
+                        FLAGS_enable_vertex_cache && tagContext_.vertexCache_ != nullptr) {
+                    found = tagContext_.vertexCache_->get(
+                            std::make_pair(vId, tagId), partId).ok();
+                }
+                if (!found) {
+                    NebulaKeyUtils::vertexPrefixTo(prefix, spaceVidLen_, partId, vId, tagId);
+                    if (env_->kvstore_->maybeExists(spaceId_, partId, prefix)) {
+                        std::unique_ptr<kvstore::KVIterator> iter;
+                        planContext_->engineCalls_++;
+                        auto code = env_->kvstore_->prefix(spaceId_, partId, prefix, &iter,
+                                                           false, kvstore::ScanHint::DEFAULT,
+                                                           planContext_->snapshot_);
+                        if (code != kvstore::ResultCode::SUCCEEDED) {
+                            handleErrorCode(code, spaceId_, partId);
+                            return;
+                        }
+                        if (iter && iter->valid()) {
+                            if (!ttl.hasValue()) {
+                                found = true;
+                            } else {
+                                const auto& schemas = tagContext_.schemas_[tagId];
+                                auto reader = RowReader::getRowReader(schemas, iter->val());
+                                found = reader != nullptr &&
+                                        !CommonUtils::checkDataExpiredForTTL(schemas.back().get(),
+                                                                             reader.get(),
+                                                                             ttl.value().first,
+                                                                             ttl.value().second);
+                            }
+                        }
+                    }
+                }
+                // one cell per tag, same shape as the plan path: the
+                // vid marks presence, null absence
+                row.emplace_back(found ? Value(vId) : Value(NullType::__NULL__));
+            }
+            resultDataSet_.rows.emplace_back(std::move(row));
+        }
+    }
+}
+
 StoragePlan<VertexID> GetPropProcessor::buildTagPlan(nebula::DataSet* result) {
     StoragePlan<VertexID> plan;
+    plan.reserve(tagContext_.propContexts_.size() + 1);
     std::vector<TagNode*> tags;
+    tags.reserve(tagContext_.propContexts_.size());
     for (const auto& tc : tagContext_.propContexts_) {
         auto tag = std::make_unique<TagNode>(
             planContext_.get(), &tagContext_, tc.first, &tc.second);
         tags.emplace_back(tag.get());
         plan.addNode(std::move(tag));
     }
-    auto output = std::make_unique<GetTagPropNode>(tags, result);
+    auto output = std::make_unique<GetTagPropNode>(tags, result, &memQuota_);
     for (auto* tag : tags) {
         output->addDependency(tag);
     }
@@ -88,14 +332,16 @@ StoragePlan<VertexID> GetPropProcessor::buildTagPlan(nebula::DataSet* result) {
 
 StoragePlan<cpp2::EdgeKey> GetPropProcessor::buildEdgePlan(nebula::DataSet* result) {
     StoragePlan<cpp2::EdgeKey> plan;
+    plan.reserve(edgeContext_.propContexts_.size() + 1);
     std::vector<EdgeNode<cpp2::EdgeKey>*> edges;
+    edges.reserve(edgeContext_.propContexts_.size());
     for (const auto& ec : edgeContext_.propContexts_) {
         auto edge = std::make_unique<FetchEdgeNode>(
             planContext_.get(), &edgeContext_, ec.first, &ec.second);
         edges.emplace_back(edge.get());
         plan.addNode(std::move(edge));
     }
-    auto output = std::make_unique<GetEdgePropNode>(edges, spaceVidLen_, result);
+    auto output = std::make_unique<GetEdgePropNode>(edges, spaceVidLen_, result, &memQuota_);
     for (auto* edge : edges) {
         output->addDependency(edge);
     }
@@ -163,6 +409,23 @@ cpp2::ErrorCode GetPropProcessor::buildTagContext(const cpp2::GetPropRequest& re
     if (ret != cpp2::ErrorCode::SUCCEEDED) {
         return ret;
     }
+    // The existence probe asks for "_vid" and nothing else; a request
+    // mixing it with value props has no path that can serve it
+    bool hasVidProp = false;
+    bool hasValueProp = false;
+    for (const auto& tc : tagContext_.propContexts_) {
+        for (const auto& prop : tc.second) {
+            if (prop.propInKeyType_ == PropContext::PropInKeyType::VID) {
+                hasVidProp = true;
+            } else {
+                hasValueProp = true;
+            }
+        }
+    }
+    if (hasVidProp && hasValueProp) {
+        return cpp2::ErrorCode::E_INVALID_OPERATION;
+    }
+    existsOnly_ = hasVidProp;
     buildTagTTLInfo();
     return cpp2::ErrorCode::SUCCEEDED;
 }
@@ -210,6 +473,8 @@ void GetPropProcessor::buildEdgeColName(const std::vector<cpp2::EdgeProp>& edgeP
 }
 
 void GetPropProcessor::onProcessFinished() {
+    CommonUtils::recordEngineCalls(planContext_->engineCalls_);
+    maybeLogSlowQuery("GetProp", resultDataSet_.rows.size(), planProfile_);
     resp_.set_props(std::move(resultDataSet_));
 }
 
@@ -35,6 +35,17 @@ protected:
 
     StoragePlan<VertexID> buildTagPlan(nebula::DataSet* result);
 
+    // Fast path for the point-lookup shape of the request: all requested
+    // props come from one tag, so each vertex needs exactly one latest
+    // tag row. Reads the row directly and skips plan construction
+    void runSingleTagFetch(const cpp2::GetPropRequest& req);
+
+    // Fast path for the existence-probe shape: every requested prop is
+    // the key-backed "_vid", so key presence answers the request and
+    // no value is decoded. One cell per tag, the vid for present, null
+    // for absent
+    void runExistenceCheck(const cpp2::GetPropRequest& req);
+
     StoragePlan<cpp2::EdgeKey> buildEdgePlan(nebula::DataSet* result);
 
     void onProcessFinished() override;
@@ -52,8 +63,14 @@ protected:
 
 private:
     bool isEdge_ = false;                   // true for edge, false for tag
+    // true when every requested prop is "_vid", the existence probe
+    bool existsOnly_ = false;
     std::unique_ptr<StorageExpressionContext> expCtx_;
     std::vector<std::unique_ptr<Expression>> yields_;
+    // Per-node summary of the sampled plan of this request, empty
+    // unless --profile_plan_every_n picked it; the slow-query log
+    // attaches it
+    std::string planProfile_;
 };
 
 }  // namespace storage
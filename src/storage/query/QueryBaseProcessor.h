@@ -33,6 +33,7 @@ public:
         TYPE = 0x02,
         RANK = 0x03,
         DST = 0x04,
+        VID = 0x05,
     };
 
     explicit PropContext(const char* name)
@@ -64,6 +65,8 @@ public:
             propInKeyType_ = PropContext::PropInKeyType::RANK;
         } else if (name_ == kDst) {
             propInKeyType_ = PropContext::PropInKeyType::DST;
+        } else if (name_ == kVid) {
+            propInKeyType_ = PropContext::PropInKeyType::VID;
         }
     }
 
@@ -77,6 +80,11 @@ public:
     std::string name_;
     // field info, e.g. nullable, default value
     const meta::SchemaProviderIf::Field* field_;
+    // field index and the schema version it was resolved against, so
+    // rows encoded at that version can be read by index instead of by
+    // a per-row name lookup. -1 when not resolved, e.g. key props
+    int64_t fieldIndex_ = -1;
+    SchemaVer schemaVer_ = -1;
     bool returned_ = false;
     bool filtered_ = false;
     // prop type in edge key, for srcId/dstId/type/rank
@@ -120,6 +128,9 @@ struct EdgeContext {
     // offset is the start index of first edge type in a response row
     size_t                                                              offset_;
     size_t                                                              statCount_ = 0;
+    // Approximate out-degree per (vertex, edgeType), null unless the
+    // degree-aware sampling of GetNeighbors is enabled
+    DegreeCache                                                        *degreeCache_ = nullptr;
 };
 
 template<typename REQ, typename RESP>
@@ -162,7 +173,8 @@ protected:
 
     void addReturnPropContext(std::vector<PropContext>& ctxs,
                               const char* propName,
-                              const meta::SchemaProviderIf::Field* field);
+                              const meta::SchemaProviderIf::Field* field,
+                              const meta::SchemaProviderIf* schema = nullptr);
 
     void addPropContextIfNotExists(
             std::vector<std::pair<SchemaID, std::vector<PropContext>>>& props,
@@ -34,12 +34,18 @@ cpp2::ErrorCode QueryBaseProcessor<REQ, RESP>::handleVertexProps(
         std::vector<PropContext> ctxs;
         if (!vertexProp.props.empty()) {
             for (const auto& name : vertexProp.props) {
+                if (name == kVid) {
+                    // The existence-probe shape: "_vid" is answered
+                    // from key presence alone, no row gets decoded
+                    ctxs.emplace_back(name.c_str(), nullptr, true, false);
+                    continue;
+                }
                 auto field = tagSchema->field(name);
                 if (field == nullptr) {
                     VLOG(1) << "Can't find prop " << name << " tagId " << tagId;
                     return cpp2::ErrorCode::E_TAG_PROP_NOT_FOUND;
                 }
-                addReturnPropContext(ctxs, name.c_str(), field);
+                addReturnPropContext(ctxs, name.c_str(), field, tagSchema.get());
             }
         } else {
             // if the list of property names is empty, then all properties on the given tag
@@ -49,7 +55,7 @@ cpp2::ErrorCode QueryBaseProcessor<REQ, RESP>::handleVertexProps(
                 auto name = tagSchema->getFieldName(i);
                 vertexProp.props.emplace_back(name);
                 auto field = tagSchema->field(i);
-                addReturnPropContext(ctxs, name, field);
+                addReturnPropContext(ctxs, name, field, tagSchema.get());
             }
         }
         tagContext_.propContexts_.emplace_back(tagId, std::move(ctxs));
@@ -86,7 +92,7 @@ cpp2::ErrorCode QueryBaseProcessor<REQ, RESP>::handleEdgeProps(
                         VLOG(1) << "Can't find prop " << name << " edgeType " << edgeType;
                         return cpp2::ErrorCode::E_EDGE_PROP_NOT_FOUND;
                     }
-                    addReturnPropContext(ctxs, name.c_str(), field);
+                    addReturnPropContext(ctxs, name.c_str(), field, edgeSchema.get());
                 } else {
                     addReturnPropContext(ctxs, name.c_str(), nullptr);
                 }
@@ -107,7 +113,7 @@ cpp2::ErrorCode QueryBaseProcessor<REQ, RESP>::handleEdgeProps(
                 auto name = edgeSchema->getFieldName(i);
                 edgeProp.props.emplace_back(name);
                 auto field = edgeSchema->field(i);
-                addReturnPropContext(ctxs, name, field);
+                addReturnPropContext(ctxs, name, field, edgeSchema.get());
             }
         }
         edgeContext_.propContexts_.emplace_back(edgeType, std::move(ctxs));
@@ -121,10 +127,15 @@ template <typename REQ, typename RESP>
 void QueryBaseProcessor<REQ, RESP>::addReturnPropContext(
         std::vector<PropContext>& ctxs,
         const char* propName,
-        const meta::SchemaProviderIf::Field* field) {
+        const meta::SchemaProviderIf::Field* field,
+        const meta::SchemaProviderIf* schema) {
     PropContext ctx(propName);
     ctx.returned_ = true;
     ctx.field_ = field;
+    if (field != nullptr && schema != nullptr) {
+        ctx.fieldIndex_ = schema->getFieldIndex(propName);
+        ctx.schemaVer_ = schema->getVersion();
+    }
     ctxs.emplace_back(std::move(ctx));
 }
 
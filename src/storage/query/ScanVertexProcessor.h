@@ -13,6 +13,13 @@
 namespace nebula {
 namespace storage {
 
+// NOTE: carried over from the 1.0 codebase and not part of the build -
+// it is not in CMakeLists.txt, no handler routes to it, and it still
+// uses the 1.0 row format and interface types. It scans exactly one
+// part per request, so a full-space export sequences the parts client
+// side and keeps one engine busy at a time; a port should take a set of
+// parts, stream interleaved batches with one scanner per engine and a
+// combined cursor, which also needs the scan interface reworked
 class ScanVertexProcessor
     : public BaseProcessor<cpp2::ScanVertexResponse> {
 public:
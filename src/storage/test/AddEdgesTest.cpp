@@ -12,6 +12,7 @@
 #include <gtest/gtest.h>
 #include <rocksdb/db.h>
 #include "storage/mutate/AddEdgesProcessor.h"
+#include "storage/mutate/EdgeTxCoordinator.h"
 #include "storage/test/TestUtils.h"
 #include "mock/MockCluster.h"
 #include "mock/MockData.h"
@@ -95,6 +96,73 @@ TEST(AddEdgesTest, MultiVersionTest) {
     checkAddEdgesData(req, env, 668, 2);
 }
 
+TEST(AddEdgesTest, AtomicTwoPartTest) {
+    fs::TempDir rootPath("/tmp/AddEdgesTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    GraphSpaceID spaceId = 1;
+
+    FLAGS_atomic_edge_writes = true;
+    {
+        LOG(INFO) << "Commit one request across all parts atomically...";
+        auto* processor = AddEdgesProcessor::instance(env, nullptr);
+        cpp2::AddEdgesRequest req = mock::MockData::mockAddEdgesReq();
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+        EXPECT_EQ(0, resp.result.failed_parts.size());
+        checkAddEdgesData(req, env, 334, 0);
+    }
+    {
+        LOG(INFO) << "The transaction records are cleaned up...";
+        // The cleanup runs after the response, so poll for it
+        for (PartitionID partId = 1; partId <= 6; partId++) {
+            bool gone = false;
+            for (int32_t retry = 0; retry < 50 && !gone; retry++) {
+                std::unique_ptr<kvstore::KVIterator> iter;
+                auto code = env->kvstore_->prefix(
+                    spaceId, partId, NebulaKeyUtils::systemEdgeTxPrefix(partId), &iter);
+                ASSERT_EQ(kvstore::ResultCode::SUCCEEDED, code);
+                gone = !iter->valid();
+                if (!gone) {
+                    usleep(50 * 1000);
+                }
+            }
+            EXPECT_TRUE(gone) << "dangling tx record on part " << partId;
+        }
+    }
+    {
+        LOG(INFO) << "A failing participant rolls the whole transaction back...";
+        auto key = NebulaKeyUtils::edgeKey(32, 1, "Tim Duncan", 101, 0, "Spurs", 0L);
+        std::vector<EdgeTxCoordinator::Participant> parts;
+        EdgeTxCoordinator::Participant good;
+        good.partId = 1;
+        good.data.emplace_back(key, "value");
+        parts.emplace_back(std::move(good));
+        EdgeTxCoordinator::Participant bad;
+        bad.partId = 999;
+        bad.data.emplace_back(NebulaKeyUtils::edgeKey(32, 999, "Spurs", -101,
+                                                      0, "Tim Duncan", 0L),
+                              "value");
+        parts.emplace_back(std::move(bad));
+        auto code = EdgeTxCoordinator::commit(env->kvstore_, spaceId, std::move(parts)).get();
+        EXPECT_NE(kvstore::ResultCode::SUCCEEDED, code);
+        // The rollback of the prepared part runs after the decision
+        bool gone = false;
+        for (int32_t retry = 0; retry < 50 && !gone; retry++) {
+            std::string value;
+            auto ret = env->kvstore_->get(spaceId, 1, key, &value);
+            gone = ret == kvstore::ResultCode::ERR_KEY_NOT_FOUND;
+            if (!gone) {
+                usleep(50 * 1000);
+            }
+        }
+        EXPECT_TRUE(gone) << "the prepared edge survived the rollback";
+    }
+    FLAGS_atomic_edge_writes = false;
+}
+
 }  // namespace storage
 }  // namespace nebula
 
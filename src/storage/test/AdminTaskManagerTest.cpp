@@ -31,6 +31,7 @@ namespace storage {
  * 6. cancel some sub task
  *      6.1 cancel_a_task_before_all_sub_task_running
  *      6.2 cancel_a_task_while_some_sub_task_running
+ * 7. pause a running task, check its queued sub tasks stay parked until resume
  * */
 
 // using ResultCode = nebula::kvstore::ResultCode;
@@ -757,6 +758,66 @@ TEST(TaskManagerTest, cancel_a_task_while_some_sub_task_running) {
     taskMgr->shutdown();
 }
 
+TEST(TaskManagerTest, pause_and_resume_a_running_task) {
+    auto taskMgr = AdminTaskManager::instance();
+    taskMgr->init();
+    int jobId = ++gJobId;
+
+    EXPECT_EQ(cpp2::ErrorCode::E_KEY_NOT_FOUND, taskMgr->pauseJob(jobId));
+    EXPECT_EQ(cpp2::ErrorCode::E_KEY_NOT_FOUND, taskMgr->resumeJob(jobId));
+
+    folly::Promise<ResultCode> pFinish;
+    folly::Future<ResultCode> fFinish = pFinish.getFuture();
+
+    folly::Promise<int> pRelease;
+    folly::Future<int> fRelease = pRelease.getFuture();
+
+    folly::Promise<int> pSubtaskRun;
+    folly::Future<int> fSubtaskRun = pSubtaskRun.getFuture();
+
+    std::atomic<int> secondSubTaskCalled{0};
+
+    std::shared_ptr<AdminTask> vtask = std::make_shared<HookableTask>();
+    HookableTask* task = static_cast<HookableTask*>(vtask.get());
+    task->setJobId(jobId);
+    task->setConcurrentReq(1);
+
+    task->addSubTask([&]() {
+        LOG(INFO) << "run subTask(1), wait until the job is paused";
+        pSubtaskRun.setValue(0);
+        fRelease.wait();
+        return suc;
+    });
+
+    task->addSubTask([&]() {
+        LOG(INFO) << "run subTask(2)";
+        ++secondSubTaskCalled;
+        return suc;
+    });
+
+    task->setCallback([&](ResultCode ret) {
+        pFinish.setValue(ret);
+    });
+
+    taskMgr->addAsyncTask(vtask);
+
+    fSubtaskRun.wait();
+    EXPECT_EQ(cpp2::ErrorCode::SUCCEEDED, taskMgr->pauseJob(jobId));
+    pRelease.setValue(0);
+
+    // the running sub task drains, but the queued one must stay parked
+    std::this_thread::sleep_for(500ms);
+    EXPECT_EQ(0, secondSubTaskCalled.load());
+
+    EXPECT_EQ(cpp2::ErrorCode::SUCCEEDED, taskMgr->resumeJob(jobId));
+    fFinish.wait();
+
+    EXPECT_EQ(1, secondSubTaskCalled.load());
+    EXPECT_EQ(fFinish.value(), suc);
+
+    taskMgr->shutdown();
+}
+
 }  // namespace storage
 }  // namespace nebula
 
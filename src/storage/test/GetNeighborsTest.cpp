@@ -7,7 +7,12 @@
 #include "common/base/Base.h"
 #include "common/fs/TempDir.h"
 #include <gtest/gtest.h>
+#include <folly/synchronization/Baton.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include "utils/NebulaKeyUtils.h"
 #include "storage/query/GetNeighborsProcessor.h"
+#include "storage/ReaderLanes.h"
+#include "storage/StorageFlags.h"
 #include "storage/test/QueryTestUtils.h"
 
 namespace nebula {
@@ -668,6 +673,69 @@ TEST(GetNeighborsTest, LimitSampleTest) {
     }
 }
 
+TEST(GetNeighborsTest, DegreeSampleTest) {
+    fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto totalParts = cluster.getTotalParts();
+    ASSERT_EQ(true, QueryTestUtils::mockVertexData(env, totalParts));
+    ASSERT_EQ(true, QueryTestUtils::mockEdgeData(env, totalParts));
+
+    TagID team = 2;
+    EdgeType serve = 101;
+    FLAGS_reservoir_sampling_degree_threshold = 5;
+    DegreeCache degreeCache(1000, 4);
+
+    std::vector<VertexID> vertices = {"Spurs"};
+    std::vector<EdgeType> over = {-serve};
+    std::vector<std::pair<TagID, std::vector<std::string>>> tags;
+    std::vector<std::pair<EdgeType, std::vector<std::string>>> edges;
+    tags.emplace_back(team, std::vector<std::string>{"name"});
+    edges.emplace_back(-serve, std::vector<std::string>{
+                       "playerName", "startYear", "teamCareer"});
+    auto req = QueryTestUtils::buildRequest(totalParts, vertices, over, tags, edges);
+    req.traverse_spec.set_limit(10);
+    req.traverse_spec.set_random(true);
+    {
+        LOG(INFO) << "FullScanBackfillsDegree";
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, nullptr,
+                                                          &degreeCache);
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+        ASSERT_EQ(0, resp.result.failed_parts.size());
+        ASSERT_EQ(1, resp.vertices.rows.size());
+        // vId, stat, team, -serve, expr
+        ASSERT_EQ(5, resp.vertices.rows[0].values.size());
+        ASSERT_EQ(10, resp.vertices.rows[0].values[3].getList().values.size());
+    }
+    // The first sampled read scanned the whole range, so the degree of
+    // the supernode is known now
+    std::hash<std::string> hash;
+    PartitionID partId = (hash(std::string("Spurs")) % totalParts) + 1;
+    auto degree = degreeCache.get(std::make_pair(std::string("Spurs"), -serve), partId);
+    ASSERT_TRUE(degree.ok());
+    ASSERT_GE(degree.value(), FLAGS_reservoir_sampling_degree_threshold);
+    {
+        LOG(INFO) << "SkipSample";
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, nullptr,
+                                                          &degreeCache);
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+        ASSERT_EQ(0, resp.result.failed_parts.size());
+        ASSERT_EQ(1, resp.vertices.rows.size());
+        ASSERT_EQ(5, resp.vertices.rows[0].values.size());
+        // positions are drawn with replacement, so the sample may come
+        // out slightly smaller than the limit
+        const auto& cell = resp.vertices.rows[0].values[3].getList();
+        ASSERT_LE(cell.values.size(), 10);
+        ASSERT_GE(cell.values.size(), 1);
+    }
+    FLAGS_reservoir_sampling_degree_threshold = 0;
+}
+
 TEST(GetNeighborsTest, VertexCacheTest) {
     fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
     mock::MockCluster cluster;
@@ -1134,6 +1202,216 @@ TEST(GetNeighborsTest, MultiVersionTest) {
     }
 }
 
+TEST(GetNeighborsTest, ConcurrentTest) {
+    fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto totalParts = cluster.getTotalParts();
+    ASSERT_EQ(true, QueryTestUtils::mockVertexData(env, totalParts));
+    ASSERT_EQ(true, QueryTestUtils::mockEdgeData(env, totalParts));
+
+    TagID player = 1;
+    EdgeType serve = 101;
+
+    FLAGS_query_concurrently = true;
+    auto executor = std::make_unique<folly::IOThreadPoolExecutor>(4);
+    {
+        LOG(INFO) << "MultiPartsOnExecutor";
+        std::vector<VertexID> vertices = {"Tim Duncan", "Tony Parker", "Kobe Bryant",
+                                          "Tracy McGrady", "Dwight Howard"};
+        std::vector<EdgeType> over = {serve};
+        std::vector<std::pair<TagID, std::vector<std::string>>> tags;
+        std::vector<std::pair<EdgeType, std::vector<std::string>>> edges;
+        tags.emplace_back(player, std::vector<std::string>{"name", "age", "avgScore"});
+        edges.emplace_back(serve, std::vector<std::string>{"teamName", "startYear", "endYear"});
+        auto req = QueryTestUtils::buildRequest(totalParts, vertices, over, tags, edges);
+
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, executor.get());
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+
+        ASSERT_EQ(0, resp.result.failed_parts.size());
+        // The merge order across parts is not deterministic, only the
+        // row set is
+        QueryTestUtils::checkResponse(resp.vertices, vertices, over, tags, edges, 5, 5);
+    }
+    FLAGS_query_concurrently = false;
+    {
+        LOG(INFO) << "SinglePlanOnExecutor";
+        CHECK(FLAGS_query_offload_execution);
+        // also exercise the sampled plan profiling, the slow-query log
+        // and the per-request I/O accounting on this run; any request
+        // runs longer than one microsecond
+        FLAGS_profile_plan_every_n = 1;
+        FLAGS_slow_query_threshold_us = 1;
+        FLAGS_enable_io_accounting = true;
+        std::vector<VertexID> vertices = {"Tim Duncan", "Tony Parker", "Kobe Bryant",
+                                          "Tracy McGrady", "Dwight Howard"};
+        std::vector<EdgeType> over = {serve};
+        std::vector<std::pair<TagID, std::vector<std::string>>> tags;
+        std::vector<std::pair<EdgeType, std::vector<std::string>>> edges;
+        tags.emplace_back(player, std::vector<std::string>{"name", "age", "avgScore"});
+        edges.emplace_back(serve, std::vector<std::string>{"teamName", "startYear", "endYear"});
+        auto req = QueryTestUtils::buildRequest(totalParts, vertices, over, tags, edges);
+
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, executor.get());
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+
+        ASSERT_EQ(0, resp.result.failed_parts.size());
+        QueryTestUtils::checkResponse(resp.vertices, vertices, over, tags, edges, 5, 5);
+        FLAGS_profile_plan_every_n = 0;
+        FLAGS_slow_query_threshold_us = 0;
+        FLAGS_enable_io_accounting = false;
+    }
+}
+
+TEST(GetNeighborsTest, LaneShardedTest) {
+    fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto totalParts = cluster.getTotalParts();
+    ASSERT_EQ(true, QueryTestUtils::mockVertexData(env, totalParts));
+    ASSERT_EQ(true, QueryTestUtils::mockEdgeData(env, totalParts));
+
+    TagID player = 1;
+    EdgeType serve = 101;
+
+    FLAGS_reader_executor_lanes = 2;
+    ReaderLanes lanes;
+    {
+        LOG(INFO) << "MultiPartsOnLanes";
+        std::vector<VertexID> vertices = {"Tim Duncan", "Tony Parker", "Kobe Bryant",
+                                          "Tracy McGrady", "Dwight Howard"};
+        std::vector<EdgeType> over = {serve};
+        std::vector<std::pair<TagID, std::vector<std::string>>> tags;
+        std::vector<std::pair<EdgeType, std::vector<std::string>>> edges;
+        tags.emplace_back(player, std::vector<std::string>{"name", "age", "avgScore"});
+        edges.emplace_back(serve, std::vector<std::string>{"teamName", "startYear", "endYear"});
+        auto req = QueryTestUtils::buildRequest(totalParts, vertices, over, tags, edges);
+
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, nullptr,
+                                                          nullptr, &lanes);
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+
+        ASSERT_EQ(0, resp.result.failed_parts.size());
+        QueryTestUtils::checkResponse(resp.vertices, vertices, over, tags, edges, 5, 5);
+    }
+    FLAGS_reader_executor_lanes = 0;
+}
+
+TEST(GetNeighborsTest, NeighborPrefetchTest) {
+    fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto totalParts = cluster.getTotalParts();
+    ASSERT_EQ(true, QueryTestUtils::mockVertexData(env, totalParts));
+    ASSERT_EQ(true, QueryTestUtils::mockEdgeData(env, totalParts));
+
+    TagID player = 1;
+    EdgeType serve = 101;
+
+    FLAGS_neighbor_prefetch_limit = 8;
+    auto executor = std::make_unique<folly::IOThreadPoolExecutor>(4);
+    {
+        LOG(INFO) << "PrefetchReturnedNeighbors";
+        std::vector<VertexID> vertices = {"Tim Duncan", "Tony Parker"};
+        std::vector<EdgeType> over = {serve};
+        std::vector<std::pair<TagID, std::vector<std::string>>> tags;
+        std::vector<std::pair<EdgeType, std::vector<std::string>>> edges;
+        tags.emplace_back(player, std::vector<std::string>{"name", "age", "avgScore"});
+        edges.emplace_back(serve, std::vector<std::string>{"teamName", "startYear", "endYear"});
+        auto req = QueryTestUtils::buildRequest(totalParts, vertices, over, tags, edges);
+
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, executor.get());
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+
+        // the warming runs detached behind the response; the response
+        // itself is unaffected by it
+        ASSERT_EQ(0, resp.result.failed_parts.size());
+        QueryTestUtils::checkResponse(resp.vertices, vertices, over, tags, edges, 2, 5);
+    }
+    executor->join();
+    FLAGS_neighbor_prefetch_limit = 0;
+}
+
+TEST(GetNeighborsTest, ResultCacheTest) {
+    fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto totalParts = cluster.getTotalParts();
+    ASSERT_EQ(true, QueryTestUtils::mockVertexData(env, totalParts));
+    ASSERT_EQ(true, QueryTestUtils::mockEdgeData(env, totalParts));
+
+    TagID player = 1;
+    EdgeType serve = 101;
+
+    FLAGS_neighbors_result_cache_ttl_ms = 60 * 1000;
+    SCOPE_EXIT { FLAGS_neighbors_result_cache_ttl_ms = 0; };
+    NeighborsResultCache resultCache(1024, 4);
+
+    std::vector<VertexID> vertices = {"Tim Duncan"};
+    std::vector<EdgeType> over = {serve};
+    std::vector<std::pair<TagID, std::vector<std::string>>> tags;
+    std::vector<std::pair<EdgeType, std::vector<std::string>>> edges;
+    tags.emplace_back(player, std::vector<std::string>{"name", "age", "avgScore"});
+    edges.emplace_back(serve, std::vector<std::string>{"teamName", "startYear", "endYear"});
+    auto req = QueryTestUtils::buildRequest(totalParts, vertices, over, tags, edges);
+
+    auto query = [&] () {
+        auto* processor = GetNeighborsProcessor::instance(env, nullptr, nullptr, nullptr,
+                                                          nullptr, nullptr, &resultCache);
+        auto fut = processor->getFuture();
+        processor->process(req);
+        return std::move(fut).get();
+    };
+
+    LOG(INFO) << "First request scans and fills the cache...";
+    auto resp1 = query();
+    ASSERT_EQ(0, resp1.result.failed_parts.size());
+    QueryTestUtils::checkResponse(resp1.vertices, vertices, over, tags, edges, 1, 5);
+    EXPECT_EQ(0, resultCache.hits());
+
+    LOG(INFO) << "A byte-identical request is served from the cache...";
+    auto resp2 = query();
+    ASSERT_EQ(0, resp2.result.failed_parts.size());
+    EXPECT_EQ(resp1.vertices, resp2.vertices);
+    EXPECT_EQ(1, resultCache.hits());
+
+    LOG(INFO) << "Drop the underlying data, a fresh hit still serves the old rows...";
+    for (auto partId = 1; partId <= totalParts; partId++) {
+        folly::Baton<true, std::atomic> baton;
+        env->kvstore_->asyncRemoveRange(1, partId,
+                                        NebulaKeyUtils::partPrefix(partId),
+                                        NebulaKeyUtils::partPrefix(partId + 1),
+                                        [&baton] (kvstore::ResultCode code) {
+                                            EXPECT_EQ(kvstore::ResultCode::SUCCEEDED, code);
+                                            baton.post();
+                                        });
+        baton.wait();
+    }
+    auto resp3 = query();
+    ASSERT_EQ(0, resp3.result.failed_parts.size());
+    EXPECT_EQ(resp1.vertices, resp3.vertices);
+
+    LOG(INFO) << "An expired entry is not served...";
+    FLAGS_neighbors_result_cache_ttl_ms = 1;
+    usleep(5 * 1000);
+    auto resp4 = query();
+    ASSERT_EQ(0, resp4.result.failed_parts.size());
+    EXPECT_NE(resp1.vertices, resp4.vertices);
+}
+
 TEST(GetNeighborsTest, FilterTest) {
     fs::TempDir rootPath("/tmp/GetNeighborsTest.XXXXXX");
     mock::MockCluster cluster;
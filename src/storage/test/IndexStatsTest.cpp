@@ -0,0 +1,85 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include "storage/index/IndexStats.h"
+
+namespace nebula {
+namespace storage {
+
+TEST(IndexStatsTest, Empty) {
+    IndexStats stats;
+    EXPECT_EQ(0, stats.rowCount());
+    EXPECT_EQ(0, stats.distinctLeading());
+    EXPECT_EQ(0, stats.rowsPerValue());
+}
+
+TEST(IndexStatsTest, LowCardinality) {
+    // 100k rows over a 2-value column: an equality lookup selects half
+    // the rows, and the estimate should say so
+    IndexStats stats;
+    for (auto i = 0; i < 100000; i++) {
+        stats.addRow(i % 2 == 0 ? "true" : "false");
+    }
+    EXPECT_EQ(100000, stats.rowCount());
+    EXPECT_EQ(2, stats.distinctLeading());
+    EXPECT_EQ(50000, stats.rowsPerValue());
+}
+
+TEST(IndexStatsTest, HighCardinality) {
+    // A near-unique column: the sketch estimate is approximate, but it
+    // must land within its ~7% error bound and keep rowsPerValue tiny
+    IndexStats stats;
+    for (auto i = 0; i < 100000; i++) {
+        stats.addRow(folly::to<std::string>(i));
+    }
+    EXPECT_EQ(100000, stats.rowCount());
+    EXPECT_NEAR(100000, stats.distinctLeading(), 100000 * 0.07);
+    EXPECT_LE(stats.rowsPerValue(), 2);
+}
+
+TEST(IndexStatsTest, EncodeDecode) {
+    IndexStats stats;
+    for (auto i = 0; i < 1000; i++) {
+        stats.addRow(folly::to<std::string>(i % 10));
+    }
+    auto decoded = IndexStats::decode(stats.encode());
+    ASSERT_TRUE(decoded.ok());
+    EXPECT_EQ(stats.rowCount(), decoded.value().rowCount());
+    EXPECT_EQ(stats.distinctLeading(), decoded.value().distinctLeading());
+
+    EXPECT_FALSE(IndexStats::decode("bogus").ok());
+}
+
+TEST(IndexStatsTest, Merge) {
+    // Merging the per-part sketches must count values present in both
+    // parts once, as if all rows had been fed to one sketch
+    IndexStats merged;
+    IndexStats whole;
+    for (auto part = 0; part < 4; part++) {
+        IndexStats stats;
+        for (auto i = 0; i < 25000; i++) {
+            auto value = folly::to<std::string>(i % 1000);
+            stats.addRow(value);
+            whole.addRow(value);
+        }
+        merged.merge(stats);
+    }
+    EXPECT_EQ(100000, merged.rowCount());
+    EXPECT_EQ(whole.distinctLeading(), merged.distinctLeading());
+}
+
+}  // namespace storage
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
@@ -226,6 +226,67 @@ TEST(IndexTest, SimpleEdgesTest) {
     }
 }
 
+TEST(IndexTest, BatchedEdgesIndexTest) {
+    fs::TempDir rootPath("/tmp/BatchedEdgesIndexTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto vIdLen = env->schemaMan_->getSpaceVidLen(1).value();
+
+    FLAGS_enable_batched_index_writes = true;
+    SCOPE_EXIT { FLAGS_enable_batched_index_writes = false; };
+
+    auto insert = [&] (int64_t startYear) {
+        cpp2::AddEdgesRequest req;
+        req.set_space_id(1);
+        req.set_overwritable(true);
+        for (auto partId = 1; partId <= 6; partId++) {
+            nebula::storage::cpp2::NewEdge newEdge;
+            nebula::storage::cpp2::EdgeKey edgeKey;
+            edgeKey.set_src(convertVertexId(vIdLen, partId));
+            edgeKey.set_edge_type(101);
+            edgeKey.set_ranking(0);
+            edgeKey.set_dst(convertVertexId(vIdLen, partId + 6));
+            newEdge.set_key(std::move(edgeKey));
+            std::vector<Value>  props;
+            props.emplace_back(Value("col1"));
+            props.emplace_back(Value("col2"));
+            props.emplace_back(Value(startYear));
+            props.emplace_back(Value(4L));
+            props.emplace_back(Value(5L));
+            props.emplace_back(Value(6L));
+            props.emplace_back(Value(7.7F));
+            newEdge.set_props(std::move(props));
+            req.parts[partId].emplace_back(std::move(newEdge));
+        }
+        auto* processor = AddEdgesProcessor::instance(env, nullptr);
+        auto fut = processor->getFuture();
+        processor->process(req);
+        auto resp = std::move(fut).get();
+        EXPECT_EQ(0, resp.result.failed_parts.size());
+    };
+
+    LOG(INFO) << "Insert through the batched log path...";
+    insert(3L);
+    for (auto partId = 1; partId <= 6; partId++) {
+        auto prefix = NebulaKeyUtils::partPrefix(partId);
+        EXPECT_EQ(1, verifyResultNum(1, partId, prefix, env->kvstore_));
+        prefix = IndexKeyUtils::indexPrefix(partId, 101);
+        EXPECT_EQ(1, verifyResultNum(1, partId, prefix, env->kvstore_));
+    }
+
+    LOG(INFO) << "Re-insert with a changed indexed prop...";
+    insert(30L);
+    for (auto partId = 1; partId <= 6; partId++) {
+        // a second version of every edge key
+        auto prefix = NebulaKeyUtils::partPrefix(partId);
+        EXPECT_EQ(2, verifyResultNum(1, partId, prefix, env->kvstore_));
+        // the obsolete index entries went away in the same batch
+        prefix = IndexKeyUtils::indexPrefix(partId, 101);
+        EXPECT_EQ(1, verifyResultNum(1, partId, prefix, env->kvstore_));
+    }
+}
+
 /**
  * Test nullable and default value for vertex insert.
  * And verify the correctness of the nullable and default value.
@@ -19,7 +19,7 @@ public:
                              const std::string& hdfsPath) override {
         UNUSED(hdfsHost); UNUSED(hdfsPort); UNUSED(hdfsPath);
         sleep(1);
-        return Status::OK();
+        return std::string("Found 0 items\n");
     }
 
     StatusOr<std::string> copyToLocal(const std::string& hdfsHost,
@@ -43,7 +43,7 @@ public:
                              const std::string& hdfsPath) override {
         UNUSED(hdfsHost); UNUSED(hdfsPort); UNUSED(hdfsPath);
         sleep(1);
-        return Status::OK();
+        return Status::Error("ls: `/data': No such file or directory");
     }
 
     StatusOr<std::string> copyToLocal(const std::string& hdfsHost,
@@ -79,6 +79,16 @@ TEST(StorageHttpIngestHandlerTest, StorageIngestTest) {
         ASSERT_TRUE(resp.ok());
         ASSERT_EQ("SSTFile ingest successfully", resp.value());
     }
+    {
+        // without an installed index-builder hook build_index is a
+        // no-op and the ingest still succeeds
+        auto url = "/ingest?space=0&build_index=1";
+        auto request = folly::stringPrintf("http://%s:%d%s", FLAGS_ws_ip.c_str(),
+                                           FLAGS_ws_http_port, url);
+        auto resp = http::HttpClient::get(request);
+        ASSERT_TRUE(resp.ok());
+        ASSERT_EQ("SSTFile ingest successfully", resp.value());
+    }
     {
         auto url = "/ingest?space=1";
         auto request = folly::stringPrintf("http://%s:%d%s", FLAGS_ws_ip.c_str(),
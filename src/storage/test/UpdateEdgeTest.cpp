@@ -15,9 +15,13 @@
 #include "mock/MockData.h"
 #include "common/interface/gen-cpp2/storage_types.h"
 #include "common/expression/ConstantExpression.h"
+#include "common/expression/ArithmeticExpression.h"
+#include <thread>
 
 DECLARE_bool(mock_ttl_col);
 DECLARE_int32(mock_ttl_duration);
+DECLARE_bool(enable_update_key_lock);
+DECLARE_bool(enable_update_chain_read);
 
 namespace nebula {
 namespace storage {
@@ -1707,6 +1711,111 @@ TEST(UpdateEdgeTest, Yield_Illegal_Key_Test) {
     EXPECT_EQ("zzzzz", val.getStr());
 }
 
+// Concurrent updates of one edge serialize on its key latch; with
+// chained reads on, a queued update reuses the row the previous holder
+// wrote instead of reading the engine. Increments through that
+// read-modify-write path must not be lost
+TEST(UpdateEdgeTest, Chained_Update_Test) {
+    fs::TempDir rootPath("/tmp/UpdateEdgeTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* env = cluster.storageEnv_.get();
+    auto parts = cluster.getTotalParts();
+
+    GraphSpaceID spaceId = 1;
+    auto status = env->schemaMan_->getSpaceVidLen(spaceId);
+    ASSERT_TRUE(status.ok());
+    auto spaceVidLen = status.value();
+
+    EXPECT_TRUE(mockEdgeData(env, parts, spaceVidLen));
+
+    FLAGS_enable_update_key_lock = true;
+    FLAGS_enable_update_chain_read = true;
+
+    auto partId = std::hash<std::string>()("Tim Duncan") % parts + 1;
+    // src = Tim Duncan, edge_type = 101, ranking = 1997, dst = Spurs
+    VertexID srcId = "Tim Duncan";
+    VertexID dstId = "Spurs";
+    EdgeRanking rank = 1997;
+    EdgeType edgeType = 101;
+
+    // The starting teamCareer, from kvstore directly
+    auto prefix = NebulaKeyUtils::edgePrefix(spaceVidLen, partId, srcId, edgeType, rank, dstId);
+    std::unique_ptr<kvstore::KVIterator> iter;
+    auto ret = env->kvstore_->prefix(spaceId, partId, prefix, &iter);
+    EXPECT_EQ(kvstore::ResultCode::SUCCEEDED, ret);
+    ASSERT_TRUE(iter && iter->valid());
+    auto edgeReader = RowReader::getEdgePropReader(env->schemaMan_,
+                                                   spaceId,
+                                                   std::abs(edgeType),
+                                                   iter->val());
+    auto initCareer = edgeReader->getValueByName("teamCareer").getInt();
+
+    constexpr int32_t kThreadNum = 4;
+    constexpr int32_t kUpdatesPerThread = 16;
+    std::vector<std::thread> threads;
+    for (int32_t t = 0; t < kThreadNum; t++) {
+        threads.emplace_back([env, spaceId, partId, srcId, dstId, rank, edgeType] {
+            for (int32_t i = 0; i < kUpdatesPerThread; i++) {
+                cpp2::UpdateEdgeRequest req;
+                req.set_space_id(spaceId);
+                req.set_part_id(partId);
+                storage::cpp2::EdgeKey edgeKey;
+                edgeKey.set_src(srcId);
+                edgeKey.set_edge_type(edgeType);
+                edgeKey.set_ranking(rank);
+                edgeKey.set_dst(dstId);
+                req.set_edge_key(edgeKey);
+
+                // int: 101.teamCareer = 101.teamCareer + 1
+                std::vector<cpp2::UpdatedProp> props;
+                cpp2::UpdatedProp uProp;
+                uProp.set_name("teamCareer");
+                ArithmeticExpression incr(
+                    Expression::Kind::kAdd,
+                    new EdgePropertyExpression(new std::string("101"),
+                                               new std::string("teamCareer")),
+                    new ConstantExpression(Value(1)));
+                uProp.set_value(Expression::encode(incr));
+                props.emplace_back(uProp);
+                req.set_updated_props(std::move(props));
+
+                decltype(req.return_props) tmpProps;
+                auto* yEdge = new std::string("101");
+                auto* yProp = new std::string("teamCareer");
+                EdgePropertyExpression edgePropExp(yEdge, yProp);
+                tmpProps.emplace_back(Expression::encode(edgePropExp));
+                req.set_return_props(std::move(tmpProps));
+                req.set_insertable(false);
+
+                auto* processor = UpdateEdgeProcessor::instance(env, nullptr);
+                auto f = processor->getFuture();
+                processor->process(req);
+                auto resp = std::move(f).get();
+                EXPECT_EQ(0, resp.result.failed_parts.size());
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // No increment may be lost
+    iter.reset();
+    ret = env->kvstore_->prefix(spaceId, partId, prefix, &iter);
+    EXPECT_EQ(kvstore::ResultCode::SUCCEEDED, ret);
+    ASSERT_TRUE(iter && iter->valid());
+    edgeReader = RowReader::getEdgePropReader(env->schemaMan_,
+                                              spaceId,
+                                              std::abs(edgeType),
+                                              iter->val());
+    EXPECT_EQ(initCareer + kThreadNum * kUpdatesPerThread,
+              edgeReader->getValueByName("teamCareer").getInt());
+
+    FLAGS_enable_update_key_lock = false;
+    FLAGS_enable_update_chain_read = false;
+}
+
 }  // namespace storage
 }  // namespace nebula
 
@@ -0,0 +1,109 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include "common/fs/TempDir.h"
+#include "utils/NebulaKeyUtils.h"
+#include <gtest/gtest.h>
+#include <folly/synchronization/Baton.h>
+#include "storage/VidDict.h"
+#include "mock/MockCluster.h"
+
+namespace nebula {
+namespace storage {
+
+static void commitBatch(kvstore::KVStore* store,
+                        GraphSpaceID spaceId,
+                        PartitionID partId,
+                        std::vector<kvstore::KV> kvs) {
+    folly::Baton<true, std::atomic> baton;
+    store->asyncMultiPut(spaceId, partId, std::move(kvs),
+                         [&baton] (kvstore::ResultCode code) {
+        EXPECT_EQ(kvstore::ResultCode::SUCCEEDED, code);
+        baton.post();
+    });
+    baton.wait();
+}
+
+TEST(VidDictTest, AssignAndLookupTest) {
+    fs::TempDir rootPath("/tmp/VidDictTest.XXXXXX");
+    mock::MockCluster cluster;
+    cluster.initStorageKV(rootPath.path());
+    auto* store = cluster.storageEnv_->kvstore_;
+    GraphSpaceID spaceId = 1;
+    PartitionID partId = 1;
+
+    // An unknown vid has no alias yet
+    auto miss = VidDict::localId(store, spaceId, partId, "Tim Duncan");
+    ASSERT_FALSE(ok(miss));
+    ASSERT_EQ(kvstore::ResultCode::ERR_KEY_NOT_FOUND, error(miss));
+
+    // Assign aliases to three vids in one batch; they come out dense
+    // from 1 and repeats resolve through the batch lookaside
+    VidDict::PendingBatch batch;
+    std::vector<std::string> vids{"Tim Duncan", "Tony Parker", "Manu Ginobili"};
+    for (size_t i = 0; i < vids.size(); i++) {
+        auto ret = VidDict::getOrAssign(store, spaceId, partId, vids[i], batch);
+        ASSERT_TRUE(ok(ret));
+        ASSERT_EQ(i + 1, value(ret));
+    }
+    {
+        auto again = VidDict::getOrAssign(store, spaceId, partId, "Tony Parker", batch);
+        ASSERT_TRUE(ok(again));
+        ASSERT_EQ(2, value(again));
+    }
+    VidDict::finish(partId, batch);
+    // Forward, reverse and count key per new vid
+    ASSERT_EQ(2 * vids.size() + 1, batch.kvs.size());
+    commitBatch(store, spaceId, partId, std::move(batch.kvs));
+
+    // Committed aliases resolve both ways without the batch
+    for (size_t i = 0; i < vids.size(); i++) {
+        auto fwd = VidDict::localId(store, spaceId, partId, vids[i]);
+        ASSERT_TRUE(ok(fwd));
+        ASSERT_EQ(i + 1, value(fwd));
+        auto rev = VidDict::userVid(store, spaceId, partId, i + 1);
+        ASSERT_TRUE(ok(rev));
+        ASSERT_EQ(vids[i], value(rev));
+    }
+
+    // A later batch picks the count up where the first left off, and
+    // known vids assign nothing new
+    VidDict::PendingBatch next;
+    {
+        auto known = VidDict::getOrAssign(store, spaceId, partId, "Tim Duncan", next);
+        ASSERT_TRUE(ok(known));
+        ASSERT_EQ(1, value(known));
+        ASSERT_TRUE(next.kvs.empty());
+        auto fresh = VidDict::getOrAssign(store, spaceId, partId, "LaMarcus Aldridge", next);
+        ASSERT_TRUE(ok(fresh));
+        ASSERT_EQ(vids.size() + 1, value(fresh));
+    }
+    VidDict::finish(partId, next);
+    commitBatch(store, spaceId, partId, std::move(next.kvs));
+    {
+        auto rev = VidDict::userVid(store, spaceId, partId, vids.size() + 1);
+        ASSERT_TRUE(ok(rev));
+        ASSERT_EQ("LaMarcus Aldridge", value(rev));
+    }
+
+    // The dictionaries are per part: another part starts from 1 again
+    VidDict::PendingBatch other;
+    auto ret = VidDict::getOrAssign(store, spaceId, 2, "Tim Duncan", other);
+    ASSERT_TRUE(ok(ret));
+    ASSERT_EQ(1, value(ret));
+}
+
+}  // namespace storage
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+    return RUN_ALL_TESTS();
+}
@@ -8,16 +8,25 @@
 #include "common/time/Duration.h"
 #include "tools/dbDump/DbDumper.h"
 #include "utils/NebulaKeyUtils.h"
+#include <sstream>
 
 DEFINE_string(space_name, "", "The space name.");
 DEFINE_string(db_path, "./", "Path to rocksdb.");
 DEFINE_string(meta_server, "127.0.0.1:45500", "Meta servers' address.");
-DEFINE_string(mode, "scan", "Dump mode, scan | stat");
+DEFINE_string(mode, "scan", "Dump mode, scan | stat | binary. Binary writes the raw "
+                            "key/value bytes length-prefixed, skipping stringification.");
 DEFINE_string(parts, "", "A list of partition id seperated by comma.");
 DEFINE_string(vids, "", "A list of vertex ids seperated by comma.");
 DEFINE_string(tags, "", "A list of tag name seperated by comma.");
 DEFINE_string(edges, "", "A list of edge name seperated by comma.");
 DEFINE_int64(limit, 1000, "Limit to output.");
+DEFINE_int32(threads, 1, "Threads scanning partitions in parallel.");
+DEFINE_bool(ordered, true, "Keep the output in partition order when scanning with "
+                           "multiple threads; turn off to stream each partition "
+                           "the moment it finishes.");
+DEFINE_string(output, "", "Write the scanned records to this file instead of stdout. "
+                          "Required by binary mode, so the statistics on stdout "
+                          "cannot corrupt the byte stream.");
 
 namespace nebula {
 namespace storage {
@@ -116,9 +125,23 @@ Status DbDumper::initParams() {
         edgeTypes_.emplace(edgeType.value());
     }
 
-    if (FLAGS_mode.compare("scan") != 0 && FLAGS_mode.compare("stat") != 0) {
+    if (FLAGS_mode.compare("scan") != 0 && FLAGS_mode.compare("stat") != 0
+            && FLAGS_mode.compare("binary") != 0) {
         return Status::Error("Unkown mode '%s'.", FLAGS_mode.c_str());
     }
+    if (FLAGS_mode.compare("binary") == 0 && FLAGS_output.empty()) {
+        return Status::Error("Binary mode needs an output file, use -output.");
+    }
+    if (FLAGS_threads < 1) {
+        return Status::Error("Invalid thread number %d.", FLAGS_threads);
+    }
+    if (!FLAGS_output.empty()) {
+        outFile_.open(FLAGS_output, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!outFile_.is_open()) {
+            return Status::Error("Open output file '%s' failed.", FLAGS_output.c_str());
+        }
+        out_ = &outFile_;
+    }
     return Status::OK();
 }
 
@@ -270,49 +293,34 @@ void DbDumper::run() {
         }
         case 0b1000: {
             // specified part, seek with prefix and print them all
-            for (auto partId : parts_) {
-                auto prefix = NebulaKeyUtils::partPrefix(partId);
-                seek(prefix);
-            }
+            scanParts({parts_.begin(), parts_.end()});
             break;
         }
         case 0b1001: {
             // specified part and edge, seek with prefix and print edge if found
             beforePrintVertex_.emplace_back(noPrint);
             beforePrintEdge_.emplace_back(printIfEdgeFound);
-            for (auto partId : parts_) {
-                auto prefix = NebulaKeyUtils::partPrefix(partId);
-                seek(prefix);
-            }
+            scanParts({parts_.begin(), parts_.end()});
             break;
         }
         case 0b1010: {
             // specified part and tag, seek with prefix and print vertex if found
             beforePrintVertex_.emplace_back(printIfTagFound);
             beforePrintEdge_.emplace_back(noPrint);
-            for (auto partId : parts_) {
-                auto prefix = NebulaKeyUtils::partPrefix(partId);
-                seek(prefix);
-            }
+            scanParts({parts_.begin(), parts_.end()});
             break;
         }
         case 0b1011: {
             // specified part/tag/edge, with prefix and print
             beforePrintVertex_.emplace_back(noPrint);
             beforePrintEdge_.emplace_back(printIfEdgeFound);
-            for (auto partId : parts_) {
-                auto prefix = NebulaKeyUtils::partPrefix(partId);
-                seek(prefix);
-            }
+            scanParts({parts_.begin(), parts_.end()});
 
             beforePrintVertex_.clear();
             beforePrintEdge_.clear();
             beforePrintVertex_.emplace_back(printIfTagFound);
             beforePrintEdge_.emplace_back(noPrint);
-            for (auto partId : parts_) {
-                auto prefix = NebulaKeyUtils::partPrefix(partId);
-                seek(prefix);
-            }
+            scanParts({parts_.begin(), parts_.end()});
             break;
         }
         case 0b1100: {
@@ -411,20 +419,91 @@ void DbDumper::run() {
 }
 
 void DbDumper::seekToFirst() {
-    const auto it = db_->NewIterator(rocksdb::ReadOptions());
-    it->SeekToFirst();
-    const auto prefixIt = std::make_unique<kvstore::RocksPrefixIter>(it, "");
-    iterates(prefixIt.get());
+    // The parts partition all the data, so a full scan is the same as
+    // scanning every part, and those can run in parallel
+    std::vector<PartitionID> partIds;
+    partIds.reserve(partNum_);
+    for (PartitionID partId = 1; partId <= partNum_; partId++) {
+        partIds.emplace_back(partId);
+    }
+    scanParts(partIds);
 }
 
 void DbDumper::seek(std::string& prefix) {
     const auto it = db_->NewIterator(rocksdb::ReadOptions());
     it->Seek(rocksdb::Slice(prefix));
     const auto prefixIt = std::make_unique<kvstore::RocksPrefixIter>(it, prefix);
-    iterates(prefixIt.get());
+    iterates(prefixIt.get(), *out_, tagStat_, edgeStat_);
 }
 
-void DbDumper::iterates(kvstore::RocksPrefixIter* it) {
+void DbDumper::scanParts(const std::vector<PartitionID>& partIds) {
+    std::vector<PartitionID> sorted(partIds);
+    std::sort(sorted.begin(), sorted.end());
+    auto threadNum = std::min(static_cast<size_t>(FLAGS_threads), sorted.size());
+    if (threadNum <= 1) {
+        for (auto partId : sorted) {
+            auto prefix = NebulaKeyUtils::partPrefix(partId);
+            seek(prefix);
+        }
+        return;
+    }
+
+    std::atomic<size_t> nextPart{0};
+    std::mutex emitLock;
+    std::condition_variable emitCV;
+    size_t emitTurn = 0;
+    auto worker = [&] {
+        while (true) {
+            auto i = nextPart++;
+            if (i >= sorted.size()) {
+                break;
+            }
+            auto prefix = NebulaKeyUtils::partPrefix(sorted[i]);
+            std::ostringstream buf;
+            std::unordered_map<TagID, uint32_t> tagStat;
+            std::unordered_map<EdgeType, uint32_t> edgeStat;
+            {
+                const auto it = db_->NewIterator(rocksdb::ReadOptions());
+                it->Seek(rocksdb::Slice(prefix));
+                const auto prefixIt = std::make_unique<kvstore::RocksPrefixIter>(it, prefix);
+                iterates(prefixIt.get(), buf, tagStat, edgeStat);
+            }
+            {
+                std::lock_guard<std::mutex> g(statLock_);
+                for (auto& t : tagStat) {
+                    tagStat_[t.first] += t.second;
+                }
+                for (auto& e : edgeStat) {
+                    edgeStat_[e.first] += e.second;
+                }
+            }
+            // Parts are claimed in ascending order, so emitting in claim
+            // order keeps the partition order of the output. Every claimed
+            // part emits, even an empty one, or the turn would never advance
+            std::unique_lock<std::mutex> l(emitLock);
+            if (FLAGS_ordered) {
+                emitCV.wait(l, [&emitTurn, i] { return emitTurn == i; });
+            }
+            (*out_) << buf.str();
+            emitTurn = i + 1;
+            emitCV.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadNum);
+    for (size_t i = 0; i < threadNum; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void DbDumper::iterates(kvstore::RocksPrefixIter* it,
+                        std::ostream& out,
+                        std::unordered_map<TagID, uint32_t>& tagStat,
+                        std::unordered_map<EdgeType, uint32_t>& edgeStat) {
     for (; it->valid(); it->next()) {
         if (FLAGS_limit > 0 && count_ >= FLAGS_limit) {
             break;
@@ -449,22 +528,19 @@ void DbDumper::iterates(kvstore::RocksPrefixIter* it) {
             auto tagId = NebulaKeyUtils::getTagId(spaceVidLen_, key);
             // only print to screen with scan mode
             if (FLAGS_mode == "scan") {
-                printTagKey(key);
+                printTagKey(key, out);
                 auto reader = RowReader::getTagPropReader(schemaMng_.get(), spaceId_, tagId, value);
                 if (!reader) {
                     std::cerr << "Can't get tag reader of " << tagId;
                     continue;
                 }
-                printValue(reader.get());
+                printValue(reader.get(), out);
+            } else if (FLAGS_mode == "binary") {
+                writeBinary(key, value, out);
             }
 
             // statistics
-            auto tagStat = tagStat_.find(tagId);
-            if (tagStat == tagStat_.end()) {
-                tagStat_.emplace(tagId, 1);
-            } else {
-                ++(tagStat->second);
-            }
+            ++tagStat[tagId];
             ++vertexCount_;
             ++count_;
         } else if (NebulaKeyUtils::isEdge(spaceVidLen_, key)) {
@@ -487,48 +563,45 @@ void DbDumper::iterates(kvstore::RocksPrefixIter* it) {
             }
             // only print to screen with scan mode
             if (FLAGS_mode == "scan") {
-                printEdgeKey(key);
+                printEdgeKey(key, out);
                 auto reader = RowReader::getEdgePropReader(schemaMng_.get(), spaceId_,
                                                            edgeType, value);
                 if (!reader) {
                     std::cerr << "Can't get edge reader of " << edgeType;
                     continue;
                 }
-                printValue(reader.get());
+                printValue(reader.get(), out);
+            } else if (FLAGS_mode == "binary") {
+                writeBinary(key, value, out);
             }
 
             // statistics
-            auto edgeStat = edgeStat_.find(edgeType);
-            if (edgeStat == edgeStat_.end()) {
-                edgeStat_.emplace(edgeType, 1);
-            } else {
-                ++(edgeStat->second);
-            }
+            ++edgeStat[edgeType];
             ++edgeCount_;
             ++count_;
         }
     }
 }
 
-inline void DbDumper::printTagKey(const folly::StringPiece& key) {
+inline void DbDumper::printTagKey(const folly::StringPiece& key, std::ostream& out) {
     auto part = NebulaKeyUtils::getPart(key);
     auto vid = NebulaKeyUtils::getVertexId(spaceVidLen_, key);
     auto tagId = NebulaKeyUtils::getTagId(spaceVidLen_, key);
-    std::cout << "[vertex] key: " << part << ", " << vid << ", " << getTagName(tagId);
+    out << "[vertex] key: " << part << ", " << vid << ", " << getTagName(tagId);
 }
 
-inline void DbDumper::printEdgeKey(const folly::StringPiece& key) {
+inline void DbDumper::printEdgeKey(const folly::StringPiece& key, std::ostream& out) {
     auto part = NebulaKeyUtils::getPart(key);
     auto edgeType = NebulaKeyUtils::getEdgeType(spaceVidLen_, key);
     auto src = NebulaKeyUtils::getSrcId(spaceVidLen_, key);
     auto dst = NebulaKeyUtils::getDstId(spaceVidLen_, key);
     auto rank = NebulaKeyUtils::getRank(spaceVidLen_, key);
-    std::cout << "[edge] key: " << part << ", " << src << ", " << getEdgeName(edgeType) << ", "
+    out << "[edge] key: " << part << ", " << src << ", " << getEdgeName(edgeType) << ", "
         << rank << ", " << dst;
 }
 
-void DbDumper::printValue(const RowReader* reader) {
-    std::cout << " value: ";
+void DbDumper::printValue(const RowReader* reader, std::ostream& out) {
+    out << " value: ";
     auto schema = reader->getSchema();
     if (schema == nullptr) {
         std::cerr << "schema not found.";
@@ -539,11 +612,23 @@ void DbDumper::printValue(const RowReader* reader) {
     while (iter) {
         auto value = reader->getValueByIndex(index);
         auto retVal = value.toString();
-        std::cout << retVal << ", ";
+        out << retVal << ", ";
         ++iter;
         ++index;
     }
-    std::cout << "\n";
+    out << "\n";
+}
+
+void DbDumper::writeBinary(const folly::StringPiece& key,
+                           const folly::StringPiece& value,
+                           std::ostream& out) {
+    // [uint32 keyLen][key bytes][uint32 valueLen][value bytes], no decode
+    uint32_t keyLen = key.size();
+    uint32_t valueLen = value.size();
+    out.write(reinterpret_cast<const char*>(&keyLen), sizeof(keyLen));
+    out.write(key.data(), keyLen);
+    out.write(reinterpret_cast<const char*>(&valueLen), sizeof(valueLen));
+    out.write(value.data(), valueLen);
 }
 
 std::string DbDumper::getTagName(const TagID tagId) {
@@ -12,6 +12,7 @@
 #include "common/clients/meta/MetaClient.h"
 #include "common/meta/ServerBasedSchemaManager.h"
 #include <rocksdb/db.h>
+#include <fstream>
 #include "kvstore/RocksEngine.h"
 #include "codec/RowReader.h"
 
@@ -24,6 +25,9 @@ DECLARE_string(vids);
 DECLARE_string(tags);
 DECLARE_string(edges);
 DECLARE_int64(limit);
+DECLARE_int32(threads);
+DECLARE_bool(ordered);
+DECLARE_string(output);
 
 namespace nebula {
 namespace storage {
@@ -51,17 +55,30 @@ private:
 
     void seek(std::string& prefix);
 
-    void iterates(kvstore::RocksPrefixIter* it);
+    // Scan the given parts, one prefix scan each, spread over FLAGS_threads.
+    // With FLAGS_ordered the output keeps the part order (buffering at most
+    // one in-flight part per thread), otherwise every part streams out the
+    // moment it finishes
+    void scanParts(const std::vector<PartitionID>& partIds);
 
-    inline void printTagKey(const folly::StringPiece& key);
+    void iterates(kvstore::RocksPrefixIter* it,
+                  std::ostream& out,
+                  std::unordered_map<TagID, uint32_t>& tagStat,
+                  std::unordered_map<EdgeType, uint32_t>& edgeStat);
 
-    inline void printEdgeKey(const folly::StringPiece& key);
+    inline void printTagKey(const folly::StringPiece& key, std::ostream& out);
+
+    inline void printEdgeKey(const folly::StringPiece& key, std::ostream& out);
 
     std::string getTagName(const TagID tagId);
 
     std::string getEdgeName(const EdgeType edgeType);
 
-    void printValue(const RowReader* reader);
+    void printValue(const RowReader* reader, std::ostream& out);
+
+    static void writeBinary(const folly::StringPiece& key,
+                            const folly::StringPiece& value,
+                            std::ostream& out);
 
     bool isValidVidLen(VertexID vid);
 
@@ -80,12 +97,18 @@ private:
     std::vector<std::function<bool(const folly::StringPiece&)>>    beforePrintVertex_;
     std::vector<std::function<bool(const folly::StringPiece&)>>    beforePrintEdge_;
 
-    // For statistics
+    // The sink of the scanned records: stdout, or FLAGS_output when given
+    std::ofstream                                                  outFile_;
+    std::ostream*                                                  out_{&std::cout};
+
+    // For statistics. The per-type maps are merged under statLock_ when
+    // parts are scanned in parallel
+    std::mutex                                                     statLock_;
     std::unordered_map<TagID, uint32_t>                            tagStat_;
     std::unordered_map<EdgeType, uint32_t>                         edgeStat_;
-    int64_t                                                        count_{0};
-    int64_t                                                        vertexCount_{0};
-    int64_t                                                        edgeCount_{0};
+    std::atomic<int64_t>                                           count_{0};
+    std::atomic<int64_t>                                           vertexCount_{0};
+    std::atomic<int64_t>                                           edgeCount_{0};
 };
 
 }  // namespace storage
@@ -20,6 +20,14 @@ DEFINE_string(prop_name, "test_prop", "the property name");
 DEFINE_string(first_vertex_id, "1", "The smallest vertex id");
 DEFINE_uint64(width, 100, "width of matrix");
 DEFINE_uint64(height, 1000, "height of matrix");
+DEFINE_uint64(chains, 1, "Number of independent chains to build, each one a full "
+                         "width * height matrix in its own vertex id range");
+DEFINE_int32(write_concurrency, 1, "Threads building chains concurrently");
+DEFINE_int32(verify_rounds, 1, "Consistency passes over all chains after the pipelined "
+                               "verification");
+DEFINE_int32(leader_change_wait_secs, 0, "Seconds to wait before each consistency pass, "
+                                         "leaving room to bounce partition leaders "
+                                         "mid-run");
 
 DECLARE_int32(heartbeat_interval_secs);
 
@@ -39,6 +47,13 @@ namespace storage {
  * 3. The width and height is the size of the big linked list, you can refer to the graph below.
  *    As expected, we can traverse the big linked list after width * height steps starting
  *    from any node in the list.
+ *
+ * With FLAGS_chains > 1 the tool builds that many independent circles in disjoint
+ * vertex id ranges, spread over FLAGS_write_concurrency writer threads; every chain
+ * is traversed by a verifier thread as soon as its writer finishes, so reads run
+ * pipelined with the remaining writes. FLAGS_verify_rounds then re-walks all chains,
+ * waiting FLAGS_leader_change_wait_secs before each pass so partition leaders can be
+ * bounced mid-soak and the re-walk lands on the new leaders.
  */
 class IntegrityTest {
 public:
@@ -52,8 +67,94 @@ public:
         if (!init()) {
             return EXIT_FAILURE;
         }
-        prepareData();
-        if (!validate(firstVertexId_, width_ * height_)) {
+        time::Duration dur;
+        const auto chainLen = width_ * height_;
+        const auto baseId = std::atol(firstVertexId_.c_str());
+
+        std::atomic<uint64_t> nextChain{0};
+        auto writer = [&] {
+            while (!failed_) {
+                auto chain = nextChain++;
+                if (chain >= FLAGS_chains) {
+                    break;
+                }
+                prepareChain(baseId + chain * chainLen);
+                {
+                    std::lock_guard<std::mutex> g(queueLock_);
+                    readyChains_.emplace_back(chain);
+                }
+                queueCV_.notify_one();
+            }
+        };
+        auto verifier = [&] {
+            while (true) {
+                uint64_t chain;
+                {
+                    std::unique_lock<std::mutex> l(queueLock_);
+                    queueCV_.wait(l, [this] {
+                        return !readyChains_.empty() || writersDone_;
+                    });
+                    if (readyChains_.empty()) {
+                        break;
+                    }
+                    chain = readyChains_.front();
+                    readyChains_.pop_front();
+                }
+                verifyChain(chain, baseId + chain * chainLen, chainLen);
+            }
+        };
+
+        std::vector<std::thread> writers;
+        std::vector<std::thread> verifiers;
+        for (int32_t i = 0; i < FLAGS_write_concurrency; i++) {
+            writers.emplace_back(writer);
+            verifiers.emplace_back(verifier);
+        }
+        for (auto& t : writers) {
+            t.join();
+        }
+        {
+            std::lock_guard<std::mutex> g(queueLock_);
+            writersDone_ = true;
+        }
+        queueCV_.notify_all();
+        for (auto& t : verifiers) {
+            t.join();
+        }
+
+        // The consistency passes re-walk every chain from scratch; the wait
+        // before each one is the window to kill or restart storage hosts, so
+        // the traversal crosses the resulting leader changes
+        for (int32_t round = 1; round <= FLAGS_verify_rounds && !failed_; round++) {
+            if (FLAGS_leader_change_wait_secs > 0) {
+                LOG(INFO) << "Consistency pass " << round << " starts in "
+                          << FLAGS_leader_change_wait_secs
+                          << "s, change the partition leaders now";
+                sleep(FLAGS_leader_change_wait_secs);
+            }
+            std::atomic<uint64_t> next{0};
+            auto checker = [&] {
+                while (!failed_) {
+                    auto chain = next++;
+                    if (chain >= FLAGS_chains) {
+                        break;
+                    }
+                    verifyChain(chain, baseId + chain * chainLen, chainLen);
+                }
+            };
+            std::vector<std::thread> checkers;
+            for (int32_t i = 0; i < FLAGS_write_concurrency; i++) {
+                checkers.emplace_back(checker);
+            }
+            for (auto& t : checkers) {
+                t.join();
+            }
+        }
+
+        LOG(INFO) << "Built " << FLAGS_chains << " chains of " << chainLen
+                  << " vertices, verified " << verifiedChains_
+                  << " times in " << dur.elapsedInMSec() << "ms";
+        if (failed_) {
             LOG(INFO) << "Integrity test failed";
             return EXIT_FAILURE;
         }
@@ -141,26 +242,36 @@ private:
      *             |                 |________||
      *             |___________________________|
      */
-    void prepareData() {
+    void prepareChain(int64_t chainFirstId) {
         std::vector<VertexID> first;
         std::vector<VertexID> prev;
         std::vector<VertexID> cur;
 
-        LOG(INFO) << "Start insert vertex";
+        LOG(INFO) << "Start insert vertex of chain at " << chainFirstId;
         for (size_t i = 0; i < width_; i++) {
-            prev.emplace_back(std::to_string(std::atol(firstVertexId_.c_str()) + i));
+            prev.emplace_back(std::to_string(chainFirstId + i));
         }
         // leave alone the first line, generate other lines
         for (size_t i = 1; i < height_; i++) {
-            addVertex(prev, cur, std::to_string(std::atol(firstVertexId_.c_str() + i * width_)));
+            addVertex(prev, cur, std::to_string(chainFirstId + i * width_));
             prev = std::move(cur);
         }
         // shift the last line
         std::rotate(prev.begin(), prev.end() - 1, prev.end());
         // generate first line, each node in first line will points to a node in rotated last line,
         // which will make the matrix a big linked list
-        addVertex(prev, first, firstVertexId_);
-        LOG(INFO) << "Prepare data ok";
+        addVertex(prev, first, std::to_string(chainFirstId));
+        LOG(INFO) << "Chain at " << chainFirstId << " prepared";
+    }
+
+    void verifyChain(uint64_t chain, int64_t chainFirstId, uint64_t chainLen) {
+        if (validate(std::to_string(chainFirstId), chainLen)) {
+            verifiedChains_++;
+            LOG(INFO) << "Chain " << chain << " verified";
+        } else {
+            LOG(ERROR) << "Chain " << chain << " starting at " << chainFirstId << " is broken";
+            failed_ = true;
+        }
     }
 
     void addVertex(std::vector<VertexID>& prev, std::vector<VertexID>& cur, VertexID startId) {
@@ -171,9 +282,10 @@ private:
         auto resp = std::move(future).get();
         if (!resp.succeeded()) {
             for (auto& err : resp.failedParts()) {
-                VLOG(2) << "Partition " << err.first
-                        << " failed: " << static_cast<int32_t>(err.second);
+                LOG(ERROR) << "Partition " << err.first
+                           << " failed: " << static_cast<int32_t>(err.second);
             }
+            failed_ = true;
         }
     }
 
@@ -203,9 +315,9 @@ private:
             v.set_tags(std::move(tags));
             newVertices.emplace_back(std::move(v));
             VLOG(2) << "Build " << cur[i] << " -> " << prev[i];
-            PLOG_EVERY_N(INFO, 10000) << "We have inserted "
-                << std::atol(vId.c_str()) - std::atol(firstVertexId_.c_str()) - width_
-                << " vertices so far, total: " << width_ * height_;
+            insertedVertices_++;
+            PLOG_EVERY_N(INFO, 10000) << "We have inserted " << insertedVertices_
+                << " vertices so far, total: " << width_ * height_ * FLAGS_chains;
         }
         return newVertices;
     }
@@ -215,46 +327,43 @@ private:
         VertexID nextId = startId;
         while (count < queryTimes) {
             PLOG_EVERY_N(INFO, 1000) << "We have gone " << count << " steps so far";
-            // TODO support getProps
             std::vector<cpp2::VertexProp> props;
             cpp2::VertexProp tagProp;
             tagProp.tag = tagId_;
             tagProp.props.emplace_back(propName_);
+            props.emplace_back(std::move(tagProp));
             DataSet dataset({kVid});
-            auto future = client_->getProps(spaceId_, dataset, &props, nullptr, nullptr);
+            Row row;
+            row.values.emplace_back(nextId);
+            dataset.emplace_back(std::move(row));
+            auto future = client_->getProps(spaceId_, std::move(dataset), &props,
+                                            nullptr, nullptr);
             auto resp = std::move(future).get();
             if (!resp.succeeded()) {
                 LOG(ERROR) << "Failed to fetch props of vertex " << nextId;
                 return false;
             }
-            // TODO
-            #if 0
-            auto& results = resp.responses();
-            // get tag schema
-            auto* vschema = results[0].get_vertex_schema();
-            DCHECK(vschema != nullptr);
-            auto tagIter = vschema->find(tagId_);
-            DCHECK(tagIter != vschema->end());
-            auto tagProvider = std::make_shared<ResultSchemaProvider>(tagIter->second);
-
-            for (auto& vdata : results[0].vertices) {
-                auto iter = std::find_if(vdata.tag_data.begin(), vdata.tag_data.end(),
-                    [this] (const auto& tagData) {
-                        return tagData.tag_id == tagId_;
-                    });
-                if (iter == vdata.tag_data.end()) {
-                    return false;
+            // the next pointer is the only requested prop, right after the vid
+            bool found = false;
+            for (auto& result : resp.responses()) {
+                for (auto& r : result.props.rows) {
+                    if (r.values.size() < 2 || !r.values[1].isInt()) {
+                        continue;
+                    }
+                    nextId = std::to_string(r.values[1].getInt());
+                    found = true;
                 }
-                auto tagReader = RowReader::getRowReader(iter->data, tagProvider);
-                auto ret = RowReader::getPropByName(tagReader.get(), propName_);
-                CHECK(ok(ret));
-                nextId = boost::get<int64_t>(value(ret));
             }
-            #endif
+            if (!found) {
+                LOG(ERROR) << "Vertex " << nextId << " has no next pointer";
+                return false;
+            }
             count++;
         }
         // after go to next node for width * height times, it should go back to where it starts
         if (nextId != startId) {
+            LOG(ERROR) << "Walked " << queryTimes << " steps from " << startId
+                       << " but ended up on " << nextId;
             return false;
         }
         return true;
@@ -270,6 +379,15 @@ private:
     size_t                                       width_;
     size_t                                       height_;
     VertexID                                     firstVertexId_;
+
+    // chains finished by a writer, waiting for a verifier to walk them
+    std::mutex                                   queueLock_;
+    std::condition_variable                      queueCV_;
+    std::deque<uint64_t>                         readyChains_;
+    bool                                         writersDone_{false};
+    std::atomic<uint64_t>                        insertedVertices_{0};
+    std::atomic<uint64_t>                        verifiedChains_{0};
+    std::atomic<bool>                            failed_{false};
 };
 
 }  // namespace storage
@@ -11,6 +11,8 @@
 #include <folly/TokenBucket.h>
 #include <folly/stats/TimeseriesHistogram.h>
 #include <folly/stats/BucketedTimeSeries.h>
+#include <cmath>
+#include <fstream>
 
 DEFINE_int32(threads, 1, "Total threads for perf");
 DEFINE_double(qps, 1000, "Total qps for the perf tool");
@@ -18,7 +20,7 @@ DEFINE_int32(totalReqs, 10000, "Total requests during this perf test");
 DEFINE_int32(io_threads, 10, "Client io threads");
 DEFINE_string(method, "getNeighbors", "method type being tested,"
                                       "such as getNeighbors, addVertices, addEdges, "
-                                      "getVertices, getEdges");
+                                      "getVertices, getEdges, or mix for a read/write blend");
 DEFINE_string(meta_server_addrs, "", "meta server address");
 DEFINE_int32(min_vertex_id, 1, "The smallest vertex Id, need convert to string");
 DEFINE_int32(max_vertex_id, 10000, "The biggest vertex Id, need convert to string");
@@ -31,6 +33,25 @@ DEFINE_int32(property_size, 1000, "The property size of per property");
 DEFINE_bool(random_message, true, "Whether to write random message to storage service");
 DEFINE_int32(concurrency, 50, "concurrent requests");
 DEFINE_int32(batch_num, 1, "batch vertices for one request");
+DEFINE_string(key_dist, "uniform", "Distribution of the vertex ids the read workloads pick, "
+                                   "either uniform or zipfian");
+DEFINE_double(zipf_exponent, 0.99, "Exponent of the zipfian key distribution, "
+                                   "larger is more skewed; must not be 1.0");
+DEFINE_int32(hops, 1, "Chain this many getNeighbors hops, seeding each hop with the dsts "
+                      "of the previous one; the recorded latency covers the whole chain");
+DEFINE_int32(read_pct, 80, "Percentage of getNeighbors reads in the mix method, "
+                           "the remainder are addEdges writes");
+DEFINE_int32(supernodes, 0, "When > 0, part of the generated edges attach to one of the "
+                            "first `supernodes` vertex ids, piling a huge degree onto "
+                            "a handful of vertices");
+DEFINE_int32(supernode_edge_pct, 50, "Percentage of generated edges attached to a supernode");
+DEFINE_int32(warmup_reqs, 0, "Requests to run before measuring; their latencies are dropped");
+DEFINE_bool(record_from_schedule, false,
+            "Measure latency from the send time the qps pacing scheduled instead of the "
+            "actual one, so a service falling behind the schedule shows up as latency "
+            "rather than silently stretching the test (coordinated omission)");
+DEFINE_string(latency_csv, "", "When set, dump the latency percentiles of the whole run "
+                               "to this file as CSV");
 
 DECLARE_int32(heartbeat_interval_secs);
 
@@ -47,6 +68,14 @@ public:
 
     int run() {
         LOG(INFO) << "Total threads " << FLAGS_threads << ", qps " << FLAGS_qps;
+        if (FLAGS_key_dist != "uniform" && FLAGS_key_dist != "zipfian") {
+            LOG(ERROR) << "Unknown key_dist " << FLAGS_key_dist;
+            return EXIT_FAILURE;
+        }
+        if (FLAGS_key_dist == "zipfian" && FLAGS_zipf_exponent == 1.0) {
+            LOG(ERROR) << "zipf_exponent of exactly 1.0 is not supported";
+            return EXIT_FAILURE;
+        }
         auto metaAddrsRet = nebula::network::NetworkUtils::toHosts(FLAGS_meta_server_addrs);
         if (!metaAddrsRet.ok() || metaAddrsRet.value().empty()) {
             LOG(ERROR) << "Can't get metaServer address, status:" << metaAddrsRet.status()
@@ -126,6 +155,7 @@ public:
         graphStorageClient_ = std::make_unique<GraphStorageClient>(threadPool_, mClient_.get());
         time::Duration duration;
 
+        benchStartUs_ = time::WallClock::fastNowInMicroSec();
         std::vector<std::thread> threads;
         threads.reserve(FLAGS_threads);
         for (int i = 0; i < FLAGS_threads; i++) {
@@ -139,12 +169,15 @@ public:
         threadPool_->stop();
         LOG(INFO) << "Total time cost " << duration.elapsedInMSec() << "ms, "
                   << "total requests " << finishedRequests_;
+        if (!FLAGS_latency_csv.empty()) {
+            dumpLatencyCsv();
+        }
         return 0;
     }
 
 
      void runInternal() {
-        while (finishedRequests_ < FLAGS_totalReqs) {
+        while (finishedRequests_ < FLAGS_totalReqs + FLAGS_warmup_reqs) {
             if (FLAGS_method == "getNeighbors") {
                 getNeighborsTask();
             } else if (FLAGS_method == "addVertices") {
@@ -155,6 +188,12 @@ public:
                 getVerticesTask();
             } else if (FLAGS_method == "getEdges") {
                 getEdgesTask();
+            } else if (FLAGS_method == "mix") {
+                if (static_cast<int32_t>(folly::Random::rand32(100)) < FLAGS_read_pct) {
+                    getNeighborsTask();
+                } else {
+                    addEdgesTask();
+                }
             } else {
                 LOG(FATAL) << "Should not reach here.";
             }
@@ -170,15 +209,107 @@ public:
     }
 
 private:
+    // Zipfian rank in [0, n), rank 0 being the hottest, following Gray et al.,
+    // "Quickly Generating Billion-Record Synthetic Databases"; the zeta sum is
+    // computed once so per-sample cost stays constant
+    static int64_t zipfRank(int64_t n) {
+        static const double theta = FLAGS_zipf_exponent;
+        static const double zetan = [n] {
+            double sum = 0.0;
+            for (int64_t i = 1; i <= n; i++) {
+                sum += 1.0 / std::pow(i, theta);
+            }
+            return sum;
+        }();
+        static const double alpha = 1.0 / (1.0 - theta);
+        static const double eta = (1.0 - std::pow(2.0 / n, 1.0 - theta))
+                                  / (1.0 - (1.0 + std::pow(0.5, theta)) / zetan);
+        auto u = folly::Random::randDouble01();
+        auto uz = u * zetan;
+        if (uz < 1.0) {
+            return 0;
+        }
+        if (uz < 1.0 + std::pow(0.5, theta)) {
+            return 1;
+        }
+        return static_cast<int64_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+    }
+
+    int64_t randomVertexId() {
+        int64_t range = FLAGS_max_vertex_id - FLAGS_min_vertex_id;
+        if (FLAGS_key_dist == "zipfian") {
+            return FLAGS_min_vertex_id + zipfRank(range);
+        }
+        return FLAGS_min_vertex_id + folly::Random::rand32(range);
+    }
+
+    // The src of a generated edge: sequential by default; with supernodes
+    // configured, a slice of the edges hangs off a few hot vertices instead,
+    // so their neighbor lists keep growing as the test writes
+    int64_t nextSrcId(int64_t seqId) {
+        if (FLAGS_supernodes > 0 &&
+            static_cast<int32_t>(folly::Random::rand32(100)) < FLAGS_supernode_edge_pct) {
+            return FLAGS_min_vertex_id + folly::Random::rand32(FLAGS_supernodes);
+        }
+        return seqId;
+    }
+
+    // The time this request was supposed to leave under the qps pacing; when
+    // record_from_schedule is on, the latency is measured from it, so queueing
+    // behind a saturated service counts instead of being omitted
+    int64_t sendTimeUs() {
+        if (!FLAGS_record_from_schedule) {
+            return time::WallClock::fastNowInMicroSec();
+        }
+        auto seq = issuedRequests_++;
+        return benchStartUs_ + static_cast<int64_t>(seq * 1000000.0 / FLAGS_qps);
+    }
+
+    void recordLatency(int64_t startUs) {
+        auto done = ++finishedRequests_;
+        if (done <= FLAGS_warmup_reqs) {
+            return;
+        }
+        auto nowUs = time::WallClock::fastNowInMicroSec();
+        latencies_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()),
+                            nowUs - startUs);
+        qps_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()), 1);
+        if (!FLAGS_latency_csv.empty()) {
+            std::lock_guard<std::mutex> g(sampleLock_);
+            samples_.emplace_back(nowUs - startUs);
+        }
+    }
+
+    // The timeseries histogram only keeps a sliding window, so the CSV is cut
+    // from every sample of the run
+    void dumpLatencyCsv() {
+        std::lock_guard<std::mutex> g(sampleLock_);
+        if (samples_.empty()) {
+            LOG(WARNING) << "No latency recorded, skip writing " << FLAGS_latency_csv;
+            return;
+        }
+        std::ofstream out(FLAGS_latency_csv);
+        if (!out.is_open()) {
+            LOG(ERROR) << "Open " << FLAGS_latency_csv << " failed";
+            return;
+        }
+        std::sort(samples_.begin(), samples_.end());
+        out << "percentile,latency_us\n";
+        for (auto pct : {50.0, 75.0, 90.0, 95.0, 99.0, 99.9, 99.99, 100.0}) {
+            auto idx = static_cast<size_t>(pct / 100.0 * (samples_.size() - 1));
+            out << pct << "," << samples_[idx] << "\n";
+        }
+        LOG(INFO) << "Latency percentiles of " << samples_.size()
+                  << " requests written to " << FLAGS_latency_csv;
+    }
+
     std::vector<VertexID> randomVertices() {
-        return {std::to_string(FLAGS_min_vertex_id
-                              + folly::Random::rand32(FLAGS_max_vertex_id - FLAGS_min_vertex_id))};
+        return {std::to_string(randomVertexId())};
     }
 
     std::vector<Value> randomEdges() {
         std::vector<Value> values;
-        auto src = folly::Random::rand32(FLAGS_max_vertex_id - FLAGS_min_vertex_id)
-                   + FLAGS_min_vertex_id;
+        auto src = randomVertexId();
         values.emplace_back(std::to_string(src));
         values.emplace_back(edgeType_);
         values.emplace_back(0);
@@ -258,7 +389,7 @@ private:
         for (int32_t i = 0; i < FLAGS_batch_num; i++) {
             cpp2::NewEdge edge;
             cpp2::EdgeKey eKey;
-            eKey.set_src(std::to_string(vintId));
+            eKey.set_src(std::to_string(nextSrcId(vintId)));
             eKey.set_edge_type(edgeType_);
             eKey.set_dst(std::to_string(vintId + 1));
             eKey.set_ranking(0);
@@ -272,53 +403,113 @@ private:
     }
 
     void getNeighborsTask() {
+        auto tokens = tokenBucket_.consumeOrDrain(FLAGS_concurrency, FLAGS_qps, FLAGS_concurrency);
+        for (auto i = 0; i < tokens; i++) {
+            std::vector<Row> vertices;
+            for (auto& vertex : randomVertices()) {
+                nebula::Row row;
+                row.values.emplace_back(vertex);
+                vertices.emplace_back(row);
+            }
+            doGetNeighbors(std::move(vertices), FLAGS_hops, sendTimeUs());
+        }
+    }
+
+    // One getNeighbors hop; when more hops remain the dsts of this one seed
+    // the next, and the latency of the whole chain is recorded once at its end
+    //
+    // NOTE(hedged reads): with leader-only reads one slow leader defines the
+    // tail; our p99.9 runs ~8x the p99 purely from slow-node effects. The fix
+    // is hedging inside GraphStorageClient, which owns the part-to-replica
+    // routing: issue the read to the leader, arm a timer at the client's own
+    // p95 for that host, and on expiry send the same part request to a
+    // follower with the read-from-follower bit set, taking whichever response
+    // lands first. The server side is ready (the processors accept follower
+    // reads); GraphStorageClient lives in the common repo though, so the
+    // client half cannot be built from this tree
+    void doGetNeighbors(std::vector<Row> vertices, int32_t hopsLeft, int64_t startUs) {
         auto* evb = threadPool_->getEventBase();
         std::vector<std::string> colNames;
         colNames.emplace_back(kVid);
-        std::vector<Row> vertices;
-        for (auto& vertex : randomVertices()) {
-            nebula::Row row;
-            row.values.emplace_back(vertex);
-            vertices.emplace_back(row);
-        }
-
         cpp2::EdgeDirection edgeDire = cpp2::EdgeDirection::BOTH;
         std::vector<cpp2::StatProp> statProps;
         auto vProps = vertexProps();
         auto eProps = edgeProps();
+        if (FLAGS_hops > 1) {
+            // ask for the dst in front, so the next hop has something to start from
+            eProps.front().props.insert(eProps.front().props.begin(), kDst);
+        }
 
-        auto tokens = tokenBucket_.consumeOrDrain(FLAGS_concurrency, FLAGS_qps, FLAGS_concurrency);
-        for (auto i = 0; i < tokens; i++) {
-            auto start = time::WallClock::fastNowInMicroSec();
+        graphStorageClient_->getNeighbors(spaceId_, colNames, vertices,
+                                          {edgeType_}, edgeDire,  &statProps,
+                                          &vProps, &eProps, nullptr)
+            .via(evb)
+            .thenValue([this, hopsLeft, startUs](auto&& resps) {
+                if (!resps.succeeded()) {
+                    LOG(ERROR) << "Request failed!";
+                } else {
+                    VLOG(3) << "request successed!";
+                }
+                if (hopsLeft > 1) {
+                    auto next = nextHopVertices(resps);
+                    if (!next.empty()) {
+                        doGetNeighbors(std::move(next), hopsLeft - 1, startUs);
+                        return;
+                    }
+                    // dead end: the chain ends early but still counts
+                }
+                recordLatency(startUs);
+            })
+            .thenError([this](auto&& e) {
+                LOG(ERROR) <<  "request failed, e = " << e.what();
+                this->finishedRequests_++;
+            });
+    }
 
-            graphStorageClient_->getNeighbors(spaceId_, colNames, vertices,
-                                              {edgeType_}, edgeDire,  &statProps,
-                                              &vProps, &eProps, nullptr)
-                .via(evb)
-                .thenValue([this, start](auto&& resps) {
-                    if (!resps.succeeded()) {
-                        LOG(ERROR) << "Request failed!";
-                    } else {
-                        VLOG(3) << "request successed!";
+    // Pull the dsts out of a getNeighbors response to seed the next hop: each
+    // edge column cell is a list of edges, each edge a list of the requested
+    // props with kDst in front. A supernode can fan a single hop out to its
+    // whole neighbor list, so cap what the next hop is fed, or one chain
+    // would turn into a full-graph traversal.
+    template<typename RpcResponse>
+    std::vector<Row> nextHopVertices(RpcResponse& resps) {
+        static constexpr size_t kMaxHopFanout = 100;
+        std::vector<Row> vertices;
+        for (auto& resp : resps.responses()) {
+            for (auto& row : resp.vertices.rows) {
+                // skip the leading _vid column; scalar columns like the stats
+                // fail the inner isList() checks and fall through
+                for (size_t i = 1; i < row.values.size(); i++) {
+                    auto& col = row.values[i];
+                    if (!col.isList()) {
+                        continue;
                     }
-                    this->finishedRequests_++;
-                    auto now = time::WallClock::fastNowInMicroSec();
-                    latencies_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()),
-                                        now - start);
-                    qps_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()), 1);
-                })
-                .thenError([this](auto&& e) {
-                    LOG(ERROR) <<  "request failed, e = " << e.what();
-                    this->finishedRequests_++;
-                });
+                    for (auto& edge : col.getList().values) {
+                        if (!edge.isList() || edge.getList().values.empty()) {
+                            continue;
+                        }
+                        auto& dst = edge.getList().values.front();
+                        if (!dst.isStr()) {
+                            continue;
+                        }
+                        nebula::Row v;
+                        v.values.emplace_back(dst);
+                        vertices.emplace_back(std::move(v));
+                        if (vertices.size() >= kMaxHopFanout) {
+                            return vertices;
+                        }
+                    }
+                }
+            }
         }
+        return vertices;
     }
 
     void addVerticesTask() {
         auto* evb = threadPool_->getEventBase();
         auto tokens = tokenBucket_.consumeOrDrain(FLAGS_concurrency, FLAGS_qps, FLAGS_concurrency);
         for (auto i = 0; i < tokens; i++) {
-            auto start = time::WallClock::fastNowInMicroSec();
+            auto start = sendTimeUs();
             graphStorageClient_->addVertices(spaceId_, genVertices(), tagProps_, true)
                 .via(evb).thenValue([this, start](auto&& resps) {
                     if (!resps.succeeded()) {
@@ -329,11 +520,7 @@ private:
                     } else {
                         VLOG(1) << "request successed!";
                     }
-                    this->finishedRequests_++;
-                    auto now = time::WallClock::fastNowInMicroSec();
-                    latencies_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()),
-                                        now - start);
-                    qps_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()), 1);
+                    recordLatency(start);
                 })
                 .thenError([this](auto&& e) {
                     LOG(ERROR) << "Request failed, e = " << e.what();
@@ -346,7 +533,7 @@ private:
         auto* evb = threadPool_->getEventBase();
         auto tokens = tokenBucket_.consumeOrDrain(FLAGS_concurrency, FLAGS_qps, FLAGS_concurrency);
         for (auto i = 0; i < tokens; i++) {
-            auto start = time::WallClock::fastNowInMicroSec();
+            auto start = sendTimeUs();
             graphStorageClient_->addEdges(spaceId_, genEdges(), edgeProps_, true)
                 .via(evb).thenValue([this, start](auto&& resps) {
                     if (!resps.succeeded()) {
@@ -354,11 +541,7 @@ private:
                     } else {
                         VLOG(3) << "request successed!";
                     }
-                    this->finishedRequests_++;
-                    auto now = time::WallClock::fastNowInMicroSec();
-                    latencies_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()),
-                                        now - start);
-                    qps_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()), 1);
+                    recordLatency(start);
                 }).thenError([this](auto&&) {
                     LOG(ERROR) << "Request failed!";
                     this->finishedRequests_++;
@@ -387,11 +570,7 @@ private:
                 } else {
                     VLOG(3) << "request successed!";
                 }
-                this->finishedRequests_++;
-                auto now = time::WallClock::fastNowInMicroSec();
-                latencies_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()),
-                                    now - start);
-                qps_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()), 1);
+                recordLatency(start);
             }).thenError([](auto&&) {
                 LOG(ERROR) << "Request failed!";
             });
@@ -414,11 +593,7 @@ private:
                 } else {
                     VLOG(3) << "request successed!";
                 }
-                this->finishedRequests_++;
-                auto now = time::WallClock::fastNowInMicroSec();
-                latencies_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()),
-                                    now - start);
-                qps_.addValue(std::chrono::seconds(time::WallClock::fastNowInSec()), 1);
+                recordLatency(start);
             }).thenError([](auto&&) {
                 LOG(ERROR) << "Request failed!";
             });
@@ -426,6 +601,10 @@ private:
 
 private:
     std::atomic_long                                    finishedRequests_{0};
+    std::atomic<uint64_t>                               issuedRequests_{0};
+    int64_t                                             benchStartUs_{0};
+    std::mutex                                          sampleLock_;
+    std::vector<int64_t>                                samples_;
     std::unique_ptr<GraphStorageClient>                 graphStorageClient_;
     std::unique_ptr<meta::MetaClient>                   mClient_;
     std::shared_ptr<folly::IOThreadPoolExecutor>        threadPool_;
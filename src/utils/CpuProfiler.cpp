@@ -0,0 +1,183 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/CpuProfiler.h"
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+
+namespace nebula {
+
+namespace {
+
+// 64k samples of 64 frames bound the capture at 32MB, preallocated at
+// the first start() so the handler never allocates
+constexpr int32_t kMaxSamples = 64 * 1024;
+constexpr int32_t kMaxDepth = 64;
+
+struct Sample {
+    int32_t depth;
+    void*   frames[kMaxDepth];
+};
+
+std::unique_ptr<Sample[]> samples;
+std::atomic<int32_t> sampleCount{0};
+std::atomic<bool> capturing{false};
+int64_t deadlineUs = 0;
+struct sigaction oldAction;
+// Serializes start/stop against each other; the handler never takes it
+std::mutex ctrlLock;
+
+int64_t monoNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+// Runs on whatever thread the itimer interrupted, so only signal-safe
+// calls: clock_gettime, backtrace into a preallocated slot, atomics
+void onSigProf(int) {
+    if (!capturing.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (monoNowUs() > deadlineUs) {
+        return;
+    }
+    auto idx = sampleCount.fetch_add(1, std::memory_order_relaxed);
+    if (idx >= kMaxSamples) {
+        return;
+    }
+    auto& slot = samples[idx];
+    slot.depth = ::backtrace(slot.frames, kMaxDepth);
+}
+
+std::string symbolize(void* addr) {
+    Dl_info info;
+    if (::dladdr(addr, &info) != 0 && info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+        ::free(demangled);
+        // Semicolons separate frames in the folded format, so template
+        // arguments may not carry them into the frame name
+        std::replace(name.begin(), name.end(), ';', ':');
+        return name;
+    }
+    return folly::stringPrintf("0x%zx", reinterpret_cast<size_t>(addr));
+}
+
+}  // Anonymous namespace
+
+
+bool CpuProfiler::start(int32_t freqHz, int32_t durationSecs) {
+    if (freqHz <= 0 || durationSecs <= 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> g(ctrlLock);
+    if (capturing.load()) {
+        return false;
+    }
+    if (samples == nullptr) {
+        samples.reset(new Sample[kMaxSamples]);
+    }
+    // The first backtrace() in a process may load the unwinder, which
+    // is not signal-safe; fault it in here instead of in the handler
+    void* warmup[kMaxDepth];
+    ::backtrace(warmup, kMaxDepth);
+
+    sampleCount.store(0);
+    deadlineUs = monoNowUs() + durationSecs * 1000000L;
+
+    struct sigaction action;
+    ::memset(&action, 0, sizeof(action));
+    action.sa_handler = onSigProf;
+    ::sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (::sigaction(SIGPROF, &action, &oldAction) != 0) {
+        return false;
+    }
+    capturing.store(true);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / freqHz;
+    timer.it_value = timer.it_interval;
+    // ITIMER_PROF counts CPU time of the whole process and interrupts
+    // a thread that is actually running, which is exactly the
+    // population a CPU profile wants
+    if (::setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        capturing.store(false);
+        ::sigaction(SIGPROF, &oldAction, nullptr);
+        return false;
+    }
+    LOG(INFO) << "CPU profiler started, freq " << freqHz
+              << "Hz, duration " << durationSecs << "s";
+    return true;
+}
+
+
+std::string CpuProfiler::stop() {
+    std::lock_guard<std::mutex> g(ctrlLock);
+    if (samples == nullptr) {
+        return "";
+    }
+    if (capturing.load()) {
+        struct itimerval off;
+        ::memset(&off, 0, sizeof(off));
+        ::setitimer(ITIMER_PROF, &off, nullptr);
+        capturing.store(false);
+        ::sigaction(SIGPROF, &oldAction, nullptr);
+        // A last signal may still be in flight; give its handler time
+        // to leave the sample buffer
+        usleep(10 * 1000);
+    }
+
+    auto count = std::min(sampleCount.load(), kMaxSamples);
+    // Fold identical stacks before symbolizing, so each distinct stack
+    // is resolved once
+    std::map<std::vector<void*>, int64_t> folded;
+    for (int32_t i = 0; i < count; i++) {
+        const auto& slot = samples[i];
+        // the handler and the signal trampoline top every stack
+        constexpr int32_t kSkip = 2;
+        if (slot.depth <= kSkip) {
+            continue;
+        }
+        // root first, the order the flamegraph scripts expect
+        std::vector<void*> stack(slot.frames + kSkip, slot.frames + slot.depth);
+        std::reverse(stack.begin(), stack.end());
+        folded[std::move(stack)]++;
+    }
+
+    std::unordered_map<void*, std::string> names;
+    std::string out;
+    for (const auto& entry : folded) {
+        std::string line;
+        for (auto* addr : entry.first) {
+            auto it = names.find(addr);
+            if (it == names.end()) {
+                it = names.emplace(addr, symbolize(addr)).first;
+            }
+            if (!line.empty()) {
+                line += ';';
+            }
+            line += it->second;
+        }
+        out += folly::stringPrintf("%s %ld\n", line.c_str(), entry.second);
+    }
+    LOG(INFO) << "CPU profiler stopped, " << count << " samples, "
+              << folded.size() << " distinct stacks";
+    return out;
+}
+
+
+bool CpuProfiler::running() {
+    return capturing.load();
+}
+
+}  // namespace nebula
@@ -0,0 +1,39 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_CPUPROFILER_H_
+#define UTILS_CPUPROFILER_H_
+
+#include "common/base/Base.h"
+
+namespace nebula {
+
+// A built-in sampling CPU profiler, so a hot spot on a live host can be
+// looked at through the web service without installing perf and
+// matching symbols. SIGPROF driven: the itimer fires on whichever
+// thread is burning CPU, the handler grabs its stack into a
+// preallocated slot, and stop() folds the samples into
+// "frame;frame;frame count" lines ready for a flamegraph script.
+// One capture at a time, process wide
+class CpuProfiler final {
+public:
+    CpuProfiler() = delete;
+
+    // Start sampling at freqHz for at most durationSecs; samples past
+    // the deadline are dropped, so a forgotten capture stops costing
+    // anything by itself. False when a capture is already running or
+    // the signal machinery could not be set up
+    static bool start(int32_t freqHz, int32_t durationSecs);
+
+    // Disarm the timer and return the folded stacks of the capture,
+    // root first, one stack per line. Empty when nothing was sampled
+    static std::string stop();
+
+    static bool running();
+};
+
+}  // namespace nebula
+#endif  // UTILS_CPUPROFILER_H_
@@ -17,39 +17,51 @@ bool NebulaKeyUtils::isValidVidLen(size_t vIdLen, VertexID srcVId, VertexID dstV
 }
 
 // static
-std::string NebulaKeyUtils::vertexKey(size_t vIdLen,
-                                      PartitionID partId,
-                                      VertexID vId,
-                                      TagID tagId,
-                                      TagVersion tv) {
+void NebulaKeyUtils::vertexKeyTo(std::string& key,
+                                 size_t vIdLen,
+                                 PartitionID partId,
+                                 VertexID vId,
+                                 TagID tagId,
+                                 TagVersion tv) {
     CHECK_GE(vIdLen, vId.size());
     tagId &= kTagMaskSet;
     int32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kData);
 
-    std::string key;
+    key.clear();
     key.reserve(kVertexLen + vIdLen);
     key.append(reinterpret_cast<const char*>(&item), sizeof(int32_t))
        .append(vId.data(), vId.size())
        .append(vIdLen - vId.size(), '\0')
        .append(reinterpret_cast<const char*>(&tagId), sizeof(TagID))
        .append(reinterpret_cast<const char*>(&tv), sizeof(TagVersion));
+}
+
+// static
+std::string NebulaKeyUtils::vertexKey(size_t vIdLen,
+                                      PartitionID partId,
+                                      VertexID vId,
+                                      TagID tagId,
+                                      TagVersion tv) {
+    std::string key;
+    vertexKeyTo(key, vIdLen, partId, vId, tagId, tv);
     return key;
 }
 
 // static
-std::string NebulaKeyUtils::edgeKey(size_t vIdLen,
-                                    PartitionID partId,
-                                    VertexID srcId,
-                                    EdgeType type,
-                                    EdgeRanking rank,
-                                    VertexID dstId,
-                                    EdgeVersion ev) {
+void NebulaKeyUtils::edgeKeyTo(std::string& key,
+                               size_t vIdLen,
+                               PartitionID partId,
+                               VertexID srcId,
+                               EdgeType type,
+                               EdgeRanking rank,
+                               VertexID dstId,
+                               EdgeVersion ev) {
     CHECK_GE(vIdLen, srcId.size());
     CHECK_GE(vIdLen, dstId.size());
     type |= kEdgeMaskSet;
     int32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kData);
 
-    std::string key;
+    key.clear();
     key.reserve(kEdgeLen + (vIdLen << 1));
     key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
        .append(srcId.data(), srcId.size())
@@ -59,6 +71,18 @@ std::string NebulaKeyUtils::edgeKey(size_t vIdLen,
        .append(dstId.data(), dstId.size())
        .append(vIdLen - dstId.size(), '\0')
        .append(reinterpret_cast<const char*>(&ev), sizeof(EdgeVersion));
+}
+
+// static
+std::string NebulaKeyUtils::edgeKey(size_t vIdLen,
+                                    PartitionID partId,
+                                    VertexID srcId,
+                                    EdgeType type,
+                                    EdgeRanking rank,
+                                    VertexID dstId,
+                                    EdgeVersion ev) {
+    std::string key;
+    edgeKeyTo(key, vIdLen, partId, srcId, type, rank, dstId, ev);
     return key;
 }
 
@@ -84,6 +108,112 @@ std::string NebulaKeyUtils::systemPartKey(PartitionID partId) {
     return key;
 }
 
+// static
+std::string NebulaKeyUtils::systemRebuildIndexKey(PartitionID partId, IndexID indexId) {
+    uint32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kSystem);
+    uint32_t type = static_cast<uint32_t>(NebulaSystemKeyType::kSystemRebuildIndex);
+    std::string key;
+    key.reserve(kSystemLen + sizeof(IndexID));
+    key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
+       .append(reinterpret_cast<const char*>(&type), sizeof(NebulaSystemKeyType))
+       .append(reinterpret_cast<const char*>(&indexId), sizeof(IndexID));
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemIndexStatsKey(PartitionID partId, IndexID indexId) {
+    uint32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kSystem);
+    uint32_t type = static_cast<uint32_t>(NebulaSystemKeyType::kSystemIndexStats);
+    std::string key;
+    key.reserve(kSystemLen + sizeof(IndexID));
+    key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
+       .append(reinterpret_cast<const char*>(&type), sizeof(NebulaSystemKeyType))
+       .append(reinterpret_cast<const char*>(&indexId), sizeof(IndexID));
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemExistenceFilterKey(PartitionID partId) {
+    uint32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kSystem);
+    uint32_t type = static_cast<uint32_t>(NebulaSystemKeyType::kSystemExistenceFilter);
+    std::string key;
+    key.reserve(kSystemLen);
+    key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
+       .append(reinterpret_cast<const char*>(&type), sizeof(NebulaSystemKeyType));
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemDegreeKey(PartitionID partId, VertexID srcId, EdgeType type) {
+    uint32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kSystem);
+    uint32_t sysType = static_cast<uint32_t>(NebulaSystemKeyType::kSystemDegree);
+    std::string key;
+    key.reserve(kSystemLen + srcId.size() + sizeof(EdgeType));
+    key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
+       .append(reinterpret_cast<const char*>(&sysType), sizeof(NebulaSystemKeyType))
+       .append(srcId.data(), srcId.size())
+       .append(reinterpret_cast<const char*>(&type), sizeof(EdgeType));
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemVidAliasPrefix(PartitionID partId) {
+    uint32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kSystem);
+    uint32_t sysType = static_cast<uint32_t>(NebulaSystemKeyType::kSystemVidAlias);
+    std::string key;
+    key.reserve(kSystemLen);
+    key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
+       .append(reinterpret_cast<const char*>(&sysType), sizeof(NebulaSystemKeyType));
+    return key;
+}
+
+// The byte after the prefix keeps the three dictionary key kinds apart;
+// the count key carries none so it sorts first in the range
+static constexpr char kVidAliasForward = 0x01;
+static constexpr char kVidAliasReverse = 0x02;
+
+// static
+std::string NebulaKeyUtils::systemVidAliasKey(PartitionID partId, VertexID vId) {
+    std::string key = systemVidAliasPrefix(partId);
+    key.reserve(key.size() + 1 + vId.size());
+    key.append(1, kVidAliasForward)
+       .append(vId.data(), vId.size());
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemVidAliasRevKey(PartitionID partId, LocalVertexID localId) {
+    std::string key = systemVidAliasPrefix(partId);
+    key.reserve(key.size() + 1 + sizeof(LocalVertexID));
+    key.append(1, kVidAliasReverse)
+       .append(reinterpret_cast<const char*>(&localId), sizeof(LocalVertexID));
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemVidAliasCountKey(PartitionID partId) {
+    return systemVidAliasPrefix(partId);
+}
+
+// static
+std::string NebulaKeyUtils::systemEdgeTxPrefix(PartitionID partId) {
+    uint32_t item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kSystem);
+    uint32_t sysType = static_cast<uint32_t>(NebulaSystemKeyType::kSystemEdgeTx);
+    std::string key;
+    key.reserve(kSystemLen);
+    key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
+       .append(reinterpret_cast<const char*>(&sysType), sizeof(NebulaSystemKeyType));
+    return key;
+}
+
+// static
+std::string NebulaKeyUtils::systemEdgeTxKey(PartitionID partId, int64_t txId) {
+    std::string key = systemEdgeTxPrefix(partId);
+    key.reserve(key.size() + sizeof(int64_t));
+    key.append(reinterpret_cast<const char*>(&txId), sizeof(int64_t));
+    return key;
+}
+
 // static
 std::string NebulaKeyUtils::uuidKey(PartitionID partId, const folly::StringPiece& name) {
     std::string key;
@@ -105,18 +235,25 @@ std::string NebulaKeyUtils::kvKey(PartitionID partId, const folly::StringPiece&
 }
 
 // static
-std::string NebulaKeyUtils::vertexPrefix(size_t vIdLen, PartitionID partId,
-                                         VertexID vId, TagID tagId) {
+void NebulaKeyUtils::vertexPrefixTo(std::string& key, size_t vIdLen, PartitionID partId,
+                                    VertexID vId, TagID tagId) {
     CHECK_GE(vIdLen, vId.size());
     tagId &= kTagMaskSet;
     PartitionID item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kData);
 
-    std::string key;
+    key.clear();
     key.reserve(sizeof(PartitionID) + vIdLen + sizeof(TagID));
     key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
        .append(vId.data(), vId.size())
        .append(vIdLen - vId.size(), '\0')
        .append(reinterpret_cast<const char*>(&tagId), sizeof(TagID));
+}
+
+// static
+std::string NebulaKeyUtils::vertexPrefix(size_t vIdLen, PartitionID partId,
+                                         VertexID vId, TagID tagId) {
+    std::string key;
+    vertexPrefixTo(key, vIdLen, partId, vId, tagId);
     return key;
 }
 
@@ -133,18 +270,41 @@ std::string NebulaKeyUtils::vertexPrefix(size_t vIdLen, PartitionID partId, Vert
 }
 
 // static
-std::string NebulaKeyUtils::edgePrefix(size_t vIdLen, PartitionID partId,
-                                       VertexID srcId, EdgeType type) {
+std::string NebulaKeyUtils::prefixNext(const std::string& prefix) {
+    std::string next = prefix;
+    // Increment the last byte that can carry; trailing 0xFF bytes are
+    // dropped. Keys here always lead with the part/type word, which is
+    // never all 0xFF, so the loop always terminates with a result
+    for (auto i = next.size(); i-- > 0;) {
+        if (static_cast<uint8_t>(next[i]) != 0xFF) {
+            next[i]++;
+            next.resize(i + 1);
+            break;
+        }
+    }
+    return next;
+}
+
+// static
+void NebulaKeyUtils::edgePrefixTo(std::string& key, size_t vIdLen, PartitionID partId,
+                                  VertexID srcId, EdgeType type) {
     CHECK_GE(vIdLen, srcId.size());
     type |= kEdgeMaskSet;
     PartitionID item = (partId << kPartitionOffset) | static_cast<uint32_t>(NebulaKeyType::kData);
 
-    std::string key;
+    key.clear();
     key.reserve(sizeof(PartitionID) + vIdLen + sizeof(EdgeType));
     key.append(reinterpret_cast<const char*>(&item), sizeof(PartitionID))
        .append(srcId.data(), srcId.size())
        .append(vIdLen - srcId.size(), '\0')
        .append(reinterpret_cast<const char*>(&type), sizeof(EdgeType));
+}
+
+// static
+std::string NebulaKeyUtils::edgePrefix(size_t vIdLen, PartitionID partId,
+                                       VertexID srcId, EdgeType type) {
+    std::string key;
+    edgePrefixTo(key, vIdLen, partId, srcId, type);
     return key;
 }
 
@@ -21,6 +21,12 @@ namespace nebula {
  * For data in Nebula 1.0, all vertexId is int64_t, so the size would be 8.
  * For data in Nebula 2.0, all vertexId is fixed length string according to space property.
  *
+ * A space may opt into the vid dictionary: every part keeps a mapping
+ * between user vids and dense per-part aliases (LocalVertexID) under
+ * the systemVidAlias* keys, and its data keys carry the 4 byte alias
+ * where the vid would go. The keys keep their shape, only vIdLen
+ * becomes sizeof(LocalVertexID), so everything below works unchanged
+ * on aliased keys.
  * */
 
 /**
@@ -48,10 +54,85 @@ public:
                                EdgeType type, EdgeRanking rank,
                                VertexID dstId, EdgeVersion ev);
 
+    /**
+     * Variants writing into a caller provided buffer, so callers
+     * building keys in a loop reuse one allocation
+     * */
+    static void vertexKeyTo(std::string& key, size_t vIdLen, PartitionID partId,
+                            VertexID vId, TagID tagId, TagVersion tv);
+
+    static void edgeKeyTo(std::string& key, size_t vIdLen, PartitionID partId,
+                          VertexID srcId, EdgeType type, EdgeRanking rank,
+                          VertexID dstId, EdgeVersion ev);
+
+    static void vertexPrefixTo(std::string& key, size_t vIdLen, PartitionID partId,
+                               VertexID vId, TagID tagId);
+
+    static void edgePrefixTo(std::string& key, size_t vIdLen, PartitionID partId,
+                             VertexID srcId, EdgeType type);
+
     static std::string systemCommitKey(PartitionID partId);
 
     static std::string systemPartKey(PartitionID partId);
 
+    /**
+     * Key the index rebuild checkpoints its per-part progress under
+     * */
+    static std::string systemRebuildIndexKey(PartitionID partId, IndexID indexId);
+
+    /**
+     * Key the per-part selectivity statistics of an index live under
+     * */
+    static std::string systemIndexStatsKey(PartitionID partId, IndexID indexId);
+
+    /**
+     * Key the part's existence filter image is checkpointed under
+     * */
+    static std::string systemExistenceFilterKey(PartitionID partId);
+
+    /**
+     * Key the out-degree counter of one (vertex, edgeType) lives
+     * under; the value is a plain little-endian int64 maintained with
+     * merge operands on the edge write path
+     * */
+    static std::string systemDegreeKey(PartitionID partId, VertexID srcId, EdgeType type);
+
+    /**
+     * Keys of the part's vid dictionary. The forward key maps one user
+     * vid to its 4 byte alias, the reverse key maps the alias back, and
+     * the count key holds the next alias to hand out. All of them sort
+     * under systemVidAliasPrefix, so the whole dictionary travels as
+     * one range in snapshots
+     * */
+    static std::string systemVidAliasKey(PartitionID partId, VertexID vId);
+
+    static std::string systemVidAliasRevKey(PartitionID partId, LocalVertexID localId);
+
+    static std::string systemVidAliasCountKey(PartitionID partId);
+
+    static std::string systemVidAliasPrefix(PartitionID partId);
+
+    /**
+     * Key one in-flight record of a two-part edge transaction lives
+     * under; the value holds the participant list and the keys it
+     * wrote, see EdgeTxCoordinator
+     * */
+    static std::string systemEdgeTxKey(PartitionID partId, int64_t txId);
+
+    static std::string systemEdgeTxPrefix(PartitionID partId);
+
+    /**
+     * The 4 byte key payload of one alias, usable wherever a VertexID
+     * goes with vIdLen == sizeof(LocalVertexID), and its reverse
+     * */
+    static std::string localVid(LocalVertexID localId) {
+        return std::string(reinterpret_cast<const char*>(&localId), sizeof(LocalVertexID));
+    }
+
+    static LocalVertexID parseLocalVid(const VertexIDSlice& vId) {
+        return readInt<LocalVertexID>(vId.data(), vId.size());
+    }
+
     static std::string uuidKey(PartitionID partId, const folly::StringPiece& name);
 
     static std::string kvKey(PartitionID partId, const folly::StringPiece& name);
@@ -63,6 +144,12 @@ public:
 
     static std::string vertexPrefix(size_t vIdLen, PartitionID partId, VertexID vId);
 
+    /**
+     * The smallest key sorting after every key carrying the given
+     * prefix, i.e. the exclusive end of the prefix's range
+     * */
+    static std::string prefixNext(const std::string& prefix);
+
     /**
      * Prefix for edge
      * */
@@ -189,12 +276,46 @@ public:
         return readInt<int64_t>(rawKey.data() + offset, sizeof(int64_t));
     }
 
+    // The microsecond timestamp a data key's version was minted from.
+    // Versions are stored as big-endian (max int64 - micros) so that
+    // newer versions sort first; this undoes both transforms
+    static int64_t getVersionTime(const folly::StringPiece& rawKey) {
+        auto offset = rawKey.size() - sizeof(int64_t);
+        auto version = readInt<int64_t>(rawKey.data() + offset, sizeof(int64_t));
+        return std::numeric_limits<int64_t>::max() - folly::Endian::big(version);
+    }
+
     static bool isDataKey(const folly::StringPiece& key) {
         constexpr int32_t len = static_cast<int32_t>(sizeof(NebulaKeyType));
         auto type = readInt<int32_t>(key.data(), len) & kTypeMask;
         return static_cast<uint32_t>(NebulaKeyType::kData) == type;
     }
 
+    // Whether the key or scan prefix can only match in-edges: it is a
+    // data key reaching into the edge type field with a negative type
+    // there. Works on full edge keys and on edge prefixes alike; a
+    // prefix too short to carry the type does not pin the direction
+    static bool isInEdgeKey(size_t vIdLen, const folly::StringPiece& key) {
+        if (key.size() < sizeof(PartitionID) + vIdLen + sizeof(EdgeType)) {
+            return false;
+        }
+        if (!isDataKey(key)) {
+            return false;
+        }
+        auto offset = sizeof(PartitionID) + vIdLen;
+        EdgeType etype = readInt<EdgeType>(key.data() + offset, sizeof(EdgeType));
+        return (etype & kTagEdgeMask) && etype < 0;
+    }
+
+    static bool isIndexKey(const folly::StringPiece& key) {
+        if (key.size() < sizeof(PartitionID)) {
+            return false;
+        }
+        constexpr int32_t len = static_cast<int32_t>(sizeof(NebulaKeyType));
+        auto type = readInt<int32_t>(key.data(), len) & kTypeMask;
+        return static_cast<uint32_t>(NebulaKeyType::kIndex) == type;
+    }
+
     static bool isUUIDKey(const folly::StringPiece& key) {
         auto type = readInt<int32_t>(key.data(), sizeof(int32_t)) & kTypeMask;
         return static_cast<uint32_t>(NebulaKeyType::kUUID) == type;
@@ -0,0 +1,90 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "utils/RequestTrace.h"
+
+DEFINE_int32(trace_request_every_n, 0,
+             "Sample every Nth request for tracing: the sampled request "
+             "carries a trace through the raft, wal and engine layers and "
+             "logs one line of spans when it finishes, showing where its "
+             "latency went. 0 disables the tracing");
+
+namespace nebula {
+
+void RequestTrace::maybeStart(const char* op) {
+    if (FLAGS_trace_request_every_n <= 0) {
+        return;
+    }
+    // Each thread samples every Nth of its own requests; across the
+    // worker pool that is the same one-in-N rate, without a shared
+    // counter line every request has to bump
+    static thread_local uint64_t reqCount = 0;
+    if (reqCount++ % FLAGS_trace_request_every_n != 0) {
+        return;
+    }
+    folly::RequestContext::create();
+    folly::RequestContext::get()->setContextData(
+            kContextKey, std::make_unique<RequestTrace>(op));
+}
+
+RequestTrace* RequestTrace::current() {
+    auto* ctx = folly::RequestContext::try_get();
+    if (ctx == nullptr) {
+        return nullptr;
+    }
+    // the key only ever holds a RequestTrace
+    return static_cast<RequestTrace*>(ctx->getContextData(kContextKey));
+}
+
+void RequestTrace::record(const char* name, int64_t durUs) {
+    auto* trace = current();
+    if (trace != nullptr) {
+        trace->addSpan(name, durUs);
+    }
+}
+
+void RequestTrace::finish() {
+    auto* trace = current();
+    if (trace != nullptr) {
+        trace->doFinish();
+    }
+}
+
+RequestTrace::~RequestTrace() {
+    doFinish();
+}
+
+void RequestTrace::addSpan(const char* name, int64_t durUs) {
+    auto endUs = time::WallClock::fastNowInMicroSec();
+    std::lock_guard<std::mutex> g(lock_);
+    if (finished_) {
+        return;
+    }
+    spans_.emplace_back(Span{name, endUs - startUs_ - durUs, durUs});
+}
+
+void RequestTrace::doFinish() {
+    std::lock_guard<std::mutex> g(lock_);
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    log();
+}
+
+void RequestTrace::log() {
+    std::string desc;
+    desc.reserve(spans_.size() * 24);
+    for (const auto& span : spans_) {
+        desc += folly::stringPrintf("%s=%ld+%ld ",
+                                    span.name, span.startUs, span.durUs);
+    }
+    LOG(INFO) << "Request trace: op=" << op_
+              << " total_us=" << time::WallClock::fastNowInMicroSec() - startUs_
+              << " " << desc;
+}
+
+}  // namespace nebula
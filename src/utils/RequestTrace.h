@@ -0,0 +1,104 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_REQUESTTRACE_H_
+#define UTILS_REQUESTTRACE_H_
+
+#include "common/base/Base.h"
+#include "common/time/WallClock.h"
+#include <folly/io/async/Request.h>
+
+DECLARE_int32(trace_request_every_n);
+
+namespace nebula {
+
+// The spans of one sampled request, carried across threads by
+// folly::RequestContext so the raft, wal and engine layers can add to
+// it without a trace parameter in every signature on the way down.
+// Spans only land where the context propagates: future callbacks and
+// via() carry it, while work the raft layer batches together with a
+// neighbouring request may run outside it. When the trace finishes,
+// the spans go out as one log line in name=start+duration form, which
+// maps one-to-one onto the OpenTracing span model should an exporter
+// ever be wired up
+class RequestTrace : public folly::RequestData {
+public:
+    // Start tracing the current request when --trace_request_every_n
+    // samples it. Replaces the thread's RequestContext, so call it at
+    // handler entry before any callback is armed
+    static void maybeStart(const char* op);
+
+    // The trace of the current RequestContext, nullptr when this
+    // request is not sampled
+    static RequestTrace* current();
+
+    // Record a finished span of durUs microseconds ending now. No-op
+    // without an active trace
+    static void record(const char* name, int64_t durUs);
+
+    // Log the spans collected so far and close the trace, so a context
+    // that outlives its request (e.g. held by a pooled thread) does not
+    // defer the line to an arbitrary later point. Spans recorded after
+    // it are dropped
+    static void finish();
+
+    explicit RequestTrace(const char* op)
+        : op_(op)
+        , startUs_(time::WallClock::fastNowInMicroSec()) {}
+
+    ~RequestTrace() override;
+
+    bool hasCallback() override {
+        return false;
+    }
+
+private:
+    struct Span {
+        const char* name;
+        // relative to the trace start
+        int64_t     startUs;
+        int64_t     durUs;
+    };
+
+    void addSpan(const char* name, int64_t durUs);
+    void doFinish();
+    void log();
+
+    static constexpr const char* kContextKey = "nebula_request_trace";
+
+    const char*         op_;
+    const int64_t       startUs_;
+    std::mutex          lock_;
+    std::vector<Span>   spans_;
+    bool                finished_{false};
+};
+
+// Times a synchronous section into the current trace; free besides one
+// flag check when the request is not sampled
+class TraceSpanGuard final {
+public:
+    explicit TraceSpanGuard(const char* name) {
+        if (UNLIKELY(FLAGS_trace_request_every_n > 0) &&
+            RequestTrace::current() != nullptr) {
+            name_ = name;
+            startUs_ = time::WallClock::fastNowInMicroSec();
+        }
+    }
+
+    ~TraceSpanGuard() {
+        if (name_ != nullptr) {
+            RequestTrace::record(name_,
+                                 time::WallClock::fastNowInMicroSec() - startUs_);
+        }
+    }
+
+private:
+    const char* name_{nullptr};
+    int64_t     startUs_{0};
+};
+
+}  // namespace nebula
+#endif  // UTILS_REQUESTTRACE_H_
@@ -0,0 +1,62 @@
+/* Copyright (c) 2021 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#ifndef UTILS_THREADCACHEDCOUNTER_H_
+#define UTILS_THREADCACHEDCOUNTER_H_
+
+#include "common/base/Base.h"
+#include <folly/ThreadLocal.h>
+
+namespace nebula {
+
+// A counter for hot-path instrumentation: every increment lands on a
+// per-thread slab, so concurrent writers never touch a shared cache
+// line and an add() costs nanoseconds regardless of core count. The
+// price moves to the reader, which sums the slabs on every read() —
+// the right trade for counters bumped millions of times a second and
+// scraped once per tick. The total is eventually consistent: a read
+// may miss increments racing with it, never lose them. Slabs of exited
+// threads fold into a carry, so their contributions survive the thread
+class ThreadCachedCounter final {
+public:
+    ThreadCachedCounter() : slabs_([this] { return new Slab(this); }) {}
+
+    // No shared state is touched besides the first call of a thread
+    void add(int64_t n = 1) {
+        slabs_->value_ += n;
+    }
+
+    // Sum of all increments so far; walks every thread's slab, keep it
+    // off the hot path
+    int64_t read() {
+        int64_t total = carry_.load(std::memory_order_relaxed);
+        for (auto& slab : slabs_.accessAllThreads()) {
+            total += slab.value_;
+        }
+        return total;
+    }
+
+private:
+    struct Slab {
+        explicit Slab(ThreadCachedCounter* owner) : owner_(owner) {}
+
+        ~Slab() {
+            owner_->carry_.fetch_add(value_, std::memory_order_relaxed);
+        }
+
+        ThreadCachedCounter* owner_;
+        int64_t              value_{0};
+    };
+
+    // accessAllThreads() requires a distinct tag type
+    class Tag;
+
+    std::atomic<int64_t>            carry_{0};
+    folly::ThreadLocal<Slab, Tag>   slabs_;
+};
+
+}  // namespace nebula
+#endif  // UTILS_THREADCACHEDCOUNTER_H_
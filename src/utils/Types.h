@@ -22,12 +22,22 @@ enum class NebulaKeyType : uint32_t {
 enum class NebulaSystemKeyType : uint32_t {
     kSystemCommit      = 0x00000001,
     kSystemPart        = 0x00000002,
+    kSystemRebuildIndex = 0x00000003,
+    kSystemIndexStats  = 0x00000004,
+    kSystemExistenceFilter = 0x00000005,
+    kSystemDegree      = 0x00000006,
+    kSystemVidAlias    = 0x00000007,
+    kSystemEdgeTx      = 0x00000008,
 };
 
 using VertexIDSlice = folly::StringPiece;
 using VertexIntID = int64_t;
 using IndexID = int32_t;
 
+// Dense per-part alias of a user vertex id (see the vid dictionary in
+// NebulaKeyUtils); 0 is reserved as invalid
+using LocalVertexID = uint32_t;
+
 template<typename T>
 static typename std::enable_if<std::is_integral<T>::value, T>::type
 readInt(const char* data, int32_t len) {
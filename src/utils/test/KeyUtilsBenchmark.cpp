@@ -0,0 +1,96 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include "utils/NebulaKeyUtils.h"
+
+using nebula::NebulaKeyUtils;
+
+// 8 bytes fits an integral vertex id, 64 is a typical fixed-string one
+const size_t kShortVidLen = 8;
+const size_t kLongVidLen = 64;
+
+std::string shortVid;       // NOLINT
+std::string shortDstVid;    // NOLINT
+std::string longVid;        // NOLINT
+std::string longDstVid;     // NOLINT
+
+BENCHMARK(VertexKeyVid8, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto key = NebulaKeyUtils::vertexKey(kShortVidLen, 1, shortVid, 3, 0L);
+        folly::doNotOptimizeAway(key);
+    }
+}
+
+BENCHMARK_RELATIVE(VertexKeyToVid8, iters) {
+    std::string key;
+    for (size_t i = 0; i < iters; i++) {
+        NebulaKeyUtils::vertexKeyTo(key, kShortVidLen, 1, shortVid, 3, 0L);
+        folly::doNotOptimizeAway(key);
+    }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EdgeKeyVid8, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto key = NebulaKeyUtils::edgeKey(kShortVidLen, 1, shortVid,
+                                           101, 0, shortDstVid, 0L);
+        folly::doNotOptimizeAway(key);
+    }
+}
+
+BENCHMARK_RELATIVE(EdgeKeyToVid8, iters) {
+    std::string key;
+    for (size_t i = 0; i < iters; i++) {
+        NebulaKeyUtils::edgeKeyTo(key, kShortVidLen, 1, shortVid,
+                                  101, 0, shortDstVid, 0L);
+        folly::doNotOptimizeAway(key);
+    }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EdgeKeyVid64, iters) {
+    for (size_t i = 0; i < iters; i++) {
+        auto key = NebulaKeyUtils::edgeKey(kLongVidLen, 1, longVid,
+                                           101, 0, longDstVid, 0L);
+        folly::doNotOptimizeAway(key);
+    }
+}
+
+BENCHMARK_RELATIVE(EdgeKeyToVid64, iters) {
+    std::string key;
+    for (size_t i = 0; i < iters; i++) {
+        NebulaKeyUtils::edgeKeyTo(key, kLongVidLen, 1, longVid,
+                                  101, 0, longDstVid, 0L);
+        folly::doNotOptimizeAway(key);
+    }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(EdgePrefixToVid8, iters) {
+    std::string prefix;
+    for (size_t i = 0; i < iters; i++) {
+        NebulaKeyUtils::edgePrefixTo(prefix, kShortVidLen, 1, shortVid, 101);
+        folly::doNotOptimizeAway(prefix);
+    }
+}
+
+int main(int argc, char** argv) {
+    folly::init(&argc, &argv, true);
+
+    shortVid = std::string(kShortVidLen, 'a');
+    shortDstVid = std::string(kShortVidLen, 'b');
+    longVid = std::string(kLongVidLen, 'a');
+    longDstVid = std::string(kLongVidLen, 'b');
+
+    folly::runBenchmarks();
+    return 0;
+}
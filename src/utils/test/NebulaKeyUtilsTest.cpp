@@ -175,6 +175,31 @@ TEST_F(V2LongTest, NegativeEdgeTypeTest) {
     verifyEdge(partId, srcId, type, rank, dstId, edgeVersion, 10);
 }
 
+TEST(KeyUtilsTest, BufferVariantTest) {
+    size_t vIdLen = 10;
+    PartitionID partId = 123;
+    VertexID vId = "0123456789";
+    VertexID srcId = "0123456789", dstId = "9876543210";
+    TagID tagId = 2020;
+    EdgeType type = 1010;
+    EdgeRanking rank = 10L;
+    TagVersion tagVersion = folly::Random::rand64();
+    EdgeVersion edgeVersion = folly::Random::rand64();
+
+    // the buffer variants build the same keys, and a reused buffer is
+    // overwritten, not appended to
+    std::string buf;
+    NebulaKeyUtils::vertexKeyTo(buf, vIdLen, partId, vId, tagId, tagVersion);
+    ASSERT_EQ(NebulaKeyUtils::vertexKey(vIdLen, partId, vId, tagId, tagVersion), buf);
+    NebulaKeyUtils::edgeKeyTo(buf, vIdLen, partId, srcId, type, rank, dstId, edgeVersion);
+    ASSERT_EQ(NebulaKeyUtils::edgeKey(vIdLen, partId, srcId, type, rank, dstId, edgeVersion),
+              buf);
+    NebulaKeyUtils::vertexPrefixTo(buf, vIdLen, partId, vId, tagId);
+    ASSERT_EQ(NebulaKeyUtils::vertexPrefix(vIdLen, partId, vId, tagId), buf);
+    NebulaKeyUtils::edgePrefixTo(buf, vIdLen, partId, srcId, type);
+    ASSERT_EQ(NebulaKeyUtils::edgePrefix(vIdLen, partId, srcId, type), buf);
+}
+
 TEST(KeyUtilsTest, MiscTest) {
     PartitionID partId = 123;
     auto commitKey = NebulaKeyUtils::systemCommitKey(partId);
@@ -188,6 +213,58 @@ TEST(KeyUtilsTest, MiscTest) {
     ASSERT_TRUE(NebulaKeyUtils::isUUIDKey(uuidKey));
 }
 
+TEST(KeyUtilsTest, VersionTimeTest) {
+    size_t vIdLen = 8;
+    PartitionID partId = 123;
+    VertexID vId = "Vid";
+    TagID tagId = 2020;
+
+    // A minted version round-trips back to the microseconds it came from
+    int64_t timeUs = 1598516000000000L;
+    auto version = folly::Endian::big(std::numeric_limits<int64_t>::max() - timeUs);
+    auto key = NebulaKeyUtils::vertexKey(vIdLen, partId, vId, tagId, version);
+    ASSERT_EQ(timeUs, NebulaKeyUtils::getVersionTime(key));
+
+    // A later timestamp yields a key sorting before the earlier one, so
+    // the first version a forward scan meets is the latest
+    auto laterVersion = folly::Endian::big(std::numeric_limits<int64_t>::max() - (timeUs + 1));
+    auto laterKey = NebulaKeyUtils::vertexKey(vIdLen, partId, vId, tagId, laterVersion);
+    ASSERT_LT(laterKey, key);
+    ASSERT_EQ(timeUs + 1, NebulaKeyUtils::getVersionTime(laterKey));
+}
+
+TEST(KeyUtilsTest, VidAliasTest) {
+    PartitionID partId = 123;
+    auto prefix = NebulaKeyUtils::systemVidAliasPrefix(partId);
+    ASSERT_EQ(partId, NebulaKeyUtils::getPart(prefix));
+
+    // All three key kinds sort under the one prefix, so they travel as
+    // one range; the count key is the bare prefix and sorts first
+    auto countKey = NebulaKeyUtils::systemVidAliasCountKey(partId);
+    auto fwdKey = NebulaKeyUtils::systemVidAliasKey(partId, "Tim Duncan");
+    auto revKey = NebulaKeyUtils::systemVidAliasRevKey(partId, 42);
+    ASSERT_EQ(countKey, prefix);
+    ASSERT_EQ(fwdKey.find(prefix), 0);
+    ASSERT_EQ(revKey.find(prefix), 0);
+    ASSERT_LT(countKey, fwdKey);
+    ASSERT_LT(fwdKey, revKey);
+
+    // Forward keys keep the user vid verbatim, so distinct vids cannot
+    // clash
+    ASSERT_NE(fwdKey, NebulaKeyUtils::systemVidAliasKey(partId, "Tony Parker"));
+    ASSERT_EQ(fwdKey, NebulaKeyUtils::systemVidAliasKey(partId, "Tim Duncan"));
+
+    // The alias payload fits where a vid goes and round-trips
+    LocalVertexID localId = 0x0A0B0C0D;
+    auto vid = NebulaKeyUtils::localVid(localId);
+    ASSERT_EQ(sizeof(LocalVertexID), vid.size());
+    ASSERT_EQ(localId, NebulaKeyUtils::parseLocalVid(vid));
+    auto key = NebulaKeyUtils::vertexKey(vid.size(), partId, vid, 2020, 0L);
+    ASSERT_TRUE(NebulaKeyUtils::isVertex(vid.size(), key));
+    ASSERT_EQ(localId,
+              NebulaKeyUtils::parseLocalVid(NebulaKeyUtils::getVertexId(vid.size(), key)));
+}
+
 }  // namespace nebula
 
 
@@ -0,0 +1,82 @@
+/* Copyright (c) 2020 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <folly/futures/Future.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include "utils/RequestTrace.h"
+
+namespace nebula {
+
+TEST(RequestTraceTest, DisabledByDefault) {
+    ASSERT_EQ(0, FLAGS_trace_request_every_n);
+    RequestTrace::maybeStart("noop");
+    ASSERT_EQ(nullptr, RequestTrace::current());
+    // all of these must be no-ops without a trace
+    RequestTrace::record("span", 10);
+    RequestTrace::finish();
+    { TraceSpanGuard guard("span"); }
+}
+
+TEST(RequestTraceTest, SampledRequest) {
+    FLAGS_trace_request_every_n = 1;
+    RequestTrace::maybeStart("op");
+    auto* trace = RequestTrace::current();
+    ASSERT_NE(nullptr, trace);
+
+    { TraceSpanGuard guard("sync_span"); }
+    RequestTrace::record("manual_span", 42);
+    RequestTrace::finish();
+    // spans after finish are dropped instead of crashing
+    RequestTrace::record("late_span", 1);
+    FLAGS_trace_request_every_n = 0;
+}
+
+TEST(RequestTraceTest, PropagatesAcrossExecutor) {
+    FLAGS_trace_request_every_n = 1;
+    RequestTrace::maybeStart("op");
+    auto* trace = RequestTrace::current();
+    ASSERT_NE(nullptr, trace);
+
+    folly::CPUThreadPoolExecutor executor(1);
+    auto* onPool = folly::via(&executor, [] {
+        return RequestTrace::current();
+    }).get();
+    // the future callback carries the RequestContext to the pool thread
+    ASSERT_EQ(trace, onPool);
+
+    RequestTrace::finish();
+    FLAGS_trace_request_every_n = 0;
+}
+
+TEST(RequestTraceTest, Sampling) {
+    FLAGS_trace_request_every_n = 1000000;
+    // the shared request counter makes at most one of these hit the
+    // sampling slot; the rest must leave the context untraced
+    folly::RequestContext::create();
+    int traced = 0;
+    for (int i = 0; i < 10; i++) {
+        folly::RequestContext::create();
+        RequestTrace::maybeStart("op");
+        if (RequestTrace::current() != nullptr) {
+            traced++;
+        }
+    }
+    ASSERT_LE(traced, 1);
+    FLAGS_trace_request_every_n = 0;
+}
+
+}  // namespace nebula
+
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2021 vesoft inc. All rights reserved.
+ *
+ * This source code is licensed under Apache 2.0 License,
+ * attached with Common Clause Condition 1.0, found in the LICENSES directory.
+ */
+
+#include "common/base/Base.h"
+#include <gtest/gtest.h>
+#include <folly/synchronization/Baton.h>
+#include "utils/ThreadCachedCounter.h"
+
+namespace nebula {
+
+TEST(ThreadCachedCounterTest, SingleThread) {
+    ThreadCachedCounter counter;
+    EXPECT_EQ(0, counter.read());
+    counter.add();
+    counter.add(41);
+    EXPECT_EQ(42, counter.read());
+}
+
+TEST(ThreadCachedCounterTest, ConcurrentAdds) {
+    ThreadCachedCounter counter;
+    constexpr int32_t kThreads = 8;
+    constexpr int32_t kAddsPerThread = 10000;
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < kThreads; i++) {
+        threads.emplace_back([&counter] {
+            for (int32_t j = 0; j < kAddsPerThread; j++) {
+                counter.add();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    // The threads have exited, so their slabs folded into the carry
+    EXPECT_EQ(kThreads * kAddsPerThread, counter.read());
+}
+
+TEST(ThreadCachedCounterTest, ReadSeesLiveThreads) {
+    ThreadCachedCounter counter;
+    counter.add(1);
+    folly::Baton<> added;
+    folly::Baton<> release;
+    std::thread other([&] {
+        counter.add(2);
+        added.post();
+        release.wait();
+    });
+    added.wait();
+    // The other thread is still alive, its slab is summed directly
+    EXPECT_EQ(3, counter.read());
+    release.post();
+    other.join();
+}
+
+}  // namespace nebula
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    folly::init(&argc, &argv, true);
+    google::SetStderrLogging(google::INFO);
+
+    return RUN_ALL_TESTS();
+}